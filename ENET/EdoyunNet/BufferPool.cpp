@@ -0,0 +1,92 @@
+// 文件: BufferPool.cpp
+// 功能: 实现缓冲区池的分级查找与复用
+
+#include "BufferPool.h"
+
+std::atomic<uint64_t> BufferPool::total_pooled_bytes_(0);
+std::atomic<uint64_t> BufferPool::max_total_bytes_(256ULL * 1024 * 1024);
+
+BufferPool::BufferPool(uint64_t max_bytes)
+    : max_bytes_(max_bytes)
+{
+    for (uint32_t i = 0; i < kClasses; i++)
+    {
+        cursors_[i] = 0;
+    }
+}
+
+// 析构: 池内的块随 blocks_ 释放（仍被使用者持有的块由最后一个使用者释放），归还全局计数
+BufferPool::~BufferPool()
+{
+    total_pooled_bytes_ -= pooled_bytes_;
+}
+
+// GetClass: 128 字节以下为第 0 级；其余按最高位所在的 2 的幂区间与其后 2 位细分，向上取整
+uint32_t BufferPool::GetClass(uint32_t size, uint32_t& block_size)
+{
+    if (size <= ((uint32_t)1 << kMinShift))
+    {
+        block_size = (uint32_t)1 << kMinShift;
+        return 0;
+    }
+    uint32_t value = size - 1;
+    uint32_t shift = 31 - (uint32_t)__builtin_clz(value);          // value 位于 [2^shift, 2^(shift+1))
+    uint32_t step_shift = shift - kSubClassShift;
+    uint32_t sub = (value >> step_shift) & ((1u << kSubClassShift) - 1);
+    block_size = ((1u << kSubClassShift) + sub + 1) << step_shift;
+    return ((shift - kMinShift) << kSubClassShift) + sub + 1;
+}
+
+uint32_t BufferPool::GetBlockSize(uint32_t size)
+{
+    if (size > ((uint32_t)1 << kMaxShift))
+    {
+        return size;
+    }
+    uint32_t block_size = 0;
+    GetClass(size, block_size);
+    return block_size;
+}
+
+// Allocate: 从上次位置开始查找引用计数为 1（只被池持有）的块；
+// 没有空闲块时新建一块，本池与全局都未满则放入池中供之后复用
+std::shared_ptr<char> BufferPool::Allocate(uint32_t size)
+{
+    if (size > ((uint32_t)1 << kMaxShift))
+    {
+        misses_++;
+        return std::shared_ptr<char>(new char[size], std::default_delete<char[]>());
+    }
+
+    uint32_t block_size = 0;
+    uint32_t cls = GetClass(size, block_size);
+    std::vector<std::shared_ptr<char>>& blocks = blocks_[cls];
+    uint32_t count = (uint32_t)blocks.size();
+    for (uint32_t i = 0; i < count; i++)
+    {
+        uint32_t index = (cursors_[cls] + i) % count;
+        if (blocks[index].use_count() == 1)
+        {
+            // 其他线程释放时的写入先于其引用计数递减，这里与之同步后再复用
+            std::atomic_thread_fence(std::memory_order_acquire);
+            cursors_[cls] = index + 1;
+            hits_++;
+            return blocks[index];
+        }
+    }
+
+    misses_++;
+    std::shared_ptr<char> block(new char[block_size], std::default_delete<char[]>());
+    if (count < kMaxBlocksPerClass && pooled_bytes_ + block_size <= max_bytes_)
+    {
+        uint64_t total = total_pooled_bytes_.fetch_add(block_size) + block_size;
+        if (total > max_total_bytes_.load(std::memory_order_relaxed))
+        {
+            total_pooled_bytes_ -= block_size;
+            return block;
+        }
+        blocks.push_back(block);
+        pooled_bytes_ += block_size;
+    }
+    return block;
+}
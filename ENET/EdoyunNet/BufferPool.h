@@ -0,0 +1,69 @@
+// 文件: BufferPool.h
+// 功能: 分级复用的缓冲区池，避免每条消息都 new/delete 一块内存
+//
+// 池持有每块缓冲区的一份 shared_ptr，分配时直接返回副本；
+// 当所有使用者都释放后引用计数回到 1，该块即可再次分配，归还时无需回调也不分配控制块。
+// 每个 2 的幂区间再分 4 级（如 1024、1280、1536、1792、2048），块大小最多比请求大 25%；
+// 缓存上限按块大小计，GetBlockSize 给出请求实际占用的内存，供 GOP 缓存等按此计入各自的上限。
+// 除每个池的上限外，所有池合计的缓存字节数另有全局上限。
+// Allocate 只能在单个线程调用；返回的缓冲区可以在任意线程释放。
+
+#ifndef _BUFFERPOOL_H_
+#define _BUFFERPOOL_H_
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+class BufferPool
+{
+public:
+    // 构造函数
+    // @param max_bytes 池内缓冲区总上限（字节），超出时直接分配不入池
+    BufferPool(uint64_t max_bytes = 2 * 1024 * 1024);
+    ~BufferPool();
+
+    BufferPool(const BufferPool&) = delete;
+    BufferPool& operator = (const BufferPool&) = delete;
+
+    // 分配至少 size 字节的缓冲区，优先复用空闲块
+    std::shared_ptr<char> Allocate(uint32_t size);
+
+    // 请求 size 字节时实际分配的块大小，超过最大分级时即 size
+    static uint32_t GetBlockSize(uint32_t size);
+
+    // 设置所有池合计的缓存上限（字节），超出时新块直接分配不入池，已入池的块不受影响
+    static void SetMaxTotalBytes(uint64_t max_bytes) { max_total_bytes_ = max_bytes; }
+    // 所有池合计的缓存字节数
+    static uint64_t GetTotalPooledBytes() { return total_pooled_bytes_.load(std::memory_order_relaxed); }
+
+    // 池内缓冲区总字节数
+    inline uint64_t GetPooledBytes() const { return pooled_bytes_; }
+    // 复用空闲块的次数
+    inline uint64_t GetHits() const { return hits_; }
+    // 需要新分配内存的次数
+    inline uint64_t GetMisses() const { return misses_; }
+
+private:
+    static const uint32_t kMinShift = 7;             // 最小分级 128 字节
+    static const uint32_t kMaxShift = 22;            // 最大分级 4MB，更大的缓冲区不入池
+    static const uint32_t kSubClassShift = 2;        // 每个 2 的幂区间再分 4 级
+    static const uint32_t kClasses = ((kMaxShift - kMinShift) << kSubClassShift) + 1;
+    static const uint32_t kMaxBlocksPerClass = 64;   // 每级最多缓存的块数，限制查找空闲块的开销
+
+    // 计算 size 所属的分级，block_size 输出该级的块大小
+    static uint32_t GetClass(uint32_t size, uint32_t& block_size);
+
+    std::vector<std::shared_ptr<char>> blocks_[kClasses]; // 每级的缓冲区
+    uint32_t cursors_[kClasses];                     // 每级下一次开始查找的位置
+    uint64_t max_bytes_ = 0;                         // 池内总上限
+    uint64_t pooled_bytes_ = 0;                      // 池内总字节数
+    uint64_t hits_ = 0;
+    uint64_t misses_ = 0;
+
+    static std::atomic<uint64_t> total_pooled_bytes_; // 所有池合计的缓存字节数
+    static std::atomic<uint64_t> max_total_bytes_;    // 所有池合计的上限
+};
+
+#endif // _BUFFERPOOL_H_
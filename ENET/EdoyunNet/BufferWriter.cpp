@@ -6,6 +6,7 @@
 #include <string.h>     // memcpy
 #include <unistd.h>     // close
 #include <sys/socket.h> // send
+#include <sys/uio.h>    // writev
 #include <errno.h>      // errno 定义
 #include <stdio.h>      // printf（可选）
 
@@ -32,7 +33,8 @@ bool BufferWriter::Append(std::shared_ptr<char> data, uint32_t size, uint32_t in
     if (buffer_.size() >= max_queue_length_) return false;
     // 构造 Packet 对象并入队
     Packet pkt = { data, size, index };
-    buffer_.emplace(std::move(pkt));
+    buffer_.emplace_back(std::move(pkt));
+    bytes_ += size - index;
     return true;
 }
 
@@ -52,52 +54,80 @@ bool BufferWriter::Append(const char *data, uint32_t size, uint32_t index)
     memcpy(pkt.data.get(), data, size);
     pkt.size = size;
     pkt.writeIndex = index;
-    buffer_.emplace(std::move(pkt));
+    buffer_.emplace_back(std::move(pkt));
+    bytes_ += size - index;
     return true;
 }
 
 // Send 方法：
-// 从队列头部取出 Packet，调用 send 系统调用发送剩余数据
-// 支持部分发送继续和重试机制
-// 通过writeIndex 记录已发送偏移，直到整个 Packet 完全发送完毕后出队
-// 参数：sockfd - 已连接的 socket 文件描述符
+// 从队列头部起把多个 Packet 的剩余数据合并为一次 writev（单个包时用 send），
+// 零拷贝入队的小块数据（如 chunk 头部与负载切片交替入队）不会各自触发一次系统调用
+// 通过 writeIndex 记录已发送偏移，整个 Packet 发送完毕后出队
+// 参数：sockfd    - 已连接的 socket 文件描述符
+//       max_bytes - 本次最多发送的字节数，用于出口限速(pacing)，默认不限制
 // 返回：
 //   >0 - 本次实际发送的字节数
 //    0 - 队列为空或遇到 EINTR/EAGAIN 需要重试
 //   <0 - 发生其他发送错误
-int BufferWriter::Send(int sockfd)
+int BufferWriter::Send(int sockfd, uint32_t max_bytes)
 {
     int ret = 0;
-    // count 控制最多处理当前包及紧接完成的下一个包，避免一次循环处理过多
-    int count = 1;
-    do {
-        // 队列空，结束发送
-        if (buffer_.empty()) return 0;
-        count--;
-        Packet &pkt = buffer_.front();
-        // 从上次偏移处继续发送
-        // 调用 send 发送数据, sockfd 是已连接的 socket 文件描述符, 从 pkt.writeIndex 开始发送
-        // pkt.data.get() + pkt.writeIndex 是数据包剩余未发送部分的起始地址
-        // pkt.size - pkt.writeIndex 是剩余未发送的字节数
-        ret = ::send(sockfd, pkt.data.get() + pkt.writeIndex,
-                     pkt.size - pkt.writeIndex, 0);
+    uint32_t total = 0;
+    // 每次合并发送的数据全部写入内核后继续下一批，部分写入说明内核缓冲区已满，结束发送
+    while (!buffer_.empty() && total < max_bytes) {
+        struct iovec iov[kMaxIovecs];
+        int iovcnt = 0;
+        uint32_t bytes = 0;
+        for (auto iter = buffer_.begin(); iter != buffer_.end() && iovcnt < kMaxIovecs && total + bytes < max_bytes; ++iter) {
+            // 剩余长度受本次发送额度限制
+            uint32_t len = iter->size - iter->writeIndex;
+            if (len > max_bytes - total - bytes) {
+                len = max_bytes - total - bytes;
+            }
+            iov[iovcnt].iov_base = iter->data.get() + iter->writeIndex;
+            iov[iovcnt].iov_len = len;
+            iovcnt++;
+            bytes += len;
+        }
+        if (iovcnt == 1) {
+            ret = ::send(sockfd, iov[0].iov_base, iov[0].iov_len, 0);
+        }
+        else {
+            ret = ::writev(sockfd, iov, iovcnt);
+        }
+        send_calls_++;
         if (ret > 0) {
-            // 更新已发送偏移
-            pkt.writeIndex += ret;
-            // 数据包发送完毕，出队并允许再次发送下一个包
-            if (pkt.writeIndex == pkt.size) {
-                count++;
-                buffer_.pop();
+            total += ret;
+            bytes_ -= ret;
+            // 按已发送字节数推进各包的偏移，发送完毕的包出队
+            uint32_t sent = (uint32_t)ret;
+            while (sent > 0) {
+                Packet &pkt = buffer_.front();
+                uint32_t len = pkt.size - pkt.writeIndex;
+                if (len > sent) {
+                    pkt.writeIndex += sent;
+                    break;
+                }
+                sent -= len;
+                buffer_.pop_front();
+            }
+            if ((uint32_t)ret < bytes) {
+                break;
             }
         }
         else if (ret < 0) {
             // 对于中断和缓冲区暂无空间情况，不算错误，由调用者重试
             if (errno == EINTR || errno == EAGAIN) {
                 ret = 0;
+                break;
             }
+            return ret;
+        }
+        else {
+            break;
         }
-    } while (count > 0);
-    return ret;
+    }
+    return total > 0 ? (int)total : ret;
 }
 
 // 以下为整数按不同端序写入缓冲区的工具函数，方便协议编码
@@ -1,7 +1,7 @@
 #ifndef _BUFFERWRITER_H_
 #define _BUFFERWRITER_H_
+#include <deque>
 #include <memory>
-#include <queue>
 
 void WriteUint32BE(char* p,uint32_t value);
 void WriteUint32LE(char* p,uint32_t value);
@@ -18,7 +18,7 @@ public:
 
 	bool Append(std::shared_ptr<char> data, uint32_t size, uint32_t index=0);
 	bool Append(const char* data, uint32_t size, uint32_t index=0);
-	int Send(int sockfd);
+	int Send(int sockfd, uint32_t max_bytes = 0xFFFFFFFF);
 
 	bool IsEmpty() const 
 	{ return buffer_.empty(); }
@@ -28,6 +28,14 @@ public:
 
 	uint32_t Size() const 
 	{ return (uint32_t)buffer_.size(); }
+
+	// 队列中尚未发送的字节数
+	uint64_t Bytes() const
+	{ return bytes_; }
+
+	// 累计调用 send/writev 的次数
+	uint64_t SendCalls() const
+	{ return send_calls_; }
 	
 private:
 	typedef struct 
@@ -37,8 +45,11 @@ private:
 		uint32_t writeIndex;
 	} Packet;
 
-	std::queue<Packet> buffer_;  		
+	std::deque<Packet> buffer_;  		
 	int max_queue_length_ = 0;
+	uint64_t bytes_ = 0;
+	uint64_t send_calls_ = 0;
 	static const int kMaxQueueLength = 10000;
+	static const int kMaxIovecs = 64;  // 一次 writev 最多合并的数据包数
 };
 #endif
\ No newline at end of file
@@ -34,6 +34,17 @@ std::shared_ptr<TaskScheduler> EventLoop::GetTaskSchduler()
     }
 }
 
+// GetTaskSchduler: 按序号获取 TaskScheduler，序号对线程数取模
+// 参数: index - 序号，例如流路径的哈希值
+// 返回: 共享指针形式的 TaskScheduler
+std::shared_ptr<TaskScheduler> EventLoop::GetTaskSchduler(uint32_t index)
+{
+    if (task_schdulers_.empty()) {
+        return nullptr;
+    }
+    return task_schdulers_.at(index % task_schdulers_.size());
+}
+
 // AddTimer: 将定时任务添加到首个 TaskScheduler
 // 参数: event - 定时回调; mesc - 间隔毫秒
 // 返回: TimerId
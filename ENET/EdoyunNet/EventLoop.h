@@ -20,6 +20,12 @@ public:
     // 获取下一个可用的 TaskScheduler，用于分配 IO 或定时任务
     std::shared_ptr<TaskScheduler> GetTaskSchduler();
 
+    // 获取指定序号的 TaskScheduler，序号按线程数取模，用于把同一资源固定到同一线程
+    std::shared_ptr<TaskScheduler> GetTaskSchduler(uint32_t index);
+
+    // 获取 TaskScheduler 线程数
+    inline uint32_t GetThreadNum() const { return (uint32_t)task_schdulers_.size(); }
+
     // 添加定时器任务到第一个 TaskScheduler
     TimerId AddTimer(const TimerEvent& event, uint32_t mesc);
 
@@ -0,0 +1,175 @@
+// 文件: SnapshotMap.h
+// 功能: 读多写少的并发哈希表，按键分片，每个分片保存一份不可变快照
+//
+// 读操作原子地取得分片快照后直接查找，不持有互斥锁；
+// 写操作在分片锁内复制快照、修改后原子替换，旧快照在最后一个读者释放后销毁。
+// 适用于会话表等查找频繁、增删很少的场景，写入代价为单个分片的大小。
+
+#ifndef _SNAPSHOTMAP_H_
+#define _SNAPSHOTMAP_H_
+
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+template <typename Key, typename Value, typename Hash = std::hash<Key>>
+class SnapshotMap
+{
+public:
+    using Map = std::unordered_map<Key, Value, Hash>;
+
+    // 构造函数
+    // @param shards 分片数量，写入时只复制键所在的分片
+    explicit SnapshotMap(uint32_t shards = 64)
+        : shards_(shards > 0 ? shards : 1)
+    {
+        for (Shard& shard : shards_)
+        {
+            shard.map = std::make_shared<Map>();
+        }
+    }
+
+    SnapshotMap(const SnapshotMap&) = delete;
+    SnapshotMap& operator = (const SnapshotMap&) = delete;
+
+    // 查找键，存在时写入 value 并返回 true（无锁）
+    bool Find(const Key& key, Value& value) const
+    {
+        auto map = Load(GetShard(key));
+        auto iter = map->find(key);
+        if (iter == map->end())
+        {
+            return false;
+        }
+        value = iter->second;
+        return true;
+    }
+
+    // 查找键，不存在时调用 create 生成并插入；create 在分片锁内调用，同一个键只会创建一次
+    Value GetOrCreate(const Key& key, const std::function<Value()>& create)
+    {
+        Value value;
+        if (Find(key, value))
+        {
+            return value;
+        }
+
+        Shard& shard = GetShard(key);
+        std::lock_guard<std::mutex> lock(shard.mutex);
+        auto map = Load(shard);
+        auto iter = map->find(key);
+        if (iter != map->end())
+        {
+            return iter->second;
+        }
+        std::shared_ptr<Map> new_map = std::make_shared<Map>(*map);
+        value = create();
+        (*new_map)[key] = value;
+        Store(shard, new_map);
+        return value;
+    }
+
+    // 删除键，返回是否存在
+    bool Erase(const Key& key)
+    {
+        Shard& shard = GetShard(key);
+        std::lock_guard<std::mutex> lock(shard.mutex);
+        auto map = Load(shard);
+        if (map->find(key) == map->end())
+        {
+            return false;
+        }
+        std::shared_ptr<Map> new_map = std::make_shared<Map>(*map);
+        new_map->erase(key);
+        Store(shard, new_map);
+        return true;
+    }
+
+    // 删除满足条件的元素，返回删除数量；pred 在分片锁内调用
+    size_t EraseIf(const std::function<bool(const Key&, const Value&)>& pred)
+    {
+        size_t erased = 0;
+        for (Shard& shard : shards_)
+        {
+            std::lock_guard<std::mutex> lock(shard.mutex);
+            auto map = Load(shard);
+            std::shared_ptr<Map> new_map;
+            for (auto& entry : *map)
+            {
+                if (pred(entry.first, entry.second))
+                {
+                    if (!new_map)
+                    {
+                        new_map = std::make_shared<Map>(*map);
+                    }
+                    new_map->erase(entry.first);
+                    erased++;
+                }
+            }
+            if (new_map)
+            {
+                Store(shard, new_map);
+            }
+        }
+        return erased;
+    }
+
+    // 遍历所有元素（各分片的快照，无锁），遍历期间的增删不可见
+    void ForEach(const std::function<void(const Key&, const Value&)>& func) const
+    {
+        for (const Shard& shard : shards_)
+        {
+            auto map = Load(shard);
+            for (auto& entry : *map)
+            {
+                func(entry.first, entry.second);
+            }
+        }
+    }
+
+    // 元素数量（各分片快照之和）
+    size_t Size() const
+    {
+        size_t size = 0;
+        for (const Shard& shard : shards_)
+        {
+            size += Load(shard)->size();
+        }
+        return size;
+    }
+
+private:
+    // Shard: 一个分片，mutex 只串行化写操作
+    struct Shard
+    {
+        std::mutex mutex;
+        std::shared_ptr<const Map> map;
+    };
+
+    Shard& GetShard(const Key& key)
+    {
+        return shards_[Hash()(key) % shards_.size()];
+    }
+
+    const Shard& GetShard(const Key& key) const
+    {
+        return shards_[Hash()(key) % shards_.size()];
+    }
+
+    static std::shared_ptr<const Map> Load(const Shard& shard)
+    {
+        return std::atomic_load(&shard.map);
+    }
+
+    static void Store(Shard& shard, std::shared_ptr<const Map> map)
+    {
+        std::atomic_store(&shard.map, map);
+    }
+
+    std::vector<Shard> shards_;
+};
+
+#endif // _SNAPSHOTMAP_H_
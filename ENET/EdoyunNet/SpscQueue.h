@@ -0,0 +1,79 @@
+// 文件: SpscQueue.h
+// 功能: 有界的单生产者单消费者无锁环形队列
+//
+// 生产者与消费者各自只写一个下标，通过 acquire/release 同步，入队出队都不加锁也不分配内存；
+// 队列满时 TryPush 立即返回 false，由调用者决定丢弃还是重试，生产者永远不会被消费者阻塞。
+// 同一时刻只能有一个线程入队、一个线程出队；生产者线程可以更换，只要更换前后有 happens-before 关系。
+
+#ifndef _SPSCQUEUE_H_
+#define _SPSCQUEUE_H_
+
+#include <atomic>
+#include <cstddef>
+#include <utility>
+#include <vector>
+
+template <typename T>
+class SpscQueue
+{
+public:
+    // 构造函数
+    // @param capacity 容量，向上取整到 2 的幂
+    explicit SpscQueue(size_t capacity)
+    {
+        size_t size = 2;
+        while (size < capacity)
+        {
+            size <<= 1;
+        }
+        slots_.resize(size);
+        mask_ = size - 1;
+    }
+
+    SpscQueue(const SpscQueue&) = delete;
+    SpscQueue& operator = (const SpscQueue&) = delete;
+
+    // 入队（仅生产者线程调用），队列满时返回 false
+    bool TryPush(T value)
+    {
+        size_t tail = tail_.load(std::memory_order_relaxed);
+        if (tail - head_.load(std::memory_order_acquire) > mask_)
+        {
+            return false;
+        }
+        slots_[tail & mask_] = std::move(value);
+        tail_.store(tail + 1, std::memory_order_release);
+        return true;
+    }
+
+    // 出队（仅消费者线程调用），队列空时返回 false；取出后槽位被清空，及时释放引用的资源
+    bool TryPop(T& value)
+    {
+        size_t head = head_.load(std::memory_order_relaxed);
+        if (head == tail_.load(std::memory_order_acquire))
+        {
+            return false;
+        }
+        value = std::move(slots_[head & mask_]);
+        slots_[head & mask_] = T();
+        head_.store(head + 1, std::memory_order_release);
+        return true;
+    }
+
+    // 当前元素个数（近似值，任意线程可调用）
+    size_t Size() const
+    {
+        return tail_.load(std::memory_order_acquire) - head_.load(std::memory_order_acquire);
+    }
+
+    // 容量
+    size_t Capacity() const { return mask_ + 1; }
+
+private:
+    std::vector<T> slots_;
+    size_t mask_ = 0;
+    alignas(64) std::atomic<size_t> head_{0};   // 消费者下标，与生产者下标分开缓存行避免伪共享
+    alignas(64) std::atomic<size_t> tail_{0};   // 生产者下标
+};
+
+#endif // _SPSCQUEUE_H_
@@ -24,6 +24,8 @@ void TaskScheduler::Start()
         this->timer_queue_.HandleTimerEvent();
         // 处理 IO 事件，具体由子类实现
         this->HandleEvent();
+        // 处理上一轮因预算用尽而留下的剩余工作
+        this->HandleReadyTasks();
     }
 }
 
@@ -47,3 +49,29 @@ void TaskScheduler::RemvoTimer(TimerId timerId)
 {
     timer_queue_.RemoveTimer(timerId);
 }
+
+// AddReadyTask: 将任务加入就绪列表，下一次 HandleReadyTasks 时执行
+void TaskScheduler::AddReadyTask(const ReadyTask &task)
+{
+    std::lock_guard<std::mutex> lock(ready_mutex_);
+    ready_tasks_.push_back(task);
+}
+
+// HandleReadyTasks: 取出当前就绪列表并逐个执行
+// 先整体交换出来，执行过程中新加入的任务留到下一轮，保证每轮每个连接只处理一个预算
+void TaskScheduler::HandleReadyTasks()
+{
+    std::vector<ReadyTask> tasks;
+    {
+        std::lock_guard<std::mutex> lock(ready_mutex_);
+        if (ready_tasks_.empty())
+        {
+            return;
+        }
+        tasks.swap(ready_tasks_);
+    }
+    for (auto &task : tasks)
+    {
+        task();
+    }
+}
@@ -9,6 +9,10 @@
 #include "Channel.h"
 #include <atomic>
 #include <mutex>
+#include <vector>
+
+// ReadyTask: 就绪列表中的任务，用于承接上一轮未处理完的工作（如连接读缓冲区中剩余的数据）
+typedef std::function<void(void)> ReadyTask;
 
 class TaskScheduler
 {
@@ -33,14 +37,24 @@ public:
     // 处理 IO 事件，返回是否继续运行
     virtual bool HandleEvent(){return false;}
 
+    // 添加就绪任务: 在本轮 IO 事件处理之后执行一次，任务中再次添加的任务留到下一轮
+    // 用于限制单个连接每轮的处理量，剩余工作延后执行，避免饿死同线程的其他连接
+    void AddReadyTask(const ReadyTask& task);
+
     // 获取调度器 ID
     inline int GetId() const { return id_; }
 
+protected:
+    // 执行当前就绪列表中的所有任务
+    void HandleReadyTasks();
+
 private:
     int id_ = 0;                         // 调度器唯一 ID
     std::mutex mutex_;                   // 保护定时器队列等共享资源
     TimerQueue timer_queue_;             // 定时器管理器
     std::atomic_bool is_shutdown_;       // 调度器停止标志
+    std::mutex ready_mutex_;             // 保护 ready_tasks_
+    std::vector<ReadyTask> ready_tasks_; // 就绪列表：上一轮留下的剩余工作
 };
 
 #endif
\ No newline at end of file
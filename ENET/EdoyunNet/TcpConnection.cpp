@@ -13,6 +13,7 @@ TcpConnection::TcpConnection(TaskScheduler *task_schduler, int sockfd)
     , read_buffer_(new BufferReader())            // 初始化读缓冲区
     , write_buffer_(new BufferWriter(500))        // 初始化写缓冲区，容量为500
     , channel_(new Channel(sockfd))               // 创建用于事件驱动的 Channel
+    , pacing_timer_(false)
 {
     is_closed_ = false;
     // 注册 Channel 读写关闭错误事件的处理函数
@@ -23,7 +24,7 @@ TcpConnection::TcpConnection(TaskScheduler *task_schduler, int sockfd)
 
     // 设置 socket 属性：非阻塞、发送缓冲区、心跳保活
     SocketUtil::SetNonBlock(sockfd);
-    SocketUtil::SetSendBufSize(sockfd, 100 * 1024);
+    SocketUtil::SetSendBufSize(sockfd, send_buf_size_);
     SocketUtil::SetKeepAlive(sockfd);
 
     // 启用读事件，并注册到 TaskScheduler
@@ -72,6 +73,100 @@ void TcpConnection::DisConnect()
     this->Close();
 }
 
+// SetPacingRate: 开启/关闭令牌桶出口限速
+// @param rate  限速速率（字节/秒），0 表示关闭
+// @param burst 桶容量（字节），0 表示按速率自动取值
+void TcpConnection::SetPacingRate(uint32_t rate, uint32_t burst)
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    pacer_.Reset(rate, burst);
+}
+
+// SetReadRate: 开启/关闭令牌桶入口限速
+// @param rate  限速速率（字节/秒），0 表示关闭
+// @param burst 桶容量（字节），0 表示按速率自动取值
+void TcpConnection::SetReadRate(uint32_t rate, uint32_t burst)
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    read_pacer_.Reset(rate, burst);
+}
+
+// SetKernelPacingRate: 交给内核按包平滑发送，fq 队列规则下效果最佳
+bool TcpConnection::SetKernelPacingRate(uint32_t rate)
+{
+    return SocketUtil::SetMaxPacingRate(channel_->GetSocket(), rate);
+}
+
+// EnableTransportStats: 在所属调度器上注册周期定时器采样 TCP_INFO
+// 定时器仅持有弱引用，连接关闭或析构后自动停止
+void TcpConnection::EnableTransportStats(uint32_t mesc, bool adaptive_sndbuf)
+{
+    adaptive_sndbuf_ = adaptive_sndbuf;
+    this->SampleTransportInfo();
+    std::weak_ptr<TcpConnection> weak_conn = shared_from_this();
+    task_schduler_->AddTimer([weak_conn]() {
+        auto conn = weak_conn.lock();
+        if (!conn || conn->IsClosed())
+        {
+            return false;
+        }
+        conn->SampleTransportInfo();
+        return true;
+    }, mesc);
+}
+
+// GetTransportInfo: 返回最近一次采样结果的拷贝
+TcpTransportInfo TcpConnection::GetTransportInfo()
+{
+    std::lock_guard<std::mutex> lock(info_mutex_);
+    return transport_info_;
+}
+
+// SetNotSentLowat: 限制内核中尚未发出的数据量，其余数据留在应用层队列，便于上层丢帧
+bool TcpConnection::SetNotSentLowat(uint32_t bytes)
+{
+    return SocketUtil::SetNotSentLowat(channel_->GetSocket(), bytes);
+}
+
+// GetPendingBytes: 应用层写队列积压字节数
+uint64_t TcpConnection::GetPendingBytes()
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    return write_buffer_->Bytes();
+}
+
+// SampleTransportInfo: 读取 TCP_INFO；开启自适应时将 SO_SNDBUF 设为 2 倍 BDP
+// BDP = 交付速率 * RTT，结果限制在 [16KB, 4MB]，变化不足 25% 时不调整以减少系统调用
+void TcpConnection::SampleTransportInfo()
+{
+    TcpTransportInfo info;
+    if (!SocketUtil::GetTcpInfo(channel_->GetSocket(), info))
+    {
+        return;
+    }
+    {
+        std::lock_guard<std::mutex> lock(info_mutex_);
+        transport_info_ = info;
+    }
+
+    if (adaptive_sndbuf_ && info.delivery_rate > 0 && info.rtt > 0)
+    {
+        static const uint64_t kMinSendBuf = 16 * 1024;
+        static const uint64_t kMaxSendBuf = 4 * 1024 * 1024;
+        uint64_t bdp = info.delivery_rate * info.rtt / 1000000;
+        uint64_t target = bdp * 2;
+        if (target < kMinSendBuf) { target = kMinSendBuf; }
+        if (target > kMaxSendBuf) { target = kMaxSendBuf; }
+        int64_t diff = (int64_t)target - send_buf_size_;
+        if (diff < 0) { diff = -diff; }
+        if (diff * 4 > send_buf_size_)
+        {
+            send_buf_size_ = (int)target;
+            SocketUtil::SetSendBufSize(channel_->GetSocket(), send_buf_size_);
+        }
+    }
+}
+
 // HandleRead: 处理可读事件
 // 1. 从 socket 读取数据到 read_buffer_
 // 2. 调用用户回调 ReadCallback 处理数据，返回 false 则关闭连接
@@ -80,12 +175,19 @@ void TcpConnection::HandleRead()
     {
         std::lock_guard<std::mutex> lock(mutex_);
         if (is_closed_) { return; }
+        if (read_pacer_.IsEnabled() && read_pacer_.Available() == 0)
+        {
+            this->WaitForReadTokens();
+            return;
+        }
         int ret = read_buffer_->Read(channel_->GetSocket());
         if (ret < 0)
         {
             this->Close();
             return;
         }
+        read_pacer_.Consume(ret);
+        received_bytes_.store(received_bytes_.load(std::memory_order_relaxed) + ret, std::memory_order_relaxed);
     }
     if (readCb_)
     {
@@ -94,25 +196,146 @@ void TcpConnection::HandleRead()
         {
             std::lock_guard<std::mutex> lock(mutex_);
             this->Close();
+            return;
+        }
+    }
+    this->HandleMigration();
+}
+
+// ScheduleReadContinuation: 暂停读事件并登记到就绪列表，下一轮继续处理剩余数据
+void TcpConnection::ScheduleReadContinuation()
+{
+    if (read_pending_ || is_closed_)
+    {
+        return;
+    }
+    read_pending_ = true;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (channel_->IsReading())
+        {
+            channel_->DisableReading();
+            task_schduler_->UpdateChannel(channel_);
         }
     }
+    std::weak_ptr<TcpConnection> weak_conn = shared_from_this();
+    task_schduler_->AddReadyTask([weak_conn]() {
+        auto conn = weak_conn.lock();
+        if (conn)
+        {
+            conn->HandleReadContinuation();
+        }
+    });
 }
 
-// HandleWrite: 处理可写事件
-// 1. 从 write_buffer_ 发送数据
-// 2. 根据缓冲区是否为空启用/禁用写事件
+// HandleReadContinuation: 在已有读缓冲区上再次调用读回调
+// 回调若仍未处理完会再次登记；处理完毕后恢复读事件
+void TcpConnection::HandleReadContinuation()
+{
+    read_pending_ = false;
+    if (is_closed_) { return; }
+    if (readCb_)
+    {
+        bool ret = readCb_(shared_from_this(), *read_buffer_);
+        if (!ret)
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            this->Close();
+            return;
+        }
+    }
+    if (!read_pending_)
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (!is_closed_ && !channel_->IsReading())
+        {
+            channel_->EnableReading();
+            task_schduler_->UpdateChannel(channel_);
+        }
+    }
+    this->HandleMigration();
+}
+
+// MigrateTo: 登记迁移目标，实际迁移推迟到读回调返回之后，避免两个线程同时处理本连接的读事件
+void TcpConnection::MigrateTo(TaskScheduler* scheduler, const ReadyTask& on_migrated)
+{
+    migrate_target_ = scheduler;
+    migrate_callback_ = on_migrated;
+}
+
+// HandleMigration: 从当前 epoll 注销 Channel 并注册到目标调度器
+// 水平触发下迁移期间到达的数据会在目标调度器上报告；已登记的定时器仍留在原调度器
+void TcpConnection::HandleMigration()
+{
+    // 原调度器上仍登记着读续处理任务时，等续处理完成后再迁移
+    if (read_pending_)
+    {
+        return;
+    }
+    TaskScheduler* target = migrate_target_;
+    ReadyTask callback = migrate_callback_;
+    migrate_target_ = nullptr;
+    migrate_callback_ = nullptr;
+    if (target == nullptr || is_closed_)
+    {
+        return;
+    }
+
+    if (target != task_schduler_)
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (is_closed_)
+        {
+            return;
+        }
+        task_schduler_->RmoveChannel(channel_);
+        task_schduler_ = target;
+        task_schduler_->UpdateChannel(channel_);
+    }
+    if (callback)
+    {
+        target->AddReadyTask(callback);
+    }
+}
+
+// HandleWrite: 处理可写事件，锁被占用时本次不发送
 void TcpConnection::HandleWrite()
 {
     if (is_closed_) { return; }
     if (!mutex_.try_lock()) { return; }
+    this->WriteLocked();
+}
+
+// WriteLocked: 持有 mutex_ 时发送，返回前释放
+// 1. 从 write_buffer_ 发送数据，开启限速时发送量不超过令牌数
+// 2. 根据缓冲区是否为空启用/禁用写事件，令牌耗尽时改由定时器唤醒
+// 3. 发送后队列降到低水位以下时，在释放锁后调用写队列回调
+void TcpConnection::WriteLocked()
+{
+    if (is_closed_)
+    {
+        mutex_.unlock();
+        return;
+    }
+
+    uint32_t quota = pacer_.Available();
+    if (quota == 0)
+    {
+        this->WaitForPacing();
+        mutex_.unlock();
+        return;
+    }
 
-    int ret = write_buffer_->Send(channel_->GetSocket());
+    int ret = write_buffer_->Send(channel_->GetSocket(), quota);
+    send_calls_.store(write_buffer_->SendCalls(), std::memory_order_relaxed);
     if (ret < 0)
     {
         this->Close();
         mutex_.unlock();
         return;
     }
+    pacer_.Consume(ret);
+    sent_bytes_.store(sent_bytes_.load(std::memory_order_relaxed) + ret, std::memory_order_relaxed);
     bool empty = write_buffer_->IsEmpty();
 
     if (empty)
@@ -123,12 +346,79 @@ void TcpConnection::HandleWrite()
             task_schduler_->UpdateChannel(channel_);
         }
     }
+    else if (pacer_.IsEnabled() && pacer_.Available() == 0)
+    {
+        this->WaitForPacing();
+    }
     else if (!channel_->IsWriting())
     {
         channel_->EnableWriting();
         task_schduler_->UpdateChannel(channel_);
     }
+    bool notify = writeCb_ && ret > 0 && write_buffer_->Bytes() <= write_low_watermark_;
     mutex_.unlock();
+
+    if (notify)
+    {
+        writeCb_(shared_from_this());
+    }
+}
+
+// WaitForPacing: 令牌耗尽，停止监听写事件防止空转，注册一次性定时器在令牌补足后重试
+// 此时写事件已关闭，定时器是唯一的唤醒来源，因此定时器中阻塞等锁而不是 try_lock，
+// 锁可能正被其他线程的 GetPendingBytes 等短暂持有，放弃会使连接停在有数据却无人发送的状态
+void TcpConnection::WaitForPacing()
+{
+    if (channel_->IsWriting())
+    {
+        channel_->DisableWriting();
+        task_schduler_->UpdateChannel(channel_);
+    }
+    if (pacing_timer_.exchange(true))
+    {
+        return; // 已有定时器在等待
+    }
+    std::weak_ptr<TcpConnection> weak_conn = shared_from_this();
+    task_schduler_->AddTimer([weak_conn]() {
+        auto conn = weak_conn.lock();
+        if (conn)
+        {
+            conn->mutex_.lock();
+            conn->pacing_timer_ = false;
+            conn->WriteLocked();
+        }
+        return false;
+    }, pacer_.WaitTime(1460));
+}
+
+// WaitForReadTokens: 读令牌耗尽，停止监听读事件（水平触发下否则会空转），令牌补足后恢复
+void TcpConnection::WaitForReadTokens()
+{
+    if (channel_->IsReading())
+    {
+        channel_->DisableReading();
+        task_schduler_->UpdateChannel(channel_);
+    }
+    if (read_timer_)
+    {
+        return; // 已有定时器在等待
+    }
+    read_timer_ = true;
+    std::weak_ptr<TcpConnection> weak_conn = shared_from_this();
+    task_schduler_->AddTimer([weak_conn]() {
+        auto conn = weak_conn.lock();
+        if (conn)
+        {
+            std::lock_guard<std::mutex> lock(conn->mutex_);
+            conn->read_timer_ = false;
+            if (!conn->is_closed_ && !conn->read_pending_ && !conn->channel_->IsReading())
+            {
+                conn->channel_->EnableReading();
+                conn->task_schduler_->UpdateChannel(conn->channel_);
+            }
+        }
+        return false;
+    }, read_pacer_.WaitTime(4096));      // 每次读取至多 4KB（BufferReader::Read）
 }
 
 // HandleClose: 处理连接挂起/关闭事件
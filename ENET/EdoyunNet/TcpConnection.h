@@ -9,6 +9,8 @@
 #include "Channel.h"
 #include "TcpSocket.h"
 #include "TaskScheduler.h"
+#include "TokenBucket.h"
+#include <vector>
 
 // TcpConnection: 表示一个客户端连接
 //  - 通过 Channel 注册可读、可写、关闭、错误等事件
@@ -24,6 +26,8 @@ public:
     using CloseCallback     = std::function<void(Ptr)>;
     // 可读事件回调: 处理读取到的数据，返回 false 则关闭连接
     using ReadCallback      = std::function<bool(Ptr, BufferReader&)>;
+    // 写队列回调: 发送队列积压降到低水位以下时调用，供上层按需填充数据
+    using WriteCallback     = std::function<void(Ptr)>;
 
     // 构造函数: 初始化调度器、缓冲区和事件通道
     // @param task_schduler 所属 TaskScheduler，用于注册 IO 事件
@@ -39,6 +43,9 @@ public:
     inline void SetReadCallback(const ReadCallback& cb) { readCb_ = cb; }
     // 注册关闭事件回调
     inline void SetCloseCallback(const CloseCallback& cb) { closeCb_ = cb; }
+    // 注册写队列低水位回调: 每次发送后队列剩余字节数不超过 low_watermark 时触发
+    inline void SetWriteCallback(const WriteCallback& cb, uint32_t low_watermark)
+    { writeCb_ = cb; write_low_watermark_ = low_watermark; }
     // 判断连接是否已关闭
     inline bool IsClosed() const { return is_closed_; }
     // 获取套接字描述符
@@ -47,9 +54,86 @@ public:
     // 发送数据: 支持零拷贝和拷贝两种重载
     void Send(std::shared_ptr<char> data, uint32_t size);
     void Send(const char* data, uint32_t size);
+    // 在发送锁内生成数据并入队: build(uint32_t& size) 返回数据缓冲区，nullptr 表示不发送。
+    // 生成时依赖的发送端状态（如 RTMP chunk 头部压缩）与入队顺序一致，多线程发送时不会错位；
+    // build 内不得调用本连接的其他接口
+    template<typename Builder>
+    void SendInOrder(Builder build)
+    {
+        if (is_closed_)
+        {
+            return;
+        }
+        uint32_t size = 0;
+        mutex_.lock();
+        std::shared_ptr<char> data = build(size);
+        if (data && size > 0)
+        {
+            write_buffer_->Append(data, size);
+        }
+        mutex_.unlock();
+        if (data && size > 0)
+        {
+            this->HandleWrite();  // 立即尝试写
+        }
+    }
+    // 在发送锁内生成多段数据并依次入队: build(segments) 追加 {缓冲区, 长度}，各段可以是不同缓冲区的切片
+    // （如文件映射上的别名指针），负载不拷贝，由 BufferWriter 合并为一次 writev 发送；约束与 SendInOrder 相同
+    template<typename Builder>
+    void SendSegmentsInOrder(Builder build)
+    {
+        if (is_closed_)
+        {
+            return;
+        }
+        std::vector<std::pair<std::shared_ptr<char>, uint32_t>> segments;
+        mutex_.lock();
+        build(segments);
+        for (auto &segment : segments)
+        {
+            if (segment.first && segment.second > 0)
+            {
+                write_buffer_->Append(segment.first, segment.second);
+            }
+        }
+        mutex_.unlock();
+        if (!segments.empty())
+        {
+            this->HandleWrite();  // 立即尝试写
+        }
+    }
     // 主动断开连接
     void DisConnect();
 
+    // 设置出口限速(pacing): 令牌桶速率与桶容量（字节/秒、字节），rate 为 0 表示关闭
+    // 令牌不足时暂停写事件，由定时器在令牌补足后恢复发送，避免关键帧突发
+    void SetPacingRate(uint32_t rate, uint32_t burst = 0);
+    // 设置内核层 SO_MAX_PACING_RATE（需 fq 队列规则才能逐包平滑），返回是否设置成功
+    bool SetKernelPacingRate(uint32_t rate);
+    // 设置入口限速: 令牌桶速率与桶容量（字节/秒、字节），rate 为 0 表示关闭
+    // 令牌不足时暂停读事件，内核接收队列填满后由 TCP 流控向对端施加背压，用于模拟读得慢的客户端
+    void SetReadRate(uint32_t rate, uint32_t burst = 0);
+
+    // 开启传输层统计: 每 mesc 毫秒采样一次 TCP_INFO
+    // adaptive_sndbuf 为 true 时按带宽时延积(BDP)调整 SO_SNDBUF
+    void EnableTransportStats(uint32_t mesc, bool adaptive_sndbuf = true);
+    // 获取最近一次采样的传输层状态（可跨线程调用）
+    TcpTransportInfo GetTransportInfo();
+    // 设置 TCP_NOTSENT_LOWAT，缩短内核发送队列，适用于对时延敏感的流
+    bool SetNotSentLowat(uint32_t bytes);
+    // 应用层发送队列中尚未写入内核的字节数
+    uint64_t GetPendingBytes();
+    // 累计写入内核、从内核读取的字节数（可跨线程调用）
+    uint64_t GetSentBytes() const { return sent_bytes_.load(std::memory_order_relaxed); }
+    uint64_t GetReceivedBytes() const { return received_bytes_.load(std::memory_order_relaxed); }
+    // 累计调用 send/writev 的次数（可跨线程调用）
+    uint64_t GetSendCalls() const { return send_calls_.load(std::memory_order_relaxed); }
+
+    // 迁移到另一个调度器: 在本轮读回调返回后，把 Channel 从当前 epoll 移到 scheduler 的 epoll，
+    // 之后的 IO 事件都在 scheduler 线程处理；迁移完成后在 scheduler 线程执行 on_migrated
+    // 只能在本连接的读回调中调用
+    void MigrateTo(TaskScheduler* scheduler, const ReadyTask& on_migrated);
+
 protected:
     // 事件处理回调: 由 Channel 在对应事件发生时触发
     virtual void HandleRead();   // 处理可读事件
@@ -57,6 +141,10 @@ protected:
     virtual void HandleClose();  // 处理挂起/关闭事件
     virtual void HandleError();  // 处理错误事件
 
+    // 读回调用完本轮处理预算时调用: 暂停读事件（向对端施加背压），
+    // 并把剩余数据的处理放入调度器就绪列表，在下一轮事件循环继续
+    void ScheduleReadContinuation();
+
     friend class TcpServer;  // 允许 TcpServer 设置断开回调
 
     bool is_closed_;                         // 是否已经关闭
@@ -68,11 +156,40 @@ protected:
 private:
     // 真正的关闭逻辑: 注销事件、调用回调、设置标志
     void Close();
+    // HandleWrite 的发送部分: 调用前须持有 mutex_，返回前释放
+    void WriteLocked();
+    // 令牌不足时关闭写事件并注册定时器，等待令牌补足后重新发送（需持有 mutex_）
+    void WaitForPacing();
+    // 读令牌不足时关闭读事件并注册定时器，等待令牌补足后恢复读取（需持有 mutex_）
+    void WaitForReadTokens();
+    // 采样 TCP_INFO 并在需要时按 BDP 调整发送缓冲区
+    void SampleTransportInfo();
+    // 就绪列表回调: 不再从 socket 读取，继续处理读缓冲区中的剩余数据
+    void HandleReadContinuation();
+    // 执行 MigrateTo 登记的迁移，在读回调返回后调用
+    void HandleMigration();
     std::mutex mutex_;                    // 保护 write_buffer_ 与状态
     std::shared_ptr<Channel> channel_;    // IO 事件分发通道
     DisConnectCallback disconnectCb_;     // 应用层断开回调
     CloseCallback closeCb_;               // 关闭回调
     ReadCallback readCb_;                 // 读取数据回调
+    WriteCallback writeCb_;               // 写队列低水位回调
+    uint32_t write_low_watermark_ = 0;    // 写队列低水位（字节）
+    TokenBucket pacer_;                   // 出口限速令牌桶
+    std::atomic_bool pacing_timer_;       // 是否已注册等待令牌的定时器
+    TokenBucket read_pacer_;              // 入口限速令牌桶
+    bool read_timer_ = false;             // 是否已注册等待读令牌的定时器，只在所属线程访问
+    bool read_pending_ = false;           // 读缓冲区中是否有等待下一轮处理的数据
+    TaskScheduler* migrate_target_ = nullptr; // 待迁移的目标调度器
+    ReadyTask migrate_callback_;          // 迁移完成后在目标调度器执行的任务
+    std::mutex info_mutex_;               // 保护 transport_info_
+    TcpTransportInfo transport_info_;     // 最近一次 TCP_INFO 采样
+    bool adaptive_sndbuf_ = false;        // 是否按 BDP 自动调整发送缓冲区
+    int send_buf_size_ = 100 * 1024;      // 当前 SO_SNDBUF 设置值
+    // 只在持有 mutex_ 时累加，读取方无需加锁
+    std::atomic<uint64_t> sent_bytes_{0};     // 累计写入内核的字节数
+    std::atomic<uint64_t> received_bytes_{0}; // 累计从内核读取的字节数
+    std::atomic<uint64_t> send_calls_{0};     // 累计调用 send 的次数
 };
 
 #endif // _TCPCONNECTION_H_
\ No newline at end of file
@@ -58,14 +58,19 @@ bool TcpServer::Start(std::string ip, uint16_t port)
 }
 
 // Stop: 停止 TCP 服务
-// 1. 对所有已连接的客户端执行断开操作
+// 1. 对所有已连接的客户端执行断开操作（断开回调会从 connects_ 中移除连接，先取出副本再逐个断开）
 // 2. 关闭 Acceptor
 // 3. 重置启动标记
 void TcpServer::Stop()
 {
     if (is_stared_)
     {
-        for (auto &iter : connects_)
+        std::unordered_map<int, TcpConnection::Ptr> connects;
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            connects = connects_;
+        }
+        for (auto &iter : connects)
         {
             iter.second->DisConnect();
         }
@@ -83,11 +88,13 @@ TcpConnection::Ptr TcpServer::OnConnect(int fd)
 // AddConnection: 将新连接加入管理 map
 void TcpServer::AddConnection(int fd, TcpConnection::Ptr conn)
 {
+    std::lock_guard<std::mutex> lock(mutex_);
     connects_.emplace(fd, conn);
 }
 
 // RemoveConnection: 从管理 map 中移除指定连接
 void TcpServer::RemoveConnection(int fd)
 {
+    std::lock_guard<std::mutex> lock(mutex_);
     connects_.erase(fd);
 }
@@ -5,6 +5,7 @@
 #define _TCPSERVER_H_
 
 #include <memory>
+#include <mutex>
 #include <string>
 #include <unordered_map>
 #include "TcpConnection.h"
@@ -51,7 +52,8 @@ private:
     std::string ip_;                          // 本地监听地址
     std::unique_ptr<Acceptor> acceptor_;      // 用于接收新连接的 Acceptor
     bool is_stared_ = false;                  // 标记服务是否已启动
-    // 存储所有活动连接: fd -> TcpConnection
+    // 存储所有活动连接: fd -> TcpConnection，连接可能在任意调度线程上断开，由 mutex_ 保护
+    std::mutex mutex_;
     std::unordered_map<int, TcpConnection::Ptr> connects_;
 };
 
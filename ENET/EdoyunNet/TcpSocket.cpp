@@ -3,6 +3,10 @@
 #include<sys/socket.h>
 #include<arpa/inet.h>
 #include<unistd.h>
+#include<stddef.h>
+#include<string.h>
+#include<errno.h>
+#include<linux/tcp.h>
 
 void SocketUtil::SetNonBlock(int sockfd)
 {
@@ -50,6 +54,75 @@ void SocketUtil::SetRecvBufSize(int sockfd, int size)
     setsockopt(sockfd, SOL_SOCKET, SO_RCVBUF, (const char*)&size, sizeof(size)); // 设置接收缓冲区大小
 }
 
+bool SocketUtil::SetMaxPacingRate(int sockfd, uint32_t rate)
+{
+#ifdef SO_MAX_PACING_RATE
+    //参数：套接字描述符，协议，最大发送速率选项，选项值，选项值长度；0xFFFFFFFF 表示不限速
+    return setsockopt(sockfd, SOL_SOCKET, SO_MAX_PACING_RATE, (const char*)&rate, sizeof(rate)) == 0;
+#else
+    return false;
+#endif
+}
+
+bool SocketUtil::SetNotSentLowat(int sockfd, uint32_t bytes)
+{
+    //参数：套接字描述符，TCP 协议，未发送低水位选项，选项值，选项值长度
+    return setsockopt(sockfd, IPPROTO_TCP, TCP_NOTSENT_LOWAT, (const char*)&bytes, sizeof(bytes)) == 0;
+}
+
+bool SocketUtil::GetTcpInfo(int sockfd, TcpTransportInfo& info)
+{
+    struct tcp_info tcpi;
+    memset(&tcpi, 0, sizeof(tcpi));
+    socklen_t len = sizeof(tcpi);
+    if (getsockopt(sockfd, IPPROTO_TCP, TCP_INFO, &tcpi, &len) != 0)
+    {
+        return false;
+    }
+    info.rtt = tcpi.tcpi_rtt;
+    info.rttvar = tcpi.tcpi_rttvar;
+    info.snd_cwnd = tcpi.tcpi_snd_cwnd;
+    info.snd_mss = tcpi.tcpi_snd_mss;
+    info.unacked = tcpi.tcpi_unacked;
+    info.retransmits = tcpi.tcpi_retransmits;
+    info.total_retrans = tcpi.tcpi_total_retrans;
+    // 以下字段由较新的内核提供，根据内核实际填充的长度判断是否有效
+    if (len >= offsetof(struct tcp_info, tcpi_notsent_bytes) + sizeof(tcpi.tcpi_notsent_bytes))
+    {
+        info.notsent_bytes = tcpi.tcpi_notsent_bytes;
+    }
+    if (len >= offsetof(struct tcp_info, tcpi_delivery_rate) + sizeof(tcpi.tcpi_delivery_rate))
+    {
+        info.delivery_rate = tcpi.tcpi_delivery_rate;
+    }
+    return true;
+}
+
+int SocketUtil::Connect(const std::string& ip, uint16_t port)
+{
+    struct sockaddr_in addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(port);
+    if (inet_pton(AF_INET, ip.c_str(), &addr.sin_addr) != 1)
+    {
+        return -1;
+    }
+
+    int sockfd = ::socket(AF_INET, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (sockfd < 0)
+    {
+        return -1;
+    }
+    SetNonBlock(sockfd);
+    if (::connect(sockfd, (struct sockaddr*)&addr, sizeof(addr)) < 0 && errno != EINPROGRESS)
+    {
+        ::close(sockfd);
+        return -1;
+    }
+    return sockfd;
+}
+
 TcpSocket::TcpSocket()
 {
 }
@@ -2,6 +2,20 @@
 #include<string>
 #include<memory>
 
+// TcpTransportInfo: 从内核 TCP_INFO 采样得到的传输层状态
+struct TcpTransportInfo
+{
+    uint32_t rtt = 0;             // 平滑往返时延（微秒）
+    uint32_t rttvar = 0;          // 往返时延抖动（微秒）
+    uint32_t snd_cwnd = 0;        // 拥塞窗口（报文段个数）
+    uint32_t snd_mss = 0;         // 发送端 MSS（字节）
+    uint32_t unacked = 0;         // 已发送未确认的报文段数
+    uint32_t retransmits = 0;     // 当前未恢复的重传次数
+    uint32_t total_retrans = 0;   // 连接累计重传报文段数
+    uint32_t notsent_bytes = 0;   // 内核发送队列中尚未发出的字节数
+    uint64_t delivery_rate = 0;   // 最近的交付速率（字节/秒）
+};
+
 // SocketUtil 类: 提供各种静态方法用于调整套接字的属性和行为
 class SocketUtil
 {
@@ -20,6 +34,16 @@ public:
     static void SetSendBufSize(int sockfd, int size);
     // 设置套接字的接收缓冲区大小，优化接收性能
     static void SetRecvBufSize(int sockfd, int size);
+    // 设置内核层的最大发送速率(SO_MAX_PACING_RATE，字节/秒)，配合 fq 队列规则实现按包平滑发送
+    // 返回 false 表示内核或平台不支持
+    static bool SetMaxPacingRate(int sockfd, uint32_t rate);
+    // 设置 TCP_NOTSENT_LOWAT，限制内核中未发送数据量，降低排队时延
+    static bool SetNotSentLowat(int sockfd, uint32_t bytes);
+    // 读取 TCP_INFO，旧内核不支持的字段保持为 0
+    static bool GetTcpInfo(int sockfd, TcpTransportInfo& info);
+    // 创建非阻塞套接字并发起连接，连接完成前写入的数据在可写后发出
+    // 返回套接字描述符，地址无效或连接立即失败时返回 -1
+    static int Connect(const std::string& ip, uint16_t port);
 };
 
 // TcpSocket 类: 封装 TCP 套接字操作，包括创建、绑定、监听、连接和关闭等
@@ -10,6 +10,7 @@
 // 返回值: 分配给该定时器的唯一 TimerId
 TimerId TimerQueue::AddTimer(const TimerEvent &event, uint32_t mesc)
 {
+    std::lock_guard<std::mutex> lock(mutex_);
     // 获取当前时间戳（毫秒）
     int64_t time_point = GetTimeNow();
     // 生成新的定时器 ID
@@ -30,6 +31,7 @@ TimerId TimerQueue::AddTimer(const TimerEvent &event, uint32_t mesc)
 // 参数: timerId - 要移除的定时器 ID
 void TimerQueue::RemoveTimer(TimerId timerId)
 {
+    std::lock_guard<std::mutex> lock(mutex_);
     // 在 timers_ 中查找该定时器
     auto iter = timers_.find(timerId);
     if (iter != timers_.end())
@@ -48,31 +50,37 @@ void TimerQueue::RemoveTimer(TimerId timerId)
 //  - 如果回调返回 false，则一次性定时器，直接移除
 void TimerQueue::HandleTimerEvent()
 {
+    std::unique_lock<std::mutex> lock(mutex_);
     // 仅当存在定时器时进行处理
     if (!timers_.empty())
     {
         // 获取当前时间戳
         int64_t timepoint = GetTimeNow();
         // 循环处理所有已到期的任务
-        while (!timers_.empty() && events_.begin()->first.first <= timepoint)
+        while (!events_.empty() && events_.begin()->first.first <= timepoint)
         {
-            // 从事件队列中取出最先到期的定时器ID
+            // 从事件队列中取出最先到期的定时器
             TimerId timerId = events_.begin()->first.second;
-            // 调用回调函数，获取返回值
-            bool repeat = events_.begin()->second->evenrt_callbak_();
+            auto timePtr = std::move(events_.begin()->second);
+            events_.erase(events_.begin());
+            // 调用回调函数时释放锁，回调中可能再次添加或移除定时器
+            lock.unlock();
+            bool repeat = timePtr->evenrt_callbak_();
+            lock.lock();
+            // 回调期间可能已被 RemoveTimer 移除
+            if (timers_.find(timerId) == timers_.end())
+            {
+                continue;
+            }
             if (repeat)
             {
-                // 如果需要重复执行，重新设置下一次超时
-                events_.begin()->second->SetNextTimeOut(timepoint);
-                auto timePtr = std::move(events_.begin()->second);
-                events_.erase(events_.begin());
-                // 重新插入以更新排序
+                // 如果需要重复执行，重新设置下一次超时并重新插入以更新排序
+                timePtr->SetNextTimeOut(timepoint);
                 events_.emplace(std::pair<int64_t, TimerId>(timePtr->getNextTimeOut(), timerId), timePtr);
             }
             else
             {
                 // 一次性定时器，执行完毕后直接移除
-                events_.erase(events_.begin());
                 timers_.erase(timerId);
             }
         }
@@ -9,6 +9,7 @@
 #include <functional>
 #include <chrono>
 #include <memory>
+#include <mutex>
 
 // TimerEvent: 定时器到期时调用的回调函数签名，返回 true 则重复执行，返回 false 则执行一次后销毁
 typedef std::function<bool(void)> TimerEvent;
@@ -86,6 +87,7 @@ protected:
     int64_t GetTimeNow();
 
 private:
+    std::mutex mutex_;            // 保护定时器表，允许其他线程添加/移除定时器（回调执行期间不持有）
     uint32_t last_timer_id_ = 0;  // 上次分配的定时器 ID，用于生成新 ID
     // 存储所有定时器: ID -> Timer 对象
     std::unordered_map<TimerId, std::shared_ptr<Timer>> timers_;
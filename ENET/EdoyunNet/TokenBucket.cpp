@@ -0,0 +1,81 @@
+// 文件: TokenBucket.cpp
+// 功能: 实现令牌桶的补充、扣除与等待时间计算
+
+#include "TokenBucket.h"
+#include <chrono>
+
+// 未指定桶容量时的最小值，保证每次至少能发送若干个 MSS
+static const uint32_t kMinBurstBytes = 4 * 1460;
+
+TokenBucket::TokenBucket(uint32_t rate, uint32_t burst)
+{
+    Reset(rate, burst);
+}
+
+// Reset: 设置速率和容量；burst 为 0 时取 50ms 的发送量
+void TokenBucket::Reset(uint32_t rate, uint32_t burst)
+{
+    rate_ = rate;
+    if (burst == 0)
+    {
+        burst = rate / 20;
+    }
+    burst_ = burst < kMinBurstBytes ? kMinBurstBytes : burst;
+    tokens_ = burst_;
+    last_time_ = GetTimeNow();
+}
+
+// Available: 根据距上次补充经过的时间增加令牌，封顶 burst_
+uint32_t TokenBucket::Available()
+{
+    if (!IsEnabled())
+    {
+        return 0xFFFFFFFF;
+    }
+    int64_t now = GetTimeNow();
+    if (now > last_time_)
+    {
+        tokens_ += (double)rate_ * (now - last_time_) / 1000000.0;
+        if (tokens_ > burst_)
+        {
+            tokens_ = burst_;
+        }
+        last_time_ = now;
+    }
+    return tokens_ > 0 ? (uint32_t)tokens_ : 0;
+}
+
+// Consume: 扣除令牌，允许短暂透支（由后续补充偿还）
+void TokenBucket::Consume(uint32_t bytes)
+{
+    if (IsEnabled())
+    {
+        tokens_ -= bytes;
+    }
+}
+
+// WaitTime: 计算积累 bytes 个令牌所需时间，向上取整到毫秒
+uint32_t TokenBucket::WaitTime(uint32_t bytes) const
+{
+    if (!IsEnabled())
+    {
+        return 0;
+    }
+    if (bytes > burst_)
+    {
+        bytes = burst_;
+    }
+    double deficit = bytes - tokens_;
+    if (deficit <= 0)
+    {
+        return 1;
+    }
+    uint32_t mesc = (uint32_t)(deficit * 1000.0 / rate_) + 1;
+    return mesc;
+}
+
+int64_t TokenBucket::GetTimeNow()
+{
+    auto time_point = std::chrono::steady_clock::now();
+    return std::chrono::duration_cast<std::chrono::microseconds>(time_point.time_since_epoch()).count();
+}
@@ -0,0 +1,49 @@
+// 文件: TokenBucket.h
+// 功能: 令牌桶限速器，按配置速率补充令牌，用于连接出口流量整形(pacing)
+
+#ifndef _TOKENBUCKET_H_
+#define _TOKENBUCKET_H_
+
+#include <cstdint>
+
+// TokenBucket: 以 rate 字节/秒 补充令牌，桶容量为 burst 字节
+//  - Available 返回当前可发送字节数
+//  - Consume 扣除实际发送的字节数
+//  - WaitTime 计算令牌补足所需等待时间，供定时器调度
+class TokenBucket
+{
+public:
+    // 构造函数: rate 为 0 表示不限速
+    // @param rate  限速速率（字节/秒）
+    // @param burst 桶容量（字节），0 表示按速率自动取值
+    TokenBucket(uint32_t rate = 0, uint32_t burst = 0);
+    ~TokenBucket() {}
+
+    // 重新设置速率与桶容量，桶被重新填满
+    void Reset(uint32_t rate, uint32_t burst = 0);
+
+    // 是否启用限速
+    inline bool IsEnabled() const { return rate_ > 0; }
+    inline uint32_t GetRate() const { return rate_; }
+    inline uint32_t GetBurst() const { return burst_; }
+
+    // 按当前时间补充令牌，返回可用令牌数（字节）
+    uint32_t Available();
+
+    // 扣除已发送的字节数
+    void Consume(uint32_t bytes);
+
+    // 距离桶内积累 bytes 个令牌还需等待的毫秒数（至少 1ms）
+    uint32_t WaitTime(uint32_t bytes) const;
+
+private:
+    // 获取稳态时钟的微秒级时间戳
+    static int64_t GetTimeNow();
+
+    uint32_t rate_ = 0;         // 补充速率（字节/秒）
+    uint32_t burst_ = 0;        // 桶容量（字节）
+    double tokens_ = 0;         // 当前令牌数
+    int64_t last_time_ = 0;     // 上次补充时间（微秒）
+};
+
+#endif // _TOKENBUCKET_H_
@@ -0,0 +1,169 @@
+// 文件: WorkerChannel.cpp
+// 功能: 实现工作进程与监控进程之间的消息收发
+
+#include "WorkerChannel.h"
+#include "EventLoop.h"
+#include <errno.h>
+#include <sstream>
+#include <sys/socket.h>
+#include <unistd.h>
+
+// 单条消息最大长度，与 WorkerSupervisor 保持一致
+static const int kMaxMessageSize = 1024;
+
+WorkerChannel::WorkerChannel(EventLoop* loop, int worker_id, int fd)
+    : loop_(loop)
+    , worker_id_(worker_id)
+    , fd_(fd)
+    , channel_(new Channel(fd))
+{
+    channel_->SetReadCallback([this]() { this->OnRead(); });
+    channel_->SetCloseCallback([this]() { this->OnClose(); });
+    channel_->EnableReading();
+    loop_->UpdateChannel(channel_);
+}
+
+WorkerChannel::~WorkerChannel()
+{
+    OnClose();
+}
+
+void WorkerChannel::SetRejectCallback(const RejectCallback& callback)
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    reject_callback_ = callback;
+}
+
+void WorkerChannel::ClaimStream(const std::string& path)
+{
+    SendMessage("own " + path);
+}
+
+void WorkerChannel::ReleaseStream(const std::string& path)
+{
+    SendMessage("release " + path);
+}
+
+void WorkerChannel::QueryOwner(const std::string& path, const OwnerCallback& callback, uint32_t timeout)
+{
+    uint32_t seq = 0;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        seq = next_seq_++;
+        pending_[seq] = callback;
+    }
+
+    if (!SendMessage("query " + std::to_string(seq) + " " + path))
+    {
+        timeout = 0;
+    }
+
+    // 超时未收到应答（或发送失败）时回调 -1；定时器只持有弱引用，通道先于定时器释放时不再回调
+    std::weak_ptr<WorkerChannel> weak_channel = shared_from_this();
+    loop_->AddTimer([weak_channel, seq]() {
+        auto channel = weak_channel.lock();
+        if (!channel)
+        {
+            return false;
+        }
+        OwnerCallback callback;
+        {
+            std::lock_guard<std::mutex> lock(channel->mutex_);
+            auto iter = channel->pending_.find(seq);
+            if (iter == channel->pending_.end())
+            {
+                return false;
+            }
+            callback = iter->second;
+            channel->pending_.erase(iter);
+        }
+        callback(-1);
+        return false;
+    }, timeout > 0 ? timeout : 1);
+}
+
+void WorkerChannel::ReportMetric(const std::string& name, int64_t value)
+{
+    SendMessage("metric " + name + " " + std::to_string(value));
+}
+
+void WorkerChannel::OnRead()
+{
+    char buf[kMaxMessageSize];
+    while (fd_ >= 0)
+    {
+        int len = (int)recv(fd_, buf, sizeof(buf), MSG_DONTWAIT);
+        if (len == 0)
+        {
+            OnClose();
+            break;
+        }
+        if (len < 0)
+        {
+            if (errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR)
+            {
+                OnClose();
+            }
+            break;
+        }
+
+        std::istringstream stream(std::string(buf, len));
+        std::string cmd;
+        stream >> cmd;
+        if (cmd == "owner")
+        {
+            uint32_t seq = 0;
+            int owner = -1;
+            stream >> seq >> owner;
+
+            OwnerCallback callback;
+            {
+                std::lock_guard<std::mutex> lock(mutex_);
+                auto iter = pending_.find(seq);
+                if (iter == pending_.end())
+                {
+                    continue;
+                }
+                callback = iter->second;
+                pending_.erase(iter);
+            }
+            callback(owner);
+        }
+        else if (cmd == "reject")
+        {
+            std::string path;
+            stream >> path;
+
+            RejectCallback callback;
+            {
+                std::lock_guard<std::mutex> lock(mutex_);
+                callback = reject_callback_;
+            }
+            if (callback && !path.empty())
+            {
+                callback(path);
+            }
+        }
+    }
+}
+
+void WorkerChannel::OnClose()
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (fd_ >= 0)
+    {
+        loop_->RmoveChannel(channel_);
+        close(fd_);
+        fd_ = -1;
+    }
+}
+
+bool WorkerChannel::SendMessage(const std::string& msg)
+{
+    int fd = fd_;
+    if (fd < 0 || (int)msg.size() > kMaxMessageSize)
+    {
+        return false;
+    }
+    return send(fd, msg.c_str(), msg.size(), MSG_DONTWAIT | MSG_NOSIGNAL) == (ssize_t)msg.size();
+}
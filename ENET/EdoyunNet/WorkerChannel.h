@@ -0,0 +1,66 @@
+// 文件: WorkerChannel.h
+// 功能: 工作进程一侧的进程间通道，向监控进程声明/释放流归属、查询流所在进程并上报指标
+//       协议说明见 WorkerSupervisor.h
+
+#ifndef _WORKERCHANNEL_H_
+#define _WORKERCHANNEL_H_
+
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+
+class EventLoop;
+class Channel;
+
+class WorkerChannel : public std::enable_shared_from_this<WorkerChannel>
+{
+public:
+    // OwnerCallback: 查询结果回调，owner 为拥有该流的工作进程编号，-1 表示不存在或查询超时
+    using OwnerCallback = std::function<void(int owner)>;
+    // RejectCallback: 监控进程拒绝本进程声明的流（该流已由其他工作进程推送）
+    using RejectCallback = std::function<void(const std::string& path)>;
+
+    // 构造函数: 将通道 fd 注册到 loop 的首个 TaskScheduler，须由 std::shared_ptr 持有
+    // @param loop      工作进程的事件循环
+    // @param worker_id 本进程编号
+    // @param fd        WorkerSupervisor 传入的通道 fd，所有权转移给本对象
+    WorkerChannel(EventLoop* loop, int worker_id, int fd);
+    ~WorkerChannel();
+
+    WorkerChannel(const WorkerChannel&) = delete;
+    WorkerChannel& operator = (const WorkerChannel&) = delete;
+
+    inline int GetWorkerId() const { return worker_id_; }
+
+    // 设置流归属被拒绝时的回调，回调在事件循环线程中执行
+    void SetRejectCallback(const RejectCallback& callback);
+    // 声明本进程拥有该流（开始推流时调用），已由其他进程拥有时监控进程回复拒绝
+    void ClaimStream(const std::string& path);
+    // 释放流归属（推流结束时调用）
+    void ReleaseStream(const std::string& path);
+    // 异步查询流所在的工作进程，回调在事件循环线程中执行
+    // @param timeout 超时时间（毫秒），超时回调 -1
+    void QueryOwner(const std::string& path, const OwnerCallback& callback, uint32_t timeout = 1000);
+    // 上报指标，监控进程按名称在所有工作进程间求和
+    void ReportMetric(const std::string& name, int64_t value);
+
+private:
+    void OnRead();
+    void OnClose();
+    bool SendMessage(const std::string& msg);
+
+    EventLoop* loop_ = nullptr;
+    int worker_id_ = -1;
+    int fd_ = -1;
+    std::shared_ptr<Channel> channel_;
+
+    std::mutex mutex_;
+    uint32_t next_seq_ = 1;                                     // 查询序号
+    std::unordered_map<uint32_t, OwnerCallback> pending_;       // 未完成的查询
+    RejectCallback reject_callback_;                            // 流归属被拒绝时的回调
+};
+
+#endif // _WORKERCHANNEL_H_
@@ -0,0 +1,381 @@
+// 文件: WorkerSupervisor.cpp
+// 功能: 实现工作进程的创建、崩溃重启、消息路由与指标汇总
+
+#include "WorkerSupervisor.h"
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <errno.h>
+#include <poll.h>
+#include <signal.h>
+#include <sstream>
+#include <sys/prctl.h>
+#include <sys/socket.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+// 单条消息最大长度
+static const int kMaxMessageSize = 1024;
+// 工作进程启动后存活不足该时长即退出，视为启动失败，按退避策略延迟重启（毫秒）
+static const int64_t kMinUptime = 1000;
+// 重启退避上限（毫秒）
+static const int64_t kMaxBackoff = 30000;
+
+static volatile sig_atomic_t g_supervisor_stop = 0;
+
+static void OnStopSignal(int)
+{
+    g_supervisor_stop = 1;
+}
+
+WorkerSupervisor::WorkerSupervisor(uint32_t num_workers)
+    : num_workers_(num_workers > 0 ? num_workers : 1)
+    , workers_(num_workers_)
+{
+
+}
+
+WorkerSupervisor::~WorkerSupervisor()
+{
+    StopWorkers();
+}
+
+int WorkerSupervisor::Run(const WorkerMain& worker_main)
+{
+    worker_main_ = worker_main;
+    g_supervisor_stop = 0;
+    signal(SIGPIPE, SIG_IGN);
+    signal(SIGINT, OnStopSignal);
+    signal(SIGTERM, OnStopSignal);
+
+    for (uint32_t id = 0; id < num_workers_; id++)
+    {
+        if (!SpawnWorker(id))
+        {
+            StopWorkers();
+            return -1;
+        }
+    }
+
+    int64_t last_print = GetTimeNow();
+    std::vector<pollfd> fds;
+    std::vector<uint32_t> ids;
+    while (!g_supervisor_stop)
+    {
+        fds.clear();
+        ids.clear();
+        for (uint32_t id = 0; id < num_workers_; id++)
+        {
+            if (workers_[id].fd >= 0)
+            {
+                pollfd pfd;
+                pfd.fd = workers_[id].fd;
+                pfd.events = POLLIN;
+                pfd.revents = 0;
+                fds.push_back(pfd);
+                ids.push_back(id);
+            }
+        }
+
+        int ret = poll(fds.data(), fds.size(), 100);
+        if (ret > 0)
+        {
+            for (size_t i = 0; i < fds.size(); i++)
+            {
+                if (fds[i].revents & POLLIN)
+                {
+                    HandleMessages(ids[i]);
+                }
+            }
+        }
+
+        ReapWorkers();
+
+        // 按退避时间重启已退出的工作进程
+        int64_t now = GetTimeNow();
+        for (uint32_t id = 0; id < num_workers_; id++)
+        {
+            if (workers_[id].pid < 0 && now >= workers_[id].next_spawn)
+            {
+                SpawnWorker(id);
+            }
+        }
+
+        if (metrics_interval_ > 0 && now - last_print >= (int64_t)metrics_interval_ * 1000)
+        {
+            last_print = now;
+            PrintMetrics();
+        }
+    }
+
+    StopWorkers();
+    return 0;
+}
+
+std::map<std::string, int64_t> WorkerSupervisor::GetMetrics() const
+{
+    std::map<std::string, int64_t> total;
+    for (const Worker& worker : workers_)
+    {
+        for (auto iter : worker.metrics)
+        {
+            total[iter.first] += iter.second;
+        }
+    }
+    return total;
+}
+
+bool WorkerSupervisor::SpawnWorker(uint32_t id)
+{
+    int fds[2];
+    if (socketpair(AF_UNIX, SOCK_SEQPACKET, 0, fds) < 0)
+    {
+        printf("[WorkerSupervisor] socketpair failed: %s\n", strerror(errno));
+        return false;
+    }
+
+    pid_t pid = fork();
+    if (pid < 0)
+    {
+        printf("[WorkerSupervisor] fork failed: %s\n", strerror(errno));
+        close(fds[0]);
+        close(fds[1]);
+        workers_[id].next_spawn = GetTimeNow() + kMinUptime;
+        return false;
+    }
+
+    if (pid == 0)
+    {
+        // 工作进程: 关闭监控进程持有的其他通道，监控进程退出时随之退出
+        prctl(PR_SET_PDEATHSIG, SIGTERM);
+        signal(SIGINT, SIG_DFL);
+        signal(SIGTERM, SIG_DFL);
+        for (const Worker& worker : workers_)
+        {
+            if (worker.fd >= 0)
+            {
+                close(worker.fd);
+            }
+        }
+        close(fds[0]);
+        int code = worker_main_((int)id, fds[1]);
+        _exit(code);
+    }
+
+    close(fds[1]);
+    Worker& worker = workers_[id];
+    worker.pid = pid;
+    worker.fd = fds[0];
+    worker.start_time = GetTimeNow();
+    worker.metrics.clear();
+    printf("[WorkerSupervisor] worker %u started, pid=%d\n", id, (int)pid);
+    return true;
+}
+
+void WorkerSupervisor::ReapWorkers()
+{
+    int status = 0;
+    pid_t pid = 0;
+    while ((pid = waitpid(-1, &status, WNOHANG)) > 0)
+    {
+        for (uint32_t id = 0; id < num_workers_; id++)
+        {
+            Worker& worker = workers_[id];
+            if (worker.pid != pid)
+            {
+                continue;
+            }
+
+            if (WIFSIGNALED(status))
+            {
+                printf("[WorkerSupervisor] worker %u (pid=%d) killed by signal %d\n", id, (int)pid, WTERMSIG(status));
+            }
+            else
+            {
+                printf("[WorkerSupervisor] worker %u (pid=%d) exited with code %d\n", id, (int)pid, WEXITSTATUS(status));
+            }
+
+            // 进程退出后其拥有的流全部失效
+            for (auto iter = stream_owners_.begin(); iter != stream_owners_.end(); )
+            {
+                if (iter->second == (int)id)
+                {
+                    iter = stream_owners_.erase(iter);
+                }
+                else
+                {
+                    iter++;
+                }
+            }
+
+            if (worker.fd >= 0)
+            {
+                close(worker.fd);
+                worker.fd = -1;
+            }
+            worker.pid = -1;
+            worker.metrics.clear();
+            worker.restarts++;
+
+            // 启动后很快退出说明存在持续性错误，按指数退避避免频繁 fork
+            int64_t now = GetTimeNow();
+            int64_t backoff = 0;
+            if (now - worker.start_time < kMinUptime)
+            {
+                uint32_t shift = worker.restarts < 15 ? worker.restarts : 15;
+                backoff = kMinUptime << shift;
+                if (backoff > kMaxBackoff)
+                {
+                    backoff = kMaxBackoff;
+                }
+            }
+            else
+            {
+                worker.restarts = 0;
+            }
+            worker.next_spawn = now + backoff;
+            break;
+        }
+    }
+}
+
+void WorkerSupervisor::HandleMessages(uint32_t id)
+{
+    char buf[kMaxMessageSize];
+    while (workers_[id].fd >= 0)
+    {
+        int len = (int)recv(workers_[id].fd, buf, sizeof(buf), MSG_DONTWAIT);
+        if (len > 0)
+        {
+            HandleMessage(id, std::string(buf, len));
+            continue;
+        }
+        if (len == 0 || (errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR))
+        {
+            // 对端关闭，等待 waitpid 回收进程后再清理
+            close(workers_[id].fd);
+            workers_[id].fd = -1;
+        }
+        break;
+    }
+}
+
+void WorkerSupervisor::HandleMessage(uint32_t id, const std::string& msg)
+{
+    std::istringstream stream(msg);
+    std::string cmd;
+    stream >> cmd;
+
+    if (cmd == "own")
+    {
+        std::string path;
+        stream >> path;
+        if (path.empty())
+        {
+            return;
+        }
+        // 同一条流只允许一个进程推送，后到者不覆盖已有归属，并通知其拒绝推流
+        auto iter = stream_owners_.find(path);
+        if (iter != stream_owners_.end() && iter->second != (int)id)
+        {
+            printf("[WorkerSupervisor] stream %s already owned by worker %d, reject worker %u\n",
+                path.c_str(), iter->second, id);
+            SendTo(id, "reject " + path);
+            return;
+        }
+        stream_owners_[path] = (int)id;
+    }
+    else if (cmd == "release")
+    {
+        std::string path;
+        stream >> path;
+        auto iter = stream_owners_.find(path);
+        if (iter != stream_owners_.end() && iter->second == (int)id)
+        {
+            stream_owners_.erase(iter);
+        }
+    }
+    else if (cmd == "query")
+    {
+        std::string seq, path;
+        stream >> seq >> path;
+        int owner = -1;
+        auto iter = stream_owners_.find(path);
+        if (iter != stream_owners_.end())
+        {
+            owner = iter->second;
+        }
+        SendTo(id, "owner " + seq + " " + std::to_string(owner));
+    }
+    else if (cmd == "metric")
+    {
+        std::string name;
+        long long value = 0;
+        stream >> name >> value;
+        if (!name.empty())
+        {
+            workers_[id].metrics[name] = value;
+        }
+    }
+}
+
+void WorkerSupervisor::SendTo(uint32_t id, const std::string& msg)
+{
+    if (workers_[id].fd >= 0)
+    {
+        // 通道满时直接丢弃，工作进程一侧的查询会超时回调 -1
+        send(workers_[id].fd, msg.c_str(), msg.size(), MSG_DONTWAIT | MSG_NOSIGNAL);
+    }
+}
+
+void WorkerSupervisor::StopWorkers()
+{
+    for (Worker& worker : workers_)
+    {
+        if (worker.pid > 0)
+        {
+            kill(worker.pid, SIGTERM);
+        }
+    }
+    for (Worker& worker : workers_)
+    {
+        if (worker.pid > 0)
+        {
+            waitpid(worker.pid, nullptr, 0);
+            worker.pid = -1;
+        }
+        if (worker.fd >= 0)
+        {
+            close(worker.fd);
+            worker.fd = -1;
+        }
+    }
+    stream_owners_.clear();
+}
+
+void WorkerSupervisor::PrintMetrics()
+{
+    uint32_t alive = 0;
+    for (const Worker& worker : workers_)
+    {
+        if (worker.pid > 0)
+        {
+            alive++;
+        }
+    }
+
+    std::string line = "[WorkerSupervisor] workers=" + std::to_string(alive) + "/" + std::to_string(num_workers_)
+        + " streams=" + std::to_string(stream_owners_.size());
+    for (auto iter : GetMetrics())
+    {
+        line += " " + iter.first + "=" + std::to_string(iter.second);
+    }
+    printf("%s\n", line.c_str());
+}
+
+int64_t WorkerSupervisor::GetTimeNow()
+{
+    auto time_point = std::chrono::steady_clock::now();
+    return std::chrono::duration_cast<std::chrono::milliseconds>(time_point.time_since_epoch()).count();
+}
@@ -0,0 +1,81 @@
+// 文件: WorkerSupervisor.h
+// 功能: 多进程(prefork)工作模式的监控进程，负责创建/重启工作进程、转发进程间消息并汇总指标
+//
+// 每个工作进程各自运行独立的 EventLoop，并在同一端口上以 SO_REUSEPORT 监听，由内核分发新连接；
+// 进程间不共享内存，只通过 socketpair(SOCK_SEQPACKET) 与监控进程交换少量状态：
+//   工作进程 -> 监控进程: "own <path>" / "release <path>" / "query <seq> <path>" / "metric <name> <value>"
+//   监控进程 -> 工作进程: "owner <seq> <worker_id>"（无归属时 worker_id 为 -1）
+//                         "reject <path>"（该流已由其他工作进程拥有，声明方须停止推流）
+
+#ifndef _WORKERSUPERVISOR_H_
+#define _WORKERSUPERVISOR_H_
+
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include <sys/types.h>
+
+class WorkerSupervisor
+{
+public:
+    // WorkerMain: 工作进程入口，参数为工作进程编号和与监控进程通信的 fd，返回值作为进程退出码
+    using WorkerMain = std::function<int(int worker_id, int channel_fd)>;
+
+    // 构造函数
+    // @param num_workers 工作进程数量
+    WorkerSupervisor(uint32_t num_workers);
+    ~WorkerSupervisor();
+
+    WorkerSupervisor(const WorkerSupervisor&) = delete;
+    WorkerSupervisor& operator = (const WorkerSupervisor&) = delete;
+
+    // 设置指标汇总打印周期（秒），0 表示不打印
+    inline void SetMetricsInterval(uint32_t seconds) { metrics_interval_ = seconds; }
+
+    // Run: 创建全部工作进程并进入监控循环，直到收到 SIGINT/SIGTERM
+    // 必须在创建任何线程（如 EventLoop）之前调用
+    // @return 0 正常退出；<0 表示创建通信通道失败
+    int Run(const WorkerMain& worker_main);
+
+    // 汇总所有工作进程上报的指标（同名指标求和）
+    std::map<std::string, int64_t> GetMetrics() const;
+
+private:
+    // Worker: 单个工作进程的运行状态
+    struct Worker
+    {
+        pid_t pid = -1;                         // 进程 ID，-1 表示未运行
+        int fd = -1;                            // 监控进程一端的通信 fd
+        int64_t start_time = 0;                 // 最近一次启动时间（毫秒）
+        int64_t next_spawn = 0;                 // 允许重新启动的时间（毫秒），用于崩溃退避
+        uint32_t restarts = 0;                  // 连续快速退出的次数
+        std::map<std::string, int64_t> metrics; // 最近上报的指标
+    };
+
+    // 创建（或重启）指定编号的工作进程
+    bool SpawnWorker(uint32_t id);
+    // 回收已退出的工作进程，清理其拥有的流并安排重启
+    void ReapWorkers();
+    // 读取并处理工作进程发来的消息
+    void HandleMessages(uint32_t id);
+    void HandleMessage(uint32_t id, const std::string& msg);
+    // 向工作进程发送一条消息
+    void SendTo(uint32_t id, const std::string& msg);
+    // 停止所有工作进程
+    void StopWorkers();
+    // 打印汇总指标
+    void PrintMetrics();
+
+    static int64_t GetTimeNow();
+
+    uint32_t num_workers_ = 1;                          // 工作进程数量
+    uint32_t metrics_interval_ = 10;                    // 指标打印周期（秒）
+    WorkerMain worker_main_;                            // 工作进程入口
+    std::vector<Worker> workers_;                       // 工作进程表
+    std::unordered_map<std::string, int> stream_owners_; // 流路径 -> 拥有该流的工作进程编号
+};
+
+#endif // _WORKERSUPERVISOR_H_
@@ -0,0 +1,247 @@
+/**
+ * @file AmfBench.cpp
+ * @brief 实现 AMF0 微基准。
+ *
+ * 待解析的消息用 AmfEncoder 按 OBS/FFmpeg 推流时的常见内容构造；
+ * 两种解析方式读取相同的字段，结果累加到一个全局变量，避免被编译器优化掉。
+ */
+#include "AmfBench.h"
+#include "amf.h"
+#include "rtmp.h"
+#include "RtmpChunk.h"
+#include "RtmpMediaPacket.h"
+#include <chrono>
+#include <cstring>
+#include <string>
+
+/** 元数据分发测试中每条流的观看者数 */
+static const unsigned kMetaDataPlayers = 100;
+/** 观看者的 out chunk size */
+static const uint32_t kChunkSize = 4096;
+
+static volatile uint64_t g_sink = 0;
+
+/** 一条待解析的 AMF0 消息 */
+struct AmfMessage
+{
+    std::shared_ptr<char> data;
+    uint32_t size = 0;
+};
+
+static AmfMessage TakeMessage(AmfEncoder& encoder)
+{
+    AmfMessage msg;
+    msg.size = encoder.size();
+    msg.data.reset(new char[msg.size], std::default_delete<char[]>());
+    memcpy(msg.data.get(), encoder.data().get(), msg.size);
+    return msg;
+}
+
+static AmfMessage CreateConnect()
+{
+    AmfObjects objects;
+    objects["app"] = AmfObject(std::string("live"));
+    objects["type"] = AmfObject(std::string("nonprivate"));
+    objects["flashVer"] = AmfObject(std::string("FMLE/3.0 (compatible; FMSc/1.0)"));
+    objects["swfUrl"] = AmfObject(std::string("rtmp://127.0.0.1:1935/live"));
+    objects["tcUrl"] = AmfObject(std::string("rtmp://127.0.0.1:1935/live"));
+    objects["capabilities"] = AmfObject(239.0);
+    objects["audioCodecs"] = AmfObject(3575.0);
+    objects["videoCodecs"] = AmfObject(252.0);
+    objects["videoFunction"] = AmfObject(1.0);
+    objects["objectEncoding"] = AmfObject(0.0);
+
+    AmfEncoder encoder;
+    encoder.encodeString("connect", 7);
+    encoder.encodeNumber(1);
+    encoder.encodeObjects(objects);
+    return TakeMessage(encoder);
+}
+
+static AmfMessage CreateStreamCommand(const char* method, bool publish)
+{
+    AmfObjects objects;
+    AmfEncoder encoder;
+    encoder.encodeString(method, (int)strlen(method));
+    encoder.encodeNumber(publish ? 5 : 4);
+    encoder.encodeObjects(objects);
+    encoder.encodeString("bench-stream-0", 14);
+    if(publish)
+    {
+        encoder.encodeString("live", 4);
+    }
+    else
+    {
+        encoder.encodeNumber(-1);
+    }
+    return TakeMessage(encoder);
+}
+
+static AmfMessage CreateMetaData()
+{
+    AmfObjects objects;
+    objects["duration"] = AmfObject(0.0);
+    objects["fileSize"] = AmfObject(0.0);
+    objects["width"] = AmfObject(1920.0);
+    objects["height"] = AmfObject(1080.0);
+    objects["videocodecid"] = AmfObject(7.0);
+    objects["videodatarate"] = AmfObject(4500.0);
+    objects["framerate"] = AmfObject(30.0);
+    objects["audiocodecid"] = AmfObject(10.0);
+    objects["audiodatarate"] = AmfObject(160.0);
+    objects["audiosamplerate"] = AmfObject(48000.0);
+    objects["audiosamplesize"] = AmfObject(16.0);
+    objects["audiochannels"] = AmfObject(2.0);
+    objects["encoder"] = AmfObject(std::string("obs-output module (libobs version 30.0.2)"));
+    objects["stereo"].type = AMF_BOOLEAN;
+    objects["stereo"].amf_boolean = true;
+
+    AmfEncoder encoder;
+    encoder.encodeString("@setDataFrame", 13);
+    encoder.encodeString("onMetaData", 10);
+    encoder.encodeECMA(objects);
+    return TakeMessage(encoder);
+}
+
+/**
+ * @brief 执行 iterations 次 fn，返回每次的平均耗时（纳秒）
+ */
+template<typename F>
+static double MeasureNs(unsigned iterations, F fn)
+{
+    auto start = std::chrono::steady_clock::now();
+    for(unsigned i = 0; i < iterations; i++)
+    {
+        fn();
+    }
+    auto elapsed = std::chrono::steady_clock::now() - start;
+    return std::chrono::duration<double, std::nano>(elapsed).count() / iterations;
+}
+
+/**
+ * @brief 按修改前 RtmpConnection::HandleInvoke 的方式解析命令
+ */
+static void DecodeCommand(AmfDecoder& decoder, const AmfMessage& msg, bool is_connect)
+{
+    decoder.reset();
+    int bytes_used = decoder.decode(msg.data.get(), msg.size, 1);
+    std::string method = decoder.getString();
+    if(is_connect)
+    {
+        decoder.decode(msg.data.get() + bytes_used, msg.size - bytes_used);
+        std::string app = decoder.hasObject("app") ? decoder.getObject("app").amf_string : "";
+        g_sink += method.size() + app.size() + (uint64_t)decoder.getNumber();
+    }
+    else
+    {
+        decoder.decode(msg.data.get() + bytes_used, msg.size - bytes_used, 3);
+        std::string stream_name = decoder.getString();
+        g_sink += method.size() + stream_name.size();
+    }
+}
+
+/**
+ * @brief 按 AmfReader 的方式解析命令，读取相同的字段
+ */
+static void ReadCommand(const AmfMessage& msg, bool is_connect)
+{
+    AmfReader reader(msg.data.get(), msg.size);
+    AmfStringView method;
+    double transaction_id = 0;
+    reader.readString(method);
+    reader.readNumber(transaction_id);
+    if(is_connect)
+    {
+        AmfReader command;
+        AmfStringView app;
+        if(reader.readObject(command))
+        {
+            command.findString("app", app);
+        }
+        g_sink += method.size + app.size + (uint64_t)transaction_id;
+    }
+    else
+    {
+        AmfStringView stream_name;
+        reader.skip();
+        reader.readString(stream_name);
+        g_sink += method.size + stream_name.size;
+    }
+}
+
+static void PrintCommand(FILE* out, const char* name, const AmfMessage& msg, bool is_connect, unsigned iterations, bool last)
+{
+    AmfDecoder decoder;
+    double decoder_ns = MeasureNs(iterations, [&](){ DecodeCommand(decoder, msg, is_connect); });
+    double reader_ns = MeasureNs(iterations, [&](){ ReadCommand(msg, is_connect); });
+    fprintf(out, "    \"%s\": {\"bytes\": %u, \"decoder_ns\": %.1f, \"reader_ns\": %.1f, \"speedup\": %.2f}%s\n",
+            name, msg.size, decoder_ns, reader_ns, reader_ns > 0 ? decoder_ns / reader_ns : 0, last ? "" : ",");
+}
+
+/**
+ * @brief 修改前的元数据分发：解码为 AmfObjects，每个观看者重新编码为 onMetaData 并分片
+ */
+static void EncodePerPlayer(AmfDecoder& decoder, AmfEncoder& encoder, const AmfMessage& msg)
+{
+    decoder.reset();
+    int bytes_used = decoder.decode(msg.data.get(), msg.size, 1);
+    bytes_used += decoder.decode(msg.data.get() + bytes_used, msg.size - bytes_used, 1);
+    decoder.decode(msg.data.get() + bytes_used, msg.size - bytes_used);
+    AmfObjects meta_data = decoder.getObjects();
+
+    for(unsigned i = 0; i < kMetaDataPlayers; i++)
+    {
+        encoder.reset();
+        encoder.encodeString("onMetaData", 10);
+        encoder.encodeECMA(meta_data);
+
+        RtmpMessage rtmp_msg;
+        rtmp_msg.type_id = RTMP_NOTIFY;
+        rtmp_msg.stream_id = 1;
+        rtmp_msg.playload = encoder.data();
+        rtmp_msg.lenght = encoder.size();
+        uint32_t capacity = RtmpChunk::GetChunkCapacity(rtmp_msg.lenght, kChunkSize);
+        std::shared_ptr<char> buffer(new char[capacity], std::default_delete<char[]>());
+        g_sink += RtmpChunk::CreateChunk(RTMP_CHUNK_DATA_ID, rtmp_msg, kChunkSize, buffer.get(), capacity);
+    }
+}
+
+/**
+ * @brief 会话内只封装一次：取出元数据消息，观看者共享同一份分片结果
+ */
+static void ShareMetaData(const AmfMessage& msg)
+{
+    RtmpMediaPacket::Ptr meta_data = RtmpMediaPacket::CreateMetaData(msg.data, msg.size);
+    for(unsigned i = 0; i < kMetaDataPlayers; i++)
+    {
+        uint32_t chunks_size = 0;
+        std::shared_ptr<char> chunks = meta_data->GetChunks(kChunkSize, 1, chunks_size);
+        g_sink += chunks_size;
+    }
+}
+
+void RunAmfBench(FILE* out, unsigned iterations)
+{
+    AmfMessage connect = CreateConnect();
+    AmfMessage play = CreateStreamCommand("play", false);
+    AmfMessage publish = CreateStreamCommand("publish", true);
+    AmfMessage meta_data = CreateMetaData();
+
+    fprintf(out, "{\n");
+    fprintf(out, "  \"iterations\": %u,\n", iterations);
+    fprintf(out, "  \"commands\": {\n");
+    PrintCommand(out, "connect", connect, true, iterations, false);
+    PrintCommand(out, "play", play, false, iterations, false);
+    PrintCommand(out, "publish", publish, false, iterations, true);
+    fprintf(out, "  },\n");
+
+    unsigned meta_iterations = iterations / kMetaDataPlayers > 0 ? iterations / kMetaDataPlayers : 1;
+    AmfDecoder decoder;
+    AmfEncoder encoder;
+    double encode_ns = MeasureNs(meta_iterations, [&](){ EncodePerPlayer(decoder, encoder, meta_data); });
+    double shared_ns = MeasureNs(meta_iterations, [&](){ ShareMetaData(meta_data); });
+    fprintf(out, "  \"metadata\": {\"bytes\": %u, \"players\": %u, \"per_player_encode_ns\": %.1f, \"shared_ns\": %.1f, "
+                 "\"speedup\": %.2f}\n",
+            meta_data.size, kMetaDataPlayers, encode_ns, shared_ns, shared_ns > 0 ? encode_ns / shared_ns : 0);
+    fprintf(out, "}\n");
+}
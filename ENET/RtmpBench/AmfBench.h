@@ -0,0 +1,21 @@
+/**
+ * @file AmfBench.h
+ * @brief AMF0 编解码微基准：命令解析与元数据分发。
+ *
+ * 对比 AmfDecoder（构造 AmfObject/AmfObjects）与 AmfReader（在原始字节上读取）解析
+ * connect、play、publish 命令的耗时，以及元数据按观看者逐个编码与会话内只封装一次的耗时。
+ */
+
+#ifndef _AMFBENCH_H_
+#define _AMFBENCH_H_
+
+#include <cstdio>
+
+/**
+ * @brief 运行 AMF 微基准并以 JSON 输出结果
+ * @param out 输出文件
+ * @param iterations 每项的循环次数
+ */
+void RunAmfBench(FILE* out, unsigned iterations);
+
+#endif // _AMFBENCH_H_
@@ -0,0 +1,244 @@
+/**
+ * @file BenchPlayer.cpp
+ * @brief 实现 BenchPlayer：play 命令与收到媒体的统计。
+ */
+#include "BenchPlayer.h"
+#include "BenchSource.h"
+#include "rtmp.h"
+#include <algorithm>
+#include <cstdint>
+#include <sys/socket.h>
+
+/** 音频时间戳跳变超过该值（毫秒）计为缺口 */
+static const int64_t kAudioGapMs = 100;
+/** 限速读取时的接收缓冲区大小 */
+static const int kThrottleRecvBuf = 64 * 1024;
+
+/**
+ * @brief 创建 socket 并发起非阻塞连接后发送 C0C1
+ */
+BenchPlayer::Ptr BenchPlayer::Create(TaskScheduler* scheduler, const std::string& ip, uint16_t port, const std::string& stream_path,
+                                     uint32_t pacing_bin_ms)
+{
+    if(!IsValidStreamPath(stream_path))
+    {
+        return nullptr;
+    }
+    int sockfd = Connect(ip, port);
+    if(sockfd < 0)
+    {
+        return nullptr;
+    }
+    Ptr player(new BenchPlayer(scheduler, sockfd, ip, port, stream_path, pacing_bin_ms));
+    player->Start();
+    return player;
+}
+
+/**
+ * @brief 私有构造，观看端不发送媒体，chunk 大小保持默认
+ */
+BenchPlayer::BenchPlayer(TaskScheduler* scheduler, int socket, const std::string& ip, uint16_t port, const std::string& stream_path,
+                         uint32_t pacing_bin_ms)
+    :RtmpClient(scheduler, socket, ip, port, stream_path, 128)
+    ,pacing_bin_ms_(pacing_bin_ms)
+{
+}
+
+/**
+ * @brief 析构函数
+ */
+BenchPlayer::~BenchPlayer()
+{
+}
+
+/**
+ * @brief 读取统计
+ */
+BenchPlayer::Stats BenchPlayer::GetStats() const
+{
+    Stats stats;
+    stats.started = HasStarted();
+    stats.closed = IsClosed();
+    stats.ttff_ms = ttff_ms_.load(std::memory_order_relaxed);
+    stats.video_frames = video_frames_.load(std::memory_order_relaxed);
+    stats.audio_frames = audio_frames_.load(std::memory_order_relaxed);
+    stats.bytes = bytes_.load(std::memory_order_relaxed);
+    stats.wire_bytes = GetReceivedBytes();
+    stats.media_timestamp = media_timestamp_.load(std::memory_order_relaxed);
+    stats.video_gaps = video_gaps_.load(std::memory_order_relaxed);
+    stats.broken_gaps = broken_gaps_.load(std::memory_order_relaxed);
+    stats.audio_gaps = audio_gaps_.load(std::memory_order_relaxed);
+    int64_t first_frame_time = first_frame_time_.load(std::memory_order_relaxed);
+    if(first_frame_time != 0)
+    {
+        stats.elapsed_ms = (uint64_t)(GetNowMs() - first_frame_time);
+    }
+    return stats;
+}
+
+/**
+ * @brief 取出时延样本
+ */
+std::vector<uint32_t> BenchPlayer::TakeLatencySamples()
+{
+    std::vector<uint32_t> samples;
+    std::lock_guard<std::mutex> lock(mutex_);
+    samples.swap(latency_samples_);
+    return samples;
+}
+
+/**
+ * @brief 截取时间段内的时间桶，时间段早于首次读取的部分补 0
+ */
+std::vector<uint32_t> BenchPlayer::GetPacingBins(int64_t start_ms, int64_t end_ms)
+{
+    std::vector<uint32_t> bins;
+    if(pacing_bin_ms_ == 0 || end_ms <= start_ms)
+    {
+        return bins;
+    }
+    int64_t first = start_ms / pacing_bin_ms_;
+    int64_t last = end_ms / pacing_bin_ms_;
+    bins.resize((size_t)(last - first), 0);
+    std::lock_guard<std::mutex> lock(mutex_);
+    for(int64_t index = first; index < last && pacing_base_ >= 0; index++)
+    {
+        if(index >= pacing_base_ && index - pacing_base_ < (int64_t)pacing_bins_.size())
+        {
+            bins[index - first] = pacing_bins_[index - pacing_base_];
+        }
+    }
+    return bins;
+}
+
+/**
+ * @brief 设置视频帧间隔
+ */
+void BenchPlayer::SetVideoInterval(uint32_t interval_ms)
+{
+    video_interval_ms_.store(interval_ms, std::memory_order_relaxed);
+}
+
+/**
+ * @brief 入口限速由 TcpConnection 暂停读事件实现，缩小接收缓冲区后内核很快通告零窗口
+ */
+void BenchPlayer::SetThrottle(uint32_t rate)
+{
+    int size = kThrottleRecvBuf;
+    setsockopt(GetSocket(), SOL_SOCKET, SO_RCVBUF, &size, sizeof(size));
+    SetReadRate(rate);
+}
+
+/**
+ * @brief TcpConnection 在调用读回调前已累加接收字节数，两次回调之差即本次读到的字节
+ */
+bool BenchPlayer::OnRead(BufferReader& buffer)
+{
+    if(pacing_bin_ms_ > 0)
+    {
+        uint64_t read_bytes = GetReceivedBytes();
+        int64_t index = GetNowMs() / pacing_bin_ms_;
+        std::lock_guard<std::mutex> lock(mutex_);
+        if(pacing_base_ < 0)
+        {
+            pacing_base_ = index;
+        }
+        size_t offset = (size_t)(index - pacing_base_);
+        if(offset >= pacing_bins_.size())
+        {
+            pacing_bins_.resize(offset + 1, 0);
+        }
+        pacing_bins_[offset] += (uint32_t)(read_bytes - pacing_read_bytes_);
+        pacing_read_bytes_ = read_bytes;
+    }
+    return RtmpClient::OnRead(buffer);
+}
+
+/**
+ * @brief 在 createStream 返回的消息流上发送 play
+ */
+void BenchPlayer::SendStreamCommand()
+{
+    AmfObjects objects;
+    amf_encoder_.reset();
+    amf_encoder_.encodeString("play", 4);
+    amf_encoder_.encodeNumber(0);
+    amf_encoder_.encodeObjects(objects);
+    amf_encoder_.encodeString(stream_name_.c_str(), (int)stream_name_.size());
+    SendInvokeMessage(stream_id_, amf_encoder_.data(), amf_encoder_.size());
+    play_start_us_ = BenchSource::GetWallClockUs();
+}
+
+/**
+ * @brief NetStream.Play.Start 后开始统计，错误时断开
+ */
+bool BenchPlayer::OnStatus(const std::string& level, const std::string& code)
+{
+    if(level == "error" || code == "NetStream.Play.StreamNotFound")
+    {
+        printf("[BenchPlayer] %s%s %s\n", GetRemote().c_str(), stream_path_.c_str(), code.c_str());
+        return false;
+    }
+    if(code == "NetStream.Play.Start" && state_ != STARTED)
+    {
+        SetStarted();
+    }
+    return true;
+}
+
+/**
+ * @brief 统计音视频帧；序列头只用于确认流可解码，不计入帧数
+ */
+bool BenchPlayer::HandleMedia(RtmpMessage& rtmp_msg)
+{
+    if(rtmp_msg.lenght < 2)
+    {
+        return true;
+    }
+    const char* payload = rtmp_msg.playload.get();
+    if(payload[1] == 0)
+    {
+        return true;                                  // AVC/AAC 序列头
+    }
+    Add<uint64_t>(bytes_, rtmp_msg.lenght);
+    media_timestamp_.store(rtmp_msg._timestamp, std::memory_order_relaxed);
+    int64_t timestamp = rtmp_msg._timestamp;
+    if(rtmp_msg.type_id == RTMP_AUDIO)
+    {
+        Add<uint64_t>(audio_frames_, 1);
+        if(last_audio_timestamp_ >= 0 && timestamp > last_audio_timestamp_ + kAudioGapMs)
+        {
+            Add<uint64_t>(audio_gaps_, 1);
+        }
+        last_audio_timestamp_ = timestamp;
+        return true;
+    }
+
+    Add<uint64_t>(video_frames_, 1);
+    uint32_t interval = video_interval_ms_.load(std::memory_order_relaxed);
+    if(interval > 0 && last_video_timestamp_ >= 0 && timestamp > last_video_timestamp_ + interval * 3 / 2)
+    {
+        Add<uint64_t>(video_gaps_, 1);
+        if((payload[0] >> 4) != 1)
+        {
+            Add<uint64_t>(broken_gaps_, 1);             // 参考帧丢失后收到非关键帧，解码出错
+        }
+    }
+    last_video_timestamp_ = timestamp;
+    if(ttff_ms_.load(std::memory_order_relaxed) < 0)
+    {
+        int64_t now = GetNowMs();
+        first_frame_time_.store(now, std::memory_order_relaxed);
+        ttff_ms_.store(now - start_time_, std::memory_order_relaxed);
+    }
+
+    uint64_t sent_us = 0;
+    if(BenchSource::ReadStamp(payload, rtmp_msg.lenght, sent_us) && sent_us >= play_start_us_)
+    {
+        uint64_t now_us = BenchSource::GetWallClockUs();
+        uint32_t latency_us = now_us > sent_us ? (uint32_t)std::min<uint64_t>(now_us - sent_us, UINT32_MAX) : 0;
+        std::lock_guard<std::mutex> lock(mutex_);
+        latency_samples_.push_back(latency_us);
+    }
+    return true;
+}
@@ -0,0 +1,132 @@
+/**
+ * @file BenchPlayer.h
+ * @brief 压测观看连接：play 后解析收到的音视频，统计交付码率、首帧时间与端到端时延。
+ *
+ * 端到端时延由视频帧中压测 SEI 携带的发送时刻计算；
+ * 发送时刻早于本连接开始播放的帧来自服务端 GOP 缓存，不计入时延样本。
+ * 开启到达统计时，每次读回调把新读到的线上字节数按到达时刻计入固定宽度的时间桶，用于评估服务端发送节奏的平滑程度。
+ * 设置视频帧间隔后按时间戳检查丢帧：视频时间戳跳变视为一次缺口，缺口后的首帧不是关键帧说明解码会出错；
+ * 音频时间戳跳变超过 100 毫秒计为音频缺口。限速读取的观看者用于检查服务端积压时的丢帧策略。
+ */
+
+#ifndef _BENCHPLAYER_H_
+#define _BENCHPLAYER_H_
+
+#include "RtmpClient.h"
+#include <atomic>
+#include <mutex>
+#include <vector>
+
+/**
+ * @class BenchPlayer
+ * @brief 一个压测观看者，IO 在所属调度线程执行
+ */
+class BenchPlayer : public RtmpClient
+{
+public:
+    using Ptr = std::shared_ptr<BenchPlayer>;
+
+    /** 观看统计 */
+    struct Stats
+    {
+        bool started = false;           ///< 服务端是否接受了 play
+        bool closed = false;            ///< 连接是否已断开
+        int64_t ttff_ms = -1;           ///< 从发起连接到收到首个视频帧的时间（毫秒），-1 表示未收到
+        uint64_t video_frames = 0;      ///< 收到的视频帧数（不含序列头）
+        uint64_t audio_frames = 0;      ///< 收到的音频帧数（不含序列头）
+        uint64_t bytes = 0;             ///< 收到的音视频负载字节数
+        uint64_t wire_bytes = 0;        ///< 从 socket 读取的字节数，含 chunk 头部
+        uint64_t elapsed_ms = 0;        ///< 收到首帧以来的时间（毫秒）
+        uint64_t media_timestamp = 0;   ///< 最近收到的音视频时间戳（毫秒），点播时用于计算实时倍率
+        uint64_t video_gaps = 0;        ///< 视频时间戳缺口数（服务端丢帧）
+        uint64_t broken_gaps = 0;       ///< 缺口后首帧不是关键帧的次数
+        uint64_t audio_gaps = 0;        ///< 音频时间戳缺口数
+    };
+
+    /**
+     * @brief 发起连接并发送 C0C1
+     * @param scheduler 调度器
+     * @param ip 服务端 IPv4 地址
+     * @param port 服务端端口
+     * @param stream_path 流路径，格式 "/app/stream"
+     * @param pacing_bin_ms 到达统计的时间桶宽度（毫秒），0 表示不统计
+     * @return 观看连接，参数无效或 socket 创建失败时为 nullptr
+     */
+    static Ptr Create(TaskScheduler* scheduler, const std::string& ip, uint16_t port, const std::string& stream_path,
+                      uint32_t pacing_bin_ms = 0);
+
+    /**
+     * @brief 析构函数
+     */
+    virtual ~BenchPlayer();
+
+    /**
+     * @brief 读取统计（可跨线程调用）
+     */
+    Stats GetStats() const;
+
+    /**
+     * @brief 取出并清空已收集的端到端时延样本（微秒）
+     */
+    std::vector<uint32_t> TakeLatencySamples();
+
+    /**
+     * @brief 读取 [start_ms, end_ms) 内各时间桶收到的线上字节数（可跨线程调用）
+     * @param start_ms 开始时间（GetNowMs 时钟，毫秒）
+     * @param end_ms 结束时间
+     * @return 每个时间桶的字节数，未开启到达统计时为空
+     */
+    std::vector<uint32_t> GetPacingBins(int64_t start_ms, int64_t end_ms);
+
+    /**
+     * @brief 设置视频帧间隔，开启丢帧检查（可跨线程调用）
+     * @param interval_ms 源的视频帧间隔（毫秒），时间戳跳变超过 1.5 倍视为缺口，0 表示不检查
+     */
+    void SetVideoInterval(uint32_t interval_ms);
+
+    /**
+     * @brief 限速读取：按 rate 读取 socket，并把接收缓冲区缩小到 64KB，使服务端尽快出现发送积压（可跨线程调用）
+     * @param rate 读取速率（字节/秒）
+     */
+    void SetThrottle(uint32_t rate);
+
+private:
+    BenchPlayer(TaskScheduler* scheduler, int socket, const std::string& ip, uint16_t port, const std::string& stream_path,
+                uint32_t pacing_bin_ms);
+
+    /**
+     * @brief 把本次读到的线上字节数计入到达时刻所在的时间桶，再交给 RtmpClient 处理
+     */
+    virtual bool OnRead(BufferReader& buffer) override;
+
+    // --- RtmpClient 接口重写 ---
+    virtual void SendStreamCommand() override;       ///< 发送 play
+    virtual bool OnStatus(const std::string& level, const std::string& code) override;
+    virtual bool HandleMedia(RtmpMessage& rtmp_msg) override;
+
+    template<typename T>
+    static void Add(std::atomic<T>& counter, T value)
+    { counter.store(counter.load(std::memory_order_relaxed) + value, std::memory_order_relaxed); }
+
+    uint64_t play_start_us_ = 0;                 ///< 发送 play 的墙上时钟时刻（微秒）
+    std::atomic<int64_t> ttff_ms_{-1};
+    std::atomic<int64_t> first_frame_time_{0};   ///< 收到首个视频帧的时间（毫秒）
+    std::atomic<uint64_t> video_frames_{0};
+    std::atomic<uint64_t> audio_frames_{0};
+    std::atomic<uint64_t> bytes_{0};
+    std::atomic<uint64_t> media_timestamp_{0};
+    std::atomic<uint32_t> video_interval_ms_{0};
+    std::atomic<uint64_t> video_gaps_{0};
+    std::atomic<uint64_t> broken_gaps_{0};
+    std::atomic<uint64_t> audio_gaps_{0};
+    int64_t last_video_timestamp_ = -1;          ///< 上一个视频帧的时间戳，只在所属线程使用
+    int64_t last_audio_timestamp_ = -1;          ///< 上一个音频帧的时间戳，只在所属线程使用
+    std::mutex mutex_;                           ///< 保护 latency_samples_ 与 pacing_bins_
+    std::vector<uint32_t> latency_samples_;      ///< 端到端时延样本（微秒）
+    const uint32_t pacing_bin_ms_;               ///< 到达统计的时间桶宽度（毫秒），0 表示不统计
+    uint64_t pacing_read_bytes_ = 0;             ///< 已计入时间桶的线上字节数，只在所属线程使用
+    int64_t pacing_base_ = -1;                   ///< pacing_bins_[0] 对应的时间桶序号（时刻 / 桶宽）
+    std::vector<uint32_t> pacing_bins_;          ///< 各时间桶收到的线上字节数
+};
+
+#endif // _BENCHPLAYER_H_
@@ -0,0 +1,206 @@
+/**
+ * @file BenchPublisher.cpp
+ * @brief 实现 BenchPublisher：publish 命令与按时间戳发送。
+ */
+#include "BenchPublisher.h"
+#include "rtmp.h"
+
+/** 发送定时器周期（毫秒） */
+static const uint32_t kSendIntervalMs = 10;
+/** 发送队列上限（字节），超过时丢帧到下一个关键帧 */
+static const uint32_t kMaxPendingBytes = 4 * 1024 * 1024;
+
+/**
+ * @brief 创建 socket 并发起非阻塞连接后发送 C0C1
+ */
+BenchPublisher::Ptr BenchPublisher::Create(TaskScheduler* scheduler, const std::string& ip, uint16_t port,
+                                           const std::string& stream_path, BenchSource::Ptr source, uint32_t chunk_size)
+{
+    if(!source || !IsValidStreamPath(stream_path))
+    {
+        return nullptr;
+    }
+    int sockfd = Connect(ip, port);
+    if(sockfd < 0)
+    {
+        return nullptr;
+    }
+    Ptr publisher(new BenchPublisher(scheduler, sockfd, ip, port, stream_path, source, chunk_size));
+    publisher->Start();
+    return publisher;
+}
+
+/**
+ * @brief 私有构造
+ */
+BenchPublisher::BenchPublisher(TaskScheduler* scheduler, int socket, const std::string& ip, uint16_t port,
+                               const std::string& stream_path, BenchSource::Ptr source, uint32_t chunk_size)
+    :RtmpClient(scheduler, socket, ip, port, stream_path, chunk_size)
+    ,source_(source)
+{
+}
+
+/**
+ * @brief 析构函数
+ */
+BenchPublisher::~BenchPublisher()
+{
+}
+
+/**
+ * @brief 读取统计
+ */
+BenchPublisher::Stats BenchPublisher::GetStats() const
+{
+    Stats stats;
+    stats.started = HasStarted();
+    stats.closed = IsClosed();
+    stats.sent_frames = sent_frames_.load(std::memory_order_relaxed);
+    stats.sent_bytes = sent_bytes_.load(std::memory_order_relaxed);
+    stats.skipped_frames = skipped_frames_.load(std::memory_order_relaxed);
+    int64_t stream_start = stream_start_ms_.load(std::memory_order_relaxed);
+    if(stream_start != 0)
+    {
+        stats.elapsed_ms = (uint64_t)(GetNowMs() - stream_start);
+    }
+    return stats;
+}
+
+/**
+ * @brief 在 createStream 返回的消息流上发送 publish
+ */
+void BenchPublisher::SendStreamCommand()
+{
+    AmfObjects objects;
+    amf_encoder_.reset();
+    amf_encoder_.encodeString("publish", 7);
+    amf_encoder_.encodeNumber(0);
+    amf_encoder_.encodeObjects(objects);
+    amf_encoder_.encodeString(stream_name_.c_str(), (int)stream_name_.size());
+    amf_encoder_.encodeString("live", 4);
+    SendInvokeMessage(stream_id_, amf_encoder_.data(), amf_encoder_.size());
+}
+
+/**
+ * @brief NetStream.Publish.Start 后开始推流，错误时断开
+ */
+bool BenchPublisher::OnStatus(const std::string& level, const std::string& code)
+{
+    if(level == "error" || code == "NetStream.Publish.BadName")
+    {
+        printf("[BenchPublisher] %s%s %s\n", GetRemote().c_str(), stream_path_.c_str(), code.c_str());
+        return false;
+    }
+    if(code == "NetStream.Publish.Start" && state_ != STARTED)
+    {
+        SetStarted();
+        StartStream();
+    }
+    return true;
+}
+
+/**
+ * @brief 发送 @setDataFrame 元数据与序列头，之后由定时器发送音视频
+ */
+void BenchPublisher::StartStream()
+{
+    AmfObjects meta_data = source_->GetMetaData();
+    if(!meta_data.empty())
+    {
+        AmfEncoder amf_encoder;
+        amf_encoder.encodeString("@setDataFrame", 13);
+        amf_encoder.encodeString("onMetaData", 10);
+        amf_encoder.encodeECMA(meta_data);
+        SendMedia(RTMP_NOTIFY, 0, amf_encoder.data(), amf_encoder.size());
+    }
+    const BenchSource::Frame& avc_sequence_header = source_->GetAvcSequenceHeader();
+    if(avc_sequence_header.size > 0)
+    {
+        SendMedia(RTMP_VIDEO, 0, avc_sequence_header.payload, avc_sequence_header.size);
+    }
+    const BenchSource::Frame& aac_sequence_header = source_->GetAacSequenceHeader();
+    if(aac_sequence_header.size > 0)
+    {
+        SendMedia(RTMP_AUDIO, 0, aac_sequence_header.payload, aac_sequence_header.size);
+    }
+
+    stream_start_ = GetNowMs();
+    stream_start_ms_.store(stream_start_, std::memory_order_relaxed);
+    SendDueFrames();
+
+    std::weak_ptr<TcpConnection> weak_conn = shared_from_this();
+    GetTaskSchduler()->AddTimer([weak_conn](){
+        auto conn = weak_conn.lock();
+        return conn && static_cast<BenchPublisher*>(conn.get())->SendDueFrames();
+    }, kSendIntervalMs);
+}
+
+/**
+ * @brief 按推流开始以来的时间发送到期的帧，循环周期结束后从头开始并累加时间戳
+ */
+bool BenchPublisher::SendDueFrames()
+{
+    if(this->IsClosed())
+    {
+        return false;
+    }
+    const std::vector<BenchSource::Frame>& frames = source_->GetFrames();
+    uint64_t elapsed = (uint64_t)(GetNowMs() - stream_start_);
+    while(true)
+    {
+        if(next_frame_ >= frames.size())
+        {
+            next_frame_ = 0;
+            loop_offset_ += source_->GetDuration();
+        }
+        const BenchSource::Frame& frame = frames[next_frame_];
+        uint64_t timestamp = loop_offset_ + frame.timestamp;
+        if(timestamp > elapsed)
+        {
+            break;
+        }
+        next_frame_++;
+
+        bool is_video = frame.type == RTMP_VIDEO;
+        if(is_video && frame.key_frame)
+        {
+            wait_key_frame_ = false;
+        }
+        if(wait_key_frame_ || GetPendingBytes() > kMaxPendingBytes)
+        {
+            wait_key_frame_ = true;
+            Add<uint64_t>(skipped_frames_, 1);
+            continue;
+        }
+
+        if(is_video)
+        {
+            uint32_t size = 0;
+            std::shared_ptr<char> payload = BenchSource::StampVideo(frame, BenchSource::GetWallClockUs(), size);
+            SendMedia(RTMP_VIDEO, (uint32_t)timestamp, payload, size);
+        }
+        else
+        {
+            SendMedia(frame.type, (uint32_t)timestamp, frame.payload, frame.size);
+        }
+        Add<uint64_t>(sent_frames_, 1);
+        Add<uint64_t>(sent_bytes_, frame.size);
+    }
+    return true;
+}
+
+/**
+ * @brief 按消息类型选择 chunk 流后发送
+ */
+void BenchPublisher::SendMedia(uint8_t type, uint32_t timestamp, std::shared_ptr<char> payload, uint32_t size)
+{
+    RtmpMessage rtmp_msg;
+    rtmp_msg.type_id = type;
+    rtmp_msg.timestamp = timestamp;
+    rtmp_msg._timestamp = timestamp;
+    rtmp_msg.stream_id = stream_id_;
+    rtmp_msg.playload = payload;
+    rtmp_msg.lenght = size;
+    uint32_t csid = type == RTMP_VIDEO ? RTMP_CHUNK_VIDEO_ID : (type == RTMP_AUDIO ? RTMP_CHUNK_AUDIO_ID : RTMP_CHUNK_DATA_ID);
+    SendRtmpChunks(csid, rtmp_msg);
+}
@@ -0,0 +1,98 @@
+/**
+ * @file BenchPublisher.h
+ * @brief 压测推流连接：publish 成功后按媒体源的时间戳实时发送音视频。
+ *
+ * 每 10 毫秒检查一次，发送所有时间戳已到的帧，定时器抖动不会影响平均码率；
+ * 服务端读得慢导致发送队列超过上限时丢帧到下一个关键帧，并计入统计。
+ */
+
+#ifndef _BENCHPUBLISHER_H_
+#define _BENCHPUBLISHER_H_
+
+#include "RtmpClient.h"
+#include "BenchSource.h"
+#include <atomic>
+
+/**
+ * @class BenchPublisher
+ * @brief 一条压测推流，IO 与发送定时器都在所属调度线程执行
+ */
+class BenchPublisher : public RtmpClient
+{
+public:
+    using Ptr = std::shared_ptr<BenchPublisher>;
+
+    /** 推流统计 */
+    struct Stats
+    {
+        bool started = false;           ///< 服务端是否接受了 publish
+        bool closed = false;            ///< 连接是否已断开
+        uint64_t sent_frames = 0;       ///< 已发送的音视频帧数
+        uint64_t sent_bytes = 0;        ///< 已发送的音视频负载字节数
+        uint64_t skipped_frames = 0;    ///< 发送队列超限丢弃的帧数
+        uint64_t elapsed_ms = 0;        ///< 开始推流以来的时间（毫秒）
+    };
+
+    /**
+     * @brief 发起连接并发送 C0C1
+     * @param scheduler 调度器
+     * @param ip 服务端 IPv4 地址
+     * @param port 服务端端口
+     * @param stream_path 流路径，格式 "/app/stream"
+     * @param source 媒体源
+     * @param chunk_size 发送 chunk 大小
+     * @return 推流连接，参数无效或 socket 创建失败时为 nullptr
+     */
+    static Ptr Create(TaskScheduler* scheduler, const std::string& ip, uint16_t port, const std::string& stream_path,
+                      BenchSource::Ptr source, uint32_t chunk_size);
+
+    /**
+     * @brief 析构函数
+     */
+    virtual ~BenchPublisher();
+
+    /**
+     * @brief 读取统计（可跨线程调用）
+     */
+    Stats GetStats() const;
+
+private:
+    BenchPublisher(TaskScheduler* scheduler, int socket, const std::string& ip, uint16_t port,
+                   const std::string& stream_path, BenchSource::Ptr source, uint32_t chunk_size);
+
+    // --- RtmpClient 接口重写 ---
+    virtual void SendStreamCommand() override;       ///< 发送 publish
+    virtual bool OnStatus(const std::string& level, const std::string& code) override;
+
+    /**
+     * @brief 发送元数据与序列头，并启动发送定时器
+     */
+    void StartStream();
+
+    /**
+     * @brief 发送所有时间戳已到的帧
+     * @return false 表示连接已断开，停止定时器
+     */
+    bool SendDueFrames();
+
+    /**
+     * @brief 发送一条音视频或数据消息
+     */
+    void SendMedia(uint8_t type, uint32_t timestamp, std::shared_ptr<char> payload, uint32_t size);
+
+    template<typename T>
+    static void Add(std::atomic<T>& counter, T value)
+    { counter.store(counter.load(std::memory_order_relaxed) + value, std::memory_order_relaxed); }
+
+    BenchSource::Ptr source_;                    ///< 媒体源
+    size_t next_frame_ = 0;                      ///< 下一帧在循环周期内的下标
+    uint64_t loop_offset_ = 0;                   ///< 已完成的循环周期总时长（毫秒）
+    int64_t stream_start_ = 0;                   ///< 开始推流的时间（毫秒）
+    bool wait_key_frame_ = false;                ///< 丢帧后等待下一个关键帧
+    std::atomic<uint64_t> sent_frames_{0};
+    std::atomic<uint64_t> sent_bytes_{0};
+    std::atomic<uint64_t> skipped_frames_{0};
+    std::atomic<int64_t> stream_start_ms_{0};    ///< stream_start_ 的跨线程副本
+};
+
+#endif // _BENCHPUBLISHER_H_
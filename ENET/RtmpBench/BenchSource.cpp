@@ -0,0 +1,290 @@
+/**
+ * @file BenchSource.cpp
+ * @brief 实现 BenchSource：合成帧生成、FLV 读取与时间戳 SEI。
+ */
+#include "BenchSource.h"
+#include "rtmp.h"
+#include "../EdoyunNet/BufferReader.h"
+#include "../EdoyunNet/BufferWriter.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+
+/** 压测 SEI 的 user_data_unregistered UUID */
+static const uint8_t kStampUuid[16] = {
+    0x52, 0x54, 0x4d, 0x50, 0x42, 0x45, 0x4e, 0x43, 0x48, 0x2d, 0x54, 0x53, 0x2d, 0x76, 0x31, 0x00
+};
+/** SEI NAL：长度(4) + NAL 头(1) + 类型(1) + 大小(1) + UUID(16) + 时刻(8) + 结束位(1) */
+static const uint32_t kStampNalSize = 1 + 1 + 1 + 16 + 8 + 1;
+static const uint32_t kStampSize = 4 + kStampNalSize;
+/** FLV 视频 tag 头：帧类型/编码(1) + AVCPacketType(1) + CompositionTime(3) */
+static const uint32_t kAvcHeaderSize = 5;
+
+/**
+ * @brief 分配负载缓冲区
+ */
+static std::shared_ptr<char> Allocate(uint32_t size)
+{
+    return std::shared_ptr<char>(new char[size], std::default_delete<char[]>());
+}
+
+/**
+ * @brief 墙上时钟的当前时间（微秒），推流端与观看端可在不同进程中比较
+ */
+uint64_t BenchSource::GetWallClockUs()
+{
+    return std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::system_clock::now().time_since_epoch()).count();
+}
+
+/**
+ * @brief 生成合成媒体源
+ *
+ * 关键帧按平均帧大小的 4 倍生成，其余帧平分 GOP 的剩余字节，平均码率与设定值一致；
+ * 音频为 44.1kHz AAC，每帧 1024 个采样
+ */
+BenchSource::Ptr BenchSource::CreateSynthetic(uint32_t video_bitrate, uint32_t fps, uint32_t gop, uint32_t audio_bitrate)
+{
+    if(fps == 0 || gop == 0 || video_bitrate < fps * 8 * 64)
+    {
+        return nullptr;
+    }
+    std::shared_ptr<BenchSource> source(new BenchSource());
+
+    // 最小的 Baseline SPS/PPS，观看端只需能识别序列头
+    static const char kAvcConfig[] = "\x17\x00\x00\x00\x00\x01\x42\x00\x1e\xff\xe1\x00\x04\x67\x42\x00\x1e\x01\x00\x04\x68\xce\x3c\x80";
+    source->avc_sequence_header_.type = RTMP_VIDEO;
+    source->avc_sequence_header_.size = sizeof(kAvcConfig) - 1;
+    source->avc_sequence_header_.payload = Allocate(source->avc_sequence_header_.size);
+    memcpy(source->avc_sequence_header_.payload.get(), kAvcConfig, source->avc_sequence_header_.size);
+
+    uint32_t average_size = video_bitrate / 8 / fps;
+    uint32_t key_size = gop > 1 ? average_size * 4 : average_size;
+    uint32_t delta_size = gop > 1 ? std::max<uint32_t>((average_size * gop - key_size) / (gop - 1), 64) : average_size;
+    source->duration_ = gop * 1000 / fps;
+    for(uint32_t i = 0; i < gop; i++)
+    {
+        Frame frame;
+        frame.type = RTMP_VIDEO;
+        frame.timestamp = i * 1000 / fps;
+        frame.key_frame = i == 0;
+        frame.size = frame.key_frame ? key_size : delta_size;
+        frame.payload = Allocate(frame.size);
+        char* data = frame.payload.get();
+        memset(data, 0xab, frame.size);
+        data[0] = frame.key_frame ? 0x17 : 0x27;
+        data[1] = 1;
+        data[2] = data[3] = data[4] = 0;
+        WriteUint32BE(data + kAvcHeaderSize, frame.size - kAvcHeaderSize - 4);
+        data[kAvcHeaderSize + 4] = frame.key_frame ? 0x65 : 0x41;
+        source->frames_.push_back(frame);
+    }
+
+    if(audio_bitrate > 0)
+    {
+        static const char kAacConfig[] = "\xaf\x00\x12\x10";
+        source->aac_sequence_header_.type = RTMP_AUDIO;
+        source->aac_sequence_header_.size = sizeof(kAacConfig) - 1;
+        source->aac_sequence_header_.payload = Allocate(source->aac_sequence_header_.size);
+        memcpy(source->aac_sequence_header_.payload.get(), kAacConfig, source->aac_sequence_header_.size);
+
+        uint32_t audio_size = std::max<uint32_t>((uint32_t)((uint64_t)audio_bitrate * 1024 / 44100 / 8), 8);
+        for(uint64_t i = 0; i * 1024 * 1000 / 44100 < source->duration_; i++)
+        {
+            Frame frame;
+            frame.type = RTMP_AUDIO;
+            frame.timestamp = (uint32_t)(i * 1024 * 1000 / 44100);
+            frame.size = audio_size;
+            frame.payload = Allocate(frame.size);
+            memset(frame.payload.get(), 0x21, frame.size);
+            frame.payload.get()[0] = (char)0xaf;
+            frame.payload.get()[1] = 1;
+            source->frames_.push_back(frame);
+        }
+        std::stable_sort(source->frames_.begin(), source->frames_.end(), [](const Frame& a, const Frame& b){
+            return a.timestamp < b.timestamp;
+        });
+    }
+
+    source->bitrate_ = video_bitrate + audio_bitrate;
+    source->meta_data_["width"] = AmfObject(1280.0);
+    source->meta_data_["height"] = AmfObject(720.0);
+    source->meta_data_["framerate"] = AmfObject((double)fps);
+    source->meta_data_["videodatarate"] = AmfObject(video_bitrate / 1000.0);
+    source->meta_data_["videocodecid"] = AmfObject((double)RTMP_CODEC_ID_H264);
+    if(audio_bitrate > 0)
+    {
+        source->meta_data_["audiodatarate"] = AmfObject(audio_bitrate / 1000.0);
+        source->meta_data_["audiocodecid"] = AmfObject((double)RTMP_CODEC_ID_AAC);
+        source->meta_data_["audiosamplerate"] = AmfObject(44100.0);
+    }
+    return source;
+}
+
+/**
+ * @brief 读取 FLV 文件
+ *
+ * 时间戳从第一个音视频 tag 起算；循环周期为最后一个视频帧的时间戳加上平均视频帧间隔
+ */
+BenchSource::Ptr BenchSource::LoadFlv(const std::string& path)
+{
+    FILE* file = fopen(path.c_str(), "rb");
+    if(!file)
+    {
+        return nullptr;
+    }
+    std::vector<char> data;
+    char buffer[64 * 1024];
+    size_t size = 0;
+    while((size = fread(buffer, 1, sizeof(buffer), file)) > 0)
+    {
+        data.insert(data.end(), buffer, buffer + size);
+    }
+    fclose(file);
+    if(data.size() < 13 || memcmp(data.data(), "FLV", 3) != 0)
+    {
+        return nullptr;
+    }
+
+    std::shared_ptr<BenchSource> source(new BenchSource());
+    uint64_t total_bytes = 0;
+    uint32_t video_frames = 0;
+    uint32_t last_video_timestamp = 0;
+    int64_t first_timestamp = -1;
+    size_t pos = ReadUint32BE(data.data() + 5) + 4;   // 文件头 + PreviousTagSize0
+    while(pos + 11 <= data.size())
+    {
+        const char* tag = data.data() + pos;
+        uint8_t type = (uint8_t)tag[0] & 0x1f;
+        uint32_t tag_size = ReadUint24BE((char*)tag + 1);
+        uint32_t timestamp = ReadUint24BE((char*)tag + 4) | ((uint32_t)(uint8_t)tag[7] << 24);
+        if(pos + 11 + tag_size > data.size())
+        {
+            break;
+        }
+        const char* body = tag + 11;
+        pos += 11 + tag_size + 4;
+        if(tag_size < 2)
+        {
+            continue;
+        }
+
+        Frame frame;
+        frame.type = type;
+        frame.size = tag_size;
+        frame.payload = Allocate(tag_size);
+        memcpy(frame.payload.get(), body, tag_size);
+        if(type == RTMP_VIDEO)
+        {
+            if(((uint8_t)body[0] & 0x0f) != RTMP_CODEC_ID_H264)
+            {
+                continue;
+            }
+            if(body[1] == 0)
+            {
+                source->avc_sequence_header_ = frame;
+                continue;
+            }
+            frame.key_frame = (((uint8_t)body[0] >> 4) & 0x0f) == 1;
+            video_frames++;
+        }
+        else if(type == RTMP_AUDIO)
+        {
+            if((((uint8_t)body[0] >> 4) & 0x0f) == RTMP_CODEC_ID_AAC && body[1] == 0)
+            {
+                source->aac_sequence_header_ = frame;
+                continue;
+            }
+        }
+        else
+        {
+            if(type == RTMP_NOTIFY)
+            {
+                AmfDecoder decoder;
+                int bytes_used = decoder.decode(body, (int)tag_size, 1);
+                if(bytes_used > 0 && decoder.getString() == "onMetaData")
+                {
+                    decoder.reset();
+                    decoder.decode(body + bytes_used, (int)tag_size - bytes_used);
+                    source->meta_data_ = decoder.getObjects();
+                }
+            }
+            continue;
+        }
+
+        if(first_timestamp < 0)
+        {
+            first_timestamp = timestamp;
+        }
+        frame.timestamp = timestamp >= first_timestamp ? (uint32_t)(timestamp - first_timestamp) : 0;
+        if(type == RTMP_VIDEO)
+        {
+            last_video_timestamp = std::max(last_video_timestamp, frame.timestamp);
+        }
+        total_bytes += frame.size;
+        source->frames_.push_back(frame);
+    }
+
+    if(source->frames_.empty())
+    {
+        return nullptr;
+    }
+    std::stable_sort(source->frames_.begin(), source->frames_.end(), [](const Frame& a, const Frame& b){
+        return a.timestamp < b.timestamp;
+    });
+    // 按视频帧间隔计算周期，循环后的关键帧间隔与文件内一致
+    uint32_t frame_interval = video_frames > 1 ? last_video_timestamp / (video_frames - 1) : 40;
+    source->duration_ = std::max(last_video_timestamp + std::max<uint32_t>(frame_interval, 1),
+                                 source->frames_.back().timestamp + 1);
+    source->bitrate_ = (uint32_t)(total_bytes * 8 * 1000 / source->duration_);
+    return source;
+}
+
+/**
+ * @brief 在 AVC 头之后插入 SEI（user_data_unregistered），原有 NAL 保持不变
+ */
+std::shared_ptr<char> BenchSource::StampVideo(const Frame& frame, uint64_t wall_clock_us, uint32_t& size)
+{
+    if(frame.size < kAvcHeaderSize)
+    {
+        size = frame.size;
+        return frame.payload;
+    }
+    size = frame.size + kStampSize;
+    std::shared_ptr<char> payload = Allocate(size);
+    char* data = payload.get();
+    memcpy(data, frame.payload.get(), kAvcHeaderSize);
+
+    char* sei = data + kAvcHeaderSize;
+    WriteUint32BE(sei, kStampNalSize);
+    sei[4] = 0x06;                                    // NAL 类型 SEI
+    sei[5] = 0x05;                                    // user_data_unregistered
+    sei[6] = 16 + 8;
+    memcpy(sei + 7, kStampUuid, sizeof(kStampUuid));
+    WriteUint32BE(sei + 23, (uint32_t)(wall_clock_us >> 32));
+    WriteUint32BE(sei + 27, (uint32_t)wall_clock_us);
+    sei[31] = (char)0x80;                             // rbsp 结束位
+
+    memcpy(sei + kStampSize, frame.payload.get() + kAvcHeaderSize, frame.size - kAvcHeaderSize);
+    return payload;
+}
+
+/**
+ * @brief 压测 SEI 总是 AVC 头之后的第一个 NAL，只检查该位置
+ */
+bool BenchSource::ReadStamp(const char* payload, uint32_t size, uint64_t& wall_clock_us)
+{
+    if(size < kAvcHeaderSize + kStampSize)
+    {
+        return false;
+    }
+    const char* sei = payload + kAvcHeaderSize;
+    if(ReadUint32BE((char*)sei) != kStampNalSize || sei[4] != 0x06 || sei[5] != 0x05
+       || memcmp(sei + 7, kStampUuid, sizeof(kStampUuid)) != 0)
+    {
+        return false;
+    }
+    wall_clock_us = ((uint64_t)ReadUint32BE((char*)sei + 23) << 32) | ReadUint32BE((char*)sei + 27);
+    return true;
+}
@@ -0,0 +1,95 @@
+/**
+ * @file BenchSource.h
+ * @brief 压测推流的媒体源：合成的 H.264/AAC 帧，或循环播放的 FLV 文件。
+ *
+ * 媒体源只读，所有推流连接共享同一份帧数据，各自维护播放位置；
+ * 发送视频帧时在负载前插入一个携带发送时刻（墙上时钟）的 SEI，供观看端计算端到端时延。
+ */
+
+#ifndef _BENCHSOURCE_H_
+#define _BENCHSOURCE_H_
+
+#include "amf.h"
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+/**
+ * @class BenchSource
+ * @brief 一个循环周期内的音视频帧与序列头
+ */
+class BenchSource
+{
+public:
+    using Ptr = std::shared_ptr<const BenchSource>;
+
+    /** 一帧音视频，类型为 RTMP_VIDEO 或 RTMP_AUDIO */
+    struct Frame
+    {
+        uint8_t type = 0;
+        uint32_t timestamp = 0;             ///< 循环周期内的时间戳（毫秒）
+        bool key_frame = false;
+        std::shared_ptr<char> payload;      ///< FLV tag 数据（含音视频头）
+        uint32_t size = 0;
+    };
+
+    /**
+     * @brief 生成合成媒体源：一个 GOP 的视频帧与同时长的 AAC 帧
+     * @param video_bitrate 视频码率（bit/s）
+     * @param fps 帧率
+     * @param gop GOP 帧数
+     * @param audio_bitrate 音频码率（bit/s），0 表示不带音频
+     * @return 媒体源，参数无效时为 nullptr
+     */
+    static Ptr CreateSynthetic(uint32_t video_bitrate, uint32_t fps, uint32_t gop, uint32_t audio_bitrate);
+
+    /**
+     * @brief 读取 FLV 文件作为媒体源，序列头与元数据单独保存，其余 tag 循环发送
+     * @param path FLV 文件路径，视频须为 H.264
+     * @return 媒体源，文件无法读取或不含音视频时为 nullptr
+     */
+    static Ptr LoadFlv(const std::string& path);
+
+    /**
+     * @brief 在视频帧的 AVC 头之后插入携带发送时刻的 SEI
+     * @param frame 视频帧
+     * @param wall_clock_us 发送时刻（墙上时钟，微秒）
+     * @param size 输出的负载长度
+     * @return 新的负载
+     */
+    static std::shared_ptr<char> StampVideo(const Frame& frame, uint64_t wall_clock_us, uint32_t& size);
+
+    /**
+     * @brief 从视频负载中读取压测 SEI 携带的发送时刻
+     * @param payload 视频负载（含 AVC 头）
+     * @param size 负载长度
+     * @param wall_clock_us 输出的发送时刻（墙上时钟，微秒）
+     * @return false 表示负载中没有压测 SEI
+     */
+    static bool ReadStamp(const char* payload, uint32_t size, uint64_t& wall_clock_us);
+
+    /**
+     * @brief 墙上时钟的当前时间（微秒）
+     */
+    static uint64_t GetWallClockUs();
+
+    const std::vector<Frame>& GetFrames() const { return frames_; }
+    const Frame& GetAvcSequenceHeader() const { return avc_sequence_header_; }
+    const Frame& GetAacSequenceHeader() const { return aac_sequence_header_; }
+    const AmfObjects& GetMetaData() const { return meta_data_; }
+    uint32_t GetDuration() const { return duration_; }   ///< 循环周期（毫秒）
+    uint32_t GetBitrate() const { return bitrate_; }     ///< 平均码率（bit/s）
+
+private:
+    BenchSource() {}
+
+    std::vector<Frame> frames_;             ///< 按时间戳排序的音视频帧
+    Frame avc_sequence_header_;             ///< 视频序列头，size 为 0 表示没有
+    Frame aac_sequence_header_;             ///< 音频序列头，size 为 0 表示没有
+    AmfObjects meta_data_;                  ///< onMetaData 内容
+    uint32_t duration_ = 0;                 ///< 循环周期（毫秒）
+    uint32_t bitrate_ = 0;                  ///< 平均码率（bit/s）
+};
+
+#endif // _BENCHSOURCE_H_
@@ -0,0 +1,93 @@
+/**
+ * @file BenchUtil.cpp
+ * @brief 实现进程内基准共用的计时与时延直方图。
+ */
+#include "BenchUtil.h"
+#include <chrono>
+#include <ctime>
+
+int64_t GetSteadyUs()
+{
+    return std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+int64_t GetThreadCpuUs()
+{
+    timespec ts;
+    clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts);
+    return (int64_t)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
+LatencyHistogram::LatencyHistogram(uint32_t resolution_us, uint32_t max_us)
+    :resolution_us_(resolution_us > 0 ? resolution_us : 1)
+    ,buckets_(max_us / (resolution_us > 0 ? resolution_us : 1) + 1)
+    ,counts_(new std::atomic<uint64_t>[buckets_])
+{
+    Reset();
+}
+
+void LatencyHistogram::Add(int64_t us)
+{
+    uint64_t value = us > 0 ? (uint64_t)us : 0;
+    size_t index = (size_t)(value / resolution_us_);
+    counts_[index < buckets_ ? index : buckets_ - 1].fetch_add(1, std::memory_order_relaxed);
+    sum_.fetch_add(value, std::memory_order_relaxed);
+    uint64_t max = max_.load(std::memory_order_relaxed);
+    while(value > max && !max_.compare_exchange_weak(max, value, std::memory_order_relaxed))
+    {
+    }
+}
+
+void LatencyHistogram::Reset()
+{
+    for(size_t i = 0; i < buckets_; i++)
+    {
+        counts_[i].store(0, std::memory_order_relaxed);
+    }
+    sum_ = 0;
+    max_ = 0;
+}
+
+uint64_t LatencyHistogram::GetCount() const
+{
+    uint64_t count = 0;
+    for(size_t i = 0; i < buckets_; i++)
+    {
+        count += counts_[i].load(std::memory_order_relaxed);
+    }
+    return count;
+}
+
+double LatencyHistogram::GetAverage() const
+{
+    uint64_t count = GetCount();
+    return count > 0 ? (double)sum_.load(std::memory_order_relaxed) / count : 0.0;
+}
+
+uint64_t LatencyHistogram::Percentile(double percent) const
+{
+    uint64_t count = GetCount();
+    if(count == 0)
+    {
+        return 0;
+    }
+    uint64_t target = (uint64_t)(count * percent / 100.0);
+    uint64_t seen = 0;
+    for(size_t i = 0; i < buckets_; i++)
+    {
+        seen += counts_[i].load(std::memory_order_relaxed);
+        if(seen > target)
+        {
+            return (uint64_t)(i + 1) * resolution_us_;
+        }
+    }
+    return GetMax();
+}
+
+void LatencyHistogram::PrintJson(FILE* out, double scale) const
+{
+    fprintf(out, "{\"samples\": %llu, \"avg\": %.2f, \"p50\": %.2f, \"p99\": %.2f, \"max\": %.2f}",
+            (unsigned long long)GetCount(), GetAverage() / scale, Percentile(50) / scale,
+            Percentile(99) / scale, GetMax() / scale);
+}
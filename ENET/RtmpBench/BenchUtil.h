@@ -0,0 +1,61 @@
+/**
+ * @file BenchUtil.h
+ * @brief 进程内基准共用的计时与时延直方图。
+ */
+
+#ifndef _BENCHUTIL_H_
+#define _BENCHUTIL_H_
+
+#include <atomic>
+#include <cstdint>
+#include <cstdio>
+#include <memory>
+
+/**
+ * @brief 单调时钟（微秒）
+ */
+int64_t GetSteadyUs();
+
+/**
+ * @brief 调用线程的 CPU 时间（微秒），同步运行的基准以此计算每项操作的 CPU 开销
+ */
+int64_t GetThreadCpuUs();
+
+/**
+ * @class LatencyHistogram
+ * @brief 固定桶宽的时延直方图，可由多个线程并发写入（relaxed 原子计数）
+ *
+ * 桶宽为 resolution_us，超过上限的样本计入最后一个桶；百分位数取所在桶的上界
+ */
+class LatencyHistogram
+{
+public:
+    /**
+     * @param resolution_us 桶宽（微秒）
+     * @param max_us 上限（微秒）
+     */
+    LatencyHistogram(uint32_t resolution_us = 10, uint32_t max_us = 1000000);
+
+    void Add(int64_t us);                 ///< 记录一个样本，负值按 0 计
+    void Reset();                         ///< 清空所有样本
+    uint64_t GetCount() const;            ///< 样本数
+    double GetAverage() const;            ///< 平均值（微秒）
+    uint64_t GetMax() const { return max_.load(std::memory_order_relaxed); }
+    uint64_t Percentile(double percent) const;
+
+    /**
+     * @brief 以 {"samples","avg","p50","p99","max"} 格式输出，单位为 scale 分之一微秒
+     * @param out 输出文件
+     * @param scale 1 输出微秒，1000 输出毫秒
+     */
+    void PrintJson(FILE* out, double scale) const;
+
+private:
+    uint32_t resolution_us_;
+    size_t buckets_;
+    std::unique_ptr<std::atomic<uint64_t>[]> counts_;
+    std::atomic<uint64_t> sum_{0};
+    std::atomic<uint64_t> max_{0};
+};
+
+#endif // _BENCHUTIL_H_
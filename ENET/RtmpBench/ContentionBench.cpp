@@ -0,0 +1,274 @@
+/**
+ * @file ContentionBench.cpp
+ * @brief 实现会话分发的竞争基准。
+ *
+ * 每个调度线程一个定时器（10 毫秒），按各流错开的相位发送到时的帧并记录 SendMediaData 的耗时；
+ * 视频负载的 AVC 头之后写入发送时刻（单调时钟），观看者收到时计算交付时延。
+ * 观看者只取 fmt0 分组的分片结果并计数，不做网络发送，测得的是会话分发本身的开销。
+ */
+#include "ContentionBench.h"
+#include "BenchUtil.h"
+#include "RtmpSession.h"
+#include "RtmpSink.h"
+#include "rtmp.h"
+#include "../EdoyunNet/EventLoop.h"
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <thread>
+#include <vector>
+
+/** 定时器周期（毫秒） */
+static const uint32_t kTickMs = 10;
+/** 每条流的 GOP 缓存上限与所有流的总上限 */
+static const uint32_t kGopCacheBytes = 4 * 1024 * 1024;
+static const uint64_t kTotalGopCacheBytes = 256ULL * 1024 * 1024;
+/** 负载中发送时刻的偏移：5 字节 AVC 头之后 */
+static const uint32_t kStampOffset = 5;
+
+namespace {
+
+/** 一个调度线程上的统计，观看者只写入所属线程的统计 */
+struct WorkerStats
+{
+    std::atomic<uint64_t> frames{0};
+    std::atomic<uint64_t> deliveries{0};
+    std::atomic<uint64_t> rejoins{0};
+    LatencyHistogram publish_us{1, 100000};
+    LatencyHistogram delivery_us{10, 1000000};
+};
+
+std::atomic<bool> g_measuring(false);
+
+class ContentionSink : public RtmpSink
+{
+public:
+    ContentionSink(uint32_t id, TaskScheduler* owner, WorkerStats* stats, uint32_t chunk_size)
+        :id_(id), owner_(owner), stats_(stats), chunk_size_(chunk_size)
+    {
+    }
+
+    void Rejoin(int64_t now_us)
+    {
+        playing_ = false;
+        join_us_ = now_us;
+    }
+
+    bool SendMediaData(uint8_t type, uint64_t timestamp, std::shared_ptr<char> payload, uint32_t payload_size) override
+    {
+        return true;
+    }
+
+    bool SendMediaPacket(RtmpMediaPacket::Ptr packet) override
+    {
+        uint32_t chunks_size = 0;
+        if(!packet->GetChunks(chunk_size_, 1, chunks_size))
+        {
+            return false;
+        }
+        playing_ = true;
+        if(!g_measuring.load(std::memory_order_relaxed))
+        {
+            return true;
+        }
+        stats_->deliveries.fetch_add(1, std::memory_order_relaxed);
+        if(packet->GetType() == RTMP_VIDEO && packet->GetSize() >= kStampOffset + 8)
+        {
+            int64_t sent_us = 0;
+            memcpy(&sent_us, packet->GetPayload().get() + kStampOffset, 8);
+            if(sent_us >= join_us_.load())                         // GOP 缓存中的旧帧不计入时延
+            {
+                stats_->delivery_us.Add(GetSteadyUs() - sent_us);
+            }
+        }
+        return true;
+    }
+
+    bool IsPlayer() override { return true; }
+    bool IsPlaying() override { return playing_; }
+    uint32_t GetId() override { return id_; }
+    TaskScheduler* GetOwnerScheduler() override { return owner_; }
+
+private:
+    uint32_t id_;
+    TaskScheduler* owner_;
+    WorkerStats* stats_;
+    uint32_t chunk_size_;
+    std::atomic<bool> playing_{false};
+    std::atomic<int64_t> join_us_{0};
+};
+
+/** 一条流，由所属线程的定时器推流 */
+struct Stream
+{
+    RtmpSession::Ptr session;
+    int64_t offset_us = 0;              ///< 发帧相位，各流错开
+    uint64_t sent = 0;                  ///< 已发送的帧数
+};
+
+/** 一个调度线程上的流与观看者 */
+struct Worker
+{
+    TaskScheduler* scheduler = nullptr;
+    std::vector<Stream> streams;
+    std::vector<std::pair<RtmpSession::Ptr, std::shared_ptr<ContentionSink>>> sinks;
+    size_t churn_index = 0;
+    double churn_budget = 0;
+    WorkerStats stats;
+};
+
+std::shared_ptr<char> CreateFrame(uint32_t size, bool key_frame)
+{
+    std::shared_ptr<char> payload(new char[size], std::default_delete<char[]>());
+    memset(payload.get(), 0, size);
+    payload.get()[0] = key_frame ? 0x17 : 0x27;
+    payload.get()[1] = 1;                               // AVC NALU
+    int64_t now = GetSteadyUs();
+    memcpy(payload.get() + kStampOffset, &now, 8);
+    return payload;
+}
+
+} // namespace
+
+bool RunContentionBench(FILE* out, const ContentionBenchConfig& config)
+{
+    if(config.streams == 0 || config.fps == 0 || config.threads == 0 || config.duration_s == 0)
+    {
+        return false;
+    }
+    uint32_t frame_size = std::max<uint32_t>(kStampOffset + 8, config.video_kbps * 1000 / 8 / config.fps);
+    int64_t frame_interval_us = 1000000 / config.fps;
+    RtmpSession::SetMaxTotalGopCacheBytes(kTotalGopCacheBytes);
+
+    EventLoop loop(config.threads);
+    std::vector<std::unique_ptr<Worker>> workers;
+    for(uint32_t i = 0; i < config.threads; i++)
+    {
+        workers.emplace_back(new Worker);
+        workers.back()->scheduler = loop.GetTaskSchduler(i).get();
+    }
+
+    // 流 i 归属线程 i % threads，第 j 个观看者位于线程 (i + j) % threads，流亲和时与推流同线程
+    uint32_t sink_id = 0;
+    for(uint32_t i = 0; i < config.streams; i++)
+    {
+        Worker& owner = *workers[i % config.threads];
+        Stream stream;
+        stream.session = std::make_shared<RtmpSession>();
+        stream.session->SetScheduler(owner.scheduler);
+        stream.session->SetGopCache(kGopCacheBytes);
+        stream.offset_us = frame_interval_us * i / config.streams;
+        for(uint32_t j = 0; j < config.players; j++)
+        {
+            Worker& worker = config.affinity ? owner : *workers[(i + j) % config.threads];
+            auto sink = std::make_shared<ContentionSink>(++sink_id, worker.scheduler, &worker.stats, config.chunk_size);
+            stream.session->AddSink(sink);
+            worker.sinks.emplace_back(stream.session, sink);
+        }
+        owner.streams.push_back(stream);
+    }
+
+    std::atomic<bool> stopped(false);
+    int64_t start_us = GetSteadyUs();
+    for(auto &worker_ptr : workers)
+    {
+        Worker* worker = worker_ptr.get();
+        worker->scheduler->AddTimer([worker, &stopped, &config, start_us, frame_size, frame_interval_us]() {
+            if(stopped.load())
+            {
+                return false;
+            }
+            bool measuring = g_measuring.load(std::memory_order_relaxed);
+            int64_t now = GetSteadyUs();
+            for(auto &stream : worker->streams)
+            {
+                int64_t elapsed = now - start_us - stream.offset_us;
+                uint64_t due = elapsed > 0 ? (uint64_t)(elapsed / frame_interval_us) + 1 : 0;
+                while(stream.sent < due)
+                {
+                    std::shared_ptr<char> payload = CreateFrame(frame_size, stream.sent % config.gop == 0);
+                    int64_t begin = GetSteadyUs();
+                    stream.session->SendMediaData(RTMP_VIDEO, stream.sent * 1000 / config.fps, payload, frame_size);
+                    if(measuring)
+                    {
+                        worker->stats.publish_us.Add(GetSteadyUs() - begin);
+                        worker->stats.frames.fetch_add(1, std::memory_order_relaxed);
+                    }
+                    stream.sent++;
+                }
+            }
+
+            // 观看者在所属线程上退出并重新加入
+            worker->churn_budget += worker->sinks.size() * config.churn_percent / 100.0 * kTickMs / 1000.0;
+            while(worker->churn_budget >= 1 && !worker->sinks.empty())
+            {
+                auto &entry = worker->sinks[worker->churn_index++ % worker->sinks.size()];
+                entry.first->RemoveSink(entry.second);
+                entry.second->Rejoin(GetSteadyUs());
+                entry.first->AddSink(entry.second);
+                worker->churn_budget -= 1;
+                if(measuring)
+                {
+                    worker->stats.rejoins.fetch_add(1, std::memory_order_relaxed);
+                }
+            }
+            return true;
+        }, kTickMs);
+    }
+
+    // 预热 1 秒后开始测量
+    std::this_thread::sleep_for(std::chrono::seconds(1));
+    uint64_t serialized_start = RtmpMediaPacket::GetBytesSerialized();
+    int64_t measure_start = GetSteadyUs();
+    g_measuring = true;
+    std::this_thread::sleep_for(std::chrono::seconds(config.duration_s));
+    g_measuring = false;
+    int64_t measure_us = std::max<int64_t>(GetSteadyUs() - measure_start, 1);
+    uint64_t serialized = RtmpMediaPacket::GetBytesSerialized() - serialized_start;
+    stopped = true;
+    loop.Quit();                                          // 先停止调度线程，未执行的中继任务不再访问各线程的统计
+
+    uint64_t frames = 0, deliveries = 0, rejoins = 0;
+    for(auto &worker : workers)
+    {
+        frames += worker->stats.frames.load();
+        deliveries += worker->stats.deliveries.load();
+        rejoins += worker->stats.rejoins.load();
+    }
+    // 各线程分别输出直方图，另取最差线程的 p99
+    uint64_t publish_p99 = 0, delivery_p99 = 0;
+    for(auto &worker : workers)
+    {
+        publish_p99 = std::max(publish_p99, worker->stats.publish_us.Percentile(99));
+        delivery_p99 = std::max(delivery_p99, worker->stats.delivery_us.Percentile(99));
+    }
+    double seconds = measure_us / 1000000.0;
+
+    fprintf(out, "{\n");
+    fprintf(out, "  \"config\": {\"mode\": \"contention\", \"streams\": %u, \"players_per_stream\": %u, \"threads\": %u, "
+            "\"affinity\": %s, \"frame_size\": %u, \"fps\": %u, \"gop\": %u, \"chunk_size\": %u, \"churn_percent\": %u, "
+            "\"duration_ms\": %lld},\n",
+            config.streams, config.players, config.threads, config.affinity ? "true" : "false", frame_size, config.fps,
+            config.gop, config.chunk_size, config.churn_percent, (long long)(measure_us / 1000));
+    fprintf(out, "  \"frames\": {\"sent\": %llu, \"per_second\": %.0f, \"target_per_second\": %u},\n",
+            (unsigned long long)frames, frames / seconds, config.streams * config.fps);
+    fprintf(out, "  \"deliveries\": {\"count\": %llu, \"per_second\": %.0f, \"rejoins\": %llu},\n",
+            (unsigned long long)deliveries, deliveries / seconds, (unsigned long long)rejoins);
+    fprintf(out, "  \"publish_us\": {\"worst_thread_p99\": %llu, \"threads\": [", (unsigned long long)publish_p99);
+    for(size_t i = 0; i < workers.size(); i++)
+    {
+        fprintf(out, "%s", i > 0 ? ", " : "");
+        workers[i]->stats.publish_us.PrintJson(out, 1);
+    }
+    fprintf(out, "]},\n");
+    fprintf(out, "  \"delivery_us\": {\"worst_thread_p99\": %llu, \"threads\": [", (unsigned long long)delivery_p99);
+    for(size_t i = 0; i < workers.size(); i++)
+    {
+        fprintf(out, "%s", i > 0 ? ", " : "");
+        workers[i]->stats.delivery_us.PrintJson(out, 1);
+    }
+    fprintf(out, "]},\n");
+    fprintf(out, "  \"bytes_serialized_per_second\": %.0f\n", serialized / seconds);
+    fprintf(out, "}\n");
+    return true;
+}
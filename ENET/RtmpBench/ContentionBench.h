@@ -0,0 +1,40 @@
+/**
+ * @file ContentionBench.h
+ * @brief 会话分发的竞争基准：大量流与观看者分布在多个调度线程上，测量每帧分发耗时与交付时延。
+ *
+ * 在进程内直接驱动 RtmpSession，不建立连接：每条流归属一个调度线程，
+ * 观看者默认轮流分配到各线程，其他线程上的观看者经中继任务交付，同一消息的分片缓存被多个线程并发读取；
+ * 开启流亲和时观看者与推流位于同一线程（SetStreamAffinity 迁移后的布局），分发不跨线程，用于对比两种布局；
+ * 测量期间观看者按固定速率退出并重新加入，覆盖连接快照更新与 GOP 缓存下发的路径。
+ */
+
+#ifndef _CONTENTIONBENCH_H_
+#define _CONTENTIONBENCH_H_
+
+#include <cstdint>
+#include <cstdio>
+
+/** 竞争基准参数 */
+struct ContentionBenchConfig
+{
+    uint32_t streams = 10000;           ///< 流数
+    uint32_t players = 10;              ///< 每条流的观看者数
+    uint32_t threads = 1;               ///< 调度线程数
+    uint32_t video_kbps = 200;          ///< 每条流的视频码率，决定帧大小
+    uint32_t fps = 25;                  ///< 帧率
+    uint32_t gop = 50;                  ///< GOP 帧数，关键帧进入 GOP 缓存
+    uint32_t chunk_size = 4096;         ///< 观看者的 out chunk size
+    uint32_t duration_s = 10;           ///< 测量时长（秒）
+    uint32_t churn_percent = 1;         ///< 每秒退出并重新加入的观看者比例（%）
+    bool affinity = false;              ///< 观看者与推流位于同一线程，否则轮流分布到各线程
+};
+
+/**
+ * @brief 运行竞争基准并以 JSON 输出结果
+ * @param out 输出文件
+ * @param config 基准参数
+ * @return false 表示参数无效
+ */
+bool RunContentionBench(FILE* out, const ContentionBenchConfig& config);
+
+#endif // _CONTENTIONBENCH_H_
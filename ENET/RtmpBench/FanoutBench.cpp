@@ -0,0 +1,231 @@
+/**
+ * @file FanoutBench.cpp
+ * @brief 实现会话扇出基准。
+ *
+ * 观看者全部加入后发送序列头并预热一个循环周期，之后按循环周期计时：
+ * 每条消息经 RtmpSession::SendMediaData 分发给全部观看者，随后清空各观看者的写队列。
+ * 拷贝字节数：shared 取 RtmpMediaPacket 的分片计数，copy 为每个观看者分片与写入队列各一次。
+ * CPU 开销取线程 CPU 时间，按观看者数与处理的媒体时长折算为每个观看者每秒媒体所需的 CPU。
+ */
+#include "FanoutBench.h"
+#include "BenchSource.h"
+#include "BenchUtil.h"
+#include "RtmpChunk.h"
+#include "RtmpSession.h"
+#include "RtmpSink.h"
+#include "rtmp.h"
+#include "../EdoyunNet/BufferWriter.h"
+#include <algorithm>
+#include <vector>
+
+namespace {
+
+/** 一种发送路径的累计结果 */
+struct FanoutResult
+{
+    uint64_t frames = 0;                        ///< 分发的消息数
+    uint64_t deliveries = 0;                    ///< 放入观看者写队列的消息数
+    uint64_t wire_bytes = 0;                    ///< 放入写队列的字节数（chunk 分片后）
+    uint64_t bytes_copied = 0;                  ///< 分片与入队过程拷贝的字节数
+    uint64_t media_ms = 0;                      ///< 处理的媒体时长（毫秒）
+    int64_t wall_us = 0;
+    int64_t cpu_us = 0;
+};
+
+class FanoutSink : public RtmpSink
+{
+public:
+    FanoutSink(uint32_t id, bool shared, uint32_t chunk_size)
+        :id_(id), shared_(shared), writer_(new BufferWriter)
+    {
+        chunk_.SetOutChunkSize(chunk_size);
+    }
+
+    bool SendMediaData(uint8_t type, uint64_t timestamp, std::shared_ptr<char> payload, uint32_t payload_size) override
+    {
+        return true;
+    }
+
+    /** shared 与 RtmpConnection::SendPacketChunks 相同；copy 与改造前的 SendRtmpChunks 加 Send(const char*) 相同 */
+    bool SendMediaPacket(RtmpMediaPacket::Ptr packet) override
+    {
+        uint32_t size = 0;
+        if(shared_)
+        {
+            std::shared_ptr<char> chunks = packet->GetChunks(chunk_, 1, size);
+            if(!chunks || !writer_->Append(chunks, size))
+            {
+                return false;
+            }
+        }
+        else
+        {
+            RtmpMessage rtmp_msg;
+            rtmp_msg.type_id = packet->GetType();
+            rtmp_msg._timestamp = (uint32_t)packet->GetTimestamp();
+            rtmp_msg.stream_id = 1;
+            rtmp_msg.playload = packet->GetPayload();
+            rtmp_msg.lenght = packet->GetSize();
+            uint32_t csid = rtmp_msg.type_id == RTMP_AUDIO ? RTMP_CHUNK_AUDIO_ID : RTMP_CHUNK_VIDEO_ID;
+            uint32_t capacity = RtmpChunk::GetChunkCapacity(rtmp_msg.lenght, chunk_.GetOutChunkSize());
+            std::shared_ptr<char> buffer(new char[capacity], std::default_delete<char[]>());
+            int ret = chunk_.CreateChunk(csid, rtmp_msg, buffer.get(), capacity);
+            if(ret <= 0 || !writer_->Append(buffer.get(), (uint32_t)ret))
+            {
+                return false;
+            }
+            size = (uint32_t)ret;
+            bytes_copied_ += (uint64_t)size * 2;
+        }
+        playing_ = true;
+        deliveries_++;
+        wire_bytes_ += size;
+        return true;
+    }
+
+    /** 丢弃写队列中的数据，相当于内核已全部取走 */
+    void Drain() { writer_.reset(new BufferWriter); }
+
+    bool IsPlayer() override { return true; }
+    bool IsPlaying() override { return playing_; }
+    uint32_t GetId() override { return id_; }
+
+    uint64_t deliveries_ = 0;
+    uint64_t wire_bytes_ = 0;
+    uint64_t bytes_copied_ = 0;
+
+private:
+    uint32_t id_;
+    bool shared_;
+    bool playing_ = false;
+    RtmpChunk chunk_;
+    std::unique_ptr<BufferWriter> writer_;
+};
+
+/** 分发一条消息并清空各观看者的写队列 */
+void Publish(RtmpSession& session, std::vector<std::shared_ptr<FanoutSink>>& sinks, const BenchSource::Frame& frame,
+             uint64_t timestamp)
+{
+    session.SendMediaData(frame.type, timestamp, frame.payload, frame.size);
+    for(auto &sink : sinks)
+    {
+        sink->Drain();
+    }
+}
+
+/** 运行一种发送路径：预热一个循环周期后按循环周期计时，直到累计墙上时间达到 duration_us */
+FanoutResult Run(const BenchSource& source, const FanoutBenchConfig& config, bool shared, int64_t duration_us)
+{
+    RtmpSession session;
+    std::vector<std::shared_ptr<FanoutSink>> sinks;
+    for(uint32_t i = 0; i < config.players; i++)
+    {
+        sinks.push_back(std::make_shared<FanoutSink>(i + 1, shared, config.chunk_size));
+        session.AddSink(sinks.back());
+    }
+
+    const BenchSource::Frame* headers[] = { &source.GetAvcSequenceHeader(), &source.GetAacSequenceHeader() };
+    for(auto header : headers)
+    {
+        if(header->size > 0)
+        {
+            Publish(session, sinks, *header, 0);
+        }
+    }
+
+    FanoutResult result;
+    uint64_t loop_offset = 0;
+    uint64_t serialized = 0, deliveries = 0, wire_bytes = 0, bytes_copied = 0;
+    for(bool warmup = true; warmup || result.wall_us < duration_us; warmup = false)
+    {
+        if(!warmup)
+        {
+            serialized = RtmpMediaPacket::GetBytesSerialized();
+            deliveries = wire_bytes = bytes_copied = 0;
+            for(auto &sink : sinks)
+            {
+                deliveries += sink->deliveries_;
+                wire_bytes += sink->wire_bytes_;
+                bytes_copied += sink->bytes_copied_;
+            }
+        }
+        int64_t wall = GetSteadyUs();
+        int64_t cpu = GetThreadCpuUs();
+        for(auto &frame : source.GetFrames())
+        {
+            Publish(session, sinks, frame, loop_offset + frame.timestamp);
+        }
+        int64_t cpu_us = GetThreadCpuUs() - cpu;
+        int64_t wall_us = GetSteadyUs() - wall;
+        loop_offset += source.GetDuration();
+        if(warmup)
+        {
+            continue;
+        }
+        result.cpu_us += cpu_us;
+        result.wall_us += wall_us;
+        result.frames += source.GetFrames().size();
+        result.media_ms += source.GetDuration();
+        result.bytes_copied += RtmpMediaPacket::GetBytesSerialized() - serialized;
+        for(auto &sink : sinks)
+        {
+            result.deliveries += sink->deliveries_;
+            result.wire_bytes += sink->wire_bytes_;
+            result.bytes_copied += sink->bytes_copied_;
+        }
+        result.deliveries -= deliveries;
+        result.wire_bytes -= wire_bytes;
+        result.bytes_copied -= bytes_copied;
+    }
+    return result;
+}
+
+void PrintResult(FILE* out, const char* name, const FanoutResult& result, uint32_t players, bool last)
+{
+    double viewer_seconds = (double)players * std::max<uint64_t>(result.media_ms, 1) / 1000.0;
+    double cpu_us_per_viewer_second = result.cpu_us / viewer_seconds;
+    fprintf(out, "  \"%s\": {\"frames\": %llu, \"deliveries\": %llu, \"wire_bytes\": %llu, \"bytes_copied\": %llu, "
+            "\"copied_bytes_per_delivery\": %.0f, \"copy_ratio\": %.3f,\n"
+            "    \"wall_ms\": %lld, \"cpu_ms\": %lld, \"cpu_ns_per_delivery\": %.0f, \"cpu_us_per_viewer_second\": %.2f, "
+            "\"viewers_per_core\": %.0f}%s\n",
+            name, (unsigned long long)result.frames, (unsigned long long)result.deliveries,
+            (unsigned long long)result.wire_bytes, (unsigned long long)result.bytes_copied,
+            result.deliveries > 0 ? (double)result.bytes_copied / result.deliveries : 0.0,
+            result.wire_bytes > 0 ? (double)result.bytes_copied / result.wire_bytes : 0.0,
+            (long long)(result.wall_us / 1000), (long long)(result.cpu_us / 1000),
+            result.deliveries > 0 ? result.cpu_us * 1000.0 / result.deliveries : 0.0,
+            cpu_us_per_viewer_second, cpu_us_per_viewer_second > 0 ? 1000000.0 / cpu_us_per_viewer_second : 0.0,
+            last ? "" : ",");
+}
+
+} // namespace
+
+bool RunFanoutBench(FILE* out, const FanoutBenchConfig& config)
+{
+    if(config.players == 0 || config.duration_s == 0)
+    {
+        return false;
+    }
+    BenchSource::Ptr source = config.flv_file.empty()
+        ? BenchSource::CreateSynthetic(config.video_kbps * 1000, config.fps, config.gop, config.audio_kbps * 1000)
+        : BenchSource::LoadFlv(config.flv_file);
+    if(!source || source->GetFrames().empty())
+    {
+        fprintf(stderr, "invalid media source\n");
+        return false;
+    }
+
+    int64_t duration_us = (int64_t)config.duration_s * 1000000;
+    FanoutResult shared = Run(*source, config, true, duration_us);
+    FanoutResult copy = Run(*source, config, false, duration_us);
+
+    fprintf(out, "{\n");
+    fprintf(out, "  \"config\": {\"mode\": \"fanout\", \"players\": %u, \"source\": \"%s\", \"source_bitrate\": %u, "
+            "\"chunk_size\": %u, \"cycle_ms\": %u},\n",
+            config.players, config.flv_file.empty() ? "synthetic" : config.flv_file.c_str(), source->GetBitrate(),
+            config.chunk_size, source->GetDuration());
+    PrintResult(out, "shared", shared, config.players, false);
+    PrintResult(out, "copy", copy, config.players, true);
+    fprintf(out, "}\n");
+    return true;
+}
@@ -0,0 +1,39 @@
+/**
+ * @file FanoutBench.h
+ * @brief 会话扇出基准：一条流分发给大量观看者，输出每个观看者的拷贝字节数与 CPU 开销。
+ *
+ * 在进程内单线程同步驱动 RtmpSession，不建立连接，分别测量两种观看者发送路径：
+ * shared 为当前路径，每条消息按 (chunk 大小, 消息流 ID) 分片一次，观看者把同一块缓冲区放入写队列；
+ * copy 为逐观看者分片的旧路径，每个观看者各自分片到新缓冲区后再以拷贝方式放入写队列。
+ * 写队列为每个观看者一个 BufferWriter，每条消息分发后清空，相当于内核已取走全部数据。
+ */
+
+#ifndef _FANOUTBENCH_H_
+#define _FANOUTBENCH_H_
+
+#include <cstdint>
+#include <cstdio>
+#include <string>
+
+/** 扇出基准参数 */
+struct FanoutBenchConfig
+{
+    uint32_t players = 1000;            ///< 观看者数
+    uint32_t video_kbps = 2000;         ///< 合成源的视频码率
+    uint32_t audio_kbps = 64;           ///< 合成源的音频码率，0 表示不带音频
+    uint32_t fps = 25;                  ///< 合成源的帧率
+    uint32_t gop = 50;                  ///< 合成源的 GOP 帧数
+    std::string flv_file;               ///< 循环的 FLV 文件，为空时使用合成源
+    uint32_t chunk_size = 4096;         ///< 观看者的 out chunk size
+    uint32_t duration_s = 10;           ///< 每种路径的测量时长（秒）
+};
+
+/**
+ * @brief 运行扇出基准并以 JSON 输出结果
+ * @param out 输出文件
+ * @param config 基准参数
+ * @return false 表示参数无效或媒体源无法读取
+ */
+bool RunFanoutBench(FILE* out, const FanoutBenchConfig& config);
+
+#endif // _FANOUTBENCH_H_
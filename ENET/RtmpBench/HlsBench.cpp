@@ -0,0 +1,216 @@
+/**
+ * @file HlsBench.cpp
+ * @brief 实现 HLS 打包基准。
+ *
+ * 各路径先送入序列头并预热一个循环周期，之后按循环周期计时：每帧封装一次，依次交给各流的打包器（或复用器）。
+ * CPU 开销取线程 CPU 时间，按流数与处理的媒体时长折算为每条流每秒媒体所需的 CPU 与单核可承担的流数。
+ */
+#include "HlsBench.h"
+#include "BenchSource.h"
+#include "BenchUtil.h"
+#include "HlsPackager.h"
+#include "RtmpMediaPacket.h"
+#include "TsMuxer.h"
+#include "rtmp.h"
+#include <algorithm>
+#include <vector>
+
+namespace {
+
+/** 一种打包路径的累计结果 */
+struct HlsResult
+{
+    uint64_t frames = 0;                        ///< 每条流处理的帧数之和
+    uint64_t input_bytes = 0;                   ///< 输入的 FLV 负载字节数
+    uint64_t ts_bytes = 0;                      ///< 输出的 TS 字节数（仅 ts 路径）
+    uint64_t buffered_bytes = 0;                ///< 结束时各打包器环形队列保留的字节数（仅 hls/llhls）
+    uint32_t playable_streams = 0;              ///< 结束时已生成播放列表的流数（仅 hls/llhls）
+    uint64_t media_ms = 0;                      ///< 每条流处理的媒体时长（毫秒）
+    int64_t wall_us = 0;
+    int64_t cpu_us = 0;
+};
+
+/** 一条流的复用器与输出缓冲区，每个关键帧处重新开始，与切片相同 */
+struct TsStream
+{
+    TsMuxer muxer;
+    std::string out;
+    uint64_t bytes = 0;                         ///< 已清空的输出字节数
+    uint64_t warmup_bytes = 0;                  ///< 预热结束时 out 中的字节数，不计入结果
+};
+
+/** 把一帧交给全部流的打包器 */
+void Package(std::vector<std::shared_ptr<HlsPackager>>& packagers, RtmpMediaPacket::Ptr packet)
+{
+    for(auto &packager : packagers)
+    {
+        packager->SendMediaPacket(packet);
+    }
+}
+
+/** 把一帧交给全部流的复用器 */
+void Mux(std::vector<std::unique_ptr<TsStream>>& streams, const BenchSource::Frame& frame, uint64_t timestamp)
+{
+    for(auto &stream : streams)
+    {
+        if(frame.type == RTMP_VIDEO)
+        {
+            if(frame.key_frame)
+            {
+                stream->bytes += stream->out.size();
+                stream->out.clear();
+                stream->muxer.WriteTables(stream->out);
+            }
+            stream->muxer.WriteVideo(frame.payload.get(), frame.size, timestamp, stream->out);
+        }
+        else
+        {
+            stream->muxer.WriteAudio(frame.payload.get(), frame.size, timestamp, stream->out);
+        }
+    }
+}
+
+/**
+ * @brief 运行一种打包路径：预热一个循环周期后按循环周期计时，直到累计墙上时间达到 duration_us
+ * @param part_ms 分片目标时长，-1 表示只用 TsMuxer 复用
+ */
+HlsResult Run(const BenchSource& source, const HlsBenchConfig& config, int32_t part_ms, int64_t duration_us)
+{
+    std::vector<std::shared_ptr<HlsPackager>> packagers;
+    std::vector<std::unique_ptr<TsStream>> streams;
+    const BenchSource::Frame& avc = source.GetAvcSequenceHeader();
+    const BenchSource::Frame& aac = source.GetAacSequenceHeader();
+    for(uint32_t i = 0; i < config.streams; i++)
+    {
+        if(part_ms < 0)
+        {
+            std::unique_ptr<TsStream> stream(new TsStream);
+            if(avc.size > 0)
+            {
+                stream->muxer.SetAvcSequenceHeader(avc.payload.get(), avc.size);
+            }
+            if(aac.size > 0)
+            {
+                stream->muxer.SetAacSequenceHeader(aac.payload.get(), aac.size);
+            }
+            streams.push_back(std::move(stream));
+        }
+        else
+        {
+            packagers.push_back(std::make_shared<HlsPackager>("/bench/hls" + std::to_string(i), config.segment_ms,
+                                                              (uint32_t)part_ms, config.window));
+        }
+    }
+    if(avc.size > 0)
+    {
+        Package(packagers, std::make_shared<RtmpMediaPacket>(RTMP_AVC_SEQUENCE_HEADER, 0, avc.payload, avc.size));
+    }
+    if(aac.size > 0)
+    {
+        Package(packagers, std::make_shared<RtmpMediaPacket>(RTMP_AAC_SEQUENCE_HEADER, 0, aac.payload, aac.size));
+    }
+
+    HlsResult result;
+    uint64_t loop_offset = 0;
+    for(bool warmup = true; warmup || result.wall_us < duration_us; warmup = false)
+    {
+        int64_t wall = GetSteadyUs();
+        int64_t cpu = GetThreadCpuUs();
+        for(auto &frame : source.GetFrames())
+        {
+            uint64_t timestamp = loop_offset + frame.timestamp;
+            if(part_ms < 0)
+            {
+                Mux(streams, frame, timestamp);
+            }
+            else
+            {
+                Package(packagers, std::make_shared<RtmpMediaPacket>(frame.type, timestamp, frame.payload, frame.size));
+            }
+        }
+        int64_t cpu_us = GetThreadCpuUs() - cpu;
+        int64_t wall_us = GetSteadyUs() - wall;
+        loop_offset += source.GetDuration();
+        if(warmup)
+        {
+            for(auto &stream : streams)
+            {
+                stream->bytes = 0;
+                stream->warmup_bytes = stream->out.size();
+            }
+            continue;
+        }
+        result.cpu_us += cpu_us;
+        result.wall_us += wall_us;
+        result.media_ms += source.GetDuration();
+        for(auto &frame : source.GetFrames())
+        {
+            result.input_bytes += (uint64_t)frame.size * config.streams;
+        }
+        result.frames += (uint64_t)source.GetFrames().size() * config.streams;
+    }
+
+    for(auto &stream : streams)
+    {
+        result.ts_bytes += stream->bytes + stream->out.size() - stream->warmup_bytes;
+    }
+    for(auto &packager : packagers)
+    {
+        HlsPackager::Data playlist;
+        result.playable_streams += packager->GetPlaylist(playlist) ? 1 : 0;
+        result.buffered_bytes += packager->GetBufferedBytes();
+    }
+    return result;
+}
+
+void PrintResult(FILE* out, const char* name, const HlsResult& result, uint32_t streams, bool last)
+{
+    double stream_seconds = (double)streams * std::max<uint64_t>(result.media_ms, 1) / 1000.0;
+    double cpu_us_per_stream_second = result.cpu_us / stream_seconds;
+    fprintf(out, "  \"%s\": {\"frames\": %llu, \"input_bytes\": %llu, \"ts_bytes\": %llu, \"ts_overhead_percent\": %.1f, "
+            "\"buffered_bytes\": %llu, \"playable_streams\": %u,\n"
+            "    \"wall_ms\": %lld, \"cpu_ms\": %lld, \"ns_per_frame\": %.0f, \"cpu_us_per_stream_second\": %.1f, "
+            "\"streams_per_core\": %.0f}%s\n",
+            name, (unsigned long long)result.frames, (unsigned long long)result.input_bytes,
+            (unsigned long long)result.ts_bytes,
+            result.ts_bytes > 0 && result.input_bytes > 0 ? (result.ts_bytes * 100.0 / result.input_bytes - 100.0) : 0.0,
+            (unsigned long long)result.buffered_bytes, result.playable_streams,
+            (long long)(result.wall_us / 1000), (long long)(result.cpu_us / 1000),
+            result.frames > 0 ? result.cpu_us * 1000.0 / result.frames : 0.0,
+            cpu_us_per_stream_second, cpu_us_per_stream_second > 0 ? 1000000.0 / cpu_us_per_stream_second : 0.0,
+            last ? "" : ",");
+}
+
+} // namespace
+
+bool RunHlsBench(FILE* out, const HlsBenchConfig& config)
+{
+    if(config.streams == 0 || config.duration_s == 0)
+    {
+        return false;
+    }
+    BenchSource::Ptr source = config.flv_file.empty()
+        ? BenchSource::CreateSynthetic(config.video_kbps * 1000, config.fps, config.gop, config.audio_kbps * 1000)
+        : BenchSource::LoadFlv(config.flv_file);
+    if(!source || source->GetFrames().empty())
+    {
+        fprintf(stderr, "invalid media source\n");
+        return false;
+    }
+
+    int64_t duration_us = (int64_t)config.duration_s * 1000000;
+    HlsResult ts = Run(*source, config, -1, duration_us);
+    HlsResult hls = Run(*source, config, 0, duration_us);
+    HlsResult llhls = Run(*source, config, (int32_t)config.part_ms, duration_us);
+
+    fprintf(out, "{\n");
+    fprintf(out, "  \"config\": {\"mode\": \"hls\", \"streams\": %u, \"source\": \"%s\", \"source_bitrate\": %u, "
+            "\"segment_ms\": %u, \"part_ms\": %u, \"window\": %u, \"cycle_ms\": %u},\n",
+            config.streams, config.flv_file.empty() ? "synthetic" : config.flv_file.c_str(), source->GetBitrate(),
+            config.segment_ms, config.part_ms, config.window, source->GetDuration());
+    PrintResult(out, "ts", ts, config.streams, false);
+    PrintResult(out, "hls", hls, config.streams, false);
+    PrintResult(out, "llhls", llhls, config.streams, true);
+    fprintf(out, "}\n");
+    return true;
+}
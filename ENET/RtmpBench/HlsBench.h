@@ -0,0 +1,41 @@
+/**
+ * @file HlsBench.h
+ * @brief HLS 打包基准：多条流各由一个 HlsPackager 切片，输出每条流的 CPU 开销与单核可承担的流数。
+ *
+ * 在进程内单线程同步驱动，不建立连接，与 RtmpSession 分发给打包器的方式相同：每帧封装为一个 RtmpMediaPacket，
+ * 各流的打包器依次复用。分别测量三种路径：
+ * ts 只用 TsMuxer 把负载复用为 MPEG-TS（不切片），hls 按关键帧切分切片，llhls 另按 PART-TARGET 切分分片。
+ * 切片在打包器内部的环形队列中淘汰，输出同时给出各打包器保留的总字节数。
+ */
+
+#ifndef _HLSBENCH_H_
+#define _HLSBENCH_H_
+
+#include <cstdint>
+#include <cstdio>
+#include <string>
+
+/** HLS 打包基准参数 */
+struct HlsBenchConfig
+{
+    uint32_t streams = 100;             ///< 流数，每条流一个打包器
+    uint32_t video_kbps = 2000;         ///< 合成源的视频码率
+    uint32_t audio_kbps = 64;           ///< 合成源的音频码率，0 表示不带音频
+    uint32_t fps = 25;                  ///< 合成源的帧率
+    uint32_t gop = 50;                  ///< 合成源的 GOP 帧数
+    std::string flv_file;               ///< 循环的 FLV 文件，为空时使用合成源
+    uint32_t segment_ms = 2000;         ///< 切片目标时长（毫秒），与 RtmpSvr 的 HlsServer::SetSegment 相同
+    uint32_t part_ms = 500;             ///< llhls 的分片目标时长（毫秒）
+    uint32_t window = 6;                ///< 播放列表中的切片数
+    uint32_t duration_s = 10;           ///< 每种路径的测量时长（秒）
+};
+
+/**
+ * @brief 运行 HLS 打包基准并以 JSON 输出结果
+ * @param out 输出文件
+ * @param config 基准参数
+ * @return false 表示参数无效或媒体源无法读取
+ */
+bool RunHlsBench(FILE* out, const HlsBenchConfig& config);
+
+#endif // _HLSBENCH_H_
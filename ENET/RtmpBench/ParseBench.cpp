@@ -0,0 +1,289 @@
+/**
+ * @file ParseBench.cpp
+ * @brief 实现 chunk 解析吞吐基准。
+ *
+ * 只解析：每轮先把各流一个循环周期的字节读入 BufferReader（不计时），再计时解析全部字节；
+ * 读取加解析：每次向 socketpair 写入至多 64KB（不计时），计时读取并解析当前可读的字节，与连接的读回调相同。
+ * 两种测量都用墙上时间与线程 CPU 时间计算吞吐，基准在单线程中同步运行。
+ */
+#include "ParseBench.h"
+#include "BenchSource.h"
+#include "BenchUtil.h"
+#include "RtmpChunk.h"
+#include "rtmp.h"
+#include "../EdoyunNet/BufferPool.h"
+#include <algorithm>
+#include <fcntl.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#include <vector>
+
+/** 读取加解析时每次写入 socketpair 的字节数 */
+static const uint32_t kWriteBytes = 64 * 1024;
+/** 一个循环周期的字节流上限，BufferReader 最多缓存约 100MB */
+static const uint64_t kMaxCycleBytes = 64ULL * 1024 * 1024;
+
+namespace {
+
+/** 一条流：一个循环周期的 chunk 字节流、重放用的 socketpair 与解析器 */
+struct ParseStream
+{
+    const std::string* bytes = nullptr;
+    int fds[2] = {-1, -1};                      ///< [0] 写入端，[1] 读取端（非阻塞）
+    RtmpChunk chunk;
+    BufferReader reader{kWriteBytes};
+    std::vector<std::shared_ptr<char>> gop;     ///< 保留到下一个关键帧的负载
+
+    ~ParseStream()
+    {
+        for(int fd : fds)
+        {
+            if(fd >= 0)
+            {
+                close(fd);
+            }
+        }
+    }
+};
+
+/** 一种测量的累计结果 */
+struct ParseResult
+{
+    uint64_t bytes = 0;
+    uint64_t messages = 0;
+    uint64_t payload_bytes = 0;                 ///< 音视频负载字节数
+    uint64_t block_bytes = 0;                   ///< 音视频负载所在块的字节数
+    int64_t wall_us = 0;
+    int64_t cpu_us = 0;
+};
+
+/** 按推流端的发送状态把媒体源的一个循环周期分片为字节流，各 csid 的第一条消息为 fmt0，可以重复重放 */
+std::string EncodeCycle(const BenchSource& source, uint32_t chunk_size)
+{
+    RtmpChunk sender;
+    sender.SetOutChunkSize(chunk_size);
+    std::string bytes;
+    std::vector<char> buffer;
+    auto append = [&](const BenchSource::Frame& frame){
+        if(frame.size == 0)
+        {
+            return;
+        }
+        RtmpMessage rtmp_msg;
+        rtmp_msg.type_id = frame.type;
+        rtmp_msg.timestamp = frame.timestamp;
+        rtmp_msg._timestamp = frame.timestamp;
+        rtmp_msg.stream_id = 1;
+        rtmp_msg.playload = frame.payload;
+        rtmp_msg.lenght = frame.size;
+        uint32_t csid = frame.type == RTMP_AUDIO ? RTMP_CHUNK_AUDIO_ID : RTMP_CHUNK_VIDEO_ID;
+        buffer.resize(RtmpChunk::GetChunkCapacity(frame.size, chunk_size));
+        int size = sender.CreateChunk(csid, rtmp_msg, buffer.data(), (uint32_t)buffer.size());
+        if(size > 0)
+        {
+            bytes.append(buffer.data(), size);
+        }
+    };
+    append(source.GetAvcSequenceHeader());
+    append(source.GetAacSequenceHeader());
+    for(auto &frame : source.GetFrames())
+    {
+        append(frame);
+    }
+    return bytes;
+}
+
+/** 统计一条完整消息，音视频负载保留到下一个关键帧 */
+void Collect(ParseStream& stream, RtmpMessage& rtmp_msg, ParseResult& result)
+{
+    result.messages++;
+    if(rtmp_msg.type_id != RTMP_VIDEO && rtmp_msg.type_id != RTMP_AUDIO)
+    {
+        return;
+    }
+    result.payload_bytes += rtmp_msg.lenght;
+    result.block_bytes += BufferPool::GetBlockSize(rtmp_msg.lenght);
+    const char* payload = rtmp_msg.playload.get();
+    if(rtmp_msg.type_id == RTMP_VIDEO && rtmp_msg.lenght > 1 && (payload[0] >> 4) == 1 && payload[1] == 1)
+    {
+        stream.gop.clear();
+    }
+    stream.gop.push_back(rtmp_msg.playload);
+}
+
+/** 解析 reader 中的全部完整 chunk */
+bool ParseAll(ParseStream& stream, ParseResult& result)
+{
+    while(stream.reader.ReadableBytes() > 0)
+    {
+        RtmpMessage rtmp_msg;
+        int ret = stream.chunk.Parse(stream.reader, rtmp_msg);
+        if(ret < 0)
+        {
+            return false;
+        }
+        result.bytes += ret;
+        if(rtmp_msg.IsCompleted())
+        {
+            Collect(stream, rtmp_msg, result);
+        }
+        if(ret == 0)
+        {
+            break;
+        }
+    }
+    return true;
+}
+
+/** 经 socketpair 把一个循环周期的字节全部读入 reader（不计时） */
+void Load(ParseStream& stream)
+{
+    const std::string& bytes = *stream.bytes;
+    size_t written = 0;
+    while(written < bytes.size())
+    {
+        ssize_t size = write(stream.fds[0], bytes.data() + written, std::min<size_t>(bytes.size() - written, kWriteBytes));
+        if(size > 0)
+        {
+            written += size;
+        }
+        while(stream.reader.Read(stream.fds[1]) > 0)
+        {
+        }
+    }
+}
+
+/** 只解析：每轮先读入各流一个周期的字节，再计时解析 */
+bool RunParseOnly(std::vector<std::unique_ptr<ParseStream>>& streams, int64_t duration_us, ParseResult& result)
+{
+    while(result.wall_us < duration_us)
+    {
+        for(auto &stream : streams)
+        {
+            Load(*stream);
+        }
+        int64_t wall = GetSteadyUs();
+        int64_t cpu = GetThreadCpuUs();
+        for(auto &stream : streams)
+        {
+            if(!ParseAll(*stream, result))
+            {
+                return false;
+            }
+        }
+        result.cpu_us += GetThreadCpuUs() - cpu;
+        result.wall_us += GetSteadyUs() - wall;
+    }
+    return true;
+}
+
+/** 读取加解析：轮流向各流写入至多 64KB，计时读取并解析 */
+bool RunRecvParse(std::vector<std::unique_ptr<ParseStream>>& streams, int64_t duration_us, ParseResult& result)
+{
+    std::vector<size_t> positions(streams.size(), 0);
+    while(result.wall_us < duration_us)
+    {
+        for(size_t i = 0; i < streams.size(); i++)
+        {
+            ParseStream& stream = *streams[i];
+            const std::string& bytes = *stream.bytes;
+            ssize_t size = write(stream.fds[0], bytes.data() + positions[i], std::min<size_t>(bytes.size() - positions[i], kWriteBytes));
+            if(size > 0)
+            {
+                positions[i] = (positions[i] + size) % bytes.size();
+            }
+
+            int64_t wall = GetSteadyUs();
+            int64_t cpu = GetThreadCpuUs();
+            while(stream.reader.Read(stream.fds[1]) > 0)
+            {
+                if(!ParseAll(stream, result))
+                {
+                    return false;
+                }
+            }
+            result.cpu_us += GetThreadCpuUs() - cpu;
+            result.wall_us += GetSteadyUs() - wall;
+        }
+    }
+    return true;
+}
+
+void PrintResult(FILE* out, const char* name, const ParseResult& result, bool last)
+{
+    double wall_s = std::max<int64_t>(result.wall_us, 1) / 1000000.0;
+    double cpu_s = std::max<int64_t>(result.cpu_us, 1) / 1000000.0;
+    fprintf(out, "  \"%s\": {\"bytes\": %llu, \"messages\": %llu, \"wall_ms\": %lld, \"cpu_ms\": %lld, "
+            "\"gb_per_second\": %.3f, \"gb_per_cpu_second\": %.3f, \"messages_per_second\": %.0f, \"ns_per_message\": %.1f}%s\n",
+            name, (unsigned long long)result.bytes, (unsigned long long)result.messages,
+            (long long)(result.wall_us / 1000), (long long)(result.cpu_us / 1000),
+            result.bytes / wall_s / 1e9, result.bytes / cpu_s / 1e9, result.messages / wall_s,
+            result.messages > 0 ? result.cpu_us * 1000.0 / result.messages : 0.0, last ? "" : ",");
+}
+
+} // namespace
+
+bool RunParseBench(FILE* out, const ParseBenchConfig& config)
+{
+    if(config.streams == 0 || config.duration_s == 0)
+    {
+        return false;
+    }
+    BenchSource::Ptr source = config.flv_file.empty()
+        ? BenchSource::CreateSynthetic(config.video_kbps * 1000, config.fps, config.gop, config.audio_kbps * 1000)
+        : BenchSource::LoadFlv(config.flv_file);
+    if(!source)
+    {
+        fprintf(stderr, "invalid media source\n");
+        return false;
+    }
+    std::string cycle = EncodeCycle(*source, config.chunk_size);
+    if(cycle.empty() || cycle.size() > kMaxCycleBytes)
+    {
+        fprintf(stderr, "invalid cycle size %zu\n", cycle.size());
+        return false;
+    }
+
+    std::vector<std::unique_ptr<ParseStream>> streams;
+    for(uint32_t i = 0; i < config.streams; i++)
+    {
+        std::unique_ptr<ParseStream> stream(new ParseStream);
+        stream->bytes = &cycle;
+        stream->chunk.SetInChunkSize(config.chunk_size);
+        if(socketpair(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0, stream->fds) < 0
+           || fcntl(stream->fds[1], F_SETFL, O_NONBLOCK) < 0)
+        {
+            fprintf(stderr, "socketpair failed\n");
+            return false;
+        }
+        streams.push_back(std::move(stream));
+    }
+
+    // 预热一轮，缓冲区池与 BufferReader 达到稳定大小
+    ParseResult warmup, parse_only, recv_parse;
+    int64_t duration_us = (int64_t)config.duration_s * 1000000;
+    if(!RunParseOnly(streams, 1, warmup)
+       || !RunParseOnly(streams, duration_us, parse_only)
+       || !RunRecvParse(streams, duration_us, recv_parse))
+    {
+        fprintf(stderr, "parse failed\n");
+        return false;
+    }
+
+    fprintf(out, "{\n");
+    fprintf(out, "  \"config\": {\"mode\": \"parse\", \"streams\": %u, \"source\": \"%s\", \"source_bitrate\": %u, "
+            "\"chunk_size\": %u, \"cycle_bytes\": %zu, \"cycle_ms\": %u},\n",
+            config.streams, config.flv_file.empty() ? "synthetic" : config.flv_file.c_str(), source->GetBitrate(),
+            config.chunk_size, cycle.size(), source->GetDuration());
+    PrintResult(out, "parse", parse_only, false);
+    PrintResult(out, "recv_parse", recv_parse, false);
+    uint64_t payload_bytes = parse_only.payload_bytes + recv_parse.payload_bytes;
+    uint64_t block_bytes = parse_only.block_bytes + recv_parse.block_bytes;
+    fprintf(out, "  \"buffer_pool\": {\"payload_bytes\": %llu, \"block_bytes\": %llu, \"block_overhead_percent\": %.1f, "
+            "\"pooled_bytes\": %llu}\n",
+            (unsigned long long)payload_bytes, (unsigned long long)block_bytes,
+            payload_bytes > 0 ? (block_bytes - payload_bytes) * 100.0 / payload_bytes : 0.0,
+            (unsigned long long)BufferPool::GetTotalPooledBytes());
+    fprintf(out, "}\n");
+    return true;
+}
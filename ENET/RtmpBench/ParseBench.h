@@ -0,0 +1,39 @@
+/**
+ * @file ParseBench.h
+ * @brief Chunk 解析吞吐基准：把推流端的 chunk 字节流重放给 RtmpChunk::Parse，输出 GB/s。
+ *
+ * 字节流由 RtmpChunk 按推流端的发送状态分片（与 BenchPublisher 相同，fmt0~3 头部），媒体源为合成帧或 FLV 文件；
+ * 每条流一个解析器，重放前经 socketpair 把一个循环周期的字节读入 BufferReader，
+ * 分别测量只解析（不含读取）与读取加解析（BufferReader::Read 的 recv 与 Parse）两种吞吐。
+ * 解析出的音视频负载保留到下一个关键帧，与 GOP 缓存持有负载的方式相同，缓冲区池的复用与此一致。
+ */
+
+#ifndef _PARSEBENCH_H_
+#define _PARSEBENCH_H_
+
+#include <cstdint>
+#include <cstdio>
+#include <string>
+
+/** 解析基准参数 */
+struct ParseBenchConfig
+{
+    uint32_t streams = 1;               ///< 流数，每条流一个 RtmpChunk
+    uint32_t video_kbps = 2000;         ///< 合成源的视频码率
+    uint32_t audio_kbps = 64;           ///< 合成源的音频码率，0 表示不带音频
+    uint32_t fps = 25;                  ///< 合成源的帧率
+    uint32_t gop = 50;                  ///< 合成源的 GOP 帧数
+    std::string flv_file;               ///< 循环的 FLV 文件，为空时使用合成源
+    uint32_t chunk_size = 4096;         ///< 推流端的 chunk 大小
+    uint32_t duration_s = 10;           ///< 每种测量的时长（秒）
+};
+
+/**
+ * @brief 运行解析基准并以 JSON 输出结果
+ * @param out 输出文件
+ * @param config 基准参数
+ * @return false 表示参数无效、媒体源无法读取或解析出错
+ */
+bool RunParseBench(FILE* out, const ParseBenchConfig& config);
+
+#endif // _PARSEBENCH_H_
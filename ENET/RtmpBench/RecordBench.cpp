@@ -0,0 +1,241 @@
+/**
+ * @file RecordBench.cpp
+ * @brief 实现录制吞吐基准。
+ *
+ * 主线程先下发序列头，之后按媒体时间实时分发：每帧到期时封装一个 RtmpMediaPacket，依次交给各录制器入队，
+ * 每 100 毫秒采样一次各录制器的队列深度。写线程的主循环与 RecordService::Run 相同。
+ * 入队开销取主线程的线程 CPU 时间（休眠不计），写盘开销取各写线程的线程 CPU 时间之和。
+ */
+#include "RecordBench.h"
+#include "BenchSource.h"
+#include "BenchUtil.h"
+#include "FlvRecorder.h"
+#include "RtmpMediaPacket.h"
+#include "rtmp.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstring>
+#include <ftw.h>
+#include <functional>
+#include <thread>
+#include <vector>
+
+/** 写线程每轮对单个录制器最多处理的消息数，与 RecordService 相同 */
+static const uint32_t kMaxMessagesPerRound = 64;
+/** 写线程空闲时的休眠时长（毫秒），与 RecordService 相同 */
+static const uint32_t kIdleWaitMs = 10;
+/** 队列深度的采样间隔（毫秒） */
+static const uint32_t kSampleIntervalMs = 100;
+
+namespace {
+
+/** 一个写线程及其负责的录制器 */
+struct RecordWriter
+{
+    std::thread thread;
+    std::vector<FlvRecorder::Ptr> recorders;
+    int64_t cpu_us = 0;                         ///< 线程退出时写入
+};
+
+uint32_t g_flv_files = 0;                       ///< CountFile 统计到的 FLV 文件数
+
+/** 统计目录下的 FLV 文件数 */
+int CountFile(const char* path, const struct stat*, int type, struct FTW*)
+{
+    size_t len = strlen(path);
+    if(type == FTW_F && len > 4 && strcmp(path + len - 4, ".flv") == 0)
+    {
+        g_flv_files++;
+    }
+    return 0;
+}
+
+/** 删除目录下的文件与子目录（FTW_DEPTH 先访问子项） */
+int RemoveFile(const char* path, const struct stat*, int, struct FTW*)
+{
+    remove(path);
+    return 0;
+}
+
+/** 写线程主循环：写完全部录制器后退出 */
+void RunWriter(RecordWriter* writer)
+{
+    int64_t cpu = GetThreadCpuUs();
+    while(!writer->recorders.empty())
+    {
+        bool busy = false;
+        for(auto iter = writer->recorders.begin(); iter != writer->recorders.end(); )
+        {
+            if((*iter)->Process(kMaxMessagesPerRound))
+            {
+                busy = true;
+            }
+            if((*iter)->IsFinished())
+            {
+                iter = writer->recorders.erase(iter);
+            }
+            else
+            {
+                iter++;
+            }
+        }
+        if(!busy)
+        {
+            std::this_thread::sleep_for(std::chrono::milliseconds(kIdleWaitMs));
+        }
+    }
+    writer->cpu_us = GetThreadCpuUs() - cpu;
+}
+
+/** 把一条消息交给全部录制器入队 */
+void Record(std::vector<FlvRecorder::Ptr>& recorders, RtmpMediaPacket::Ptr packet)
+{
+    for(auto &recorder : recorders)
+    {
+        recorder->SendMediaPacket(packet);
+    }
+}
+
+} // namespace
+
+bool RunRecordBench(FILE* out, const RecordBenchConfig& config)
+{
+    if(config.streams == 0 || config.writers == 0 || config.duration_s == 0 || config.dir.empty())
+    {
+        return false;
+    }
+    BenchSource::Ptr source = config.flv_file.empty()
+        ? BenchSource::CreateSynthetic(config.video_kbps * 1000, config.fps, config.gop, config.audio_kbps * 1000)
+        : BenchSource::LoadFlv(config.flv_file);
+    if(!source || source->GetFrames().empty())
+    {
+        fprintf(stderr, "invalid media source\n");
+        return false;
+    }
+
+    std::string record_dir = config.dir + "/record";
+    nftw(record_dir.c_str(), RemoveFile, 16, FTW_DEPTH | FTW_PHYS);   // 清理上次运行残留的文件
+
+    std::vector<FlvRecorder::Ptr> recorders;
+    std::vector<std::unique_ptr<RecordWriter>> writers;
+    for(uint32_t i = 0; i < config.writers; i++)
+    {
+        writers.emplace_back(new RecordWriter);
+    }
+    for(uint32_t i = 0; i < config.streams; i++)
+    {
+        std::string stream_path = "/record/" + std::to_string(i);
+        FlvRecorder::Ptr recorder = std::make_shared<FlvRecorder>(stream_path, config.dir, config.max_duration_ms, 0,
+                                                                  config.queue_size, false);
+        recorders.push_back(recorder);
+        writers[std::hash<std::string>()(stream_path) % writers.size()]->recorders.push_back(recorder);
+    }
+    for(auto &writer : writers)
+    {
+        RecordWriter* w = writer.get();
+        w->thread = std::thread([w](){
+            RunWriter(w);
+        });
+    }
+
+    const BenchSource::Frame& avc = source->GetAvcSequenceHeader();
+    const BenchSource::Frame& aac = source->GetAacSequenceHeader();
+    if(avc.size > 0)
+    {
+        Record(recorders, std::make_shared<RtmpMediaPacket>(RTMP_AVC_SEQUENCE_HEADER, 0, avc.payload, avc.size));
+    }
+    if(aac.size > 0)
+    {
+        Record(recorders, std::make_shared<RtmpMediaPacket>(RTMP_AAC_SEQUENCE_HEADER, 0, aac.payload, aac.size));
+    }
+
+    // 按媒体时间实时分发，直到达到测量时长
+    uint64_t messages = 0, offered_bytes = 0;
+    uint32_t max_queued = 0;
+    int64_t start = GetSteadyUs();
+    int64_t next_sample = start;
+    int64_t cpu = GetThreadCpuUs();
+    uint64_t loop_offset = 0;
+    bool done = false;
+    while(!done)
+    {
+        for(auto &frame : source->GetFrames())
+        {
+            uint64_t timestamp = loop_offset + frame.timestamp;
+            if(timestamp >= (uint64_t)config.duration_s * 1000)
+            {
+                done = true;
+                break;
+            }
+            int64_t due = start + (int64_t)timestamp * 1000;
+            int64_t now = GetSteadyUs();
+            if(due > now)
+            {
+                std::this_thread::sleep_for(std::chrono::microseconds(due - now));
+            }
+            Record(recorders, std::make_shared<RtmpMediaPacket>(frame.type, timestamp, frame.payload, frame.size));
+            messages += config.streams;
+            offered_bytes += (uint64_t)frame.size * config.streams;
+
+            if(GetSteadyUs() >= next_sample)
+            {
+                next_sample += kSampleIntervalMs * 1000;
+                for(auto &recorder : recorders)
+                {
+                    max_queued = std::max(max_queued, recorder->GetQueueSize());
+                }
+            }
+        }
+        loop_offset += source->GetDuration();
+    }
+    int64_t enqueue_cpu_us = GetThreadCpuUs() - cpu;
+    int64_t wall_us = GetSteadyUs() - start;
+
+    // 停止录制器，写线程写完积压后退出
+    for(auto &recorder : recorders)
+    {
+        recorder->Stop();
+    }
+    int64_t drain_start = GetSteadyUs();
+    int64_t writer_cpu_us = 0;
+    for(auto &writer : writers)
+    {
+        writer->thread.join();
+        writer_cpu_us += writer->cpu_us;
+    }
+    int64_t drain_us = GetSteadyUs() - drain_start;
+
+    uint64_t written_bytes = 0, dropped = 0, errors = 0;
+    for(auto &recorder : recorders)
+    {
+        written_bytes += recorder->GetWrittenBytes();
+        dropped += recorder->GetDroppedMessages();
+        errors += recorder->GetWriteErrors();
+    }
+    recorders.clear();
+    g_flv_files = 0;
+    nftw(record_dir.c_str(), CountFile, 16, FTW_PHYS);
+    nftw(record_dir.c_str(), RemoveFile, 16, FTW_DEPTH | FTW_PHYS);
+
+    double wall_s = std::max<int64_t>(wall_us, 1) / 1000000.0;
+    double writer_cpu_s = std::max<int64_t>(writer_cpu_us, 1) / 1000000.0;
+    fprintf(out, "{\n");
+    fprintf(out, "  \"config\": {\"mode\": \"record\", \"streams\": %u, \"writers\": %u, \"dir\": \"%s\", \"source\": \"%s\", "
+            "\"source_bitrate\": %u, \"queue_size\": %u, \"rotate_ms\": %u, \"duration_ms\": %lld},\n",
+            config.streams, config.writers, config.dir.c_str(), config.flv_file.empty() ? "synthetic" : config.flv_file.c_str(),
+            source->GetBitrate(), config.queue_size, config.max_duration_ms, (long long)(wall_us / 1000));
+    fprintf(out, "  \"record\": {\"messages\": %llu, \"offered_bytes\": %llu, \"written_bytes\": %llu, \"written_mb_per_second\": %.1f, "
+            "\"dropped_messages\": %llu, \"drop_percent\": %.3f, \"write_errors\": %llu, \"flv_files\": %u,\n"
+            "    \"max_queued_messages\": %u, \"drain_ms\": %lld},\n",
+            (unsigned long long)messages, (unsigned long long)offered_bytes, (unsigned long long)written_bytes,
+            written_bytes / wall_s / 1e6, (unsigned long long)dropped, messages > 0 ? dropped * 100.0 / messages : 0.0,
+            (unsigned long long)errors, g_flv_files, max_queued, (long long)(drain_us / 1000));
+    fprintf(out, "  \"cpu\": {\"enqueue_ms\": %lld, \"enqueue_ns_per_message\": %.0f, \"writer_ms\": %lld, "
+            "\"writer_core_percent\": %.1f, \"writer_mb_per_cpu_second\": %.0f, \"streams_per_writer_core\": %.0f}\n",
+            (long long)(enqueue_cpu_us / 1000), messages > 0 ? enqueue_cpu_us * 1000.0 / messages : 0.0,
+            (long long)(writer_cpu_us / 1000), writer_cpu_us * 100.0 / std::max<int64_t>(wall_us, 1),
+            written_bytes / writer_cpu_s / 1e6, config.streams * wall_s / writer_cpu_s);
+    fprintf(out, "}\n");
+    return true;
+}
@@ -0,0 +1,41 @@
+/**
+ * @file RecordBench.h
+ * @brief 录制吞吐基准：多条流同时经 FlvRecorder 写入（通常为 tmpfs 的）目录，输出写入吞吐、丢帧与写线程 CPU。
+ *
+ * 在进程内运行，不建立连接：主线程相当于推流所在的事件循环，按媒体时间实时地把每帧封装一次交给全部录制器入队；
+ * 写线程池与 RecordService 相同，每条流按路径哈希固定到一个写线程，轮询各录制器的队列并写盘。
+ * 测量结束后停止全部录制器，等待写线程写完积压；录制的文件在统计后删除。
+ */
+
+#ifndef _RECORDBENCH_H_
+#define _RECORDBENCH_H_
+
+#include <cstdint>
+#include <cstdio>
+#include <string>
+
+/** 录制基准参数 */
+struct RecordBenchConfig
+{
+    uint32_t streams = 500;             ///< 同时录制的流数
+    uint32_t writers = 1;               ///< 写线程数
+    uint32_t video_kbps = 2000;         ///< 合成源的视频码率
+    uint32_t audio_kbps = 64;           ///< 合成源的音频码率，0 表示不带音频
+    uint32_t fps = 25;                  ///< 合成源的帧率
+    uint32_t gop = 50;                  ///< 合成源的 GOP 帧数
+    std::string flv_file;               ///< 循环的 FLV 文件，为空时使用合成源
+    std::string dir = "/dev/shm/rtmpbench"; ///< 录制根目录，文件写入 dir/record/<流序号>/
+    uint32_t queue_size = 1024;         ///< 每条流的待写队列长度，与 RecordService 的默认值相同
+    uint32_t max_duration_ms = 10000;   ///< 文件切分时长（毫秒）
+    uint32_t duration_s = 10;           ///< 测量时长（秒）
+};
+
+/**
+ * @brief 运行录制基准并以 JSON 输出结果
+ * @param out 输出文件
+ * @param config 基准参数
+ * @return false 表示参数无效或媒体源无法读取
+ */
+bool RunRecordBench(FILE* out, const RecordBenchConfig& config);
+
+#endif // _RECORDBENCH_H_
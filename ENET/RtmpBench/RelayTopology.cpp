@@ -0,0 +1,106 @@
+/**
+ * @file RelayTopology.cpp
+ * @brief 实现回环多节点拓扑。
+ */
+#include "RelayTopology.h"
+#include <cstdio>
+
+RelayTopology::Ptr RelayTopology::CreateEdge(const std::string& ip, uint16_t base_port, uint32_t edges, uint32_t idle_grace_ms)
+{
+    Ptr topology(new RelayTopology);
+    if(!topology->AddNode(ip, base_port))
+    {
+        return nullptr;
+    }
+    std::vector<std::string> origins = { ip + ":" + std::to_string(base_port) };
+    for(uint32_t i = 1; i <= edges; i++)
+    {
+        if(!topology->AddNode(ip, (uint16_t)(base_port + i)))
+        {
+            return nullptr;
+        }
+        topology->nodes_.back().server->SetEdgeOrigins(origins, idle_grace_ms);
+        topology->play_ports_.push_back((uint16_t)(base_port + i));
+    }
+    return topology;
+}
+
+RelayTopology::Ptr RelayTopology::CreateForward(const std::string& ip, uint16_t base_port, uint32_t targets)
+{
+    Ptr topology(new RelayTopology);
+    if(!topology->AddNode(ip, base_port))
+    {
+        return nullptr;
+    }
+    std::vector<std::string> addresses;
+    for(uint32_t i = 1; i <= targets; i++)
+    {
+        if(!topology->AddNode(ip, (uint16_t)(base_port + i)))
+        {
+            return nullptr;
+        }
+        addresses.push_back(ip + ":" + std::to_string(base_port + i));
+        topology->play_ports_.push_back((uint16_t)(base_port + i));
+    }
+    Node& ingest = topology->nodes_.front();
+    topology->forward_service_ = ForwardService::Create(ingest.loop.get(), ingest.server, addresses);
+    return topology;
+}
+
+RelayTopology::~RelayTopology()
+{
+    forward_service_.reset();
+    for(auto &node : nodes_)
+    {
+        node.server->Stop();
+    }
+    for(auto &node : nodes_)
+    {
+        node.server.reset();
+        node.loop.reset();
+    }
+}
+
+bool RelayTopology::AddNode(const std::string& ip, uint16_t port)
+{
+    Node node;
+    node.loop.reset(new EventLoop(1));
+    node.server = RtmpServer::Create(node.loop.get());
+    if(!node.server->Start(ip, port))
+    {
+        fprintf(stderr, "start node %s:%u failed\n", ip.c_str(), port);
+        return false;
+    }
+    nodes_.push_back(std::move(node));
+    return true;
+}
+
+int RelayTopology::GetUpstreams(const std::vector<std::string>& stream_paths)
+{
+    int upstreams = 0;
+    for(auto &stream_path : stream_paths)
+    {
+        RtmpSession::Ptr session = nodes_.front().server->FindSession(stream_path);
+        upstreams += session ? session->GetPlayers() : 0;
+    }
+    return upstreams;
+}
+
+int RelayTopology::GetForwardedStreams(const std::vector<std::string>& stream_paths)
+{
+    int forwarded = 0;
+    for(size_t i = 1; i < nodes_.size(); i++)
+    {
+        for(auto &stream_path : stream_paths)
+        {
+            RtmpSession::Ptr session = nodes_[i].server->FindSession(stream_path);
+            forwarded += session && session->HasPublisher() ? 1 : 0;
+        }
+    }
+    return forwarded;
+}
+
+ForwardService::Stats RelayTopology::GetForwardStats()
+{
+    return forward_service_ ? forward_service_->GetStats() : ForwardService::Stats();
+}
@@ -0,0 +1,98 @@
+/**
+ * @file RelayTopology.h
+ * @brief 回环多节点拓扑：在压测进程内启动多个 RtmpServer，组成源站加边缘、或接入加转发目标的拓扑。
+ *
+ * 每个节点使用独立的 EventLoop（单个调度线程），监听 127.0.0.1 上从基准端口开始的连续端口：
+ * edge 拓扑中基准端口为源站，其后为边缘，边缘以 RtmpServer::SetEdgeOrigins 向源站回源；
+ * forward 拓扑中基准端口为接入节点，其后为转发目标，接入节点以 ForwardService 把每条推流转发到全部目标。
+ * 推流连接到基准端口，观看者轮流连接到其后的节点，压测的时延与码率因此包含一跳服务端之间的转发。
+ */
+
+#ifndef _RELAYTOPOLOGY_H_
+#define _RELAYTOPOLOGY_H_
+
+#include "ForwardService.h"
+#include "RtmpServer.h"
+#include "../EdoyunNet/EventLoop.h"
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+/**
+ * @class RelayTopology
+ * @brief 拓扑中各节点的创建、查询与销毁
+ */
+class RelayTopology
+{
+public:
+    using Ptr = std::unique_ptr<RelayTopology>;
+
+    /**
+     * @brief 启动源站与 edges 个边缘
+     * @param ip 监听地址
+     * @param base_port 源站端口，边缘依次使用其后的端口
+     * @param edges 边缘数
+     * @param idle_grace_ms 边缘没有观看者持续该时长后断开回源
+     * @return 拓扑，任一节点启动失败时为 nullptr
+     */
+    static Ptr CreateEdge(const std::string& ip, uint16_t base_port, uint32_t edges, uint32_t idle_grace_ms);
+
+    /**
+     * @brief 启动接入节点与 targets 个转发目标
+     * @param ip 监听地址
+     * @param base_port 接入节点端口，转发目标依次使用其后的端口
+     * @param targets 转发目标数
+     * @return 拓扑，任一节点启动失败时为 nullptr
+     */
+    static Ptr CreateForward(const std::string& ip, uint16_t base_port, uint32_t targets);
+
+    /**
+     * @brief 析构函数，先停止转发再停止各节点
+     */
+    ~RelayTopology();
+
+    /**
+     * @brief 观看者使用的节点端口（边缘或转发目标）
+     */
+    const std::vector<uint16_t>& GetPlayPorts() const { return play_ports_; }
+
+    /**
+     * @brief 源站上各条流的观看者数之和，edge 拓扑中即回源连接数
+     * @param stream_paths 流路径
+     */
+    int GetUpstreams(const std::vector<std::string>& stream_paths);
+
+    /**
+     * @brief 转发目标上已有发布者的流数之和，forward 拓扑中即已建立的转发
+     * @param stream_paths 流路径
+     */
+    int GetForwardedStreams(const std::vector<std::string>& stream_paths);
+
+    /**
+     * @brief 接入节点的转发统计，edge 拓扑中全部为 0
+     */
+    ForwardService::Stats GetForwardStats();
+
+private:
+    /** 一个服务节点 */
+    struct Node
+    {
+        std::unique_ptr<EventLoop> loop;
+        std::shared_ptr<RtmpServer> server;
+    };
+
+    RelayTopology() = default;
+
+    /**
+     * @brief 启动一个节点
+     * @return false 表示监听失败
+     */
+    bool AddNode(const std::string& ip, uint16_t port);
+
+    std::vector<Node> nodes_;                         ///< [0] 为源站或接入节点
+    std::vector<uint16_t> play_ports_;                ///< 观看者使用的节点端口
+    std::shared_ptr<ForwardService> forward_service_; ///< 接入节点的转发服务
+};
+
+#endif // _RELAYTOPOLOGY_H_
@@ -0,0 +1,788 @@
+#include <algorithm>
+#include <chrono>
+#include <cinttypes>
+#include <cmath>
+#include <csignal>
+#include <cstdio>
+#include <stdlib.h>
+#include <string.h>
+#include <string>
+#include <thread>
+#include <unistd.h>
+#include <vector>
+#include "../EdoyunNet/EventLoop.h"
+#include "BenchSource.h"
+#include "BenchPublisher.h"
+#include "BenchPlayer.h"
+#include "AmfBench.h"
+#include "ContentionBench.h"
+#include "ParseBench.h"
+#include "FanoutBench.h"
+#include "HlsBench.h"
+#include "RecordBench.h"
+#include "RelayTopology.h"
+
+/** AMF 微基准每项的循环次数 */
+static const unsigned kAmfIterations = 200000;
+/** 到达节奏模式的时间桶宽度（毫秒） */
+static const uint32_t kPacingBinMs = 10;
+/** edge 模式中边缘没有观看者后断开回源的等待时长（毫秒） */
+static const uint32_t kEdgeIdleGraceMs = 2000;
+
+// 压测参数
+struct BenchConfig
+{
+    std::string mode = "live";          // live: 推拉流压测；vod: 点播观看压测；pacing: 推拉流压测并统计到达节奏；amf: AMF 编解码微基准；contention: 会话分发竞争基准；parse: chunk 解析吞吐基准；fanout: 会话扇出拷贝与 CPU 基准；hls: HLS 打包 CPU 基准；record: 录制写盘吞吐基准；edge/forward: 在进程内启动回环多节点拓扑后推拉流压测
+    std::string publish_ip = "127.0.0.1";
+    uint16_t publish_port = 1935;
+    std::string play_ip;                // 为空时与推流地址相同
+    uint16_t play_port = 0;
+    std::string app = "bench";
+    uint32_t publishers = 1;            // 推流数，为 0 时只拉已有的流；点播模式下为文件数，不推流
+    uint32_t players = 10;              // 每条流的观看者数
+    uint32_t video_kbps = 2000;
+    uint32_t audio_kbps = 64;
+    uint32_t fps = 30;
+    uint32_t gop = 60;
+    std::string flv_file;               // 不为空时循环发送该文件
+    uint32_t duration_s = 30;
+    uint32_t chunk_size = 4096;
+    uint32_t threads = 0;               // 为 0 时取 CPU 核数
+    uint32_t player_interval_ms = 0;    // 相邻观看者发起连接的间隔
+    std::string output;                 // JSON 输出文件，为空时输出到标准输出
+    uint32_t server_pid = 0;            // 不为 0 时在测量期间采样该服务进程的 CPU 时间
+    bool stream_affinity = false;       // 竞争基准中观看者与推流位于同一线程
+    uint32_t heavy_kbps = 0;            // 不为 0 时另建一条无人观看的高码率推流，与观看者共用服务端调度线程
+    uint32_t throttled_kbps = 0;        // 不为 0 时每条流另建一个按该速率读取 socket 的观看者，检查服务端积压时的丢帧
+    std::string record_dir;             // record 模式的录制根目录，为空时使用 /dev/shm/rtmpbench
+    uint32_t relay_nodes = 0;           // edge/forward 模式的边缘数或转发目标数，为 0 时分别取 2 与 4
+};
+
+static int64_t GetNowMs()
+{
+    return std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+static void SleepMs(int64_t ms)
+{
+    std::this_thread::sleep_for(std::chrono::milliseconds(ms));
+}
+
+// 解析 "ip:port"，省略端口时保持默认值
+static bool ParseAddress(const std::string& address, std::string& ip, uint16_t& port)
+{
+    size_t pos = address.rfind(':');
+    ip = address.substr(0, pos);
+    if(pos != std::string::npos)
+    {
+        int value = atoi(address.c_str() + pos + 1);
+        if(value <= 0 || value > 65535)
+        {
+            return false;
+        }
+        port = (uint16_t)value;
+    }
+    return !ip.empty();
+}
+
+// 读取进程累计的用户态与内核态 CPU 时间（毫秒），/proc/<pid>/stat 的第 14、15 项
+static bool ReadProcessCpuMs(uint32_t pid, uint64_t& cpu_ms)
+{
+    char path[64] = {0};
+    snprintf(path, sizeof(path), "/proc/%u/stat", pid);
+    FILE* file = fopen(path, "r");
+    if(!file)
+    {
+        return false;
+    }
+    char line[1024] = {0};
+    bool ok = fgets(line, sizeof(line), file) != nullptr;
+    fclose(file);
+    // 进程名可能包含空格，从最后一个 ')' 之后开始解析（第 3 项起）
+    const char* fields = ok ? strrchr(line, ')') : nullptr;
+    unsigned long long utime = 0, stime = 0;
+    if(!fields || sscanf(fields + 1, " %*c %*d %*d %*d %*d %*d %*u %*u %*u %*u %*u %llu %llu", &utime, &stime) != 2)
+    {
+        return false;
+    }
+    long ticks = sysconf(_SC_CLK_TCK);
+    cpu_ms = (utime + stime) * 1000 / (ticks > 0 ? ticks : 100);
+    return true;
+}
+
+// 有序样本的百分位数
+template<typename T>
+static T Percentile(const std::vector<T>& sorted, double percent)
+{
+    if(sorted.empty())
+    {
+        return 0;
+    }
+    size_t index = (size_t)(percent / 100.0 * (sorted.size() - 1) + 0.5);
+    return sorted[std::min(index, sorted.size() - 1)];
+}
+
+// 到达节奏：每个观看者测量期间各时间桶线上字节数的变异系数（标准差 / 均值）与峰均比，
+// 服务端按码率平滑发送时两者都接近 0 与 1，按帧突发发送时随帧间隔内的空桶增多而升高
+// 回环拓扑中一个观看者节点的汇总
+struct NodeStats
+{
+    uint16_t port = 0;
+    uint32_t players = 0;
+    uint32_t started = 0;
+    uint64_t bytes = 0;                     // 测量期间收到的负载字节数
+    std::vector<uint32_t> latency_samples;  // 微秒
+};
+
+// 输出回环拓扑：各观看者节点的码率与时延，edge 的回源连接数，forward 的转发状态与丢帧
+static void PrintTopology(FILE* out, const std::string& mode, RelayTopology& topology, const std::vector<std::string>& stream_paths,
+                          std::vector<NodeStats>& nodes, int64_t measure_ms, int upstreams, int idle_upstreams)
+{
+    fprintf(out, ",\n  \"topology\": {\"mode\": \"%s\", \"nodes\": [", mode.c_str());
+    for(size_t i = 0; i < nodes.size(); i++)
+    {
+        NodeStats& node = nodes[i];
+        std::sort(node.latency_samples.begin(), node.latency_samples.end());
+        fprintf(out, "%s\n    {\"port\": %u, \"players\": %u, \"started\": %u, \"bitrate\": %" PRIu64
+                ", \"latency_p50\": %.2f, \"latency_p99\": %.2f}",
+                i > 0 ? "," : "", node.port, node.players, node.started,
+                node.players > 0 ? node.bytes * 8 * 1000 / measure_ms / node.players : 0,
+                Percentile(node.latency_samples, 50) / 1000.0, Percentile(node.latency_samples, 99) / 1000.0);
+    }
+    fprintf(out, "],\n");
+    if(mode == "edge")
+    {
+        // 期望 upstreams 为 流数 × 边缘数（与观看者数无关），idle_upstreams 为 0
+        fprintf(out, "    \"upstreams\": %d, \"expected_upstreams\": %zu, \"idle_upstreams\": %d}",
+                upstreams, stream_paths.size() * nodes.size(), idle_upstreams);
+    }
+    else
+    {
+        ForwardService::Stats stats = topology.GetForwardStats();
+        fprintf(out, "    \"forwarded_streams\": %d, \"expected_streams\": %zu, \"connected\": %u, \"reconnects\": %" PRIu64
+                ", \"max_lag_ms\": %u, \"dropped_video\": %" PRIu64 ", \"dropped_audio\": %" PRIu64 ", \"gop_skips\": %" PRIu64 "}",
+                topology.GetForwardedStreams(stream_paths), stream_paths.size() * nodes.size(), stats.connected, stats.reconnects,
+                stats.max_lag_ms, stats.dropped_video, stats.dropped_audio, stats.gop_skips);
+    }
+}
+
+static void PrintPacing(FILE* out, const std::vector<BenchPlayer::Ptr>& players, int64_t start_ms, int64_t end_ms, uint32_t bin_ms)
+{
+    std::vector<double> cvs, peak_to_means, empty_ratios;
+    uint64_t bins_total = 0;
+    for(auto &player : players)
+    {
+        std::vector<uint32_t> bins = player->GetPacingBins(start_ms, end_ms);
+        if(bins.empty() || !player->GetStats().started)
+        {
+            continue;
+        }
+        double sum = 0, square_sum = 0;
+        uint32_t peak = 0;
+        size_t empty = 0;
+        for(uint32_t bytes : bins)
+        {
+            sum += bytes;
+            square_sum += (double)bytes * bytes;
+            peak = std::max(peak, bytes);
+            empty += bytes == 0 ? 1 : 0;
+        }
+        double mean = sum / bins.size();
+        if(mean <= 0)
+        {
+            continue;
+        }
+        double stddev = std::sqrt(std::max(0.0, square_sum / bins.size() - mean * mean));
+        cvs.push_back(stddev / mean);
+        peak_to_means.push_back(peak / mean);
+        empty_ratios.push_back((double)empty / bins.size());
+        bins_total += bins.size();
+    }
+    std::sort(cvs.begin(), cvs.end());
+    std::sort(peak_to_means.begin(), peak_to_means.end());
+    double cv_sum = 0, empty_sum = 0;
+    for(size_t i = 0; i < cvs.size(); i++)
+    {
+        cv_sum += cvs[i];
+        empty_sum += empty_ratios[i];
+    }
+    fprintf(out, ",\n  \"pacing\": {\"bin_ms\": %u, \"players\": %zu, \"bins\": %" PRIu64 ",\n", bin_ms, cvs.size(), bins_total);
+    fprintf(out, "    \"cv\": {\"avg\": %.3f, \"p50\": %.3f, \"p99\": %.3f, \"max\": %.3f},\n",
+            cvs.empty() ? 0.0 : cv_sum / cvs.size(), Percentile(cvs, 50), Percentile(cvs, 99), cvs.empty() ? 0.0 : cvs.back());
+    fprintf(out, "    \"peak_to_mean\": {\"p50\": %.2f, \"p99\": %.2f, \"max\": %.2f},\n",
+            Percentile(peak_to_means, 50), Percentile(peak_to_means, 99), peak_to_means.empty() ? 0.0 : peak_to_means.back());
+    fprintf(out, "    \"empty_bin_percent\": %.1f}", cvs.empty() ? 0.0 : empty_sum * 100.0 / cvs.size());
+}
+
+// 竞争基准：流数、每流观看者数、码率、帧率、GOP、chunk 大小、时长与线程数沿用压测参数
+static ContentionBenchConfig CreateContentionConfig(const BenchConfig& config)
+{
+    ContentionBenchConfig contention;
+    contention.streams = config.publishers;
+    contention.players = config.players;
+    contention.threads = config.threads;
+    contention.video_kbps = config.video_kbps;
+    contention.fps = std::max(1u, config.fps);
+    contention.gop = std::max(1u, config.gop);
+    contention.chunk_size = config.chunk_size;
+    contention.duration_s = config.duration_s;
+    contention.affinity = config.stream_affinity;
+    return contention;
+}
+
+// 解析基准：流数、媒体源、chunk 大小与时长沿用压测参数
+static ParseBenchConfig CreateParseConfig(const BenchConfig& config)
+{
+    ParseBenchConfig parse;
+    parse.streams = config.publishers;
+    parse.video_kbps = config.video_kbps;
+    parse.audio_kbps = config.audio_kbps;
+    parse.fps = std::max(1u, config.fps);
+    parse.gop = std::max(1u, config.gop);
+    parse.flv_file = config.flv_file;
+    parse.chunk_size = config.chunk_size;
+    parse.duration_s = config.duration_s;
+    return parse;
+}
+
+// 扇出基准：观看者数、媒体源、chunk 大小与时长沿用压测参数
+static FanoutBenchConfig CreateFanoutConfig(const BenchConfig& config)
+{
+    FanoutBenchConfig fanout;
+    fanout.players = config.players;
+    fanout.video_kbps = config.video_kbps;
+    fanout.audio_kbps = config.audio_kbps;
+    fanout.fps = std::max(1u, config.fps);
+    fanout.gop = std::max(1u, config.gop);
+    fanout.flv_file = config.flv_file;
+    fanout.chunk_size = config.chunk_size;
+    fanout.duration_s = config.duration_s;
+    return fanout;
+}
+
+// HLS 打包基准：流数、媒体源与时长沿用压测参数，切片参数与 RtmpSvr 相同
+static HlsBenchConfig CreateHlsConfig(const BenchConfig& config)
+{
+    HlsBenchConfig hls;
+    hls.streams = config.publishers;
+    hls.video_kbps = config.video_kbps;
+    hls.audio_kbps = config.audio_kbps;
+    hls.fps = std::max(1u, config.fps);
+    hls.gop = std::max(1u, config.gop);
+    hls.flv_file = config.flv_file;
+    hls.duration_s = config.duration_s;
+    return hls;
+}
+
+// 录制基准：流数、写线程数、媒体源与时长沿用压测参数
+static RecordBenchConfig CreateRecordConfig(const BenchConfig& config)
+{
+    RecordBenchConfig record;
+    record.streams = config.publishers;
+    record.writers = config.threads;
+    record.video_kbps = config.video_kbps;
+    record.audio_kbps = config.audio_kbps;
+    record.fps = std::max(1u, config.fps);
+    record.gop = std::max(1u, config.gop);
+    record.flv_file = config.flv_file;
+    if(!config.record_dir.empty())
+    {
+        record.dir = config.record_dir;
+    }
+    record.duration_s = config.duration_s;
+    return record;
+}
+
+// 打开 JSON 输出，未指定文件时输出到标准输出
+static FILE* OpenOutput(const BenchConfig& config)
+{
+    FILE* out = config.output.empty() ? stdout : fopen(config.output.c_str(), "w");
+    if(!out)
+    {
+        fprintf(stderr, "open %s failed\n", config.output.c_str());
+    }
+    return out;
+}
+
+static void CloseOutput(FILE* out)
+{
+    if(out != stdout)
+    {
+        fclose(out);
+    }
+}
+
+static void Usage()
+{
+    fprintf(stderr,
+            "用法: rtmpbench [-M live|vod|pacing|amf|contention|parse|fanout|hls|record|edge|forward] [-s 推流ip:port] [-p 拉流ip:port] [-a app] [-m 推流数] [-n 每流观看者数]\n"
+            "                [-b 视频kbps] [-A 音频kbps] [-r 帧率] [-g GOP帧数] [-F 循环的FLV文件]\n"
+            "                [-d 测量秒数] [-c chunk大小] [-t 线程数] [-i 观看者连接间隔ms] [-o JSON文件] [-P 服务进程pid]\n"
+            "                [-S 流亲和(0|1)] [-H 高码率推流kbps] [-R 限速观看者kbps] [-D 录制目录] [-e 边缘或转发目标数]\n");
+}
+
+static bool ParseArgs(int argc, char** argv, BenchConfig& config)
+{
+    for(int i = 1; i < argc; i++)
+    {
+        if(i + 1 >= argc || argv[i][0] != '-' || strlen(argv[i]) != 2)
+        {
+            return false;
+        }
+        const char* value = argv[++i];
+        switch(argv[i - 1][1])
+        {
+        case 'M': config.mode = value; break;
+        case 's': if(!ParseAddress(value, config.publish_ip, config.publish_port)) return false; break;
+        case 'p': config.play_port = 1935; if(!ParseAddress(value, config.play_ip, config.play_port)) return false; break;
+        case 'a': config.app = value; break;
+        case 'm': config.publishers = (uint32_t)atoi(value); break;
+        case 'n': config.players = (uint32_t)atoi(value); break;
+        case 'b': config.video_kbps = (uint32_t)atoi(value); break;
+        case 'A': config.audio_kbps = (uint32_t)atoi(value); break;
+        case 'r': config.fps = (uint32_t)atoi(value); break;
+        case 'g': config.gop = (uint32_t)atoi(value); break;
+        case 'F': config.flv_file = value; break;
+        case 'd': config.duration_s = (uint32_t)atoi(value); break;
+        case 'c': config.chunk_size = (uint32_t)atoi(value); break;
+        case 't': config.threads = (uint32_t)atoi(value); break;
+        case 'i': config.player_interval_ms = (uint32_t)atoi(value); break;
+        case 'o': config.output = value; break;
+        case 'P': config.server_pid = (uint32_t)atoi(value); break;
+        case 'S': config.stream_affinity = atoi(value) != 0; break;
+        case 'H': config.heavy_kbps = (uint32_t)atoi(value); break;
+        case 'R': config.throttled_kbps = (uint32_t)atoi(value); break;
+        case 'D': config.record_dir = value; break;
+        case 'e': config.relay_nodes = (uint32_t)atoi(value); break;
+        default: return false;
+        }
+    }
+    if(config.play_ip.empty())
+    {
+        config.play_ip = config.publish_ip;
+        config.play_port = config.publish_port;
+    }
+    if(config.threads == 0)
+    {
+        config.threads = std::max(1u, std::thread::hardware_concurrency());
+    }
+    config.chunk_size = std::max(128u, std::min(config.chunk_size, 0xffffffu));
+    if(config.mode != "live" && config.mode != "vod" && config.mode != "pacing" && config.mode != "amf"
+       && config.mode != "contention" && config.mode != "parse" && config.mode != "fanout" && config.mode != "hls"
+       && config.mode != "record" && config.mode != "edge" && config.mode != "forward")
+    {
+        return false;
+    }
+    if(config.mode == "vod" && (config.publishers == 0 || config.players == 0))
+    {
+        return false;
+    }
+    return config.duration_s > 0 && (config.publishers > 0 || config.players > 0);
+}
+
+// 运行压测：先建立推流，全部开始后再建立观看者，观看者全部发起后开始测量；点播模式不推流，直接观看服务端的文件
+int main(int argc, char** argv)
+{
+    BenchConfig config;
+    if(!ParseArgs(argc, argv, config))
+    {
+        Usage();
+        return 1;
+    }
+
+    // 进程内基准，不建立连接
+    if(config.mode == "amf" || config.mode == "contention" || config.mode == "parse" || config.mode == "fanout"
+       || config.mode == "hls" || config.mode == "record")
+    {
+        FILE* out = OpenOutput(config);
+        if(!out)
+        {
+            return 1;
+        }
+        bool ok = true;
+        if(config.mode == "amf")
+        {
+            RunAmfBench(out, kAmfIterations);
+        }
+        else if(config.mode == "contention")
+        {
+            ok = RunContentionBench(out, CreateContentionConfig(config));
+        }
+        else if(config.mode == "parse")
+        {
+            ok = RunParseBench(out, CreateParseConfig(config));
+        }
+        else if(config.mode == "fanout")
+        {
+            ok = RunFanoutBench(out, CreateFanoutConfig(config));
+        }
+        else if(config.mode == "hls")
+        {
+            ok = RunHlsBench(out, CreateHlsConfig(config));
+        }
+        else
+        {
+            ok = RunRecordBench(out, CreateRecordConfig(config));
+        }
+        CloseOutput(out);
+        return ok ? 0 : 1;
+    }
+
+    BenchSource::Ptr source = config.flv_file.empty()
+        ? BenchSource::CreateSynthetic(config.video_kbps * 1000, config.fps, config.gop, config.audio_kbps * 1000)
+        : BenchSource::LoadFlv(config.flv_file);
+    if(!source)
+    {
+        fprintf(stderr, "invalid media source\n");
+        return 1;
+    }
+
+    // 对端已关闭时写 socket 返回 EPIPE 而不是终止进程；回环拓扑的服务端与客户端位于同一进程
+    signal(SIGPIPE, SIG_IGN);
+
+    // 回环拓扑：推流连接到源站或接入节点，观看者轮流连接到各边缘或转发目标
+    RelayTopology::Ptr topology;
+    std::vector<uint16_t> play_ports = { config.play_port };
+    if(config.mode == "edge" || config.mode == "forward")
+    {
+        topology = config.mode == "edge"
+            ? RelayTopology::CreateEdge(config.publish_ip, config.publish_port, config.relay_nodes > 0 ? config.relay_nodes : 2,
+                                        kEdgeIdleGraceMs)
+            : RelayTopology::CreateForward(config.publish_ip, config.publish_port, config.relay_nodes > 0 ? config.relay_nodes : 4);
+        if(!topology)
+        {
+            return 1;
+        }
+        play_ports = topology->GetPlayPorts();
+        config.play_ip = config.publish_ip;
+    }
+
+    EventLoop loop(config.threads);
+    uint32_t streams = config.publishers > 0 ? config.publishers : 1;
+    std::vector<std::string> stream_paths;
+    for(uint32_t i = 0; i < streams; i++)
+    {
+        stream_paths.push_back("/" + config.app + "/stream" + std::to_string(i));
+    }
+
+    bool vod = config.mode == "vod";
+    uint32_t pacing_bin_ms = config.mode == "pacing" ? kPacingBinMs : 0;
+    std::vector<BenchPublisher::Ptr> publishers;
+    for(uint32_t i = 0; i < config.publishers && !vod; i++)
+    {
+        BenchPublisher::Ptr publisher = BenchPublisher::Create(loop.GetTaskSchduler().get(), config.publish_ip, config.publish_port,
+                                                               stream_paths[i], source, config.chunk_size);
+        if(publisher)
+        {
+            publishers.push_back(publisher);
+        }
+    }
+    // 高码率推流不计入推流统计；服务端单线程运行时与全部观看者位于同一调度线程
+    BenchPublisher::Ptr heavy_publisher;
+    if(config.heavy_kbps > 0 && !vod)
+    {
+        BenchSource::Ptr heavy_source = BenchSource::CreateSynthetic(config.heavy_kbps * 1000, config.fps, config.gop, 0);
+        if(heavy_source)
+        {
+            heavy_publisher = BenchPublisher::Create(loop.GetTaskSchduler().get(), config.publish_ip, config.publish_port,
+                                                     "/" + config.app + "/heavy", heavy_source, config.chunk_size);
+        }
+    }
+    // 等待推流开始，最多 5 秒；之后再等半个 GOP 让服务端缓存关键帧
+    int64_t deadline = GetNowMs() + 5000;
+    while(GetNowMs() < deadline)
+    {
+        size_t started = heavy_publisher && !heavy_publisher->HasStarted() ? 0 : 1;
+        for(auto &publisher : publishers)
+        {
+            started += publisher->HasStarted() ? 1 : 0;
+        }
+        if(started == publishers.size() + 1)
+        {
+            break;
+        }
+        SleepMs(50);
+    }
+    if(!publishers.empty())
+    {
+        SleepMs(500);
+    }
+
+    // 合成源的视频帧间隔固定，观看者据此检查时间戳缺口；FLV 文件的帧间隔未知，不检查
+    uint32_t video_interval_ms = config.flv_file.empty() ? 1000 / std::max(1u, config.fps) : 0;
+    std::vector<BenchPlayer::Ptr> players;
+    std::vector<size_t> player_nodes;                // 各观看者连接的节点在 play_ports 中的序号
+    for(uint32_t i = 0; i < config.players; i++)
+    {
+        for(auto &stream_path : stream_paths)
+        {
+            size_t node = i % play_ports.size();
+            BenchPlayer::Ptr player = BenchPlayer::Create(loop.GetTaskSchduler().get(), config.play_ip, play_ports[node], stream_path,
+                                                             pacing_bin_ms);
+            if(player)
+            {
+                player->SetVideoInterval(video_interval_ms);
+                players.push_back(player);
+                player_nodes.push_back(node);
+            }
+            if(config.player_interval_ms > 0)
+            {
+                SleepMs(config.player_interval_ms);
+            }
+        }
+    }
+    // 限速观看者不计入观看者统计，单独输出收到的码率与丢帧缺口
+    std::vector<BenchPlayer::Ptr> throttled_players;
+    for(uint32_t i = 0; i < streams && config.throttled_kbps > 0; i++)
+    {
+        BenchPlayer::Ptr player = BenchPlayer::Create(loop.GetTaskSchduler().get(), config.play_ip, play_ports[0], stream_paths[i]);
+        if(player)
+        {
+            player->SetVideoInterval(video_interval_ms);
+            player->SetThrottle(config.throttled_kbps * 1000 / 8);
+            throttled_players.push_back(player);
+        }
+    }
+    fprintf(stderr, "publishers %zu/%u, players %zu/%u\n", publishers.size(), config.publishers,
+            players.size(), config.players * streams);
+
+    // 等首帧到达后开始测量，丢弃此前的时延样本（含 GOP 缓存突发）
+    SleepMs(1000);
+    std::vector<uint64_t> start_bytes(players.size());
+    std::vector<uint64_t> start_wire_bytes(players.size());
+    std::vector<uint64_t> start_media_timestamps(players.size());
+    for(size_t i = 0; i < players.size(); i++)
+    {
+        BenchPlayer::Stats stats = players[i]->GetStats();
+        start_bytes[i] = stats.bytes;
+        start_wire_bytes[i] = stats.wire_bytes;
+        start_media_timestamps[i] = stats.media_timestamp;
+        players[i]->TakeLatencySamples();
+    }
+    uint64_t publisher_start_bytes = 0;
+    for(auto &publisher : publishers)
+    {
+        publisher_start_bytes += publisher->GetStats().sent_bytes;
+    }
+    std::vector<BenchPlayer::Stats> throttled_start;
+    for(auto &player : throttled_players)
+    {
+        throttled_start.push_back(player->GetStats());
+    }
+    BenchPublisher::Stats heavy_start;
+    if(heavy_publisher)
+    {
+        heavy_start = heavy_publisher->GetStats();
+    }
+
+    uint64_t server_cpu_start = 0, server_cpu_end = 0;
+    bool server_cpu = config.server_pid > 0 && ReadProcessCpuMs(config.server_pid, server_cpu_start);
+    int64_t measure_start = GetNowMs();
+    std::vector<uint32_t> latency_samples;
+    std::vector<NodeStats> nodes(play_ports.size());
+    for(size_t i = 0; i < play_ports.size(); i++)
+    {
+        nodes[i].port = play_ports[i];
+    }
+    for(uint32_t second = 1; second <= config.duration_s; second++)
+    {
+        SleepMs(measure_start + second * 1000 - GetNowMs());
+        uint64_t bytes = 0;
+        for(size_t i = 0; i < players.size(); i++)
+        {
+            bytes += players[i]->GetStats().bytes - start_bytes[i];
+            std::vector<uint32_t> samples = players[i]->TakeLatencySamples();
+            latency_samples.insert(latency_samples.end(), samples.begin(), samples.end());
+            std::vector<uint32_t>& node_samples = nodes[player_nodes[i]].latency_samples;
+            node_samples.insert(node_samples.end(), samples.begin(), samples.end());
+        }
+        fprintf(stderr, "[%us] delivered %.1f Mbps\n", second, bytes * 8.0 / second / 1000000.0);
+    }
+    int64_t measure_end = GetNowMs();
+    int64_t measure_ms = std::max<int64_t>(measure_end - measure_start, 1);
+    server_cpu = server_cpu && ReadProcessCpuMs(config.server_pid, server_cpu_end);
+
+    // 汇总统计
+    uint32_t publishers_started = 0, publishers_closed = 0;
+    uint64_t sent_frames = 0, skipped_frames = 0, publisher_bytes = 0;
+    for(auto &publisher : publishers)
+    {
+        BenchPublisher::Stats stats = publisher->GetStats();
+        publishers_started += stats.started ? 1 : 0;
+        publishers_closed += stats.closed ? 1 : 0;
+        sent_frames += stats.sent_frames;
+        skipped_frames += stats.skipped_frames;
+        publisher_bytes += stats.sent_bytes;
+    }
+    publisher_bytes -= publisher_start_bytes;
+
+    uint32_t players_started = 0, players_closed = 0, players_without_video = 0;
+    uint64_t video_frames = 0, delivered_bytes = 0, wire_bytes = 0, video_gaps = 0, broken_gaps = 0, audio_gaps = 0;
+    std::vector<int64_t> ttff;
+    std::vector<uint64_t> bitrates;
+    std::vector<double> realtime_ratios;             // 测量期间媒体时间戳推进与墙上时间之比
+    for(size_t i = 0; i < players.size(); i++)
+    {
+        BenchPlayer::Stats stats = players[i]->GetStats();
+        players_started += stats.started ? 1 : 0;
+        players_closed += stats.closed ? 1 : 0;
+        video_frames += stats.video_frames;
+        video_gaps += stats.video_gaps;
+        broken_gaps += stats.broken_gaps;
+        audio_gaps += stats.audio_gaps;
+        if(stats.ttff_ms < 0)
+        {
+            players_without_video++;
+        }
+        else
+        {
+            ttff.push_back(stats.ttff_ms);
+        }
+        uint64_t bytes = stats.bytes - start_bytes[i];
+        delivered_bytes += bytes;
+        NodeStats& node = nodes[player_nodes[i]];
+        node.players++;
+        node.started += stats.started ? 1 : 0;
+        node.bytes += bytes;
+        wire_bytes += stats.wire_bytes - start_wire_bytes[i];
+        bitrates.push_back(bytes * 8 * 1000 / measure_ms);
+        if(stats.started)
+        {
+            uint64_t advance = stats.media_timestamp > start_media_timestamps[i] ? stats.media_timestamp - start_media_timestamps[i] : 0;
+            realtime_ratios.push_back((double)advance / measure_ms);
+        }
+    }
+    std::sort(ttff.begin(), ttff.end());
+    std::sort(bitrates.begin(), bitrates.end());
+    std::sort(latency_samples.begin(), latency_samples.end());
+    std::sort(realtime_ratios.begin(), realtime_ratios.end());
+    double realtime_ratio_sum = 0;
+    for(double ratio : realtime_ratios)
+    {
+        realtime_ratio_sum += ratio;
+    }
+    uint64_t average_bitrate = bitrates.empty() ? 0 : delivered_bytes * 8 * 1000 / measure_ms / bitrates.size();
+    double latency_sum = 0;
+    for(uint32_t sample : latency_samples)
+    {
+        latency_sum += sample;
+    }
+    size_t player_count = players.size();
+    // edge 拓扑：测量期间每条流在每个边缘各有一条回源连接；观看者全部离开后，边缘应在空闲等待后断开回源
+    int upstreams = 0, idle_upstreams = 0;
+    if(config.mode == "edge")
+    {
+        upstreams = topology->GetUpstreams(stream_paths);
+        for(auto &player : players)
+        {
+            player->Stop();
+        }
+        players.clear();                             // socket 在连接的最后一个引用释放时才关闭
+        SleepMs(kEdgeIdleGraceMs + 1500);
+        idle_upstreams = topology->GetUpstreams(stream_paths);
+    }
+
+    FILE* out = OpenOutput(config);
+    if(!out)
+    {
+        return 1;
+    }
+    fprintf(out, "{\n");
+    fprintf(out, "  \"config\": {\"publish\": \"%s:%u\", \"play\": \"%s:%u\", \"streams\": %u, \"players_per_stream\": %u, "
+            "\"source\": \"%s\", \"source_bitrate\": %u, \"chunk_size\": %u, \"threads\": %u, \"duration_ms\": %" PRId64 "},\n",
+            config.publish_ip.c_str(), config.publish_port, config.play_ip.c_str(), config.play_port, streams, config.players,
+            config.flv_file.empty() ? "synthetic" : "flv", source->GetBitrate(), config.chunk_size, config.threads, measure_ms);
+    fprintf(out, "  \"publishers\": {\"count\": %zu, \"started\": %u, \"closed\": %u, \"sent_frames\": %" PRIu64
+            ", \"skipped_frames\": %" PRIu64 ", \"bitrate\": %" PRIu64 "},\n",
+            publishers.size(), publishers_started, publishers_closed, sent_frames, skipped_frames,
+            publishers.empty() ? 0 : publisher_bytes * 8 * 1000 / measure_ms / publishers.size());
+    fprintf(out, "  \"players\": {\"count\": %zu, \"started\": %u, \"closed\": %u, \"without_video\": %u, \"video_frames\": %" PRIu64 ","
+            " \"video_gaps\": %" PRIu64 ", \"broken_gaps\": %" PRIu64 ", \"audio_gaps\": %" PRIu64 ",\n",
+            player_count, players_started, players_closed, players_without_video, video_frames, video_gaps, broken_gaps, audio_gaps);
+    fprintf(out, "    \"bitrate\": {\"min\": %" PRIu64 ", \"avg\": %" PRIu64 ", \"max\": %" PRIu64 ", \"total\": %" PRIu64 "},\n",
+            bitrates.empty() ? 0 : bitrates.front(), average_bitrate, bitrates.empty() ? 0 : bitrates.back(),
+            delivered_bytes * 8 * 1000 / measure_ms);
+    fprintf(out, "    \"wire\": {\"payload_bytes\": %" PRIu64 ", \"wire_bytes\": %" PRIu64 ", \"overhead_bytes\": %" PRIu64 "},\n",
+            delivered_bytes, wire_bytes, wire_bytes > delivered_bytes ? wire_bytes - delivered_bytes : 0);
+    fprintf(out, "    \"ttff_ms\": {\"min\": %" PRId64 ", \"p50\": %" PRId64 ", \"p95\": %" PRId64 ", \"max\": %" PRId64 "}},\n",
+            ttff.empty() ? 0 : ttff.front(), Percentile(ttff, 50), Percentile(ttff, 95), ttff.empty() ? 0 : ttff.back());
+    fprintf(out, "  \"latency_ms\": {\"samples\": %zu, \"avg\": %.2f, \"p50\": %.2f, \"p95\": %.2f, \"p99\": %.2f, \"max\": %.2f}",
+            latency_samples.size(), latency_samples.empty() ? 0.0 : latency_sum / latency_samples.size() / 1000.0,
+            Percentile(latency_samples, 50) / 1000.0, Percentile(latency_samples, 95) / 1000.0,
+            Percentile(latency_samples, 99) / 1000.0, latency_samples.empty() ? 0.0 : latency_samples.back() / 1000.0);
+    if(server_cpu)
+    {
+        // 服务进程在测量期间平均占用的核数，以及每个核可承担的观看者数
+        double cpu_cores = (double)(server_cpu_end - server_cpu_start) / measure_ms;
+        fprintf(out, ",\n  \"server\": {\"pid\": %u, \"cpu_cores\": %.3f, \"players_per_core\": %.1f}",
+                config.server_pid, cpu_cores, cpu_cores > 0 ? players_started / cpu_cores : 0.0);
+    }
+    if(vod)
+    {
+        // 倍率低于 1 表示观看者收到的媒体落后于实时，会出现卡顿
+        fprintf(out, ",\n  \"vod\": {\"realtime_ratio\": {\"min\": %.3f, \"avg\": %.3f}, \"below_realtime\": %zu}",
+                realtime_ratios.empty() ? 0.0 : realtime_ratios.front(),
+                realtime_ratios.empty() ? 0.0 : realtime_ratio_sum / realtime_ratios.size(),
+                (size_t)(std::lower_bound(realtime_ratios.begin(), realtime_ratios.end(), 0.95) - realtime_ratios.begin()));
+    }
+    if(!throttled_players.empty())
+    {
+        // 服务端按帧类型丢帧时视频缺口之后总是关键帧（broken_gaps 为 0），音频保持连续（audio_gaps 为 0）
+        BenchPlayer::Stats total;
+        uint32_t started = 0, closed = 0;
+        for(size_t i = 0; i < throttled_players.size(); i++)
+        {
+            BenchPlayer::Stats stats = throttled_players[i]->GetStats();
+            started += stats.started ? 1 : 0;
+            closed += stats.closed ? 1 : 0;
+            total.bytes += stats.bytes - throttled_start[i].bytes;
+            total.video_frames += stats.video_frames - throttled_start[i].video_frames;
+            total.video_gaps += stats.video_gaps;
+            total.broken_gaps += stats.broken_gaps;
+            total.audio_gaps += stats.audio_gaps;
+        }
+        fprintf(out, ",\n  \"throttled\": {\"count\": %zu, \"started\": %u, \"closed\": %u, \"read_kbps\": %u, \"bitrate\": %" PRIu64
+                ", \"video_frames\": %" PRIu64 ", \"video_gaps\": %" PRIu64 ", \"broken_gaps\": %" PRIu64 ", \"audio_gaps\": %" PRIu64 "}",
+                throttled_players.size(), started, closed, config.throttled_kbps,
+                total.bytes * 8 * 1000 / measure_ms / throttled_players.size(), total.video_frames,
+                total.video_gaps, total.broken_gaps, total.audio_gaps);
+    }
+    if(heavy_publisher)
+    {
+        // 服务端读得慢时推流发送队列超限丢帧，skipped_frames 不为 0 说明实际码率低于设定值
+        BenchPublisher::Stats stats = heavy_publisher->GetStats();
+        fprintf(out, ",\n  \"heavy_publisher\": {\"started\": %s, \"closed\": %s, \"bitrate\": %" PRIu64 ", \"skipped_frames\": %" PRIu64 "}",
+                stats.started ? "true" : "false", stats.closed ? "true" : "false",
+                (stats.sent_bytes - heavy_start.sent_bytes) * 8 * 1000 / measure_ms, stats.skipped_frames - heavy_start.skipped_frames);
+    }
+    if(pacing_bin_ms > 0)
+    {
+        PrintPacing(out, players, measure_start, measure_end, pacing_bin_ms);
+    }
+    if(topology)
+    {
+        PrintTopology(out, config.mode, *topology, stream_paths, nodes, measure_ms, upstreams, idle_upstreams);
+    }
+    fprintf(out, "\n}\n");
+    CloseOutput(out);
+
+    for(auto &player : players)
+    {
+        player->Stop();
+    }
+    for(auto &player : throttled_players)
+    {
+        player->Stop();
+    }
+    for(auto &publisher : publishers)
+    {
+        publisher->Stop();
+    }
+    if(heavy_publisher)
+    {
+        heavy_publisher->Stop();
+    }
+    SleepMs(200);
+    return 0;
+}
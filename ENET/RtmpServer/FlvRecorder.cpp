@@ -0,0 +1,403 @@
+/**
+ * @file FlvRecorder.cpp
+ * @brief 实现 FlvRecorder：无锁入队、丢帧计数、对齐缓冲写盘、文件切分与关键帧索引。
+ */
+#include "FlvRecorder.h"
+#include "rtmp.h"
+#include <cerrno>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+/** 写缓冲区大小，O_DIRECT 要求按块对齐 */
+static const uint32_t kBufferSize = 256 * 1024;
+/** 写缓冲区与 O_DIRECT 写入长度的对齐 */
+static const uint32_t kAlignment = 4096;
+/** 正在写入的文件的后缀，关闭时去掉后缀发布 */
+static const char kPartSuffix[] = ".part";
+/** 文件名冲突时最多尝试的序号数 */
+static const uint32_t kMaxNameAttempts = 1000;
+
+/**
+ * @brief 逐级创建目录，等价于 mkdir -p
+ */
+static void MakeDirs(const std::string& path)
+{
+    for(size_t pos = path.find('/', 1); ; pos = path.find('/', pos + 1))
+    {
+        std::string dir = path.substr(0, pos);
+        if(!dir.empty())
+        {
+            mkdir(dir.c_str(), 0755);
+        }
+        if(pos == std::string::npos)
+        {
+            break;
+        }
+    }
+}
+
+/**
+ * @brief 构造函数，分配对齐的写缓冲区
+ */
+FlvRecorder::FlvRecorder(const std::string& stream_path, const std::string& dir, uint32_t max_duration_ms,
+                         uint64_t max_bytes, uint32_t queue_size, bool direct_io)
+    :queue_(queue_size > 0 ? queue_size : 1024)
+    ,stream_path_(stream_path)
+    ,dir_(dir + stream_path)
+    ,max_duration_ms_(max_duration_ms)
+    ,max_bytes_(max_bytes)
+    ,direct_io_(direct_io)
+    ,id_(AllocInternalId())
+{
+    void* buffer = nullptr;
+    if(posix_memalign(&buffer, kAlignment, kBufferSize) == 0)
+    {
+        buffer_ = (char*)buffer;
+    }
+}
+
+/**
+ * @brief 析构函数
+ */
+FlvRecorder::~FlvRecorder()
+{
+    CloseFile();
+    free(buffer_);
+}
+
+/**
+ * @brief 元数据消息直接入队，与音视频共用写入路径
+ */
+bool FlvRecorder::SendMetaData(RtmpMediaPacket::Ptr meta_data)
+{
+    return SendMediaPacket(meta_data);
+}
+
+/**
+ * @brief 封装为媒体消息后按共享路径处理
+ */
+bool FlvRecorder::SendMediaData(uint8_t type, uint64_t timestamp, std::shared_ptr<char> payload, uint32_t payload_size)
+{
+    return SendMediaPacket(std::make_shared<RtmpMediaPacket>(type, timestamp, payload, payload_size));
+}
+
+/**
+ * @brief 入队会话共享的媒体消息；队列满时丢弃并计数，视频丢到下一个关键帧
+ * @param packet 媒体消息
+ * @return true 始终保持在会话中
+ */
+bool FlvRecorder::SendMediaPacket(RtmpMediaPacket::Ptr packet)
+{
+    is_playing_ = true;
+    if(stopped_ || packet->GetSize() == 0)
+    {
+        return true;
+    }
+
+    bool is_video = packet->GetType() == RTMP_VIDEO;
+    if(is_video && wait_key_frame_ && !packet->IsKeyFrame())
+    {
+        dropped_messages_++;
+        return true;
+    }
+    if(!queue_.TryPush(packet))
+    {
+        dropped_messages_++;
+        if(is_video || packet->GetType() == RTMP_AVC_SEQUENCE_HEADER)
+        {
+            wait_key_frame_ = true;                   // 参考帧缺失后的视频无法解码
+        }
+        return true;
+    }
+    if(is_video)
+    {
+        wait_key_frame_ = false;
+    }
+    return true;
+}
+
+/**
+ * @brief 取出并写入队列中的消息；停止后写完剩余数据即关闭文件
+ */
+bool FlvRecorder::Process(uint32_t max_messages)
+{
+    if(finished_)
+    {
+        return false;
+    }
+
+    bool stopped = stopped_;                          // 先读停止标志，之后取空的队列一定包含停止前的全部消息
+    RtmpMediaPacket::Ptr packet;
+    uint32_t count = 0;
+    while(count < max_messages && queue_.TryPop(packet))
+    {
+        WriteMessage(packet);
+        count++;
+    }
+    packet.reset();
+
+    if(stopped && queue_.Size() == 0)
+    {
+        CloseFile();
+        finished_ = true;
+    }
+    return count > 0;
+}
+
+/**
+ * @brief 写入一条消息，有视频的流在关键帧处开始和切分文件
+ */
+void FlvRecorder::WriteMessage(const RtmpMediaPacket::Ptr& packet)
+{
+    uint8_t type = packet->GetType();
+    if(type == RTMP_NOTIFY)
+    {
+        meta_data_ = packet;
+        return;
+    }
+    if(type == RTMP_AVC_SEQUENCE_HEADER)
+    {
+        avc_sequence_header_ = packet;
+        CloseFile();                                  // 编码参数变化，之后的数据写入新文件
+        return;
+    }
+    if(type == RTMP_AAC_SEQUENCE_HEADER)
+    {
+        aac_sequence_header_ = packet;
+        return;
+    }
+    if(type != RTMP_VIDEO && type != RTMP_AUDIO)
+    {
+        return;
+    }
+
+    uint64_t timestamp = packet->GetTimestamp();
+    bool key_frame = type == RTMP_VIDEO && packet->IsKeyFrame();
+    bool can_cut = avc_sequence_header_ ? key_frame : true;
+    if(fd_ >= 0 && can_cut)
+    {
+        uint64_t elapsed = timestamp > file_start_ts_ ? timestamp - file_start_ts_ : 0;
+        if((max_duration_ms_ > 0 && elapsed >= max_duration_ms_) || (max_bytes_ > 0 && file_bytes_ >= max_bytes_))
+        {
+            CloseFile();
+        }
+    }
+    if(fd_ < 0)
+    {
+        if(!can_cut || !OpenFile(timestamp))
+        {
+            return;                                   // 等待关键帧，或打开失败时丢弃
+        }
+    }
+
+    uint32_t file_ts = (uint32_t)(timestamp > file_start_ts_ ? timestamp - file_start_ts_ : 0);
+    if(key_frame)
+    {
+        key_frames_.push_back(std::make_pair(file_ts, file_bytes_));
+    }
+    WriteTag(type == RTMP_VIDEO ? RTMP_VIDEO : RTMP_AUDIO, file_ts, packet->GetPayload().get(), packet->GetSize());
+}
+
+/**
+ * @brief 以 "<目录>/<开始时间>-<序号>.flv.part" 新建文件，写入文件头、元数据与序列头
+ *
+ * 以 O_EXCL 创建，不截断已有文件：同一秒内重启的录制器序号从 0 重新开始，名字已被占用（正在写入或已发布）时递增序号重试。
+ * 已发布的 .flv 从此不再被写入，点播可以安全地映射
+ */
+bool FlvRecorder::OpenFile(uint64_t timestamp)
+{
+    if(buffer_ == nullptr)
+    {
+        return false;
+    }
+
+    char prefix[32] = {0};
+    time_t now = time(nullptr);
+    struct tm local;
+    localtime_r(&now, &local);
+    strftime(prefix, sizeof(prefix), "/%Y%m%d-%H%M%S", &local);
+    MakeDirs(dir_);
+
+    int flags = O_WRONLY | O_CREAT | O_EXCL | O_CLOEXEC;
+    direct_ = false;
+    fd_ = -1;
+    for(uint32_t attempt = 0; attempt < kMaxNameAttempts && fd_ < 0; attempt++)
+    {
+        file_path_ = dir_ + prefix + "-" + std::to_string(file_index_++) + ".flv";
+        if(access(file_path_.c_str(), F_OK) == 0)
+        {
+            continue;                               // 已发布的文件不覆盖
+        }
+        fd_ = open((file_path_ + kPartSuffix).c_str(), flags, 0644);
+        if(fd_ < 0 && errno != EEXIST)
+        {
+            break;
+        }
+    }
+    if(fd_ < 0)
+    {
+        write_errors_++;
+        return false;
+    }
+    if(direct_io_)
+    {
+        // 创建后再开启 O_DIRECT，不支持的文件系统（如 tmpfs）返回失败，回退到普通写
+        direct_ = fcntl(fd_, F_SETFL, fcntl(fd_, F_GETFL) | O_DIRECT) == 0;
+    }
+
+    file_start_ts_ = timestamp;
+    file_bytes_ = 0;
+    buffer_used_ = 0;
+    key_frames_.clear();
+
+    static const char kFlvHeader[13] = { 'F', 'L', 'V', 0x01, 0x05, 0x00, 0x00, 0x00, 0x09, 0x00, 0x00, 0x00, 0x00 };
+    Append(kFlvHeader, sizeof(kFlvHeader));
+    if(meta_data_)
+    {
+        WriteTag(RTMP_NOTIFY, 0, meta_data_->GetPayload().get(), meta_data_->GetSize());
+    }
+    if(aac_sequence_header_)
+    {
+        WriteTag(RTMP_AUDIO, 0, aac_sequence_header_->GetPayload().get(), aac_sequence_header_->GetSize());
+    }
+    if(avc_sequence_header_)
+    {
+        WriteTag(RTMP_VIDEO, 0, avc_sequence_header_->GetPayload().get(), avc_sequence_header_->GetSize());
+    }
+    return fd_ >= 0;
+}
+
+/**
+ * @brief 关闭当前文件，关键帧索引写入同名 .idx 文件，每行 "时间戳(毫秒) 字节偏移"，之后去掉 .part 后缀发布
+ *
+ * 索引先于文件出现，点播打开文件时即可使用索引
+ */
+void FlvRecorder::CloseFile()
+{
+    if(fd_ < 0)
+    {
+        return;
+    }
+    Flush(true);
+    if(fd_ >= 0)
+    {
+        close(fd_);
+        fd_ = -1;
+    }
+
+    FILE* index = fopen((file_path_ + ".idx").c_str(), "w");
+    if(index)
+    {
+        for(auto &key_frame : key_frames_)
+        {
+            fprintf(index, "%u %llu\n", key_frame.first, (unsigned long long)key_frame.second);
+        }
+        fclose(index);
+    }
+    key_frames_.clear();
+
+    if(rename((file_path_ + kPartSuffix).c_str(), file_path_.c_str()) != 0)
+    {
+        write_errors_++;
+    }
+}
+
+/**
+ * @brief 追加 FLV tag，头部与 PreviousTagSize 在栈上生成，负载直接拷入写缓冲区
+ */
+void FlvRecorder::WriteTag(uint8_t type, uint32_t timestamp, const char* data, uint32_t size)
+{
+    char header[11];
+    header[0] = (char)type;
+    header[1] = (char)(size >> 16);
+    header[2] = (char)(size >> 8);
+    header[3] = (char)size;
+    header[4] = (char)(timestamp >> 16);
+    header[5] = (char)(timestamp >> 8);
+    header[6] = (char)timestamp;
+    header[7] = (char)(timestamp >> 24);
+    header[8] = header[9] = header[10] = 0;
+    Append(header, sizeof(header));
+    Append(data, size);
+
+    uint32_t tag_size = size + 11;
+    char previous[4] = { (char)(tag_size >> 24), (char)(tag_size >> 16), (char)(tag_size >> 8), (char)tag_size };
+    Append(previous, sizeof(previous));
+}
+
+/**
+ * @brief 拷贝到写缓冲区，满一块写一次盘
+ */
+void FlvRecorder::Append(const char* data, uint32_t size)
+{
+    file_bytes_ += size;
+    while(size > 0 && fd_ >= 0)
+    {
+        uint32_t copy = kBufferSize - buffer_used_;
+        if(copy > size)
+        {
+            copy = size;
+        }
+        memcpy(buffer_ + buffer_used_, data, copy);
+        buffer_used_ += copy;
+        data += copy;
+        size -= copy;
+        if(buffer_used_ == kBufferSize)
+        {
+            Flush(false);
+        }
+    }
+}
+
+/**
+ * @brief 写出缓冲区，写失败时关闭文件等待下一个切分点重新打开
+ */
+void FlvRecorder::Flush(bool final)
+{
+    if(fd_ < 0 || buffer_used_ == 0)
+    {
+        return;
+    }
+
+    uint32_t length = buffer_used_;
+    if(direct_ && !final)
+    {
+        length -= length % kAlignment;               // O_DIRECT 只能写整块
+    }
+    if(direct_ && final && length % kAlignment != 0)
+    {
+        fcntl(fd_, F_SETFL, fcntl(fd_, F_GETFL) & ~O_DIRECT);
+        direct_ = false;
+    }
+
+    uint32_t offset = 0;
+    while(offset < length)
+    {
+        ssize_t ret = write(fd_, buffer_ + offset, length - offset);
+        if(ret < 0 && errno == EINTR)
+        {
+            continue;
+        }
+        if(ret <= 0)
+        {
+            write_errors_++;
+            close(fd_);
+            fd_ = -1;
+            buffer_used_ = 0;
+            return;
+        }
+        offset += (uint32_t)ret;
+    }
+    written_bytes_ += length;
+
+    buffer_used_ -= length;
+    if(buffer_used_ > 0)
+    {
+        memmove(buffer_, buffer_ + length, buffer_used_);
+    }
+}
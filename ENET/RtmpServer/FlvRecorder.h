@@ -0,0 +1,158 @@
+/**
+ * @file FlvRecorder.h
+ * @brief FLV 录制（DVR）：作为内部观看者加入 RtmpSession，由独立的写线程把媒体消息写入 FLV 文件。
+ *
+ * 主要职责：
+ *  - 事件循环线程只把共享的媒体消息放入无锁队列，不做任何磁盘 IO
+ *  - 队列满时丢帧并计数（视频丢到下一个关键帧），磁盘慢不会反压事件循环
+ *  - 写线程以对齐的大块缓冲区批量写入，可选 O_DIRECT
+ *  - 按时长或大小在关键帧处切分文件，每个文件附带关键帧索引（.idx）
+ *  - 写入中的文件带 .part 后缀，关闭后改名发布，发布的 .flv 不再改动
+ */
+
+#ifndef _FLVRECORDER_H_
+#define _FLVRECORDER_H_
+
+#include "RtmpSink.h"
+#include "../EdoyunNet/SpscQueue.h"
+#include <atomic>
+#include <string>
+#include <vector>
+
+/**
+ * @class FlvRecorder
+ * @brief 单条流的录制器；Send* 接口在推流线程调用，Process 只在所属写线程调用
+ */
+class FlvRecorder : public RtmpSink
+{
+public:
+    using Ptr = std::shared_ptr<FlvRecorder>;
+
+    /**
+     * @brief 构造函数
+     * @param stream_path 流路径，格式 "/app/stream"
+     * @param dir 录制根目录，文件写入 dir/app/stream/
+     * @param max_duration_ms 单个文件最大时长（毫秒），0 表示不按时长切分
+     * @param max_bytes 单个文件最大字节数，0 表示不按大小切分
+     * @param queue_size 待写队列长度（消息数）
+     * @param direct_io 是否以 O_DIRECT 打开文件（文件系统不支持时自动回退）
+     */
+    FlvRecorder(const std::string& stream_path, const std::string& dir, uint32_t max_duration_ms,
+                uint64_t max_bytes, uint32_t queue_size, bool direct_io);
+
+    /**
+     * @brief 析构函数，关闭未结束的文件
+     */
+    virtual ~FlvRecorder();
+
+    // --- RtmpSink 接口重写（推流线程）---
+    virtual bool SendMetaData(RtmpMediaPacket::Ptr meta_data) override;
+    virtual bool SendMediaData(uint8_t type, uint64_t timestamp, std::shared_ptr<char> payload, uint32_t payload_size) override;
+    virtual bool SendMediaPacket(RtmpMediaPacket::Ptr packet) override;   ///< 放入写队列，不阻塞
+    virtual bool IsPlayer() override { return true; }                    ///< 以观看者身份接收音视频
+    virtual bool IsPlaying() override { return is_playing_; }            ///< 是否已收到过媒体消息
+    virtual uint32_t GetId() override { return id_; }                    ///< 内部 ID，不与 socket 冲突
+
+    /**
+     * @brief 推流结束，写线程写完队列中剩余数据后关闭文件
+     */
+    void Stop() { stopped_ = true; }
+
+    /**
+     * @brief 处理写队列（写线程调用）
+     * @param max_messages 本轮最多处理的消息数
+     * @return true 表示处理了数据，队列可能还有剩余
+     */
+    bool Process(uint32_t max_messages);
+
+    /**
+     * @brief 是否已停止且数据全部写完，写线程据此移除录制器
+     */
+    bool IsFinished() const { return finished_; }
+
+    uint64_t GetDroppedMessages() const { return dropped_messages_; }  ///< 队列满丢弃的消息数
+    uint64_t GetWrittenBytes() const { return written_bytes_; }        ///< 已写入磁盘的字节数
+    uint64_t GetWriteErrors() const { return write_errors_; }          ///< 写失败次数
+    uint32_t GetQueueSize() const { return (uint32_t)queue_.Size(); }  ///< 当前积压消息数
+
+    /**
+     * @brief 获取录制统计：写入磁盘的字节数与队列满丢弃的消息数
+     */
+    virtual bool GetSinkStats(SinkStats& stats) override
+    {
+        stats.type = "record";
+        stats.sent_bytes = written_bytes_;
+        stats.dropped_frames = dropped_messages_;
+        return true;
+    }
+    std::string GetStreamPath() const { return stream_path_; }
+
+private:
+    /**
+     * @brief 写入一条消息：更新序列头/元数据，必要时切分文件，追加 FLV tag
+     */
+    void WriteMessage(const RtmpMediaPacket::Ptr& packet);
+
+    /**
+     * @brief 打开新文件并写入 FLV 头、元数据与序列头
+     * @param timestamp 文件首帧时间戳，文件内时间戳以此为 0
+     */
+    bool OpenFile(uint64_t timestamp);
+
+    /**
+     * @brief 写出缓冲区、关闭文件并写入关键帧索引
+     */
+    void CloseFile();
+
+    /**
+     * @brief 追加一个 FLV tag（11 字节头 + 数据 + PreviousTagSize）
+     */
+    void WriteTag(uint8_t type, uint32_t timestamp, const char* data, uint32_t size);
+
+    /**
+     * @brief 追加数据到写缓冲区，缓冲区满时写盘
+     */
+    void Append(const char* data, uint32_t size);
+
+    /**
+     * @brief 写出缓冲区；O_DIRECT 模式下只写对齐部分，final 时关闭 O_DIRECT 写出剩余部分
+     * @param final 是否为关闭文件前的最后一次写出
+     */
+    void Flush(bool final);
+
+    // --- 推流线程 ---
+    SpscQueue<RtmpMediaPacket::Ptr> queue_;   ///< 推流线程到写线程的消息队列
+    bool is_playing_ = false;                 ///< 是否已收到媒体消息
+    bool wait_key_frame_ = false;             ///< 视频丢帧后等待下一个关键帧
+    bool has_video_ = false;                  ///< 是否收到过视频序列头
+
+    // --- 写线程 ---
+    RtmpMediaPacket::Ptr meta_data_;          ///< 元数据 tag，每个文件开头写入
+    RtmpMediaPacket::Ptr avc_sequence_header_;///< 视频序列头，每个文件开头写入
+    RtmpMediaPacket::Ptr aac_sequence_header_;///< 音频序列头，每个文件开头写入
+    int fd_ = -1;                             ///< 当前文件
+    bool direct_ = false;                     ///< 当前文件是否使用 O_DIRECT
+    std::string file_path_;                   ///< 当前文件发布后的路径，写入期间为其加 .part
+    uint64_t file_start_ts_ = 0;              ///< 当前文件首帧时间戳
+    uint64_t file_bytes_ = 0;                 ///< 当前文件已写入（含缓冲区）字节数
+    uint32_t file_index_ = 0;                 ///< 文件序号
+    std::vector<std::pair<uint32_t, uint64_t>> key_frames_;  ///< 关键帧索引（文件内时间戳，偏移）
+    char* buffer_ = nullptr;                  ///< 对齐的写缓冲区
+    uint32_t buffer_used_ = 0;                ///< 写缓冲区已用字节数
+
+    // --- 统计（任意线程读取）---
+    std::atomic<uint64_t> dropped_messages_{0};
+    std::atomic<uint64_t> written_bytes_{0};
+    std::atomic<uint64_t> write_errors_{0};
+    std::atomic_bool stopped_{false};
+    std::atomic_bool finished_{false};
+
+    const std::string stream_path_;           ///< 流路径
+    const std::string dir_;                   ///< 录制目录（含流路径）
+    const uint32_t max_duration_ms_;          ///< 单文件最大时长
+    const uint64_t max_bytes_;                ///< 单文件最大字节数
+    const bool direct_io_;                    ///< 是否请求 O_DIRECT
+    const uint32_t id_;                       ///< 内部 Sink ID
+};
+
+#endif // _FLVRECORDER_H_
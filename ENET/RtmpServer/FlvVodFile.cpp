@@ -0,0 +1,315 @@
+/**
+ * @file FlvVodFile.cpp
+ * @brief 实现 FlvVodFile：文件映射、关键帧索引与共享映射缓存。
+ */
+#include "FlvVodFile.h"
+#include "rtmp.h"
+#include "../EdoyunNet/BufferReader.h"
+#include <algorithm>
+#include <cstdio>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+std::mutex FlvVodFile::cache_mutex_;
+std::unordered_map<std::string, FlvVodFile::CacheEntry> FlvVodFile::cache_;
+
+/**
+ * @brief 打开文件；缓存中的映射在文件大小与修改时间都未变化时直接共享
+ *
+ * 映射与建索引在锁外进行，两个观看者同时打开同一文件时各自加载，先写入缓存的一份被之后的观看者共享。
+ * 录制中的 .part 文件仍在增长，不映射
+ */
+FlvVodFile::Ptr FlvVodFile::Open(const std::string& path)
+{
+    static const std::string kPartSuffix = ".part";
+    if(path.size() >= kPartSuffix.size() && path.compare(path.size() - kPartSuffix.size(), kPartSuffix.size(), kPartSuffix) == 0)
+    {
+        return nullptr;
+    }
+    int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if(fd < 0)
+    {
+        return nullptr;
+    }
+    struct stat st;
+    if(fstat(fd, &st) != 0 || !S_ISREG(st.st_mode) || (uint64_t)st.st_size < kFileHeaderSize + kTagHeaderSize + 4)
+    {
+        ::close(fd);
+        return nullptr;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(cache_mutex_);
+        auto iter = cache_.find(path);
+        if(iter != cache_.end() && iter->second.size == (uint64_t)st.st_size && iter->second.mtime == st.st_mtime)
+        {
+            Ptr file = iter->second.file.lock();
+            if(file)
+            {
+                ::close(fd);
+                return file;
+            }
+        }
+    }
+
+    Ptr file(new FlvVodFile(path));
+    bool ok = file->Load(fd, (uint64_t)st.st_size);
+    ::close(fd);                                  // 映射建立后不再需要描述符
+    if(!ok)
+    {
+        return nullptr;
+    }
+
+    std::lock_guard<std::mutex> lock(cache_mutex_);
+    for(auto iter = cache_.begin(); iter != cache_.end(); )
+    {
+        if(iter->second.file.expired())
+        {
+            iter = cache_.erase(iter);
+        }
+        else
+        {
+            iter++;
+        }
+    }
+    CacheEntry& entry = cache_[path];
+    Ptr cached = entry.file.lock();
+    if(cached && entry.size == (uint64_t)st.st_size && entry.mtime == st.st_mtime)
+    {
+        return cached;
+    }
+    entry.file = file;
+    entry.size = (uint64_t)st.st_size;
+    entry.mtime = st.st_mtime;
+    return file;
+}
+
+/**
+ * @brief 汇总缓存中仍被观看者持有的映射
+ */
+void FlvVodFile::GetCacheStats(size_t& files, uint64_t& bytes)
+{
+    files = 0;
+    bytes = 0;
+    std::lock_guard<std::mutex> lock(cache_mutex_);
+    for(auto &iter : cache_)
+    {
+        Ptr file = iter.second.file.lock();
+        if(file)
+        {
+            files++;
+            bytes += file->mapped_size_;
+        }
+    }
+}
+
+/**
+ * @brief 私有构造函数
+ */
+FlvVodFile::FlvVodFile(const std::string& path)
+    :path_(path)
+{
+}
+
+/**
+ * @brief 析构函数，映射随 mapping_ 的最后一个引用解除
+ */
+FlvVodFile::~FlvVodFile()
+{
+}
+
+/**
+ * @brief 映射文件，建立关键帧索引，并解析开头的元数据与序列头
+ */
+bool FlvVodFile::Load(int fd, uint64_t size)
+{
+    void* addr = ::mmap(nullptr, size, PROT_READ, MAP_SHARED, fd, 0);
+    if(addr == MAP_FAILED)
+    {
+        return false;
+    }
+    mapping_.reset((char*)addr, [size](char* p) { ::munmap(p, size); });
+    mapped_size_ = size;
+    size_ = size;
+
+    // 只接受标准文件头：签名 "FLV"，DataOffset 为 9
+    char* data = mapping_.get();
+    if(data[0] != 'F' || data[1] != 'L' || data[2] != 'V' || ReadUint32BE(data + 5) != 9)
+    {
+        return false;
+    }
+
+    if(!LoadIndex())
+    {
+        BuildIndex();
+    }
+
+    // 开头的元数据与序列头直接引用映射，媒体数据从第一个普通音视频 tag 开始
+    uint64_t offset = kFileHeaderSize;
+    Tag tag;
+    while(ReadTag(offset, tag))
+    {
+        std::shared_ptr<char> payload = GetSlice(offset + kTagHeaderSize);
+        uint8_t flags = tag.data_size > 0 ? (uint8_t)payload.get()[0] : 0;
+        bool is_header = tag.data_size >= 2 && payload.get()[1] == 0;
+        if(tag.type == RTMP_NOTIFY)
+        {
+            if(!meta_data_)
+            {
+                meta_data_ = RtmpMediaPacket::CreateMetaData(payload, tag.data_size);
+            }
+        }
+        else if(tag.type == RTMP_VIDEO && is_header && (flags & 0x0f) == RTMP_CODEC_ID_H264)
+        {
+            avc_sequence_header_ = std::make_shared<RtmpMediaPacket>(RTMP_AVC_SEQUENCE_HEADER, 0, payload, tag.data_size);
+        }
+        else if(tag.type == RTMP_AUDIO && is_header && (flags >> 4) == RTMP_CODEC_ID_AAC)
+        {
+            aac_sequence_header_ = std::make_shared<RtmpMediaPacket>(RTMP_AAC_SEQUENCE_HEADER, 0, payload, tag.data_size);
+        }
+        else
+        {
+            break;
+        }
+        offset += tag.size;
+    }
+    media_offset_ = offset;
+    return media_offset_ < size_;
+}
+
+/**
+ * @brief 加载录制时写出的 .idx；每个偏移都须指向视频关键帧，文件末尾的 tag 须完整，否则改为扫描
+ */
+bool FlvVodFile::LoadIndex()
+{
+    FILE* index = fopen((path_ + ".idx").c_str(), "r");
+    if(!index)
+    {
+        return false;
+    }
+    std::vector<KeyFrame> key_frames;
+    unsigned int timestamp = 0;
+    unsigned long long offset = 0;
+    bool ok = true;
+    while(ok && fscanf(index, "%u %llu", &timestamp, &offset) == 2)
+    {
+        Tag tag;
+        ok = ReadTag(offset, tag) && IsKeyFrame(offset, tag)
+          && (key_frames.empty() || (timestamp >= key_frames.back().timestamp && offset > key_frames.back().offset));
+        KeyFrame key_frame;
+        key_frame.timestamp = timestamp;
+        key_frame.offset = offset;
+        key_frames.push_back(key_frame);
+    }
+    fclose(index);
+
+    // 由最后一个 PreviousTagSize 定位最后一个 tag，确认文件完整并取得时长
+    uint32_t last_size = ReadUint32BE(mapping_.get() + mapped_size_ - 4);
+    Tag last;
+    if(!ok || key_frames.empty() || last_size + 4 > mapped_size_ - kFileHeaderSize
+    || !ReadTag(mapped_size_ - 4 - last_size, last) || last.size != last_size + 4)
+    {
+        return false;
+    }
+    duration_ = last.timestamp;
+    key_frames_.swap(key_frames);
+    return true;
+}
+
+/**
+ * @brief 顺序扫描 tag：记录视频关键帧，遇到不完整或无效的 tag 时截断（文件可能仍在写入）
+ */
+void FlvVodFile::BuildIndex()
+{
+    key_frames_.clear();
+    uint64_t offset = kFileHeaderSize;
+    Tag tag;
+    while(ReadTag(offset, tag))
+    {
+        if(IsKeyFrame(offset, tag) && (key_frames_.empty() || tag.timestamp >= key_frames_.back().timestamp))
+        {
+            KeyFrame key_frame;
+            key_frame.timestamp = tag.timestamp;
+            key_frame.offset = offset;
+            key_frames_.push_back(key_frame);
+        }
+        duration_ = std::max(duration_, tag.timestamp);
+        offset += tag.size;
+    }
+    size_ = offset;
+}
+
+/**
+ * @brief 解析 tag 头部，tag 须完整位于有效数据内
+ */
+bool FlvVodFile::ReadTag(uint64_t offset, Tag& tag) const
+{
+    if(offset + kTagHeaderSize + 4 > size_)
+    {
+        return false;
+    }
+    char* p = mapping_.get() + offset;
+    tag.type = (uint8_t)p[0] & 0x1f;
+    tag.data_size = ReadUint24BE(p + 1);
+    tag.timestamp = ReadUint24BE(p + 4) | ((uint32_t)(uint8_t)p[7] << 24);
+    tag.size = kTagHeaderSize + tag.data_size + 4;
+    if(tag.type != RTMP_AUDIO && tag.type != RTMP_VIDEO && tag.type != RTMP_NOTIFY)
+    {
+        return false;
+    }
+    return offset + tag.size <= size_;
+}
+
+/**
+ * @brief 视频 tag 的 FrameType 为 1，且不是 AVC 序列头
+ */
+bool FlvVodFile::IsKeyFrame(uint64_t offset, const Tag& tag) const
+{
+    if(tag.type != RTMP_VIDEO || tag.data_size < 2)
+    {
+        return false;
+    }
+    const char* data = mapping_.get() + offset + kTagHeaderSize;
+    bool is_header = (data[0] & 0x0f) == RTMP_CODEC_ID_H264 && data[1] == 0;
+    return ((uint8_t)data[0] >> 4) == 1 && !is_header;
+}
+
+/**
+ * @brief 二分查找时间戳不晚于 timestamp 的最后一个关键帧
+ */
+bool FlvVodFile::FindKeyFrame(uint32_t timestamp, KeyFrame& key_frame) const
+{
+    if(key_frames_.empty())
+    {
+        return false;
+    }
+    auto iter = std::upper_bound(key_frames_.begin(), key_frames_.end(), timestamp,
+                                 [](uint32_t value, const KeyFrame& item) { return value < item.timestamp; });
+    key_frame = (iter == key_frames_.begin()) ? *iter : *(iter - 1);
+    return true;
+}
+
+/**
+ * @brief 别名构造：指向映射内的 offset，与映射共用引用计数
+ */
+std::shared_ptr<char> FlvVodFile::GetSlice(uint64_t offset) const
+{
+    return std::shared_ptr<char>(mapping_, mapping_.get() + offset);
+}
+
+/**
+ * @brief 提示内核异步预读，避免发送时在事件循环线程上同步缺页
+ */
+void FlvVodFile::Prefetch(uint64_t offset, uint64_t size) const
+{
+    if(offset >= size_)
+    {
+        return;
+    }
+    long page_size = sysconf(_SC_PAGESIZE);
+    uint64_t begin = offset / page_size * page_size;
+    uint64_t end = std::min(offset + size, size_);
+    ::madvise(mapping_.get() + begin, end - begin, MADV_WILLNEED);
+}
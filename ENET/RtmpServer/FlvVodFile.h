@@ -0,0 +1,158 @@
+/**
+ * @file FlvVodFile.h
+ * @brief 点播文件：以只读 mmap 映射 FLV 文件，提供关键帧索引与按 tag 切片的零拷贝访问。
+ *
+ * 主要职责：
+ *  - 映射整个文件，发送的 tag 数据是映射上的别名指针，观看者发送队列直接引用映射，不经过用户态拷贝
+ *  - 优先加载录制时写出的同名 .idx 关键帧索引，缺失或与文件不符时扫描 tag 重建，按时间戳二分查找
+ *  - 解析文件开头的元数据与 AVC/AAC 序列头，封装为共享的媒体消息，所有观看者共用其分片结果
+ *  - 按路径缓存已映射的文件，同一文件的观看者共享一份映射，文件大小或修改时间变化时重新映射
+ *
+ * 映射以 MAP_SHARED 建立，文件在映射期间被截断时访问截断部分会触发 SIGBUS，因此只打开已发布、不再改动的文件：
+ * FlvRecorder 写入中的文件带 .part 后缀，关闭后改名发布，Open 拒绝 .part 文件；其他工具写入点播目录时也应先写临时名再改名。
+ */
+
+#ifndef _FLVVODFILE_H_
+#define _FLVVODFILE_H_
+
+#include "RtmpMediaPacket.h"
+#include <ctime>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+/**
+ * @class FlvVodFile
+ * @brief 一个已映射的 FLV 文件，打开后只读，可跨线程共享
+ */
+class FlvVodFile
+{
+public:
+    using Ptr = std::shared_ptr<FlvVodFile>;
+
+    /** FLV 文件头（9 字节）加 PreviousTagSize0 */
+    static const uint32_t kFileHeaderSize = 13;
+    /** tag 头部长度 */
+    static const uint32_t kTagHeaderSize = 11;
+
+    /** 文件中的一个 tag */
+    struct Tag
+    {
+        uint8_t type = 0;           ///< tag 类型：8 音频、9 视频、18 脚本
+        uint32_t timestamp = 0;     ///< 时间戳（毫秒，含扩展字节）
+        uint32_t data_size = 0;     ///< tag 数据长度
+        uint32_t size = 0;          ///< tag 总长度：头部 + 数据 + PreviousTagSize
+    };
+
+    /** 关键帧索引项 */
+    struct KeyFrame
+    {
+        uint32_t timestamp = 0;     ///< 关键帧时间戳（毫秒）
+        uint64_t offset = 0;        ///< 关键帧 tag 在文件中的偏移
+    };
+
+    /**
+     * @brief 打开并映射文件，已映射且未变化的文件直接共享
+     * @param path 文件路径
+     * @return 文件，不存在、仍在录制（.part）或不是有效的 FLV 文件时返回 nullptr
+     */
+    static Ptr Open(const std::string& path);
+
+    /**
+     * @brief 析构函数，解除映射
+     */
+    ~FlvVodFile();
+
+    /**
+     * @brief 读取 offset 处的 tag 头部
+     * @param offset tag 在文件中的偏移
+     * @param tag 输出 tag 信息
+     * @return false 表示越界、tag 不完整或类型无效
+     */
+    bool ReadTag(uint64_t offset, Tag& tag) const;
+
+    /**
+     * @brief 查找不晚于 timestamp 的最后一个关键帧，O(log n)
+     * @param timestamp 目标时间（毫秒）
+     * @param key_frame 输出关键帧，目标早于首个关键帧时取首个关键帧
+     * @return false 表示文件没有关键帧（纯音频），应从媒体数据起点开始
+     */
+    bool FindKeyFrame(uint32_t timestamp, KeyFrame& key_frame) const;
+
+    /**
+     * @brief 取文件中一段数据的别名指针，与映射共用引用计数
+     * @param offset 起始偏移
+     * @return 指向映射内 offset 处的指针，持有期间映射不会解除
+     */
+    std::shared_ptr<char> GetSlice(uint64_t offset) const;
+
+    /**
+     * @brief 提示内核预读一段数据（madvise WILLNEED），不阻塞
+     * @param offset 起始偏移
+     * @param size 长度
+     */
+    void Prefetch(uint64_t offset, uint64_t size) const;
+
+    const std::string& GetPath() const { return path_; }
+    uint64_t GetSize() const { return size_; }                      ///< 有效数据长度（不含末尾不完整的 tag）
+    uint64_t GetMediaOffset() const { return media_offset_; }       ///< 首个非序列头音视频 tag 的偏移
+    uint32_t GetDuration() const { return duration_; }              ///< 最后一个 tag 的时间戳（毫秒）
+    size_t GetKeyFrameCount() const { return key_frames_.size(); }
+    RtmpMediaPacket::Ptr GetMetaData() const { return meta_data_; }
+    RtmpMediaPacket::Ptr GetAvcSequenceHeader() const { return avc_sequence_header_; }
+    RtmpMediaPacket::Ptr GetAacSequenceHeader() const { return aac_sequence_header_; }
+
+    /**
+     * @brief 当前共享映射的文件数与映射总字节数
+     */
+    static void GetCacheStats(size_t& files, uint64_t& bytes);
+
+private:
+    FlvVodFile(const std::string& path);
+
+    /**
+     * @brief 映射文件并解析文件头、开头的元数据与序列头
+     */
+    bool Load(int fd, uint64_t size);
+
+    /**
+     * @brief 加载 .idx 关键帧索引，每行 "时间戳 偏移"，偏移须指向视频关键帧 tag
+     */
+    bool LoadIndex();
+
+    /**
+     * @brief 扫描全部 tag 建立关键帧索引，并截掉末尾不完整的 tag
+     */
+    void BuildIndex();
+
+    /**
+     * @brief 判断 tag 是否为视频关键帧（不含序列头）
+     */
+    bool IsKeyFrame(uint64_t offset, const Tag& tag) const;
+
+    /** 缓存项：映射按文件大小与修改时间区分版本 */
+    struct CacheEntry
+    {
+        std::weak_ptr<FlvVodFile> file;
+        uint64_t size = 0;
+        time_t mtime = 0;
+    };
+
+    static std::mutex cache_mutex_;                                      ///< 保护 cache_
+    static std::unordered_map<std::string, CacheEntry> cache_;           ///< 路径到已映射文件
+
+    std::string path_;                          ///< 文件路径
+    std::shared_ptr<char> mapping_;             ///< 映射区，析构时 munmap
+    uint64_t mapped_size_ = 0;                  ///< 映射长度
+    uint64_t size_ = 0;                         ///< 有效数据长度
+    uint64_t media_offset_ = kFileHeaderSize;   ///< 媒体数据起点
+    uint32_t duration_ = 0;                     ///< 时长（毫秒）
+    std::vector<KeyFrame> key_frames_;          ///< 按时间戳升序的关键帧索引
+    RtmpMediaPacket::Ptr meta_data_;            ///< 文件开头的元数据，无则为空
+    RtmpMediaPacket::Ptr avc_sequence_header_;  ///< 视频序列头，无则为空
+    RtmpMediaPacket::Ptr aac_sequence_header_;  ///< 音频序列头，无则为空
+};
+
+#endif // _FLVVODFILE_H_
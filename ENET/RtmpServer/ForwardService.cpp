@@ -0,0 +1,233 @@
+/**
+ * @file ForwardService.cpp
+ * @brief 实现 ForwardService：转发连接的生命周期与重连。
+ */
+#include "ForwardService.h"
+#include "RtmpServer.h"
+#include "../EdoyunNet/EventLoop.h"
+#include <cstdio>
+#include <cstdlib>
+
+/** 转发连接断开后的重连延迟（毫秒） */
+static const uint32_t kReconnectMs = 1000;
+
+/**
+ * @brief 静态工厂方法，创建转发服务并订阅推流事件
+ */
+std::shared_ptr<ForwardService> ForwardService::Create(EventLoop* eventloop, std::shared_ptr<RtmpServer> rtmp_server,
+                                                       const std::vector<std::string>& targets)
+{
+    std::shared_ptr<ForwardService> service(new ForwardService(eventloop, rtmp_server, targets));
+    std::weak_ptr<ForwardService> weak_service = service;
+    rtmp_server->SetEventCallback([weak_service](std::string type, std::string stream_path){
+        if(auto forward_service = weak_service.lock())
+        {
+            forward_service->OnStreamEvent(type, stream_path);
+        }
+    });
+    return service;
+}
+
+/**
+ * @brief 私有构造函数，解析下游地址
+ */
+ForwardService::ForwardService(EventLoop* eventloop, std::shared_ptr<RtmpServer> rtmp_server, const std::vector<std::string>& targets)
+    :loop_(eventloop)
+    ,rtmp_server_(rtmp_server)
+{
+    for(auto &target : targets)
+    {
+        size_t pos = target.rfind(':');
+        std::string ip = target.substr(0, pos);
+        int port = pos == std::string::npos ? 1935 : atoi(target.c_str() + pos + 1);
+        if(ip.empty() || port <= 0 || port > 65535)
+        {
+            printf("[Forward] invalid target %s\n", target.c_str());
+            continue;
+        }
+        targets_.emplace_back(ip, (uint16_t)port);
+    }
+}
+
+/**
+ * @brief 析构函数：断开所有转发连接
+ */
+ForwardService::~ForwardService()
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    for(auto &iter : pushers_)
+    {
+        for(auto &pusher : iter.second)
+        {
+            if(pusher)
+            {
+                pusher->Stop();
+            }
+        }
+    }
+    pushers_.clear();
+}
+
+/**
+ * @brief 设置转发队列参数
+ */
+void ForwardService::SetQueueOptions(const RtmpPusher::QueueOptions& options)
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    queue_options_ = options;
+}
+
+/**
+ * @brief 汇总统计
+ */
+ForwardService::Stats ForwardService::GetStats()
+{
+    Stats stats;
+    std::lock_guard<std::mutex> lock(mutex_);
+    stats.reconnects = reconnects_;
+    for(auto &iter : pushers_)
+    {
+        stats.streams++;
+        for(auto &pusher : iter.second)
+        {
+            if(!pusher)
+            {
+                continue;
+            }
+            stats.pushers++;
+            if(pusher->HasStarted() && !pusher->IsClosed())
+            {
+                stats.connected++;
+            }
+            RtmpMediaQueue::Stats queue_stats = pusher->GetQueueStats();
+            if(queue_stats.lag_ms > stats.max_lag_ms)
+            {
+                stats.max_lag_ms = queue_stats.lag_ms;
+            }
+            stats.dropped_video += queue_stats.dropped_video;
+            stats.dropped_audio += queue_stats.dropped_audio;
+            stats.dropped_bytes += queue_stats.dropped_bytes;
+            stats.gop_skips += queue_stats.gop_skips;
+        }
+    }
+    return stats;
+}
+
+/**
+ * @brief 推流开始时为每个下游建立转发连接，结束时全部断开
+ *
+ * 与 RecordService 相同，事件回调在 RtmpServer 的锁内执行，会话操作转到 0 号调度线程
+ */
+void ForwardService::OnStreamEvent(const std::string& type, const std::string& stream_path)
+{
+    bool is_start = type == "publish.start";
+    if(!is_start && type != "publish,stop")
+    {
+        return;
+    }
+
+    std::weak_ptr<ForwardService> weak_service = shared_from_this();
+    loop_->GetTaskSchduler(0)->AddReadyTask([weak_service, is_start, stream_path](){
+        auto service = weak_service.lock();
+        if(!service)
+        {
+            return;
+        }
+        auto rtmp_server = service->rtmp_server_.lock();
+        RtmpSession::Ptr session = rtmp_server ? rtmp_server->FindSession(stream_path) : nullptr;
+
+        std::lock_guard<std::mutex> lock(service->mutex_);
+        auto iter = service->pushers_.find(stream_path);
+        if(iter != service->pushers_.end())
+        {
+            for(auto &pusher : iter->second)
+            {
+                if(pusher)
+                {
+                    pusher->Stop();                   // 关闭回调发现槽位已不属于它，不会重连
+                }
+            }
+            service->pushers_.erase(iter);
+        }
+
+        if(is_start && session && !service->targets_.empty())
+        {
+            std::vector<RtmpPusher::Ptr>& pushers = service->pushers_[stream_path];
+            pushers.resize(service->targets_.size());
+            for(size_t i = 0; i < pushers.size(); i++)
+            {
+                pushers[i] = service->CreatePusher(session, stream_path, i);
+            }
+        }
+    });
+}
+
+/**
+ * @brief 为流的第 index 个下游建立转发连接
+ *
+ * 转发连接优先放在会话所属的调度线程，分发时无需跨线程中继
+ */
+RtmpPusher::Ptr ForwardService::CreatePusher(RtmpSession::Ptr session, const std::string& stream_path, size_t index)
+{
+    auto rtmp_server = rtmp_server_.lock();
+    if(!rtmp_server)
+    {
+        return nullptr;
+    }
+    TaskScheduler* scheduler = session->GetScheduler();
+    if(!scheduler)
+    {
+        scheduler = loop_->GetTaskSchduler().get();
+    }
+
+    std::weak_ptr<ForwardService> weak_service = shared_from_this();
+    const std::pair<std::string, uint16_t>& target = targets_[index];
+    RtmpPusher::Ptr pusher = RtmpPusher::Create(scheduler, target.first, target.second, stream_path, session,
+                                                rtmp_server->GetChunkSize(), queue_options_,
+                                                [weak_service, index](RtmpPusher::Ptr pusher){
+        if(auto service = weak_service.lock())
+        {
+            service->OnPusherStop(pusher, index);
+        }
+    });
+    if(!pusher)
+    {
+        printf("[Forward] connect %s:%u%s failed\n", target.first.c_str(), target.second, stream_path.c_str());
+    }
+    return pusher;
+}
+
+/**
+ * @brief 转发连接断开后延迟重连
+ *
+ * 关闭回调在连接的 Close 中执行，不能在此释放连接的最后一个引用，
+ * 槽位的清理与重连都放到定时器中进行；连接创建失败的槽位保持为空，等下次推流
+ */
+void ForwardService::OnPusherStop(RtmpPusher::Ptr pusher, size_t index)
+{
+    std::weak_ptr<ForwardService> weak_service = shared_from_this();
+    loop_->AddTimer([weak_service, pusher, index](){
+        auto service = weak_service.lock();
+        if(!service)
+        {
+            return false;
+        }
+        auto rtmp_server = service->rtmp_server_.lock();
+        std::string stream_path = pusher->GetStreamPath();
+        RtmpSession::Ptr session = rtmp_server ? rtmp_server->FindSession(stream_path) : nullptr;
+
+        std::lock_guard<std::mutex> lock(service->mutex_);
+        auto iter = service->pushers_.find(stream_path);
+        if(iter == service->pushers_.end() || index >= iter->second.size() || iter->second[index] != pusher)
+        {
+            return false;                             // 推流已结束或已重新开始
+        }
+        iter->second[index].reset();
+        if(session && session->HasPublisher())
+        {
+            service->reconnects_++;
+            iter->second[index] = service->CreatePusher(session, stream_path, index);
+        }
+        return false;
+    }, kReconnectMs);
+}
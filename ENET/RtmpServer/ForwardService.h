@@ -0,0 +1,99 @@
+/**
+ * @file ForwardService.h
+ * @brief 推流转发服务：推流开始时为每个下游地址创建一条 RtmpPusher，推流结束时断开。
+ *
+ * 每条流的每个下游各占一个槽位，连接断开后若推流仍在继续则 1 秒后重连；
+ * 每条转发连接有独立的队列，一个下游变慢只会让它自己丢帧，不影响推流端与其他下游。
+ */
+
+#ifndef _FORWARDSERVICE_H_
+#define _FORWARDSERVICE_H_
+
+#include "RtmpPusher.h"
+#include "RtmpSession.h"
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+class EventLoop;
+class RtmpServer;
+
+/**
+ * @class ForwardService
+ * @brief 管理转发连接的创建、重连与停止
+ */
+class ForwardService : public std::enable_shared_from_this<ForwardService>
+{
+public:
+    /** 转发统计 */
+    struct Stats
+    {
+        uint32_t streams = 0;           ///< 正在转发的流数
+        uint32_t pushers = 0;           ///< 转发连接数（含连接中）
+        uint32_t connected = 0;         ///< 下游已接受 publish 的连接数
+        uint64_t reconnects = 0;        ///< 累计重连次数
+        uint32_t max_lag_ms = 0;        ///< 各连接中最大的队列积压（毫秒）
+        uint64_t dropped_video = 0;     ///< 当前连接累计丢弃的视频帧数
+        uint64_t dropped_audio = 0;     ///< 当前连接累计丢弃的音频帧数
+        uint64_t dropped_bytes = 0;     ///< 当前连接累计丢弃的字节数
+        uint64_t gop_skips = 0;         ///< 当前连接累计跳到下一个关键帧的次数
+    };
+
+    /**
+     * @brief 创建转发服务并注册 RtmpServer 的推流事件回调
+     * @param eventloop 事件循环
+     * @param rtmp_server 提供会话的 RTMP 服务
+     * @param targets 下游地址列表，格式 "ip:port"，省略端口时为 1935
+     * @return 转发服务共享指针
+     */
+    static std::shared_ptr<ForwardService> Create(EventLoop* eventloop, std::shared_ptr<RtmpServer> rtmp_server,
+                                                  const std::vector<std::string>& targets);
+
+    /**
+     * @brief 析构函数，断开所有转发连接
+     */
+    ~ForwardService();
+
+    /**
+     * @brief 设置转发队列的丢帧阈值与补充水位，对之后建立的连接生效
+     * @param options 队列参数
+     */
+    void SetQueueOptions(const RtmpPusher::QueueOptions& options);
+
+    /**
+     * @brief 汇总转发连接的统计
+     * @return 统计信息
+     */
+    Stats GetStats();
+
+private:
+    ForwardService(EventLoop* eventloop, std::shared_ptr<RtmpServer> rtmp_server, const std::vector<std::string>& targets);
+
+    /**
+     * @brief 推流开始/结束事件，转到 0 号调度线程处理
+     */
+    void OnStreamEvent(const std::string& type, const std::string& stream_path);
+
+    /**
+     * @brief 为流的第 index 个下游建立转发连接（调用者持有 mutex_）
+     */
+    RtmpPusher::Ptr CreatePusher(RtmpSession::Ptr session, const std::string& stream_path, size_t index);
+
+    /**
+     * @brief 转发连接断开：延迟后仍在推流则重连，否则清空槽位
+     */
+    void OnPusherStop(RtmpPusher::Ptr pusher, size_t index);
+
+    EventLoop* loop_;                                                ///< 事件循环
+    std::weak_ptr<RtmpServer> rtmp_server_;                          ///< 提供会话的 RTMP 服务
+    std::vector<std::pair<std::string, uint16_t>> targets_;          ///< 下游地址
+    RtmpPusher::QueueOptions queue_options_;                         ///< 转发队列参数
+    std::mutex mutex_;                                               ///< 保护 pushers_ 与 reconnects_
+    std::unordered_map<std::string, std::vector<RtmpPusher::Ptr>> pushers_;  ///< 流路径 -> 各下游的转发连接
+    uint64_t reconnects_ = 0;                                        ///< 累计重连次数
+};
+
+#endif // _FORWARDSERVICE_H_
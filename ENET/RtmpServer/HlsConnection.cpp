@@ -0,0 +1,288 @@
+/**
+ * @file HlsConnection.cpp
+ * @brief 实现 HlsConnection：请求路由、阻塞式刷新与零拷贝响应。
+ */
+#include "HlsConnection.h"
+#include "HlsPackager.h"
+#include "HlsServer.h"
+#include <cstdio>
+#include <cstdlib>
+#include <sstream>
+#include <strings.h>
+
+/** 请求头最大长度，超过时视为无效请求 */
+static const uint32_t kMaxRequestSize = 8192;
+
+/**
+ * @brief 构造函数，注册读回调与关闭回调
+ */
+HlsConnection::HlsConnection(std::shared_ptr<HlsServer> hls_server, TaskScheduler* scheduler, int socket)
+    :TcpConnection(scheduler, socket)
+    ,hls_server_(hls_server)
+{
+    this->SetReadCallback([this](std::shared_ptr<TcpConnection> conn, BufferReader& buffer){
+        return this->OnRead(buffer);
+    });
+    this->SetCloseCallback([this](std::shared_ptr<TcpConnection> conn){
+        pending_request_ = 0;
+    });
+}
+
+/**
+ * @brief 析构函数
+ */
+HlsConnection::~HlsConnection()
+{
+}
+
+/**
+ * @brief 依次处理缓冲区中的完整请求；阻塞式刷新未响应前保留后续请求
+ * @param buffer 输入缓冲区
+ * @return false 表示需要断开连接
+ */
+bool HlsConnection::OnRead(BufferReader& buffer)
+{
+    while(pending_request_ == 0 && buffer.ReadableBytes() > 0)
+    {
+        std::string data(buffer.Peek(), buffer.ReadableBytes());
+        size_t pos = data.find("\r\n\r\n");
+        if(pos == std::string::npos)
+        {
+            if(data.size() > kMaxRequestSize)
+            {
+                SendErrorResponse(400, "Bad Request");
+                return false;
+            }
+            return true;                              // 请求头不完整，等待更多数据
+        }
+        buffer.Retrieve(pos + 4);
+        if(!HandleRequest(data.substr(0, pos)))
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+/**
+ * @brief 路由请求：/app/stream.m3u8、/app/stream/<msn>.ts、/app/stream/<msn>.<part>.ts
+ * @param request 请求头（不含结尾空行）
+ * @return false 表示需要断开连接
+ */
+bool HlsConnection::HandleRequest(const std::string& request)
+{
+    auto server = hls_server_.lock();
+    if(!server)
+    {
+        return false;
+    }
+
+    std::istringstream stream(request);
+    std::string method, url, version;
+    stream >> method >> url >> version;
+
+    // HTTP/1.1 默认长连接，HTTP/1.0 或 "Connection: close" 时响应后断开
+    keep_alive_ = version == "HTTP/1.1";
+    std::string line;
+    while(std::getline(stream, line))
+    {
+        if(line.size() > 11 && strncasecmp(line.c_str(), "connection:", 11) == 0)
+        {
+            keep_alive_ = line.find("close") == std::string::npos && line.find("Close") == std::string::npos;
+        }
+    }
+
+    if(method != "GET")
+    {
+        SendErrorResponse(405, "Method Not Allowed");
+        return false;
+    }
+
+    std::string query;
+    size_t query_pos = url.find('?');
+    if(query_pos != std::string::npos)
+    {
+        query = url.substr(query_pos + 1);
+        url = url.substr(0, query_pos);
+    }
+
+    const std::string playlist_suffix = ".m3u8";
+    const std::string segment_suffix = ".ts";
+    if(url.size() > playlist_suffix.size() + 1
+       && url.compare(url.size() - playlist_suffix.size(), playlist_suffix.size(), playlist_suffix) == 0)
+    {
+        std::string stream_path = url.substr(0, url.size() - playlist_suffix.size());
+        auto packager = server->FindPackager(stream_path);
+        if(!packager)
+        {
+            server->RequestStream(stream_path);       // 推流在其他工作进程或需要回源时建立拉流，客户端重试后即可播放
+            SendErrorResponse(404, "Not Found");
+            return keep_alive_;
+        }
+        HandlePlaylist(packager, query);
+        return keep_alive_ || pending_request_ != 0;
+    }
+
+    size_t slash = url.rfind('/');
+    if(slash == std::string::npos || slash == 0 || url.size() <= segment_suffix.size()
+       || url.compare(url.size() - segment_suffix.size(), segment_suffix.size(), segment_suffix) != 0)
+    {
+        SendErrorResponse(404, "Not Found");
+        return keep_alive_;
+    }
+
+    // 文件名为 "<msn>.ts" 或 "<msn>.<part>.ts"
+    auto packager = server->FindPackager(url.substr(0, slash));
+    std::string name = url.substr(slash + 1, url.size() - slash - 1 - segment_suffix.size());
+    char* end = nullptr;
+    uint64_t sequence = strtoull(name.c_str(), &end, 10);
+    HlsPackager::Data data;
+    if(packager && end != name.c_str())
+    {
+        if(*end == '\0')
+        {
+            data = packager->GetSegment(sequence);
+        }
+        else if(*end == '.')
+        {
+            const char* part = end + 1;
+            uint32_t index = (uint32_t)strtoul(part, &end, 10);
+            if(end != part && *end == '\0')
+            {
+                data = packager->GetPart(sequence, index);
+            }
+        }
+    }
+    if(!data)
+    {
+        SendErrorResponse(404, "Not Found");
+        return keep_alive_;
+    }
+
+    // 切片内容不再变化，允许 CDN 缓存
+    SendResponse("video/mp2t", "max-age=60", data);
+    return keep_alive_;
+}
+
+/**
+ * @brief 处理播放列表请求
+ * @param packager 打包器
+ * @param query 查询参数
+ */
+void HlsConnection::HandlePlaylist(std::shared_ptr<HlsPackager> packager, const std::string& query)
+{
+    int64_t sequence = -1;
+    int64_t part = -1;
+    if(!GetQueryValue(query, "_HLS_msn", sequence) || sequence < 0)
+    {
+        SendPlaylist(packager, 0);
+        return;
+    }
+    GetQueryValue(query, "_HLS_part", part);
+
+    uint64_t request_id = next_request_++;
+    pending_request_ = request_id;
+    std::weak_ptr<TcpConnection> weak_conn = shared_from_this();
+    std::weak_ptr<HlsPackager> weak_packager = packager;
+    auto respond = [weak_conn, weak_packager, request_id](){
+        auto conn = weak_conn.lock();
+        auto packager = weak_packager.lock();
+        if(conn && packager)
+        {
+            std::static_pointer_cast<HlsConnection>(conn)->SendPlaylist(packager, request_id);
+        }
+    };
+
+    if(!packager->WaitFor((uint64_t)sequence, (int32_t)part, respond))
+    {
+        pending_request_ = 0;
+        SendErrorResponse(400, "Bad Request");
+        return;
+    }
+
+    // 最多阻塞 3 个切片时长，超时后返回当前播放列表
+    if(pending_request_ == request_id)
+    {
+        GetTaskSchduler()->AddTimer([respond](){
+            respond();
+            return false;
+        }, packager->GetSegmentDuration() * 3);
+    }
+}
+
+/**
+ * @brief 发送播放列表；阻塞式刷新请求由先到的回调（分片完成或超时）响应
+ * @param packager 打包器
+ * @param request_id 请求序号，0 表示普通请求
+ */
+void HlsConnection::SendPlaylist(std::shared_ptr<HlsPackager> packager, uint64_t request_id)
+{
+    if(request_id != 0)
+    {
+        uint64_t expected = request_id;
+        if(!pending_request_.compare_exchange_strong(expected, 0))
+        {
+            return;                                   // 已响应或连接已关闭
+        }
+    }
+
+    HlsPackager::Data playlist;
+    if(!packager->GetPlaylist(playlist))
+    {
+        SendErrorResponse(404, "Not Found");
+        return;
+    }
+    SendResponse("application/vnd.apple.mpegurl", "no-cache", playlist);
+}
+
+/**
+ * @brief 发送 200 响应
+ */
+void HlsConnection::SendResponse(const char* content_type, const char* cache_control, std::shared_ptr<const std::string> body)
+{
+    char header[512] = {0};
+    int size = snprintf(header, sizeof(header),
+                        "HTTP/1.1 200 OK\r\n"
+                        "Content-Type: %s\r\n"
+                        "Content-Length: %u\r\n"
+                        "Cache-Control: %s\r\n"
+                        "Access-Control-Allow-Origin: *\r\n"
+                        "Connection: %s\r\n\r\n",
+                        content_type, (uint32_t)body->size(), cache_control, keep_alive_ ? "keep-alive" : "close");
+    this->Send(header, (uint32_t)size);
+
+    // 别名构造：发送队列持有共享切片的引用，多个连接发送同一份数据不拷贝
+    std::shared_ptr<char> data(std::const_pointer_cast<std::string>(body), const_cast<char*>(body->data()));
+    this->Send(data, (uint32_t)body->size());
+}
+
+/**
+ * @brief 发送错误响应
+ */
+void HlsConnection::SendErrorResponse(int code, const char* reason)
+{
+    char response[256] = {0};
+    int size = snprintf(response, sizeof(response),
+                        "HTTP/1.1 %d %s\r\nContent-Length: 0\r\nAccess-Control-Allow-Origin: *\r\nConnection: %s\r\n\r\n",
+                        code, reason, keep_alive_ ? "keep-alive" : "close");
+    this->Send(response, (uint32_t)size);
+}
+
+/**
+ * @brief 从 "a=1&b=2" 形式的查询参数中读取整数
+ */
+bool HlsConnection::GetQueryValue(const std::string& query, const char* name, int64_t& value)
+{
+    std::string key = std::string(name) + "=";
+    size_t pos = 0;
+    while((pos = query.find(key, pos)) != std::string::npos)
+    {
+        if(pos == 0 || query[pos - 1] == '&')
+        {
+            value = strtoll(query.c_str() + pos + key.size(), nullptr, 10);
+            return true;
+        }
+        pos += key.size();
+    }
+    return false;
+}
@@ -0,0 +1,99 @@
+/**
+ * @file HlsConnection.h
+ * @brief HLS 的 HTTP 连接：解析请求，返回打包器中缓存的播放列表与切片。
+ *
+ * 支持 HTTP/1.1 长连接；LL-HLS 阻塞式刷新请求在分片生成或超时后才响应，
+ * 等待期间到达的后续请求留在缓冲区，在下一次读事件时处理。
+ */
+
+#ifndef _HLSCONNECTION_H_
+#define _HLSCONNECTION_H_
+
+#include "../EdoyunNet/TcpConnection.h"
+#include <atomic>
+#include <memory>
+#include <string>
+
+class HlsServer;
+class HlsPackager;
+
+/**
+ * @class HlsConnection
+ * @brief 继承自 TcpConnection，处理 .m3u8 与 .ts 请求，切片以零拷贝方式发送
+ */
+class HlsConnection : public TcpConnection
+{
+public:
+    /**
+     * @brief 构造函数
+     * @param hls_server 提供打包器查找的 HLS 服务
+     * @param scheduler 调度器
+     * @param socket 底层 TCP 套接字
+     */
+    HlsConnection(std::shared_ptr<HlsServer> hls_server, TaskScheduler* scheduler, int socket);
+
+    /**
+     * @brief 析构函数
+     */
+    virtual ~HlsConnection();
+
+private:
+    /**
+     * @brief 读取并依次处理完整的请求
+     * @param buffer 输入缓冲区
+     * @return false 表示需要断开连接
+     */
+    bool OnRead(BufferReader& buffer);
+
+    /**
+     * @brief 处理一个请求
+     * @param request 请求头（不含结尾空行）
+     * @return false 表示需要断开连接
+     */
+    bool HandleRequest(const std::string& request);
+
+    /**
+     * @brief 处理播放列表请求，带 _HLS_msn 时注册阻塞式刷新
+     * @param packager 打包器
+     * @param query 查询参数
+     */
+    void HandlePlaylist(std::shared_ptr<HlsPackager> packager, const std::string& query);
+
+    /**
+     * @brief 阻塞式刷新条件满足或超时后发送播放列表，同一请求只响应一次
+     * @param packager 打包器
+     * @param request_id 请求序号
+     */
+    void SendPlaylist(std::shared_ptr<HlsPackager> packager, uint64_t request_id);
+
+    /**
+     * @brief 发送 200 响应，响应体以零拷贝方式引用共享数据
+     * @param content_type Content-Type
+     * @param cache_control Cache-Control
+     * @param body 响应体
+     */
+    void SendResponse(const char* content_type, const char* cache_control, std::shared_ptr<const std::string> body);
+
+    /**
+     * @brief 发送错误响应
+     * @param code HTTP 状态码
+     * @param reason 状态描述
+     */
+    void SendErrorResponse(int code, const char* reason);
+
+    /**
+     * @brief 从查询参数中读取整数值
+     * @param query 查询参数
+     * @param name 参数名
+     * @param value 输出值
+     * @return true 参数存在
+     */
+    static bool GetQueryValue(const std::string& query, const char* name, int64_t& value);
+
+    std::weak_ptr<HlsServer> hls_server_;       ///< 所属 HLS 服务
+    bool keep_alive_ = true;                    ///< 当前请求是否保持连接
+    std::atomic<uint64_t> pending_request_{0};  ///< 等待中的阻塞式刷新请求序号，0 表示没有
+    uint64_t next_request_ = 1;                 ///< 下一个阻塞式刷新请求序号
+};
+
+#endif // _HLSCONNECTION_H_
@@ -0,0 +1,439 @@
+/**
+ * @file HlsPackager.cpp
+ * @brief 实现 HlsPackager：切片/分片切分、内存环形队列与 m3u8 生成。
+ */
+#include "HlsPackager.h"
+#include "rtmp.h"
+#include <cstdio>
+
+/** 播放列表之外额外保留的切片数，正在下载旧切片的客户端不会 404 */
+static const uint32_t kExtraSegments = 2;
+/** 保留分片的切片数（从最新切片往前），更早切片的分片从播放列表中移除 */
+static const uint32_t kPartSegments = 3;
+/** 长时间没有关键帧时，切片超过目标时长的该倍数后强制切分 */
+static const uint32_t kMaxSegmentFactor = 4;
+/** 阻塞式刷新允许超前直播点的切片数 */
+static const uint64_t kMaxSequenceAhead = 2;
+
+/**
+ * @brief 构造函数
+ */
+HlsPackager::HlsPackager(const std::string& stream_path, uint32_t segment_ms, uint32_t part_ms, uint32_t window)
+    :stream_name_(GetStreamName(stream_path))
+    ,segment_ms_(segment_ms > 0 ? segment_ms : 2000)
+    ,part_ms_(part_ms < segment_ms_ ? part_ms : 0)
+    ,window_(window > 0 ? window : 6)
+    ,id_(AllocInternalId())
+{
+    target_duration_ = (segment_ms_ + 999) / 1000;
+}
+
+/**
+ * @brief 析构函数
+ */
+HlsPackager::~HlsPackager()
+{
+}
+
+/**
+ * @brief 取流路径最后一段作为切片 URI 前缀，"/app/stream" -> "stream"
+ */
+std::string HlsPackager::GetStreamName(const std::string& stream_path)
+{
+    size_t pos = stream_path.rfind('/');
+    return pos == std::string::npos ? stream_path : stream_path.substr(pos + 1);
+}
+
+/**
+ * @brief 封装为媒体消息后按共享路径处理
+ */
+bool HlsPackager::SendMediaData(uint8_t type, uint64_t timestamp, std::shared_ptr<char> payload, uint32_t payload_size)
+{
+    return SendMediaPacket(std::make_shared<RtmpMediaPacket>(type, timestamp, payload, payload_size));
+}
+
+/**
+ * @brief 复用一帧：序列头更新复用器参数；有视频的流在关键帧处切分切片，
+ *        在分片时长即将超过 PART-TARGET 的视频帧处切分分片
+ * @param packet 媒体消息
+ * @return true 始终保持在会话中
+ */
+bool HlsPackager::SendMediaPacket(RtmpMediaPacket::Ptr packet)
+{
+    is_playing_ = true;
+    uint8_t type = packet->GetType();
+    const char* data = packet->GetPayload().get();
+    uint32_t size = packet->GetSize();
+    if(data == nullptr || size == 0)
+    {
+        return true;
+    }
+    if(type == RTMP_AVC_SEQUENCE_HEADER)
+    {
+        muxer_.SetAvcSequenceHeader(data, size);
+        return true;
+    }
+    if(type == RTMP_AAC_SEQUENCE_HEADER)
+    {
+        muxer_.SetAacSequenceHeader(data, size);
+        return true;
+    }
+
+    bool is_video = type == RTMP_VIDEO;
+    if((is_video && !muxer_.HasVideo()) || (type == RTMP_AUDIO && !muxer_.HasAudio()) || (!is_video && type != RTMP_AUDIO))
+    {
+        return true;                                  // 未收到序列头或不支持的编码
+    }
+
+    uint64_t timestamp = packet->GetTimestamp();
+    bool key_frame = is_video && packet->IsKeyFrame();
+    if(!started_)
+    {
+        if(muxer_.HasVideo() && !key_frame)
+        {
+            return true;                              // 有视频的流从关键帧开始
+        }
+        started_ = true;
+        segment_start_ts_ = timestamp;
+        StartPart(timestamp, key_frame);
+    }
+    else
+    {
+        uint64_t segment_elapsed = timestamp > segment_start_ts_ ? timestamp - segment_start_ts_ : 0;
+        uint64_t part_elapsed = timestamp > part_start_ts_ ? timestamp - part_start_ts_ : 0;
+        bool can_cut = muxer_.HasVideo() ? key_frame : true;
+        if((can_cut && segment_elapsed >= segment_ms_) || segment_elapsed >= (uint64_t)segment_ms_ * kMaxSegmentFactor)
+        {
+            FinishPart(timestamp);
+            FinishSegment(timestamp);
+            segment_start_ts_ = timestamp;
+            StartPart(timestamp, key_frame);
+        }
+        else if(part_ms_ > 0 && (is_video || !muxer_.HasVideo()) && part_elapsed + frame_interval_ > part_ms_)
+        {
+            FinishPart(timestamp);
+            StartPart(timestamp, key_frame);
+        }
+    }
+
+    if(is_video)
+    {
+        if(timestamp > last_video_ts_ && timestamp - last_video_ts_ < 1000)
+        {
+            frame_interval_ = (uint32_t)(timestamp - last_video_ts_);
+        }
+        last_video_ts_ = timestamp;
+        muxer_.WriteVideo(data, size, timestamp, part_data_);
+    }
+    else
+    {
+        muxer_.WriteAudio(data, size, timestamp, part_data_);
+    }
+    if(timestamp > last_ts_)
+    {
+        last_ts_ = timestamp;
+    }
+    return true;
+}
+
+/**
+ * @brief 开始新的分片，每个分片以 PAT/PMT 开头，可单独解析
+ */
+void HlsPackager::StartPart(uint64_t timestamp, bool independent)
+{
+    part_data_.clear();
+    muxer_.WriteTables(part_data_);
+    part_start_ts_ = timestamp;
+    part_independent_ = independent;
+}
+
+/**
+ * @brief 结束当前分片，发布后唤醒等待该分片的阻塞式刷新请求
+ */
+void HlsPackager::FinishPart(uint64_t timestamp)
+{
+    Part part;
+    part.data = std::make_shared<const std::string>(std::move(part_data_));
+    part.duration = (uint32_t)(timestamp > part_start_ts_ ? timestamp - part_start_ts_ : 0);
+    part.independent = part_independent_;
+    part_data_ = std::string();
+
+    std::vector<WaitCallback> ready;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        open_parts_.push_back(part);
+        if(part_ms_ > 0)
+        {
+            UpdatePlaylist(ready);                    // 普通 HLS 的播放列表只在切片完成时变化
+        }
+    }
+    for(auto &cb : ready)
+    {
+        cb();
+    }
+}
+
+/**
+ * @brief 结束当前切片：各分片拼接为完整切片，超出窗口的切片移出队列
+ */
+void HlsPackager::FinishSegment(uint64_t timestamp)
+{
+    std::vector<WaitCallback> ready;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        Segment segment;
+        segment.sequence = next_sequence_++;
+        segment.duration = (uint32_t)(timestamp > segment_start_ts_ ? timestamp - segment_start_ts_ : 0);
+
+        if(open_parts_.size() == 1)
+        {
+            segment.data = open_parts_[0].data;       // 普通 HLS 每个切片只有一个分片，直接共享
+        }
+        else
+        {
+            size_t total = 0;
+            for(auto &part : open_parts_)
+            {
+                total += part.data->size();
+            }
+            std::shared_ptr<std::string> data = std::make_shared<std::string>();
+            data->reserve(total);
+            for(auto &part : open_parts_)
+            {
+                data->append(*part.data);
+            }
+            segment.data = data;
+        }
+        if(part_ms_ > 0)
+        {
+            segment.parts = std::move(open_parts_);
+        }
+        open_parts_.clear();
+        segments_.push_back(std::move(segment));
+
+        while(segments_.size() > window_ + kExtraSegments)
+        {
+            segments_.pop_front();
+        }
+        // 只有最近几个切片在播放列表中列出分片，更早的分片释放内存
+        if(segments_.size() > kPartSegments)
+        {
+            segments_[segments_.size() - kPartSegments - 1].parts.clear();
+        }
+        UpdatePlaylist(ready);
+    }
+    for(auto &cb : ready)
+    {
+        cb();
+    }
+}
+
+/**
+ * @brief 推流结束，输出剩余数据并结束播放列表
+ */
+void HlsPackager::Close()
+{
+    if(started_ && part_data_.size() > 0)
+    {
+        FinishPart(last_ts_);
+        FinishSegment(last_ts_);
+        started_ = false;
+    }
+
+    std::vector<WaitCallback> ready;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        closed_ = true;
+        UpdatePlaylist(ready);
+    }
+    for(auto &cb : ready)
+    {
+        cb();
+    }
+}
+
+/**
+ * @brief 判断等待条件：切片已完成，或当前切片已有足够的分片，或流已结束
+ */
+bool HlsPackager::IsReady(uint64_t sequence, int32_t part) const
+{
+    if(closed_ || sequence < next_sequence_)
+    {
+        return true;
+    }
+    return sequence == next_sequence_ && part >= 0 && (uint32_t)part < open_parts_.size();
+}
+
+/**
+ * @brief 生成播放列表。LL-HLS 模式下最近的切片与当前切片列出 EXT-X-PART
+ */
+void HlsPackager::UpdatePlaylist(std::vector<WaitCallback>& ready)
+{
+    if(segments_.empty() && open_parts_.empty())
+    {
+        playlist_.reset();
+        return;
+    }
+
+    size_t first = segments_.size() > window_ ? segments_.size() - window_ : 0;
+    for(size_t i = first; i < segments_.size(); i++)
+    {
+        uint32_t seconds = (segments_[i].duration + 999) / 1000;
+        if(seconds > target_duration_)
+        {
+            target_duration_ = seconds;               // 只增不减，关键帧间隔超过目标时长时放宽
+        }
+    }
+
+    char line[256];
+    std::string playlist = "#EXTM3U\n";
+    playlist += part_ms_ > 0 ? "#EXT-X-VERSION:9\n" : "#EXT-X-VERSION:3\n";
+    snprintf(line, sizeof(line), "#EXT-X-TARGETDURATION:%u\n", target_duration_);
+    playlist += line;
+    uint64_t media_sequence = first < segments_.size() ? segments_[first].sequence : next_sequence_;
+    snprintf(line, sizeof(line), "#EXT-X-MEDIA-SEQUENCE:%llu\n", (unsigned long long)media_sequence);
+    playlist += line;
+    if(part_ms_ > 0)
+    {
+        snprintf(line, sizeof(line), "#EXT-X-SERVER-CONTROL:CAN-BLOCK-RELOAD=YES,PART-HOLD-BACK=%.3f\n", part_ms_ * 3 / 1000.0);
+        playlist += line;
+        snprintf(line, sizeof(line), "#EXT-X-PART-INF:PART-TARGET=%.3f\n", part_ms_ / 1000.0);
+        playlist += line;
+    }
+
+    auto append_parts = [&](uint64_t sequence, const std::vector<Part>& parts) {
+        for(size_t i = 0; i < parts.size(); i++)
+        {
+            snprintf(line, sizeof(line), "#EXT-X-PART:DURATION=%.3f,URI=\"%s/%llu.%u.ts\"%s\n",
+                     parts[i].duration / 1000.0, stream_name_.c_str(), (unsigned long long)sequence,
+                     (uint32_t)i, parts[i].independent ? ",INDEPENDENT=YES" : "");
+            playlist += line;
+        }
+    };
+
+    for(size_t i = first; i < segments_.size(); i++)
+    {
+        const Segment& segment = segments_[i];
+        append_parts(segment.sequence, segment.parts);
+        snprintf(line, sizeof(line), "#EXTINF:%.3f,\n%s/%llu.ts\n",
+                 segment.duration / 1000.0, stream_name_.c_str(), (unsigned long long)segment.sequence);
+        playlist += line;
+    }
+    if(part_ms_ > 0 && !closed_)
+    {
+        append_parts(next_sequence_, open_parts_);
+    }
+    if(closed_)
+    {
+        playlist += "#EXT-X-ENDLIST\n";
+    }
+    playlist_ = std::make_shared<const std::string>(std::move(playlist));
+
+    for(auto iter = waiters_.begin(); iter != waiters_.end(); )
+    {
+        if(IsReady(iter->sequence, iter->part))
+        {
+            ready.push_back(std::move(iter->cb));
+            iter = waiters_.erase(iter);
+        }
+        else
+        {
+            iter++;
+        }
+    }
+}
+
+/**
+ * @brief 获取缓存的播放列表，多个请求共享同一份
+ */
+bool HlsPackager::GetPlaylist(Data& playlist)
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    if(!playlist_ || segments_.empty())
+    {
+        return false;                                 // 至少有一个完整切片后才可播放
+    }
+    playlist = playlist_;
+    return true;
+}
+
+/**
+ * @brief 按序号查找完整切片
+ */
+HlsPackager::Data HlsPackager::GetSegment(uint64_t sequence)
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    if(segments_.empty() || sequence < segments_.front().sequence || sequence > segments_.back().sequence)
+    {
+        return nullptr;
+    }
+    return segments_[sequence - segments_.front().sequence].data;
+}
+
+/**
+ * @brief 按序号查找分片，包括当前未完成切片中已完成的分片
+ */
+HlsPackager::Data HlsPackager::GetPart(uint64_t sequence, uint32_t part)
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    const std::vector<Part>* parts = nullptr;
+    if(sequence == next_sequence_)
+    {
+        parts = &open_parts_;
+    }
+    else if(!segments_.empty() && sequence >= segments_.front().sequence && sequence <= segments_.back().sequence)
+    {
+        parts = &segments_[sequence - segments_.front().sequence].parts;
+    }
+    if(parts == nullptr || part >= parts->size())
+    {
+        return nullptr;
+    }
+    return (*parts)[part].data;
+}
+
+/**
+ * @brief 注册阻塞式刷新请求
+ */
+bool HlsPackager::WaitFor(uint64_t sequence, int32_t part, const WaitCallback& cb)
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if(!IsReady(sequence, part))
+        {
+            if(sequence > next_sequence_ + kMaxSequenceAhead)
+            {
+                return false;
+            }
+            waiters_.push_back(Waiter{sequence, part, cb});
+            return true;
+        }
+    }
+    cb();
+    return true;
+}
+
+/**
+ * @brief 统计环形队列占用的内存
+ */
+uint64_t HlsPackager::GetBufferedBytes()
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    uint64_t bytes = 0;
+    for(auto &segment : segments_)
+    {
+        bytes += segment.data->size();
+        if(segment.parts.size() > 1)
+        {
+            for(auto &part : segment.parts)
+            {
+                bytes += part.data->size();
+            }
+        }
+    }
+    for(auto &part : open_parts_)
+    {
+        bytes += part.data->size();
+    }
+    return bytes;
+}
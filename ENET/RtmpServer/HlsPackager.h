@@ -0,0 +1,187 @@
+/**
+ * @file HlsPackager.h
+ * @brief HLS / LL-HLS 打包器，作为内部观看者加入 RtmpSession，在内存中生成切片与播放列表。
+ *
+ * 主要职责：
+ *  - 每条流只打包一次，与 HTTP 观看者数量无关
+ *  - 将 FLV 负载复用为 MPEG-TS，按关键帧切分切片，按 PART-TARGET 切分 LL-HLS 分片
+ *  - 在有界环形队列中保存最近的切片，不落盘
+ *  - 生成 m3u8 播放列表，支持 LL-HLS 阻塞式刷新（_HLS_msn/_HLS_part）
+ */
+
+#ifndef _HLSPACKAGER_H_
+#define _HLSPACKAGER_H_
+
+#include "RtmpSink.h"
+#include "TsMuxer.h"
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <vector>
+
+/**
+ * @class HlsPackager
+ * @brief 订阅一条流的内部 RtmpSink，媒体数据在发布者线程中复用，切片由 HTTP 线程并发读取
+ */
+class HlsPackager : public RtmpSink
+{
+public:
+    using Ptr = std::shared_ptr<HlsPackager>;
+    using Data = std::shared_ptr<const std::string>;
+    using WaitCallback = std::function<void()>;
+
+    /**
+     * @brief 构造函数
+     * @param stream_path 流路径，格式 "/app/stream"
+     * @param segment_ms 切片目标时长（毫秒），在该时长后的第一个关键帧处切分
+     * @param part_ms LL-HLS 分片目标时长（毫秒），0 表示只生成普通 HLS
+     * @param window 播放列表中的切片数量
+     */
+    HlsPackager(const std::string& stream_path, uint32_t segment_ms, uint32_t part_ms, uint32_t window);
+
+    /**
+     * @brief 析构函数
+     */
+    virtual ~HlsPackager();
+
+    // --- RtmpSink 接口重写 ---
+    virtual bool SendMediaData(uint8_t type, uint64_t timestamp, std::shared_ptr<char> payload, uint32_t payload_size) override;
+    virtual bool SendMediaPacket(RtmpMediaPacket::Ptr packet) override;   ///< 复用一帧到当前分片
+    virtual bool IsPlayer() override { return true; }                    ///< 以观看者身份接收音视频
+    virtual bool IsPlaying() override { return is_playing_; }            ///< 是否已收到过媒体消息
+    virtual uint32_t GetId() override { return id_; }                    ///< 内部 ID，不与 socket 冲突
+
+    /**
+     * @brief 获取当前播放列表
+     * @param playlist 输出播放列表
+     * @return false 表示还没有可播放的切片
+     */
+    bool GetPlaylist(Data& playlist);
+
+    /**
+     * @brief 获取完整切片
+     * @param sequence 切片序号（Media Sequence Number）
+     * @return 切片数据，已移出环形队列或不存在时为 nullptr
+     */
+    Data GetSegment(uint64_t sequence);
+
+    /**
+     * @brief 获取 LL-HLS 分片
+     * @param sequence 所属切片序号
+     * @param part 分片在切片内的序号
+     * @return 分片数据，不存在时为 nullptr
+     */
+    Data GetPart(uint64_t sequence, uint32_t part);
+
+    /**
+     * @brief LL-HLS 阻塞式刷新：等待指定切片/分片生成后回调
+     *
+     * 条件已满足时立即回调；回调可能在发布者线程执行，且不持有打包器的锁
+     * @param sequence 等待的切片序号（_HLS_msn）
+     * @param part 等待的分片序号（_HLS_part），-1 表示等待整个切片
+     * @param cb 条件满足或流结束时的回调
+     * @return false 表示请求的切片超出直播点过远，应返回 400
+     */
+    bool WaitFor(uint64_t sequence, int32_t part, const WaitCallback& cb);
+
+    /**
+     * @brief 推流结束：输出最后一个切片，播放列表加 EXT-X-ENDLIST，唤醒所有等待者
+     */
+    void Close();
+
+    /**
+     * @brief 获取切片目标时长
+     * @return 毫秒
+     */
+    uint32_t GetSegmentDuration() const { return segment_ms_; }
+
+    /**
+     * @brief 获取环形队列中切片与分片占用的总字节数
+     * @return 字节数
+     */
+    uint64_t GetBufferedBytes();
+
+private:
+    /** LL-HLS 分片 */
+    struct Part
+    {
+        Data data;
+        uint32_t duration = 0;       ///< 时长（毫秒）
+        bool independent = false;    ///< 是否以关键帧开始
+    };
+
+    /** 完整切片，data 为各分片拼接 */
+    struct Segment
+    {
+        uint64_t sequence = 0;
+        uint32_t duration = 0;       ///< 时长（毫秒）
+        Data data;
+        std::vector<Part> parts;     ///< 只为最近几个切片保留，用于播放列表中的 EXT-X-PART
+    };
+
+    struct Waiter
+    {
+        uint64_t sequence;
+        int32_t part;
+        WaitCallback cb;
+    };
+
+    /**
+     * @brief 开始新的分片，写入 PAT/PMT
+     */
+    void StartPart(uint64_t timestamp, bool independent);
+
+    /**
+     * @brief 结束当前分片并发布到播放列表
+     */
+    void FinishPart(uint64_t timestamp);
+
+    /**
+     * @brief 结束当前切片：拼接分片、加入环形队列、淘汰过期切片
+     */
+    void FinishSegment(uint64_t timestamp);
+
+    /**
+     * @brief 重新生成播放列表并取出已满足条件的等待者（调用者持有 mutex_）
+     * @param ready 输出需要回调的等待者
+     */
+    void UpdatePlaylist(std::vector<WaitCallback>& ready);
+
+    /**
+     * @brief 判断等待条件是否已满足（调用者持有 mutex_）
+     */
+    bool IsReady(uint64_t sequence, int32_t part) const;
+
+    static std::string GetStreamName(const std::string& stream_path);
+
+    // --- 以下只在发布者线程访问 ---
+    TsMuxer muxer_;                         ///< TS 复用器
+    std::string part_data_;                 ///< 正在写入的分片
+    uint64_t part_start_ts_ = 0;            ///< 当前分片起始时间戳
+    bool part_independent_ = false;         ///< 当前分片是否以关键帧开始
+    uint64_t segment_start_ts_ = 0;         ///< 当前切片起始时间戳
+    uint64_t last_video_ts_ = 0;            ///< 上一个视频帧时间戳
+    uint32_t frame_interval_ = 0;           ///< 最近的视频帧间隔，用于保证分片不超过 PART-TARGET
+    uint64_t last_ts_ = 0;                  ///< 最后一帧时间戳
+    bool started_ = false;                  ///< 是否已开始第一个切片
+    bool is_playing_ = false;               ///< 是否已收到媒体消息
+
+    // --- 以下由 mutex_ 保护，HTTP 线程读取 ---
+    std::mutex mutex_;
+    std::deque<Segment> segments_;          ///< 已完成切片的环形队列
+    std::vector<Part> open_parts_;          ///< 当前切片已完成的分片
+    uint64_t next_sequence_ = 0;            ///< 当前切片的序号
+    Data playlist_;                         ///< 缓存的播放列表
+    std::vector<Waiter> waiters_;           ///< 阻塞式刷新的等待者
+    uint32_t target_duration_ = 0;          ///< EXT-X-TARGETDURATION（秒）
+    bool closed_ = false;                   ///< 推流是否已结束
+
+    const std::string stream_name_;         ///< 切片 URI 前缀
+    const uint32_t segment_ms_;             ///< 切片目标时长（毫秒）
+    const uint32_t part_ms_;                ///< 分片目标时长（毫秒）
+    const uint32_t window_;                 ///< 播放列表切片数
+    const uint32_t id_;                     ///< 内部 Sink ID
+};
+
+#endif // _HLSPACKAGER_H_
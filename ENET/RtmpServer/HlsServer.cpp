@@ -0,0 +1,161 @@
+/**
+ * @file HlsServer.cpp
+ * @brief 实现 HlsServer：打包器的创建/移除与连接分发。
+ */
+#include "HlsServer.h"
+#include "HlsConnection.h"
+#include "HlsPackager.h"
+#include "RtmpServer.h"
+#include "../EdoyunNet/EventLoop.h"
+#include <unistd.h>
+
+/**
+ * @brief 静态工厂方法，创建 HLS 服务实例并订阅推流事件
+ * @param eventloop 事件循环
+ * @param rtmp_server RTMP 服务
+ * @return HLS 服务共享指针
+ */
+std::shared_ptr<HlsServer> HlsServer::Create(EventLoop* eventloop, std::shared_ptr<RtmpServer> rtmp_server)
+{
+    std::shared_ptr<HlsServer> server(new HlsServer(eventloop, rtmp_server));
+    std::weak_ptr<HlsServer> weak_server = server;
+    rtmp_server->SetEventCallback([weak_server](std::string type, std::string stream_path){
+        if(auto hls_server = weak_server.lock())
+        {
+            hls_server->OnStreamEvent(type, stream_path);
+        }
+    });
+    return server;
+}
+
+/**
+ * @brief 私有构造函数
+ */
+HlsServer::HlsServer(EventLoop* eventloop, std::shared_ptr<RtmpServer> rtmp_server)
+    :TcpServer(eventloop)
+    ,loop_(eventloop)
+    ,rtmp_server_(rtmp_server)
+{
+}
+
+/**
+ * @brief 析构函数，结束所有打包器
+ */
+HlsServer::~HlsServer()
+{
+    packagers_.ForEach([](const std::string& stream_path, const std::shared_ptr<HlsPackager>& packager){
+        packager->Close();
+    });
+}
+
+/**
+ * @brief 设置切片参数
+ */
+void HlsServer::SetSegment(uint32_t segment_ms, uint32_t part_ms, uint32_t window)
+{
+    segment_ms_ = segment_ms;
+    part_ms_ = part_ms;
+    window_ = window;
+}
+
+/**
+ * @brief 查找打包器
+ */
+std::shared_ptr<HlsPackager> HlsServer::FindPackager(const std::string& stream_path)
+{
+    std::shared_ptr<HlsPackager> packager;
+    packagers_.Find(stream_path, packager);
+    return packager;
+}
+
+/**
+ * @brief 请求中继或回源，会话就绪后在 0 号调度线程创建打包器
+ */
+void HlsServer::RequestStream(const std::string& stream_path)
+{
+    auto rtmp_server = rtmp_server_.lock();
+    if(!rtmp_server)
+    {
+        return;
+    }
+
+    std::weak_ptr<HlsServer> weak_server = shared_from_this();
+    rtmp_server->RouteStream(stream_path, [weak_server, stream_path](RtmpSession::Ptr session){
+        auto server = weak_server.lock();
+        if(!server || !session)
+        {
+            return;
+        }
+        server->loop_->GetTaskSchduler(0)->AddReadyTask([weak_server, stream_path, session](){
+            auto server = weak_server.lock();
+            if(!server || server->FindPackager(stream_path))
+            {
+                return;
+            }
+            auto packager = std::make_shared<HlsPackager>(stream_path, server->segment_ms_, server->part_ms_, server->window_);
+            server->packagers_.GetOrCreate(stream_path, [packager](){
+                return packager;
+            });
+            session->AddSink(packager);                   // 拉流连接开始下发后收到序列头和缓存的 GOP
+        });
+    });
+}
+
+/**
+ * @brief 推流开始/结束与拉流连接关闭事件，转到 0 号调度线程处理
+ */
+void HlsServer::OnStreamEvent(const std::string& type, const std::string& stream_path)
+{
+    bool is_start = type == "publish.start";
+    bool is_pull_stop = type == "pull.stop";
+    if(!is_start && !is_pull_stop && type != "publish,stop")
+    {
+        return;
+    }
+
+    std::weak_ptr<HlsServer> weak_server = shared_from_this();
+    loop_->GetTaskSchduler(0)->AddReadyTask([weak_server, is_start, is_pull_stop, stream_path](){
+        auto server = weak_server.lock();
+        if(!server)
+        {
+            return;
+        }
+        auto rtmp_server = server->rtmp_server_.lock();
+        RtmpSession::Ptr session = rtmp_server ? rtmp_server->FindSession(stream_path) : nullptr;
+        if(is_pull_stop && session && session->HasPublisher())
+        {
+            return;                                   // 本地已有推流，打包器由推流事件管理
+        }
+
+        // 同一路径重新推流时先结束旧的打包器
+        std::shared_ptr<HlsPackager> packager = server->FindPackager(stream_path);
+        if(packager)
+        {
+            server->packagers_.Erase(stream_path);
+            if(session)
+            {
+                session->RemoveSink(packager);
+            }
+            packager->Close();
+        }
+
+        if(is_start && session)
+        {
+            packager = std::make_shared<HlsPackager>(stream_path, server->segment_ms_, server->part_ms_, server->window_);
+            server->packagers_.GetOrCreate(stream_path, [packager](){
+                return packager;
+            });
+            session->AddSink(packager);               // 推流线程在下一帧之前下发序列头和缓存的 GOP
+        }
+    });
+}
+
+/**
+ * @brief TCP 新连接回调，创建 HlsConnection 处理该连接
+ * @param socket 新连接的 socket 描述符
+ * @return 对应的 HlsConnection 智能指针
+ */
+TcpConnection::Ptr HlsServer::OnConnect(int socket)
+{
+    return std::make_shared<HlsConnection>(shared_from_this(), loop_->GetTaskSchduler().get(), socket);
+}
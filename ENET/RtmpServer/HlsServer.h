@@ -0,0 +1,100 @@
+/**
+ * @file HlsServer.h
+ * @brief HLS / LL-HLS 服务：推流开始时为每条流创建一个 HlsPackager，通过 HTTP 提供播放列表与切片。
+ *
+ * 请求格式：
+ *  - GET /app/stream.m3u8[?_HLS_msn=N&_HLS_part=M]   播放列表（LL-HLS 支持阻塞式刷新）
+ *  - GET /app/stream/<msn>.ts                         完整切片
+ *  - GET /app/stream/<msn>.<part>.ts                  LL-HLS 分片
+ * 切片只保存在内存中，每条流只打包一次，HTTP 连接共享同一份切片数据。
+ * 本进程没有推流的流（多进程模式下推流在其他工作进程，或边缘模式）在首次请求播放列表时中继或回源，
+ * 取得会话后再创建打包器，之前的请求返回 404。
+ */
+
+#ifndef _HLSSERVER_H_
+#define _HLSSERVER_H_
+
+#include "../EdoyunNet/TcpServer.h"
+#include "../EdoyunNet/SnapshotMap.h"
+#include <memory>
+#include <string>
+
+class RtmpServer;
+class HlsPackager;
+
+/**
+ * @class HlsServer
+ * @brief 基于 TcpServer 的 HLS 监听服务，订阅 RtmpServer 的推流事件管理打包器
+ */
+class HlsServer : public TcpServer, public std::enable_shared_from_this<HlsServer>
+{
+public:
+    /**
+     * @brief 创建 HLS 服务实例，并注册 RtmpServer 的推流事件回调
+     * @param eventloop 事件循环，通常与 RtmpServer 相同
+     * @param rtmp_server 提供会话的 RTMP 服务
+     * @return HLS 服务共享指针
+     */
+    static std::shared_ptr<HlsServer> Create(EventLoop* eventloop, std::shared_ptr<RtmpServer> rtmp_server);
+
+    /**
+     * @brief 析构函数
+     */
+    ~HlsServer();
+
+    /**
+     * @brief 设置切片参数，对之后开始的推流生效
+     * @param segment_ms 切片目标时长（毫秒）
+     * @param part_ms LL-HLS 分片目标时长（毫秒），0 表示只提供普通 HLS
+     * @param window 播放列表中的切片数
+     */
+    void SetSegment(uint32_t segment_ms, uint32_t part_ms, uint32_t window);
+
+    /**
+     * @brief 查找流对应的打包器
+     * @param stream_path 流路径，格式 "/app/stream"
+     * @return 打包器，流未推送时为 nullptr
+     */
+    std::shared_ptr<HlsPackager> FindPackager(const std::string& stream_path);
+
+    /**
+     * @brief 本进程没有该流的打包器时，经 RtmpServer::RouteStream 中继或回源，取得会话后创建打包器
+     *
+     * 打包器以观看者身份加入会话，拉流连接在上游推流结束前一直保持；
+     * 拉流连接关闭（"pull.stop"）且本地没有推流时移除打包器
+     * @param stream_path 流路径
+     */
+    void RequestStream(const std::string& stream_path);
+
+private:
+    /**
+     * @brief 私有构造，仅通过 Create() 调用
+     */
+    HlsServer(EventLoop* eventloop, std::shared_ptr<RtmpServer> rtmp_server);
+
+    /**
+     * @brief 推流开始时创建打包器并加入会话，推流结束或拉流连接关闭时移除
+     *
+     * 事件回调在 RtmpServer 的锁内执行，操作会话前转到固定的调度线程，
+     * 避免与会话锁形成环，同时保证同一条流的开始/结束按顺序处理
+     * @param type 事件类型
+     * @param stream_path 流路径
+     */
+    void OnStreamEvent(const std::string& type, const std::string& stream_path);
+
+    /**
+     * @brief TCP 新连接回调，创建 HlsConnection
+     * @param socket 新连接的 socket 描述符
+     * @return 连接对象
+     */
+    virtual TcpConnection::Ptr OnConnect(int socket) override;
+
+    EventLoop* loop_;                                                   ///< 事件循环
+    std::weak_ptr<RtmpServer> rtmp_server_;                             ///< 提供会话的 RTMP 服务
+    SnapshotMap<std::string, std::shared_ptr<HlsPackager>> packagers_;  ///< 流路径到打包器的映射，查找无锁
+    uint32_t segment_ms_ = 2000;                                        ///< 切片目标时长（毫秒）
+    uint32_t part_ms_ = 500;                                            ///< LL-HLS 分片目标时长（毫秒）
+    uint32_t window_ = 6;                                               ///< 播放列表切片数
+};
+
+#endif // _HLSSERVER_H_
@@ -0,0 +1,610 @@
+/**
+ * @file HttpFlvConnection.cpp
+ * @brief 实现 HttpFlvConnection：HTTP 请求解析、FLV 头与共享 FLV tag 的发送。
+ */
+#include "HttpFlvConnection.h"
+#include "RenditionSwitcher.h"
+#include "FlvVodFile.h"
+#include "VodPlayer.h"
+#include "TimeShiftPlayer.h"
+#include "rtmp.h"
+#include "RtmpServer.h"
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <sstream>
+
+/** 请求头最大长度，超过时视为无效请求 */
+static const uint32_t kMaxRequestSize = 8192;
+/** 点播时每次发送的最大连续 tag 字节数 */
+static const uint32_t kMaxVodRunBytes = 256 * 1024;
+/** 点播发送完毕后检查发送队列是否清空的周期（毫秒） */
+static const uint32_t kVodCloseCheckInterval = 100;
+
+/**
+ * @brief 读取查询参数中的数值（秒）并换算为毫秒
+ * @param url 请求地址
+ * @param query 查询参数起始位置（'?' 的下标）
+ * @param name 参数名，含 '='
+ * @return 毫秒数，参数不存在或不大于 0 时返回 0
+ */
+static uint32_t GetQueryMs(const std::string& url, size_t query, const char* name)
+{
+    size_t pos = url.find(name, query);
+    while(pos != std::string::npos && url[pos - 1] != '?' && url[pos - 1] != '&')
+    {
+        pos = url.find(name, pos + 1);
+    }
+    if(pos == std::string::npos)
+    {
+        return 0;
+    }
+    double seconds = atof(url.c_str() + pos + strlen(name));
+    return seconds > 0 ? (uint32_t)(seconds * 1000) : 0;
+}
+
+/**
+ * @brief 构造函数，注册读回调与关闭回调
+ */
+HttpFlvConnection::HttpFlvConnection(std::shared_ptr<RtmpServer> rtmp_server, TaskScheduler* scheduler, int socket, bool chunked)
+    :TcpConnection(scheduler, socket)
+    ,rtmp_server_(rtmp_server)
+    ,chunked_(chunked)
+{
+    this->SetReadCallback([this](std::shared_ptr<TcpConnection> conn, BufferReader& buffer){
+        return this->OnRead(buffer);
+    });
+    this->SetCloseCallback([this](std::shared_ptr<TcpConnection> conn){
+        this->OnClose();
+    });
+}
+
+/**
+ * @brief 析构函数
+ */
+HttpFlvConnection::~HttpFlvConnection()
+{
+}
+
+/**
+ * @brief 读取请求头，遇到空行后处理请求
+ * @param buffer 输入缓冲区
+ * @return false 表示需要断开连接
+ */
+bool HttpFlvConnection::OnRead(BufferReader& buffer)
+{
+    if(is_player_ || is_routing_)
+    {
+        buffer.RetrieveAll();   // 请求已受理后客户端不应再发送数据，直接丢弃
+        return true;
+    }
+
+    std::string data(buffer.Peek(), buffer.ReadableBytes());
+    size_t pos = data.find("\r\n\r\n");
+    if(pos == std::string::npos)
+    {
+        if(data.size() > kMaxRequestSize)
+        {
+            SendErrorResponse(400, "Bad Request");
+            return false;
+        }
+        return true;            // 请求头不完整，等待更多数据
+    }
+    buffer.RetrieveAll();
+    return HandleRequest(data.substr(0, pos));
+}
+
+/**
+ * @brief 连接关闭时从会话中移除，延迟到下一轮执行以避免在会话锁内回调
+ */
+void HttpFlvConnection::OnClose()
+{
+    if(time_shift_player_)
+    {
+        time_shift_player_->Stop();
+        time_shift_player_.reset();
+        auto server = rtmp_server_.lock();
+        if(server)
+        {
+            server->NotifyEvent("play.stop", stream_path_);
+        }
+    }
+    if(vod_player_)
+    {
+        vod_player_->Stop();
+        vod_player_.reset();
+        auto server = rtmp_server_.lock();
+        if(server)
+        {
+            server->NotifyEvent("play.stop", stream_path_);
+        }
+    }
+
+    auto session = rtmp_session_.lock();
+    if(session && is_player_)
+    {
+        auto sink = std::dynamic_pointer_cast<RtmpSink>(shared_from_this());
+        auto switcher = rendition_switcher_;
+        GetTaskSchduler()->AddTimer([session, sink, switcher](){
+            session->RemoveSink(sink);
+            if(switcher)
+            {
+                switcher->Stop();
+            }
+            return false;
+        }, 1);
+
+        auto server = rtmp_server_.lock();
+        if(server)
+        {
+            server->NotifyEvent("play.stop", stream_path_);
+        }
+    }
+    is_player_ = false;
+    rendition_switcher_.reset();
+    media_queue_.Clear();
+}
+
+/**
+ * @brief 解析 "GET /app/stream.flv HTTP/1.1"，找到流或点播文件后由 StartPlay 开始发送
+ * @param request 请求头（不含结尾空行）
+ * @return false 表示请求无效
+ */
+bool HttpFlvConnection::HandleRequest(const std::string& request)
+{
+    auto server = rtmp_server_.lock();
+    if(!server)
+    {
+        return false;
+    }
+
+    std::istringstream stream(request);
+    std::string method, url, version;
+    stream >> method >> url >> version;
+    if(method != "GET")
+    {
+        SendErrorResponse(405, "Method Not Allowed");
+        return false;
+    }
+
+    // 去掉查询参数，路径须为 /app/stream.flv；点播可带 start=秒 指定起始位置，直播可带 delay=秒 落后直播播放
+    uint32_t start_ms = 0;
+    uint32_t delay_ms = 0;
+    size_t query = url.find('?');
+    if(query != std::string::npos)
+    {
+        start_ms = GetQueryMs(url, query, "start=");
+        delay_ms = GetQueryMs(url, query, "delay=");
+        url = url.substr(0, query);
+    }
+    const std::string suffix = ".flv";
+    if(url.size() <= suffix.size() + 1 || url.compare(url.size() - suffix.size(), suffix.size(), suffix) != 0)
+    {
+        SendErrorResponse(404, "Not Found");
+        return false;
+    }
+    stream_path_ = url.substr(0, url.size() - suffix.size());
+
+    // 只为已有推流的流提供服务，不创建空会话；没有推流时依次尝试点播文件、其他工作进程的推流与回源拉流
+    RtmpSession::Ptr session;
+    if(server->rtmp_sessions_.Find(stream_path_, session) && session->HasPublisher())
+    {
+        return StartPlay(session, nullptr, start_ms, delay_ms, version);
+    }
+    std::shared_ptr<FlvVodFile> vod_file = server->OpenVodFile(stream_path_);
+    if(vod_file)
+    {
+        return StartPlay(nullptr, vod_file, start_ms, delay_ms, version);
+    }
+
+    // 多进程模式下流归属的查询是异步的，结果回到本连接的线程处理，期间忽略客户端数据
+    is_routing_ = true;
+    std::weak_ptr<TcpConnection> weak_conn = shared_from_this();
+    TaskScheduler* scheduler = GetTaskSchduler();
+    server->RouteStream(stream_path_, [weak_conn, scheduler, start_ms, delay_ms, version](RtmpSession::Ptr session){
+        scheduler->AddReadyTask([weak_conn, session, start_ms, delay_ms, version](){
+            auto conn = weak_conn.lock();
+            if(!conn || conn->IsClosed())
+            {
+                return;
+            }
+            auto flv_conn = std::static_pointer_cast<HttpFlvConnection>(conn);
+            flv_conn->is_routing_ = false;
+            if(!flv_conn->StartPlay(session, nullptr, start_ms, delay_ms, version))
+            {
+                conn->DisConnect();
+            }
+        });
+    });
+    return true;
+}
+
+/**
+ * @brief 发送响应头和 FLV 头，按点播、时移或直播开始发送
+ */
+bool HttpFlvConnection::StartPlay(std::shared_ptr<RtmpSession> session, std::shared_ptr<FlvVodFile> vod_file,
+                                  uint32_t start_ms, uint32_t delay_ms, const std::string& version)
+{
+    auto server = rtmp_server_.lock();
+    if(!server)
+    {
+        return false;
+    }
+    if(!session && !vod_file)
+    {
+        SendErrorResponse(404, "Not Found");
+        return false;
+    }
+    std::shared_ptr<TimeShiftBuffer> time_shift;
+    if(delay_ms > 0 && session && session->HasPublisher())
+    {
+        time_shift = session->GetTimeShift();            // 流未开启时移时按直播播放
+    }
+
+    // HTTP/1.0 客户端不支持 chunked 编码，以关闭连接表示结束
+    use_chunked_ = chunked_ && version == "HTTP/1.1";
+    std::string response = "HTTP/1.1 200 OK\r\n"
+                           "Content-Type: video/x-flv\r\n"
+                           "Cache-Control: no-cache\r\n"
+                           "Access-Control-Allow-Origin: *\r\n"
+                           "Connection: close\r\n";
+    if(use_chunked_)
+    {
+        response += "Transfer-Encoding: chunked\r\n";
+    }
+    response += "\r\n";
+    this->Send(response.c_str(), (uint32_t)response.size());
+
+    // FLV 文件头（9 字节，声明音视频）+ PreviousTagSize0；点播直接发送文件自身的文件头
+    static const char kFlvHeader[13] = { 'F', 'L', 'V', 0x01, 0x05, 0x00, 0x00, 0x00, 0x09, 0x00, 0x00, 0x00, 0x00 };
+    if(!vod_file && use_chunked_)
+    {
+        char prefix[8] = {0};
+        int prefix_size = snprintf(prefix, sizeof(prefix), "%X\r\n", (uint32_t)sizeof(kFlvHeader));
+        std::string header(prefix, prefix_size);
+        header.append(kFlvHeader, sizeof(kFlvHeader));
+        header.append("\r\n");
+        this->Send(header.c_str(), (uint32_t)header.size());
+    }
+    else if(!vod_file)
+    {
+        this->Send(kFlvHeader, sizeof(kFlvHeader));
+    }
+
+    // 与 RTMP 观看者相同的出口策略
+    if(server->player_pacing_rate_ > 0)
+    {
+        this->SetPacingRate(server->player_pacing_rate_, server->player_pacing_burst_);
+        if(server->kernel_pacing_)
+        {
+            this->SetKernelPacingRate(server->player_pacing_rate_);
+        }
+    }
+    if(server->transport_stats_interval_ > 0)
+    {
+        this->EnableTransportStats(server->transport_stats_interval_);
+        max_queue_delay_ = server->max_queue_delay_;
+    }
+    if(server->notsent_lowat_ > 0)
+    {
+        this->SetNotSentLowat(server->notsent_lowat_);
+    }
+    if(vod_file)
+    {
+        is_player_ = true;
+        StartVod(vod_file, start_ms);
+        server->NotifyEvent("Play.start", stream_path_);
+        return true;
+    }
+    if(time_shift)
+    {
+        is_player_ = true;
+        StartTimeShift(time_shift, delay_ms);
+        server->NotifyEvent("Play.start", stream_path_);
+        return true;
+    }
+    if(server->player_queue_drop_disposable_ms_ > 0 || server->player_queue_drop_gop_ms_ > 0 || server->player_queue_max_ms_ > 0)
+    {
+        media_queue_.SetThresholds(server->player_queue_drop_disposable_ms_, server->player_queue_drop_gop_ms_, server->player_queue_max_ms_);
+        queue_watermark_ = server->player_queue_watermark_;
+        use_media_queue_ = true;
+        this->SetWriteCallback([this](std::shared_ptr<TcpConnection> conn){
+            this->DrainMediaQueue();
+        }, queue_watermark_);
+    }
+
+    // 加入会话，推流线程在下一帧之前下发元数据、序列头和缓存的 GOP；开启自适应码率时由切换器代为加入
+    is_player_ = true;
+    rtmp_session_ = session;
+    auto sink = std::dynamic_pointer_cast<RtmpSink>(shared_from_this());
+    rendition_switcher_ = RenditionSwitcher::Create(server, sink, stream_path_);
+    if(rendition_switcher_)
+    {
+        if(server->transport_stats_interval_ == 0)
+        {
+            this->EnableTransportStats(RenditionSwitcher::kTransportStatsInterval, false);
+        }
+        sink = rendition_switcher_->GetActiveSink();
+    }
+    session->AddSink(sink);
+    server->NotifyEvent("Play.start", stream_path_);
+    return true;
+}
+
+/**
+ * @brief 发送错误响应，随后由调用者断开连接
+ * @param code HTTP 状态码
+ * @param reason 状态描述
+ */
+void HttpFlvConnection::SendErrorResponse(int code, const char* reason)
+{
+    char response[256] = {0};
+    int size = snprintf(response, sizeof(response),
+                        "HTTP/1.1 %d %s\r\nContent-Length: 0\r\nConnection: close\r\n\r\n", code, reason);
+    this->Send(response, (uint32_t)size);
+}
+
+/**
+ * @brief 以 onMetaData 脚本 tag 发送元数据，tag 由所有 HTTP-FLV 观看者共享
+ * @param meta_data 元数据消息
+ * @return true 发送成功
+ */
+bool HttpFlvConnection::SendMetaData(RtmpMediaPacket::Ptr meta_data)
+{
+    if(this->IsClosed() || !meta_data || meta_data->GetSize() == 0)
+    {
+        return false;
+    }
+
+    uint32_t tag_size = 0;
+    std::shared_ptr<char> tag = meta_data->GetFlvTag(use_chunked_, tag_size);
+    if(tag)
+    {
+        SendFlvData(tag, tag_size);
+    }
+    return true;
+}
+
+/**
+ * @brief 发送音视频数据，封装为媒体消息后按共享路径发送
+ */
+bool HttpFlvConnection::SendMediaData(uint8_t type, uint64_t timestamp, std::shared_ptr<char> payload, uint32_t payload_size)
+{
+    return SendMediaPacket(std::make_shared<RtmpMediaPacket>(type, timestamp, payload, payload_size));
+}
+
+/**
+ * @brief 发送会话共享的媒体消息，关键帧等待与积压丢帧策略与 RTMP 观看者一致
+ * @param packet 媒体消息
+ * @return true 发送成功，false 表示连接已关闭
+ */
+bool HttpFlvConnection::SendMediaPacket(RtmpMediaPacket::Ptr packet)
+{
+    if(this->IsClosed())
+    {
+        return false;
+    }
+    if(packet->GetSize() == 0)
+    {
+        return false;
+    }
+
+    is_playing_ = true;
+    uint8_t type = packet->GetType();
+    if(type == RTMP_AVC_SEQUENCE_HEADER)
+    {
+        has_avc_sequence_header_ = true;
+    }
+
+    //发送积压超过阈值，丢弃视频直到下一个关键帧
+    if(has_key_frame_ && type == RTMP_VIDEO && IsCongested())
+    {
+        has_key_frame_ = false;
+    }
+
+    //有视频的流从关键帧开始发送
+    if(!has_key_frame_ && has_avc_sequence_header_
+    && type != RTMP_AVC_SEQUENCE_HEADER && type != RTMP_AAC_SEQUENCE_HEADER)
+    {
+        if(!packet->IsKeyFrame())
+        {
+            skipped_frames_.fetch_add(1, std::memory_order_relaxed);
+            return true;
+        }
+        has_key_frame_ = true;
+    }
+
+    if(use_media_queue_)
+    {
+        media_queue_.Push(packet);
+        DrainMediaQueue();
+    }
+    else
+    {
+        SendPacketTag(packet);
+    }
+    return true;
+}
+
+/**
+ * @brief 发送一段已编码的 FLV 数据
+ */
+void HttpFlvConnection::SendFlvData(std::shared_ptr<char> data, uint32_t size)
+{
+    if(data && size > 0)
+    {
+        this->Send(data, size);
+    }
+}
+
+/**
+ * @brief 发送共享的 FLV tag，同一消息的 tag 只生成一次
+ * @param packet 媒体消息
+ */
+void HttpFlvConnection::SendPacketTag(RtmpMediaPacket::Ptr packet)
+{
+    uint32_t tag_size = 0;
+    std::shared_ptr<char> tag = packet->GetFlvTag(use_chunked_, tag_size);
+    SendFlvData(tag, tag_size);
+}
+
+/**
+ * @brief 文件开头（文件头、元数据与序列头）原样发送，之后的 tag 由 VodPlayer 在发送队列低于水位或定时器到期时补充
+ * @param file 点播文件
+ * @param start_ms 起始位置（毫秒）
+ */
+void HttpFlvConnection::StartVod(std::shared_ptr<FlvVodFile> file, uint32_t start_ms)
+{
+    vod_player_ = std::make_shared<VodPlayer>(file, kMaxVodRunBytes,
+        [this](uint64_t offset, uint32_t size, uint32_t timestamp) {
+            this->SendVodData(offset, size);
+        },
+        [this]() {
+            return this->GetPendingBytes();
+        },
+        [this]() {
+            this->FinishVod();
+        });
+    SendVodData(0, (uint32_t)file->GetMediaOffset());
+    is_playing_ = true;
+    vod_player_->Start(GetTaskSchduler(), start_ms);
+    // 定位起点之后再注册，发送文件开头时不会从偏移 0 补充数据
+    this->SetWriteCallback([this](std::shared_ptr<TcpConnection> conn){
+        if(vod_player_)
+        {
+            vod_player_->Pump();
+        }
+    }, VodPlayer::kMaxPendingBytes / 2);
+}
+
+/**
+ * @brief 时移观看者与直播观看者走同一条发送路径（SendMetaData/SendMediaPacket），不经过媒体队列，
+ * 由 TimeShiftPlayer 按发送积压读取窗口，时移观看者不丢帧
+ * @param buffer 流的时移窗口
+ * @param delay_ms 落后直播的时长（毫秒）
+ */
+void HttpFlvConnection::StartTimeShift(std::shared_ptr<TimeShiftBuffer> buffer, uint32_t delay_ms)
+{
+    time_shift_player_ = std::make_shared<TimeShiftPlayer>(buffer, std::dynamic_pointer_cast<RtmpSink>(shared_from_this()),
+        [this]() {
+            return this->GetPendingBytes();
+        });
+    time_shift_player_->Start(GetTaskSchduler(), delay_ms);
+    this->SetWriteCallback([this](std::shared_ptr<TcpConnection> conn){
+        if(time_shift_player_)
+        {
+            time_shift_player_->Pump();
+        }
+    }, TimeShiftPlayer::kMaxPendingBytes / 2);
+}
+
+/**
+ * @brief 文件数据以别名指针入队，chunked 编码的分块头尾放在同一个小缓冲区中，与数据一起由一次 writev 发送
+ * @param offset 文件内偏移
+ * @param size 长度
+ */
+void HttpFlvConnection::SendVodData(uint64_t offset, uint32_t size)
+{
+    if(!vod_player_ || size == 0)
+    {
+        return;
+    }
+    std::shared_ptr<char> data = vod_player_->GetFile()->GetSlice(offset);
+    this->SendSegmentsInOrder([&](std::vector<std::pair<std::shared_ptr<char>, uint32_t>>& segments) {
+        if(!use_chunked_)
+        {
+            segments.emplace_back(data, size);
+            return;
+        }
+        std::shared_ptr<char> wrapper(new char[16], std::default_delete<char[]>());
+        int prefix_size = snprintf(wrapper.get(), 12, "%X\r\n", size);
+        memcpy(wrapper.get() + prefix_size, "\r\n", 2);
+        segments.emplace_back(wrapper, (uint32_t)prefix_size);
+        segments.emplace_back(data, size);
+        segments.emplace_back(std::shared_ptr<char>(wrapper, wrapper.get() + prefix_size), 2u);
+    });
+}
+
+/**
+ * @brief 结束 chunked 响应；发送队列清空后断开，非 chunked 客户端以连接关闭判断结束
+ */
+void HttpFlvConnection::FinishVod()
+{
+    if(use_chunked_)
+    {
+        this->Send("0\r\n\r\n", 5);
+    }
+    std::weak_ptr<TcpConnection> weak_conn = shared_from_this();
+    GetTaskSchduler()->AddTimer([weak_conn]() {
+        auto conn = weak_conn.lock();
+        if(!conn || conn->IsClosed())
+        {
+            return false;
+        }
+        if(conn->GetPendingBytes() > 0)
+        {
+            return true;
+        }
+        conn->DisConnect();
+        return false;
+    }, kVodCloseCheckInterval);
+}
+
+/**
+ * @brief TCP 发送队列低于水位时从媒体队列取出消息发送，同 RtmpConnection::DrainMediaQueue
+ */
+void HttpFlvConnection::DrainMediaQueue()
+{
+    media_queue_.Drain([this]() {
+        return !this->IsClosed() && GetPendingBytes() <= queue_watermark_;
+    }, [this](RtmpMediaPacket::Ptr packet) {
+        SendPacketTag(packet);
+    });
+}
+
+/**
+ * @brief 获取媒体队列统计
+ * @return 积压时长、队列长度与丢帧计数
+ */
+RtmpMediaQueue::Stats HttpFlvConnection::GetMediaQueueStats()
+{
+    return media_queue_.GetStats();
+}
+
+/**
+ * @brief 汇总发送统计，与 RtmpConnection 相同
+ */
+bool HttpFlvConnection::GetSinkStats(SinkStats& stats)
+{
+    RtmpMediaQueue::Stats queue_stats = media_queue_.GetStats();
+    stats.type = "http-flv";
+    stats.sent_bytes = GetSentBytes();
+    stats.pending_bytes = GetPendingBytes();
+    stats.lag_ms = queue_stats.lag_ms;
+    stats.dropped_frames = queue_stats.dropped_video + queue_stats.dropped_audio
+                         + skipped_frames_.load(std::memory_order_relaxed);
+    stats.send_calls = GetSendCalls();
+    TcpTransportInfo info = GetTransportInfo();
+    stats.delivery_rate = info.delivery_rate;
+    stats.notsent_bytes = info.notsent_bytes;
+    return true;
+}
+
+/**
+ * @brief 根据 TCP_INFO 交付速率估算发送积压时延（应用层队列 + 内核未发送数据）
+ * @return true 表示积压时延超过 max_queue_delay_
+ */
+bool HttpFlvConnection::IsCongested()
+{
+    if(max_queue_delay_ == 0)
+    {
+        return false;
+    }
+    TcpTransportInfo info = GetTransportInfo();
+    if(info.delivery_rate == 0)
+    {
+        return false;
+    }
+    uint64_t backlog = GetPendingBytes() + info.notsent_bytes;
+    return backlog * 1000 / info.delivery_rate > max_queue_delay_;
+}
@@ -0,0 +1,187 @@
+/**
+ * @file HttpFlvConnection.h
+ * @brief HTTP-FLV 观看者连接，作为 RtmpSink 加入与 RTMP 观看者相同的 RtmpSession。
+ *
+ * 主要职责：
+ *  - 解析 "GET /app/stream.flv" 请求并定位会话
+ *  - 发送 HTTP 响应头、FLV 文件头和元数据
+ *  - 发送会话内共享的 FLV tag，沿用 RTMP 观看者的关键帧等待、媒体队列与积压丢帧策略
+ *  - 开启点播时，没有推流的路径发送点播目录下的同名文件，tag 直接引用文件映射
+ */
+
+#ifndef _HTTPFLVCONNECTION_H_
+#define _HTTPFLVCONNECTION_H_
+
+#include "../EdoyunNet/TcpConnection.h"
+#include "amf.h"
+#include "RtmpSink.h"
+#include "RtmpMediaQueue.h"
+#include <atomic>
+#include <string>
+
+class RtmpServer;
+class RtmpSession;
+class RenditionSwitcher;
+class FlvVodFile;
+class VodPlayer;
+class TimeShiftBuffer;
+class TimeShiftPlayer;
+
+/**
+ * @class HttpFlvConnection
+ * @brief 继承自 TcpConnection 和 RtmpSink，以 HTTP-FLV 格式向浏览器/移动端播放器发送直播流
+ */
+class HttpFlvConnection : public TcpConnection, public RtmpSink
+{
+public:
+    /**
+     * @brief 构造函数
+     * @param rtmp_server 提供会话表与观看者策略配置的 RTMP 服务
+     * @param scheduler 调度器
+     * @param socket 底层 TCP 套接字
+     * @param chunked HTTP/1.1 请求是否使用 chunked 编码，否则以关闭连接表示结束
+     */
+    HttpFlvConnection(std::shared_ptr<RtmpServer> rtmp_server, TaskScheduler* scheduler, int socket, bool chunked);
+
+    /**
+     * @brief 析构函数
+     */
+    virtual ~HttpFlvConnection();
+
+    // --- RtmpSink 接口重写 ---
+    virtual bool SendMetaData(RtmpMediaPacket::Ptr meta_data) override;
+    virtual bool SendMediaData(uint8_t type, uint64_t timestamp, std::shared_ptr<char> payload, uint32_t payload_size) override;
+    virtual bool SendMediaPacket(RtmpMediaPacket::Ptr packet) override;  ///< 发送会话内共享的 FLV tag
+    virtual bool IsPlayer() override { return is_player_; }             ///< 请求被接受后即为观看者
+    virtual bool IsPlaying() override { return is_playing_; }           ///< 是否已开始发送音视频
+    virtual uint32_t GetId() override { return (uint32_t)GetSocket(); } ///< 以 socket 作为唯一 ID
+    virtual TaskScheduler* GetOwnerScheduler() override { return GetTaskSchduler(); }
+
+    /**
+     * @brief 获取媒体队列的积压与丢帧统计
+     * @return 统计信息，未启用队列时积压为 0
+     */
+    RtmpMediaQueue::Stats GetMediaQueueStats();
+
+    /**
+     * @brief 获取发送统计
+     */
+    virtual bool GetSinkStats(SinkStats& stats) override;
+
+    /**
+     * @brief 获取请求的流路径
+     * @return 流路径，格式 "/app/stream"
+     */
+    std::string GetStreamPath() const { return stream_path_; }
+
+private:
+    /**
+     * @brief 读取 HTTP 请求头，请求完整后处理；播放开始后忽略客户端发送的数据
+     * @param buffer 输入缓冲区
+     * @return false 表示需要断开连接
+     */
+    bool OnRead(BufferReader& buffer);
+
+    /**
+     * @brief 连接关闭回调，从会话中移除
+     */
+    void OnClose();
+
+    /**
+     * @brief 解析请求行，本地没有推流时先查询流归属再开始播放
+     * @param request 完整的请求头
+     * @return false 表示请求无效，已发送错误响应
+     */
+    bool HandleRequest(const std::string& request);
+
+    /**
+     * @brief 发送响应头和 FLV 头并开始播放，会话与点播文件都为空时返回 404
+     * @param session 直播会话
+     * @param vod_file 点播文件
+     * @param start_ms 点播起始位置（毫秒）
+     * @param delay_ms 时移落后直播的时长（毫秒）
+     * @param version 请求的 HTTP 版本
+     * @return false 表示需要断开连接
+     */
+    bool StartPlay(std::shared_ptr<RtmpSession> session, std::shared_ptr<FlvVodFile> vod_file,
+                   uint32_t start_ms, uint32_t delay_ms, const std::string& version);
+
+    /**
+     * @brief 发送错误响应
+     * @param code HTTP 状态码
+     * @param reason 状态描述
+     */
+    void SendErrorResponse(int code, const char* reason);
+
+    /**
+     * @brief 发送一段 FLV 数据，chunked 编码时已在构造 tag 时包装
+     * @param data 数据
+     * @param size 数据长度
+     */
+    void SendFlvData(std::shared_ptr<char> data, uint32_t size);
+
+    /**
+     * @brief 发送共享的 FLV tag
+     * @param packet 媒体消息
+     */
+    void SendPacketTag(RtmpMediaPacket::Ptr packet);
+
+    /**
+     * @brief 以点播方式发送文件：先发文件开头（文件头、元数据与序列头），再由 VodPlayer 按实时速度发送
+     * @param file 点播文件
+     * @param start_ms 起始位置（毫秒）
+     */
+    void StartVod(std::shared_ptr<FlvVodFile> file, uint32_t start_ms);
+
+    /**
+     * @brief 以时移方式播放：由 TimeShiftPlayer 从流的时移窗口中落后直播发送，不加入会话
+     * @param buffer 流的时移窗口
+     * @param delay_ms 落后直播的时长（毫秒）
+     */
+    void StartTimeShift(std::shared_ptr<TimeShiftBuffer> buffer, uint32_t delay_ms);
+
+    /**
+     * @brief 发送文件中的一段原始 FLV 数据，负载引用文件映射，chunked 编码时加上分块头尾
+     * @param offset 文件内偏移
+     * @param size 长度
+     */
+    void SendVodData(uint64_t offset, uint32_t size);
+
+    /**
+     * @brief 点播发送完毕：结束 chunked 响应，发送队列清空后断开
+     */
+    void FinishVod();
+
+    /**
+     * @brief TCP 发送队列低于水位时从媒体队列补充
+     */
+    void DrainMediaQueue();
+
+    /**
+     * @brief 根据 TCP_INFO 估算发送积压时延是否超过阈值
+     * @return true 表示拥塞
+     */
+    bool IsCongested();
+
+    std::weak_ptr<RtmpServer> rtmp_server_;      ///< 所属 RTMP 服务
+    std::weak_ptr<RtmpSession> rtmp_session_;    ///< 加入的会话
+    std::shared_ptr<RenditionSwitcher> rendition_switcher_;  ///< 自适应码率切换器，未开启时为空
+    std::shared_ptr<VodPlayer> vod_player_;      ///< 点播发送器，直播观看者为空
+    std::shared_ptr<TimeShiftPlayer> time_shift_player_; ///< 时移发送器，直播观看者为空
+    std::string stream_path_;                    ///< 请求的流路径
+    bool chunked_ = true;                        ///< 是否允许使用 chunked 编码
+    bool use_chunked_ = false;                   ///< 本连接是否使用 chunked 编码
+    bool is_player_ = false;                     ///< 请求是否已被接受
+    bool is_routing_ = false;                    ///< 是否正在查询流归属
+    bool is_playing_ = false;                    ///< 是否已开始发送音视频
+    bool has_key_frame_ = false;                 ///< 是否已发送过关键帧
+    bool has_avc_sequence_header_ = false;       ///< 是否收到过视频序列头，纯音频流不等待关键帧
+
+    RtmpMediaQueue media_queue_;                 ///< 观看者媒体队列
+    bool use_media_queue_ = false;               ///< 是否启用媒体队列
+    std::atomic<uint64_t> skipped_frames_{0};    ///< 等待关键帧期间跳过的帧数
+    uint32_t queue_watermark_ = 0;               ///< TCP 发送队列补充水位（字节）
+    uint32_t max_queue_delay_ = 0;               ///< 允许的最大发送积压时延（毫秒），0 表示不检查
+};
+
+#endif // _HTTPFLVCONNECTION_H_
@@ -0,0 +1,54 @@
+/**
+ * @file HttpFlvServer.cpp
+ * @brief 实现 HttpFlvServer 的创建与连接分发。
+ */
+#include "HttpFlvServer.h"
+#include "HttpFlvConnection.h"
+#include "RtmpServer.h"
+#include "../EdoyunNet/EventLoop.h"
+#include <unistd.h>
+
+/**
+ * @brief 静态工厂方法，创建 HTTP-FLV 服务实例
+ * @param eventloop 事件循环
+ * @param rtmp_server RTMP 服务
+ * @return HTTP-FLV 服务共享指针
+ */
+std::shared_ptr<HttpFlvServer> HttpFlvServer::Create(EventLoop* eventloop, std::shared_ptr<RtmpServer> rtmp_server)
+{
+    std::shared_ptr<HttpFlvServer> server(new HttpFlvServer(eventloop, rtmp_server));
+    return server;
+}
+
+/**
+ * @brief 私有构造函数
+ */
+HttpFlvServer::HttpFlvServer(EventLoop* eventloop, std::shared_ptr<RtmpServer> rtmp_server)
+    :TcpServer(eventloop)
+    ,loop_(eventloop)
+    ,rtmp_server_(rtmp_server)
+{
+}
+
+/**
+ * @brief 析构函数
+ */
+HttpFlvServer::~HttpFlvServer()
+{
+}
+
+/**
+ * @brief TCP 新连接回调，创建 HttpFlvConnection 处理该连接
+ * @param socket 新连接的 socket 描述符
+ * @return 对应的 HttpFlvConnection 智能指针
+ */
+TcpConnection::Ptr HttpFlvServer::OnConnect(int socket)
+{
+    auto rtmp_server = rtmp_server_.lock();
+    if(!rtmp_server)
+    {
+        ::close(socket);
+        return nullptr;
+    }
+    return std::make_shared<HttpFlvConnection>(rtmp_server, loop_->GetTaskSchduler().get(), socket, chunked_);
+}
@@ -0,0 +1,61 @@
+/**
+ * @file HttpFlvServer.h
+ * @brief HTTP-FLV 服务，为浏览器和移动端播放器提供 "GET /app/stream.flv" 直播流。
+ *
+ * 与 RtmpServer 共用会话表：同一个推流会话同时服务 RTMP 与 HTTP-FLV 观看者，
+ * GOP 缓存、媒体消息与观看者策略只有一份。
+ */
+
+#ifndef _HTTPFLVSERVER_H_
+#define _HTTPFLVSERVER_H_
+
+#include "../EdoyunNet/TcpServer.h"
+#include <memory>
+
+class RtmpServer;
+
+/**
+ * @class HttpFlvServer
+ * @brief 基于 TcpServer 的 HTTP-FLV 监听服务，为每个连接创建 HttpFlvConnection
+ */
+class HttpFlvServer : public TcpServer, public std::enable_shared_from_this<HttpFlvServer>
+{
+public:
+    /**
+     * @brief 创建 HTTP-FLV 服务实例
+     * @param eventloop 事件循环，通常与 RtmpServer 相同
+     * @param rtmp_server 提供会话与观看者策略配置的 RTMP 服务
+     * @return HTTP-FLV 服务共享指针
+     */
+    static std::shared_ptr<HttpFlvServer> Create(EventLoop* eventloop, std::shared_ptr<RtmpServer> rtmp_server);
+
+    /**
+     * @brief 析构函数
+     */
+    ~HttpFlvServer();
+
+    /**
+     * @brief 设置 HTTP/1.1 响应是否使用 chunked 编码，关闭时以关闭连接表示结束
+     * @param chunked 是否使用 chunked 编码，默认开启
+     */
+    void SetChunkedTransfer(bool chunked) { chunked_ = chunked; }
+
+private:
+    /**
+     * @brief 私有构造，仅通过 Create() 调用
+     */
+    HttpFlvServer(EventLoop* eventloop, std::shared_ptr<RtmpServer> rtmp_server);
+
+    /**
+     * @brief TCP 新连接回调，创建 HttpFlvConnection
+     * @param socket 新连接的 socket 描述符
+     * @return 连接对象，RTMP 服务已销毁时返回 nullptr
+     */
+    virtual TcpConnection::Ptr OnConnect(int socket) override;
+
+    EventLoop* loop_;                         ///< 事件循环
+    std::weak_ptr<RtmpServer> rtmp_server_;   ///< 共享会话表的 RTMP 服务
+    bool chunked_ = true;                     ///< 是否使用 chunked 编码
+};
+
+#endif // _HTTPFLVSERVER_H_
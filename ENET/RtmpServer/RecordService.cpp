@@ -0,0 +1,224 @@
+/**
+ * @file RecordService.cpp
+ * @brief 实现 RecordService：录制器生命周期与写线程池。
+ */
+#include "RecordService.h"
+#include "RtmpServer.h"
+#include "../EdoyunNet/EventLoop.h"
+#include <chrono>
+#include <functional>
+
+/** 写线程每轮对单个录制器最多处理的消息数，避免一条流占满写线程 */
+static const uint32_t kMaxMessagesPerRound = 64;
+/** 写线程空闲时的休眠时长（毫秒），入队方不通知写线程，也就不需要加锁 */
+static const uint32_t kIdleWaitMs = 10;
+
+/**
+ * @brief 静态工厂方法，创建录制服务并订阅推流事件
+ */
+std::shared_ptr<RecordService> RecordService::Create(EventLoop* eventloop, std::shared_ptr<RtmpServer> rtmp_server,
+                                                     const std::string& dir, uint32_t threads)
+{
+    std::shared_ptr<RecordService> service(new RecordService(eventloop, rtmp_server, dir, threads));
+    std::weak_ptr<RecordService> weak_service = service;
+    rtmp_server->SetEventCallback([weak_service](std::string type, std::string stream_path){
+        if(auto record_service = weak_service.lock())
+        {
+            record_service->OnStreamEvent(type, stream_path);
+        }
+    });
+    return service;
+}
+
+/**
+ * @brief 私有构造函数，启动写线程
+ */
+RecordService::RecordService(EventLoop* eventloop, std::shared_ptr<RtmpServer> rtmp_server, const std::string& dir, uint32_t threads)
+    :loop_(eventloop)
+    ,rtmp_server_(rtmp_server)
+    ,dir_(dir)
+{
+    if(threads == 0)
+    {
+        threads = 1;
+    }
+    for(uint32_t i = 0; i < threads; i++)
+    {
+        writers_.emplace_back(new Writer);
+    }
+    for(auto &writer : writers_)
+    {
+        Writer* w = writer.get();
+        w->thread = std::thread([this, w](){
+            this->Run(w);
+        });
+    }
+}
+
+/**
+ * @brief 析构函数：停止所有录制器，写线程写完剩余数据后退出
+ */
+RecordService::~RecordService()
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        for(auto &iter : recorders_)
+        {
+            iter.second->Stop();
+        }
+        recorders_.clear();
+    }
+    running_ = false;
+    for(auto &writer : writers_)
+    {
+        writer->cond.notify_one();
+        if(writer->thread.joinable())
+        {
+            writer->thread.join();
+        }
+    }
+}
+
+/**
+ * @brief 设置文件切分条件
+ */
+void RecordService::SetRotation(uint32_t max_duration_ms, uint64_t max_bytes)
+{
+    max_duration_ms_ = max_duration_ms;
+    max_bytes_ = max_bytes;
+}
+
+/**
+ * @brief 设置队列长度与 O_DIRECT
+ */
+void RecordService::SetWriteOptions(uint32_t queue_size, bool direct_io)
+{
+    queue_size_ = queue_size;
+    direct_io_ = direct_io;
+}
+
+/**
+ * @brief 汇总统计
+ */
+RecordService::Stats RecordService::GetStats()
+{
+    Stats stats;
+    std::lock_guard<std::mutex> lock(mutex_);
+    for(auto &iter : recorders_)
+    {
+        stats.recorders++;
+        stats.dropped_messages += iter.second->GetDroppedMessages();
+        stats.written_bytes += iter.second->GetWrittenBytes();
+        stats.write_errors += iter.second->GetWriteErrors();
+        stats.queued_messages += iter.second->GetQueueSize();
+    }
+    return stats;
+}
+
+/**
+ * @brief 推流开始时创建录制器加入会话，结束时移出会话并通知写线程收尾
+ *
+ * 与 HlsServer 相同，事件回调在 RtmpServer 的锁内执行，会话操作转到 0 号调度线程
+ */
+void RecordService::OnStreamEvent(const std::string& type, const std::string& stream_path)
+{
+    bool is_start = type == "publish.start";
+    if(!is_start && type != "publish,stop")
+    {
+        return;
+    }
+
+    std::weak_ptr<RecordService> weak_service = shared_from_this();
+    loop_->GetTaskSchduler(0)->AddReadyTask([weak_service, is_start, stream_path](){
+        auto service = weak_service.lock();
+        if(!service)
+        {
+            return;
+        }
+        auto rtmp_server = service->rtmp_server_.lock();
+        RtmpSession::Ptr session = rtmp_server ? rtmp_server->FindSession(stream_path) : nullptr;
+
+        FlvRecorder::Ptr recorder;
+        {
+            std::lock_guard<std::mutex> lock(service->mutex_);
+            auto iter = service->recorders_.find(stream_path);
+            if(iter != service->recorders_.end())
+            {
+                recorder = iter->second;
+                service->recorders_.erase(iter);
+            }
+        }
+        if(recorder)
+        {
+            if(session)
+            {
+                session->RemoveSink(recorder);
+            }
+            recorder->Stop();                         // 写线程写完队列后关闭文件
+        }
+
+        if(is_start && session)
+        {
+            recorder = std::make_shared<FlvRecorder>(stream_path, service->dir_, service->max_duration_ms_,
+                                                     service->max_bytes_, service->queue_size_, service->direct_io_);
+            {
+                std::lock_guard<std::mutex> lock(service->mutex_);
+                service->recorders_[stream_path] = recorder;
+            }
+            Writer* writer = service->writers_[std::hash<std::string>()(stream_path) % service->writers_.size()].get();
+            {
+                std::lock_guard<std::mutex> lock(writer->mutex);
+                writer->pending.push_back(recorder);
+            }
+            writer->cond.notify_one();
+            session->AddSink(recorder);               // 推流线程在下一帧之前下发元数据、序列头和缓存的 GOP
+        }
+    });
+}
+
+/**
+ * @brief 写线程主循环
+ */
+void RecordService::Run(Writer* writer)
+{
+    while(true)
+    {
+        bool running = running_;
+        {
+            std::lock_guard<std::mutex> lock(writer->mutex);
+            for(auto &recorder : writer->pending)
+            {
+                writer->recorders.push_back(recorder);
+            }
+            writer->pending.clear();
+        }
+
+        bool busy = false;
+        for(auto iter = writer->recorders.begin(); iter != writer->recorders.end(); )
+        {
+            if((*iter)->Process(kMaxMessagesPerRound))
+            {
+                busy = true;
+            }
+            if((*iter)->IsFinished())
+            {
+                iter = writer->recorders.erase(iter);
+            }
+            else
+            {
+                iter++;
+            }
+        }
+
+        if(!running && !busy)
+        {
+            break;                                    // 退出前已写完剩余数据
+        }
+        if(!busy)
+        {
+            std::unique_lock<std::mutex> lock(writer->mutex);
+            writer->cond.wait_for(lock, std::chrono::milliseconds(kIdleWaitMs));
+        }
+    }
+    writer->recorders.clear();                        // 析构时关闭未收尾的文件
+}
@@ -0,0 +1,113 @@
+/**
+ * @file RecordService.h
+ * @brief 录制服务：推流开始时为每条流创建 FlvRecorder 并加入会话，由进程内的写线程池写盘。
+ *
+ * 每条流固定由一个写线程处理（按路径哈希），写线程轮询其负责的录制器的无锁队列；
+ * 事件循环线程只负责入队，磁盘 IO 全部在写线程中完成。
+ */
+
+#ifndef _RECORDSERVICE_H_
+#define _RECORDSERVICE_H_
+
+#include "FlvRecorder.h"
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+class EventLoop;
+class RtmpServer;
+
+/**
+ * @class RecordService
+ * @brief 管理录制器的创建/停止与写线程池
+ */
+class RecordService : public std::enable_shared_from_this<RecordService>
+{
+public:
+    /** 录制统计 */
+    struct Stats
+    {
+        uint32_t recorders = 0;         ///< 正在录制的流数
+        uint64_t dropped_messages = 0;  ///< 队列满丢弃的消息数
+        uint64_t written_bytes = 0;     ///< 已写入字节数
+        uint64_t write_errors = 0;      ///< 写失败次数
+        uint32_t queued_messages = 0;   ///< 当前积压消息数
+    };
+
+    /**
+     * @brief 创建录制服务并注册 RtmpServer 的推流事件回调
+     * @param eventloop 事件循环
+     * @param rtmp_server 提供会话的 RTMP 服务
+     * @param dir 录制根目录
+     * @param threads 写线程数
+     * @return 录制服务共享指针
+     */
+    static std::shared_ptr<RecordService> Create(EventLoop* eventloop, std::shared_ptr<RtmpServer> rtmp_server,
+                                                 const std::string& dir, uint32_t threads = 1);
+
+    /**
+     * @brief 析构函数，写完所有队列后停止写线程
+     */
+    ~RecordService();
+
+    /**
+     * @brief 设置文件切分条件，对之后开始的推流生效
+     * @param max_duration_ms 单个文件最大时长（毫秒），0 表示不按时长切分
+     * @param max_bytes 单个文件最大字节数，0 表示不按大小切分
+     */
+    void SetRotation(uint32_t max_duration_ms, uint64_t max_bytes);
+
+    /**
+     * @brief 设置每条流的待写队列长度与是否使用 O_DIRECT，对之后开始的推流生效
+     * @param queue_size 队列长度（消息数），满时丢帧
+     * @param direct_io 是否以 O_DIRECT 打开文件
+     */
+    void SetWriteOptions(uint32_t queue_size, bool direct_io);
+
+    /**
+     * @brief 汇总正在录制的流的统计
+     * @return 统计信息
+     */
+    Stats GetStats();
+
+private:
+    /** 写线程及其负责的录制器 */
+    struct Writer
+    {
+        std::thread thread;
+        std::mutex mutex;                       ///< 保护 pending
+        std::condition_variable cond;
+        std::vector<FlvRecorder::Ptr> recorders;///< 只由写线程访问
+        std::vector<FlvRecorder::Ptr> pending;  ///< 新加入的录制器，由写线程合并
+    };
+
+    RecordService(EventLoop* eventloop, std::shared_ptr<RtmpServer> rtmp_server, const std::string& dir, uint32_t threads);
+
+    /**
+     * @brief 推流开始/结束事件，转到 0 号调度线程处理
+     */
+    void OnStreamEvent(const std::string& type, const std::string& stream_path);
+
+    /**
+     * @brief 写线程主循环：轮询录制器队列，空闲时短暂休眠
+     */
+    void Run(Writer* writer);
+
+    EventLoop* loop_;                                 ///< 事件循环
+    std::weak_ptr<RtmpServer> rtmp_server_;           ///< 提供会话的 RTMP 服务
+    std::string dir_;                                 ///< 录制根目录
+    std::vector<std::unique_ptr<Writer>> writers_;    ///< 写线程池
+    std::atomic_bool running_{true};                  ///< 写线程运行标志
+    std::mutex mutex_;                                ///< 保护 recorders_
+    std::unordered_map<std::string, FlvRecorder::Ptr> recorders_;  ///< 正在录制的流
+    uint32_t max_duration_ms_ = 10 * 60 * 1000;       ///< 单文件最大时长（毫秒）
+    uint64_t max_bytes_ = 0;                          ///< 单文件最大字节数
+    uint32_t queue_size_ = 1024;                      ///< 每条流的队列长度
+    bool direct_io_ = false;                          ///< 是否使用 O_DIRECT
+};
+
+#endif // _RECORDSERVICE_H_
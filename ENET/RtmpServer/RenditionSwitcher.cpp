@@ -0,0 +1,656 @@
+/**
+ * @file RenditionSwitcher.cpp
+ * @brief 实现观看者的档位切换：关键帧切点、时间戳对齐与升降档决策。
+ */
+#include "RenditionSwitcher.h"
+#include "RtmpServer.h"
+#include "RtmpSession.h"
+#include "rtmp.h"
+#include "../EdoyunNet/TaskScheduler.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+
+/** 采样观看者发送统计的周期（毫秒） */
+static const int64_t kSampleIntervalMs = 500;
+/** 估算可用带宽时保留的采样个数，取窗口内交付速率的最大值，减小发送端空闲时采样偏低的影响 */
+static const size_t kRateSamples = 10;
+/** 两个档位最新时间戳相差不超过该值（毫秒）时视为同一时间轴 */
+static const int64_t kMaxSkewMs = 3000;
+/** 切换最长等待时长（毫秒），超过后放弃本次切换 */
+static const int64_t kMaxSwitchMs = 4000;
+/** 切换期间目标档位最多缓存的消息数 */
+static const size_t kMaxPendingPackets = 1024;
+/** 切点前后允许的时间戳跳变（毫秒），超过时按切点重新对齐 */
+static const int64_t kMaxGapMs = 1000;
+/** 两次降档的最小间隔（毫秒），等待上次切换的积压排空 */
+static const int64_t kMinDownIntervalMs = 2000;
+/** 积压低于该时长（毫秒）且无丢帧时才考虑升档 */
+static const uint64_t kUpLagMs = 200;
+/** 降档时目标码率不超过可用带宽的百分比 */
+static const uint64_t kDownCapacityPercent = 80;
+/** 升档时可用带宽至少为目标码率的百分比 */
+static const uint64_t kUpCapacityPercent = 130;
+
+static int64_t GetNowMs()
+{
+    return std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+static bool IsMediaType(uint8_t type)
+{
+    return type == RTMP_VIDEO || type == RTMP_AUDIO;
+}
+
+/**
+ * @brief 构造函数，分配内部观看者 id；只弱引用切换器，切换器释放后输入不再转发
+ */
+RenditionSwitcher::Input::Input(std::weak_ptr<RenditionSwitcher> switcher, const std::string& stream_path,
+                                std::shared_ptr<RtmpSession> session)
+    :stream_path(stream_path)
+    ,session(session)
+    ,switcher_(switcher)
+    ,id_(AllocInternalId())
+{
+}
+
+/**
+ * @brief 会话下发的元数据交给切换器缓存或转发
+ */
+bool RenditionSwitcher::Input::SendMetaData(RtmpMediaPacket::Ptr meta_data)
+{
+    if(auto switcher = switcher_.lock())
+    {
+        switcher->OnMetaData(this, meta_data);
+    }
+    return true;
+}
+
+/**
+ * @brief 封装为共享消息后按 SendMediaPacket 处理
+ */
+bool RenditionSwitcher::Input::SendMediaData(uint8_t type, uint64_t timestamp, std::shared_ptr<char> payload, uint32_t payload_size)
+{
+    return SendMediaPacket(std::make_shared<RtmpMediaPacket>(type, timestamp, payload, payload_size));
+}
+
+/**
+ * @brief 标记档位已收到媒体，消息交给切换器决定转发、缓存或丢弃
+ */
+bool RenditionSwitcher::Input::SendMediaPacket(RtmpMediaPacket::Ptr packet)
+{
+    is_playing_ = true;
+    if(auto switcher = switcher_.lock())
+    {
+        switcher->OnPacket(this, packet);
+    }
+    return true;
+}
+
+/**
+ * @brief 返回观看者所在的调度器，会话按线程中继时输入与观看者归入同一线程
+ */
+TaskScheduler* RenditionSwitcher::Input::GetOwnerScheduler()
+{
+    auto switcher = switcher_.lock();
+    return switcher ? switcher->GetPlayerScheduler() : nullptr;
+}
+
+/**
+ * @brief 只有当前档位返回观看者的统计，切换期间观看者不被重复统计
+ */
+bool RenditionSwitcher::Input::GetSinkStats(SinkStats& stats)
+{
+    auto switcher = switcher_.lock();
+    if(!switcher)
+    {
+        return false;
+    }
+    std::shared_ptr<RtmpSink> player;
+    {
+        std::lock_guard<std::mutex> lock(switcher->mutex_);
+        if(switcher->current_.get() == this)
+        {
+            player = switcher->player_.lock();
+        }
+    }
+    if(!player || !player->GetSinkStats(stats))
+    {
+        return false;
+    }
+    stats.rendition_switches = switcher->GetSwitches();
+    return true;
+}
+
+/**
+ * @brief 会话下发完缓存的 GOP，之后的消息才计入 last_timestamp 并参与切点判断
+ */
+void RenditionSwitcher::Input::OnGopCacheSent()
+{
+    if(auto switcher = switcher_.lock())
+    {
+        std::lock_guard<std::mutex> lock(switcher->mutex_);
+        joining = false;
+    }
+}
+
+/**
+ * @brief 静态工厂方法，读取 RtmpServer 的档位配置
+ */
+RenditionSwitcher::Ptr RenditionSwitcher::Create(std::shared_ptr<RtmpServer> rtmp_server, std::shared_ptr<RtmpSink> player,
+                                                 const std::string& stream_path)
+{
+    Ptr switcher(new RenditionSwitcher(rtmp_server, player, stream_path));
+    if(switcher->suffixes_.empty())
+    {
+        return nullptr;
+    }
+    for(auto &suffix : switcher->suffixes_)
+    {
+        if(stream_path.size() > suffix.size() &&
+           stream_path.compare(stream_path.size() - suffix.size(), suffix.size(), suffix) == 0)
+        {
+            return nullptr;                               // 指定档位播放时不切换
+        }
+    }
+    RtmpSession::Ptr session = rtmp_server->FindSession(stream_path);
+    if(!session)
+    {
+        return nullptr;
+    }
+    switcher->current_ = std::make_shared<Input>(switcher, stream_path, session);
+    return switcher;
+}
+
+/**
+ * @brief 私有构造函数，在 RtmpServer 的锁内复制档位后缀与升降档参数
+ */
+RenditionSwitcher::RenditionSwitcher(std::shared_ptr<RtmpServer> rtmp_server, std::shared_ptr<RtmpSink> player,
+                                     const std::string& stream_path)
+    :rtmp_server_(rtmp_server)
+    ,player_(player)
+    ,source_path_(stream_path)
+    ,last_switch_ms_(GetNowMs())
+{
+    std::lock_guard<std::mutex> lock(rtmp_server->mutex_);
+    suffixes_ = rtmp_server->abr_suffixes_;
+    down_lag_ms_ = rtmp_server->abr_down_lag_ms_;
+    up_interval_ms_ = rtmp_server->abr_up_interval_ms_;
+}
+
+/**
+ * @brief 当前档位的输入，观看者开始播放时以它加入会话
+ */
+std::shared_ptr<RtmpSink> RenditionSwitcher::GetActiveSink()
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    return current_;
+}
+
+/**
+ * @brief 停止切换，移出当前档位与正在切换的目标档位
+ */
+void RenditionSwitcher::Stop()
+{
+    std::shared_ptr<Input> current;
+    std::shared_ptr<Input> target;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stopped_ = true;
+        current = current_;
+        target = target_;
+        target_.reset();
+        pending_.clear();
+    }
+    for(auto &input : { current, target })
+    {
+        RtmpSession::Ptr session = input ? input->session.lock() : nullptr;
+        if(session)
+        {
+            session->RemoveSink(input);
+        }
+    }
+}
+
+/**
+ * @brief 观看者所在的调度器，观看者已释放时为 nullptr
+ */
+TaskScheduler* RenditionSwitcher::GetPlayerScheduler()
+{
+    auto player = player_.lock();
+    return player ? player->GetOwnerScheduler() : nullptr;
+}
+
+/**
+ * @brief 缓存各档位的元数据，当前档位的元数据直接转发
+ */
+void RenditionSwitcher::OnMetaData(Input* input, RtmpMediaPacket::Ptr meta_data)
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    input->meta_data = meta_data;
+    if(!stopped_ && input == current_.get() && !current_done_)
+    {
+        if(auto player = player_.lock())
+        {
+            player->SendMetaData(meta_data);
+        }
+    }
+}
+
+/**
+ * @brief 处理档位的媒体消息
+ *
+ * 当前档位按偏移转发，直到到达切点；目标档位从切点之后的第一个关键帧开始缓存。
+ * 两个档位在同一时间轴上时：目标档位领先则以其关键帧为切点，当前档位继续发送到切点；
+ * 目标档位落后（转码输出有延迟）则以当前档位的关键帧为切点，当前档位暂停等待目标档位赶上。
+ * 时间轴不同时在目标档位的下一个关键帧立即切换，并重新对齐时间戳
+ */
+void RenditionSwitcher::OnPacket(Input* input, RtmpMediaPacket::Ptr packet)
+{
+    auto player = player_.lock();
+    if(!player)
+    {
+        return;
+    }
+
+    uint8_t type = packet->GetType();
+    int64_t timestamp = (int64_t)packet->GetTimestamp();
+    int64_t now = GetNowMs();
+    std::shared_ptr<Input> remove;
+    bool evaluate = false;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if(stopped_)
+        {
+            return;
+        }
+
+        if(type == RTMP_AVC_SEQUENCE_HEADER || type == RTMP_AAC_SEQUENCE_HEADER)
+        {
+            if(type == RTMP_AVC_SEQUENCE_HEADER)
+            {
+                input->avc_sequence_header = packet;
+            }
+            else
+            {
+                input->aac_sequence_header = packet;
+            }
+            if(input == current_.get() && !current_done_)
+            {
+                Forward(player, packet);
+            }
+            return;
+        }
+        if(!IsMediaType(type))
+        {
+            return;
+        }
+        if(!input->joining)
+        {
+            input->last_timestamp = timestamp;
+        }
+
+        if(input == current_.get())
+        {
+            bool key_frame = type == RTMP_VIDEO && packet->IsKeyFrame();
+            if(target_ && !current_done_)
+            {
+                if(cut_timestamp_ >= 0 && timestamp >= cut_timestamp_)
+                {
+                    current_done_ = true;                 // 到达目标档位的关键帧
+                }
+                else if(cut_timestamp_ < 0 && key_frame && target_->last_timestamp >= 0
+                     && target_->last_timestamp < timestamp && timestamp - target_->last_timestamp <= kMaxSkewMs)
+                {
+                    cut_timestamp_ = timestamp;           // 目标档位落后，在本关键帧暂停等待
+                    current_done_ = true;
+                }
+            }
+
+            if(resume_key_frame_ && type == RTMP_VIDEO)
+            {
+                resume_key_frame_ = !key_frame;
+            }
+            if(!current_done_ && !(resume_key_frame_ && type == RTMP_VIDEO))
+            {
+                Forward(player, packet);
+                last_input_ts_ = timestamp;
+            }
+
+            if(!target_ && !evaluating_ && now - last_sample_ms_ >= kSampleIntervalMs)
+            {
+                evaluating_ = true;
+                last_sample_ms_ = now;
+                evaluate = true;
+            }
+        }
+        else if(input == target_.get() && !input->joining)
+        {
+            OnTargetPacket(packet);
+        }
+
+        if(target_)
+        {
+            if(target_started_ && current_done_)
+            {
+                remove = CompleteSwitch(player);
+            }
+            else if(now - switch_start_ms_ > kMaxSwitchMs || pending_.size() > kMaxPendingPackets)
+            {
+                remove = AbortSwitch();
+            }
+        }
+    }
+
+    if(remove)
+    {
+        RemoveInput(remove);
+    }
+    if(evaluate)
+    {
+        std::weak_ptr<RenditionSwitcher> weak_switcher = shared_from_this();
+        if(TaskScheduler* scheduler = player->GetOwnerScheduler())
+        {
+            scheduler->AddReadyTask([weak_switcher]() {
+                if(auto switcher = weak_switcher.lock())
+                {
+                    switcher->Evaluate();
+                }
+            });
+        }
+    }
+}
+
+/**
+ * @brief 目标档位等待可用的关键帧，开始后缓存所有消息直到完成切换
+ */
+void RenditionSwitcher::OnTargetPacket(RtmpMediaPacket::Ptr packet)
+{
+    int64_t timestamp = (int64_t)packet->GetTimestamp();
+    if(target_started_)
+    {
+        pending_.push_back(packet);
+        return;
+    }
+    if(packet->GetType() != RTMP_VIDEO || !packet->IsKeyFrame())
+    {
+        return;
+    }
+
+    int64_t reference = current_->last_timestamp;
+    if(reference < 0 || std::abs(timestamp - reference) > kMaxSkewMs)
+    {
+        current_done_ = true;                             // 时间轴不同，立即切换
+    }
+    else if(cut_timestamp_ >= 0 ? timestamp < cut_timestamp_ : timestamp <= last_input_ts_)
+    {
+        return;                                           // 关键帧早于切点，等待下一个
+    }
+    else if(cut_timestamp_ < 0)
+    {
+        cut_timestamp_ = timestamp;
+    }
+    target_started_ = true;
+    pending_.push_back(packet);
+}
+
+/**
+ * @brief 按偏移后的时间戳发送，偏移为 0 时直接发送共享消息
+ */
+void RenditionSwitcher::Forward(const std::shared_ptr<RtmpSink>& player, RtmpMediaPacket::Ptr packet)
+{
+    int64_t timestamp = (int64_t)packet->GetTimestamp() + offset_;
+    if(timestamp < 0)
+    {
+        timestamp = 0;
+    }
+    if(offset_ != 0)
+    {
+        packet = std::make_shared<RtmpMediaPacket>(packet->GetType(), (uint64_t)timestamp, packet->GetPayload(), packet->GetSize());
+    }
+    if(IsMediaType(packet->GetType()))
+    {
+        last_output_ts_ = std::max(last_output_ts_, timestamp);
+    }
+    player->SendMediaPacket(packet);
+}
+
+/**
+ * @brief 完成切换
+ *
+ * 目标档位关键帧按原偏移输出后落在已输出时间戳之后且跳变不大时保留偏移（时间轴对齐的档位原样转发），
+ * 否则重新计算偏移，使关键帧紧接已输出的时间戳
+ */
+std::shared_ptr<RenditionSwitcher::Input> RenditionSwitcher::CompleteSwitch(const std::shared_ptr<RtmpSink>& player)
+{
+    int64_t key_timestamp = (int64_t)pending_.front()->GetTimestamp();
+    int64_t output = key_timestamp + offset_;
+    if(last_output_ts_ >= 0 && (output < last_output_ts_ || output > last_output_ts_ + kMaxGapMs))
+    {
+        offset_ = last_output_ts_ - key_timestamp;
+    }
+
+    if(target_->meta_data)
+    {
+        player->SendMetaData(target_->meta_data);
+    }
+    for(auto &header : { target_->aac_sequence_header, target_->avc_sequence_header })
+    {
+        if(header)
+        {
+            Forward(player, std::make_shared<RtmpMediaPacket>(header->GetType(), (uint64_t)key_timestamp,
+                                                              header->GetPayload(), header->GetSize()));
+        }
+    }
+    for(auto &packet : pending_)
+    {
+        Forward(player, packet);
+        last_input_ts_ = (int64_t)packet->GetTimestamp();
+    }
+
+    std::shared_ptr<Input> old = current_;
+    current_ = target_;
+    target_.reset();
+    pending_.clear();
+    cut_timestamp_ = -1;
+    current_done_ = false;
+    target_started_ = false;
+    resume_key_frame_ = false;
+    last_switch_ms_ = GetNowMs();
+    switches_++;
+    return old;
+}
+
+/**
+ * @brief 放弃切换，当前档位若已暂停则从下一个关键帧继续
+ */
+std::shared_ptr<RenditionSwitcher::Input> RenditionSwitcher::AbortSwitch()
+{
+    std::shared_ptr<Input> target = target_;
+    target_.reset();
+    pending_.clear();
+    if(current_done_)
+    {
+        resume_key_frame_ = true;
+    }
+    cut_timestamp_ = -1;
+    current_done_ = false;
+    target_started_ = false;
+    last_switch_ms_ = GetNowMs();                         // 放弃后同样等待一个间隔再尝试
+    return target;
+}
+
+/**
+ * @brief 采样观看者统计并决定升降档
+ *
+ * 积压时长 = (应用层发送队列 + 内核未发送字节) / 交付速率 + 媒体队列积压；
+ * 可用带宽取最近几次交付速率采样的最大值（发送端空闲时的采样偏低）。
+ * 积压超过阈值或出现丢帧时降到可用带宽能承载的最高档位，积压很低且带宽足够承载更高一档时升一档
+ */
+void RenditionSwitcher::Evaluate()
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        evaluating_ = false;
+    }
+    auto player = player_.lock();
+    RtmpSink::SinkStats stats;
+    if(!player || !player->GetSinkStats(stats))
+    {
+        return;
+    }
+    std::vector<Rendition> renditions = ListRenditions();
+    int64_t now = GetNowMs();
+
+    std::string target_path;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if(stopped_ || target_)
+        {
+            return;
+        }
+
+        uint64_t lag_ms = stats.lag_ms;
+        if(stats.delivery_rate > 0)
+        {
+            lag_ms += (stats.pending_bytes + stats.notsent_bytes) * 1000 / stats.delivery_rate;
+        }
+        bool dropped = stats.dropped_frames > last_dropped_frames_;
+        last_dropped_frames_ = stats.dropped_frames;
+
+        if(rate_samples_.size() < kRateSamples)
+        {
+            rate_samples_.push_back(stats.delivery_rate);
+        }
+        else
+        {
+            rate_samples_[rate_index_] = stats.delivery_rate;
+            rate_index_ = (rate_index_ + 1) % kRateSamples;
+        }
+        uint64_t capacity = *std::max_element(rate_samples_.begin(), rate_samples_.end()) * 8;
+
+        size_t index = renditions.size();
+        for(size_t i = 0; i < renditions.size(); i++)
+        {
+            if(renditions[i].stream_path == current_->stream_path)
+            {
+                index = i;
+            }
+        }
+        if(index == renditions.size())
+        {
+            return;                                       // 当前档位没有推流统计，不做决策
+        }
+
+        int64_t elapsed = now - last_switch_ms_;
+        if((lag_ms > down_lag_ms_ || dropped) && elapsed >= kMinDownIntervalMs && index + 1 < renditions.size())
+        {
+            size_t next = index + 1;
+            for(size_t i = index + 1; i < renditions.size(); i++)
+            {
+                if(capacity > 0 && renditions[i].bitrate * 100 <= capacity * kDownCapacityPercent)
+                {
+                    next = i;
+                    break;
+                }
+            }
+            target_path = renditions[next].stream_path;
+        }
+        else if(lag_ms < kUpLagMs && !dropped && elapsed >= up_interval_ms_ && index > 0
+             && capacity * 100 >= (uint64_t)renditions[index - 1].bitrate * kUpCapacityPercent)
+        {
+            target_path = renditions[index - 1].stream_path;
+        }
+    }
+
+    if(!target_path.empty())
+    {
+        StartSwitch(target_path);
+    }
+}
+
+/**
+ * @brief 源流与各后缀流中正在推流且有码率统计的档位
+ */
+std::vector<RenditionSwitcher::Rendition> RenditionSwitcher::ListRenditions()
+{
+    std::vector<Rendition> renditions;
+    auto rtmp_server = rtmp_server_.lock();
+    if(!rtmp_server)
+    {
+        return renditions;
+    }
+    std::vector<std::string> paths(1, source_path_);
+    for(auto &suffix : suffixes_)
+    {
+        paths.push_back(source_path_ + suffix);
+    }
+    for(auto &path : paths)
+    {
+        RtmpSession::Ptr session = rtmp_server->FindSession(path);
+        if(!session || !session->HasPublisher())
+        {
+            continue;
+        }
+        Rendition rendition;
+        rendition.stream_path = path;
+        rendition.bitrate = session->GetIngestStats().GetSnapshot().bitrate;
+        if(rendition.bitrate > 0)
+        {
+            renditions.push_back(rendition);
+        }
+    }
+    std::stable_sort(renditions.begin(), renditions.end(), [](const Rendition& a, const Rendition& b) {
+        return a.bitrate > b.bitrate;
+    });
+    return renditions;
+}
+
+/**
+ * @brief 加入目标档位会话，会话下发的缓存 GOP 只用于获取元数据与序列头
+ *
+ * 缓存的 GOP 由推流线程在分发下一帧之前下发，AddSink 返回时可能尚未开始；joining 在 OnGopCacheSent 中清除
+ */
+void RenditionSwitcher::StartSwitch(const std::string& stream_path)
+{
+    auto rtmp_server = rtmp_server_.lock();
+    RtmpSession::Ptr session = rtmp_server ? rtmp_server->FindSession(stream_path) : nullptr;
+    if(!session)
+    {
+        return;
+    }
+    auto input = std::make_shared<Input>(shared_from_this(), stream_path, session);
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if(stopped_ || target_)
+        {
+            return;
+        }
+        target_ = input;
+        input->joining = true;
+        pending_.clear();
+        cut_timestamp_ = -1;
+        current_done_ = false;
+        target_started_ = false;
+        switch_start_ms_ = GetNowMs();
+    }
+    session->AddSink(input);
+}
+
+/**
+ * @brief 把档位输入移出其会话，在观看者线程执行
+ */
+void RenditionSwitcher::RemoveInput(std::shared_ptr<Input> input)
+{
+    TaskScheduler* scheduler = GetPlayerScheduler();
+    RtmpSession::Ptr session = input->session.lock();
+    if(!scheduler || !session)
+    {
+        return;
+    }
+    // 可能位于会话锁内（缓存 GOP 下发时），移出会话投递到观看者线程执行
+    scheduler->AddReadyTask([session, input]() {
+        session->RemoveSink(input);
+    });
+}
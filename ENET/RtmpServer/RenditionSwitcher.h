@@ -0,0 +1,205 @@
+/**
+ * @file RenditionSwitcher.h
+ * @brief 观看者自适应码率：在同一条流的各档位会话之间按关键帧切换，对播放器透明。
+ *
+ * 主要职责：
+ *  - 以内部 Sink（Input）代替观看者加入档位会话，媒体经切换器转发给观看者连接
+ *  - 按观看者的 TCP 交付速率、发送积压与丢帧决定升降档，档位码率取各会话的推流统计
+ *  - 切换时以目标档位的关键帧为切点：旧档位发送到切点为止，之后先发新档位的元数据与序列头，再从关键帧开始发送
+ *  - 档位时间轴对齐（转码档位沿用源时间戳）时时间戳原样转发，否则在切点重新对齐，保证输出连续
+ *
+ * RTMP 与 HTTP-FLV 观看者共用，播放器无需改动。
+ */
+
+#ifndef _RENDITIONSWITCHER_H_
+#define _RENDITIONSWITCHER_H_
+
+#include "RtmpSink.h"
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+class RtmpServer;
+class RtmpSession;
+
+/**
+ * @class RenditionSwitcher
+ * @brief 单个观看者的档位切换器，由观看者连接持有
+ *
+ * 各档位的消息可能来自不同的推流线程，内部以互斥锁串行化；
+ * 加锁顺序为会话锁在前、切换器锁在后，因此加入与移出会话、读取档位统计都投递到观看者所在线程执行
+ */
+class RenditionSwitcher : public std::enable_shared_from_this<RenditionSwitcher>
+{
+public:
+    using Ptr = std::shared_ptr<RenditionSwitcher>;
+
+    /** 服务未开启传输层统计时，观看者连接为切换决策开启的 TCP_INFO 采样周期（毫秒） */
+    static const uint32_t kTransportStatsInterval = 500;
+
+    /**
+     * @brief 为观看者创建切换器
+     * @param rtmp_server 提供会话与档位配置的 RTMP 服务
+     * @param player 观看者连接
+     * @param stream_path 请求的流路径，观看者从该流开始播放
+     * @return 切换器，未开启自适应码率或请求的本身是档位流时返回 nullptr
+     */
+    static Ptr Create(std::shared_ptr<RtmpServer> rtmp_server, std::shared_ptr<RtmpSink> player,
+                      const std::string& stream_path);
+
+    /**
+     * @brief 获取代替观看者加入请求的流会话的 Sink
+     * @return 内部 Sink，观看者开始播放时将其加入会话
+     */
+    std::shared_ptr<RtmpSink> GetActiveSink();
+
+    /**
+     * @brief 停止切换并移出所有档位会话（观看者所在线程调用，不能在会话锁内调用）
+     */
+    void Stop();
+
+    /**
+     * @brief 已完成的切换次数
+     */
+    uint32_t GetSwitches() const { return switches_; }
+
+private:
+    /** 代替观看者加入一个档位会话，收到的消息交给切换器 */
+    class Input : public RtmpSink
+    {
+    public:
+        Input(std::weak_ptr<RenditionSwitcher> switcher, const std::string& stream_path,
+              std::shared_ptr<RtmpSession> session);
+
+        virtual bool SendMetaData(RtmpMediaPacket::Ptr meta_data) override;
+        virtual bool SendMediaData(uint8_t type, uint64_t timestamp, std::shared_ptr<char> payload, uint32_t payload_size) override;
+        virtual bool SendMediaPacket(RtmpMediaPacket::Ptr packet) override;
+        virtual bool IsPlayer() override { return true; }
+        virtual bool IsPlaying() override { return is_playing_; }
+        virtual uint32_t GetId() override { return id_; }
+        virtual TaskScheduler* GetOwnerScheduler() override;            ///< 观看者所在线程，会话按线程中继
+        virtual bool GetSinkStats(SinkStats& stats) override;           ///< 当前档位返回观看者的统计
+        virtual void OnGopCacheSent() override;                         ///< 结束加入，之后的消息按实时处理
+
+        const std::string stream_path;              ///< 档位流路径
+        const std::weak_ptr<RtmpSession> session;   ///< 档位会话
+
+        // 以下成员由切换器加锁访问
+        RtmpMediaPacket::Ptr meta_data;             ///< 档位的元数据
+        RtmpMediaPacket::Ptr avc_sequence_header;   ///< 档位的视频序列头
+        RtmpMediaPacket::Ptr aac_sequence_header;   ///< 档位的音频序列头
+        int64_t last_timestamp = -1;                ///< 最近收到的实时音视频时间戳，-1 表示尚未收到
+        bool joining = false;                       ///< 正在加入会话，会话下发完缓存的 GOP 之前为 true
+
+    private:
+        std::weak_ptr<RenditionSwitcher> switcher_;
+        std::atomic_bool is_playing_{false};        ///< 是否收到过媒体消息
+        const uint32_t id_;
+    };
+
+    /** 一个正在推流的档位 */
+    struct Rendition
+    {
+        std::string stream_path;
+        uint32_t bitrate = 0;                       ///< 推流统计的码率（bit/s）
+    };
+
+    RenditionSwitcher(std::shared_ptr<RtmpServer> rtmp_server, std::shared_ptr<RtmpSink> player,
+                      const std::string& stream_path);
+
+    /**
+     * @brief 处理档位的元数据，当前档位直接转发
+     */
+    void OnMetaData(Input* input, RtmpMediaPacket::Ptr meta_data);
+
+    /**
+     * @brief 处理档位的媒体消息：转发当前档位、缓存目标档位切点之后的消息，两者都到达切点时完成切换
+     */
+    void OnPacket(Input* input, RtmpMediaPacket::Ptr packet);
+
+    /**
+     * @brief 处理目标档位的媒体消息（调用者持有 mutex_）
+     */
+    void OnTargetPacket(RtmpMediaPacket::Ptr packet);
+
+    /**
+     * @brief 按偏移后的时间戳发送给观看者（调用者持有 mutex_）
+     */
+    void Forward(const std::shared_ptr<RtmpSink>& player, RtmpMediaPacket::Ptr packet);
+
+    /**
+     * @brief 完成切换：对齐时间戳，先发新档位的元数据与序列头，再发缓存的消息（调用者持有 mutex_）
+     * @return 需要移出会话的旧档位
+     */
+    std::shared_ptr<Input> CompleteSwitch(const std::shared_ptr<RtmpSink>& player);
+
+    /**
+     * @brief 放弃未完成的切换，已暂停的当前档位从下一个关键帧恢复（调用者持有 mutex_）
+     * @return 需要移出会话的目标档位
+     */
+    std::shared_ptr<Input> AbortSwitch();
+
+    /**
+     * @brief 采样观看者的发送统计并决定是否切换（观看者所在线程）
+     */
+    void Evaluate();
+
+    /**
+     * @brief 列出正在推流的各档位，按码率从高到低排列
+     */
+    std::vector<Rendition> ListRenditions();
+
+    /**
+     * @brief 加入目标档位会话，开始切换（观看者所在线程）
+     * @param stream_path 目标档位路径
+     */
+    void StartSwitch(const std::string& stream_path);
+
+    /**
+     * @brief 在观看者所在线程把档位移出会话
+     */
+    void RemoveInput(std::shared_ptr<Input> input);
+
+    /**
+     * @brief 观看者所在的调度线程
+     */
+    TaskScheduler* GetPlayerScheduler();
+
+    std::weak_ptr<RtmpServer> rtmp_server_;         ///< 提供档位会话的 RTMP 服务
+    std::weak_ptr<RtmpSink> player_;                ///< 观看者连接
+    const std::string source_path_;                 ///< 请求的流路径，档位路径为其加后缀
+    std::vector<std::string> suffixes_;             ///< 档位后缀
+    uint32_t down_lag_ms_;                          ///< 发送积压超过该时长（毫秒）时降档
+    uint32_t up_interval_ms_;                       ///< 距上次切换至少该时长（毫秒）才升档
+
+    std::mutex mutex_;                              ///< 串行化各档位的回调
+    std::shared_ptr<Input> current_;                ///< 当前档位
+    std::shared_ptr<Input> target_;                 ///< 正在切换到的档位
+    bool stopped_ = false;                          ///< 是否已停止
+
+    // 切换状态
+    int64_t cut_timestamp_ = -1;                    ///< 切点（档位时间戳），-1 表示尚未确定
+    bool current_done_ = false;                     ///< 当前档位已到达切点，不再转发
+    bool target_started_ = false;                   ///< 目标档位已从关键帧开始缓存
+    std::vector<RtmpMediaPacket::Ptr> pending_;     ///< 目标档位从关键帧开始的消息，完成切换时发送
+    int64_t switch_start_ms_ = 0;                   ///< 开始切换的时刻
+    bool resume_key_frame_ = false;                 ///< 放弃切换后当前档位的视频从关键帧恢复
+
+    // 时间戳
+    int64_t offset_ = 0;                            ///< 档位时间戳到输出时间戳的偏移
+    int64_t last_input_ts_ = -1;                    ///< 当前档位最近转发的时间戳
+    int64_t last_output_ts_ = -1;                   ///< 最近输出的时间戳
+
+    // 档位决策
+    bool evaluating_ = false;                       ///< 已投递采样任务
+    int64_t last_sample_ms_ = 0;                    ///< 上次采样的时刻
+    int64_t last_switch_ms_ = 0;                    ///< 上次切换（或开始播放）的时刻
+    std::vector<uint64_t> rate_samples_;            ///< 最近几次采样的交付速率（字节/秒）
+    size_t rate_index_ = 0;                         ///< 下一个采样写入的位置
+    uint64_t last_dropped_frames_ = 0;              ///< 上次采样时的累计丢帧数
+    std::atomic<uint32_t> switches_{0};             ///< 已完成的切换次数
+};
+
+#endif // _RENDITIONSWITCHER_H_
@@ -12,6 +12,7 @@
 // fmt=2：只保留时间增量的 Message Header（3 字节）
 // fmt=3：无 Message Header（0 字节），完全复用上一个 chunk 的信息
 #include "RtmpChunk.h"
+#include "rtmp.h"
 #include <string.h>
 
 int RtmpChunk::stream_id_ = 0;
@@ -20,7 +21,6 @@ RtmpChunk::RtmpChunk()
 {
     // 初始化解析状态并分配唯一chunk stream id
     state_ = PARSE_HEADER;
-    chunk_stream_id_ = -1;
     ++stream_id_;
 }
 
@@ -28,96 +28,268 @@ RtmpChunk::~RtmpChunk()
 {
 }
 
+// Parse: 在一次调用内连续解析chunk头和chunk体，直到一条消息完整或数据不足
 int RtmpChunk::Parse(BufferReader &in_buffer, RtmpMessage &out_rtmp_msg)
 {
-    int ret = 0;
-    // 当buffer中无数据时，直接返回0等待更多数据
-    if (!in_buffer.ReadableBytes())
+    int bytes_used = 0;
+    while (in_buffer.ReadableBytes() > 0)
     {
-        return 0;
+        int ret = 0;
+        if (state_ == PARSE_HEADER)
+        {
+            // 先解析chunk报头
+            ret = ParseChunkHeader(in_buffer);
+            if (ret > 0 && ParseInPlace(in_buffer, out_rtmp_msg))
+            {
+                return bytes_used + ret + out_rtmp_msg.lenght;
+            }
+        }
+        else
+        {
+            // 解析chunk数据体
+            ret = ParseChunkBody(in_buffer);
+        }
+
+        if (ret < 0)
+        {
+            return ret;
+        }
+        if (ret == 0)
+        {
+            break;                             // 数据不足，等待下一次读取
+        }
+        bytes_used += ret;
+
+        // chunk结束且payload已填满时输出完整消息
+        if (state_ == PARSE_HEADER && current_ != nullptr
+            && current_->lenght > 0 && current_->index == current_->lenght)
+        {
+            CompleteMessage(out_rtmp_msg);
+            break;
+        }
     }
+    return bytes_used;
+}
 
-    if (state_ == PARSE_HEADER)
+// Clear: 丢弃所有未完成消息并回到解析header状态
+void RtmpChunk::Clear()
+{
+    for (uint32_t csid = 0; csid < kMaxFastCsid; csid++)
     {
-        // 先解析chunk报头
-        ret = ParseChunkHeader(in_buffer);
+        rtmp_message_[csid] = RtmpMessage();
     }
-    else
+    overflow_message_.clear();
+    current_ = nullptr;
+    chunk_remaining_ = 0;
+    state_ = PARSE_HEADER;
+}
+
+// ParseInPlace: 控制类、命令类消息在处理时解码完毕、不会被持有，
+// 整条消息已在buffer中时直接引用buffer内存，省去分配和拷贝；
+// 数据消息中的元数据由会话直接共享，与媒体数据一样需要拷贝
+bool RtmpChunk::ParseInPlace(BufferReader &buffer, RtmpMessage &out_rtmp_msg)
+{
+    RtmpMessage& rtmp_msg = *current_;
+    if (state_ != PARSE_BODY || rtmp_msg.index != 0 || rtmp_msg.lenght > chunk_remaining_
+        || rtmp_msg.lenght > buffer.ReadableBytes())
+    {
+        return false;
+    }
+    if (rtmp_msg.type_id == RTMP_AUDIO || rtmp_msg.type_id == RTMP_VIDEO || rtmp_msg.type_id == RTMP_AGGREGATE
+        || rtmp_msg.type_id == RTMP_NOTIFY)
     {
-        // 解析chunk数据体
-        ret = ParseChunkBody(in_buffer);
-        // 解析成功且已累计到完整消息时
-        if (ret > 0 && chunk_stream_id_ >= 0)
+        return false;                          // 媒体数据与元数据会被会话缓存和转发，必须拷贝
+    }
+
+    // 别名构造: 不持有引用计数，只携带指针
+    rtmp_msg.playload = std::shared_ptr<char>(std::shared_ptr<char>(), buffer.Peek());
+    rtmp_msg.index = rtmp_msg.lenght;
+    buffer.Retrieve(rtmp_msg.lenght);
+    state_ = PARSE_HEADER;
+    chunk_remaining_ = 0;
+    CompleteMessage(out_rtmp_msg);
+    return true;
+}
+
+// CompleteMessage: 输出完整消息，payload移交给调用者，状态保留给同一csid的后续消息复用
+void RtmpChunk::CompleteMessage(RtmpMessage &out_rtmp_msg)
+{
+    RtmpMessage& rtmp_msg = *current_;
+    out_rtmp_msg.timestamp = rtmp_msg.timestamp;
+    out_rtmp_msg.lenght = rtmp_msg.lenght;
+    out_rtmp_msg.type_id = rtmp_msg.type_id;
+    out_rtmp_msg.stream_id = rtmp_msg.stream_id;
+    out_rtmp_msg.extend_timestamp = rtmp_msg.extend_timestamp;
+    out_rtmp_msg._timestamp = rtmp_msg._timestamp;
+    out_rtmp_msg.codeId = rtmp_msg.codeId;
+    out_rtmp_msg.csid = rtmp_msg.csid;
+    out_rtmp_msg.index = rtmp_msg.index;
+    out_rtmp_msg.playload = std::move(rtmp_msg.playload);
+    rtmp_msg.index = 0;
+    current_ = nullptr;
+}
+
+// CreateChunk: 将完整消息in_msg拆分并写入buf，buf_size为缓冲区大小
+// csid为输出chunk stream id，按发送状态选择头部，返回写入总字节数，失败返回-1
+int RtmpChunk::CreateChunk(uint32_t csid, RtmpMessage &in_msg, char *buf, uint32_t buf_size)
+{
+    RtmpChunkHeader& prev = GetOutHeader(csid);
+    uint32_t delta = 0;
+    uint8_t fmt = SelectFormat(prev, in_msg, delta);
+    int ret = CreateChunk(csid, in_msg, out_chunk_size_, fmt, delta, buf, buf_size);
+    if (ret > 0)
+    {
+        UpdateHeader(prev, in_msg, fmt, delta);
+        AddHeaderBytesSaved(fmt);
+        in_msg.lenght = 0;
+    }
+    return ret;
+}
+
+// CreateChunkHeaders: 头部格式与CreateChunk相同，负载长度只用于计算chunk数
+int RtmpChunk::CreateChunkHeaders(uint32_t csid, const RtmpMessage &in_msg, char *buf, uint32_t buf_size,
+                                  std::vector<uint32_t> &sizes)
+{
+    uint32_t chunk_size = out_chunk_size_;
+    if (chunk_size == 0 || in_msg.lenght == 0 || buf_size < GetChunkHeadersCapacity(in_msg.lenght, chunk_size))
+    {
+        return -1;
+    }
+    RtmpChunkHeader& prev = GetOutHeader(csid);
+    uint32_t delta = 0;
+    uint8_t fmt = SelectFormat(prev, in_msg, delta);
+    uint32_t buf_offset = 0;
+    sizes.clear();
+    for (uint32_t offset = 0; offset < in_msg.lenght; offset += chunk_size)
+    {
+        uint32_t header_size = 0;
+        if (offset == 0)
         {
-            auto& rtmp_msg = rtmp_message_[chunk_stream_id_];
-            // 判断payload是否填充完成
-            if (rtmp_msg.index == rtmp_msg.lenght)
+            header_size += CreateBasicHeader(fmt, csid, buf + buf_offset);
+            if (fmt == 0)
             {
-                // 更新绝对时间戳(_timestamp)
-                if (rtmp_msg.timestamp >= 0xFFFFFF)
-                {
-                    rtmp_msg._timestamp += rtmp_msg.extend_timestamp;
-                }
-                else
-                {
-                    rtmp_msg._timestamp += rtmp_msg.timestamp;
-                }
-                // 将完整消息输出
-                out_rtmp_msg = rtmp_msg;
-                // 重置状态，释放message缓冲
-                chunk_stream_id_ = -1;
-                rtmp_msg.Clear();
+                header_size += CreateMessageHeader(0, in_msg, buf + buf_offset + header_size);
             }
+            else
+            {
+                RtmpMessage header_msg;
+                header_msg._timestamp = delta;
+                header_msg.lenght = in_msg.lenght;
+                header_msg.type_id = in_msg.type_id;
+                header_size += CreateMessageHeader(fmt, header_msg, buf + buf_offset + header_size);
+            }
+        }
+        else
+        {
+            header_size += CreateBasicHeader(3, csid, buf + buf_offset);
+        }
+        if (in_msg._timestamp >= 0xFFFFFF)
+        {
+            WriteUint32BE(buf + buf_offset + header_size, (uint32_t)in_msg._timestamp);
+            header_size += 4;
         }
+        buf_offset += header_size;
+        sizes.push_back(header_size);
     }
-    return ret;
+    UpdateHeader(prev, in_msg, fmt, delta);
+    AddHeaderBytesSaved(fmt);
+    return buf_offset;
 }
 
-// CreateChunk: 将完整消息in_msg拆分并写入buf，buf_size为缓冲区大小
-// csid为输出chunk stream id，返回写入总字节数，失败返回-1
-int RtmpChunk::CreateChunk(uint32_t csid, RtmpMessage &in_msg, char *buf, uint32_t buf_size)
+// CreateChunk: 按chunk_size拆分消息，首个chunk用fmt=0，后续chunk用fmt=3
+int RtmpChunk::CreateChunk(uint32_t csid, const RtmpMessage &in_msg, uint32_t chunk_size, char *buf, uint32_t buf_size)
+{
+    return CreateChunk(csid, in_msg, chunk_size, 0, 0, buf, buf_size);
+}
+
+// SelectFormat: 只在时间戳不回退且无需扩展时间戳时使用增量头部，
+// fmt3只用于上一条消息也以相同增量发送的情况，避免接收端把fmt0的绝对时间戳当作增量
+uint8_t RtmpChunk::SelectFormat(const RtmpChunkHeader &prev, const RtmpMessage &in_msg, uint32_t &delta)
+{
+    delta = 0;
+    if (!prev.valid || prev.stream_id != in_msg.stream_id
+        || in_msg._timestamp >= 0xFFFFFF || in_msg._timestamp < prev.timestamp)
+    {
+        return 0;
+    }
+    delta = (uint32_t)in_msg._timestamp - prev.timestamp;
+    if (prev.lenght != in_msg.lenght || prev.type_id != in_msg.type_id)
+    {
+        return 1;
+    }
+    if (prev.has_delta && prev.delta == delta)
+    {
+        return 3;
+    }
+    return 2;
+}
+
+void RtmpChunk::UpdateHeader(RtmpChunkHeader &prev, const RtmpMessage &in_msg, uint8_t fmt, uint32_t delta)
+{
+    prev.valid = true;
+    prev.has_delta = (fmt != 0);
+    prev.type_id = in_msg.type_id;
+    prev.lenght = in_msg.lenght;
+    prev.stream_id = in_msg.stream_id;
+    prev.timestamp = (uint32_t)in_msg._timestamp;
+    prev.delta = delta;
+}
+
+// CreateChunk: 首个chunk按fmt写消息头，后续chunk用fmt=3
+int RtmpChunk::CreateChunk(uint32_t csid, const RtmpMessage &in_msg, uint32_t chunk_size, uint8_t fmt, uint32_t delta,
+                           char *buf, uint32_t buf_size)
 {
     uint32_t buf_offset = 0;
     uint32_t playload_offset = 0;
-    // 预估最坏情况需要的缓冲区(capacity) = payload + 每个chunk可能4字节扩展ts + Basic头
-    uint32_t capacity = in_msg.lenght + in_msg.lenght / out_chunk_size_ * 5;
-    if (buf_size < capacity)
+    uint32_t remaining = in_msg.lenght;
+    // 预估最坏情况需要的缓冲区: payload + 每个chunk的Basic头(最多3字节)与扩展ts(4字节)
+    if (chunk_size == 0 || buf_size < GetChunkCapacity(in_msg.lenght, chunk_size))
     {
         return -1;
     }
-    // 写入第一个chunk的Basic Header和Message Header
-    buf_offset += CreateBasicHeader(0, csid, buf + buf_offset);
-    buf_offset += CreateMessageHeader(0, in_msg, buf + buf_offset);
-    // 写入扩展时间戳（当_timestamp>=0xFFFFFF时）
+    // 写入第一个chunk的Basic Header和Message Header，增量头部的时间戳字段为delta
+    buf_offset += CreateBasicHeader(fmt, csid, buf + buf_offset);
+    if (fmt == 0)
+    {
+        buf_offset += CreateMessageHeader(0, in_msg, buf + buf_offset);
+    }
+    else
+    {
+        RtmpMessage header_msg;
+        header_msg._timestamp = delta;
+        header_msg.lenght = in_msg.lenght;
+        header_msg.type_id = in_msg.type_id;
+        buf_offset += CreateMessageHeader(fmt, header_msg, buf + buf_offset);
+    }
+    // 写入扩展时间戳（当_timestamp>=0xFFFFFF时，只会出现在fmt0）
     if (in_msg._timestamp >= 0xFFFFFF)
     {
-        WriteUint32BE((char*)buf + buf_offset, (uint32_t)in_msg.extend_timestamp);
+        WriteUint32BE((char*)buf + buf_offset, (uint32_t)in_msg._timestamp);
         buf_offset += 4;
     }
     // 拆分payload到多个chunk
-    while (in_msg.lenght > 0)
+    while (remaining > 0)
     {
-        if (in_msg.lenght > out_chunk_size_)
+        if (remaining > chunk_size)
         {
             // 写入chunk_size长度的数据
-            memcpy(buf + buf_offset, in_msg.playload.get() + playload_offset, out_chunk_size_);
-            playload_offset += out_chunk_size_;
-            buf_offset += out_chunk_size_;
-            in_msg.lenght -= out_chunk_size_;
+            memcpy(buf + buf_offset, in_msg.playload.get() + playload_offset, chunk_size);
+            playload_offset += chunk_size;
+            buf_offset += chunk_size;
+            remaining -= chunk_size;
             // 写入后续chunk的Basic Header(FMT=3)和可选扩展TS
             buf_offset += CreateBasicHeader(3, csid, buf + buf_offset);
             if (in_msg._timestamp >= 0xFFFFFF)
             {
-                WriteUint32BE(buf + buf_offset, (uint32_t)in_msg.extend_timestamp);
+                WriteUint32BE(buf + buf_offset, (uint32_t)in_msg._timestamp);
                 buf_offset += 4;
             }
         }
         else
         {
             // 写入最后一个包的剩余payload
-            memcpy(buf + buf_offset, in_msg.playload.get() + playload_offset, in_msg.lenght);
-            buf_offset += in_msg.lenght;
-            in_msg.lenght = 0;
+            memcpy(buf + buf_offset, in_msg.playload.get() + playload_offset, remaining);
+            buf_offset += remaining;
             break;
         }
     }
@@ -125,6 +297,7 @@ int RtmpChunk::CreateChunk(uint32_t csid, RtmpMessage &in_msg, char *buf, uint32
 }
 
 // 解析chunk的基本报头和消息报头，准备后续body解析
+// 先把所有字段读到局部变量，数据完整后才更新消息状态，数据不足时可以安全重试
 int RtmpChunk::ParseChunkHeader(BufferReader &buffer)
 {
     uint32_t bytes_used = 0;// 已解析的字节数
@@ -132,28 +305,12 @@ int RtmpChunk::ParseChunkHeader(BufferReader &buffer)
     uint8_t* buf = (uint8_t*)buffer.Peek();
     uint32_t buf_size = buffer.ReadableBytes();
 
-    // 1. 解析Basic Header(fmt一共有3个版本): 读取fmt和csid
+    // 1. 解析Basic Header: 高两位为fmt，低六位为0/1时csid分别占2/3字节
     uint8_t flags = buf[bytes_used];
-    
     uint8_t fmt = (flags >> 6); // 高两位存放fmt: 0-3
-    if (fmt >= 4)
-    {
-        return -1; // FMT范围0-3
-    }
     bytes_used += 1;
-    uint8_t csid = flags & 0x3F; // 低六位存放CSID
-    if (csid == 0) 
-    {
-        // 1字节形式: csid = 0
-        if (buf_size < bytes_used) return 0; // 数据不足
-        csid = 0; // CSID为0表示使用默认chunk stream
-    }
-    else if (csid < 64)
-    {
-        // 1字节形式: csid = buf[0] & 0x3F
-        // 已经在flags中解析过了
-    }
-    else if (csid < 320)
+    uint32_t csid = flags & 0x3F;
+    if (csid == 0)
     {
         // 2字节形式: csid = buf[1] + 64
         if (buf_size < (bytes_used + 1)) return 0;
@@ -176,92 +333,96 @@ int RtmpChunk::ParseChunkHeader(BufferReader &buffer)
     memcpy(&header, buf + bytes_used, header_len);
     bytes_used += header_len;
 
-    auto& rtmp_msg = rtmp_message_[csid];
-    chunk_stream_id_ = rtmp_msg.csid = csid;
+    RtmpMessage& rtmp_msg = GetMessage(csid);
 
-    // 在FMT<=1时，需要(重新)分配payload缓冲区和设置消息类型
+    // 3. 时间戳字段为0xFFFFFF时后面跟4字节扩展时间戳；fmt=3沿用上一个chunk的字段
+    uint32_t timestamp = (fmt <= 2) ? ReadUint24BE((char*)header.timestamp) : rtmp_msg.timestamp;
+    uint32_t extend_ts = rtmp_msg.extend_timestamp;
+    if (timestamp >= 0xFFFFFF)
+    {
+        if (buf_size < (bytes_used + 4)) return 0;
+        extend_ts = ReadUint32BE((char*)buf + bytes_used);
+        bytes_used += 4;
+    }
+
+    // 数据完整，更新消息状态
+    current_ = &rtmp_msg;
+    rtmp_msg.csid = csid;
     if (fmt <= 1)
     {
-        uint32_t lenght = ReadUint24BE((char*)header.lenght);
-        if (rtmp_msg.lenght != lenght || !rtmp_msg.playload)
-        {
-            rtmp_msg.lenght = lenght;
-            rtmp_msg.playload.reset(new char[lenght], std::default_delete<char[]>());
-        }
-        rtmp_msg.index = 0;
+        // 长度和类型变化，之前未完成的消息作废
+        rtmp_msg.lenght = ReadUint24BE((char*)header.lenght);
         rtmp_msg.type_id = header.type_id;
+        rtmp_msg.index = 0;
+        rtmp_msg.playload.reset();
     }
-
-    // 在FMT=0时，额外设置message stream id
     if (fmt == 0)
     {
         rtmp_msg.stream_id = ReadUint32LE((char*)header.stream_id);
     }
+    rtmp_msg.timestamp = timestamp;
+    rtmp_msg.extend_timestamp = extend_ts;
 
-    // 3. 解析或累加时间戳
-    uint32_t timestamp = ReadUint24BE((char*)header.timestamp);
-    uint32_t extend_ts = 0;
-    if (timestamp >= 0xFFFFFF || rtmp_msg.timestamp >= 0xFFFFFF)
-    {
-        // 读取扩展时间戳(4字节)
-        if (buf_size < (bytes_used + 4)) return 0;
-        extend_ts = ReadUint32BE((char*)buf + bytes_used);
-        bytes_used += 4;
-    }
-    // 根据fmt将timestamp累加到rtmp_msg
+    // 新消息的第一个chunk: fmt=0为绝对时间戳，其余为相对上一条消息的增量
     if (rtmp_msg.index == 0)
     {
-        // 第一个chunk: 初始化timestamp和extend_timestamp
-        rtmp_msg._timestamp = 0;
-        rtmp_msg.timestamp = timestamp;
-        rtmp_msg.extend_timestamp = extend_ts;
-    }
-    else
-    {
-        // 后续chunk: 累加timestamp或extend_timestamp
-        if (rtmp_msg.timestamp >= 0xFFFFFF)
-            rtmp_msg.extend_timestamp += extend_ts;
+        uint32_t value = (timestamp >= 0xFFFFFF) ? extend_ts : timestamp;
+        if (fmt == 0)
+        {
+            rtmp_msg._timestamp = value;
+        }
         else
-            rtmp_msg.timestamp += timestamp;
+        {
+            rtmp_msg._timestamp += value;
+        }
     }
 
-    // 准备解析Body
-    state_ = PARSE_BODY;
+    // 准备解析Body，空消息没有body
+    chunk_remaining_ = rtmp_msg.lenght - rtmp_msg.index;
+    if (chunk_remaining_ > in_chunk_size_)
+    {
+        chunk_remaining_ = in_chunk_size_;
+    }
+    state_ = chunk_remaining_ > 0 ? PARSE_BODY : PARSE_HEADER;
     buffer.Retrieve(bytes_used);
     return bytes_used;
 }
 
 // 解析chunk的数据体，将payload拼装到对应RtmpMessage
+// 已到达的部分立即拷贝，不必等整个chunk到齐
 int RtmpChunk::ParseChunkBody(BufferReader &buffer)
 {
-    uint32_t bytes_used = 0;
     uint8_t* buf = (uint8_t*)buffer.Peek();
     uint32_t buf_size = buffer.ReadableBytes();
 
-    if (chunk_stream_id_ < 0)
+    if (current_ == nullptr)
     {
         return -1; // header未正确解析
     }
 
-    auto& rtmp_msg = rtmp_message_[chunk_stream_id_];
-    // 计算当前chunk应读取多少payload
-    uint32_t to_copy = rtmp_msg.lenght - rtmp_msg.index;
-    if (to_copy > in_chunk_size_) to_copy = in_chunk_size_;
-    if (buf_size < to_copy) return 0; // 数据不足
+    RtmpMessage& rtmp_msg = *current_;
+    if (!rtmp_msg.playload)
+    {
+        rtmp_msg.playload = buffer_pool_.Allocate(rtmp_msg.lenght);
+    }
+
+    // 计算本次应读取多少payload
+    uint32_t to_copy = chunk_remaining_;
+    if (to_copy > buf_size) to_copy = buf_size;
 
     // 拷贝payload数据, 从当前chunk的index位置开始
-    memcpy(rtmp_msg.playload.get() + rtmp_msg.index, buf + bytes_used, to_copy);
-    bytes_used += to_copy;
+    memcpy(rtmp_msg.playload.get() + rtmp_msg.index, buf, to_copy);
     rtmp_msg.index += to_copy;
+    chunk_remaining_ -= to_copy;
 
-    // 若读取完本chunk或达完整消息边界，则切回header解析
-    if (rtmp_msg.index >= rtmp_msg.lenght || rtmp_msg.index % in_chunk_size_ == 0)
+    // 读取完本chunk，切回header解析
+    if (chunk_remaining_ == 0)
     {
         state_ = PARSE_HEADER;
     }
-    buffer.Retrieve(bytes_used);// 更新缓冲区已读字节数
+    buffer.Retrieve(to_copy);// 更新缓冲区已读字节数
     // 返回本次解析消耗的字节数
-    return bytes_used;
+    return to_copy;
 }
 
 int RtmpChunk::CreateBasicHeader(uint8_t fmt, uint32_t csid, char *buf)
@@ -288,7 +449,7 @@ int RtmpChunk::CreateBasicHeader(uint8_t fmt, uint32_t csid, char *buf)
     return len;
 }
 
-int RtmpChunk::CreateMessageHeader(uint8_t fmt, RtmpMessage &rtmp_msg, char *buf)
+int RtmpChunk::CreateMessageHeader(uint8_t fmt, const RtmpMessage &rtmp_msg, char *buf)
 {
     int len = 0;
     // fmt<=2: 写入时间戳(3字节)
@@ -10,8 +10,24 @@
 
 #include "../EdoyunNet/BufferReader.h"
 #include "../EdoyunNet/BufferWriter.h"
+#include "../EdoyunNet/BufferPool.h"
 #include "RtmpMessage.h"
-#include <map>
+#include <atomic>
+#include <unordered_map>
+#include <vector>
+
+// RtmpChunkHeader: 发送端某个csid上最近一条消息的头部字段，
+// 下一条消息据此选择最小的fmt（同流ID用fmt1，长度类型相同用fmt2，时间增量也相同用fmt3）
+struct RtmpChunkHeader
+{
+    bool valid = false;        // 该csid上是否已发送过消息
+    bool has_delta = false;    // 最近一条消息是否以时间增量发送，只有此时fmt3可沿用增量
+    uint8_t type_id = 0;
+    uint32_t lenght = 0;
+    uint32_t stream_id = 0;
+    uint32_t timestamp = 0;    // 绝对时间戳
+    uint32_t delta = 0;        // 时间增量
+};
 
 class RtmpChunk
 {
@@ -27,14 +43,68 @@ public:
     RtmpChunk();
     virtual ~RtmpChunk();
 
-    // Parse: 从in_buffer读取chunk数据，填充out_rtmp_msg
+    // Parse: 从in_buffer连续解析多个chunk，直到拼出一条完整消息或数据不足
     // 返回>=0: 本次解析消耗的字节数，0表示需要更多数据，<0表示出错
+    // 音视频以外的消息整条位于in_buffer中时不拷贝，out_rtmp_msg.playload直接指向in_buffer，
+    // 只在下一次读取in_buffer之前有效；音视频消息的payload来自缓冲区池，可以长期持有
     int Parse(BufferReader& in_buffer, RtmpMessage& out_rtmp_msg);
 
     // CreateChunk: 将完整消息in_msg拆分并写入buf，buf_size为缓冲区大小
-    // csid为输出chunk stream id，返回写入总字节数，失败返回-1
+    // csid为输出chunk stream id，按该csid的发送状态选择最小的头部，返回写入总字节数，失败返回-1
+    // 与其他发送路径共用头部状态，调用者需保证分片顺序与入队顺序一致
     int CreateChunk(uint32_t csid, RtmpMessage& in_msg, char* buf, uint32_t buf_size);
 
+    // CreateChunk: 按指定chunk_size拆分消息，首个chunk使用fmt0，不依赖发送状态
+    // 返回写入总字节数，失败返回-1；in_msg不会被修改
+    static int CreateChunk(uint32_t csid, const RtmpMessage& in_msg, uint32_t chunk_size, char* buf, uint32_t buf_size);
+
+    // CreateChunk: 首个chunk使用指定的fmt，fmt1/2的时间戳字段写入delta，fmt3不写消息头
+    static int CreateChunk(uint32_t csid, const RtmpMessage& in_msg, uint32_t chunk_size, uint8_t fmt, uint32_t delta,
+                           char* buf, uint32_t buf_size);
+
+    // CreateChunkHeaders: 只生成in_msg按发送端chunk大小拆分后各chunk的头部，负载由调用者切片后与头部交替发送，不拷贝
+    // 头部依次写入buf，sizes输出每个头部的长度（首个为按发送状态压缩的完整头部，其余为fmt3头部）
+    // 与CreateChunk共用发送状态并同样更新，返回写入总字节数，失败返回-1
+    int CreateChunkHeaders(uint32_t csid, const RtmpMessage& in_msg, char* buf, uint32_t buf_size, std::vector<uint32_t>& sizes);
+
+    // 计算CreateChunkHeaders所需的缓冲区大小
+    static uint32_t GetChunkHeadersCapacity(uint32_t msg_size, uint32_t chunk_size)
+    {
+        return (msg_size / chunk_size + 1) * 18;
+    }
+
+    // SelectFormat: 根据csid上一条消息的头部为in_msg选择最小的fmt，delta输出时间增量
+    // 时间戳回退、流ID变化或需要扩展时间戳时使用fmt0
+    static uint8_t SelectFormat(const RtmpChunkHeader& prev, const RtmpMessage& in_msg, uint32_t& delta);
+
+    // UpdateHeader: 以fmt发送in_msg后更新csid的头部状态
+    static void UpdateHeader(RtmpChunkHeader& prev, const RtmpMessage& in_msg, uint8_t fmt, uint32_t delta);
+
+    // 获取发送端csid的头部状态
+    RtmpChunkHeader& GetOutHeader(uint32_t csid)
+    {
+        return csid < kMaxFastCsid ? out_header_[csid] : overflow_out_header_[csid];
+    }
+
+    // 记录一次压缩头部节省的字节数（fmt0消息头11字节与实际头部之差）
+    void AddHeaderBytesSaved(uint8_t fmt)
+    {
+        header_bytes_saved_.store(header_bytes_saved_.load(std::memory_order_relaxed)
+                                  + KChunkMessageHeaderLenght[0] - KChunkMessageHeaderLenght[fmt],
+                                  std::memory_order_relaxed);
+    }
+    // 累计节省的头部字节数（可跨线程读取）
+    uint64_t GetHeaderBytesSaved() const
+    {
+        return header_bytes_saved_.load(std::memory_order_relaxed);
+    }
+
+    // 计算按chunk_size拆分msg_size字节消息所需的最大缓冲区大小
+    static uint32_t GetChunkCapacity(uint32_t msg_size, uint32_t chunk_size)
+    {
+        return msg_size + (msg_size / chunk_size + 1) * 7 + 16;
+    }
+
     // 设置接收端chunk大小
     void SetInChunkSize(uint32_t in_chunk_size)
     {
@@ -45,13 +115,14 @@ public:
     {
         out_chunk_size_ = out_chunk_size;
     }
-
-    // 清除内部缓存的未完成消息
-    void Clear()
+    uint32_t GetOutChunkSize() const
     {
-        rtmp_message_.clear();
+        return out_chunk_size_;
     }
 
+    // 清除内部缓存的未完成消息；发送端头部状态与对端的接收状态对应，连接内保持不变
+    void Clear();
+
     // 获取当前活动的chunk stream id
     int GetStreamId() const
     {
@@ -63,17 +134,34 @@ protected:
     int ParseChunkHeader(BufferReader& buffer);
     // 解析chunk的数据体，将payload拼装到对应RtmpMessage
     int ParseChunkBody(BufferReader& buffer);
+    // 新消息整条位于buffer中且无需长期持有时，直接引用buffer输出，返回是否输出
+    bool ParseInPlace(BufferReader& buffer, RtmpMessage& out_rtmp_msg);
+    // 将已拼装完成的消息交给out_rtmp_msg，payload所有权一并转移
+    void CompleteMessage(RtmpMessage& out_rtmp_msg);
+    // 按csid获取消息状态，csid<64使用固定数组
+    RtmpMessage& GetMessage(uint32_t csid)
+    {
+        return csid < kMaxFastCsid ? rtmp_message_[csid] : overflow_message_[csid];
+    }
     // 构建Basic Header字段，fmt和csid映射到一到三字节
-    int CreateBasicHeader(uint8_t fmt, uint32_t csid, char* buf);
+    static int CreateBasicHeader(uint8_t fmt, uint32_t csid, char* buf);
     // 构建Message Header，根据fmt写入时间戳、长度、类型和stream id
-    int CreateMessageHeader(uint8_t fmt, RtmpMessage& rtmp_msg, char* buf);
+    static int CreateMessageHeader(uint8_t fmt, const RtmpMessage& rtmp_msg, char* buf);
 
 private:
+    static const uint32_t kMaxFastCsid = 64; // 单字节Basic Header可表示的csid上限
+
     State state_;                      // 当前解析状态
-    int chunk_stream_id_ = -1;         // 当前解析的chunk stream id
+    RtmpMessage* current_ = nullptr;   // 当前chunk所属的消息
+    uint32_t chunk_remaining_ = 0;     // 当前chunk还未读取的payload字节数
     static int stream_id_;             // 静态自增，用于分配唯一chunk stream id
     uint32_t in_chunk_size_ = 128;     // 最大接收chunk大小（字节）
     uint32_t out_chunk_size_ = 128;    // 发送chunk大小
-    std::map<int, RtmpMessage> rtmp_message_;  // 按csid存储未完成消息
+    RtmpMessage rtmp_message_[kMaxFastCsid];   // csid<64的未完成消息
+    std::unordered_map<uint32_t, RtmpMessage> overflow_message_; // csid>=64的未完成消息
+    RtmpChunkHeader out_header_[kMaxFastCsid];                   // 发送端csid<64的头部状态
+    std::unordered_map<uint32_t, RtmpChunkHeader> overflow_out_header_; // 发送端csid>=64的头部状态
+    std::atomic<uint64_t> header_bytes_saved_{0};                // 压缩头部累计节省的字节数，只由发送方写入
+    BufferPool buffer_pool_;           // 音视频消息的payload缓冲区池
     const int KChunkMessageHeaderLenght[4] = {11,7,3,0}; // 不同fmt下message header长度
 };
\ No newline at end of file
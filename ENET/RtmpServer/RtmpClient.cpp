@@ -0,0 +1,442 @@
+/**
+ * @file RtmpClient.cpp
+ * @brief 实现 RtmpClient：非阻塞连接、客户端握手、connect/createStream 命令与超时检查。
+ */
+#include "RtmpClient.h"
+#include "rtmp.h"
+#include <chrono>
+#include <cstring>
+
+/** 定时检查周期（毫秒） */
+static const uint32_t kCheckIntervalMs = 500;
+/** 从发起连接到对端接受 play/publish 的最长时间（毫秒） */
+static const int64_t kStartTimeoutMs = 5000;
+/** 命令的事务 ID，用于匹配 _result */
+static const double kConnectTransaction = 1;
+static const double kCreateStreamTransaction = 2;
+
+/**
+ * @brief 单调时钟的当前时间（毫秒）
+ */
+int64_t RtmpClient::GetNowMs()
+{
+    return std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+/**
+ * @brief 流路径是否为 "/app/stream" 格式
+ */
+bool RtmpClient::IsValidStreamPath(const std::string& stream_path)
+{
+    size_t pos = stream_path.find('/', 1);
+    return !stream_path.empty() && stream_path[0] == '/' && pos != std::string::npos && pos + 1 < stream_path.size();
+}
+
+/**
+ * @brief 创建 socket 并发起非阻塞连接
+ *
+ * 连接完成前写入的数据在 socket 可写后由写事件发出
+ */
+int RtmpClient::Connect(const std::string& ip, uint16_t port)
+{
+    return SocketUtil::Connect(ip, port);
+}
+
+/**
+ * @brief 构造函数，解析 app 与流名称并设置网络回调
+ */
+RtmpClient::RtmpClient(TaskScheduler* scheduler, int socket, const std::string& ip, uint16_t port,
+                       const std::string& stream_path, uint32_t out_chunk_size)
+    :TcpConnection(scheduler, socket)
+    ,ip_(ip)
+    ,port_(port)
+    ,stream_path_(stream_path)
+    ,out_chunk_size_(out_chunk_size)
+    ,handshake_(new RtmpHandshake(RtmpHandshake::HANDSHAKE_S0S1S2))
+    ,rtmp_chunk_(new RtmpChunk())
+{
+    rtmp_chunk_->SetOutChunkSize(out_chunk_size_);
+    size_t pos = stream_path_.find('/', 1);
+    app_ = stream_path_.substr(1, pos - 1);
+    stream_name_ = stream_path_.substr(pos + 1);
+
+    this->SetReadCallback([this](std::shared_ptr<TcpConnection> conn, BufferReader& buffer){
+        return this->OnRead(buffer);
+    });
+    this->SetCloseCallback([this](std::shared_ptr<TcpConnection> conn){
+        this->OnClose();
+    });
+}
+
+/**
+ * @brief 析构函数
+ */
+RtmpClient::~RtmpClient()
+{
+}
+
+/**
+ * @brief 发送 C0C1 并启动定时检查
+ */
+void RtmpClient::Start()
+{
+    start_time_ = GetNowMs();
+
+    char c0c1[1537];
+    int size = handshake_->BuildC0C1(c0c1, sizeof(c0c1));
+    if(size > 0)
+    {
+        this->Send(c0c1, size);
+    }
+
+    std::weak_ptr<TcpConnection> weak_conn = shared_from_this();
+    GetTaskSchduler()->AddTimer([weak_conn](){
+        auto conn = weak_conn.lock();
+        if(!conn || conn->IsClosed())
+        {
+            return false;
+        }
+        RtmpClient* client = static_cast<RtmpClient*>(conn.get());
+        if(client->IsExpired(GetNowMs()))
+        {
+            client->DisConnect();
+            return false;
+        }
+        return true;
+    }, kCheckIntervalMs);
+}
+
+/**
+ * @brief 主动断开，关闭在所属调度线程执行
+ */
+void RtmpClient::Stop()
+{
+    auto conn = shared_from_this();
+    GetTaskSchduler()->AddReadyTask([conn](){
+        conn->DisConnect();
+    });
+}
+
+/**
+ * @brief 默认超时检查：对端未在限定时间内接受 play/publish
+ */
+bool RtmpClient::IsExpired(int64_t now)
+{
+    return !has_started_ && now - start_time_ >= kStartTimeoutMs;
+}
+
+/**
+ * @brief 标记对端已开始
+ */
+void RtmpClient::SetStarted()
+{
+    state_ = STARTED;
+    has_started_ = true;
+}
+
+/**
+ * @brief 数据到达回调：握手完成后立即发送 SetChunkSize 与 connect，剩余数据按 Chunk 解析
+ */
+bool RtmpClient::OnRead(BufferReader& buffer)
+{
+    if(handshake_->IsCompleted())
+    {
+        return HandleChunk(buffer);
+    }
+
+    char res[4096];
+    int res_size = handshake_->Parse(buffer, res, sizeof(res));
+    if(res_size < 0)
+    {
+        return false;
+    }
+    if(res_size > 0)
+    {
+        this->Send(res, res_size);                    // C2
+    }
+    if(handshake_->IsCompleted())
+    {
+        SendChunkSize();
+        SendConnect();
+        if(buffer.ReadableBytes() > 0)
+        {
+            return HandleChunk(buffer);
+        }
+    }
+    return true;
+}
+
+/**
+ * @brief 解析 Chunk，直到缓冲区耗尽或数据不足
+ */
+bool RtmpClient::HandleChunk(BufferReader& buffer)
+{
+    int ret = -1;
+    do
+    {
+        RtmpMessage rtmp_msg;
+        ret = rtmp_chunk_->Parse(buffer, rtmp_msg);
+        if(ret < 0)
+        {
+            return false;
+        }
+        bytes_received_ += ret;
+        if(rtmp_msg.IsCompleted() && !HandleMessage(rtmp_msg))
+        {
+            return false;
+        }
+    } while(buffer.ReadableBytes() > 0 && ret > 0);
+
+    SendAcknowledgement();
+    return true;
+}
+
+/**
+ * @brief 按消息类型分发
+ */
+bool RtmpClient::HandleMessage(RtmpMessage& rtmp_msg)
+{
+    switch(rtmp_msg.type_id)
+    {
+    case RTMP_VIDEO:
+    case RTMP_AUDIO:
+        return HandleMedia(rtmp_msg);
+    case RTMP_AGGREGATE:
+        return HandleAggregate(rtmp_msg);
+    case RTMP_INVOKE:
+        return HandleInvoke(rtmp_msg);
+    case RTMP_NOTIFY:
+        return HandleNotify(rtmp_msg);
+    case RTMP_SET_CHUNK_SIZE:
+        rtmp_chunk_->SetInChunkSize(ReadUint32BE(rtmp_msg.playload.get()));
+        break;
+    case RTMP_ACK_SIZE:
+        ack_window_ = ReadUint32BE(rtmp_msg.playload.get());
+        break;
+    default:
+        break;
+    }
+    return true;
+}
+
+/**
+ * @brief 拆分聚合消息：每个子消息是一个 FLV tag，逐个作为音视频消息交给 HandleMedia
+ *
+ * 子消息共享聚合消息的缓冲区，时间戳按与第一个子消息的差值加到聚合消息的时间戳上
+ */
+bool RtmpClient::HandleAggregate(RtmpMessage& rtmp_msg)
+{
+    char* data = rtmp_msg.playload.get();
+    uint32_t pos = 0;
+    uint32_t first_timestamp = 0;
+    while(pos + 11 <= rtmp_msg.lenght)
+    {
+        char* tag = data + pos;
+        uint32_t size = ReadUint24BE(tag + 1);
+        if(pos + 11 + size > rtmp_msg.lenght)
+        {
+            break;
+        }
+        uint32_t timestamp = ReadUint24BE(tag + 4) | ((uint32_t)(uint8_t)tag[7] << 24);
+        if(pos == 0)
+        {
+            first_timestamp = timestamp;
+        }
+
+        RtmpMessage sub_msg;
+        sub_msg.type_id = (uint8_t)tag[0];
+        sub_msg.stream_id = rtmp_msg.stream_id;
+        sub_msg.csid = rtmp_msg.csid;
+        sub_msg.lenght = size;
+        sub_msg.index = size;
+        sub_msg._timestamp = rtmp_msg._timestamp + (timestamp - first_timestamp);
+        sub_msg.playload = std::shared_ptr<char>(rtmp_msg.playload, tag + 11);
+        if((sub_msg.type_id == RTMP_VIDEO || sub_msg.type_id == RTMP_AUDIO) && !HandleMedia(sub_msg))
+        {
+            return false;
+        }
+        pos += 11 + size + 4;                             // 跳过 PreviousTagSize
+    }
+    return true;
+}
+
+/**
+ * @brief 处理对端的命令应答：_result 推进 connect -> createStream -> play/publish，onStatus 交给子类
+ */
+bool RtmpClient::HandleInvoke(RtmpMessage& rtmp_msg)
+{
+    AmfReader reader(rtmp_msg.playload.get(), rtmp_msg.lenght);
+    AmfStringView method;
+    double transaction_id = 0;
+    if(!reader.readString(method))
+    {
+        return true;
+    }
+    reader.readNumber(transaction_id);
+
+    if(method == "_result")
+    {
+        if(state_ == START_CONNECT && transaction_id == kConnectTransaction)
+        {
+            SendCreateStream();
+        }
+        else if(state_ == START_CREATE_STREAM && transaction_id == kCreateStreamTransaction)
+        {
+            double stream_id = 0;
+            reader.skip();                                    // 命令对象之后的数字即流 ID
+            reader.readNumber(stream_id);
+            stream_id_ = (uint32_t)stream_id;
+            state_ = START_STREAM;
+            SendStreamCommand();
+        }
+    }
+    else if(method == "_error")
+    {
+        printf("[RtmpClient] %s%s rejected\n", GetRemote().c_str(), stream_path_.c_str());
+        return false;
+    }
+    else if(method == "onStatus")
+    {
+        // 事务 ID 之后为命令对象（null）和状态信息对象，部分服务端省略 null，取第一个非空对象
+        AmfReader info;
+        AmfStringView level, code;
+        while(reader.readObject(info) && info.remaining() == 0)
+        {
+        }
+        info.findString("level", level);
+        info.findString("code", code);
+        return OnStatus(level.toString(), code.toString());
+    }
+    return true;
+}
+
+/**
+ * @brief 发送 chunk 大小不是默认 128 时通知对端
+ */
+void RtmpClient::SendChunkSize()
+{
+    if(out_chunk_size_ == 128)
+    {
+        return;
+    }
+    std::shared_ptr<char> data(new char[4], std::default_delete<char[]>());
+    WriteUint32BE(data.get(), out_chunk_size_);
+    RtmpMessage rtmp_msg;
+    rtmp_msg.type_id = RTMP_SET_CHUNK_SIZE;
+    rtmp_msg.playload = data;
+    rtmp_msg.lenght = 4;
+    // SetChunkSize 本身按默认的 128 分片，4 字节负载只有一个 chunk
+    SendRtmpChunks(RTMP_CHUNK_CONTROL_ID, rtmp_msg);
+}
+
+/**
+ * @brief 发送 connect 命令
+ */
+void RtmpClient::SendConnect()
+{
+    AmfObjects objects;
+    amf_encoder_.reset();
+    amf_encoder_.encodeString("connect", 7);
+    amf_encoder_.encodeNumber(kConnectTransaction);
+    objects["app"] = AmfObject(app_);
+    objects["type"] = AmfObject(std::string("nonprivate"));
+    objects["flashVer"] = AmfObject(std::string("FMLE/3.0 (compatible; RtmpSvr)"));
+    objects["tcUrl"] = AmfObject("rtmp://" + GetRemote() + "/" + app_);
+    objects["capabilities"] = AmfObject(15.0);
+    objects["audioCodecs"] = AmfObject(3575.0);
+    objects["videoCodecs"] = AmfObject(252.0);
+    objects["videoFunction"] = AmfObject(1.0);
+    objects["objectEncoding"] = AmfObject(0.0);
+    amf_encoder_.encodeObjects(objects);
+    SendInvokeMessage(0, amf_encoder_.data(), amf_encoder_.size());
+    state_ = START_CONNECT;
+}
+
+/**
+ * @brief 发送 createStream 命令
+ */
+void RtmpClient::SendCreateStream()
+{
+    AmfObjects objects;
+    amf_encoder_.reset();
+    amf_encoder_.encodeString("createStream", 12);
+    amf_encoder_.encodeNumber(kCreateStreamTransaction);
+    amf_encoder_.encodeObjects(objects);
+    SendInvokeMessage(0, amf_encoder_.data(), amf_encoder_.size());
+    state_ = START_CREATE_STREAM;
+}
+
+/**
+ * @brief 已接收字节数超过对端确认窗口时发送 Acknowledgement，序号为已接收字节数的低 32 位
+ */
+void RtmpClient::SendAcknowledgement()
+{
+    if(ack_window_ == 0 || bytes_received_ - last_ack_bytes_ < ack_window_)
+    {
+        return;
+    }
+    last_ack_bytes_ = bytes_received_;
+
+    std::shared_ptr<char> data(new char[4], std::default_delete<char[]>());
+    WriteUint32BE(data.get(), (uint32_t)bytes_received_);
+    RtmpMessage rtmp_msg;
+    rtmp_msg.type_id = RTMP_ACK;
+    rtmp_msg.playload = data;
+    rtmp_msg.lenght = 4;
+    SendRtmpChunks(RTMP_CHUNK_CONTROL_ID, rtmp_msg);
+}
+
+/**
+ * @brief 发送 invoke 命令
+ */
+void RtmpClient::SendInvokeMessage(uint32_t stream_id, std::shared_ptr<char> payload, uint32_t payload_size)
+{
+    RtmpMessage rtmp_msg;
+    rtmp_msg.type_id = RTMP_INVOKE;
+    rtmp_msg.timestamp = 0;
+    rtmp_msg.stream_id = stream_id;
+    rtmp_msg.playload = payload;
+    rtmp_msg.lenght = payload_size;
+    SendRtmpChunks(RTMP_CHUNK_INVOKE_ID, rtmp_msg);
+}
+
+/**
+ * @brief 将消息分片后直接入队发送
+ *
+ * SetChunkSize 之前只发送不超过 128 字节的控制消息，之后的消息都按 out_chunk_size_ 分片；
+ * 头部按 csid 的发送状态压缩，在发送锁内分片，保证与入队顺序一致
+ */
+void RtmpClient::SendRtmpChunks(uint32_t csid, RtmpMessage& rtmp_msg)
+{
+    this->SendInOrder([&](uint32_t& size) -> std::shared_ptr<char> {
+        uint32_t capacity = RtmpChunk::GetChunkCapacity(rtmp_msg.lenght, out_chunk_size_);
+        std::shared_ptr<char> buffer(new char[capacity], std::default_delete<char[]>());
+        int ret = rtmp_chunk_->CreateChunk(csid, rtmp_msg, buffer.get(), capacity);
+        if(ret <= 0)
+        {
+            return nullptr;
+        }
+        size = ret;
+        return buffer;
+    });
+}
+
+/**
+ * @brief 发送会话共享的媒体消息，与其他同组连接共享分片结果
+ */
+void RtmpClient::SendPacketChunks(RtmpMediaPacket::Ptr packet)
+{
+    this->SendInOrder([&](uint32_t& chunks_size) {
+        return packet->GetChunks(*rtmp_chunk_, stream_id_, chunks_size);
+    });
+}
+
+/**
+ * @brief 累计节省的 chunk 头部字节数
+ */
+uint64_t RtmpClient::GetHeaderBytesSaved() const
+{
+    return rtmp_chunk_->GetHeaderBytesSaved();
+}
+
@@ -0,0 +1,190 @@
+/**
+ * @file RtmpClient.h
+ * @brief 服务端发起的出站 RTMP 连接的公共部分：非阻塞连接、客户端握手与 connect/createStream 命令。
+ *
+ * 边缘回源（RtmpPuller，play）与推流转发（RtmpPusher，publish）在此基础上实现：
+ *  - 握手完成后发送 SetChunkSize（如需要）与 connect，收到 _result 后发送 createStream
+ *  - createStream 返回流 ID 后由子类发送 play 或 publish，onStatus 交给子类判断
+ *  - 定时检查握手/命令超时，子类可追加断流、空闲等条件
+ */
+
+#ifndef _RTMPCLIENT_H_
+#define _RTMPCLIENT_H_
+
+#include "../EdoyunNet/TcpConnection.h"
+#include "amf.h"
+#include "RtmpChunk.h"
+#include "RtmpHandshake.h"
+#include "RtmpMediaPacket.h"
+#include <atomic>
+#include <string>
+
+/**
+ * @class RtmpClient
+ * @brief 出站 RTMP 连接基类；IO、命令与定时检查都在所属调度线程执行
+ */
+class RtmpClient : public TcpConnection
+{
+public:
+    /**
+     * @brief 析构函数
+     */
+    virtual ~RtmpClient();
+
+    /**
+     * @brief 主动断开（可跨线程调用），关闭在所属调度线程执行
+     */
+    void Stop();
+
+    /**
+     * @brief 对端是否已接受 play/publish；未开始就断开说明对端不可用
+     */
+    bool HasStarted() const { return has_started_; }
+
+    std::string GetStreamPath() const { return stream_path_; }
+    std::string GetRemote() const { return ip_ + ":" + std::to_string(port_); }   ///< 对端地址 "ip:port"
+
+protected:
+    /** 连接阶段 */
+    enum State
+    {
+        HANDSHAKE,           ///< 等待 S0S1S2
+        START_CONNECT,       ///< 已发送 connect
+        START_CREATE_STREAM, ///< 已发送 createStream
+        START_STREAM,        ///< 已发送 play/publish，等待 onStatus
+        STARTED,             ///< 对端已开始下发或接收
+    };
+
+    /**
+     * @brief 构造函数
+     * @param scheduler 处理该连接 IO 的调度器
+     * @param socket 已发起非阻塞连接的 socket
+     * @param ip 对端 IPv4 地址
+     * @param port 对端端口
+     * @param stream_path 流路径，格式 "/app/stream"
+     * @param out_chunk_size 发送 chunk 大小，不是 128 时握手后先发送 SetChunkSize
+     */
+    RtmpClient(TaskScheduler* scheduler, int socket, const std::string& ip, uint16_t port,
+               const std::string& stream_path, uint32_t out_chunk_size);
+
+    /**
+     * @brief 创建 socket 并发起非阻塞连接
+     * @return socket，参数无效或连接立即失败时为 -1
+     */
+    static int Connect(const std::string& ip, uint16_t port);
+
+    /**
+     * @brief 流路径是否为 "/app/stream" 格式
+     */
+    static bool IsValidStreamPath(const std::string& stream_path);
+
+    /**
+     * @brief 单调时钟的当前时间（毫秒）
+     */
+    static int64_t GetNowMs();
+
+    /**
+     * @brief 发送 C0C1 并启动定时检查，须在对象由 shared_ptr 管理后调用
+     */
+    void Start();
+
+    /**
+     * @brief createStream 成功后发送 play 或 publish
+     */
+    virtual void SendStreamCommand() = 0;
+
+    /**
+     * @brief 处理 play/publish 的 onStatus，开始成功时调用 SetStarted
+     * @return false 表示断开
+     */
+    virtual bool OnStatus(const std::string& level, const std::string& code) = 0;
+
+    /**
+     * @brief 处理音视频消息
+     * @return false 表示断开
+     */
+    virtual bool HandleMedia(RtmpMessage& rtmp_msg) { return true; }
+
+    /**
+     * @brief 处理数据消息（元数据等）
+     * @return false 表示断开
+     */
+    virtual bool HandleNotify(RtmpMessage& rtmp_msg) { return true; }
+
+    /**
+     * @brief 定时检查是否需要断开，默认只检查开始超时
+     * @param now 当前时间（毫秒）
+     * @return true 表示断开
+     */
+    virtual bool IsExpired(int64_t now);
+
+    /**
+     * @brief 连接关闭回调，在所属调度线程调用
+     */
+    virtual void OnClose() {}
+
+    /**
+     * @brief 标记对端已开始，之后不再检查开始超时
+     */
+    void SetStarted();
+
+    /**
+     * @brief 在指定消息流上发送 invoke 命令
+     * @param stream_id 消息流 ID，connect/createStream 为 0
+     */
+    void SendInvokeMessage(uint32_t stream_id, std::shared_ptr<char> payload, uint32_t payload_size);
+
+    /**
+     * @brief 按 out_chunk_size_ 分片后入队发送，头部按发送状态压缩，可在其他线程调用
+     */
+    void SendRtmpChunks(uint32_t csid, RtmpMessage& rtmp_msg);
+
+    /**
+     * @brief 发送会话共享的媒体消息，头部按发送状态压缩，可在其他线程调用
+     */
+    void SendPacketChunks(RtmpMediaPacket::Ptr packet);
+
+    /**
+     * @brief 获取 chunk 头部压缩累计节省的字节数（可跨线程调用）
+     */
+    uint64_t GetHeaderBytesSaved() const;
+
+    AmfEncoder amf_encoder_;                     ///< 命令编码，只在所属线程使用
+    std::atomic<int> state_{HANDSHAKE};          ///< 连接阶段
+    uint32_t stream_id_ = 0;                     ///< createStream 返回的消息流 ID
+    const std::string ip_;                       ///< 对端地址
+    const uint16_t port_;                        ///< 对端端口
+    const std::string stream_path_;              ///< 流路径
+    std::string app_;                            ///< 应用名
+    std::string stream_name_;                    ///< 流名称
+    const uint32_t out_chunk_size_;              ///< 发送 chunk 大小
+    int64_t start_time_ = 0;                     ///< 发起连接的时间（毫秒）
+
+    /**
+     * @brief 读回调：依握手阶段处理握手或 chunk，派生类可覆盖以观察到达的字节
+     * @return false 表示断开
+     */
+    virtual bool OnRead(BufferReader& buffer);
+
+private:
+    bool HandleChunk(BufferReader& buffer);
+    bool HandleMessage(RtmpMessage& rtmp_msg);
+    bool HandleInvoke(RtmpMessage& rtmp_msg);
+    bool HandleAggregate(RtmpMessage& rtmp_msg);
+    void SendConnect();
+    void SendCreateStream();
+    void SendChunkSize();
+    /**
+     * @brief 已接收字节数超过对端确认窗口时发送 Acknowledgement
+     */
+    void SendAcknowledgement();
+
+    std::unique_ptr<RtmpHandshake> handshake_;   ///< 客户端握手状态
+    std::unique_ptr<RtmpChunk> rtmp_chunk_;      ///< Chunk 解析，以及发送端的头部状态
+    std::atomic_bool has_started_{false};        ///< 是否收到过开始的 onStatus
+    uint64_t bytes_received_ = 0;                ///< 已解析的字节数，用于确认窗口
+    uint64_t last_ack_bytes_ = 0;                ///< 上次确认时的字节数
+    uint32_t ack_window_ = 0;                    ///< 对端设置的确认窗口
+};
+
+#endif // _RTMPCLIENT_H_
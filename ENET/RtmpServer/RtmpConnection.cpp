@@ -9,8 +9,19 @@
  * - 音视频帧的序列头缓存与分发
  */
 #include "RtmpConnection.h"
+#include "RenditionSwitcher.h"
+#include "FlvVodFile.h"
+#include "VodPlayer.h"
+#include "TimeShiftPlayer.h"
 #include "rtmp.h"
 #include "RtmpServer.h"
+#include <algorithm>
+#include <cstdlib>
+
+/** 点播时一条聚合消息的最大负载（字节） */
+static const uint32_t kMaxVodAggregateBytes = 64 * 1024;
+/** out chunk size 不小于该值时点播负载以映射切片入队；更小时切片过碎，改为拷贝分片 */
+static const uint32_t kMinVodSliceChunkSize = 4096;
 
 /**
  * @brief 构造函数（服务端接口），设置握手状态并保存服务器引用
@@ -20,6 +31,8 @@ RtmpConnection::RtmpConnection(std::shared_ptr<RtmpServer> rtmp_server, TaskSche
 {
     handshake_.reset(new RtmpHandshake(RtmpHandshake::HANDSHAKE_C0C1));  // 初始化握手状态
     rtmp_server_ = rtmp_server;                                         // 保存服务端实例
+    read_budget_bytes_ = rtmp_server->read_budget_bytes_;               // 每轮解析预算
+    read_budget_messages_ = rtmp_server->read_budget_messages_;
 }
 
 /**
@@ -101,27 +114,49 @@ void RtmpConnection::OnClose()
 }
 
 /**
- * @brief 解析并组装接收到的 Chunk 数据，直到缓冲区耗尽或发生错误
+ * @brief 解析并组装接收到的 Chunk 数据，直到缓冲区耗尽、发生错误或用完本轮预算
+ *
+ * 每轮最多解析 read_budget_bytes_ 字节、处理 read_budget_messages_ 条消息，
+ * 剩余数据留在读缓冲区，由调度器就绪列表在下一轮继续处理，避免积压的推流端饿死同线程的观看者
  * @param buffer 输入缓冲区
  * @return true 解析及处理成功，false 表示发生错误需断开
  */
 bool RtmpConnection::HandleChunk(BufferReader &buffer)
 {
     int ret = -1;
-    // 循环读取并解析 Chunk，直到缓冲区空或发生错误
+    uint32_t bytes_parsed = 0;
+    uint32_t messages = 0;
+    // 循环解析，每次 Parse 连续处理多个 Chunk 并最多输出一条完整消息
     do
     {
         RtmpMessage rtmp_msg;
         ret = rtmp_chunk_->Parse(buffer, rtmp_msg);// 解析 Chunk 数据
         if (ret < 0)
+        {
+            CountError(true);
             return false;               // Chunk 解析错误，需断开
+        }
+        bytes_parsed += ret;
         if (ret >= 0 && rtmp_msg.IsCompleted())
         {
             // 完整消息到达，进入上层业务处理
             if (!HandleMessage(rtmp_msg))
+            {
+                CountError(false);
                 return false;           // 消息处理失败，断开
+            }
+            messages++;
+        }
+        // 本轮预算用完，剩余数据交给下一轮事件循环
+        if (ret > 0 && buffer.ReadableBytes() > 0
+            && (bytes_parsed >= read_budget_bytes_ || messages >= read_budget_messages_))
+        {
+            this->ScheduleReadContinuation();
+            break;
         }
     } while (buffer.ReadableBytes() > 0 && ret > 0);
+
+    SendBytesReceived();
     return true;
 }
 
@@ -150,6 +185,31 @@ bool RtmpConnection::HandleMessage(RtmpMessage &rtmp_msg)
     case RTMP_SET_CHUNK_SIZE:
         rtmp_chunk_->SetInChunkSize(ReadUint32BE(rtmp_msg.playload.get()));
         break;
+    case RTMP_ACK_SIZE:
+        if (rtmp_msg.lenght >= 4)
+        {
+            peer_ack_window_ = ReadUint32BE(rtmp_msg.playload.get());// 对端要求的确认窗口
+        }
+        break;
+    case RTMP_ACK:
+        if (rtmp_msg.lenght >= 4)
+        {
+            acked_sequence_.store(ReadUint32BE(rtmp_msg.playload.get()), std::memory_order_relaxed);
+            ack_received_ = true;
+            if (use_media_queue_)
+            {
+                DrainMediaQueue();      // 未确认字节减少，继续从媒体队列补充
+            }
+            if (vod_player_)
+            {
+                vod_player_->Pump();    // 点播同样受未确认字节限制
+            }
+            if (time_shift_player_)
+            {
+                time_shift_player_->Pump();
+            }
+        }
+        break;
     default:
         break;
     }
@@ -158,41 +218,79 @@ bool RtmpConnection::HandleMessage(RtmpMessage &rtmp_msg)
 
 bool RtmpConnection::HandleInvoke(RtmpMessage &rtmp_msg)
 {
-    // 重置 AMF 解码器以解析新消息
-    amf_decoder_.reset();
-    // 首先解析方法名（第一个 AMF0 字符串）
-    int bytes_used = amf_decoder_.decode(rtmp_msg.playload.get(), rtmp_msg.lenght, 1);
-    if (bytes_used < 0)
+    // 命令在消息负载上直接读取，方法名与流名称不构造中间对象
+    AmfReader reader(rtmp_msg.playload.get(), rtmp_msg.lenght);
+    // 首先解析方法名（第一个 AMF0 字符串）和事务 ID
+    AmfStringView method;
+    if (!reader.readString(method))
     {
         printf("AMF 解码失败\n");
         return false;
     }
-    std::string method = amf_decoder_.getString();
+    transaction_id_ = 0;
+    reader.readNumber(transaction_id_);
     // 根据 stream_id 判断是 connect/createStream（stream_id=0）还是 publish/play/DeleteStream
     if (rtmp_msg.stream_id == 0)
     {
-        // 解析剩余参数，处理连接或创建流
-        bytes_used += amf_decoder_.decode(rtmp_msg.playload.get() + bytes_used, rtmp_msg.lenght - bytes_used);
         if (method == "connect")
-            return HandleConnect();// 处理 connect 命令，建立连接
+        {
+            // 命令对象，包含 app 等连接参数
+            AmfReader command;
+            if (!reader.readObject(command))
+                return false;
+            return HandleConnect(command);// 处理 connect 命令，建立连接
+        }
         if (method == "createStream")
             return HandleCreateStream(); // 处理 createStream 命令，创建流
     }
     else if (rtmp_msg.stream_id == stream_id_)// 如果是已分配的 stream_id
     {
-        // 对于已分配的 stream_id，继续解析参数（通常包含流名称）,这里解析3是因为第一个参数是方法名
-        // 解析方法名后，继续解析剩余参数
-        bytes_used += amf_decoder_.decode(rtmp_msg.playload.get() + bytes_used, rtmp_msg.lenght - bytes_used, 3);
-        stream_name_ = amf_decoder_.getString();
-        stream_path_ = "/" + app_ + "/" + stream_name_;
-        // 如果还有剩余参数，继续解析
-        if (rtmp_msg.lenght > bytes_used)
-            bytes_used += amf_decoder_.decode(rtmp_msg.playload.get() + bytes_used, rtmp_msg.lenght - bytes_used);
+        // 事务 ID 之后依次为命令对象（通常为 null）和流名称；seek/pause 没有流名称，读取失败时位置不变
+        AmfStringView stream_name;
+        if (reader.skip() && reader.readString(stream_name))
+        {
+            stream_name_.assign(stream_name.data, stream_name.size);
+            stream_path_ = "/" + app_ + "/" + stream_name_;
+        }
         // 分发到对应业务处理
         if (method == "publish")
             return HandlePublish();
         if (method == "play")
+        {
+            // 可选的起始位置（秒），点播时从不晚于该位置的关键帧开始，直播忽略
+            double start = -2;
+            reader.readNumber(start);
+            vod_start_ms_ = start > 0 ? (uint32_t)(start * 1000) : 0;
+            // 流名称可带 "?delay=秒"，开启时移的流从落后直播该时长的关键帧开始；查询参数不属于流路径
+            time_shift_delay_ms_ = 0;
+            size_t query = stream_name_.find('?');
+            if (query != std::string::npos)
+            {
+                size_t delay = stream_name_.find("delay=", query);
+                if (delay != std::string::npos && (stream_name_[delay - 1] == '?' || stream_name_[delay - 1] == '&'))
+                {
+                    double seconds = atof(stream_name_.c_str() + delay + 6);
+                    time_shift_delay_ms_ = seconds > 0 ? (uint32_t)(seconds * 1000) : 0;
+                }
+                stream_name_.resize(query);
+                stream_path_ = "/" + app_ + "/" + stream_name_;
+            }
             return HandlePlay();
+        }
+        if (method == "seek")
+        {
+            double position = 0;
+            reader.readNumber(position);
+            return HandleSeek(position);
+        }
+        if (method == "pause")
+        {
+            bool pause = true;
+            double position = 0;
+            reader.readBoolean(pause);
+            reader.readNumber(position);
+            return HandlePause(pause, position);
+        }
         if (method == "DeleteStream")
             return HandleDeleteStream();
     }
@@ -200,64 +298,38 @@ bool RtmpConnection::HandleInvoke(RtmpMessage &rtmp_msg)
 }
 
 /**
- * @brief 处理通知消息，解析元数据并发送给对应的 RtmpSession
+ * @brief 处理通知消息，取出元数据并发送给对应的 RtmpSession
+ *
+ * 只读取消息名，元数据在会话内只封装一次，之后所有观看者共享同一份字节
  * @param rtmp_msg 完整的 RTMP 消息
  * @return true 处理成功，false 表示处理失败需断开连接
  */
 bool RtmpConnection::HandleNotify(RtmpMessage &rtmp_msg)
 {
-    //准备解码器
-    amf_decoder_.reset();
-
-    //解析消息名称
-    int bytes_used = amf_decoder_.decode(rtmp_msg.playload.get(),rtmp_msg.lenght,1);
-
-    std::string method = amf_decoder_.getString();
-    if(method == "@setDataFrame")// 如果是元数据通知
+    RtmpMediaPacket::Ptr meta_data = RtmpMediaPacket::CreateMetaData(rtmp_msg.playload, rtmp_msg.lenght);
+    if(!meta_data)
     {
-        amf_decoder_.reset();
-        //继续解析剩余的参数
-        bytes_used = amf_decoder_.decode(rtmp_msg.playload.get() + bytes_used,rtmp_msg.lenght - bytes_used,1);
-        if(bytes_used < 0)
-        {
-            return false;
-        }
-        //是不是元数据
-        if(amf_decoder_.getString() == "onMetaData")// 如果是元数据
-        {
-            //解析剩余的元数据
-            bytes_used += amf_decoder_.decode(rtmp_msg.playload.get() + bytes_used,rtmp_msg.lenght - bytes_used);
-        }
-        else
-        {
-            //不是元数据，直接返回
-            return true;
-        }
-        {
-            // 解析元数据对象
-            amf_decoder_.decode(rtmp_msg.playload.get() + bytes_used,rtmp_msg.lenght - bytes_used);
-            meta_data_ = amf_decoder_.getObjects();// 获取元数据对象
-        }
-
-        //设置元数据
-        //TODO 获取session设置元数据
-        auto server = rtmp_server_.lock();
-        if(!server)
-        {
-            return false;
-        }
+        //不是元数据，直接返回
+        return true;
+    }
 
-        auto session = rtmp_session_.lock();
-        if(session)
-        {
-            session->SendMetaData(meta_data_);
-        }
+    auto session = rtmp_session_.lock();
+    if(session && state_ == START_PUBLISH)
+    {
+        session->SendMetaData(meta_data);
     }
     return true;
 }
 
 bool RtmpConnection::HandleAudio(RtmpMessage &rtmp_msg)
 {
+    // 只接受发布者的媒体：观看者同样持有 rtmp_session_，但会话的写入只允许发生在推流线程
+    auto session = rtmp_session_.lock();
+    if (!session || state_ != START_PUBLISH)
+    {
+        return true;
+    }
+    uint8_t type = RTMP_AUDIO;
     // 提取音频格式信息：高 4 位为 sound_format，低 4 位为编码 id
     uint8_t* payload = (uint8_t*)rtmp_msg.playload.get();
     uint8_t sound_format = (payload[0] >> 4) & 0x0f;
@@ -273,13 +345,24 @@ bool RtmpConnection::HandleAudio(RtmpMessage &rtmp_msg)
         // 调整消息类型为 AAC 序列头
         type = RTMP_AAC_SEQUENCE_HEADER;
     }
+    else
+    {
+        session->GetIngestStats().OnAudio(rtmp_msg._timestamp, rtmp_msg.lenght);
+    }
     // 将音频数据分发给对应 Session
-    session->SendMediaData(type, rtmp_msg.timestamp, rtmp_msg.playload, rtmp_msg.lenght);
+    session->SendMediaData(type, rtmp_msg._timestamp, rtmp_msg.playload, rtmp_msg.lenght);
     return true;
 }
 
 bool RtmpConnection::HandleVideo(RtmpMessage &rtmp_msg)
 {
+    // 与 HandleAudio 相同，忽略非发布者发来的视频
+    auto session = rtmp_session_.lock();
+    if (!session || state_ != START_PUBLISH)
+    {
+        return true;
+    }
+    uint8_t type = RTMP_VIDEO;
     // 提取视频帧类型和编码 ID
     uint8_t* payload = (uint8_t*)rtmp_msg.playload.get();
     uint8_t frame_type = (payload[0] >> 4) & 0x0f;
@@ -294,22 +377,29 @@ bool RtmpConnection::HandleVideo(RtmpMessage &rtmp_msg)
         session->SetAvcSequenceHeader(avc_sequence_header_, avc_sequence_header_size_);
         type = RTMP_AVC_SEQUENCE_HEADER;
     }
+    else
+    {
+        // 码率、帧率与 GOP 长度在推流线程上顺带统计，不另起遍历
+        session->GetIngestStats().OnVideo(rtmp_msg._timestamp, rtmp_msg.lenght, frame_type == 1);
+    }
     // 分发视频数据
-    session->SendMediaData(type, rtmp_msg.timestamp, rtmp_msg.playload, rtmp_msg.lenght);
+    session->SendMediaData(type, rtmp_msg._timestamp, rtmp_msg.playload, rtmp_msg.lenght);
     return true;
 }
 
 /**
  * @brief 处理 connect 命令，建立 RTMP 连接
+ * @param command connect 的命令对象
  * @return true 连接处理成功，false 表示处理失败需断开连接
  */
-bool RtmpConnection::HandleConnect()
+bool RtmpConnection::HandleConnect(const AmfReader& command)
 {
     // 校验必需的 “app” 参数是否存在
-    if (!amf_decoder_.hasObject("app")) 
+    AmfStringView app;
+    if (!command.findString("app", app))
         return false;
     // 读取并存储 app 名称
-    app_ = amf_decoder_.getObject("app").amf_string;//获取应用程序的值
+    app_.assign(app.data, app.size);//获取应用程序的值
     if (app_.empty()) 
         return false;
     // 发送 ack、带宽、chunk 大小控制命令
@@ -321,7 +411,7 @@ bool RtmpConnection::HandleConnect()
     amf_encoder_.reset();
     //编码结果
     amf_encoder_.encodeString("_result",7);
-    amf_encoder_.encodeNumber(amf_decoder_.getNumber());
+    amf_encoder_.encodeNumber(transaction_id_);
 
     objects["fmsVer"] = AmfObject(std::string("FMS/4,5,0,297"));
     objects["capabilities"] = AmfObject(255.0);
@@ -353,7 +443,7 @@ bool RtmpConnection::HandleCreateStream()
     //结果
     amf_encoder_.reset();
     amf_encoder_.encodeString("_result",7);
-    amf_encoder_.encodeNumber(amf_decoder_.getNumber());
+    amf_encoder_.encodeNumber(transaction_id_);
     //需要填一个空对象
     amf_encoder_.encodeObjects(objects);
     amf_encoder_.encodeNumber(stream_id);
@@ -413,6 +503,7 @@ bool RtmpConnection::HandlePublish()
         if(server)
         {
             server->NotifyEvent("publish.start",stream_path_);// 通知服务器有新的流开始推送
+            server->UpdateStreamOwner(stream_path_,true);// 多进程模式下声明流归属
         }
     }
     amf_encoder_.encodeObjects(objects);
@@ -430,11 +521,38 @@ bool RtmpConnection::HandlePublish()
     auto session = rtmp_session_.lock();
     if(session)
     {
-        session->AddSink(std::dynamic_pointer_cast<RtmpSink>(shared_from_this()));// 添加当前连接为流的接收者
+        JoinSession(session, false);// 添加当前连接为流的接收者
     }
     return true;
 }
 
+/**
+ * @brief 拒绝已开始的推流，在连接所属线程发送状态并断开
+ */
+void RtmpConnection::RejectPublish()
+{
+    std::weak_ptr<TcpConnection> weak_conn = shared_from_this();
+    GetTaskSchduler()->AddReadyTask([weak_conn](){
+        auto conn = weak_conn.lock();
+        if(!conn || conn->IsClosed())
+        {
+            return;
+        }
+        auto rtmp_conn = std::static_pointer_cast<RtmpConnection>(conn);
+        AmfObjects objects;
+        rtmp_conn->amf_encoder_.reset();
+        rtmp_conn->amf_encoder_.encodeString("onStatus",8);
+        rtmp_conn->amf_encoder_.encodeNumber(0);
+        rtmp_conn->amf_encoder_.encodeObjects(objects);
+        objects["level"] = AmfObject(std::string("error"));
+        objects["code"] = AmfObject(std::string("NetStream.Publish.BadName"));
+        objects["description"] = AmfObject(std::string("Stream already publishing on another worker."));
+        rtmp_conn->amf_encoder_.encodeObjects(objects);
+        rtmp_conn->SendInvokeMessage(RTMP_CHUNK_INVOKE_ID,rtmp_conn->amf_encoder_.data(),rtmp_conn->amf_encoder_.size());
+        conn->DisConnect();
+    });
+}
+
 /**
  * @brief 处理 play 命令，开始播放流并通知客户端
  * @return true 播放处理成功，false 表示处理失败需断开连接
@@ -487,13 +605,82 @@ bool RtmpConnection::HandlePlay()
 
     //更新状态
     state_ = START_PLAY;
+
+    //观看者出口限速，平滑关键帧/GOP 突发
+    if(server->player_pacing_rate_ > 0)
+    {
+        this->SetPacingRate(server->player_pacing_rate_, server->player_pacing_burst_);
+        if(server->kernel_pacing_)
+        {
+            this->SetKernelPacingRate(server->player_pacing_rate_);
+        }
+    }
+
+    //观看者传输层统计：按 BDP 调整发送缓冲区，并据积压时延丢帧
+    if(server->transport_stats_interval_ > 0)
+    {
+        this->EnableTransportStats(server->transport_stats_interval_);
+        max_queue_delay_ = server->max_queue_delay_;
+    }
+    if(server->notsent_lowat_ > 0)
+    {
+        this->SetNotSentLowat(server->notsent_lowat_);
+    }
+
+    //观看者未确认字节上限：确认粒度为一个窗口，上限至少取两倍窗口，避免播放器未到窗口时无法确认
+    if(server->max_unacked_bytes_ > 0)
+    {
+        uint64_t min_limit = (uint64_t)ackonwledgement_size_ * 2;
+        max_unacked_bytes_ = (uint32_t)std::min<uint64_t>(std::max<uint64_t>(server->max_unacked_bytes_, min_limit), 0x7FFFFFFF);
+    }
+
+    //点播：没有推流且点播目录下有同名文件时直接发送文件，不加入会话，也不经过媒体队列（点播不丢帧）
+    std::shared_ptr<FlvVodFile> vod_file = server->HasPublisher(stream_path_) ? nullptr : server->OpenVodFile(stream_path_);
+    if(vod_file)
+    {
+        StartVod(vod_file);
+        server->NotifyEvent("Play.start",stream_path_);
+        return true;
+    }
+
+    //时移：流开启了时移窗口时从窗口中落后直播发送，不加入会话，也不经过媒体队列（时移不丢帧）
+    RtmpSession::Ptr time_shift_session = time_shift_delay_ms_ > 0 ? server->FindSession(stream_path_) : nullptr;
+    std::shared_ptr<TimeShiftBuffer> time_shift;
+    if(time_shift_session && time_shift_session->HasPublisher())
+    {
+        time_shift = time_shift_session->GetTimeShift();
+    }
+    if(time_shift)
+    {
+        StartTimeShift(time_shift);
+        server->NotifyEvent("Play.start",stream_path_);
+        return true;
+    }
+
+    //观看者媒体队列：积压按媒体时长计算，超过阈值时按帧类型丢帧
+    if(server->player_queue_drop_disposable_ms_ > 0 || server->player_queue_drop_gop_ms_ > 0 || server->player_queue_max_ms_ > 0)
+    {
+        media_queue_.SetThresholds(server->player_queue_drop_disposable_ms_, server->player_queue_drop_gop_ms_, server->player_queue_max_ms_);
+        queue_watermark_ = server->player_queue_watermark_;
+        use_media_queue_ = true;
+        this->SetWriteCallback([this](std::shared_ptr<TcpConnection> conn){
+            this->DrainMediaQueue();
+        }, queue_watermark_);
+    }
     //TODO 
     //session添加客户端
     rtmp_session_ = server->GetSession(stream_path_);
+    server->RouteStream(stream_path_, nullptr);// 本地无推流时从推流所在的工作进程中继或回源，拉流连接由该流的观看者共享
     auto session = rtmp_session_.lock();
     if(session)
     {
-        session->AddSink(std::dynamic_pointer_cast<RtmpSink>(shared_from_this()));// 添加客户端
+        //自适应码率：由切换器代替本连接加入会话，切换决策依赖 TCP_INFO 交付速率
+        rendition_switcher_ = RenditionSwitcher::Create(server, std::dynamic_pointer_cast<RtmpSink>(shared_from_this()), stream_path_);
+        if(rendition_switcher_ && server->transport_stats_interval_ == 0)
+        {
+            this->EnableTransportStats(RenditionSwitcher::kTransportStatsInterval, false);
+        }
+        JoinSession(session, true);// 添加客户端
     }
 
     if(server)
@@ -504,6 +691,63 @@ bool RtmpConnection::HandlePlay()
     return true;
 }
 
+/**
+ * @brief 把连接加入会话，启用流亲和时先迁移到会话所属线程
+ * @param session 目标会话
+ * @param is_player 是否为观看者
+ *
+ * 迁移在本轮读回调返回后进行
+ */
+void RtmpConnection::JoinSession(std::shared_ptr<RtmpSession> session, bool is_player)
+{
+    auto sink = std::dynamic_pointer_cast<RtmpSink>(shared_from_this());
+    if(is_player && rendition_switcher_)
+    {
+        sink = rendition_switcher_->GetActiveSink();
+    }
+    TaskScheduler* owner = session->GetScheduler();
+    if(owner == nullptr || owner == GetTaskSchduler())
+    {
+        session->AddSink(sink);
+        return;
+    }
+
+    if(!is_player)
+    {
+        // 发布者的媒体消息都由自身读回调产生，迁移前后不会乱序，可以立即加入
+        session->AddSink(sink);
+        MigrateTo(owner, nullptr);
+        return;
+    }
+
+    auto server = rtmp_server_.lock();
+    uint32_t max_players = server ? server->affinity_max_players_ : 0;
+    if(max_players > 0 && (uint32_t)session->GetPlayers(owner) >= max_players)
+    {
+        session->AddSink(sink);// 所属线程已满，留在当前线程由会话中继
+        return;
+    }
+
+    // 观看者在目标线程加入，避免迁移期间直接发送与中继发送交错
+    std::weak_ptr<RtmpSink> weak_sink = sink;
+    MigrateTo(owner, [session, weak_sink]() {
+        auto sink = weak_sink.lock();
+        if(sink)
+        {
+            session->AddSink(sink);
+        }
+    });
+}
+
+/**
+ * @brief 获取处理本连接 IO 的调度线程
+ * @return 调度器指针
+ */
+TaskScheduler* RtmpConnection::GetOwnerScheduler()
+{
+    return GetTaskSchduler();
+}
+
 bool RtmpConnection::HandleDeleteStream()
 {
     auto server = rtmp_server_.lock();
@@ -519,13 +763,19 @@ bool RtmpConnection::HandleDeleteStream()
         if(session)
         {
             auto conn = std::dynamic_pointer_cast<RtmpSink>(shared_from_this());
-            GetTaskSchduler()->AddTimer([session,conn](){
+            auto switcher = rendition_switcher_;
+            GetTaskSchduler()->AddTimer([session,conn,switcher](){
                 session->RemoveSink(conn);
+                if(switcher)
+                {
+                    switcher->Stop();// 移出切换器加入的各档位会话
+                }
                 return false;
             },1);
             if(is_publishing_)
             {
                 server->NotifyEvent("publish,stop",stream_path_);
+                server->UpdateStreamOwner(stream_path_,false);
             }
             else if(is_playing_)
             {
@@ -533,14 +783,218 @@ bool RtmpConnection::HandleDeleteStream()
             }
         }
 
+    if(vod_player_)
+    {
+        vod_player_->Stop();
+        vod_player_.reset();
+        server->NotifyEvent("play.stop",stream_path_);
+    }
+    if(time_shift_player_)
+    {
+        time_shift_player_->Stop();
+        time_shift_player_.reset();
+        server->NotifyEvent("play.stop",stream_path_);
+    }
+
     is_playing_ = false;
     is_publishing_ = false;
     has_key_frame = false;
+    rendition_switcher_.reset();
+    media_queue_.Clear();
     rtmp_chunk_->Clear();
     }
     return true;
 }
 
+/**
+ * @brief 点播与时移拖动：从不晚于目标位置的关键帧重新发送，先通知播放器清空缓冲
+ *
+ * 时移观看者的位置为流时间戳，只能在窗口内拖动，早于窗口时从窗口起点开始
+ * @param position 目标位置（毫秒）
+ * @return false 表示连接已关闭
+ */
+bool RtmpConnection::HandleSeek(double position)
+{
+    if(time_shift_player_)
+    {
+        time_shift_player_->Seek(position > 0 ? (uint64_t)position : 0);
+        if(!SendOnStatus("NetStream.Seek.Notify", "Seeking.") || !SendOnStatus("NetStream.Play.Start", "Started playing."))
+        {
+            return false;
+        }
+        time_shift_player_->Pump();                     // 先重发序列头，再从关键帧开始发送
+        return true;
+    }
+    if(!vod_player_)
+    {
+        return SendOnStatus("NetStream.Seek.Failed", "Seek is only supported for files and time-shifted streams.");
+    }
+    vod_player_->Seek(position > 0 ? (uint32_t)position : 0);
+    if(!SendOnStatus("NetStream.Seek.Notify", "Seeking.") || !SendOnStatus("NetStream.Play.Start", "Started playing."))
+    {
+        return false;
+    }
+    SendVodHeaders();
+    vod_player_->Pump();
+    return true;
+}
+
+/**
+ * @brief 点播与时移暂停与恢复，恢复时从暂停处继续发送，不重复已发送的数据
+ * @param pause true 表示暂停
+ * @param position 播放器当前位置（毫秒），未使用
+ * @return false 表示连接已关闭
+ */
+bool RtmpConnection::HandlePause(bool pause, double position)
+{
+    if(time_shift_player_)
+    {
+        time_shift_player_->Pause(pause);               // 时移恢复后落后时长增加暂停的时长
+    }
+    else if(vod_player_)
+    {
+        vod_player_->Pause(pause);
+    }
+    else
+    {
+        return true;
+    }
+    return pause ? SendOnStatus("NetStream.Pause.Notify", "Paused.")
+                 : SendOnStatus("NetStream.Unpause.Notify", "Unpaused.");
+}
+
+/**
+ * @brief 开始点播：发送队列降到一半上限时由写队列回调补充，与定时器共同驱动 VodPlayer
+ * @param file 点播文件
+ */
+void RtmpConnection::StartVod(std::shared_ptr<FlvVodFile> file)
+{
+    is_playing_ = true;
+    vod_player_ = std::make_shared<VodPlayer>(file, kMaxVodAggregateBytes,
+        [this](uint64_t offset, uint32_t size, uint32_t timestamp) {
+            this->SendVodTags(offset, size, timestamp);
+        },
+        [this]() -> uint64_t {
+            return this->IsAckLimited() ? UINT64_MAX : this->GetPendingBytes();
+        },
+        [this]() {
+            this->SendOnStatus("NetStream.Play.Stop", "Stopped playing.");
+        });
+    SendVodHeaders();
+    vod_player_->Start(GetTaskSchduler(), vod_start_ms_);
+    // 定位起点之后再注册，发送序列头时不会从文件开头补充数据
+    this->SetWriteCallback([this](std::shared_ptr<TcpConnection> conn){
+        if(vod_player_)
+        {
+            vod_player_->Pump();
+        }
+    }, VodPlayer::kMaxPendingBytes / 2);
+}
+
+/**
+ * @brief 开始时移播放：元数据与序列头由 TimeShiftPlayer 经 SendMetaData/SendMediaPacket 发送，
+ * 同一窗口的时移观看者共享消息的分片结果；发送队列降到一半上限时由写队列回调补充
+ * @param buffer 流的时移窗口
+ */
+void RtmpConnection::StartTimeShift(std::shared_ptr<TimeShiftBuffer> buffer)
+{
+    is_playing_ = true;
+    time_shift_player_ = std::make_shared<TimeShiftPlayer>(buffer, std::dynamic_pointer_cast<RtmpSink>(shared_from_this()),
+        [this]() -> uint64_t {
+            return this->IsAckLimited() ? UINT64_MAX : this->GetPendingBytes();
+        });
+    time_shift_player_->Start(GetTaskSchduler(), time_shift_delay_ms_);
+    this->SetWriteCallback([this](std::shared_ptr<TcpConnection> conn){
+        if(time_shift_player_)
+        {
+            time_shift_player_->Pump();
+        }
+    }, TimeShiftPlayer::kMaxPendingBytes / 2);
+}
+
+/**
+ * @brief 发送点播文件的元数据与序列头，起播与拖动后各发送一次
+ */
+void RtmpConnection::SendVodHeaders()
+{
+    std::shared_ptr<FlvVodFile> file = vod_player_ ? vod_player_->GetFile() : nullptr;
+    if(!file)
+    {
+        return;
+    }
+    RtmpMediaPacket::Ptr packets[] = { file->GetMetaData(), file->GetAvcSequenceHeader(), file->GetAacSequenceHeader() };
+    for(auto &packet : packets)
+    {
+        if(packet)
+        {
+            SendPacketChunks(packet);
+        }
+    }
+}
+
+/**
+ * @brief 文件中连续的 tag 与聚合消息的负载格式相同，直接作为一条 RTMP_AGGREGATE 发送
+ *
+ * chunk 头部单独生成，负载按 chunk 切成映射上的别名指针与头部交替入队，由 writev 一次发出
+ * @param offset 首个 tag 在文件中的偏移
+ * @param size 这段 tag 的总长度
+ * @param timestamp 首个 tag 的时间戳，即聚合消息的时间戳
+ */
+void RtmpConnection::SendVodTags(uint64_t offset, uint32_t size, uint32_t timestamp)
+{
+    std::shared_ptr<char> payload = vod_player_->GetFile()->GetSlice(offset);
+    RtmpMessage rtmp_msg;
+    rtmp_msg.type_id = RTMP_AGGREGATE;
+    rtmp_msg._timestamp = timestamp;
+    rtmp_msg.stream_id = stream_id_;
+    rtmp_msg.playload = payload;
+    rtmp_msg.lenght = size;
+
+    if(rtmp_chunk_->GetOutChunkSize() < kMinVodSliceChunkSize)
+    {
+        SendRtmpChunks(RTMP_CHUNK_VIDEO_ID, rtmp_msg);
+        return;
+    }
+    this->SendSegmentsInOrder([&](std::vector<std::pair<std::shared_ptr<char>, uint32_t>>& segments) {
+        uint32_t chunk_size = rtmp_chunk_->GetOutChunkSize();
+        uint32_t capacity = RtmpChunk::GetChunkHeadersCapacity(size, chunk_size);
+        std::shared_ptr<char> headers(new char[capacity], std::default_delete<char[]>());
+        std::vector<uint32_t> header_sizes;
+        if(rtmp_chunk_->CreateChunkHeaders(RTMP_CHUNK_VIDEO_ID, rtmp_msg, headers.get(), capacity, header_sizes) <= 0)
+        {
+            return;
+        }
+        uint32_t header_offset = 0;
+        for(size_t i = 0; i < header_sizes.size(); i++)
+        {
+            uint32_t payload_offset = (uint32_t)i * chunk_size;
+            segments.emplace_back(std::shared_ptr<char>(headers, headers.get() + header_offset), header_sizes[i]);
+            segments.emplace_back(std::shared_ptr<char>(payload, payload.get() + payload_offset),
+                                  std::min(chunk_size, size - payload_offset));
+            header_offset += header_sizes[i];
+        }
+    });
+}
+
+/**
+ * @brief 在消息流上发送 onStatus 通知
+ * @param code 状态码
+ * @param description 描述
+ * @return false 表示连接已关闭
+ */
+bool RtmpConnection::SendOnStatus(const char* code, const char* description)
+{
+    AmfObjects objects;
+    amf_encoder_.reset();
+    amf_encoder_.encodeString("onStatus",8);
+    amf_encoder_.encodeNumber(0);
+    objects["level"] = AmfObject(std::string("status"));
+    objects["code"] = AmfObject(std::string(code));
+    objects["description"] = AmfObject(std::string(description));
+    amf_encoder_.encodeObjects(objects);
+    return SendInvokeMessage(RTMP_CHUNK_INVOKE_ID,amf_encoder_.data(),amf_encoder_.size());
+}
+
 /**
  * @brief 设置对等方的带宽限制，发送 RTMP_BANDWIDTH_SIZE 消息
  */
@@ -574,6 +1028,30 @@ void RtmpConnection::SendAcknowlegement()
     SendRtmpChunks(RTMP_CHUNK_CONTROL_ID,rtmp_msg);// 发送确认消息
 }
 
+/**
+ * @brief 接收字节数达到确认窗口时发送 Acknowledgement，序号为已接收字节数的低 32 位
+ *
+ * 窗口取对端 Window Acknowledgement Size 设置的值，对端未设置时沿用本端窗口
+ */
+void RtmpConnection::SendBytesReceived()
+{
+    uint32_t window = peer_ack_window_ > 0 ? peer_ack_window_ : ackonwledgement_size_;
+    uint64_t received_bytes = GetReceivedBytes();
+    if (window == 0 || received_bytes - last_ack_bytes_ < window)
+    {
+        return;
+    }
+    last_ack_bytes_ = received_bytes;
+
+    std::shared_ptr<char> data(new char[4],std::default_delete<char[]>());
+    WriteUint32BE(data.get(),(uint32_t)received_bytes);
+    RtmpMessage rtmp_msg;
+    rtmp_msg.type_id = RTMP_ACK;
+    rtmp_msg.playload = data;
+    rtmp_msg.lenght = 4;
+    SendRtmpChunks(RTMP_CHUNK_CONTROL_ID,rtmp_msg);
+}
+
 /**
  * @brief 设置最大 Chunk 大小，发送 RTMP_SET_CHUNK_SIZE 消息
  */
@@ -652,6 +1130,53 @@ bool RtmpConnection::IsKeyFrame(std::shared_ptr<char> data, uint32_t size)
     return (frame_type == 1 && code_id == RTMP_CODEC_ID_H264);// 关键帧的 frame_type 为 1，编码 ID 为 H264
 }
 
+/**
+ * @brief 计算已发送但对端尚未确认的字节数
+ *
+ * 序号按 32 位回绕相减；对端计数可能不含握手等字节，差值为负时按 0 处理
+ * @return 未确认字节数
+ */
+uint32_t RtmpConnection::GetUnackedBytes()
+{
+    int32_t unacked = (int32_t)((uint32_t)GetSentBytes() - acked_sequence_.load(std::memory_order_relaxed));
+    return unacked > 0 ? (uint32_t)unacked : 0;
+}
+
+/**
+ * @brief 未确认字节是否超过上限，从未收到 Acknowledgement 的对端不受限制
+ * @return true 表示应暂停发送
+ */
+bool RtmpConnection::IsAckLimited()
+{
+    return max_unacked_bytes_ > 0 && ack_received_ && GetUnackedBytes() > max_unacked_bytes_;
+}
+
+/**
+ * @brief 判断观看者发送是否积压
+ *
+ * 未启用媒体队列时，未确认字节超过上限视为积压；
+ * 否则根据 TCP_INFO 交付速率估算发送积压时延（应用层队列 + 内核未发送数据）
+ * @return true 表示未确认字节超限或积压时延超过 max_queue_delay_
+ */
+bool RtmpConnection::IsCongested()
+{
+    if(!use_media_queue_ && IsAckLimited())
+    {
+        return true;
+    }
+    if(max_queue_delay_ == 0)
+    {
+        return false;
+    }
+    TcpTransportInfo info = GetTransportInfo();
+    if(info.delivery_rate == 0)
+    {
+        return false;
+    }
+    uint64_t backlog = GetPendingBytes() + info.notsent_bytes;
+    return backlog * 1000 / info.delivery_rate > max_queue_delay_;
+}
+
 /**
  * @brief 将 RTMP 消息分片并发送，考虑 Chunk 大小和额外的头部信息
  * @param csid Chunk Stream ID，用于标识消息流
@@ -659,47 +1184,46 @@ bool RtmpConnection::IsKeyFrame(std::shared_ptr<char> data, uint32_t size)
  */
 void RtmpConnection::SendRtmpChunks(uint32_t csid, RtmpMessage &rtmp_msg)
 {
-     // 计算缓冲区容量，考虑分片和额外空间， 具体来说, rtmp_msg.lenght 是负载长度，除以 max_chunk_size_ 得到分片数，
-    // 每个分片需要额外的 5 字节头部信息（chunk header），再加上 1024 字节的预留空间
-    uint32_t capacity = rtmp_msg.lenght + rtmp_msg.lenght / max_chunk_size_ * 5 + 1024;
-    std::shared_ptr<char> buffer(new char[capacity],std::default_delete<char[]>());// 分配缓冲区
-    int size = rtmp_chunk_->CreateChunk(csid,rtmp_msg,buffer.get(),capacity);// 创建分片数据
-    if(size > 0)
-    {
-        this->Send(buffer.get(),size);// 发送分片数据
-    }
+    // 计算缓冲区容量: 负载长度加上每个分片的 Basic Header 与扩展时间戳
+    // 头部按 csid 的发送状态压缩，需在发送锁内分片，保证与入队顺序一致
+    this->SendInOrder([&](uint32_t& size) -> std::shared_ptr<char> {
+        uint32_t capacity = RtmpChunk::GetChunkCapacity(rtmp_msg.lenght, rtmp_chunk_->GetOutChunkSize());
+        std::shared_ptr<char> buffer(new char[capacity],std::default_delete<char[]>());// 分配缓冲区
+        int ret = rtmp_chunk_->CreateChunk(csid,rtmp_msg,buffer.get(),capacity);// 创建分片数据
+        if(ret <= 0)
+        {
+            return nullptr;
+        }
+        size = ret;
+        return buffer;// 缓冲区直接入队，不再拷贝
+    });
 }
 
 /**
  * @brief 发送元数据，通常用于视频流的元信息
- * @param metaData 元数据对象集合
+ *
+ * 元数据消息由会话共享，分片结果与同组观看者共用，不再逐个连接重新编码
+ * @param meta_data 元数据消息
  * @return true 发送成功，false 表示连接已关闭或发送失败
  */
-bool RtmpConnection::SendMetaData(AmfObjects metaData)
+bool RtmpConnection::SendMetaData(RtmpMediaPacket::Ptr meta_data)
 {
     if(this->IsClosed())
     {
         return false;
     }
 
-    if(meta_data_.size() == 0)
+    if(!meta_data || meta_data->GetSize() == 0)
     {
         return false;
     }
 
-    amf_encoder_.reset();
-    amf_encoder_.encodeString("onMetaData",10);
-    amf_encoder_.encodeECMA(meta_data_);// 编码元数据对象集合
-    // 将编码后的数据发送为 notify 消息
-    if(!SendNotifyMessage(RTMP_CHUNK_DATA_ID,amf_encoder_.data(),amf_encoder_.size()))
-    {
-        return false;
-    }
+    SendPacketChunks(meta_data);
     return true;
 }
 
 /**
- * @brief 发送音视频数据，处理序列头和关键帧逻辑
+ * @brief 发送音视频数据，封装为媒体消息后按共享路径发送
  * @param type 数据类型（视频或音频）
  * @param timestamp 时间戳
  * @param playload 数据负载
@@ -707,12 +1231,28 @@ bool RtmpConnection::SendMetaData(AmfObjects metaData)
  * @return true 发送成功，false 表示连接已关闭或发送失败
  */
 bool RtmpConnection::SendMediaData(uint8_t type, uint64_t timestamp, std::shared_ptr<char> playload, uint32_t playload_size)
+{
+    return SendMediaPacket(std::make_shared<RtmpMediaPacket>(type, timestamp, playload, playload_size));
+}
+
+/**
+ * @brief 发送会话共享的媒体消息，处理序列头和关键帧逻辑
+ *
+ * 分片结果按本连接的 out chunk size 与 stream id 从消息缓存中获取，
+ * 同组观看者共享同一块缓冲区，直接入队发送
+ * @param packet 媒体消息
+ * @return true 发送成功，false 表示连接已关闭或发送失败
+ */
+bool RtmpConnection::SendMediaPacket(RtmpMediaPacket::Ptr packet)
 {
     if(this->IsClosed())
     {
         return false;
     }
 
+    uint8_t type = packet->GetType();
+    std::shared_ptr<char> playload = packet->GetPayload();
+    uint32_t playload_size = packet->GetSize();
     if(playload_size == 0)
     {
         return false;
@@ -731,6 +1271,12 @@ bool RtmpConnection::SendMediaData(uint8_t type, uint64_t timestamp, std::shared
         aac_sequence_header_szie_ = playload_size;
     }
 
+    //发送积压超过阈值，丢弃视频直到下一个关键帧，避免时延持续增长；聚合消息不含关键帧，按普通视频帧处理
+    if(has_key_frame && (type == RTMP_VIDEO || type == RTMP_AGGREGATE) && IsCongested())
+    {
+        has_key_frame = false;
+    }
+
     if(!has_key_frame && avc_sequence_header_size_ > 0
     && (type != RTMP_AVC_SEQUENCE_HEADER)
     && (type != RTMP_AAC_SEQUENCE_HEADER)) //说明数据包既不是序列头，还没有收到关键帧
@@ -746,28 +1292,98 @@ bool RtmpConnection::SendMediaData(uint8_t type, uint64_t timestamp, std::shared
         }
         else
         {
+            skipped_frames_.fetch_add(packet->GetFrames(), std::memory_order_relaxed);
             return true;
         }
     }
 
-    //收到关键帧之后开始发送message
-    RtmpMessage rtmp_msg;
-    rtmp_msg._timestamp = timestamp;
-    rtmp_msg.stream_id = stream_id_;
-    rtmp_msg.playload = playload;
-    rtmp_msg.lenght = playload_size;
-
-    //还有msg类型
-    if(type == RTMP_VIDEO ||type ==RTMP_AVC_SEQUENCE_HEADER)
+    //收到关键帧之后开始发送message；启用媒体队列时先入队，由队列负责积压丢帧
+    if(use_media_queue_)
+    {
+        media_queue_.Push(packet);
+        DrainMediaQueue();
+    }
+    else
     {
-        rtmp_msg.type_id = RTMP_VIDEO;
-        SendRtmpChunks(RTMP_CHUNK_VIDEO_ID,rtmp_msg);
+        SendPacketChunks(packet);
     }
-    else if(type == RTMP_AUDIO ||type ==RTMP_AAC_SEQUENCE_HEADER)
+    return true;
+}
+
+/**
+ * @brief 发送共享媒体消息，同组观看者共享分片结果
+ *
+ * 首个 chunk 按本连接各 csid 的发送状态压缩头部，推流线程与本连接线程都会发送，
+ * 因此在发送锁内取分片并入队
+ * @param packet 媒体消息
+ */
+void RtmpConnection::SendPacketChunks(RtmpMediaPacket::Ptr packet)
+{
+    this->SendInOrder([&](uint32_t& chunks_size) {
+        return packet->GetChunks(*rtmp_chunk_, stream_id_, chunks_size);
+    });
+}
+
+/**
+ * @brief TCP 发送队列低于水位且未确认字节未超限时从媒体队列取出消息发送
+ *
+ * 会在推流线程（新消息入队）和本连接线程（写队列回调、收到 Acknowledgement）上调用，由 RtmpMediaQueue::Drain 保证同一时刻只有一个线程补充
+ */
+void RtmpConnection::DrainMediaQueue()
+{
+    media_queue_.Drain([this]() {
+        return !this->IsClosed() && GetPendingBytes() <= queue_watermark_ && !IsAckLimited();
+    }, [this](RtmpMediaPacket::Ptr packet) {
+        SendPacketChunks(packet);
+    });
+}
+
+/**
+ * @brief 获取观看者媒体队列统计
+ * @return 积压时长、队列长度与丢帧计数
+ */
+RtmpMediaQueue::Stats RtmpConnection::GetMediaQueueStats()
+{
+    return media_queue_.GetStats();
+}
+
+/**
+ * @brief 汇总观看者的发送统计：内核写入字节、发送队列、媒体队列积压与丢帧
+ */
+bool RtmpConnection::GetSinkStats(SinkStats& stats)
+{
+    if(!IsPlayer())
     {
-        rtmp_msg.type_id = RTMP_AUDIO;
-        SendRtmpChunks(RTMP_CHUNK_AUDIO_ID,rtmp_msg);
+        return false;
     }
+    RtmpMediaQueue::Stats queue_stats = media_queue_.GetStats();
+    stats.type = "rtmp";
+    stats.sent_bytes = GetSentBytes();
+    stats.pending_bytes = GetPendingBytes();
+    stats.lag_ms = queue_stats.lag_ms;
+    stats.header_bytes_saved = rtmp_chunk_->GetHeaderBytesSaved();
+    stats.send_calls = GetSendCalls();
+    stats.unacked_bytes = GetUnackedBytes();
+    TcpTransportInfo info = GetTransportInfo();
+    stats.delivery_rate = info.delivery_rate;
+    stats.notsent_bytes = info.notsent_bytes;
+    stats.dropped_frames = queue_stats.dropped_video + queue_stats.dropped_audio
+                         + skipped_frames_.load(std::memory_order_relaxed);
     return true;
+}
 
+/**
+ * @brief 将解析或处理失败计入本连接所在线程的计数器
+ * @param chunk_error true 表示 Chunk 解析失败，false 表示消息处理失败
+ */
+void RtmpConnection::CountError(bool chunk_error)
+{
+    auto server = rtmp_server_.lock();
+    if(!server)
+    {
+        return;
+    }
+    RtmpServer::ThreadCounters& counters = server->GetThreadCounters(GetOwnerScheduler());
+    std::atomic<uint64_t>& counter = chunk_error ? counters.chunk_errors : counters.message_errors;
+    counter.store(counter.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
 }
@@ -18,9 +18,16 @@
 #include "RtmpSink.h"
 #include "RtmpChunk.h"
 #include "RtmpHandshake.h"
+#include "RtmpMediaQueue.h"
+#include <atomic>
 
 class RtmpServer;
 class RtmpSession;
+class RenditionSwitcher;
+class FlvVodFile;
+class VodPlayer;
+class TimeShiftBuffer;
+class TimeShiftPlayer;
 /**
  * @class RtmpConnection
  * @brief 继承自 TcpConnection 和 RtmpSink，实现 RTMP 客户端/服务器双向交互逻辑。
@@ -61,8 +68,42 @@ public:
     virtual bool IsPlaying() override;    ///< 判断观看者是否正在播放
     virtual bool IsPublishing() override; ///< 判断发布者是否正在推流
     virtual uint32_t GetId() override;    ///< 获取唯一连接 ID
+    virtual TaskScheduler* GetOwnerScheduler() override; ///< 获取处理本连接 IO 的调度线程
+    virtual bool AcceptsAggregate() override { return true; } ///< RTMP 播放器都支持聚合消息
+
+    /**
+     * @brief 获取观看者媒体队列的积压与丢帧统计
+     * @return 统计信息，未启用队列时积压为 0
+     */
+    RtmpMediaQueue::Stats GetMediaQueueStats();
+
+    /**
+     * @brief 获取已发送但对端尚未确认的字节数（按对端 Acknowledgement 序号计算，可跨线程调用）
+     * @return 未确认字节数，精度为确认窗口
+     */
+    uint32_t GetUnackedBytes();
+
+    /**
+     * @brief 获取观看者的发送统计，发布者返回 false
+     */
+    virtual bool GetSinkStats(SinkStats& stats) override;
+
+    /**
+     * @brief 拒绝已开始的推流：回复 NetStream.Publish.BadName 后断开，可跨线程调用
+     *
+     * 多进程模式下监控进程发现该流已由其他工作进程推送时使用
+     */
+    void RejectPublish();
 
 private:
+    /**
+     * @brief 私有构造，初始化 TcpConnection、Chunk 解析器和默认状态
+     * @param scheduler 调度器
+     * @param socket    底层 TCP 套接字
+     * @param rtmp      协议配置来源（服务端实例）
+     */
+    RtmpConnection(TaskScheduler* scheduler, int socket, Rtmp* rtmp);
+
     /**
      * @brief 处理读到的原始数据，先握手后分片处理
      * @param buffer 输入缓冲区
@@ -82,6 +123,11 @@ private:
      */
     bool HandleChunk(BufferReader& buffer);
 
+    /**
+     * @brief 将解析或处理失败计入所在线程的计数器
+     */
+    void CountError(bool chunk_error);
+
     /**
      * @brief 处理完整的 RTMP 消息，根据类型分发到不同处理函数
      * @param rtmp_msg 完整消息结构
@@ -96,26 +142,58 @@ private:
     bool HandleVideo(RtmpMessage& rtmp_msg);     ///< 视频消息处理
 
     // --- 流程命令处理 ---
-    bool HandleConnect();        ///< 处理 connect，建立连接
+    bool HandleConnect(const AmfReader& command); ///< 处理 connect，建立连接
     bool HandleCreateStream();   ///< 处理 createStream，创建流
     bool HandlePublish();        ///< 处理 publish，开始推流
     bool HandlePlay();           ///< 处理 play，开始播放（拉流）
     bool HandleDeleteStream();   ///< 处理 deleteStream，删除流并清理会话
+    bool HandleSeek(double position);             ///< 处理点播与时移 seek，position 为毫秒
+    bool HandlePause(bool pause, double position);///< 处理点播与时移 pause/恢复
+
+    // --- 点播 ---
+    /**
+     * @brief 以点播方式播放文件：发送元数据与序列头后由 VodPlayer 按实时速度发送 tag
+     * @param file 点播文件
+     */
+    void StartVod(std::shared_ptr<FlvVodFile> file);
+    void SendVodHeaders();                                                  ///< 发送文件的元数据与序列头，消息由该文件的观看者共享
+    void SendVodTags(uint64_t offset, uint32_t size, uint32_t timestamp);  ///< 把一段连续的 tag 作为聚合消息发送，负载引用文件映射
+    bool SendOnStatus(const char* code, const char* description);           ///< 发送 level 为 status 的 onStatus
+
+    // --- 时移 ---
+    /**
+     * @brief 以时移方式播放：由 TimeShiftPlayer 从流的时移窗口中落后直播发送，不加入会话
+     * @param buffer 流的时移窗口
+     */
+    void StartTimeShift(std::shared_ptr<TimeShiftBuffer> buffer);
 
     // --- 控制消息发送 ---
     void SetPeerBandWidth();     ///< 发送带宽限制命令
     void SendAcknowlegement();   ///< 发送确认消息
+    void SendBytesReceived();    ///< 接收字节数达到确认窗口时发送 Acknowledgement
     void SetChunkSize();         ///< 发送 chunk 大小设置命令
 
     // --- 消息发送工具 ---
     bool SendInvokeMessage(uint32_t csid, std::shared_ptr<char> payload, uint32_t payload_size);///< 封装 invoke 并发送，启动
     bool SendNotifyMessage(uint32_t csid, std::shared_ptr<char> payload, uint32_t payload_size);///< 封装 notify 并发送，通知
     bool IsKeyFrame(std::shared_ptr<char> data, uint32_t size);                                 ///< 判断 H264 关键帧
+    bool IsCongested();                                                                         ///< 根据 TCP_INFO 与未确认字节判断发送是否积压
+    bool IsAckLimited();                                                                        ///< 未确认字节是否超过上限
     void SendRtmpChunks(uint32_t csid, RtmpMessage& rtmp_msg);                                 ///< 按 chunk 分片并发送
+    void SendPacketChunks(RtmpMediaPacket::Ptr packet);                                         ///< 发送共享媒体消息的分片结果
+    void DrainMediaQueue();                                                                     ///< 发送队列低于水位时从媒体队列补充数据
 
     // --- RtmpSink 接口实现 ---
-    virtual bool SendMetaData(AmfObjects metaData) override; ///< RtmpSink 元数据发送
+    /**
+     * @brief 把连接加入会话；启用流亲和时先迁移到会话所属线程，迁移完成后再加入
+     * @param session 目标会话
+     * @param is_player 是否为观看者，观看者在所属线程达到上限时留在原线程
+     */
+    void JoinSession(std::shared_ptr<RtmpSession> session, bool is_player);
+
+    virtual bool SendMetaData(RtmpMediaPacket::Ptr meta_data) override; ///< RtmpSink 元数据发送，共享会话内的元数据消息
     virtual bool SendMediaData(uint8_t type, uint64_t timestamp, std::shared_ptr<char> payload, uint32_t payload_size) override;///< RtmpSink 媒体数据发送
+    virtual bool SendMediaPacket(RtmpMediaPacket::Ptr packet) override;  ///< RtmpSink 共享媒体消息发送，复用会话内已分片的 chunk
 
 private:
     ConnectionState state_;                       ///< 当前 RTMP 流程状态
@@ -124,28 +202,47 @@ private:
 
     std::weak_ptr<RtmpServer> rtmp_server_;      ///< RTMP 服务弱引用
     std::weak_ptr<RtmpSession> rtmp_session_;    ///< 当前会话弱引用
+    std::shared_ptr<RenditionSwitcher> rendition_switcher_;  ///< 自适应码率切换器，未开启时为空
+    std::shared_ptr<VodPlayer> vod_player_;      ///< 点播发送器，直播观看者为空
+    uint32_t vod_start_ms_ = 0;                  ///< play 命令的起始位置（毫秒），只用于点播
+    std::shared_ptr<TimeShiftPlayer> time_shift_player_; ///< 时移发送器，直播观看者为空
+    uint32_t time_shift_delay_ms_ = 0;           ///< 流名称中 "?delay=秒" 指定的落后时长（毫秒）
 
     uint32_t peer_width_;            ///< 对等方可接收带宽
     uint32_t ackonwledgement_size_;  ///< 确认窗口大小
     uint32_t max_chunk_size_;        ///< 最大 chunk 大小
     uint32_t stream_id_;             ///< 当前 stream id
 
-    AmfObjects meta_data_;           ///< 缓存的元数据
-    AmfDecoder amf_decoder_;         ///< AMF 解码器
     AmfEncoder amf_encoder_;         ///< AMF 编码器
+    double transaction_id_ = 0;      ///< 当前命令的事务 ID，应答时原样带回
 
-    bool is_playing_;                ///< 播放者播放状态
-    bool is_publishing_;             ///< 发布者推流状态
+    bool is_playing_ = false;        ///< 播放者播放状态
+    bool is_publishing_ = false;     ///< 发布者推流状态
 
     std::string app_;                ///< 应用名称
     std::string stream_name_;        ///< 流名称
     std::string stream_path_;        ///< 完整流路径
 
-    bool has_key_frame;              ///< 是否已收到关键帧，用于延迟推流
+    bool has_key_frame = false;      ///< 是否已收到关键帧，用于延迟推流
+    std::atomic<uint64_t> skipped_frames_{0}; ///< 等待关键帧期间跳过的帧数
+    uint32_t max_queue_delay_ = 0;   ///< 允许的最大发送积压时延（毫秒），0 表示不检测
+    uint32_t read_budget_bytes_ = 64 * 1024; ///< 每轮 Chunk 解析字节预算
+    uint32_t read_budget_messages_ = 32;     ///< 每轮消息处理预算
+
+    // Acknowledgement 流控
+    uint32_t peer_ack_window_ = 0;           ///< 对端设置的确认窗口，0 表示沿用本端窗口
+    uint64_t last_ack_bytes_ = 0;            ///< 上次发送 Acknowledgement 时的接收字节数
+    std::atomic<uint32_t> acked_sequence_{0};///< 对端最近确认的序号（已接收字节数的低 32 位）
+    std::atomic_bool ack_received_{false};   ///< 是否收到过对端的 Acknowledgement
+    uint32_t max_unacked_bytes_ = 0;         ///< 未确认字节上限，0 表示不限制
+
+    RtmpMediaQueue media_queue_;             ///< 观看者媒体队列，积压时按帧类型丢帧
+    bool use_media_queue_ = false;           ///< 是否经由媒体队列发送
+    uint32_t queue_watermark_ = 0;           ///< TCP 发送队列低于该字节数时从媒体队列补充
 
     // AVC/AAC 序列头缓存
     std::shared_ptr<char> avc_sequence_header_; ///< 视频序列头
     std::shared_ptr<char> aac_sequence_header_; ///< 音频序列头
-    uint32_t avc_sequence_header_size_;         ///< 视频序列头长度
-    uint32_t aac_sequence_header_szie_;         ///< 音频序列头长度
+    uint32_t avc_sequence_header_size_ = 0;     ///< 视频序列头长度
+    uint32_t aac_sequence_header_szie_ = 0;     ///< 音频序列头长度
 };
\ No newline at end of file
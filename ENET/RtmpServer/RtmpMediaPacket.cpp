@@ -0,0 +1,375 @@
+/**
+ * @file RtmpMediaPacket.cpp
+ * @brief 实现 RtmpMediaPacket 的按组懒分片与缓存。
+ *
+ * 分组与 FLV tag 生成后以 release 语义发布到原子槽位，之后只读；
+ * 多个线程同时未命中同一分组时各自生成一次，CAS 失败的一方释放自己的结果，改用已发布的一份。
+ */
+
+#include "RtmpMediaPacket.h"
+#include "RtmpChunk.h"
+#include "rtmp.h"
+#include "amf.h"
+#include <cstdio>
+
+std::atomic<uint64_t> RtmpMediaPacket::bytes_serialized_(0);
+
+/**
+ * @brief 构造函数，仅保存负载引用，不做拷贝
+ */
+RtmpMediaPacket::RtmpMediaPacket(uint8_t type, uint64_t timestamp, std::shared_ptr<char> payload, uint32_t size)
+    :type_(type)
+    ,timestamp_(timestamp)
+    ,payload_(payload)
+    ,size_(size)
+{
+    for(auto &group : groups_)
+    {
+        group.store(nullptr, std::memory_order_relaxed);
+    }
+    for(auto &tag : flv_tags_)
+    {
+        tag.store(nullptr, std::memory_order_relaxed);
+    }
+}
+
+/**
+ * @brief 析构函数，最后一个引用释放时不再有并发访问
+ */
+RtmpMediaPacket::~RtmpMediaPacket()
+{
+    for(auto &group : groups_)
+    {
+        delete group.load(std::memory_order_relaxed);
+    }
+    for(auto &tag : flv_tags_)
+    {
+        delete tag.load(std::memory_order_relaxed);
+    }
+}
+
+/**
+ * @brief 判断是否为 H264 关键帧，frame_type 为 1 且编码 ID 为 H264
+ * @return true 表示关键帧
+ */
+bool RtmpMediaPacket::IsKeyFrame() const
+{
+    if(type_ != RTMP_VIDEO || size_ == 0)
+    {
+        return false;
+    }
+    uint8_t frame_type = (payload_.get()[0] >> 4) & 0x0f;
+    uint8_t codec_id = payload_.get()[0] & 0x0f;
+    return (frame_type == 1 && codec_id == RTMP_CODEC_ID_H264);
+}
+
+/**
+ * @brief 以 fmt0 分片，不依赖发送状态
+ * @param chunk_size 观看者的 out chunk size
+ * @param stream_id 观看者的消息流 ID
+ * @param chunks_size 输出分片后的字节数
+ * @return 分片后的缓冲区，失败返回 nullptr
+ */
+std::shared_ptr<char> RtmpMediaPacket::GetChunks(uint32_t chunk_size, uint32_t stream_id, uint32_t& chunks_size)
+{
+    RtmpMessage rtmp_msg;
+    uint32_t csid = 0;
+    if(!GetMessage(stream_id, rtmp_msg, csid))
+    {
+        return nullptr;
+    }
+    return GetGroupChunks(rtmp_msg, csid, chunk_size, 0, 0, chunks_size);
+}
+
+/**
+ * @brief 按连接的发送状态选择最小的 chunk 头部，再查找或生成对应的分片结果
+ *
+ * 同组观看者上一条消息相同，选出的头部也相同，仍共享同一块缓冲区；
+ * 新加入或丢过帧的观看者头部不同，另成一组，分组过多时退回 fmt0
+ * @param chunk 观看者的 chunk 状态，调用者需保证与入队顺序一致
+ * @param stream_id 观看者的消息流 ID
+ * @param chunks_size 输出分片后的字节数
+ * @return 分片后的缓冲区，失败返回 nullptr
+ */
+std::shared_ptr<char> RtmpMediaPacket::GetChunks(RtmpChunk& chunk, uint32_t stream_id, uint32_t& chunks_size)
+{
+    RtmpMessage rtmp_msg;
+    uint32_t csid = 0;
+    if(!GetMessage(stream_id, rtmp_msg, csid))
+    {
+        return nullptr;
+    }
+
+    RtmpChunkHeader& prev = chunk.GetOutHeader(csid);
+    uint32_t delta = 0;
+    uint8_t fmt = RtmpChunk::SelectFormat(prev, rtmp_msg, delta);
+    std::shared_ptr<char> chunks = GetGroupChunks(rtmp_msg, csid, chunk.GetOutChunkSize(), fmt, delta, chunks_size);
+    if(!chunks && fmt != 0)
+    {
+        fmt = 0;
+        delta = 0;
+        chunks = GetGroupChunks(rtmp_msg, csid, chunk.GetOutChunkSize(), 0, 0, chunks_size);
+    }
+    if(chunks)
+    {
+        RtmpChunk::UpdateHeader(prev, rtmp_msg, fmt, delta);
+        chunk.AddHeaderBytesSaved(fmt);
+    }
+    return chunks;
+}
+
+/**
+ * @brief 构造分片用的消息头，序列头按普通音视频消息发送
+ */
+bool RtmpMediaPacket::GetMessage(uint32_t stream_id, RtmpMessage& rtmp_msg, uint32_t& csid) const
+{
+    if(type_ == RTMP_VIDEO || type_ == RTMP_AVC_SEQUENCE_HEADER)
+    {
+        rtmp_msg.type_id = RTMP_VIDEO;
+        csid = RTMP_CHUNK_VIDEO_ID;
+    }
+    else if(type_ == RTMP_AUDIO || type_ == RTMP_AAC_SEQUENCE_HEADER)
+    {
+        rtmp_msg.type_id = RTMP_AUDIO;
+        csid = RTMP_CHUNK_AUDIO_ID;
+    }
+    else if(type_ == RTMP_NOTIFY)
+    {
+        rtmp_msg.type_id = RTMP_NOTIFY;
+        csid = RTMP_CHUNK_DATA_ID;
+    }
+    else if(type_ == RTMP_AGGREGATE)
+    {
+        rtmp_msg.type_id = RTMP_AGGREGATE;
+        csid = RTMP_CHUNK_VIDEO_ID;
+    }
+    else
+    {
+        return false;
+    }
+    rtmp_msg._timestamp = timestamp_;
+    rtmp_msg.stream_id = stream_id;
+    rtmp_msg.playload = payload_;
+    rtmp_msg.lenght = size_;
+    return true;
+}
+
+/**
+ * @brief 查找 (chunk_size, stream_id, fmt, delta) 分组，未命中时分片一次并发布到第一个空槽位
+ *
+ * fmt0 与 fmt3 的字节与 delta 无关，按 delta 为 0 分组；槽位只增不减，按顺序扫描即可，
+ * 已发布的槽位不会再变化。槽位用完时 fmt0 的结果不缓存直接返回
+ * @return 分片后的缓冲区；压缩头部的分组已达上限或分片失败时返回 nullptr
+ */
+std::shared_ptr<char> RtmpMediaPacket::GetGroupChunks(const RtmpMessage& rtmp_msg, uint32_t csid, uint32_t chunk_size,
+                                                      uint8_t fmt, uint32_t delta, uint32_t& chunks_size)
+{
+    if(fmt == 0 || fmt == 3)
+    {
+        delta = 0;
+    }
+
+    size_t slot = 0;
+    for(; slot < kMaxChunkGroups; slot++)
+    {
+        ChunkGroup* group = groups_[slot].load(std::memory_order_acquire);
+        if(!group)
+        {
+            break;
+        }
+        if(group->chunk_size == chunk_size && group->stream_id == rtmp_msg.stream_id
+        && group->fmt == fmt && group->delta == delta)
+        {
+            chunks_size = group->size;
+            return group->data;
+        }
+    }
+    if(fmt != 0 && slot >= kMaxChunkGroups)
+    {
+        return nullptr;
+    }
+
+    uint32_t capacity = RtmpChunk::GetChunkCapacity(size_, chunk_size);
+    std::shared_ptr<char> buffer(new char[capacity], std::default_delete<char[]>());
+    int size = RtmpChunk::CreateChunk(csid, rtmp_msg, chunk_size, fmt, delta, buffer.get(), capacity);
+    if(size <= 0)
+    {
+        return nullptr;
+    }
+    bytes_serialized_ += size;
+    chunks_size = (uint32_t)size;
+
+    ChunkGroup* group = new ChunkGroup{ chunk_size, rtmp_msg.stream_id, fmt, delta, buffer, (uint32_t)size };
+    for(; slot < kMaxChunkGroups; slot++)
+    {
+        ChunkGroup* expected = nullptr;
+        if(groups_[slot].compare_exchange_strong(expected, group, std::memory_order_acq_rel, std::memory_order_acquire))
+        {
+            return buffer;
+        }
+        // 其他线程先占用了该槽位，若正是同一分组则改用对方的结果
+        if(expected->chunk_size == chunk_size && expected->stream_id == rtmp_msg.stream_id
+        && expected->fmt == fmt && expected->delta == delta)
+        {
+            delete group;
+            chunks_size = expected->size;
+            return expected->data;
+        }
+    }
+    delete group;
+    return fmt == 0 ? buffer : nullptr;
+}
+
+/**
+ * @brief 获取 FLV tag，所有 HTTP-FLV 观看者共享同一份
+ * @param chunked 是否按 HTTP chunked 编码包装
+ * @param tag_size 输出 tag 字节数
+ * @return tag 缓冲区，失败返回 nullptr
+ */
+std::shared_ptr<char> RtmpMediaPacket::GetFlvTag(bool chunked, uint32_t& tag_size)
+{
+    int index = chunked ? 1 : 0;
+    FlvTag* tag = flv_tags_[index].load(std::memory_order_acquire);
+    if(!tag)
+    {
+        // 序列头按普通音视频 tag 发送
+        uint8_t tag_type = 0;
+        if(type_ == RTMP_VIDEO || type_ == RTMP_AVC_SEQUENCE_HEADER)
+        {
+            tag_type = RTMP_VIDEO;
+        }
+        else if(type_ == RTMP_AUDIO || type_ == RTMP_AAC_SEQUENCE_HEADER)
+        {
+            tag_type = RTMP_AUDIO;
+        }
+        else if(type_ == RTMP_NOTIFY)
+        {
+            tag_type = RTMP_NOTIFY;
+        }
+        else
+        {
+            return nullptr;
+        }
+        FlvTag* created = new FlvTag;
+        created->data = CreateFlvTag(tag_type, timestamp_, payload_.get(), size_, chunked, created->size);
+        bytes_serialized_ += created->size;
+        FlvTag* expected = nullptr;
+        if(flv_tags_[index].compare_exchange_strong(expected, created, std::memory_order_acq_rel, std::memory_order_acquire))
+        {
+            tag = created;
+        }
+        else
+        {
+            delete created;                               // 其他线程已发布同一个 tag
+            tag = expected;
+        }
+    }
+    tag_size = tag->size;
+    return tag->data;
+}
+
+/**
+ * @brief 从数据消息中取出元数据，只读取消息名，元数据字节原样共享
+ * @param payload 数据消息负载
+ * @param size 负载长度（字节）
+ * @return 元数据消息，不是元数据时返回 nullptr
+ */
+RtmpMediaPacket::Ptr RtmpMediaPacket::CreateMetaData(std::shared_ptr<char> payload, uint32_t size)
+{
+    AmfReader reader(payload.get(), size);
+    AmfStringView name;
+    uint32_t offset = 0;
+    if(!reader.readString(name))
+    {
+        return nullptr;
+    }
+    if(name == "@setDataFrame")
+    {
+        offset = reader.position();
+        if(!reader.readString(name))
+        {
+            return nullptr;
+        }
+    }
+    if(name != "onMetaData" || reader.remaining() == 0)
+    {
+        return nullptr;
+    }
+
+    // 别名构造：与原负载共用引用计数，指向 onMetaData 起始位置
+    std::shared_ptr<char> meta_data(payload, payload.get() + offset);
+    return std::make_shared<RtmpMediaPacket>(RTMP_NOTIFY, 0, meta_data, size - offset);
+}
+
+/**
+ * @brief 按顺序写入各子消息的 FLV tag，负载只拷贝这一次，之后所有观看者共享
+ * @param packets 音视频消息
+ * @return 聚合消息，packets 为空时返回 nullptr
+ */
+RtmpMediaPacket::Ptr RtmpMediaPacket::CreateAggregate(const std::vector<Ptr>& packets)
+{
+    if(packets.empty())
+    {
+        return nullptr;
+    }
+
+    uint32_t size = 0;
+    for(auto &packet : packets)
+    {
+        size += 11 + packet->GetSize() + 4;
+    }
+    std::shared_ptr<char> payload(new char[size], std::default_delete<char[]>());
+    char* p = payload.get();
+    for(auto &packet : packets)
+    {
+        uint64_t timestamp = packet->GetTimestamp();
+        uint32_t data_size = packet->GetSize();
+        p[0] = packet->GetType();
+        WriteUint24BE(p + 1, data_size);
+        WriteUint24BE(p + 4, (uint32_t)timestamp & 0xFFFFFF);  // 低 24 位
+        p[7] = (char)((timestamp >> 24) & 0xFF);               // 扩展的高 8 位
+        WriteUint24BE(p + 8, 0);                               // StreamID 恒为 0
+        memcpy(p + 11, packet->GetPayload().get(), data_size);
+        WriteUint32BE(p + 11 + data_size, 11 + data_size);
+        p += 11 + data_size + 4;
+    }
+    bytes_serialized_ += size;
+
+    auto aggregate = std::make_shared<RtmpMediaPacket>(RTMP_AGGREGATE, packets.front()->GetTimestamp(), payload, size);
+    aggregate->frames_ = (uint32_t)packets.size();
+    return aggregate;
+}
+
+/**
+ * @brief 构造 FLV tag: 11 字节 tag 头 + 数据 + 4 字节 PreviousTagSize
+ *
+ * chunked 编码时在前后加上 "<十六进制长度>\r\n" 与 "\r\n"，整段可直接写入 socket
+ */
+std::shared_ptr<char> RtmpMediaPacket::CreateFlvTag(uint8_t tag_type, uint64_t timestamp, const char* data, uint32_t size,
+                                                    bool chunked, uint32_t& tag_size)
+{
+    uint32_t body_size = 11 + size + 4;
+    char prefix[16] = {0};
+    int prefix_size = chunked ? snprintf(prefix, sizeof(prefix), "%X\r\n", body_size) : 0;
+    tag_size = prefix_size + body_size + (chunked ? 2 : 0);
+
+    std::shared_ptr<char> tag(new char[tag_size], std::default_delete<char[]>());
+    char* p = tag.get();
+    memcpy(p, prefix, prefix_size);
+    p += prefix_size;
+
+    p[0] = tag_type;
+    WriteUint24BE(p + 1, size);
+    WriteUint24BE(p + 4, (uint32_t)timestamp & 0xFFFFFF);  // 低 24 位
+    p[7] = (char)((timestamp >> 24) & 0xFF);               // 扩展的高 8 位
+    WriteUint24BE(p + 8, 0);                               // StreamID 恒为 0
+    memcpy(p + 11, data, size);
+    WriteUint32BE(p + 11 + size, 11 + size);
+    p += body_size;
+
+    if(chunked)
+    {
+        memcpy(p, "\r\n", 2);
+    }
+    return tag;
+}
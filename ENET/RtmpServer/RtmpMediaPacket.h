@@ -0,0 +1,181 @@
+/**
+ * @file RtmpMediaPacket.h
+ * @brief 定义会话内共享的媒体消息 RtmpMediaPacket。
+ *
+ * 推流端的一帧音视频在会话内只封装一次，按观看者的 (out chunk size, stream id) 分组
+ * 懒生成 chunk 字节流并缓存，同组观看者的发送队列共享同一块引用计数缓冲区；
+ * 分组缓存是固定数量的原子槽位，生成后以 CAS 发布、不再修改，观看者查找时不加锁；
+ * 首个 chunk 按观看者的发送状态使用 fmt0~3 头部，上一条消息相同的观看者仍落在同一组；
+ * HTTP-FLV 观看者同样共享懒生成的 FLV tag。
+ * 元数据（onMetaData）同样以 RTMP_NOTIFY 类型的消息在会话内只封装一次，
+ * 聚合消息（RTMP_AGGREGATE）在会话的聚合窗口结束时构造一次。
+ */
+
+#ifndef _RTMPMEDIAPACKET_H_
+#define _RTMPMEDIAPACKET_H_
+#include "../EdoyunNet/BufferPool.h"
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+class RtmpChunk;
+struct RtmpMessage;
+
+/**
+ * @class RtmpMediaPacket
+ * @brief 一条待分发的音视频消息及其已分片的 chunk 缓存
+ */
+class RtmpMediaPacket
+{
+public:
+    using Ptr = std::shared_ptr<RtmpMediaPacket>;
+
+    /**
+     * @brief 构造函数
+     * @param type RTMP 媒体类型（RTMP_AUDIO/RTMP_VIDEO/Sequence Header），元数据为 RTMP_NOTIFY，聚合消息为 RTMP_AGGREGATE
+     * @param timestamp 时间戳（毫秒）
+     * @param payload 消息负载，多个观看者共享，不得再修改
+     * @param size 负载长度（字节）
+     */
+    RtmpMediaPacket(uint8_t type, uint64_t timestamp, std::shared_ptr<char> payload, uint32_t size);
+
+    /**
+     * @brief 析构函数，释放已发布的分组与 FLV tag
+     */
+    ~RtmpMediaPacket();
+
+    RtmpMediaPacket(const RtmpMediaPacket&) = delete;
+    RtmpMediaPacket& operator=(const RtmpMediaPacket&) = delete;
+
+    uint8_t GetType() const { return type_; }
+    uint64_t GetTimestamp() const { return timestamp_; }
+    std::shared_ptr<char> GetPayload() const { return payload_; }
+    uint32_t GetSize() const { return size_; }
+
+    /**
+     * @brief 负载占用的内存：推流端的负载由 BufferPool 按分级分配，缓存上限按块大小计
+     * @return 负载所在块的字节数
+     */
+    uint32_t GetMemorySize() const { return BufferPool::GetBlockSize(size_); }
+
+    /**
+     * @brief 判断是否为 H264 关键帧（不含 AVC Sequence Header）
+     * @return true 表示关键帧
+     */
+    bool IsKeyFrame() const;
+
+    /**
+     * @brief 获取按指定 chunk 大小和消息流 ID 分片后的字节流（首个 chunk 为 fmt0），首次调用时生成并缓存
+     * @param chunk_size 观看者的 out chunk size
+     * @param stream_id 观看者的消息流 ID
+     * @param chunks_size 输出分片后的字节数
+     * @return 分片后的缓冲区，失败返回 nullptr
+     */
+    std::shared_ptr<char> GetChunks(uint32_t chunk_size, uint32_t stream_id, uint32_t& chunks_size);
+
+    /**
+     * @brief 按观看者的发送状态选择最小的 chunk 头部（fmt0~3）后获取分片结果，并更新发送状态
+     * @param chunk 观看者的 chunk 状态，提供 out chunk size 与各 csid 最近一条消息的头部
+     * @param stream_id 观看者的消息流 ID
+     * @param chunks_size 输出分片后的字节数
+     * @return 分片后的缓冲区，失败返回 nullptr
+     */
+    std::shared_ptr<char> GetChunks(RtmpChunk& chunk, uint32_t stream_id, uint32_t& chunks_size);
+
+    /**
+     * @brief 获取 FLV tag（含 PreviousTagSize），首次调用时生成并缓存
+     * @param chunked 是否按 HTTP chunked 编码包装
+     * @param tag_size 输出 tag 字节数
+     * @return tag 缓冲区，失败返回 nullptr
+     */
+    std::shared_ptr<char> GetFlvTag(bool chunked, uint32_t& tag_size);
+
+    /**
+     * @brief 构造一个 FLV tag（含 PreviousTagSize）
+     * @param tag_type FLV tag 类型（8 音频 / 9 视频 / 18 脚本数据）
+     * @param timestamp 时间戳（毫秒）
+     * @param data tag 数据
+     * @param size 数据长度（字节）
+     * @param chunked 是否按 HTTP chunked 编码包装
+     * @param tag_size 输出 tag 字节数
+     * @return tag 缓冲区
+     */
+    static std::shared_ptr<char> CreateFlvTag(uint8_t tag_type, uint64_t timestamp, const char* data, uint32_t size,
+                                              bool chunked, uint32_t& tag_size);
+
+    /**
+     * @brief 从推流端的数据消息中取出元数据，封装为会话内共享的 RTMP_NOTIFY 消息
+     *
+     * 接受 "@setDataFrame" + "onMetaData" + ECMA 数组与 "onMetaData" + ECMA 数组两种格式，
+     * 只校验消息名，不解码元数据内容；新消息与原负载共享缓冲区，跳过 @setDataFrame 前缀
+     * @param payload 数据消息负载，必须持有引用计数（不能是引用接收缓冲区的别名指针）
+     * @param size 负载长度（字节）
+     * @return 元数据消息，不是元数据时返回 nullptr
+     */
+    static Ptr CreateMetaData(std::shared_ptr<char> payload, uint32_t size);
+
+    /**
+     * @brief 把一组音视频消息打包为一条聚合消息（RTMP_AGGREGATE），会话内只构造一次
+     *
+     * 负载为连续的 FLV tag（11 字节 tag 头 + 数据 + 4 字节 PreviousTagSize），
+     * 子消息保留各自的绝对时间戳，聚合消息的时间戳取第一个子消息的时间戳
+     * @param packets 按发送顺序排列的音视频消息，不含序列头
+     * @return 聚合消息，packets 为空时返回 nullptr
+     */
+    static Ptr CreateAggregate(const std::vector<Ptr>& packets);
+
+    /**
+     * @brief 聚合消息包含的子消息数，普通消息为 1
+     */
+    uint32_t GetFrames() const { return frames_; }
+
+    /**
+     * @brief 获取进程内累计的分片拷贝字节数，用于统计与压测
+     * @return 字节数
+     */
+    static uint64_t GetBytesSerialized() { return bytes_serialized_.load(); }
+
+private:
+    /** 每条消息缓存的分片结果上限，超出后压缩头部的请求退回 fmt0 */
+    static const size_t kMaxChunkGroups = 8;
+
+    /**
+     * @brief 同一 (chunk_size, stream_id, fmt, delta) 分组的分片结果，发布后只读
+     */
+    struct ChunkGroup
+    {
+        uint32_t chunk_size;
+        uint32_t stream_id;
+        uint8_t fmt;                    ///< 首个 chunk 的头部格式
+        uint32_t delta;                 ///< fmt1/2 的时间增量
+        std::shared_ptr<char> data;
+        uint32_t size;
+    };
+
+    /**
+     * @brief 生成后的 FLV tag，发布后只读
+     */
+    struct FlvTag
+    {
+        std::shared_ptr<char> data;
+        uint32_t size;
+    };
+
+    bool GetMessage(uint32_t stream_id, RtmpMessage& rtmp_msg, uint32_t& csid) const;
+    std::shared_ptr<char> GetGroupChunks(const RtmpMessage& rtmp_msg, uint32_t csid, uint32_t chunk_size,
+                                         uint8_t fmt, uint32_t delta, uint32_t& chunks_size);
+
+    uint8_t type_ = 0;                  ///< 媒体类型
+    uint64_t timestamp_ = 0;            ///< 时间戳（毫秒）
+    std::shared_ptr<char> payload_;     ///< 原始负载
+    uint32_t size_ = 0;                 ///< 负载长度
+    uint32_t frames_ = 1;               ///< 包含的音视频帧数
+
+    std::atomic<ChunkGroup*> groups_[kMaxChunkGroups]; ///< 已生成的分片，按槽位顺序 CAS 发布，分组数通常为 1~2
+    std::atomic<FlvTag*> flv_tags_[2];  ///< 已生成的 FLV tag，下标 1 为 chunked 编码
+
+    static std::atomic<uint64_t> bytes_serialized_; ///< 累计分片拷贝字节数
+};
+
+#endif
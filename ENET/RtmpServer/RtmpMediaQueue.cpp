@@ -0,0 +1,265 @@
+/**
+ * @file RtmpMediaQueue.cpp
+ * @brief 实现观看者媒体队列的积压计算与按帧类型丢帧策略。
+ */
+
+#include "RtmpMediaQueue.h"
+#include "rtmp.h"
+
+/**
+ * @brief 判断是否为可丢弃的视频帧（FLV frame_type 为 3，不被其他帧参考）
+ */
+static bool IsDisposableFrame(const RtmpMediaPacket::Ptr& packet)
+{
+    if(packet->GetType() != RTMP_VIDEO || packet->GetSize() == 0)
+    {
+        return false;
+    }
+    uint8_t frame_type = (packet->GetPayload().get()[0] >> 4) & 0x0f;
+    return frame_type == 3;
+}
+
+/**
+ * @brief 判断是否为普通视频帧（序列头、音频之外）
+ *
+ * 聚合消息不跨关键帧，按普通视频帧参与丢帧，其中的音频随之丢弃
+ */
+static bool IsVideoFrame(const RtmpMediaPacket::Ptr& packet)
+{
+    return packet->GetType() == RTMP_VIDEO || packet->GetType() == RTMP_AGGREGATE;
+}
+
+RtmpMediaQueue::RtmpMediaQueue(uint32_t drop_disposable_ms, uint32_t drop_gop_ms, uint32_t max_ms)
+{
+    SetThresholds(drop_disposable_ms, drop_gop_ms, max_ms);
+}
+
+void RtmpMediaQueue::SetThresholds(uint32_t drop_disposable_ms, uint32_t drop_gop_ms, uint32_t max_ms)
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    drop_disposable_ms_ = drop_disposable_ms;
+    drop_gop_ms_ = drop_gop_ms;
+    max_ms_ = max_ms;
+}
+
+/**
+ * @brief 入队并执行丢帧策略
+ *
+ * 1. 正在等待关键帧时丢弃非关键视频帧
+ * 2. 积压超过 drop_disposable_ms_ 时丢弃新到的可丢弃帧
+ * 3. 积压超过 drop_gop_ms_ 时跳到最新关键帧（或等待下一个关键帧）
+ * 4. 积压仍超过 max_ms_ 时从队头丢弃，包括音频
+ * @param packet 媒体消息
+ * @return true 表示已入队
+ */
+bool RtmpMediaQueue::Push(RtmpMediaPacket::Ptr packet)
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    if(IsVideoFrame(packet))
+    {
+        if(packet->IsKeyFrame())
+        {
+            wait_key_frame_ = false;
+        }
+        else if(wait_key_frame_)
+        {
+            CountDrop(packet);
+            return false;
+        }
+        else if(drop_disposable_ms_ > 0 && IsDisposableFrame(packet) && GetDuration() > drop_disposable_ms_)
+        {
+            CountDrop(packet);
+            return false;
+        }
+    }
+
+    queue_.push_back(packet);
+    bytes_ += packet->GetSize();
+
+    if(drop_gop_ms_ > 0 && GetDuration() > drop_gop_ms_)
+    {
+        SkipToKeyFrame();
+    }
+    if(max_ms_ > 0 && GetDuration() > max_ms_)
+    {
+        DropOldest();
+    }
+    return true;
+}
+
+RtmpMediaPacket::Ptr RtmpMediaQueue::Pop()
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    if(queue_.empty())
+    {
+        return nullptr;
+    }
+    RtmpMediaPacket::Ptr packet = queue_.front();
+    queue_.pop_front();
+    bytes_ -= packet->GetSize();
+    return packet;
+}
+
+bool RtmpMediaQueue::IsEmpty()
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    return queue_.empty();
+}
+
+void RtmpMediaQueue::Drain(const std::function<bool()>& can_send, const std::function<void(RtmpMediaPacket::Ptr)>& send)
+{
+    do
+    {
+        if(draining_.exchange(true))
+        {
+            return;
+        }
+        while(can_send())
+        {
+            RtmpMediaPacket::Ptr packet = Pop();
+            if(!packet)
+            {
+                break;
+            }
+            send(packet);
+        }
+        draining_ = false;
+    } while(!IsEmpty() && can_send());
+}
+
+void RtmpMediaQueue::Clear()
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    queue_.clear();
+    bytes_ = 0;
+    wait_key_frame_ = false;
+}
+
+RtmpMediaQueue::Stats RtmpMediaQueue::GetStats()
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    Stats stats = stats_;
+    stats.lag_ms = GetDuration();
+    stats.packets = (uint32_t)queue_.size();
+    stats.bytes = bytes_;
+    return stats;
+}
+
+/**
+ * @brief 以队头与队尾消息的时间戳差作为积压时长
+ */
+uint32_t RtmpMediaQueue::GetDuration() const
+{
+    if(queue_.size() < 2)
+    {
+        return 0;
+    }
+    uint64_t first = queue_.front()->GetTimestamp();
+    uint64_t last = queue_.back()->GetTimestamp();
+    return last > first ? (uint32_t)(last - first) : 0;
+}
+
+/**
+ * @brief 丢弃最新关键帧之前的视频帧，音频与序列头保留
+ *
+ * 队列中没有关键帧时丢弃全部普通视频帧，并在下一个关键帧到达前继续丢弃
+ */
+void RtmpMediaQueue::SkipToKeyFrame()
+{
+    int key_index = -1;
+    for(int i = (int)queue_.size() - 1; i >= 0; i--)
+    {
+        if(queue_[i]->IsKeyFrame())
+        {
+            key_index = i;
+            break;
+        }
+    }
+    if(key_index == 0)
+    {
+        return;     // 队头已是最新 GOP，没有可跳过的视频
+    }
+
+    std::deque<RtmpMediaPacket::Ptr> kept;
+    int end = key_index < 0 ? (int)queue_.size() : key_index;
+    bool dropped = false;
+    for(int i = 0; i < (int)queue_.size(); i++)
+    {
+        if(i < end && IsVideoFrame(queue_[i]))
+        {
+            bytes_ -= queue_[i]->GetSize();
+            CountDrop(queue_[i]);
+            dropped = true;
+        }
+        else
+        {
+            kept.push_back(queue_[i]);
+        }
+    }
+    queue_.swap(kept);
+    if(key_index < 0)
+    {
+        wait_key_frame_ = true;
+    }
+    if(dropped)
+    {
+        stats_.gop_skips++;
+    }
+}
+
+/**
+ * @brief 超过硬上限时从队头丢弃，序列头保留以便解码器继续工作
+ */
+void RtmpMediaQueue::DropOldest()
+{
+    bool dropped_video = false;
+    for(auto iter = queue_.begin(); iter != queue_.end() && GetDuration() > max_ms_; )
+    {
+        uint8_t type = (*iter)->GetType();
+        if(type == RTMP_AVC_SEQUENCE_HEADER || type == RTMP_AAC_SEQUENCE_HEADER)
+        {
+            ++iter;
+            continue;
+        }
+        dropped_video = dropped_video || (type == RTMP_VIDEO);
+        bytes_ -= (*iter)->GetSize();
+        CountDrop(*iter);
+        iter = queue_.erase(iter);
+    }
+
+    // 丢掉了视频的开头，剩余视频帧无法解码，跳到下一个关键帧
+    if(dropped_video)
+    {
+        for(auto iter = queue_.begin(); iter != queue_.end(); )
+        {
+            if((*iter)->IsKeyFrame())
+            {
+                return;
+            }
+            if(IsVideoFrame(*iter))
+            {
+                bytes_ -= (*iter)->GetSize();
+                CountDrop(*iter);
+                iter = queue_.erase(iter);
+            }
+            else
+            {
+                ++iter;
+            }
+        }
+        wait_key_frame_ = true;
+    }
+}
+
+void RtmpMediaQueue::CountDrop(const RtmpMediaPacket::Ptr& packet)
+{
+    if(packet->GetType() == RTMP_AUDIO)
+    {
+        stats_.dropped_audio++;
+    }
+    else
+    {
+        stats_.dropped_video += packet->GetFrames();
+    }
+    stats_.dropped_bytes += packet->GetSize();
+}
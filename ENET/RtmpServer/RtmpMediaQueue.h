@@ -0,0 +1,123 @@
+/**
+ * @file RtmpMediaQueue.h
+ * @brief 定义观看者的有界媒体队列 RtmpMediaQueue。
+ *
+ * 位于会话分发与 TCP 发送队列之间，按媒体时长（毫秒）衡量积压，
+ * 积压时按帧类型丢弃：先丢可丢弃帧，再整体跳到下一个关键帧，音频始终保持连续。
+ */
+
+#ifndef _RTMPMEDIAQUEUE_H_
+#define _RTMPMEDIAQUEUE_H_
+#include <atomic>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include "RtmpMediaPacket.h"
+
+/**
+ * @class RtmpMediaQueue
+ * @brief 单个观看者的待发送媒体消息队列，线程安全
+ */
+class RtmpMediaQueue
+{
+public:
+    /**
+     * @brief 队列统计信息
+     */
+    struct Stats
+    {
+        uint32_t lag_ms = 0;            ///< 队列中媒体的时长（毫秒）
+        uint32_t packets = 0;           ///< 队列中的消息数
+        uint64_t bytes = 0;             ///< 队列中的负载字节数
+        uint64_t dropped_video = 0;     ///< 累计丢弃的视频帧数
+        uint64_t dropped_audio = 0;     ///< 累计丢弃的音频帧数（仅在超过硬上限时）
+        uint64_t dropped_bytes = 0;     ///< 累计丢弃的字节数
+        uint64_t gop_skips = 0;         ///< 累计跳到下一个关键帧的次数
+    };
+
+    /**
+     * @brief 构造函数
+     * @param drop_disposable_ms 积压超过该值时丢弃可丢弃帧
+     * @param drop_gop_ms 积压超过该值时丢弃视频直到下一个关键帧
+     * @param max_ms 积压硬上限，超过时连音频一起从队头丢弃
+     */
+    RtmpMediaQueue(uint32_t drop_disposable_ms = 1000, uint32_t drop_gop_ms = 3000, uint32_t max_ms = 10000);
+
+    /**
+     * @brief 设置丢帧阈值（媒体时长，毫秒）
+     */
+    void SetThresholds(uint32_t drop_disposable_ms, uint32_t drop_gop_ms, uint32_t max_ms);
+
+    /**
+     * @brief 入队并按当前积压执行丢帧策略
+     * @param packet 媒体消息
+     * @return true 表示已入队，false 表示该消息被丢弃
+     */
+    bool Push(RtmpMediaPacket::Ptr packet);
+
+    /**
+     * @brief 取出队头消息
+     * @return 队头消息，队列为空时返回 nullptr
+     */
+    RtmpMediaPacket::Ptr Pop();
+
+    /**
+     * @brief 判断队列是否为空
+     */
+    bool IsEmpty();
+
+    /**
+     * @brief can_send 为 true 时依次取出队头消息交给 send，直到队列为空
+     *
+     * 会在推流线程（新消息入队）和连接所属线程（写队列回调等）上调用，同一时刻只有一个线程补充；
+     * 退出前再检查一次，避免另一线程入队的消息错过补充
+     * @param can_send 连接是否可以继续发送（未关闭、发送队列低于水位等）
+     * @param send 发送一条消息
+     */
+    void Drain(const std::function<bool()>& can_send, const std::function<void(RtmpMediaPacket::Ptr)>& send);
+
+    /**
+     * @brief 清空队列，统计计数保留
+     */
+    void Clear();
+
+    /**
+     * @brief 获取积压与丢帧统计
+     */
+    Stats GetStats();
+
+private:
+    /**
+     * @brief 计算队列中媒体的时长（调用者持有 mutex_）
+     */
+    uint32_t GetDuration() const;
+
+    /**
+     * @brief 丢弃队列中最新关键帧之前的所有视频帧；队列中没有关键帧时丢弃全部视频并等待下一个关键帧
+     */
+    void SkipToKeyFrame();
+
+    /**
+     * @brief 从队头丢弃消息直到时长不超过 max_ms_，序列头除外
+     */
+    void DropOldest();
+
+    /**
+     * @brief 记录一条被丢弃的消息
+     */
+    void CountDrop(const RtmpMediaPacket::Ptr& packet);
+
+    std::mutex mutex_;
+    std::deque<RtmpMediaPacket::Ptr> queue_;    ///< 待发送消息
+    uint64_t bytes_ = 0;                        ///< 队列中的负载字节数
+    bool wait_key_frame_ = false;               ///< 是否正在丢弃视频直到下一个关键帧
+    std::atomic_bool draining_{false};          ///< 是否有线程正在补充
+
+    uint32_t drop_disposable_ms_ = 1000;        ///< 丢弃可丢弃帧的阈值
+    uint32_t drop_gop_ms_ = 3000;               ///< 跳到下一个关键帧的阈值
+    uint32_t max_ms_ = 10000;                   ///< 积压硬上限
+
+    Stats stats_;                               ///< 累计丢帧统计
+};
+
+#endif
@@ -43,7 +43,7 @@ struct RtmpMessage
     uint64_t _timestamp = 0;
     uint8_t codeId = 0;
 
-    uint8_t csid = 0;
+    uint32_t csid = 0;
     uint32_t index = 0;
     std::shared_ptr<char> playload = nullptr;
 
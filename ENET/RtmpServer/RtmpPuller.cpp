@@ -0,0 +1,203 @@
+/**
+ * @file RtmpPuller.cpp
+ * @brief 实现 RtmpPuller：play 命令、断流/空闲检查与回源媒体写入本地会话。
+ */
+#include "RtmpPuller.h"
+#include "RtmpServer.h"
+#include "rtmp.h"
+
+/** 源站开始下发后，超过该时长（毫秒）未收到音视频视为断流 */
+static const int64_t kStallTimeoutMs = 10000;
+
+/**
+ * @brief 创建 socket 并发起非阻塞连接，加入会话后发送 C0C1
+ */
+RtmpPuller::Ptr RtmpPuller::Create(TaskScheduler* scheduler, const std::string& ip, uint16_t port, const std::string& stream_path,
+                                   std::shared_ptr<RtmpSession> session, uint32_t idle_grace_ms, const StopCallback& stop_cb)
+{
+    if(!IsValidStreamPath(stream_path))
+    {
+        return nullptr;
+    }
+    int sockfd = Connect(ip, port);
+    if(sockfd < 0)
+    {
+        return nullptr;
+    }
+
+    Ptr puller(new RtmpPuller(scheduler, sockfd, ip, port, stream_path, session, idle_grace_ms));
+    puller->stop_cb_ = stop_cb;
+    if(session)
+    {
+        session->AddSink(puller);                     // 先以发布者身份加入，重置旧的序列头与 GOP 缓存
+    }
+    puller->Start();
+    return puller;
+}
+
+/**
+ * @brief 私有构造
+ */
+RtmpPuller::RtmpPuller(TaskScheduler* scheduler, int socket, const std::string& ip, uint16_t port,
+                       const std::string& stream_path, std::shared_ptr<RtmpSession> session, uint32_t idle_grace_ms)
+    :RtmpClient(scheduler, socket, ip, port, stream_path, 128)
+    ,rtmp_session_(session)
+    ,idle_grace_ms_(idle_grace_ms)
+    ,id_(AllocInternalId())
+{
+}
+
+/**
+ * @brief 析构函数
+ */
+RtmpPuller::~RtmpPuller()
+{
+}
+
+/**
+ * @brief 定时检查：握手/命令超时、源站断流、本地观看者空闲超过宽限期时断开
+ */
+bool RtmpPuller::IsExpired(int64_t now)
+{
+    bool expired = false;
+    if(state_ != STARTED)
+    {
+        expired = RtmpClient::IsExpired(now);
+    }
+    else
+    {
+        expired = now - last_media_time_ >= kStallTimeoutMs;
+    }
+
+    auto session = rtmp_session_.lock();
+    if(session && session->GetPlayers() > 0)
+    {
+        idle_since_ = 0;
+    }
+    else if(idle_since_ == 0)
+    {
+        idle_since_ = now;
+    }
+    else if(now - idle_since_ >= (int64_t)idle_grace_ms_)
+    {
+        expired = true;
+    }
+    return expired;
+}
+
+/**
+ * @brief 连接关闭：以发布者身份退出会话（清空序列头与 GOP 缓存），并通知 RtmpServer
+ */
+void RtmpPuller::OnClose()
+{
+    auto session = rtmp_session_.lock();
+    if(session)
+    {
+        session->RemoveSink(std::static_pointer_cast<RtmpPuller>(shared_from_this()));
+    }
+    if(stop_cb_)
+    {
+        stop_cb_(std::static_pointer_cast<RtmpPuller>(shared_from_this()));
+    }
+}
+
+/**
+ * @brief 在 createStream 返回的消息流上发送 play 命令
+ */
+void RtmpPuller::SendStreamCommand()
+{
+    AmfObjects objects;
+    amf_encoder_.reset();
+    amf_encoder_.encodeString("play", 4);
+    amf_encoder_.encodeNumber(0);
+    amf_encoder_.encodeObjects(objects);
+    amf_encoder_.encodeString(stream_name_.c_str(), (int)stream_name_.size());
+    amf_encoder_.encodeNumber(-1);                    // 只播放直播流
+    SendInvokeMessage(stream_id_, amf_encoder_.data(), amf_encoder_.size());
+}
+
+/**
+ * @brief NetStream.Play.Start 确认开始播放，错误或源站停播时断开
+ */
+bool RtmpPuller::OnStatus(const std::string& level, const std::string& code)
+{
+    if(level == "error" || code == "NetStream.Play.StreamNotFound" || code == "NetStream.Play.Stop")
+    {
+        printf("[RtmpPuller] %s%s %s\n", GetOrigin().c_str(), stream_path_.c_str(), code.c_str());
+        return false;
+    }
+    if(code == "NetStream.Play.Start" && state_ != STARTED)
+    {
+        SetStarted();
+        last_media_time_ = GetNowMs();
+    }
+    return true;
+}
+
+/**
+ * @brief 处理元数据：源站下发 onMetaData，推流端格式为 @setDataFrame + onMetaData
+ *
+ * 只校验消息名，元数据字节原样交给会话共享
+ */
+bool RtmpPuller::HandleNotify(RtmpMessage& rtmp_msg)
+{
+    RtmpMediaPacket::Ptr meta_data = RtmpMediaPacket::CreateMetaData(rtmp_msg.playload, rtmp_msg.lenght);
+    if(!meta_data)
+    {
+        return true;
+    }
+
+    auto session = rtmp_session_.lock();
+    if(session)
+    {
+        session->SendMetaData(meta_data);
+    }
+    return true;
+}
+
+/**
+ * @brief 音视频写入本地会话，识别序列头的方式与推流连接相同
+ *
+ * 音视频负载来自缓冲区池，可以直接交给会话长期持有，无需拷贝
+ */
+bool RtmpPuller::HandleMedia(RtmpMessage& rtmp_msg)
+{
+    auto session = rtmp_session_.lock();
+    if(!session || rtmp_msg.lenght < 2)
+    {
+        return true;
+    }
+    last_media_time_ = GetNowMs();
+
+    uint8_t* payload = (uint8_t*)rtmp_msg.playload.get();
+    uint8_t type = rtmp_msg.type_id;
+    if(type == RTMP_VIDEO)
+    {
+        uint8_t frame_type = (payload[0] >> 4) & 0x0f;
+        uint8_t codec_id = payload[0] & 0x0f;
+        if(frame_type == 1 && codec_id == RTMP_CODEC_ID_H264 && payload[1] == 0)
+        {
+            session->SetAvcSequenceHeader(rtmp_msg.playload, rtmp_msg.lenght);
+            type = RTMP_AVC_SEQUENCE_HEADER;
+        }
+        else
+        {
+            session->GetIngestStats().OnVideo(rtmp_msg._timestamp, rtmp_msg.lenght, frame_type == 1);
+        }
+    }
+    else
+    {
+        uint8_t sound_format = (payload[0] >> 4) & 0x0f;
+        if(sound_format == RTMP_CODEC_ID_AAC && payload[1] == 0)
+        {
+            session->SetAacSequenceHeader(rtmp_msg.playload, rtmp_msg.lenght);
+            type = RTMP_AAC_SEQUENCE_HEADER;
+        }
+        else
+        {
+            session->GetIngestStats().OnAudio(rtmp_msg._timestamp, rtmp_msg.lenght);
+        }
+    }
+    session->SendMediaData(type, rtmp_msg._timestamp, rtmp_msg.playload, rtmp_msg.lenght);
+    return true;
+}
@@ -0,0 +1,87 @@
+/**
+ * @file RtmpPuller.h
+ * @brief 边缘回源拉流：以 RTMP 客户端身份向源站 play，收到的音视频写入本地 RtmpSession。
+ *
+ * 主要职责：
+ *  - 连接、握手与 connect/createStream 由 RtmpClient 完成，之后发送 play
+ *  - 以发布者身份加入本地会话，由会话向本地观看者分发，一条流只回源一次
+ *  - 本地无观看者超过宽限期、握手超时或源站断流时断开，由 RtmpServer 决定是否重连
+ */
+
+#ifndef _RTMPPULLER_H_
+#define _RTMPPULLER_H_
+
+#include "RtmpClient.h"
+#include "RtmpSink.h"
+#include <functional>
+#include <string>
+
+class RtmpSession;
+
+/**
+ * @class RtmpPuller
+ * @brief 单条流的回源连接；IO 与定时检查都在所属调度线程执行
+ */
+class RtmpPuller : public RtmpClient, public RtmpSink
+{
+public:
+    using Ptr = std::shared_ptr<RtmpPuller>;
+    /** 连接关闭回调，在所属调度线程调用 */
+    using StopCallback = std::function<void(Ptr)>;
+
+    /**
+     * @brief 发起到源站的非阻塞连接并发送 C0C1
+     * @param scheduler 处理该连接 IO 的调度器
+     * @param ip 源站 IPv4 地址
+     * @param port 源站端口
+     * @param stream_path 流路径，格式 "/app/stream"
+     * @param session 收到的媒体写入的本地会话
+     * @param idle_grace_ms 本地无观看者持续超过该时长（毫秒）后断开
+     * @param stop_cb 连接关闭回调
+     * @return 回源连接，参数无效或 socket 创建失败时为 nullptr
+     */
+    static Ptr Create(TaskScheduler* scheduler, const std::string& ip, uint16_t port, const std::string& stream_path,
+                      std::shared_ptr<RtmpSession> session, uint32_t idle_grace_ms, const StopCallback& stop_cb);
+
+    /**
+     * @brief 析构函数
+     */
+    virtual ~RtmpPuller();
+
+    // --- RtmpSink 接口重写 ---
+    virtual bool SendMediaData(uint8_t type, uint64_t timestamp, std::shared_ptr<char> payload, uint32_t payload_size) override
+    { return true; }                                                     ///< 作为发布者不接收会话数据
+    virtual bool IsPublisher() override { return true; }                 ///< 以发布者身份加入会话
+    virtual bool IsPublishing() override { return state_ == STARTED; }  ///< 源站是否已开始下发
+    virtual uint32_t GetId() override { return id_; }                    ///< 内部 ID，不与 socket 冲突
+    virtual TaskScheduler* GetOwnerScheduler() override { return GetTaskSchduler(); }
+
+    std::string GetOrigin() const { return GetRemote(); }
+
+private:
+    RtmpPuller(TaskScheduler* scheduler, int socket, const std::string& ip, uint16_t port,
+               const std::string& stream_path, std::shared_ptr<RtmpSession> session, uint32_t idle_grace_ms);
+
+    // --- RtmpClient 接口重写 ---
+    virtual void SendStreamCommand() override;       ///< 发送 play
+    virtual bool OnStatus(const std::string& level, const std::string& code) override;
+    virtual bool HandleMedia(RtmpMessage& rtmp_msg) override;
+    virtual bool HandleNotify(RtmpMessage& rtmp_msg) override;
+    /**
+     * @brief 在开始超时之外，检查源站断流与本地观看者空闲
+     */
+    virtual bool IsExpired(int64_t now) override;
+    /**
+     * @brief 连接关闭：退出会话并通知 RtmpServer
+     */
+    virtual void OnClose() override;
+
+    std::weak_ptr<RtmpSession> rtmp_session_;    ///< 本地会话
+    StopCallback stop_cb_;                       ///< 关闭回调
+    int64_t last_media_time_ = 0;                ///< 最近收到音视频的时间（毫秒）
+    int64_t idle_since_ = 0;                     ///< 本地无观看者的起始时间（毫秒），0 表示有观看者
+    const uint32_t idle_grace_ms_;               ///< 无观看者宽限期（毫秒）
+    const uint32_t id_;                          ///< 内部 Sink ID
+};
+
+#endif // _RTMPPULLER_H_
@@ -0,0 +1,212 @@
+/**
+ * @file RtmpPusher.cpp
+ * @brief 实现 RtmpPusher：publish 命令、加入本地会话与带积压丢帧的转发。
+ */
+#include "RtmpPusher.h"
+#include "RtmpSession.h"
+#include "rtmp.h"
+
+/**
+ * @brief 创建 socket 并发起非阻塞连接后发送 C0C1，下游接受 publish 后才加入会话
+ */
+RtmpPusher::Ptr RtmpPusher::Create(TaskScheduler* scheduler, const std::string& ip, uint16_t port, const std::string& stream_path,
+                                   std::shared_ptr<RtmpSession> session, uint32_t chunk_size, const QueueOptions& options,
+                                   const StopCallback& stop_cb)
+{
+    if(!session || !IsValidStreamPath(stream_path))
+    {
+        return nullptr;
+    }
+    int sockfd = Connect(ip, port);
+    if(sockfd < 0)
+    {
+        return nullptr;
+    }
+
+    Ptr pusher(new RtmpPusher(scheduler, sockfd, ip, port, stream_path, session, chunk_size, options));
+    pusher->stop_cb_ = stop_cb;
+    pusher->Start();
+    return pusher;
+}
+
+/**
+ * @brief 私有构造，设置转发队列与写回调
+ */
+RtmpPusher::RtmpPusher(TaskScheduler* scheduler, int socket, const std::string& ip, uint16_t port, const std::string& stream_path,
+                       std::shared_ptr<RtmpSession> session, uint32_t chunk_size, const QueueOptions& options)
+    :RtmpClient(scheduler, socket, ip, port, stream_path, chunk_size)
+    ,rtmp_session_(session)
+    ,media_queue_(options.drop_disposable_ms, options.drop_gop_ms, options.max_ms)
+    ,queue_watermark_(options.watermark)
+    ,id_(AllocInternalId())
+{
+    this->SetWriteCallback([this](std::shared_ptr<TcpConnection> conn){
+        this->DrainMediaQueue();
+    }, queue_watermark_);
+}
+
+/**
+ * @brief 析构函数
+ */
+RtmpPusher::~RtmpPusher()
+{
+}
+
+/**
+ * @brief 在 createStream 返回的消息流上发送 publish 命令
+ */
+void RtmpPusher::SendStreamCommand()
+{
+    AmfObjects objects;
+    amf_encoder_.reset();
+    amf_encoder_.encodeString("publish", 7);
+    amf_encoder_.encodeNumber(0);
+    amf_encoder_.encodeObjects(objects);
+    amf_encoder_.encodeString(stream_name_.c_str(), (int)stream_name_.size());
+    amf_encoder_.encodeString("live", 4);
+    SendInvokeMessage(stream_id_, amf_encoder_.data(), amf_encoder_.size());
+}
+
+/**
+ * @brief NetStream.Publish.Start 后加入会话，错误时断开
+ *
+ * 每次连接都是新的观看者，加入时会话重新下发元数据与序列头，重连无需额外处理
+ */
+bool RtmpPusher::OnStatus(const std::string& level, const std::string& code)
+{
+    if(level == "error" || code == "NetStream.Publish.BadName")
+    {
+        printf("[RtmpPusher] %s%s %s\n", GetRemote().c_str(), stream_path_.c_str(), code.c_str());
+        return false;
+    }
+    if(code == "NetStream.Publish.Start" && state_ != STARTED)
+    {
+        SetStarted();
+        auto session = rtmp_session_.lock();
+        if(!session)
+        {
+            return false;
+        }
+        session->AddSink(std::static_pointer_cast<RtmpPusher>(shared_from_this()));
+    }
+    return true;
+}
+
+/**
+ * @brief 连接关闭：退出会话并通知 ForwardService
+ */
+void RtmpPusher::OnClose()
+{
+    auto session = rtmp_session_.lock();
+    if(session)
+    {
+        session->RemoveSink(std::static_pointer_cast<RtmpPusher>(shared_from_this()));
+    }
+    media_queue_.Clear();
+    if(stop_cb_)
+    {
+        stop_cb_(std::static_pointer_cast<RtmpPusher>(shared_from_this()));
+    }
+}
+
+/**
+ * @brief 转发元数据，格式与推流端相同：@setDataFrame + onMetaData + ECMA 数组
+ *
+ * 会话共享的元数据不含 @setDataFrame，在其前拼接该字符串的 AMF0 编码，元数据本身不重新编码
+ */
+bool RtmpPusher::SendMetaData(RtmpMediaPacket::Ptr meta_data)
+{
+    if(this->IsClosed() || !meta_data || meta_data->GetSize() == 0)
+    {
+        return false;
+    }
+
+    static const char kSetDataFrame[] = { AMF0_STRING, 0x00, 0x0d, '@', 's', 'e', 't', 'D', 'a', 't', 'a',
+                                          'F', 'r', 'a', 'm', 'e' };
+    uint32_t size = sizeof(kSetDataFrame) + meta_data->GetSize();
+    std::shared_ptr<char> payload(new char[size], std::default_delete<char[]>());
+    memcpy(payload.get(), kSetDataFrame, sizeof(kSetDataFrame));
+    memcpy(payload.get() + sizeof(kSetDataFrame), meta_data->GetPayload().get(), meta_data->GetSize());
+
+    RtmpMessage rtmp_msg;
+    rtmp_msg.type_id = RTMP_NOTIFY;
+    rtmp_msg.stream_id = stream_id_;
+    rtmp_msg.playload = payload;
+    rtmp_msg.lenght = size;
+    SendRtmpChunks(RTMP_CHUNK_DATA_ID, rtmp_msg);
+    return true;
+}
+
+/**
+ * @brief 封装为媒体消息后按共享路径发送
+ */
+bool RtmpPusher::SendMediaData(uint8_t type, uint64_t timestamp, std::shared_ptr<char> payload, uint32_t payload_size)
+{
+    return SendMediaPacket(std::make_shared<RtmpMediaPacket>(type, timestamp, payload, payload_size));
+}
+
+/**
+ * @brief 入队并补充发送；收到 AVC 序列头后先等关键帧，避免下游从 GOP 中间开始解码
+ */
+bool RtmpPusher::SendMediaPacket(RtmpMediaPacket::Ptr packet)
+{
+    if(this->IsClosed())
+    {
+        return false;
+    }
+    if(packet->GetSize() == 0)
+    {
+        return false;
+    }
+
+    is_playing_ = true;
+
+    uint8_t type = packet->GetType();
+    if(type == RTMP_AVC_SEQUENCE_HEADER)
+    {
+        has_avc_header_ = true;
+        has_key_frame_ = false;
+    }
+    else if(type != RTMP_AAC_SEQUENCE_HEADER && has_avc_header_ && !has_key_frame_)
+    {
+        if(type != RTMP_VIDEO || !packet->IsKeyFrame())
+        {
+            skipped_frames_.fetch_add(1, std::memory_order_relaxed);
+            return true;
+        }
+        has_key_frame_ = true;
+    }
+
+    media_queue_.Push(packet);
+    DrainMediaQueue();
+    return true;
+}
+
+/**
+ * @brief TCP 发送队列低于水位时从转发队列取出消息发送，同 RtmpConnection::DrainMediaQueue
+ */
+void RtmpPusher::DrainMediaQueue()
+{
+    media_queue_.Drain([this]() {
+        return !this->IsClosed() && GetPendingBytes() <= queue_watermark_;
+    }, [this](RtmpMediaPacket::Ptr packet) {
+        SendPacketChunks(packet);
+    });
+}
+
+/**
+ * @brief 汇总转发连接的发送统计
+ */
+bool RtmpPusher::GetSinkStats(SinkStats& stats)
+{
+    RtmpMediaQueue::Stats queue_stats = media_queue_.GetStats();
+    stats.type = "forward";
+    stats.sent_bytes = GetSentBytes();
+    stats.pending_bytes = GetPendingBytes();
+    stats.lag_ms = queue_stats.lag_ms;
+    stats.dropped_frames = queue_stats.dropped_video + queue_stats.dropped_audio
+                         + skipped_frames_.load(std::memory_order_relaxed);
+    stats.header_bytes_saved = GetHeaderBytesSaved();
+    stats.send_calls = GetSendCalls();
+    return true;
+}
@@ -0,0 +1,112 @@
+/**
+ * @file RtmpPusher.h
+ * @brief 推流转发：以 RTMP 客户端身份向下游服务 publish，本地会话中的音视频原样转发。
+ *
+ * 主要职责：
+ *  - 连接、握手与 connect/createStream 由 RtmpClient 完成，之后发送 publish
+ *  - 下游返回 NetStream.Publish.Start 后以观看者身份加入本地会话，
+ *    会话立即下发元数据、序列头和缓存的 GOP，重连后序列头同样会重新发送
+ *  - 发送 chunk 大小与服务端一致，直接复用会话内已分片的 chunk 缓冲区
+ *  - 经由 RtmpMediaQueue 发送，下游变慢时丢帧到下一个关键帧，不阻塞推流端
+ */
+
+#ifndef _RTMPPUSHER_H_
+#define _RTMPPUSHER_H_
+
+#include "RtmpClient.h"
+#include "RtmpSink.h"
+#include "RtmpMediaQueue.h"
+#include <functional>
+#include <string>
+
+class RtmpSession;
+
+/**
+ * @class RtmpPusher
+ * @brief 单条流到单个下游的转发连接；IO 在所属调度线程执行，入队可在任意线程
+ */
+class RtmpPusher : public RtmpClient, public RtmpSink
+{
+public:
+    using Ptr = std::shared_ptr<RtmpPusher>;
+    /** 连接关闭回调，在所属调度线程调用 */
+    using StopCallback = std::function<void(Ptr)>;
+
+    /** 转发队列参数，含义同 RtmpServer::SetPlayerQueue */
+    struct QueueOptions
+    {
+        uint32_t drop_disposable_ms = 1000; ///< 积压超过该值时丢弃可丢弃帧
+        uint32_t drop_gop_ms = 3000;        ///< 积压超过该值时丢弃视频直到下一个关键帧
+        uint32_t max_ms = 10000;            ///< 积压硬上限
+        uint32_t watermark = 256 * 1024;    ///< TCP 发送队列低于该字节数时从队列补充
+    };
+
+    /**
+     * @brief 发起到下游的非阻塞连接并发送 C0C1
+     * @param scheduler 处理该连接 IO 的调度器
+     * @param ip 下游 IPv4 地址
+     * @param port 下游端口
+     * @param stream_path 流路径，格式 "/app/stream"，下游使用相同的路径
+     * @param session 被转发的本地会话
+     * @param chunk_size 发送 chunk 大小，与服务端一致时可复用会话内的分片结果
+     * @param options 转发队列参数
+     * @param stop_cb 连接关闭回调
+     * @return 转发连接，参数无效或 socket 创建失败时为 nullptr
+     */
+    static Ptr Create(TaskScheduler* scheduler, const std::string& ip, uint16_t port, const std::string& stream_path,
+                      std::shared_ptr<RtmpSession> session, uint32_t chunk_size, const QueueOptions& options,
+                      const StopCallback& stop_cb);
+
+    /**
+     * @brief 析构函数
+     */
+    virtual ~RtmpPusher();
+
+    // --- RtmpSink 接口重写 ---
+    virtual bool SendMetaData(RtmpMediaPacket::Ptr meta_data) override;  ///< 以 @setDataFrame 转发元数据
+    virtual bool SendMediaData(uint8_t type, uint64_t timestamp, std::shared_ptr<char> payload, uint32_t payload_size) override;
+    virtual bool SendMediaPacket(RtmpMediaPacket::Ptr packet) override;  ///< 复用会话内已分片的 chunk
+    virtual bool IsPlayer() override { return true; }                    ///< 以观看者身份接收音视频
+    virtual bool IsPlaying() override { return is_playing_; }            ///< 是否已收到过媒体消息
+    virtual uint32_t GetId() override { return id_; }                    ///< 内部 ID，不与 socket 冲突
+    virtual TaskScheduler* GetOwnerScheduler() override { return GetTaskSchduler(); }
+
+    /**
+     * @brief 获取转发队列的积压与丢帧统计
+     */
+    RtmpMediaQueue::Stats GetQueueStats() { return media_queue_.GetStats(); }
+
+    /**
+     * @brief 获取转发连接的发送统计
+     */
+    virtual bool GetSinkStats(SinkStats& stats) override;
+
+private:
+    RtmpPusher(TaskScheduler* scheduler, int socket, const std::string& ip, uint16_t port, const std::string& stream_path,
+               std::shared_ptr<RtmpSession> session, uint32_t chunk_size, const QueueOptions& options);
+
+    // --- RtmpClient 接口重写 ---
+    virtual void SendStreamCommand() override;       ///< 发送 publish
+    virtual bool OnStatus(const std::string& level, const std::string& code) override;
+    /**
+     * @brief 连接关闭：退出会话并通知 ForwardService
+     */
+    virtual void OnClose() override;
+
+    /**
+     * @brief TCP 发送队列低于水位时从转发队列补充，同 RtmpConnection::DrainMediaQueue
+     */
+    void DrainMediaQueue();
+
+    std::weak_ptr<RtmpSession> rtmp_session_;    ///< 被转发的本地会话
+    StopCallback stop_cb_;                       ///< 关闭回调
+    RtmpMediaQueue media_queue_;                 ///< 转发队列，积压时按帧类型丢帧
+    const uint32_t queue_watermark_;             ///< TCP 发送队列补充水位（字节）
+    std::atomic<uint64_t> skipped_frames_{0};    ///< 等待关键帧期间跳过的帧数
+    std::atomic_bool is_playing_{false};         ///< 是否已收到过媒体消息
+    std::atomic_bool has_avc_header_{false};     ///< 是否已转发 AVC 序列头
+    std::atomic_bool has_key_frame_{false};      ///< 序列头之后是否已转发关键帧
+    const uint32_t id_;                          ///< 内部 Sink ID
+};
+
+#endif // _RTMPPUSHER_H_
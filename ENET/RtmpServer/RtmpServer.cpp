@@ -1,6 +1,36 @@
 #include "RtmpServer.h"
 #include "../EdoyunNet/EventLoop.h"
+#include "../EdoyunNet/BufferPool.h"
 #include "RtmpConnection.h"
+#include "FlvVodFile.h"
+#include "RtmpPuller.h"
+#include <algorithm>
+
+/** 回源连接关闭后到移出回源表、按需重连的间隔（毫秒） */
+static const uint32_t kPullRetryMs = 1000;
+
+/**
+ * @brief 源站与流路径的哈希得分（FNV-1a 加 64 位混合），各边缘进程结果一致
+ * @param origin 源站地址
+ * @param stream_path 流路径
+ * @return 得分，最高者为该流的首选源站
+ */
+static uint64_t HashOrigin(const std::string& origin, const std::string& stream_path)
+{
+    uint64_t hash = 14695981039346656037ULL;
+    for(const std::string* str : { &origin, &stream_path })
+    {
+        for(unsigned char c : *str)
+        {
+            hash = (hash ^ c) * 1099511628211ULL;
+        }
+        hash = (hash ^ '/') * 1099511628211ULL;
+    }
+    hash ^= hash >> 33;
+    hash *= 0xff51afd7ed558ccdULL;
+    hash ^= hash >> 33;
+    return hash;
+}
 
 /**
  * @brief 静态工厂方法，创建并返回 RTMP 服务实例
@@ -22,19 +52,15 @@ RtmpServer::RtmpServer(EventLoop* eventloop)
     ,loop_(eventloop)
     ,event_callbacks_(10)
 {
+    thread_counter_num_ = loop_->GetThreadNum() > 0 ? loop_->GetThreadNum() : 1;
+    thread_counters_.reset(new ThreadCounters[thread_counter_num_]);
+    RtmpSession::SetMaxTotalGopCacheBytes(256 * 1024 * 1024);  // 默认 GOP 缓存总上限 256MB
+
     // 定时移除无订阅者的会话
     loop_->AddTimer([this](){
-        std::lock_guard<std::mutex> lock(mutex_);
-        for(auto iter = rtmp_sessions_.begin(); iter != rtmp_sessions_.end();){
-            if(iter->second->GetClients() == 0)
-            {
-                rtmp_sessions_.erase(iter++);
-            }
-            else
-            {
-                ++iter;
-            }
-        }
+        rtmp_sessions_.EraseIf([](const std::string&, const RtmpSession::Ptr& session){
+            return session->GetClients() == 0;
+        });
         return true;
     },3000); // 每 3 秒执行一次
 }
@@ -44,6 +70,10 @@ RtmpServer::RtmpServer(EventLoop* eventloop)
  */
 RtmpServer::~RtmpServer()
 {
+    if(metrics_timer_id_ > 0)
+    {
+        loop_->RemvoTimer(metrics_timer_id_);
+    }
 }
 
 /**
@@ -56,17 +86,519 @@ void RtmpServer::SetEventCallback(const EventCallback &cb)
     event_callbacks_.push_back(cb);
 }
 
+/**
+ * @brief 设置观看者出口限速参数，在 play 成功后应用到连接
+ * @param rate 令牌桶速率（字节/秒），0 表示不限速
+ * @param burst 令牌桶容量（字节）
+ * @param kernel_pacing 是否同时设置内核 SO_MAX_PACING_RATE
+ */
+void RtmpServer::SetPlayerPacing(uint32_t rate, uint32_t burst, bool kernel_pacing)
+{
+    player_pacing_rate_ = rate;
+    player_pacing_burst_ = burst;
+    kernel_pacing_ = kernel_pacing;
+}
+
+/**
+ * @brief 设置观看者传输层统计参数，在 play 成功后应用到连接
+ * @param interval TCP_INFO 采样周期（毫秒），0 表示关闭
+ * @param notsent_lowat TCP_NOTSENT_LOWAT（字节），0 表示不设置
+ * @param max_queue_delay 允许的最大发送积压时延（毫秒）
+ */
+void RtmpServer::SetPlayerTransportStats(uint32_t interval, uint32_t notsent_lowat, uint32_t max_queue_delay)
+{
+    transport_stats_interval_ = interval;
+    notsent_lowat_ = notsent_lowat;
+    max_queue_delay_ = max_queue_delay;
+}
+
+/**
+ * @brief 设置观看者未确认字节上限，对之后开始播放的观看者生效
+ * @param max_unacked_bytes 未确认字节上限，0 表示关闭
+ */
+void RtmpServer::SetPlayerAckLimit(uint32_t max_unacked_bytes)
+{
+    max_unacked_bytes_ = max_unacked_bytes;
+}
+
+/**
+ * @brief 设置 Chunk 解析预算，防止单个推流连接的积压数据独占调度线程
+ * @param bytes 每轮最多解析的字节数
+ * @param messages 每轮最多处理的消息数
+ */
+void RtmpServer::SetReadBudget(uint32_t bytes, uint32_t messages)
+{
+    if(bytes > 0 && messages > 0)
+    {
+        read_budget_bytes_ = bytes;
+        read_budget_messages_ = messages;
+    }
+}
+
+/**
+ * @brief 设置观看者媒体队列参数，在 play 成功后应用到连接
+ * @param drop_disposable_ms 丢弃可丢弃帧的积压阈值（毫秒）
+ * @param drop_gop_ms 跳到下一个关键帧的积压阈值（毫秒）
+ * @param max_ms 积压硬上限（毫秒）
+ * @param watermark TCP 发送队列补充水位（字节）
+ */
+void RtmpServer::SetPlayerQueue(uint32_t drop_disposable_ms, uint32_t drop_gop_ms, uint32_t max_ms, uint32_t watermark)
+{
+    player_queue_drop_disposable_ms_ = drop_disposable_ms;
+    player_queue_drop_gop_ms_ = drop_gop_ms;
+    player_queue_max_ms_ = max_ms;
+    player_queue_watermark_ = watermark;
+}
+
+/**
+ * @brief 设置 GOP 缓存上限，对之后创建的会话生效
+ * @param session_max_bytes 每个会话的缓存上限（字节），0 表示关闭
+ * @param total_max_bytes 所有会话的缓存总上限（字节），0 表示不限制
+ */
+void RtmpServer::SetGopCache(uint32_t session_max_bytes, uint64_t total_max_bytes)
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    gop_cache_max_bytes_ = session_max_bytes;
+    RtmpSession::SetMaxTotalGopCacheBytes(total_max_bytes);
+}
+
+/**
+ * @brief 设置观看者聚合窗口，对之后创建的会话生效
+ * @param window_ms 窗口长度（毫秒），0 表示关闭
+ */
+void RtmpServer::SetPlayerAggregate(uint32_t window_ms)
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    aggregate_window_ms_ = window_ms;
+}
+
+/**
+ * @brief 设置流亲和调度，对之后创建的会话生效
+ * @param enable 是否启用
+ * @param max_players_per_thread 每条流在所属线程上的观看者上限，0 表示不限制
+ */
+void RtmpServer::SetStreamAffinity(bool enable, uint32_t max_players_per_thread)
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    stream_affinity_ = enable;
+    affinity_max_players_ = max_players_per_thread;
+}
+
+/**
+ * @brief 设置观看者自适应码率，对之后开始播放的观看者生效
+ * @param suffixes 档位后缀，为空表示关闭
+ * @param down_lag_ms 降档的发送积压阈值（毫秒）
+ * @param up_interval_ms 升档的最小间隔（毫秒）
+ */
+void RtmpServer::SetAdaptiveBitrate(const std::vector<std::string>& suffixes, uint32_t down_lag_ms, uint32_t up_interval_ms)
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    abr_suffixes_ = suffixes;
+    abr_down_lag_ms_ = down_lag_ms;
+    abr_up_interval_ms_ = up_interval_ms;
+}
+
+/**
+ * @brief 设置点播目录
+ * @param root 点播目录，为空表示关闭
+ */
+void RtmpServer::SetVodRoot(const std::string& root)
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    vod_root_ = root;
+}
+
+/**
+ * @brief 设置时移窗口，对之后创建的会话生效
+ * @param window_ms 每条流的窗口时长（毫秒），0 表示关闭
+ * @param total_max_bytes 所有窗口的内存总上限（字节），0 表示不限制
+ */
+void RtmpServer::SetTimeShift(uint32_t window_ms, uint64_t total_max_bytes)
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    time_shift_window_ms_ = window_ms;
+    TimeShiftBuffer::SetMaxTotalBytes(total_max_bytes);
+}
+
+/**
+ * @brief 按流路径映射点播文件，路径已带扩展名时直接使用，否则加 ".flv"
+ * @param stream_path 流路径
+ * @return 点播文件，不存在时为 nullptr
+ */
+std::shared_ptr<FlvVodFile> RtmpServer::OpenVodFile(const std::string& stream_path)
+{
+    std::string root;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        root = vod_root_;
+    }
+    if(root.empty() || stream_path.size() < 2 || stream_path[0] != '/' || stream_path.find("..") != std::string::npos)
+    {
+        return nullptr;
+    }
+    FlvVodFile::Ptr file = FlvVodFile::Open(root + stream_path);
+    if(!file)
+    {
+        file = FlvVodFile::Open(root + stream_path + ".flv");
+    }
+    return file;
+}
+
+/**
+ * @brief 绑定多进程模式的进程间通道，并启动指标上报定时器
+ * @param channel 与监控进程的通道
+ * @param metrics_interval 指标上报周期（毫秒），0 表示不上报
+ */
+void RtmpServer::SetWorkerChannel(std::shared_ptr<WorkerChannel> channel, uint32_t metrics_interval)
+{
+    worker_channel_ = channel;
+    if(worker_channel_)
+    {
+        std::weak_ptr<RtmpServer> weak_server = shared_from_this();
+        worker_channel_->SetRejectCallback([weak_server](const std::string& stream_path){
+            if(auto server = weak_server.lock())
+            {
+                server->OnStreamRejected(stream_path);
+            }
+        });
+    }
+    if(metrics_timer_id_ > 0)
+    {
+        loop_->RemvoTimer(metrics_timer_id_);
+        metrics_timer_id_ = 0;
+    }
+    if(worker_channel_ && metrics_interval > 0)
+    {
+        metrics_timer_id_ = loop_->AddTimer([this](){
+            this->ReportWorkerMetrics();
+            return true;
+        },metrics_interval);
+    }
+}
+
+/**
+ * @brief 设置源站列表，开启或关闭边缘模式
+ * @param origins 源站地址列表，格式 "ip:port"，省略端口时为 1935
+ * @param idle_grace_ms 回源连接在无观看者时的保留时长（毫秒）
+ */
+void RtmpServer::SetEdgeOrigins(const std::vector<std::string>& origins, uint32_t idle_grace_ms)
+{
+    std::lock_guard<std::mutex> lock(pull_mutex_);
+    edge_origins_.clear();
+    for(auto &origin : origins)
+    {
+        size_t pos = origin.rfind(':');
+        std::string ip = origin.substr(0, pos);
+        int port = pos == std::string::npos ? 1935 : atoi(origin.c_str() + pos + 1);
+        if(ip.empty() || port <= 0 || port > 65535)
+        {
+            printf("[Edge] invalid origin %s\n", origin.c_str());
+            continue;
+        }
+        edge_origins_.emplace_back(ip, (uint16_t)port);
+    }
+    edge_idle_grace_ms_ = idle_grace_ms;
+}
+
+/**
+ * @brief 为没有发布者的流建立回源连接
+ *
+ * 源站按 HashOrigin 得分从高到低排列，第 attempt 次尝试使用第 attempt 个（取模）；
+ * 回源连接优先放在会话所属的调度线程，收到的帧在同一线程分发给本地观看者
+ * @param stream_path 流路径
+ * @param attempt 第几次尝试
+ * @return 流对应的会话，未开启边缘模式时为 nullptr
+ */
+RtmpSession::Ptr RtmpServer::PullFromOrigin(const std::string& stream_path, uint32_t attempt)
+{
+    std::lock_guard<std::mutex> lock(pull_mutex_);
+    if(edge_origins_.empty())
+    {
+        return nullptr;
+    }
+
+    RtmpSession::Ptr session = GetSession(stream_path);
+    if(pullers_.find(stream_path) != pullers_.end() || session->HasPublisher())
+    {
+        return session;                               // 本地推流或已在回源
+    }
+
+    std::vector<std::pair<uint64_t,size_t>> ranks;
+    for(size_t i = 0; i < edge_origins_.size(); i++)
+    {
+        std::string origin = edge_origins_[i].first + ":" + std::to_string(edge_origins_[i].second);
+        ranks.emplace_back(HashOrigin(origin, stream_path), i);
+    }
+    std::sort(ranks.begin(), ranks.end(), [](const std::pair<uint64_t,size_t>& a, const std::pair<uint64_t,size_t>& b){
+        return a.first > b.first;
+    });
+    auto &origin = edge_origins_[ranks[attempt % ranks.size()].second];
+    auto puller = StartPuller(stream_path, session, origin.first, origin.second, attempt, false);
+    if(puller)
+    {
+        printf("[Edge] pull %s from %s\n", stream_path.c_str(), puller->GetOrigin().c_str());
+    }
+    return session;
+}
+
+/**
+ * @brief 设置工作进程中继端口基准
+ * @param base_port 中继端口基准，0 表示不中继
+ */
+void RtmpServer::SetWorkerRelayPort(uint16_t base_port)
+{
+    std::lock_guard<std::mutex> lock(pull_mutex_);
+    worker_relay_port_ = base_port;
+}
+
+/**
+ * @brief 从推流所在的工作进程中继：连接对方在回环地址上的中继端口，以观看者身份拉流
+ * @param stream_path 流路径
+ * @param worker_id 推流所在的工作进程编号
+ * @return 流对应的会话，未设置中继端口时为 nullptr
+ */
+RtmpSession::Ptr RtmpServer::PullFromWorker(const std::string& stream_path, int worker_id)
+{
+    std::lock_guard<std::mutex> lock(pull_mutex_);
+    if(worker_relay_port_ == 0 || worker_id < 0 || worker_relay_port_ + worker_id > 65535)
+    {
+        return nullptr;
+    }
+
+    RtmpSession::Ptr session = GetSession(stream_path);
+    if(pullers_.find(stream_path) != pullers_.end() || session->HasPublisher())
+    {
+        return session;                               // 本地推流或已在中继
+    }
+    if(StartPuller(stream_path, session, "127.0.0.1", (uint16_t)(worker_relay_port_ + worker_id), 0, true))
+    {
+        printf("[Relay] pull %s from worker %d\n", stream_path.c_str(), worker_id);
+    }
+    return session;
+}
+
+/**
+ * @brief 创建拉流连接并登记到回源表
+ *
+ * 拉流连接优先放在会话所属的调度线程，收到的帧在同一线程分发给本地观看者
+ */
+std::shared_ptr<RtmpPuller> RtmpServer::StartPuller(const std::string& stream_path, RtmpSession::Ptr session, const std::string& ip,
+                                                    uint16_t port, uint32_t attempt, bool from_worker)
+{
+    TaskScheduler* scheduler = session->GetScheduler() ? session->GetScheduler() : loop_->GetTaskSchduler().get();
+    std::weak_ptr<RtmpServer> weak_server = shared_from_this();
+    auto puller = RtmpPuller::Create(scheduler, ip, port, stream_path, session, edge_idle_grace_ms_,
+        [weak_server, attempt, from_worker](std::shared_ptr<RtmpPuller> puller){
+            if(auto server = weak_server.lock())
+            {
+                server->OnPullerStop(puller, attempt, from_worker);
+            }
+        });
+    if(puller)
+    {
+        pullers_[stream_path] = puller;
+    }
+    return puller;
+}
+
+/**
+ * @brief 回源连接关闭后的处理
+ *
+ * 关闭回调在连接内部执行，回源表持有的引用在定时器中释放；
+ * 等待期间该流仍登记在回源表中，新观看者不会立即触发重连，起到退避作用
+ * @param puller 关闭的回源连接
+ * @param attempt 该连接对应的尝试次数
+ */
+void RtmpServer::OnPullerStop(std::shared_ptr<RtmpPuller> puller, uint32_t attempt, bool from_worker)
+{
+    NotifyEvent("pull.stop", puller->GetStreamPath());
+    uint32_t next_attempt = puller->HasStarted() ? 0 : attempt + 1;   // 源站不可用时换下一个
+    std::weak_ptr<RtmpServer> weak_server = shared_from_this();
+    loop_->AddTimer([weak_server, puller, next_attempt, from_worker](){
+        auto server = weak_server.lock();
+        if(!server)
+        {
+            return false;
+        }
+        std::string stream_path = puller->GetStreamPath();
+        {
+            std::lock_guard<std::mutex> lock(server->pull_mutex_);
+            auto iter = server->pullers_.find(stream_path);
+            if(iter != server->pullers_.end() && iter->second == puller)
+            {
+                server->pullers_.erase(iter);
+            }
+        }
+        RtmpSession::Ptr session = server->FindSession(stream_path);
+        if(session && session->GetPlayers() > 0)
+        {
+            if(from_worker)
+            {
+                server->RouteStream(stream_path, nullptr);   // 推流可能已换到其他工作进程
+            }
+            else
+            {
+                server->PullFromOrigin(stream_path, next_attempt);
+            }
+        }
+        return false;
+    }, kPullRetryMs);
+}
+
+/**
+ * @brief 查询流所在的工作进程，本进程存在推流时直接回调，否则询问监控进程
+ * @param stream_path 流路径
+ * @param cb 查询结果回调
+ */
+void RtmpServer::ResolveStreamOwner(std::string stream_path, const WorkerChannel::OwnerCallback& cb)
+{
+    RtmpSession::Ptr session;
+    rtmp_sessions_.Find(stream_path, session);
+
+    int local_id = worker_channel_ ? worker_channel_->GetWorkerId() : 0;
+    if(session && session->HasPublisher())
+    {
+        cb(local_id);
+    }
+    else if(worker_channel_)
+    {
+        worker_channel_->QueryOwner(stream_path, cb);
+    }
+    else
+    {
+        cb(-1);
+    }
+}
+
+/**
+ * @brief 为本进程没有推流的流取得媒体：推流在其他工作进程时中继，集群中没有推流时回源
+ * @param stream_path 流路径
+ * @param cb 完成回调，参数为承载该流的本地会话，没有来源时为 nullptr
+ */
+void RtmpServer::RouteStream(const std::string& stream_path, const std::function<void(RtmpSession::Ptr)>& cb)
+{
+    if(!worker_channel_ || worker_relay_port_ == 0)
+    {
+        RtmpSession::Ptr session = PullFromOrigin(stream_path);
+        if(cb)
+        {
+            cb(session);
+        }
+        return;
+    }
+
+    int local_id = worker_channel_->GetWorkerId();
+    std::weak_ptr<RtmpServer> weak_server = shared_from_this();
+    ResolveStreamOwner(stream_path, [weak_server, stream_path, local_id, cb](int owner){
+        auto server = weak_server.lock();
+        RtmpSession::Ptr session;
+        if(server && owner == local_id)
+        {
+            session = server->FindSession(stream_path);
+        }
+        else if(server && owner >= 0)
+        {
+            session = server->PullFromWorker(stream_path, owner);
+        }
+        else if(server)
+        {
+            session = server->PullFromOrigin(stream_path);
+        }
+        if(cb)
+        {
+            cb(session);
+        }
+    });
+}
+
+/**
+ * @brief 流已由其他工作进程推送，断开本进程的推流连接；中继与回源连接不会声明流归属
+ * @param stream_path 流路径
+ */
+void RtmpServer::OnStreamRejected(const std::string& stream_path)
+{
+    RtmpSession::Ptr session = FindSession(stream_path);
+    std::shared_ptr<RtmpConnection> publisher = session ? session->GetPublisher() : nullptr;
+    if(publisher)
+    {
+        printf("[Worker] stream %s is published on another worker, reject\n", stream_path.c_str());
+        publisher->RejectPublish();
+    }
+}
+
+/**
+ * @brief 推流开始/结束时通知监控进程，单进程模式下无操作
+ * @param stream_path 流路径
+ * @param is_publishing true 表示开始推流，false 表示结束
+ */
+void RtmpServer::UpdateStreamOwner(std::string stream_path, bool is_publishing)
+{
+    if(!worker_channel_)
+    {
+        return;
+    }
+    if(is_publishing)
+    {
+        worker_channel_->ClaimStream(stream_path);
+    }
+    else
+    {
+        worker_channel_->ReleaseStream(stream_path);
+    }
+}
+
+/**
+ * @brief 统计本进程的会话、推流与客户端数量并上报给监控进程
+ */
+void RtmpServer::ReportWorkerMetrics()
+{
+    std::vector<RtmpSession::Ptr> sessions;
+    rtmp_sessions_.ForEach([&sessions](const std::string&, const RtmpSession::Ptr& session){
+        sessions.push_back(session);
+    });
+
+    int64_t publishers = 0;
+    int64_t clients = 0;
+    for(auto &session : sessions)
+    {
+        if(session->HasPublisher())
+        {
+            publishers++;
+        }
+        clients += session->GetClients();
+    }
+
+    worker_channel_->ReportMetric("rtmp_sessions", (int64_t)sessions.size());
+    worker_channel_->ReportMetric("rtmp_publishers", publishers);
+    worker_channel_->ReportMetric("rtmp_clients", clients);
+}
+
 /**
  * @brief 创建新的会话，如果不存在则插入，会在发布(push)阶段调用
  * @param stream_path 流路径，格式: "/app/streamName"
  */
 void RtmpServer::AddSesion(std::string stream_path)
 {
-    std::lock_guard<std::mutex> lock(mutex_);
-    if(rtmp_sessions_.find(stream_path) == rtmp_sessions_.end())
+    GetSession(stream_path);
+}
+
+/**
+ * @brief 创建会话，启用流亲和时按路径哈希选定所属调度线程
+ * @param stream_path 流路径
+ * @return 新建的会话
+ */
+RtmpSession::Ptr RtmpServer::CreateSession(const std::string& stream_path)
+{
+    auto session = std::make_shared<RtmpSession>();
+    session->SetGopCache(gop_cache_max_bytes_);
+    session->SetAggregateWindow(aggregate_window_ms_);
+    session->SetTimeShift(time_shift_window_ms_);
+    if(stream_affinity_)
     {
-        rtmp_sessions_[stream_path] = std::make_shared<RtmpSession>();
+        uint32_t index = (uint32_t)std::hash<std::string>()(stream_path);
+        session->SetScheduler(loop_->GetTaskSchduler(index).get());
     }
+    return session;
 }
 
 /**
@@ -75,23 +607,21 @@ void RtmpServer::AddSesion(std::string stream_path)
  */
 void RtmpServer::RemoveSession(std::string stream_path)
 {
-    std::lock_guard<std::mutex> lock(mutex_);
-    rtmp_sessions_.erase(stream_path);
+    rtmp_sessions_.Erase(stream_path);
 }
 
 /**
  * @brief 获取或创建指定流路径对应的会话
+ *
+ * 已存在的会话直接从快照中查找，不加锁；首次创建时只锁定所在分片
  * @param stream_path 流路径
  * @return 对应的 RtmpSession 智能指针
  */
 RtmpSession::Ptr RtmpServer::GetSession(std::string stream_path)
 {
-    std::lock_guard<std::mutex> lock(mutex_);
-    if(rtmp_sessions_.find(stream_path) == rtmp_sessions_.end())
-    {
-        rtmp_sessions_[stream_path] = std::make_shared<RtmpSession>();
-    }
-    return rtmp_sessions_[stream_path];
+    return rtmp_sessions_.GetOrCreate(stream_path, [this, &stream_path](){
+        return CreateSession(stream_path);
+    });
 }
 
 /**
@@ -106,7 +636,7 @@ bool RtmpServer::HasPublisher(std::string stream_path)
     {
         return false;
     }
-    return (session->GetPublisher() != nullptr);
+    return session->HasPublisher();
 }
 
 /**
@@ -116,8 +646,75 @@ bool RtmpServer::HasPublisher(std::string stream_path)
  */
 bool RtmpServer::HasSession(std::string stream_path)
 {
-    std::lock_guard<std::mutex> lock(mutex_);
-    return (rtmp_sessions_.find(stream_path) != rtmp_sessions_.end());
+    RtmpSession::Ptr session;
+    return rtmp_sessions_.Find(stream_path, session);
+}
+
+/**
+ * @brief 查找已存在的会话，供 HTTP 等其他协议的服务使用
+ * @param stream_path 流路径
+ * @return 会话，不存在时为 nullptr
+ */
+RtmpSession::Ptr RtmpServer::FindSession(const std::string& stream_path)
+{
+    RtmpSession::Ptr session;
+    rtmp_sessions_.Find(stream_path, session);
+    return session;
+}
+
+/**
+ * @brief 获取调度线程对应的计数器，调度器 ID 与 EventLoop 中的下标一致
+ */
+RtmpServer::ThreadCounters& RtmpServer::GetThreadCounters(TaskScheduler* scheduler)
+{
+    uint32_t index = scheduler ? (uint32_t)scheduler->GetId() % thread_counter_num_ : 0;
+    return thread_counters_[index];
+}
+
+/**
+ * @brief 汇总各线程计数器，并遍历会话快照读取推流与观看者统计
+ */
+RtmpServer::Stats RtmpServer::GetStats()
+{
+    Stats stats;
+    for(uint32_t i = 0; i < thread_counter_num_; i++)
+    {
+        stats.chunk_errors += thread_counters_[i].chunk_errors.load(std::memory_order_relaxed);
+        stats.message_errors += thread_counters_[i].message_errors.load(std::memory_order_relaxed);
+    }
+    stats.gop_cache_bytes = RtmpSession::GetTotalGopCacheBytes();
+    stats.buffer_pool_bytes = BufferPool::GetTotalPooledBytes();
+    size_t vod_files = 0;
+    FlvVodFile::GetCacheStats(vod_files, stats.vod_mapped_bytes);
+    stats.vod_files = (uint32_t)vod_files;
+    stats.time_shift_bytes = TimeShiftBuffer::GetTotalBytes();
+    stats.time_shift_evicted_gops = TimeShiftBuffer::GetEvictedGops();
+
+    rtmp_sessions_.ForEach([&stats](const std::string& stream_path, const RtmpSession::Ptr& session){
+        StreamStats stream_stats;
+        stream_stats.stream_path = stream_path;
+        stream_stats.has_publisher = session->HasPublisher();
+        stream_stats.ingest = session->GetIngestStats().GetSnapshot();
+        std::shared_ptr<const RtmpSession::SinkList> sinks = session->GetSinks();
+        if(sinks)
+        {
+            for(auto &sink : *sinks)
+            {
+                if(!sink || !sink->IsPlayer())
+                {
+                    continue;
+                }
+                stream_stats.players++;
+                RtmpSink::SinkStats sink_stats;
+                if(sink->GetSinkStats(sink_stats))
+                {
+                    stream_stats.viewers.push_back(sink_stats);
+                }
+            }
+        }
+        stats.streams.push_back(std::move(stream_stats));
+    });
+    return stats;
 }
 
 /**
@@ -1,7 +1,17 @@
+#include <atomic>
+#include <memory>
 #include <mutex>
+#include <unordered_map>
+#include <vector>
 #include "../EdoyunNet/TcpServer.h"
+#include "../EdoyunNet/SnapshotMap.h"
+#include "../EdoyunNet/WorkerChannel.h"
 #include "rtmp.h"
 #include "RtmpSession.h"
+#include "RtmpSink.h"
+
+class RtmpPuller;
+class FlvVodFile;
 
 /**
  * @class RtmpServer
@@ -33,8 +43,205 @@ public:
      */
     void SetEventCallback(const EventCallback& cb);
 
+    /**
+     * @brief 设置观看者连接的出口限速，平滑关键帧突发
+     * @param rate 令牌桶速率（字节/秒），0 表示不限速
+     * @param burst 令牌桶容量（字节），0 表示按速率自动取值
+     * @param kernel_pacing 是否同时设置内核 SO_MAX_PACING_RATE（需 fq 队列规则）
+     */
+    void SetPlayerPacing(uint32_t rate, uint32_t burst = 0, bool kernel_pacing = false);
+
+    /**
+     * @brief 开启观看者连接的 TCP_INFO 采样、按 BDP 自适应发送缓冲区及积压丢帧
+     * @param interval 采样周期（毫秒），0 表示关闭
+     * @param notsent_lowat TCP_NOTSENT_LOWAT 值（字节），0 表示不设置
+     * @param max_queue_delay 发送积压折算时延超过该值（毫秒）时丢弃到下一个关键帧
+     */
+    void SetPlayerTransportStats(uint32_t interval, uint32_t notsent_lowat = 0, uint32_t max_queue_delay = 1000);
+
+    /**
+     * @brief 设置观看者未确认字节上限：按播放器 Acknowledgement 序号计算已发送未确认的字节数，
+     *        超过上限时暂停从媒体队列补充（由队列按积压丢帧），未启用媒体队列时丢弃到下一个关键帧
+     *
+     * 确认粒度为确认窗口（SetAcknowledgementSize），上限小于两倍窗口时按两倍窗口处理；
+     * 从未回复 Acknowledgement 的播放器不受限制
+     * @param max_unacked_bytes 未确认字节上限，0 表示关闭
+     */
+    void SetPlayerAckLimit(uint32_t max_unacked_bytes);
+
+    /**
+     * @brief 设置每个连接每轮事件循环的 Chunk 解析预算，超出部分留到下一轮处理
+     * @param bytes 每轮最多解析的字节数
+     * @param messages 每轮最多处理的完整消息数
+     */
+    void SetReadBudget(uint32_t bytes, uint32_t messages);
+
+    /**
+     * @brief 设置观看者媒体队列的丢帧阈值（按媒体时长计算积压）
+     * @param drop_disposable_ms 积压超过该值时丢弃可丢弃帧
+     * @param drop_gop_ms 积压超过该值时丢弃视频直到下一个关键帧，音频保持连续
+     * @param max_ms 积压硬上限，超过时从队头丢弃（包括音频）
+     * @param watermark TCP 发送队列低于该字节数时才从媒体队列补充
+     * @note 三个阈值均为 0 时关闭媒体队列，数据直接进入 TCP 发送队列
+     */
+    void SetPlayerQueue(uint32_t drop_disposable_ms, uint32_t drop_gop_ms, uint32_t max_ms, uint32_t watermark = 256 * 1024);
+
+    /**
+     * @brief 设置 GOP 缓存，新观看者加入时立即下发最近一个 GOP，无需等待下一个关键帧
+     * @param session_max_bytes 每个会话的缓存上限（字节），0 表示关闭
+     * @param total_max_bytes 所有会话的缓存总上限（字节），0 表示不限制
+     */
+    void SetGopCache(uint32_t session_max_bytes, uint64_t total_max_bytes);
+
+    /**
+     * @brief 设置观看者聚合窗口：窗口内的普通音视频帧打包为 RTMP 聚合消息（type 22）发送
+     *
+     * 聚合消息在会话内只打包一次，所有 RTMP 观看者共享；关键帧与序列头不进入窗口，
+     * 先发出窗口中的帧再逐帧发送，新观看者仍从关键帧开始播放。HTTP-FLV 观看者不受影响
+     * @param window_ms 窗口长度（媒体时间，毫秒），0 表示关闭
+     * @note 对之后创建的会话生效
+     */
+    void SetPlayerAggregate(uint32_t window_ms);
+
+    /**
+     * @brief 设置流亲和调度：同一条流的发布者与观看者固定在同一个调度线程
+     *
+     * 流按路径哈希分配到调度线程，发布者与观看者在 publish/play 后迁移到该线程，
+     * 分发不再跨线程加锁；单个线程上的观看者达到上限后，新观看者留在原线程，
+     * 由会话按线程分组中继
+     * @param enable 是否启用
+     * @param max_players_per_thread 每条流在所属线程上的观看者上限，0 表示不限制
+     * @note 对之后创建的会话生效
+     */
+    void SetStreamAffinity(bool enable, uint32_t max_players_per_thread = 0);
+
+    /**
+     * @brief 开启观看者自适应码率：同一条流的各档位（路径加后缀，如转码输出）之间按关键帧自动切换
+     *
+     * 按观看者的 TCP 交付速率、发送积压与丢帧决定升降档，切换时先发新档位的序列头，
+     * 时间戳保持连续；RTMP 与 HTTP-FLV 观看者都适用。开启后观看者不接收聚合消息
+     * @param suffixes 档位后缀，如 {"_720", "_480"}，为空表示关闭；请求档位流本身的观看者不切换
+     * @param down_lag_ms 发送积压超过该时长（毫秒）或出现丢帧时降档
+     * @param up_interval_ms 距上次切换至少该时长（毫秒）且交付速率足够时升档
+     * @note 对之后开始播放的观看者生效
+     */
+    void SetAdaptiveBitrate(const std::vector<std::string>& suffixes, uint32_t down_lag_ms = 1000,
+                            uint32_t up_interval_ms = 10000);
+
+    /**
+     * @brief 开启点播：播放没有推流的流时，映射点播目录下同名的 FLV 文件按实时速度发送
+     *
+     * 流路径 "/app/name" 依次对应 root/app/name 与 root/app/name.flv；文件以只读 mmap 映射，
+     * 同一文件的观看者共享映射与关键帧索引（优先加载录制时写出的 .idx），tag 直接从映射发送，不拷贝。
+     * RTMP 观看者支持 play 的起始位置、seek 与 pause，HTTP-FLV 观看者支持 "?start=秒"
+     * @param root 点播目录，为空表示关闭
+     * @note 有推流时优先播放直播；边缘模式下点播文件优先于回源
+     */
+    void SetVodRoot(const std::string& root);
+
+    /**
+     * @brief 开启时移：每条流在内存中保留最近一段时间的音视频，观看者可以落后直播播放
+     *
+     * RTMP 观看者播放 "name?delay=秒"、HTTP-FLV 观看者请求 "?delay=秒" 时从落后直播该时长的关键帧开始，
+     * RTMP 观看者还可以在窗口内 seek（位置为流时间戳）与 pause。窗口只引用推流端的负载，不拷贝；
+     * 所有流共用一个内存上限，超出时淘汰全局最早写入的 GOP。不写磁盘
+     * @param window_ms 每条流的窗口时长（毫秒），0 表示关闭
+     * @param total_max_bytes 所有窗口的内存总上限（字节），0 表示不限制
+     * @note 对之后创建的会话生效
+     */
+    void SetTimeShift(uint32_t window_ms, uint64_t total_max_bytes);
+
+    /**
+     * @brief 多进程模式下绑定与监控进程的通道
+     *
+     * 绑定后本进程开始推流时声明流归属、结束时释放，并按周期上报会话与连接数指标；
+     * 该流已由其他工作进程推送时监控进程拒绝声明，本进程回复 NetStream.Publish.BadName 并断开推流
+     * @param channel 由 WorkerSupervisor 创建的进程间通道
+     * @param metrics_interval 指标上报周期（毫秒），0 表示不上报
+     */
+    void SetWorkerChannel(std::shared_ptr<WorkerChannel> channel, uint32_t metrics_interval = 1000);
+
+    /**
+     * @brief 查询流由哪个工作进程推送
+     * @param stream_path 流路径
+     * @param cb 查询结果回调，参数为工作进程编号；单进程模式下本地有推流时为 0，不存在时为 -1
+     */
+    void ResolveStreamOwner(std::string stream_path, const WorkerChannel::OwnerCallback& cb);
+
+    /**
+     * @brief 多进程模式下设置工作进程之间的中继端口
+     *
+     * 每个工作进程另以 WorkerRelayServer 在 127.0.0.1:(base_port + 编号) 上接受中继连接；
+     * 观看者落到没有推流的工作进程时，由该进程向推流所在的进程拉流，同一条流只建立一条中继连接，
+     * 由本进程的所有观看者（RTMP、HTTP-FLV 与 HLS）共享
+     * @param base_port 中继端口基准，0 表示不中继
+     */
+    void SetWorkerRelayPort(uint16_t base_port);
+
+    /**
+     * @brief 为本进程没有推流的流取得媒体
+     *
+     * 多进程模式下先查询流归属，推流在其他工作进程时建立中继；集群中都没有推流时按边缘模式回源
+     * @param stream_path 流路径
+     * @param cb 完成回调，参数为承载该流的本地会话，没有来源时为 nullptr，可为空；
+     *           单进程模式或本进程已有推流时同步执行，否则在事件循环线程中执行
+     */
+    void RouteStream(const std::string& stream_path, const std::function<void(RtmpSession::Ptr)>& cb);
+
+    /**
+     * @brief 开启边缘模式：播放本地没有推流的流时，向源站回源拉流
+     *
+     * 同一条流只建立一条回源连接，由所有本地观看者（RTMP 与 HTTP-FLV）共享；
+     * 源站按流路径做一致性哈希（最高随机权重），增减源站只影响相应部分的流，
+     * 连接失败时按哈希顺序换下一个源站重试
+     * @param origins 源站地址列表，格式 "ip:port"，为空表示关闭边缘模式
+     * @param idle_grace_ms 本地无观看者持续超过该时长（毫秒）后断开回源
+     */
+    void SetEdgeOrigins(const std::vector<std::string>& origins, uint32_t idle_grace_ms = 10000);
+
+    /**
+     * @brief 查找已存在的会话，不存在时不创建
+     * @param stream_path 流路径
+     * @return 会话，不存在时为 nullptr
+     */
+    RtmpSession::Ptr FindSession(const std::string& stream_path);
+
+    /** 单条流的统计 */
+    struct StreamStats
+    {
+        std::string stream_path;                    ///< 流路径
+        bool has_publisher = false;                 ///< 是否有发布者
+        int players = 0;                            ///< 观看者数量（含内部观看者）
+        RtmpStreamStats::Snapshot ingest;           ///< 推流统计
+        std::vector<RtmpSink::SinkStats> viewers;   ///< 各观看者的发送统计
+    };
+
+    /** 服务统计 */
+    struct Stats
+    {
+        uint64_t chunk_errors = 0;                  ///< 累计 Chunk 解析失败次数
+        uint64_t message_errors = 0;                ///< 累计消息处理失败（断开）次数
+        uint64_t gop_cache_bytes = 0;               ///< 所有会话 GOP 缓存占用（字节）
+        uint64_t buffer_pool_bytes = 0;             ///< 所有连接的负载缓冲区池缓存的字节数
+        uint32_t vod_files = 0;                     ///< 正在被观看的点播文件数
+        uint64_t vod_mapped_bytes = 0;              ///< 点播文件映射总字节数
+        uint64_t time_shift_bytes = 0;              ///< 所有时移窗口占用（字节）
+        uint64_t time_shift_evicted_gops = 0;       ///< 累计因时移内存上限淘汰的 GOP 数
+        std::vector<StreamStats> streams;           ///< 各流统计
+    };
+
+    /**
+     * @brief 汇总各线程计数器与各会话的统计（可跨线程调用）
+     *
+     * 计数由所属线程无锁写入，只在读取时遍历汇总，不增加分发路径的开销
+     * @return 统计信息
+     */
+    Stats GetStats();
+
 private:
     friend class RtmpConnection;
+    friend class HttpFlvConnection;
+    friend class RenditionSwitcher;
 
     /**
      * @brief 私有构造，仅通过 Create() 调用
@@ -89,8 +296,124 @@ private:
      */
     virtual TcpConnection::Ptr OnConnect(int socket) override;
 
+    /**
+     * @brief 创建会话并应用 GOP 缓存与流亲和配置
+     * @param stream_path 流路径
+     * @return 新建的会话
+     */
+    RtmpSession::Ptr CreateSession(const std::string& stream_path);
+
+    /**
+     * @brief 边缘模式下为没有发布者的流发起回源，已在回源时直接返回
+     * @param stream_path 流路径
+     * @param attempt 第几次尝试，按一致性哈希顺序选择源站
+     * @return 流对应的会话，未开启边缘模式时为 nullptr
+     */
+    RtmpSession::Ptr PullFromOrigin(const std::string& stream_path, uint32_t attempt = 0);
+
+    /**
+     * @brief 多进程模式下从推流所在的工作进程中继，已在中继或回源时直接返回
+     * @param stream_path 流路径
+     * @param worker_id 推流所在的工作进程编号
+     * @return 流对应的会话，未设置中继端口时为 nullptr
+     */
+    RtmpSession::Ptr PullFromWorker(const std::string& stream_path, int worker_id);
+
+    /**
+     * @brief 创建拉流连接并登记到回源表，调用者持有 pull_mutex_
+     * @param stream_path 流路径
+     * @param session 本地会话
+     * @param ip 对端地址
+     * @param port 对端端口
+     * @param attempt 第几次尝试
+     * @param from_worker 是否为工作进程之间的中继
+     * @return 拉流连接，连接失败时为 nullptr
+     */
+    std::shared_ptr<RtmpPuller> StartPuller(const std::string& stream_path, RtmpSession::Ptr session, const std::string& ip,
+                                            uint16_t port, uint32_t attempt, bool from_worker);
+
+    /**
+     * @brief 回源/中继连接关闭：通知 "pull.stop" 事件，延迟移出回源表；本地仍有观看者时，
+     *        中继重新查询流归属，回源未开始播放的换下一个源站
+     * @param puller 关闭的拉流连接
+     * @param attempt 该连接对应的尝试次数
+     * @param from_worker 是否为工作进程之间的中继
+     */
+    void OnPullerStop(std::shared_ptr<RtmpPuller> puller, uint32_t attempt, bool from_worker);
+
+    /**
+     * @brief 监控进程拒绝本进程对流的声明：断开该流的推流连接
+     * @param stream_path 流路径
+     */
+    void OnStreamRejected(const std::string& stream_path);
+
+    /**
+     * @brief 打开流路径对应的点播文件
+     * @param stream_path 流路径，含 ".." 的路径不映射
+     * @return 点播文件，未开启点播、文件不存在或无效时为 nullptr
+     */
+    std::shared_ptr<FlvVodFile> OpenVodFile(const std::string& stream_path);
+
+    /**
+     * @brief 推流开始/结束时通知监控进程更新流归属
+     * @param stream_path 流路径
+     * @param is_publishing true 表示开始推流，false 表示结束
+     */
+    void UpdateStreamOwner(std::string stream_path, bool is_publishing);
+
+    /**
+     * @brief 向监控进程上报本进程的会话、推流与客户端数量
+     */
+    void ReportWorkerMetrics();
+
+    /** 按调度线程分开的计数器，前后各留一个缓存行，避免相邻线程的计数器伪共享 */
+    struct ThreadCounters
+    {
+        char pad_front[64];
+        std::atomic<uint64_t> chunk_errors{0};
+        std::atomic<uint64_t> message_errors{0};
+        char pad_back[64];
+    };
+
+    /**
+     * @brief 获取调度线程对应的计数器，只由该线程写入
+     * @param scheduler 调度器
+     */
+    ThreadCounters& GetThreadCounters(TaskScheduler* scheduler);
+
     EventLoop* loop_;                                ///< 事件循环，用于定时与网络回调
-    std::mutex mutex_;                               ///< 保护会话表与回调列表的互斥锁
-    std::unordered_map<std::string,RtmpSession::Ptr> rtmp_sessions_;  ///< 流路径到会话的映射表
+    std::mutex mutex_;                               ///< 保护回调列表与配置的互斥锁
+    SnapshotMap<std::string,RtmpSession::Ptr> rtmp_sessions_;  ///< 流路径到会话的映射表，查找无锁
     std::vector<EventCallback> event_callbacks_;     ///< 注册的事件回调列表
+    uint32_t player_pacing_rate_ = 0;                ///< 观看者出口限速速率（字节/秒）
+    uint32_t player_pacing_burst_ = 0;               ///< 观看者令牌桶容量（字节）
+    bool kernel_pacing_ = false;                     ///< 是否启用内核层 pacing
+    uint32_t transport_stats_interval_ = 0;          ///< TCP_INFO 采样周期（毫秒）
+    uint32_t notsent_lowat_ = 0;                     ///< 观看者 TCP_NOTSENT_LOWAT（字节）
+    uint32_t max_queue_delay_ = 1000;                ///< 观看者允许的最大发送积压时延（毫秒）
+    uint32_t max_unacked_bytes_ = 0;                 ///< 观看者未确认字节上限，0 表示关闭
+    uint32_t read_budget_bytes_ = 64 * 1024;         ///< 每轮 Chunk 解析字节预算
+    uint32_t read_budget_messages_ = 32;             ///< 每轮消息处理预算
+    uint32_t player_queue_drop_disposable_ms_ = 1000;   ///< 观看者丢弃可丢弃帧的积压阈值（毫秒）
+    uint32_t player_queue_drop_gop_ms_ = 3000;          ///< 观看者跳到下一个关键帧的积压阈值（毫秒）
+    uint32_t player_queue_max_ms_ = 10000;              ///< 观看者积压硬上限（毫秒）
+    uint32_t player_queue_watermark_ = 256 * 1024;      ///< 观看者 TCP 发送队列补充水位（字节）
+    uint32_t gop_cache_max_bytes_ = 4 * 1024 * 1024; ///< 每个会话的 GOP 缓存上限（字节）
+    uint32_t aggregate_window_ms_ = 0;               ///< 观看者聚合窗口（毫秒），0 表示关闭
+    bool stream_affinity_ = false;                   ///< 是否启用流亲和调度
+    uint32_t affinity_max_players_ = 0;              ///< 流所属线程上的观看者上限，0 表示不限制
+    std::vector<std::string> abr_suffixes_;          ///< 自适应码率的档位后缀，为空表示关闭
+    uint32_t abr_down_lag_ms_ = 1000;                ///< 降档的发送积压阈值（毫秒）
+    uint32_t abr_up_interval_ms_ = 10000;            ///< 升档的最小间隔（毫秒）
+    std::string vod_root_;                           ///< 点播目录，为空表示关闭
+    uint32_t time_shift_window_ms_ = 0;              ///< 时移窗口（毫秒），0 表示关闭
+    std::shared_ptr<WorkerChannel> worker_channel_;  ///< 多进程模式下与监控进程的通道
+    uint16_t worker_relay_port_ = 0;                 ///< 工作进程中继端口基准，0 表示不中继
+    TimerId metrics_timer_id_ = 0;                   ///< 指标上报定时器
+    std::mutex pull_mutex_;                          ///< 保护源站列表与回源表
+    std::vector<std::pair<std::string,uint16_t>> edge_origins_;  ///< 源站地址，为空表示非边缘模式
+    uint32_t edge_idle_grace_ms_ = 10000;            ///< 回源连接在无观看者时的保留时长（毫秒）
+    std::unordered_map<std::string,std::shared_ptr<RtmpPuller>> pullers_;  ///< 流路径到回源连接
+    std::unique_ptr<ThreadCounters[]> thread_counters_;  ///< 各调度线程的计数器
+    uint32_t thread_counter_num_ = 1;                ///< 计数器数量，与调度线程数相同
 };
\ No newline at end of file
@@ -7,29 +7,122 @@
 #include "RtmpSink.h"
 #include "rtmp.h"
 #include "RtmpConnection.h"
+#include <algorithm>
+
+std::atomic<uint64_t> RtmpSession::total_gop_cache_bytes_(0);
+std::atomic<uint64_t> RtmpSession::max_total_gop_cache_bytes_(0);
 
 /**
  * @brief 默认构造函数
  */
 RtmpSession::RtmpSession()
+    : rtmp_sinks_(std::make_shared<SinkList>())
+    , publish_sinks_(rtmp_sinks_)
 {
 }
 
 /**
- * @brief 默认析构函数
+ * @brief 析构函数，归还 GOP 缓存占用
  */
 RtmpSession::~RtmpSession()
 {
+    ClearGopCache();
+}
+
+/**
+ * @brief 设置 H264 AVC Sequence Header，同时生成供观看者共享的序列头消息（推流线程调用）
+ * @param avcSequenceHeader AVC Sequence Header 数据
+ * @param avcSequenceHeaderSize 数据长度（字节）
+ */
+void RtmpSession::SetAvcSequenceHeader(std::shared_ptr<char> avcSequenceHeader, uint32_t avcSequenceHeaderSize)
+{
+    avc_sequence_header_ = avcSequenceHeader;
+    avc_sequence_header_size_ = avcSequenceHeaderSize;
+    avc_sequence_packet_ = std::make_shared<RtmpMediaPacket>(RTMP_AVC_SEQUENCE_HEADER, 0, avcSequenceHeader, avcSequenceHeaderSize);
+    ClearGopCache();                                      // 编码参数变化后旧 GOP 无法解码
+}
+
+/**
+ * @brief 设置 AAC Sequence Header，同时生成供观看者共享的序列头消息（推流线程调用）
+ * @param aacSequenceHeader AAC Sequence Header 数据
+ * @param aacSequenceHeaderSize 数据长度（字节）
+ */
+void RtmpSession::SetAacSequenceHeader(std::shared_ptr<char> aacSequenceHeader, uint32_t aacSequenceHeaderSize)
+{
+    aac_sequence_header_ = aacSequenceHeader;
+    aac_sequence_header_size_ = aacSequenceHeaderSize;
+    aac_sequence_packet_ = std::make_shared<RtmpMediaPacket>(RTMP_AAC_SEQUENCE_HEADER, 0, aacSequenceHeader, aacSequenceHeaderSize);
+}
+
+/**
+ * @brief 设置本会话 GOP 缓存上限，关闭后推流线程在下一帧清空缓存
+ * @param max_bytes 缓存上限（字节），0 表示关闭
+ */
+void RtmpSession::SetGopCache(uint32_t max_bytes)
+{
+    max_gop_cache_bytes_.store(max_bytes, std::memory_order_relaxed);
+}
+
+/**
+ * @brief 设置聚合窗口，关闭时窗口中剩余的消息随下一帧发出
+ * @param window_ms 窗口长度（毫秒），0 表示关闭
+ */
+void RtmpSession::SetAggregateWindow(uint32_t window_ms)
+{
+    aggregate_window_ms_.store(window_ms, std::memory_order_relaxed);
+}
+
+/**
+ * @brief 设置时移窗口，窗口时长变化时重新建立
+ * @param window_ms 窗口时长（毫秒），0 表示关闭
+ */
+void RtmpSession::SetTimeShift(uint32_t window_ms)
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (window_ms == 0)
+    {
+        time_shift_.reset();
+    }
+    else if (!time_shift_ || time_shift_->GetWindow() != window_ms)
+    {
+        time_shift_ = std::make_shared<TimeShiftBuffer>(window_ms);
+    }
+    version_.fetch_add(1, std::memory_order_release);   // 推流线程下一帧改用新的窗口
+}
+
+/**
+ * @brief 获取时移窗口
+ */
+TimeShiftBuffer::Ptr RtmpSession::GetTimeShift()
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    return time_shift_;
 }
 
 /**
  * @brief 添加一个 RTMP Sink（发布者或观看者）到会话中
+ *
+ * 复制当前连接列表、加入新连接后原子替换，正在分发的旧快照不受影响；
+ * 新观看者同时记入待同步列表，由推流线程在分发下一帧之前下发缓存的 GOP 并调用其 OnGopCacheSent，
+ * 缓存帧与实时帧都在推流线程上按顺序发出，既不重复也不遗漏
  * @param sink 要添加的连接接口
  */
 void RtmpSession::AddSink(std::shared_ptr<RtmpSink> sink)
 {
-    std::lock_guard<std::mutex> lock(mutex_);            // 加锁保护并发访问
-    rtmp_sinks_[sink->GetId()] = sink;                    // 将连接存入会话列表
+    std::lock_guard<std::mutex> lock(mutex_);            // 串行化列表修改
+    auto sinks = std::make_shared<SinkList>();
+    sinks->reserve(rtmp_sinks_->size() + 1);
+    for (auto &conn : *rtmp_sinks_)
+    {
+        if (conn->GetId() != sink->GetId())              // 同一连接重复加入时替换旧项
+        {
+            sinks->push_back(conn);
+        }
+    }
+    sinks->push_back(sink);
+    joining_.erase(std::remove_if(joining_.begin(), joining_.end(), [&sink](const std::shared_ptr<RtmpSink>& conn) {
+        return conn->GetId() == sink->GetId();
+    }), joining_.end());
     if (sink->IsPublisher())                             // 如果该连接是发布者
     {
         // 重置已存储的 Sequence Header，等待发布者重新推流
@@ -37,28 +130,74 @@ void RtmpSession::AddSink(std::shared_ptr<RtmpSink> sink)
         aac_sequence_header_.reset();
         avc_sequence_header_size_ = 0;
         aac_sequence_header_size_ = 0;
+        avc_sequence_packet_.reset();
+        aac_sequence_packet_.reset();
+        meta_data_.reset();
+        ClearGopCache();
+        aggregate_packets_.clear();
+        if (time_shift_)
+        {
+            time_shift_->Clear();                         // 新的推流与窗口中的旧数据不在同一时间轴上
+        }
         has_publisher_ = true;
         publisher_ = sink;                                // 保存发布者弱引用
+        ingest_stats_.Reset();                            // 新的推流重新统计
     }
+    else if (sink->IsPlayer())
+    {
+        joining_.push_back(sink);
+    }
+    StoreSinks(sinks);                                    // 将连接存入会话列表
 }
 
 /**
- * @brief 从会话中移除指定的 RTMP Sink
+ * @brief 从会话中移除指定的 RTMP Sink，发布者在推流线程上退出
  * @param sink 要移除的连接接口
  */
 void RtmpSession::RemoveSink(std::shared_ptr<RtmpSink> sink)
 {
-    std::lock_guard<std::mutex> lock(mutex_);            // 加锁保护并发访问
-    if (sink->IsPublisher())                             // 如果移除的是发布者
+    RtmpMediaPacket::Ptr aggregate;
+    std::shared_ptr<const SinkList> sinks;
     {
-        // 清空发布者相关的元数据缓存
-        avc_sequence_header_.reset();
-        aac_sequence_header_.reset();
-        avc_sequence_header_size_ = 0;
-        aac_sequence_header_size_ = 0;
-        has_publisher_ = false;
+        std::lock_guard<std::mutex> lock(mutex_);            // 加锁保护并发访问
+        if (sink->IsPublisher())                             // 如果移除的是发布者
+        {
+            aggregate = TakeAggregate();                      // 推流结束，聚合窗口中剩余的帧照常发出
+            // 清空发布者相关的元数据缓存
+            avc_sequence_header_.reset();
+            aac_sequence_header_.reset();
+            avc_sequence_header_size_ = 0;
+            aac_sequence_header_size_ = 0;
+            avc_sequence_packet_.reset();
+            aac_sequence_packet_.reset();
+            meta_data_.reset();
+            ClearGopCache();
+            has_publisher_ = false;
+        }
+
+        joining_.erase(std::remove_if(joining_.begin(), joining_.end(), [&sink](const std::shared_ptr<RtmpSink>& conn) {
+            return conn->GetId() == sink->GetId();
+        }), joining_.end());
+        auto new_sinks = std::make_shared<SinkList>();
+        new_sinks->reserve(rtmp_sinks_->size());
+        for (auto &conn : *rtmp_sinks_)
+        {
+            if (conn->GetId() != sink->GetId())
+            {
+                new_sinks->push_back(conn);
+            }
+        }
+        if (new_sinks->size() != rtmp_sinks_->size())
+        {
+            StoreSinks(new_sinks);                            // 从列表中删除该连接
+        }
+        sinks = rtmp_sinks_;
+    }
+
+    if (aggregate)
+    {
+        DistributePacket(sinks, aggregate, nullptr, nullptr, AGGREGATE_PLAYERS);
     }
-    rtmp_sinks_.erase(sink->GetId());                    // 从映射中删除该连接
 }
 
 /**
@@ -67,72 +206,375 @@ void RtmpSession::RemoveSink(std::shared_ptr<RtmpSink> sink)
  */
 int RtmpSession::GetClients()
 {
-    std::lock_guard<std::mutex> lock(mutex_);
-    int clients = 0;
-    for (auto &entry : rtmp_sinks_)                       // 遍历所有连接
-    {
-        if (auto conn = entry.second.lock())              // 尝试提升弱引用
-        {
-            clients++;                                    // 计数有效连接
-        }
-    }
-    return clients;
+    return (int)GetSinks()->size();                      // 连接断开时由 RemoveSink 移出列表
 }
 
 /**
- * @brief 向所有观看者发送元数据（AMF 对象），在正式推送媒体流前调用
- * @param metaData 键值对集合，包含流的属性信息
+ * @brief 向所有观看者发送元数据，在正式推送媒体流前调用（推流线程调用）
+ *
+ * 元数据消息在会话内只有一份，RTMP 观看者共享分片结果，HTTP-FLV 观看者共享 FLV tag
+ * @param meta_data RTMP_NOTIFY 消息，负载为 "onMetaData" + ECMA 数组
  */
-void RtmpSession::SendMetaData(AmfObjects &metaData)
+void RtmpSession::SendMetaData(RtmpMediaPacket::Ptr meta_data)
 {
-    std::lock_guard<std::mutex> lock(mutex_);
-    for (auto it = rtmp_sinks_.begin(); it != rtmp_sinks_.end();) 
+    SyncPublishState();
+    meta_data_ = meta_data;                               // 保存元数据，供后加入的观看者使用
+    RtmpMediaPacket::Ptr aggregate = TakeAggregate();     // 之前的帧先于元数据发出
+    if (publish_time_shift_)
     {
-        if (auto conn = it->second.lock())              // 获取强引用判断是否在线，lock是一个线程安全的操作
-        {
-            if (conn->IsPlayer())                       // 仅发送给观看者
-            {
-                conn->SendMetaData(metaData);          // 调用接口发送元数据，这里的SendMetaData是RtmpSink的虚函数
-            }
-            ++it;
-        }
-        else
+        publish_time_shift_->Append(meta_data);
+    }
+    if (aggregate)
+    {
+        DistributePacket(publish_sinks_, aggregate, nullptr, nullptr, AGGREGATE_PLAYERS);
+    }
+    for (auto &conn : *publish_sinks_)
+    {
+        if (conn->IsPlayer())                             // 仅发送给观看者
         {
-            it = rtmp_sinks_.erase(it);                 // 清理已断开的连接
+            conn->SendMetaData(meta_data);                // 调用接口发送元数据，这里的SendMetaData是RtmpSink的虚函数
         }
     }
 }
 
 /**
- * @brief 向所有观看者分发音视频数据或 Sequence Header
- * @param type RTMP 媒体类型（RTMP_AUDIO/RTMP_VIDEO/SequenceHeader ID）
+ * @brief 向所有观看者分发音视频数据或 Sequence Header（推流线程调用）
+ *
+ * 每帧只封装为一个 RtmpMediaPacket，观看者按 (out chunk size, stream id) 分组共享分片结果，
+ * 同组观看者的发送队列引用同一块缓冲区，负载只拷贝一次。
+ * 开启聚合窗口时，非关键帧先进入窗口，窗口结束时打包为一条聚合消息发给支持聚合的观看者，
+ * 其他观看者仍逐帧接收。
+ * GOP 缓存、聚合窗口与连接快照都由推流线程持有，连接列表未变化时每帧只读取一次版本号，不加锁
+ * @param type RTMP 媒体类型（RTMP_AUDIO/RTMP_VIDEO/Sequence Header ID）
  * @param timestamp 帧时间戳（毫秒）
  * @param data 媒体数据缓冲智能指针
  * @param size 缓冲区大小（字节）
  */
 void RtmpSession::SendMediaData(uint8_t type, uint64_t timestamp, std::shared_ptr<char> data, uint32_t size)
 {
-    std::lock_guard<std::mutex> lock(mutex_);
-    for (auto it = rtmp_sinks_.begin(); it != rtmp_sinks_.end();) 
+    auto packet = std::make_shared<RtmpMediaPacket>(type, timestamp, data, size);
+    SyncPublishState();
+    bool cached = CacheMediaPacket(packet);
+    RtmpMediaPacket::Ptr aggregate;
+    bool aggregated = AggregatePacket(packet, cached, aggregate);
+    if (publish_time_shift_)
+    {
+        publish_time_shift_->Append(packet);              // 推流线程顺序写入，窗口内消息与直播顺序一致
+    }
+
+    // 窗口中较早的帧先发出，当前帧进入窗口时只发给逐帧接收的观看者
+    if (aggregate)
+    {
+        DistributePacket(publish_sinks_, aggregate, aac_sequence_packet_, avc_sequence_packet_, AGGREGATE_PLAYERS);
+    }
+    DistributePacket(publish_sinks_, packet, aac_sequence_packet_, avc_sequence_packet_,
+                     aggregated ? DIRECT_PLAYERS : ALL_PLAYERS);
+}
+
+/**
+ * @brief 同步连接快照与时移窗口，版本号未变化时只有一次原子读取
+ *
+ * 新加入的观看者在加入分发快照之前先收到元数据、序列头与缓存的 GOP
+ */
+void RtmpSession::SyncPublishState()
+{
+    uint32_t version = version_.load(std::memory_order_acquire);
+    if (version == synced_version_)
+    {
+        return;
+    }
+    SinkList joining;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        synced_version_ = version_.load(std::memory_order_relaxed);
+        publish_sinks_ = rtmp_sinks_;
+        publish_time_shift_ = time_shift_;
+        joining.swap(joining_);
+    }
+    for (auto &sink : joining)
     {
-        if (auto conn = it->second.lock())              // 检查连接是否存活
+        SendGopCache(sink);
+        sink->OnGopCacheSent();
+    }
+}
+
+/**
+ * @brief 向快照中符合条件的观看者分发消息
+ *
+ * 流亲和模式下，其他线程上的观看者按线程分组，每个线程只投递一次中继任务
+ * @param sinks 连接快照
+ * @param packet 媒体消息
+ * @param aac_packet 音频序列头消息
+ * @param avc_packet 视频序列头消息
+ * @param filter 分发对象
+ */
+void RtmpSession::DistributePacket(const std::shared_ptr<const SinkList>& sinks, RtmpMediaPacket::Ptr packet,
+                                   RtmpMediaPacket::Ptr aac_packet, RtmpMediaPacket::Ptr avc_packet, SinkFilter filter)
+{
+    std::unordered_map<TaskScheduler*, std::vector<std::weak_ptr<RtmpSink>>> relays;
+    for (auto &conn : *sinks)
+    {
+        if (!conn->IsPlayer())                            // 仅对观看者推送
+        {
+            continue;
+        }
+        if (filter != ALL_PLAYERS && conn->AcceptsAggregate() != (filter == AGGREGATE_PLAYERS))
+        {
+            continue;
+        }
+        TaskScheduler* scheduler = scheduler_ ? conn->GetOwnerScheduler() : nullptr;
+        if (scheduler && scheduler != scheduler_)
+        {
+            relays[scheduler].push_back(conn);
+        }
+        else
         {
-            if (conn->IsPlayer())                       // 仅对观看者推送
+            DeliverPacket(conn, packet, aac_packet, avc_packet);
+        }
+    }
+
+    // 每个线程每帧只投递一次中继任务，观看者共享同一份分片结果
+    for (auto &relay : relays)
+    {
+        auto relay_sinks = std::move(relay.second);
+        relay.first->AddReadyTask([relay_sinks, packet, aac_packet, avc_packet]() {
+            for (auto &weak_sink : relay_sinks)
             {
-                if (!conn->IsPlaying())                // 新进入的观看者先发送缓存的 Sequence Header
+                if (auto sink = weak_sink.lock())
                 {
-                    // 先发送音频Header再发送视频Header，这里的SendMediaData是RtmpSink的虚函数
-                    conn->SendMediaData(RTMP_AAC_SEQUENCE_HEADER, timestamp, aac_sequence_header_, aac_sequence_header_size_);
-                    conn->SendMediaData(RTMP_AVC_SEQUENCE_HEADER, timestamp, avc_sequence_header_, avc_sequence_header_size_);
+                    DeliverPacket(sink, packet, aac_packet, avc_packet);
                 }
-                conn->SendMediaData(type, timestamp, data, size);  // 推送实际音视频帧
             }
-            ++it;
+        });
+    }
+}
+
+/**
+ * @brief 把媒体消息加入聚合窗口（推流线程调用）
+ *
+ * 只有普通音频帧和非关键视频帧进入窗口；关键帧与序列头到达时先发出窗口中的消息，
+ * 自身逐帧发给所有观看者，保证聚合消息不跨越关键帧，等待关键帧的新观看者不会被推迟。
+ * 窗口中首尾时间戳相差达到窗口长度（或时间戳回退）时打包发出
+ * @param packet 媒体消息
+ * @param cached 该消息是否已加入 GOP 缓存
+ * @param aggregate 输出需要先发出的聚合消息
+ * @return true 表示消息已进入窗口
+ */
+bool RtmpSession::AggregatePacket(RtmpMediaPacket::Ptr packet, bool cached, RtmpMediaPacket::Ptr& aggregate)
+{
+    uint8_t type = packet->GetType();
+    uint32_t window_ms = aggregate_window_ms_.load(std::memory_order_relaxed);
+    bool aggregatable = window_ms > 0
+                     && (type == RTMP_AUDIO || (type == RTMP_VIDEO && !packet->IsKeyFrame()));
+    if (!aggregatable)
+    {
+        aggregate = TakeAggregate();
+        return false;
+    }
+
+    uint64_t timestamp = packet->GetTimestamp();
+    if (!aggregate_packets_.empty() && timestamp + window_ms < aggregate_packets_.front()->GetTimestamp())
+    {
+        aggregate = TakeAggregate();                      // 时间戳大幅回退，视为新的时间轴
+    }
+    aggregate_packets_.push_back(packet);
+    if (cached)
+    {
+        aggregate_cached_++;
+    }
+    if (!aggregate && timestamp >= aggregate_packets_.front()->GetTimestamp() + window_ms)
+    {
+        aggregate = TakeAggregate();
+    }
+    return true;
+}
+
+/**
+ * @brief 取出聚合窗口中的消息（推流线程调用）
+ * @return 聚合消息，只有一帧时返回该帧本身，窗口为空时返回 nullptr
+ */
+RtmpMediaPacket::Ptr RtmpSession::TakeAggregate()
+{
+    RtmpMediaPacket::Ptr aggregate;
+    if (aggregate_packets_.size() == 1)
+    {
+        aggregate = aggregate_packets_.front();
+    }
+    else if (!aggregate_packets_.empty())
+    {
+        aggregate = RtmpMediaPacket::CreateAggregate(aggregate_packets_);
+    }
+    aggregate_packets_.clear();
+    aggregate_cached_ = 0;
+    return aggregate;
+}
+
+/**
+ * @brief 向单个观看者发送媒体消息
+ * @param sink 观看者
+ * @param packet 媒体消息
+ * @param aac_packet 音频序列头消息
+ * @param avc_packet 视频序列头消息
+ */
+void RtmpSession::DeliverPacket(std::shared_ptr<RtmpSink> sink, RtmpMediaPacket::Ptr packet,
+                                RtmpMediaPacket::Ptr aac_packet, RtmpMediaPacket::Ptr avc_packet)
+{
+    if (!sink->IsPlaying())                             // 新进入的观看者先发送缓存的 Sequence Header
+    {
+        // 先发送音频Header再发送视频Header，所有观看者共享同一份序列头消息
+        if (aac_packet)
+        {
+            sink->SendMediaPacket(aac_packet);
         }
-        else
+        if (avc_packet)
+        {
+            sink->SendMediaPacket(avc_packet);
+        }
+    }
+    sink->SendMediaPacket(packet);                      // 推送实际音视频帧
+}
+
+/**
+ * @brief 统计位于指定调度线程上的观看者数量
+ * @param scheduler 调度器
+ * @return 观看者数量
+ */
+int RtmpSession::GetPlayers(TaskScheduler* scheduler)
+{
+    int players = 0;
+    for (auto &conn : *GetSinks())
+    {
+        if (conn->IsPlayer() && conn->GetOwnerScheduler() == scheduler)
+        {
+            players++;
+        }
+    }
+    return players;
+}
+
+/**
+ * @brief 统计所有线程上的观看者数量
+ * @return 观看者数量
+ */
+int RtmpSession::GetPlayers()
+{
+    int players = 0;
+    for (auto &conn : *GetSinks())
+    {
+        if (conn->IsPlayer())
+        {
+            players++;
+        }
+    }
+    return players;
+}
+
+/**
+ * @brief 判断会话中是否有发布者，不要求发布者是 RtmpConnection
+ * @return true 表示有发布者
+ */
+bool RtmpSession::HasPublisher()
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    return has_publisher_;
+}
+
+/**
+ * @brief 将媒体消息加入 GOP 缓存（推流线程调用）
+ *
+ * 关键帧到达时丢弃旧缓存重新开始；超过本会话或全局上限时丢弃整个缓存，等待下一个关键帧；
+ * 缓存关闭后清空已有的缓存
+ * @param packet 媒体消息
+ * @return true 表示已加入缓存
+ */
+bool RtmpSession::CacheMediaPacket(RtmpMediaPacket::Ptr packet)
+{
+    uint32_t max_bytes = max_gop_cache_bytes_.load(std::memory_order_relaxed);
+    if (max_bytes == 0)
+    {
+        if (gop_caching_)
         {
-            it = rtmp_sinks_.erase(it);                   // 移除已断开的客户端
+            ClearGopCache();
         }
+        return false;
+    }
+
+    uint8_t type = packet->GetType();
+    if (type != RTMP_VIDEO && type != RTMP_AUDIO)
+    {
+        return false;                                     // 序列头单独保存
+    }
+
+    if (packet->IsKeyFrame())
+    {
+        ClearGopCache();
+        gop_caching_ = true;
+    }
+    if (!gop_caching_)
+    {
+        return false;
+    }
+
+    uint32_t size = packet->GetMemorySize();
+    uint64_t max_total = max_total_gop_cache_bytes_.load();
+    if (gop_cache_bytes_ + size > max_bytes
+        || (max_total > 0 && total_gop_cache_bytes_.load() + size > max_total))
+    {
+        ClearGopCache();                                  // 不完整的 GOP 没有意义，整体丢弃
+        return false;
+    }
+
+    gop_cache_.push_back(packet);
+    gop_cache_bytes_ += size;
+    total_gop_cache_bytes_ += size;
+    return true;
+}
+
+/**
+ * @brief 清空 GOP 缓存并归还全局占用（推流线程调用或处于析构中）
+ */
+void RtmpSession::ClearGopCache()
+{
+    total_gop_cache_bytes_ -= gop_cache_bytes_;
+    gop_cache_bytes_ = 0;
+    gop_cache_.clear();
+    gop_caching_ = false;
+    aggregate_cached_ = 0;                                // 聚合窗口中的帧不再位于缓存中
+}
+
+/**
+ * @brief 向新观看者下发元数据、序列头和缓存的 GOP（推流线程调用）
+ *
+ * 在该观看者进入分发快照之前完成，保证后续实时帧排在缓存帧之后
+ * @param sink 观看者
+ */
+void RtmpSession::SendGopCache(std::shared_ptr<RtmpSink> sink)
+{
+    if (meta_data_)
+    {
+        sink->SendMetaData(meta_data_);
+    }
+    if (gop_cache_.empty())
+    {
+        return;                                           // 无缓存时由实时帧触发序列头下发
+    }
+    if (aac_sequence_packet_)
+    {
+        sink->SendMediaPacket(aac_sequence_packet_);
+    }
+    if (avc_sequence_packet_)
+    {
+        sink->SendMediaPacket(avc_sequence_packet_);
+    }
+    // 聚合窗口中的帧稍后随聚合消息到达，支持聚合的观看者不再从缓存中重复发送
+    size_t count = gop_cache_.size();
+    if (aggregate_window_ms_.load(std::memory_order_relaxed) > 0 && sink->AcceptsAggregate())
+    {
+        count -= std::min(aggregate_cached_, count);
+    }
+    for (size_t i = 0; i < count; i++)
+    {
+        sink->SendMediaPacket(gop_cache_[i]);
     }
 }
 
@@ -1,6 +1,16 @@
+#include <atomic>
 #include <memory>
 #include <mutex>
+#include <unordered_map>
+#include <vector>
 #include "amf.h"
+#include "RtmpMediaPacket.h"
+#include "RtmpStreamStats.h"
+#include "TimeShiftBuffer.h"
+
+class RtmpSink;
+class RtmpConnection;
+class TaskScheduler;
 
 /**
  * @class RtmpSession
@@ -25,24 +35,81 @@ public:
      * @param avcSequenceHeader AVC Sequence Header 数据
      * @param avcSequenceHeaderSize 数据长度（字节）
      */
-    void SetAvcSequenceHeader(std::shared_ptr<char> avcSequenceHeader,uint32_t avcSequenceHeaderSize)
-    {
-        std::lock_guard<std::mutex> lock(mutex_);
-        avc_sequence_header_ = avcSequenceHeader;
-        avc_sequence_header_size_ = avcSequenceHeaderSize;
-    }
+    void SetAvcSequenceHeader(std::shared_ptr<char> avcSequenceHeader,uint32_t avcSequenceHeaderSize);
 
     /**
      * @brief 设置 AAC Sequence Header，用于后续音频流推送
      * @param aacSequenceHeader AAC Sequence Header 数据
      * @param aacSequenceHeaderSize 数据长度（字节）
      */
-    void SetAacSequenceHeader(std::shared_ptr<char> aacSequenceHeader,uint32_t aacSequenceHeaderSize)
-    {
-        std::lock_guard<std::mutex> lock(mutex_);
-        aac_sequence_header_ = aacSequenceHeader;
-        aac_sequence_header_size_ = aacSequenceHeaderSize;
-    }
+    void SetAacSequenceHeader(std::shared_ptr<char> aacSequenceHeader,uint32_t aacSequenceHeaderSize);
+
+    /**
+     * @brief 设置拥有该流的调度线程（流亲和模式）
+     *
+     * 设置后发布者与观看者迁移到该线程，分发在同一线程内完成；
+     * 仍位于其他线程的观看者按线程分组，每帧向每个线程投递一次中继任务
+     * @param scheduler 调度器，nullptr 表示关闭
+     */
+    void SetScheduler(TaskScheduler* scheduler) { scheduler_ = scheduler; }
+    TaskScheduler* GetScheduler() const { return scheduler_; }
+
+    /**
+     * @brief 统计位于指定调度线程上的观看者数量
+     * @param scheduler 调度器
+     * @return 观看者数量
+     */
+    int GetPlayers(TaskScheduler* scheduler);
+
+    /**
+     * @brief 统计所有线程上的观看者数量（含 HLS、录制等内部观看者）
+     * @return 观看者数量
+     */
+    int GetPlayers();
+
+    /**
+     * @brief 是否有发布者（推流连接或边缘回源连接）在会话中
+     * @return true 表示有发布者
+     */
+    bool HasPublisher();
+
+    /**
+     * @brief 设置本会话 GOP 缓存上限，新观看者加入时立即下发最近一个 GOP
+     * @param max_bytes 缓存上限（字节，按负载所在块的大小计，见 RtmpMediaPacket::GetMemorySize），0 表示关闭
+     */
+    void SetGopCache(uint32_t max_bytes);
+
+    /**
+     * @brief 设置聚合窗口：时间戳跨度不超过窗口的非关键帧打包为一条聚合消息，发送给支持聚合的观看者
+     *
+     * 关键帧、序列头和元数据到达时先发出已打包的消息，聚合消息不会跨越关键帧
+     * @param window_ms 窗口长度（毫秒），0 表示关闭
+     */
+    void SetAggregateWindow(uint32_t window_ms);
+
+    /**
+     * @brief 设置时移窗口：保存最近 window_ms 的音视频，观看者可落后直播播放或在窗口内回看
+     * @param window_ms 窗口时长（毫秒），0 表示关闭
+     */
+    void SetTimeShift(uint32_t window_ms);
+
+    /**
+     * @brief 获取时移窗口
+     * @return 时移窗口，未开启时返回 nullptr
+     */
+    TimeShiftBuffer::Ptr GetTimeShift();
+
+    /**
+     * @brief 设置所有会话 GOP 缓存的总上限
+     * @param max_bytes 总上限（字节），0 表示不限制
+     */
+    static void SetMaxTotalGopCacheBytes(uint64_t max_bytes) { max_total_gop_cache_bytes_ = max_bytes; }
+
+    /**
+     * @brief 获取所有会话 GOP 缓存当前占用的字节数
+     * @return 字节数
+     */
+    static uint64_t GetTotalGopCacheBytes() { return total_gop_cache_bytes_.load(); }
 
     /**
      * @brief 添加一个新的 RTMP Sink（客户端或发布者）到会话
@@ -62,11 +129,21 @@ public:
      */
     int GetClients();
 
+    using SinkList = std::vector<std::shared_ptr<RtmpSink>>;
+
     /**
-     * @brief 向所有观看者发送元数据（AmfObjects）
-     * @param metaData 元数据键值对集合
+     * @brief 获取连接列表的当前快照，快照不可修改，遍历时无需加锁
+     * @return 连接列表快照
      */
-    void SendMetaData(AmfObjects& metaData);
+    std::shared_ptr<const SinkList> GetSinks() const { return std::atomic_load(&rtmp_sinks_); }
+
+    /**
+     * @brief 向所有观看者发送元数据
+     *
+     * 元数据在推流端收到 @setDataFrame 时只封装一次，观看者和之后加入的观看者共享同一份字节
+     * @param meta_data RTMP_NOTIFY 消息，负载为 "onMetaData" + ECMA 数组
+     */
+    void SendMetaData(RtmpMediaPacket::Ptr meta_data);
 
     /**
      * @brief 向会话中的所有观看者发送音视频数据
@@ -82,14 +159,121 @@ public:
      * @return 发布者 RtmpConnection 智能指针或 nullptr
      */
     std::shared_ptr<RtmpConnection> GetPublisher();
+
+    /**
+     * @brief 获取推流统计，发布者收到音视频时更新，统计接口读取
+     * @return 推流统计
+     */
+    RtmpStreamStats& GetIngestStats() { return ingest_stats_; }
 private:
-    std::mutex mutex_;               /**< 保护 rtmp_sinks_ 及 sequence header 访问的互斥量 */
+    /**
+     * @brief 向单个观看者发送媒体消息，尚未开始播放的观看者先发送序列头
+     * @param sink 观看者
+     * @param packet 媒体消息
+     * @param aac_packet 音频序列头消息，可为空
+     * @param avc_packet 视频序列头消息，可为空
+     */
+    static void DeliverPacket(std::shared_ptr<RtmpSink> sink, RtmpMediaPacket::Ptr packet,
+                              RtmpMediaPacket::Ptr aac_packet, RtmpMediaPacket::Ptr avc_packet);
+
+    /** 分发对象：全部观看者、只接收聚合消息的观看者、逐帧接收的观看者 */
+    enum SinkFilter { ALL_PLAYERS, AGGREGATE_PLAYERS, DIRECT_PLAYERS };
+
+    /**
+     * @brief 向快照中符合条件的观看者分发消息，其他线程上的观看者按线程打包中继
+     * @param sinks 连接快照
+     * @param packet 媒体消息
+     * @param aac_packet 音频序列头消息，可为空
+     * @param avc_packet 视频序列头消息，可为空
+     * @param filter 分发对象
+     */
+    void DistributePacket(const std::shared_ptr<const SinkList>& sinks, RtmpMediaPacket::Ptr packet,
+                          RtmpMediaPacket::Ptr aac_packet, RtmpMediaPacket::Ptr avc_packet, SinkFilter filter);
+
+    /**
+     * @brief 把媒体消息加入聚合窗口（推流线程调用）
+     * @param packet 媒体消息
+     * @param cached 该消息是否已加入 GOP 缓存
+     * @param aggregate 输出需要先发出的聚合消息，无则为空
+     * @return true 表示消息已进入聚合窗口，不再逐帧发给支持聚合的观看者
+     */
+    bool AggregatePacket(RtmpMediaPacket::Ptr packet, bool cached, RtmpMediaPacket::Ptr& aggregate);
+
+    /**
+     * @brief 取出聚合窗口中的消息（推流线程调用），只有一帧时原样返回
+     * @return 聚合消息，窗口为空时返回 nullptr
+     */
+    RtmpMediaPacket::Ptr TakeAggregate();
+
+    /**
+     * @brief 以新列表替换连接快照并递增版本号（调用者持有 mutex_）
+     * @param sinks 新的连接列表
+     */
+    void StoreSinks(std::shared_ptr<const SinkList> sinks)
+    {
+        std::atomic_store(&rtmp_sinks_, sinks);
+        version_.fetch_add(1, std::memory_order_release);
+    }
+
+    /**
+     * @brief 推流线程在分发前调用：版本号未变化时直接返回，否则加锁取连接快照与时移窗口，
+     *        并向新加入的观看者下发缓存的 GOP
+     */
+    void SyncPublishState();
+
+    /**
+     * @brief 将媒体消息加入 GOP 缓存，遇到关键帧时重新开始缓存
+     * @param packet 媒体消息
+     * @return true 表示已加入缓存
+     */
+    bool CacheMediaPacket(RtmpMediaPacket::Ptr packet);
+
+    /**
+     * @brief 清空 GOP 缓存并归还全局占用
+     */
+    void ClearGopCache();
+
+    /**
+     * @brief 向新加入的观看者下发元数据、序列头和缓存的 GOP（推流线程调用）
+     * @param sink 观看者
+     */
+    void SendGopCache(std::shared_ptr<RtmpSink> sink);
+
+    std::mutex mutex_;               /**< 串行化连接增删与配置修改，推流线程只在版本号变化时加锁同步 */
     bool has_publisher_ = false;     /**< 标志是否已有发布者 */
     std::weak_ptr<RtmpSink> publisher_; /**< 发布者连接的弱引用 */
-    std::unordered_map<int,std::weak_ptr<RtmpSink>> rtmp_sinks_; /**< 会话中所有客户端连接集合 */
+    std::shared_ptr<const SinkList> rtmp_sinks_; /**< 会话中所有客户端连接的快照，增删时复制并原子替换 */
+    SinkList joining_;               /**< 已加入快照、尚待推流线程下发 GOP 缓存的观看者 */
+    std::atomic<uint32_t> version_{0}; /**< 连接快照或时移窗口每次修改后递增 */
+    TimeShiftBuffer::Ptr time_shift_;             /**< 时移窗口，未开启时为空；时移观看者持有引用，会话释放后仍可播完 */
+    std::atomic<uint32_t> max_gop_cache_bytes_{0};/**< 本会话 GOP 缓存上限，0 表示关闭 */
+    std::atomic<uint32_t> aggregate_window_ms_{0};/**< 聚合窗口（毫秒），0 表示关闭 */
+
+    // 以下为推流状态，只在推流线程上读写：发布者加入与退出时在锁内重置，推流线程在下一次同步时可见
+    uint32_t synced_version_ = 0;                 /**< 推流线程已同步的版本号 */
+    std::shared_ptr<const SinkList> publish_sinks_; /**< 推流线程分发用的连接快照 */
+    TimeShiftBuffer::Ptr publish_time_shift_;     /**< 推流线程写入的时移窗口 */
 
     std::shared_ptr<char> avc_sequence_header_;   /**< 缓存的视频 Sequence Header 数据 */
     std::shared_ptr<char> aac_sequence_header_;   /**< 缓存的音频 Sequence Header 数据 */
     uint32_t avc_sequence_header_size_ = 0;       /**< 视频序列头长度 */
     uint32_t aac_sequence_header_size_ = 0;       /**< 音频序列头长度 */
+    RtmpMediaPacket::Ptr avc_sequence_packet_;    /**< 视频序列头消息，观看者共享分片结果 */
+    RtmpMediaPacket::Ptr aac_sequence_packet_;    /**< 音频序列头消息 */
+
+    RtmpMediaPacket::Ptr meta_data_;              /**< 发布者最近一次发送的元数据，为空表示尚未收到 */
+
+    TaskScheduler* scheduler_ = nullptr;          /**< 拥有该流的调度线程，nullptr 表示不区分线程 */
+
+    std::vector<RtmpMediaPacket::Ptr> gop_cache_; /**< 从最近一个关键帧开始的音视频消息 */
+    uint64_t gop_cache_bytes_ = 0;                /**< GOP 缓存占用字节数 */
+    bool gop_caching_ = false;                    /**< 是否已从关键帧开始缓存 */
+
+    std::vector<RtmpMediaPacket::Ptr> aggregate_packets_; /**< 聚合窗口中尚未发给支持聚合的观看者的消息 */
+    size_t aggregate_cached_ = 0;                 /**< 聚合窗口中同时位于 GOP 缓存末尾的消息数 */
+
+    RtmpStreamStats ingest_stats_;                /**< 推流统计 */
+
+    static std::atomic<uint64_t> total_gop_cache_bytes_;     /**< 所有会话 GOP 缓存占用 */
+    static std::atomic<uint64_t> max_total_gop_cache_bytes_; /**< 所有会话 GOP 缓存总上限 */
 };
\ No newline at end of file
@@ -8,9 +8,13 @@
 
 #ifndef _RTMPSINK_H_
 #define _RTMPSINK_H_
+#include <atomic>
 #include <cstdint>
 #include <memory>
 #include "amf.h"
+#include "RtmpMediaPacket.h"
+
+class TaskScheduler;
 
 /**
  * @class RtmpSink
@@ -29,11 +33,12 @@ public:
     virtual ~RtmpSink(){}
 
     /**
-     * @brief 发送元数据消息（AMF 对象），在音视频正式推送前使用
-     * @param metaData 键值对集合，包含流的属性信息
+     * @brief 发送元数据消息，在音视频正式推送前使用
+     * @param meta_data 会话内共享的 RTMP_NOTIFY 消息，负载为 "onMetaData" + ECMA 数组的 AMF0 编码，
+     *                  所有观看者共享同一份字节，不得修改
      * @return true 表示发送成功或忽略
      */
-    virtual bool SendMetaData(AmfObjects metaData) {return true;}
+    virtual bool SendMetaData(RtmpMediaPacket::Ptr meta_data) {return true;}
 
     /**
      * @brief 发送音视频数据或 Sequence Header
@@ -45,6 +50,25 @@ public:
      */
     virtual bool SendMediaData(uint8_t type,uint64_t timestamp,std::shared_ptr<char> payload,uint32_t payload_size) = 0;
 
+    /**
+     * @brief 发送会话内共享的媒体消息，实现者可直接复用已分片的 chunk 缓冲区
+     * @param packet 共享的媒体消息
+     * @return true 表示发送成功
+     */
+    virtual bool SendMediaPacket(RtmpMediaPacket::Ptr packet)
+    {
+        return SendMediaData(packet->GetType(), packet->GetTimestamp(), packet->GetPayload(), packet->GetSize());
+    }
+
+    /**
+     * @brief 是否接收聚合消息（RTMP_AGGREGATE）
+     *
+     * 会话开启聚合窗口后，返回 true 的观看者收到打包后的聚合消息，其余观看者仍逐帧接收；
+     * 同一 Sink 的返回值不得变化
+     * @return true 表示接收聚合消息
+     */
+    virtual bool AcceptsAggregate() {return false;}
+
     /**
      * @brief 判断是否为播放端（观看者）
      * @return true 如果是观看者
@@ -72,5 +96,51 @@ public:
      */
     virtual uint32_t GetId() = 0;
 
+    /**
+     * @brief 获取处理该连接 IO 的调度线程，会话据此按线程中继分发
+     * @return 调度器指针，nullptr 表示不区分线程
+     */
+    virtual TaskScheduler* GetOwnerScheduler() {return nullptr;}
+
+    /**
+     * @brief 会话已向该观看者下发完缓存的 GOP（推流线程调用），之后收到的都是实时消息
+     */
+    virtual void OnGopCacheSent() {}
+
+    /**
+     * @brief 观看者的发送统计
+     */
+    struct SinkStats
+    {
+        const char* type = "";          ///< 观看者类型，如 "rtmp"、"http-flv"
+        uint64_t sent_bytes = 0;        ///< 累计写入内核的字节数
+        uint64_t pending_bytes = 0;     ///< 应用层发送队列中的字节数
+        uint32_t lag_ms = 0;            ///< 媒体队列中积压的媒体时长（毫秒）
+        uint64_t dropped_frames = 0;    ///< 累计丢弃的帧数
+        uint64_t header_bytes_saved = 0;///< chunk 头部压缩累计节省的字节数
+        uint64_t send_calls = 0;        ///< 累计调用 send 的次数
+        uint32_t unacked_bytes = 0;     ///< 已发送但播放器尚未确认的字节数，不支持时为 0
+        uint64_t delivery_rate = 0;     ///< TCP_INFO 最近的交付速率（字节/秒），未采样时为 0
+        uint32_t notsent_bytes = 0;     ///< 内核发送队列中尚未发出的字节数
+        uint32_t rendition_switches = 0;///< 自适应码率完成的档位切换次数
+    };
+
+    /**
+     * @brief 获取发送统计，供统计接口汇总（可跨线程调用）
+     * @param stats 输出的统计
+     * @return false 表示该 Sink 不提供统计
+     */
+    virtual bool GetSinkStats(SinkStats& stats) {return false;}
+
+    /**
+     * @brief 为服务端内部的 Sink（HLS 打包、录制等）分配 ID
+     * @return 从最高位开始分配的 ID，不与以 socket 作为 ID 的连接冲突
+     */
+    static uint32_t AllocInternalId()
+    {
+        static std::atomic<uint32_t> next_id(0x80000000);
+        return next_id++;
+    }
+
 };
 #endif
\ No newline at end of file
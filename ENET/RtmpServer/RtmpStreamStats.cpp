@@ -0,0 +1,136 @@
+/**
+ * @file RtmpStreamStats.cpp
+ * @brief 实现 RtmpStreamStats：窗口码率、帧率、GOP 长度与音视频偏差。
+ */
+#include "RtmpStreamStats.h"
+#include <chrono>
+
+/** 码率与帧率的统计窗口（毫秒） */
+static const int64_t kWindowMs = 1000;
+
+/**
+ * @brief 单调时钟的当前时间（毫秒）
+ */
+static int64_t GetNowMs()
+{
+    return std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+/**
+ * @brief 清空计数
+ */
+void RtmpStreamStats::Reset()
+{
+    bytes_ = 0;
+    video_frames_ = 0;
+    audio_frames_ = 0;
+    key_frames_ = 0;
+    bitrate_ = 0;
+    fps_ = 0;
+    gop_frames_ = 0;
+    gop_ms_ = 0;
+    last_video_ts_ = 0;
+    last_audio_ts_ = 0;
+    start_time_ = 0;
+    window_start_ = 0;
+    window_bytes_ = 0;
+    window_frames_ = 0;
+    frames_since_key_ = 0;
+    last_key_ts_ = 0;
+    has_key_frame_ = false;
+}
+
+/**
+ * @brief 记录一帧视频，关键帧到达时结束上一个 GOP
+ */
+void RtmpStreamStats::OnVideo(uint64_t timestamp, uint32_t size, bool key_frame)
+{
+    Add<uint64_t>(video_frames_, 1);
+    if(key_frame)
+    {
+        Add<uint64_t>(key_frames_, 1);
+        if(has_key_frame_)
+        {
+            gop_frames_.store(frames_since_key_, std::memory_order_relaxed);
+            gop_ms_.store(timestamp > last_key_ts_ ? (uint32_t)(timestamp - last_key_ts_) : 0, std::memory_order_relaxed);
+        }
+        has_key_frame_ = true;
+        frames_since_key_ = 0;
+        last_key_ts_ = timestamp;
+    }
+    frames_since_key_++;
+    window_frames_++;
+    last_video_ts_.store(timestamp, std::memory_order_relaxed);
+    Account(size);
+}
+
+/**
+ * @brief 记录一帧音频
+ */
+void RtmpStreamStats::OnAudio(uint64_t timestamp, uint32_t size)
+{
+    Add<uint64_t>(audio_frames_, 1);
+    last_audio_ts_.store(timestamp, std::memory_order_relaxed);
+    Account(size);
+}
+
+/**
+ * @brief 累加字节数，窗口满 1 秒时按实际经过时间计算码率与帧率
+ */
+void RtmpStreamStats::Account(uint32_t size)
+{
+    Add<uint64_t>(bytes_, size);
+    window_bytes_ += size;
+
+    int64_t now = GetNowMs();
+    int64_t window_start = window_start_.load(std::memory_order_relaxed);
+    if(window_start == 0)
+    {
+        start_time_.store(now, std::memory_order_relaxed);
+        window_start_.store(now, std::memory_order_relaxed);
+        return;
+    }
+    int64_t elapsed = now - window_start;
+    if(elapsed >= kWindowMs)
+    {
+        bitrate_.store((uint32_t)(window_bytes_ * 8 * 1000 / elapsed), std::memory_order_relaxed);
+        fps_.store((uint32_t)((window_frames_ * 1000 + elapsed / 2) / elapsed), std::memory_order_relaxed);
+        window_bytes_ = 0;
+        window_frames_ = 0;
+        window_start_.store(now, std::memory_order_relaxed);
+    }
+}
+
+/**
+ * @brief 读取当前统计；超过两个窗口没有新帧时码率与帧率视为 0
+ */
+RtmpStreamStats::Snapshot RtmpStreamStats::GetSnapshot() const
+{
+    Snapshot snapshot;
+    snapshot.bytes = bytes_.load(std::memory_order_relaxed);
+    snapshot.video_frames = video_frames_.load(std::memory_order_relaxed);
+    snapshot.audio_frames = audio_frames_.load(std::memory_order_relaxed);
+    snapshot.key_frames = key_frames_.load(std::memory_order_relaxed);
+    snapshot.gop_frames = gop_frames_.load(std::memory_order_relaxed);
+    snapshot.gop_ms = gop_ms_.load(std::memory_order_relaxed);
+
+    int64_t now = GetNowMs();
+    int64_t window_start = window_start_.load(std::memory_order_relaxed);
+    if(window_start != 0 && now - window_start < 2 * kWindowMs)
+    {
+        snapshot.bitrate = bitrate_.load(std::memory_order_relaxed);
+        snapshot.fps = fps_.load(std::memory_order_relaxed);
+    }
+    int64_t start_time = start_time_.load(std::memory_order_relaxed);
+    if(start_time != 0)
+    {
+        snapshot.duration_ms = (uint64_t)(now - start_time);
+    }
+    if(snapshot.video_frames > 0 && snapshot.audio_frames > 0)
+    {
+        snapshot.av_drift_ms = (int64_t)last_video_ts_.load(std::memory_order_relaxed)
+                             - (int64_t)last_audio_ts_.load(std::memory_order_relaxed);
+    }
+    return snapshot;
+}
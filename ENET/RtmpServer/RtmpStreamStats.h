@@ -0,0 +1,94 @@
+/**
+ * @file RtmpStreamStats.h
+ * @brief 推流统计：由发布者在收到音视频时更新，统计接口读取时汇总。
+ *
+ * 只有发布者所在线程写入，计数使用 relaxed 原子量，写入方不加锁；
+ * 码率与帧率按 1 秒窗口计算，GOP 长度与音视频时间戳偏差在收到帧时更新。
+ */
+
+#ifndef _RTMPSTREAMSTATS_H_
+#define _RTMPSTREAMSTATS_H_
+
+#include <atomic>
+#include <cstdint>
+
+/**
+ * @class RtmpStreamStats
+ * @brief 单条流的推流计数器，单写多读
+ */
+class RtmpStreamStats
+{
+public:
+    /** 读取时的快照 */
+    struct Snapshot
+    {
+        uint64_t bytes = 0;             ///< 累计接收的音视频负载字节数
+        uint64_t video_frames = 0;      ///< 累计视频帧数
+        uint64_t audio_frames = 0;      ///< 累计音频帧数
+        uint64_t key_frames = 0;        ///< 累计关键帧数
+        uint32_t bitrate = 0;           ///< 最近 1 秒的码率（bit/s）
+        uint32_t fps = 0;               ///< 最近 1 秒的视频帧率
+        uint32_t gop_frames = 0;        ///< 最近一个完整 GOP 的帧数
+        uint32_t gop_ms = 0;            ///< 最近一个完整 GOP 的时长（毫秒）
+        int64_t av_drift_ms = 0;        ///< 最新视频时间戳减最新音频时间戳（毫秒）
+        uint64_t duration_ms = 0;       ///< 推流持续时间（毫秒）
+    };
+
+    /**
+     * @brief 清空计数，发布者加入会话时调用
+     */
+    void Reset();
+
+    /**
+     * @brief 记录一帧视频
+     * @param timestamp 时间戳（毫秒）
+     * @param size 负载字节数
+     * @param key_frame 是否为关键帧
+     */
+    void OnVideo(uint64_t timestamp, uint32_t size, bool key_frame);
+
+    /**
+     * @brief 记录一帧音频
+     * @param timestamp 时间戳（毫秒）
+     * @param size 负载字节数
+     */
+    void OnAudio(uint64_t timestamp, uint32_t size);
+
+    /**
+     * @brief 读取当前统计（可跨线程调用）
+     */
+    Snapshot GetSnapshot() const;
+
+private:
+    /**
+     * @brief 累加字节数并在窗口满 1 秒时更新码率与帧率
+     */
+    void Account(uint32_t size);
+
+    template<typename T>
+    static void Add(std::atomic<T>& counter, T value)
+    { counter.store(counter.load(std::memory_order_relaxed) + value, std::memory_order_relaxed); }
+
+    // 前后各留一个缓存行，发布者频繁写入的计数不与会话的其他成员伪共享
+    char pad_front_[64];
+    std::atomic<uint64_t> bytes_{0};
+    std::atomic<uint64_t> video_frames_{0};
+    std::atomic<uint64_t> audio_frames_{0};
+    std::atomic<uint64_t> key_frames_{0};
+    std::atomic<uint32_t> bitrate_{0};
+    std::atomic<uint32_t> fps_{0};
+    std::atomic<uint32_t> gop_frames_{0};
+    std::atomic<uint32_t> gop_ms_{0};
+    std::atomic<uint64_t> last_video_ts_{0};
+    std::atomic<uint64_t> last_audio_ts_{0};
+    std::atomic<int64_t> start_time_{0};        ///< 推流开始时间（毫秒），0 表示尚未收到帧
+    std::atomic<int64_t> window_start_{0};      ///< 当前窗口开始时间（毫秒），只由写入方访问
+    uint64_t window_bytes_ = 0;                 ///< 当前窗口内的字节数，只由写入方访问
+    uint32_t window_frames_ = 0;                ///< 当前窗口内的视频帧数，只由写入方访问
+    uint32_t frames_since_key_ = 0;             ///< 上个关键帧以来的视频帧数，只由写入方访问
+    uint64_t last_key_ts_ = 0;                  ///< 上个关键帧的时间戳，只由写入方访问
+    bool has_key_frame_ = false;                ///< 是否收到过关键帧，只由写入方访问
+    char pad_back_[64];
+};
+
+#endif // _RTMPSTREAMSTATS_H_
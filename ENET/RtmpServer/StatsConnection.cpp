@@ -0,0 +1,160 @@
+/**
+ * @file StatsConnection.cpp
+ * @brief 实现 StatsConnection：请求路由与响应。
+ */
+#include "StatsConnection.h"
+#include "StatsServer.h"
+#include <cstdio>
+#include <sstream>
+#include <strings.h>
+
+/** 请求头最大长度，超过时视为无效请求 */
+static const uint32_t kMaxRequestSize = 8192;
+
+/**
+ * @brief 构造函数，注册读回调
+ */
+StatsConnection::StatsConnection(std::shared_ptr<StatsServer> stats_server, TaskScheduler* scheduler, int socket)
+    :TcpConnection(scheduler, socket)
+    ,stats_server_(stats_server)
+{
+    this->SetReadCallback([this](std::shared_ptr<TcpConnection> conn, BufferReader& buffer){
+        return this->OnRead(buffer);
+    });
+}
+
+/**
+ * @brief 析构函数
+ */
+StatsConnection::~StatsConnection()
+{
+}
+
+/**
+ * @brief 依次处理缓冲区中的完整请求；统计未返回前保留后续请求
+ * @param buffer 输入缓冲区
+ * @return false 表示需要断开连接
+ */
+bool StatsConnection::OnRead(BufferReader& buffer)
+{
+    while(!pending_ && buffer.ReadableBytes() > 0)
+    {
+        std::string data(buffer.Peek(), buffer.ReadableBytes());
+        size_t pos = data.find("\r\n\r\n");
+        if(pos == std::string::npos)
+        {
+            if(data.size() > kMaxRequestSize)
+            {
+                SendErrorResponse(400, "Bad Request");
+                return false;
+            }
+            return true;                              // 请求头不完整，等待更多数据
+        }
+        buffer.Retrieve(pos + 4);
+        if(!HandleRequest(data.substr(0, pos)))
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+/**
+ * @brief 路由请求：/stats、/metrics
+ * @param request 请求头（不含结尾空行）
+ * @return false 表示需要断开连接
+ */
+bool StatsConnection::HandleRequest(const std::string& request)
+{
+    auto server = stats_server_.lock();
+    if(!server)
+    {
+        return false;
+    }
+
+    std::istringstream stream(request);
+    std::string method, url, version;
+    stream >> method >> url >> version;
+
+    // HTTP/1.1 默认长连接，HTTP/1.0 或 "Connection: close" 时响应后断开
+    keep_alive_ = version == "HTTP/1.1";
+    std::string line;
+    while(std::getline(stream, line))
+    {
+        if(line.size() > 11 && strncasecmp(line.c_str(), "connection:", 11) == 0)
+        {
+            keep_alive_ = line.find("close") == std::string::npos && line.find("Close") == std::string::npos;
+        }
+    }
+
+    if(method != "GET")
+    {
+        SendErrorResponse(405, "Method Not Allowed");
+        return false;
+    }
+
+    size_t query_pos = url.find('?');
+    if(query_pos != std::string::npos)
+    {
+        url = url.substr(0, query_pos);
+    }
+
+    if(url != "/stats" && url != "/metrics")
+    {
+        SendErrorResponse(404, "Not Found");
+        return keep_alive_;
+    }
+
+    // 多进程模式下需要等待其他工作进程的统计，响应前保留后续请求
+    const char* content_type = url == "/stats" ? "application/json" : "text/plain; version=0.0.4";
+    std::weak_ptr<TcpConnection> weak_conn = shared_from_this();
+    pending_ = true;
+    server->Collect(url, GetTaskSchduler(), [weak_conn, content_type](const std::string& body){
+        auto conn = weak_conn.lock();
+        if(!conn || conn->IsClosed())
+        {
+            return;
+        }
+        auto stats_conn = std::static_pointer_cast<StatsConnection>(conn);
+        stats_conn->pending_ = false;
+        stats_conn->SendResponse(content_type, body);
+        if(!stats_conn->keep_alive_)
+        {
+            stats_conn->DisConnect();
+        }
+    });
+    return keep_alive_ || pending_;
+}
+
+/**
+ * @brief 发送 200 响应
+ */
+void StatsConnection::SendResponse(const char* content_type, const std::string& body)
+{
+    char header[512] = {0};
+    int size = snprintf(header, sizeof(header),
+                        "HTTP/1.1 200 OK\r\n"
+                        "Content-Type: %s\r\n"
+                        "Content-Length: %u\r\n"
+                        "Cache-Control: no-cache\r\n"
+                        "Access-Control-Allow-Origin: *\r\n"
+                        "Connection: %s\r\n\r\n",
+                        content_type, (uint32_t)body.size(), keep_alive_ ? "keep-alive" : "close");
+    this->Send(header, (uint32_t)size);
+    if(!body.empty())
+    {
+        this->Send(body.data(), (uint32_t)body.size());
+    }
+}
+
+/**
+ * @brief 发送错误响应
+ */
+void StatsConnection::SendErrorResponse(int code, const char* reason)
+{
+    char response[256] = {0};
+    int size = snprintf(response, sizeof(response),
+                        "HTTP/1.1 %d %s\r\nContent-Length: 0\r\nAccess-Control-Allow-Origin: *\r\nConnection: %s\r\n\r\n",
+                        code, reason, keep_alive_ ? "keep-alive" : "close");
+    this->Send(response, (uint32_t)size);
+}
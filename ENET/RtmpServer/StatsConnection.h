@@ -0,0 +1,72 @@
+/**
+ * @file StatsConnection.h
+ * @brief 统计接口的 HTTP 连接：解析请求，返回 JSON 或 Prometheus 文本。
+ *
+ * 支持 HTTP/1.1 长连接，请求处理方式与 HlsConnection 相同；
+ * 多进程模式下统计由 StatsServer::Collect 异步汇总，返回前不处理同一连接上的后续请求。
+ */
+
+#ifndef _STATSCONNECTION_H_
+#define _STATSCONNECTION_H_
+
+#include "../EdoyunNet/TcpConnection.h"
+#include <memory>
+#include <string>
+
+class StatsServer;
+
+/**
+ * @class StatsConnection
+ * @brief 继承自 TcpConnection，处理 /stats 与 /metrics 请求
+ */
+class StatsConnection : public TcpConnection
+{
+public:
+    /**
+     * @brief 构造函数
+     * @param stats_server 生成统计的服务
+     * @param scheduler 调度器
+     * @param socket 底层 TCP 套接字
+     */
+    StatsConnection(std::shared_ptr<StatsServer> stats_server, TaskScheduler* scheduler, int socket);
+
+    /**
+     * @brief 析构函数
+     */
+    virtual ~StatsConnection();
+
+private:
+    /**
+     * @brief 读取并依次处理完整的请求
+     * @param buffer 输入缓冲区
+     * @return false 表示需要断开连接
+     */
+    bool OnRead(BufferReader& buffer);
+
+    /**
+     * @brief 处理一个请求
+     * @param request 请求头（不含结尾空行）
+     * @return false 表示需要断开连接
+     */
+    bool HandleRequest(const std::string& request);
+
+    /**
+     * @brief 发送 200 响应
+     * @param content_type Content-Type
+     * @param body 响应体
+     */
+    void SendResponse(const char* content_type, const std::string& body);
+
+    /**
+     * @brief 发送错误响应
+     * @param code HTTP 状态码
+     * @param reason 状态描述
+     */
+    void SendErrorResponse(int code, const char* reason);
+
+    std::weak_ptr<StatsServer> stats_server_;   ///< 所属统计服务
+    bool keep_alive_ = true;                    ///< 当前请求是否保持连接
+    bool pending_ = false;                      ///< 是否在等待汇总的统计，只在所属调度线程中访问
+};
+
+#endif // _STATSCONNECTION_H_
@@ -0,0 +1,115 @@
+/**
+ * @file StatsPeerClient.cpp
+ * @brief 实现 StatsPeerClient：发送请求、按 Content-Length 读取响应与超时断开。
+ */
+#include "StatsPeerClient.h"
+#include <cstdlib>
+#include <strings.h>
+
+/** 响应最大长度，超过时视为无效 */
+static const size_t kMaxResponseSize = 64 * 1024 * 1024;
+
+/**
+ * @brief 发起连接并发送请求，连接完成前的请求在可写后发出
+ */
+std::shared_ptr<StatsPeerClient> StatsPeerClient::Create(TaskScheduler* scheduler, uint16_t port, const std::string& url,
+                                                         uint32_t timeout_ms, const Callback& callback)
+{
+    int sockfd = SocketUtil::Connect("127.0.0.1", port);
+    if(sockfd < 0)
+    {
+        callback(false, std::string());
+        return nullptr;
+    }
+
+    std::shared_ptr<StatsPeerClient> client(new StatsPeerClient(scheduler, sockfd, callback));
+    std::string request = "GET " + url + " HTTP/1.1\r\nHost: 127.0.0.1\r\n\r\n";
+    client->Send(request.c_str(), (uint32_t)request.size());
+
+    // 定时器持有客户端直到超时，期间未完成的请求按失败回调
+    scheduler->AddTimer([client](){
+        client->DisConnect();
+        return false;
+    }, timeout_ms);
+    return client;
+}
+
+/**
+ * @brief 构造函数，注册读回调与关闭回调
+ */
+StatsPeerClient::StatsPeerClient(TaskScheduler* scheduler, int socket, const Callback& callback)
+    :TcpConnection(scheduler, socket)
+    ,callback_(callback)
+{
+    this->SetReadCallback([this](std::shared_ptr<TcpConnection> conn, BufferReader& buffer){
+        return this->OnRead(buffer);
+    });
+    this->SetCloseCallback([this](std::shared_ptr<TcpConnection> conn){
+        this->Finish(false, std::string());
+    });
+}
+
+/**
+ * @brief 析构函数
+ */
+StatsPeerClient::~StatsPeerClient()
+{
+}
+
+/**
+ * @brief 累积响应并检查是否完整
+ */
+bool StatsPeerClient::OnRead(BufferReader& buffer)
+{
+    response_.append(buffer.Peek(), buffer.ReadableBytes());
+    buffer.RetrieveAll();
+
+    size_t header_end = response_.find("\r\n\r\n");
+    if(header_end == std::string::npos)
+    {
+        return response_.size() <= kMaxResponseSize;
+    }
+    if(response_.compare(0, 12, "HTTP/1.1 200") != 0)
+    {
+        Finish(false, std::string());
+        return false;
+    }
+
+    size_t content_length = 0;
+    size_t pos = 0;
+    while(pos < header_end)
+    {
+        size_t end = response_.find("\r\n", pos);
+        if(end - pos > 15 && strncasecmp(response_.c_str() + pos, "content-length:", 15) == 0)
+        {
+            content_length = (size_t)strtoull(response_.c_str() + pos + 15, nullptr, 10);
+        }
+        pos = end + 2;
+    }
+    if(content_length > kMaxResponseSize)
+    {
+        Finish(false, std::string());
+        return false;
+    }
+    if(response_.size() - header_end - 4 < content_length)
+    {
+        return true;                                    // 响应体不完整，等待更多数据
+    }
+    Finish(true, response_.substr(header_end + 4, content_length));
+    return false;
+}
+
+/**
+ * @brief 回调结果并释放回调持有的对象
+ */
+void StatsPeerClient::Finish(bool ok, const std::string& body)
+{
+    if(finished_)
+    {
+        return;
+    }
+    finished_ = true;
+    Callback callback;
+    callback.swap(callback_);
+    callback(ok, body);
+}
@@ -0,0 +1,64 @@
+/**
+ * @file StatsPeerClient.h
+ * @brief 多进程模式下向其他工作进程的统计端口（回环地址）发起一次 HTTP GET，取回响应体。
+ */
+
+#ifndef _STATSPEERCLIENT_H_
+#define _STATSPEERCLIENT_H_
+
+#include "../EdoyunNet/TcpConnection.h"
+#include <functional>
+#include <memory>
+#include <string>
+
+/**
+ * @class StatsPeerClient
+ * @brief 继承自 TcpConnection 的一次性 HTTP 客户端，按 Content-Length 读完响应后断开
+ */
+class StatsPeerClient : public TcpConnection
+{
+public:
+    /** 完成回调：ok 为 false 表示连接失败、超时或响应不是 200 */
+    using Callback = std::function<void(bool ok, const std::string& body)>;
+
+    /**
+     * @brief 连接 127.0.0.1:port 并发送请求，回调在 scheduler 线程中执行且只执行一次
+     * @param scheduler 调度器
+     * @param port 对端端口
+     * @param url 请求路径
+     * @param timeout_ms 超时时间（毫秒）
+     * @param callback 完成回调；连接立即失败时同步回调并返回 nullptr
+     * @return 客户端，由超时定时器持有到超时为止
+     */
+    static std::shared_ptr<StatsPeerClient> Create(TaskScheduler* scheduler, uint16_t port, const std::string& url,
+                                                   uint32_t timeout_ms, const Callback& callback);
+
+    /**
+     * @brief 析构函数
+     */
+    virtual ~StatsPeerClient();
+
+private:
+    /**
+     * @brief 私有构造
+     */
+    StatsPeerClient(TaskScheduler* scheduler, int socket, const Callback& callback);
+
+    /**
+     * @brief 累积响应，响应头与 Content-Length 指定的响应体完整后回调
+     * @param buffer 输入缓冲区
+     * @return false 表示响应已完整或无效，断开连接
+     */
+    bool OnRead(BufferReader& buffer);
+
+    /**
+     * @brief 回调结果，只执行一次
+     */
+    void Finish(bool ok, const std::string& body);
+
+    Callback callback_;                 ///< 完成回调
+    std::string response_;              ///< 已收到的响应
+    bool finished_ = false;             ///< 是否已回调
+};
+
+#endif // _STATSPEERCLIENT_H_
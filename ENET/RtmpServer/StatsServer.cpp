@@ -0,0 +1,400 @@
+/**
+ * @file StatsServer.cpp
+ * @brief 实现 StatsServer：汇总 RtmpServer 统计并生成 JSON 与 Prometheus 文本。
+ */
+#include "StatsServer.h"
+#include "StatsConnection.h"
+#include "StatsPeerClient.h"
+#include "RtmpServer.h"
+#include "../EdoyunNet/EventLoop.h"
+#include <cinttypes>
+#include <cstdarg>
+#include <cstdio>
+#include <map>
+#include <sstream>
+#include <vector>
+
+/** 等待其他工作进程统计的超时（毫秒），超时的工作进程按不可用输出 */
+static const uint32_t kPeerTimeoutMs = 1000;
+
+/**
+ * @brief 转义 JSON 字符串与 Prometheus 标签值中的引号、反斜杠和控制字符
+ */
+static std::string Escape(const std::string& value)
+{
+    std::string result;
+    result.reserve(value.size());
+    for(char c : value)
+    {
+        if(c == '"' || c == '\\')
+        {
+            result += '\\';
+            result += c;
+        }
+        else if((unsigned char)c < 0x20)
+        {
+            char hex[8] = {0};
+            snprintf(hex, sizeof(hex), "\\u%04x", (unsigned char)c);
+            result += hex;
+        }
+        else
+        {
+            result += c;
+        }
+    }
+    return result;
+}
+
+/**
+ * @brief 按 printf 格式追加文本
+ */
+static void Append(std::string& out, const char* format, ...) __attribute__((format(printf, 2, 3)));
+static void Append(std::string& out, const char* format, ...)
+{
+    char buf[512] = {0};
+    va_list args;
+    va_start(args, format);
+    int size = vsnprintf(buf, sizeof(buf), format, args);
+    va_end(args);
+    if(size > 0)
+    {
+        out.append(buf, size < (int)sizeof(buf) ? size : (int)sizeof(buf) - 1);
+    }
+}
+
+/** 单条流的观看者统计汇总 */
+struct ViewerTotals
+{
+    uint64_t sent_bytes = 0;
+    uint64_t pending_bytes = 0;
+    uint64_t dropped_frames = 0;
+    uint64_t header_bytes_saved = 0;
+    uint64_t send_calls = 0;
+    uint32_t max_lag_ms = 0;
+    uint32_t max_unacked_bytes = 0;
+};
+
+/** 按流输出的 Prometheus 指标 */
+struct StreamMetric
+{
+    const char* name;
+    const char* type;
+    int64_t (*value)(const RtmpServer::StreamStats& stream, const ViewerTotals& totals);
+};
+
+static const StreamMetric kStreamMetrics[] = {
+    {"rtmp_stream_publishing", "gauge",
+     [](const RtmpServer::StreamStats& s, const ViewerTotals&) -> int64_t { return s.has_publisher ? 1 : 0; }},
+    {"rtmp_stream_players", "gauge",
+     [](const RtmpServer::StreamStats& s, const ViewerTotals&) -> int64_t { return s.players; }},
+    {"rtmp_stream_ingest_bytes_total", "counter",
+     [](const RtmpServer::StreamStats& s, const ViewerTotals&) -> int64_t { return (int64_t)s.ingest.bytes; }},
+    {"rtmp_stream_ingest_bitrate_bps", "gauge",
+     [](const RtmpServer::StreamStats& s, const ViewerTotals&) -> int64_t { return s.ingest.bitrate; }},
+    {"rtmp_stream_ingest_fps", "gauge",
+     [](const RtmpServer::StreamStats& s, const ViewerTotals&) -> int64_t { return s.ingest.fps; }},
+    {"rtmp_stream_gop_frames", "gauge",
+     [](const RtmpServer::StreamStats& s, const ViewerTotals&) -> int64_t { return s.ingest.gop_frames; }},
+    {"rtmp_stream_gop_ms", "gauge",
+     [](const RtmpServer::StreamStats& s, const ViewerTotals&) -> int64_t { return s.ingest.gop_ms; }},
+    {"rtmp_stream_av_drift_ms", "gauge",
+     [](const RtmpServer::StreamStats& s, const ViewerTotals&) -> int64_t { return s.ingest.av_drift_ms; }},
+    {"rtmp_stream_egress_bytes_total", "counter",
+     [](const RtmpServer::StreamStats&, const ViewerTotals& t) -> int64_t { return (int64_t)t.sent_bytes; }},
+    {"rtmp_stream_egress_pending_bytes", "gauge",
+     [](const RtmpServer::StreamStats&, const ViewerTotals& t) -> int64_t { return (int64_t)t.pending_bytes; }},
+    {"rtmp_stream_viewer_max_lag_ms", "gauge",
+     [](const RtmpServer::StreamStats&, const ViewerTotals& t) -> int64_t { return t.max_lag_ms; }},
+    {"rtmp_stream_viewer_max_unacked_bytes", "gauge",
+     [](const RtmpServer::StreamStats&, const ViewerTotals& t) -> int64_t { return t.max_unacked_bytes; }},
+    {"rtmp_stream_dropped_frames_total", "counter",
+     [](const RtmpServer::StreamStats&, const ViewerTotals& t) -> int64_t { return (int64_t)t.dropped_frames; }},
+    {"rtmp_stream_chunk_header_saved_bytes_total", "counter",
+     [](const RtmpServer::StreamStats&, const ViewerTotals& t) -> int64_t { return (int64_t)t.header_bytes_saved; }},
+    {"rtmp_stream_egress_send_calls_total", "counter",
+     [](const RtmpServer::StreamStats&, const ViewerTotals& t) -> int64_t { return (int64_t)t.send_calls; }},
+};
+
+/** 一次请求中各工作进程的统计，只在请求所在的调度线程中访问 */
+struct WorkerResults
+{
+    std::vector<std::string> bodies;            ///< 各工作进程的响应体
+    std::vector<bool> ok;                       ///< 各工作进程是否返回了统计
+    uint32_t remaining = 0;                     ///< 尚未返回的工作进程数
+    bool is_json = true;                        ///< 请求 /stats 还是 /metrics
+    std::function<void(const std::string&)> callback;
+};
+
+/**
+ * @brief 合并为 {"workers":[{"worker":i,"stats":对象或 null}, ...]}
+ */
+static std::string MergeJson(const WorkerResults& results)
+{
+    std::string out = "{\"workers\":[";
+    for(size_t i = 0; i < results.bodies.size(); i++)
+    {
+        std::string body = results.bodies[i];
+        while(!body.empty() && (body.back() == '\n' || body.back() == '\r'))
+        {
+            body.pop_back();
+        }
+        Append(out, "%s{\"worker\":%u,\"stats\":", i == 0 ? "" : ",", (uint32_t)i);
+        out += results.ok[i] && !body.empty() ? body : "null";
+        out += "}";
+    }
+    out += "]}\n";
+    return out;
+}
+
+/**
+ * @brief 合并 Prometheus 文本：样本加上 worker 标签，同一指标各工作进程的样本连续输出，
+ *        另输出 rtmp_worker_up 标记各工作进程是否返回了统计
+ */
+static std::string MergeMetrics(const WorkerResults& results)
+{
+    std::string out = "# TYPE rtmp_worker_up gauge\n";
+    for(size_t i = 0; i < results.bodies.size(); i++)
+    {
+        Append(out, "rtmp_worker_up{worker=\"%u\"} %d\n", (uint32_t)i, results.ok[i] ? 1 : 0);
+    }
+
+    std::vector<std::string> names;                                     // 指标按首次出现的顺序输出
+    std::map<std::string, std::pair<std::string, std::string>> families;  // 指标名 -> (TYPE 行, 样本)
+    for(size_t i = 0; i < results.bodies.size(); i++)
+    {
+        if(!results.ok[i])
+        {
+            continue;
+        }
+        std::string label = "worker=\"" + std::to_string(i) + "\"";
+        std::string family;
+        std::istringstream lines(results.bodies[i]);
+        std::string line;
+        while(std::getline(lines, line))
+        {
+            if(line.compare(0, 7, "# TYPE ") == 0)
+            {
+                family = line.substr(7, line.find(' ', 7) - 7);
+                if(families.find(family) == families.end())
+                {
+                    names.push_back(family);
+                    families[family].first = line + "\n";
+                }
+                continue;
+            }
+            size_t name_end = line.find_first_of("{ ");
+            if(line.empty() || line[0] == '#' || name_end == std::string::npos)
+            {
+                continue;
+            }
+            std::string name = line.substr(0, name_end);
+            std::string key = family.empty() ? name : family;
+            if(families.find(key) == families.end())
+            {
+                names.push_back(key);
+            }
+            std::string sample = name + "{" + label;
+            if(line[name_end] == '{')
+            {
+                sample += line[name_end + 1] == '}' ? line.substr(name_end + 1) : "," + line.substr(name_end + 1);
+            }
+            else
+            {
+                sample += "}" + line.substr(name_end);
+            }
+            families[key].second += sample + "\n";
+        }
+    }
+    for(auto &name : names)
+    {
+        out += families[name].first + families[name].second;
+    }
+    return out;
+}
+
+/**
+ * @brief 静态工厂方法，创建统计服务实例
+ */
+std::shared_ptr<StatsServer> StatsServer::Create(EventLoop* eventloop, std::shared_ptr<RtmpServer> rtmp_server)
+{
+    return std::shared_ptr<StatsServer>(new StatsServer(eventloop, rtmp_server));
+}
+
+/**
+ * @brief 私有构造函数
+ */
+StatsServer::StatsServer(EventLoop* eventloop, std::shared_ptr<RtmpServer> rtmp_server)
+    :TcpServer(eventloop)
+    ,loop_(eventloop)
+    ,rtmp_server_(rtmp_server)
+{
+}
+
+/**
+ * @brief 析构函数
+ */
+StatsServer::~StatsServer()
+{
+}
+
+/**
+ * @brief 生成 JSON：服务级计数、每条流的推流统计与各观看者的发送统计
+ */
+std::string StatsServer::GetJson()
+{
+    auto rtmp_server = rtmp_server_.lock();
+    if(!rtmp_server)
+    {
+        return std::string();
+    }
+    RtmpServer::Stats stats = rtmp_server->GetStats();
+
+    std::string out;
+    Append(out, "{\"chunk_errors\":%" PRIu64 ",\"message_errors\":%" PRIu64 ",\"gop_cache_bytes\":%" PRIu64
+           ",\"buffer_pool_bytes\":%" PRIu64 ",\"vod_files\":%u,\"vod_mapped_bytes\":%" PRIu64
+           ",\"time_shift_bytes\":%" PRIu64 ",\"time_shift_evicted_gops\":%" PRIu64 ",\"streams\":[",
+           stats.chunk_errors, stats.message_errors, stats.gop_cache_bytes, stats.buffer_pool_bytes, stats.vod_files, stats.vod_mapped_bytes,
+           stats.time_shift_bytes, stats.time_shift_evicted_gops);
+    for(size_t i = 0; i < stats.streams.size(); i++)
+    {
+        const RtmpServer::StreamStats& stream = stats.streams[i];
+        const RtmpStreamStats::Snapshot& ingest = stream.ingest;
+        out += i == 0 ? "{" : ",{";
+        out += "\"stream\":\"" + Escape(stream.stream_path) + "\"";
+        Append(out, ",\"publishing\":%s,\"players\":%d", stream.has_publisher ? "true" : "false", stream.players);
+        Append(out, ",\"ingest\":{\"bytes\":%" PRIu64 ",\"bitrate\":%u,\"fps\":%u,\"video_frames\":%" PRIu64
+               ",\"audio_frames\":%" PRIu64 ",\"key_frames\":%" PRIu64 ",\"gop_frames\":%u,\"gop_ms\":%u"
+               ",\"av_drift_ms\":%" PRId64 ",\"duration_ms\":%" PRIu64 "}",
+               ingest.bytes, ingest.bitrate, ingest.fps, ingest.video_frames, ingest.audio_frames, ingest.key_frames,
+               ingest.gop_frames, ingest.gop_ms, ingest.av_drift_ms, ingest.duration_ms);
+        out += ",\"viewers\":[";
+        for(size_t j = 0; j < stream.viewers.size(); j++)
+        {
+            const RtmpSink::SinkStats& viewer = stream.viewers[j];
+            Append(out, "%s{\"type\":\"%s\",\"sent_bytes\":%" PRIu64 ",\"pending_bytes\":%" PRIu64
+                   ",\"lag_ms\":%u,\"dropped_frames\":%" PRIu64 ",\"header_bytes_saved\":%" PRIu64
+                   ",\"send_calls\":%" PRIu64 ",\"unacked_bytes\":%u,\"delivery_rate\":%" PRIu64
+                   ",\"notsent_bytes\":%u,\"rendition_switches\":%u}",
+                   j == 0 ? "" : ",", viewer.type, viewer.sent_bytes, viewer.pending_bytes,
+                   viewer.lag_ms, viewer.dropped_frames, viewer.header_bytes_saved, viewer.send_calls,
+                   viewer.unacked_bytes, viewer.delivery_rate, viewer.notsent_bytes, viewer.rendition_switches);
+        }
+        out += "]}";
+    }
+    out += "]}\n";
+    return out;
+}
+
+/**
+ * @brief 生成 Prometheus 文本；观看者统计按流求和或取最大值，不为单个连接输出时间序列
+ */
+std::string StatsServer::GetMetrics()
+{
+    auto rtmp_server = rtmp_server_.lock();
+    if(!rtmp_server)
+    {
+        return std::string();
+    }
+    RtmpServer::Stats stats = rtmp_server->GetStats();
+
+    std::string out;
+    Append(out, "# TYPE rtmp_chunk_errors_total counter\nrtmp_chunk_errors_total %" PRIu64 "\n", stats.chunk_errors);
+    Append(out, "# TYPE rtmp_message_errors_total counter\nrtmp_message_errors_total %" PRIu64 "\n", stats.message_errors);
+    Append(out, "# TYPE rtmp_gop_cache_bytes gauge\nrtmp_gop_cache_bytes %" PRIu64 "\n", stats.gop_cache_bytes);
+    Append(out, "# TYPE rtmp_buffer_pool_bytes gauge\nrtmp_buffer_pool_bytes %" PRIu64 "\n", stats.buffer_pool_bytes);
+    Append(out, "# TYPE rtmp_vod_files gauge\nrtmp_vod_files %u\n", stats.vod_files);
+    Append(out, "# TYPE rtmp_vod_mapped_bytes gauge\nrtmp_vod_mapped_bytes %" PRIu64 "\n", stats.vod_mapped_bytes);
+    Append(out, "# TYPE rtmp_time_shift_bytes gauge\nrtmp_time_shift_bytes %" PRIu64 "\n", stats.time_shift_bytes);
+    Append(out, "# TYPE rtmp_time_shift_evicted_gops_total counter\nrtmp_time_shift_evicted_gops_total %" PRIu64 "\n",
+           stats.time_shift_evicted_gops);
+    Append(out, "# TYPE rtmp_streams gauge\nrtmp_streams %u\n", (uint32_t)stats.streams.size());
+
+    // 观看者统计先按流汇总
+    std::vector<ViewerTotals> totals(stats.streams.size());
+    for(size_t i = 0; i < stats.streams.size(); i++)
+    {
+        for(auto &viewer : stats.streams[i].viewers)
+        {
+            totals[i].sent_bytes += viewer.sent_bytes;
+            totals[i].pending_bytes += viewer.pending_bytes;
+            totals[i].dropped_frames += viewer.dropped_frames;
+            totals[i].header_bytes_saved += viewer.header_bytes_saved;
+            totals[i].send_calls += viewer.send_calls;
+            totals[i].max_lag_ms = viewer.lag_ms > totals[i].max_lag_ms ? viewer.lag_ms : totals[i].max_lag_ms;
+            totals[i].max_unacked_bytes = viewer.unacked_bytes > totals[i].max_unacked_bytes
+                                        ? viewer.unacked_bytes : totals[i].max_unacked_bytes;
+        }
+    }
+
+    // 同一指标的样本需连续输出，按指标遍历各流
+    for(auto &metric : kStreamMetrics)
+    {
+        Append(out, "# TYPE %s %s\n", metric.name, metric.type);
+        for(size_t i = 0; i < stats.streams.size(); i++)
+        {
+            Append(out, "%s{stream=\"%s\"} %" PRId64 "\n", metric.name,
+                   Escape(stats.streams[i].stream_path).c_str(), metric.value(stats.streams[i], totals[i]));
+        }
+    }
+    return out;
+}
+
+/**
+ * @brief 设置各工作进程统计实例的回环端口
+ */
+void StatsServer::SetWorkerPeers(int worker_id, uint32_t workers, uint16_t base_port)
+{
+    worker_id_ = worker_id;
+    workers_ = workers;
+    peer_base_port_ = base_port;
+}
+
+/**
+ * @brief 生成本进程统计，多进程模式下并发向其他工作进程取统计，全部返回或超时后合并
+ */
+void StatsServer::Collect(const std::string& url, TaskScheduler* scheduler, const std::function<void(const std::string&)>& callback)
+{
+    bool is_json = url == "/stats";
+    std::string local = is_json ? GetJson() : GetMetrics();
+    if(worker_id_ < 0 || (uint32_t)worker_id_ >= workers_ || workers_ <= 1)
+    {
+        callback(local);
+        return;
+    }
+
+    // 各工作进程的结果都在 scheduler 线程中回调（连接立即失败时在当前线程，即同一线程），无需加锁
+    auto results = std::make_shared<WorkerResults>();
+    results->bodies.resize(workers_);
+    results->ok.resize(workers_, false);
+    results->bodies[worker_id_] = local;
+    results->ok[worker_id_] = !local.empty();
+    results->remaining = workers_ - 1;
+    results->is_json = is_json;
+    results->callback = callback;
+    for(uint32_t i = 0; i < workers_; i++)
+    {
+        if((int)i == worker_id_ || peer_base_port_ + i > 65535)
+        {
+            continue;
+        }
+        StatsPeerClient::Create(scheduler, (uint16_t)(peer_base_port_ + i), url, kPeerTimeoutMs,
+            [results, i](bool ok, const std::string& body){
+                results->ok[i] = ok;
+                results->bodies[i] = body;
+                if(--results->remaining == 0)
+                {
+                    results->callback(results->is_json ? MergeJson(*results) : MergeMetrics(*results));
+                }
+            });
+    }
+}
+
+/**
+ * @brief TCP 新连接回调，创建 StatsConnection 处理该连接
+ * @param socket 新连接的 socket 描述符
+ * @return 对应的 StatsConnection 智能指针
+ */
+TcpConnection::Ptr StatsServer::OnConnect(int socket)
+{
+    return std::make_shared<StatsConnection>(shared_from_this(), loop_->GetTaskSchduler().get(), socket);
+}
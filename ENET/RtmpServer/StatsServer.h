@@ -0,0 +1,91 @@
+/**
+ * @file StatsServer.h
+ * @brief 统计接口：通过 HTTP 输出 RtmpServer 的流与连接统计。
+ *
+ * 请求格式：
+ *  - GET /stats     JSON，包含每个观看者的发送统计
+ *  - GET /metrics   Prometheus 文本格式，观看者统计按流汇总，避免标签基数随观看者增长
+ * 统计在请求到达时汇总，不在分发路径上做任何额外工作。
+ * 多进程模式下每个工作进程另有一个只输出本进程统计的实例监听回环端口；公共端口收到请求时
+ * 并发向其他工作进程取统计后合并：JSON 按工作进程列出，Prometheus 样本增加 worker 标签。
+ */
+
+#ifndef _STATSSERVER_H_
+#define _STATSSERVER_H_
+
+#include "../EdoyunNet/TcpServer.h"
+#include <functional>
+#include <memory>
+#include <string>
+
+class RtmpServer;
+
+/**
+ * @class StatsServer
+ * @brief 基于 TcpServer 的统计监听服务
+ */
+class StatsServer : public TcpServer, public std::enable_shared_from_this<StatsServer>
+{
+public:
+    /**
+     * @brief 创建统计服务实例
+     * @param eventloop 事件循环，通常与 RtmpServer 相同
+     * @param rtmp_server 被统计的 RTMP 服务
+     * @return 统计服务共享指针
+     */
+    static std::shared_ptr<StatsServer> Create(EventLoop* eventloop, std::shared_ptr<RtmpServer> rtmp_server);
+
+    /**
+     * @brief 析构函数
+     */
+    ~StatsServer();
+
+    /**
+     * @brief 生成 JSON 格式的统计
+     * @return JSON 文本，RtmpServer 已释放时为空字符串
+     */
+    std::string GetJson();
+
+    /**
+     * @brief 生成 Prometheus 文本格式的统计
+     * @return 指标文本，RtmpServer 已释放时为空字符串
+     */
+    std::string GetMetrics();
+
+    /**
+     * @brief 多进程模式下设置各工作进程统计实例的回环端口
+     * @param worker_id 本进程编号
+     * @param workers 工作进程数
+     * @param base_port 回环端口基准，工作进程 i 的统计实例监听 127.0.0.1:(base_port + i)
+     */
+    void SetWorkerPeers(int worker_id, uint32_t workers, uint16_t base_port);
+
+    /**
+     * @brief 生成请求的统计，设置了工作进程时合并所有工作进程的结果
+     * @param url "/stats" 或 "/metrics"
+     * @param scheduler 请求所在连接的调度线程，其他工作进程的结果在该线程中收集
+     * @param callback 完成回调，参数为响应体；未设置工作进程时同步执行
+     */
+    void Collect(const std::string& url, TaskScheduler* scheduler, const std::function<void(const std::string&)>& callback);
+
+private:
+    /**
+     * @brief 私有构造，仅通过 Create() 调用
+     */
+    StatsServer(EventLoop* eventloop, std::shared_ptr<RtmpServer> rtmp_server);
+
+    /**
+     * @brief TCP 新连接回调，创建 StatsConnection
+     * @param socket 新连接的 socket 描述符
+     * @return 连接对象
+     */
+    virtual TcpConnection::Ptr OnConnect(int socket) override;
+
+    EventLoop* loop_;                           ///< 事件循环
+    std::weak_ptr<RtmpServer> rtmp_server_;     ///< 被统计的 RTMP 服务
+    int worker_id_ = -1;                        ///< 本进程编号，-1 表示单进程
+    uint32_t workers_ = 0;                      ///< 工作进程数
+    uint16_t peer_base_port_ = 0;               ///< 各工作进程统计实例的回环端口基准
+};
+
+#endif // _STATSSERVER_H_
@@ -0,0 +1,291 @@
+/**
+ * @file TimeShiftBuffer.cpp
+ * @brief 实现 TimeShiftBuffer：窗口追加与淘汰、关键帧索引查找与跨流的全局内存上限。
+ */
+#include "TimeShiftBuffer.h"
+#include "rtmp.h"
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+
+std::mutex TimeShiftBuffer::registry_mutex_;
+std::vector<TimeShiftBuffer*> TimeShiftBuffer::registry_;
+std::atomic<uint64_t> TimeShiftBuffer::total_bytes_(0);
+std::atomic<uint64_t> TimeShiftBuffer::max_total_bytes_(0);
+std::atomic<uint64_t> TimeShiftBuffer::evicted_gops_(0);
+
+/** 时间戳回退超过该值（毫秒）时视为新的时间轴，清空窗口 */
+static const uint64_t kMaxTimestampRollback = 1000;
+
+static int64_t GetNowMs()
+{
+    return std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+/**
+ * @brief 比较两个序列头的内容，部分编码器在每个关键帧前重复发送相同的序列头
+ */
+static bool IsSameHeader(const RtmpMediaPacket::Ptr& a, const RtmpMediaPacket::Ptr& b)
+{
+    return a && b && a->GetSize() == b->GetSize() && memcmp(a->GetPayload().get(), b->GetPayload().get(), a->GetSize()) == 0;
+}
+
+/**
+ * @brief 构造函数，登记到全局淘汰表
+ */
+TimeShiftBuffer::TimeShiftBuffer(uint32_t window_ms)
+    :window_ms_(window_ms)
+    ,oldest_arrival_(INT64_MAX)
+{
+    std::lock_guard<std::mutex> lock(registry_mutex_);
+    registry_.push_back(this);
+}
+
+/**
+ * @brief 析构函数，注销后其他流的淘汰不会再访问本窗口
+ */
+TimeShiftBuffer::~TimeShiftBuffer()
+{
+    {
+        std::lock_guard<std::mutex> lock(registry_mutex_);
+        registry_.erase(std::remove(registry_.begin(), registry_.end(), this), registry_.end());
+    }
+    total_bytes_ -= bytes_.load();
+}
+
+/**
+ * @brief 写入推流消息
+ *
+ * 窗口中保存新建的消息对象，只与推流端共享负载，直播观看者生成的分片缓存不会随窗口长期保留；
+ * 时移观看者共享窗口内消息的分片结果，内存上限只统计负载
+ */
+void TimeShiftBuffer::Append(RtmpMediaPacket::Ptr packet)
+{
+    uint8_t type = packet->GetType();
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if(type == RTMP_NOTIFY)
+        {
+            meta_data_ = packet;
+            return;
+        }
+        if(type == RTMP_AVC_SEQUENCE_HEADER || type == RTMP_AAC_SEQUENCE_HEADER)
+        {
+            RtmpMediaPacket::Ptr& header = type == RTMP_AVC_SEQUENCE_HEADER ? avc_header_ : aac_header_;
+            if(IsSameHeader(header, packet))
+            {
+                return;
+            }
+            if(header)
+            {
+                ClearPackets();                           // 编码参数变化，窗口中的旧数据无法用新序列头解码
+            }
+            header = packet;
+            generation_++;
+            return;
+        }
+        if(type != RTMP_AUDIO && type != RTMP_VIDEO)
+        {
+            return;
+        }
+
+        uint64_t timestamp = packet->GetTimestamp();
+        if(!packets_.empty() && timestamp + kMaxTimestampRollback < packets_.back()->GetTimestamp())
+        {
+            ClearPackets();                               // 时间戳大幅回退，旧窗口不再能按时间戳查找
+        }
+
+        // 有视频时以关键帧为起播点，纯音频流按固定间隔取起播点
+        bool key_frame = type == RTMP_VIDEO ? packet->IsKeyFrame()
+                       : (!avc_header_ && (key_frames_.empty() || timestamp >= key_frames_.back().timestamp + kAudioIndexInterval));
+        if(key_frames_.empty() && !key_frame)
+        {
+            return;                                       // 窗口从起播点开始
+        }
+        if(key_frame)
+        {
+            KeyFrame entry;
+            entry.timestamp = timestamp;
+            entry.sequence = first_sequence_ + packets_.size();
+            entry.arrival = GetNowMs();
+            key_frames_.push_back(entry);
+            gop_bytes_.push_back(0);
+        }
+
+        uint32_t size = packet->GetMemorySize();
+        packets_.push_back(std::make_shared<RtmpMediaPacket>(type, timestamp, packet->GetPayload(), packet->GetSize()));
+        gop_bytes_.back() += size;
+        bytes_ += size;
+        total_bytes_ += size;
+
+        // 第二个起播点已落在窗口之外时，第一个 GOP 不再需要
+        while(key_frames_.size() >= 2 && key_frames_[1].timestamp + window_ms_ <= timestamp)
+        {
+            EvictFirstGop();
+        }
+        UpdateOldestArrival();
+    }
+
+    uint64_t max_total = max_total_bytes_.load();
+    if(max_total > 0 && total_bytes_.load() > max_total)
+    {
+        EvictGlobal();
+    }
+}
+
+/**
+ * @brief 清空窗口与序列头，读取位置落后于新的首条序号，下次读取时跳转
+ */
+void TimeShiftBuffer::Clear()
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    ClearPackets();
+    meta_data_.reset();
+    aac_header_.reset();
+    avc_header_.reset();
+    generation_++;
+}
+
+/**
+ * @brief 淘汰第一个 GOP（调用者持有 mutex_）
+ */
+void TimeShiftBuffer::EvictFirstGop()
+{
+    if(key_frames_.empty())
+    {
+        return;
+    }
+    size_t count = key_frames_.size() >= 2 ? (size_t)(key_frames_[1].sequence - first_sequence_) : packets_.size();
+    packets_.erase(packets_.begin(), packets_.begin() + count);
+    first_sequence_ += count;
+    bytes_ -= gop_bytes_.front();
+    total_bytes_ -= gop_bytes_.front();
+    key_frames_.pop_front();
+    gop_bytes_.pop_front();
+    UpdateOldestArrival();
+}
+
+/**
+ * @brief 清空窗口中的消息（调用者持有 mutex_），序号跳过被清空的消息
+ */
+void TimeShiftBuffer::ClearPackets()
+{
+    first_sequence_ += packets_.size();
+    packets_.clear();
+    key_frames_.clear();
+    gop_bytes_.clear();
+    total_bytes_ -= bytes_.exchange(0);
+    UpdateOldestArrival();
+}
+
+/**
+ * @brief 更新队头写入时刻（调用者持有 mutex_）
+ */
+void TimeShiftBuffer::UpdateOldestArrival()
+{
+    oldest_arrival_.store(key_frames_.empty() ? INT64_MAX : key_frames_.front().arrival, std::memory_order_relaxed);
+}
+
+/**
+ * @brief 全局淘汰：按写入时刻选出最早的 GOP，各流保留的回看时长趋于一致
+ *
+ * 持有登记表锁期间窗口不会析构；只在取到目标后加该窗口的锁，与 Append 的加锁顺序一致
+ */
+void TimeShiftBuffer::EvictGlobal()
+{
+    std::lock_guard<std::mutex> registry_lock(registry_mutex_);
+    while(max_total_bytes_.load() > 0 && total_bytes_.load() > max_total_bytes_.load())
+    {
+        TimeShiftBuffer* victim = nullptr;
+        int64_t oldest = INT64_MAX;
+        for(auto buffer : registry_)
+        {
+            int64_t arrival = buffer->oldest_arrival_.load(std::memory_order_relaxed);
+            if(arrival < oldest)
+            {
+                oldest = arrival;
+                victim = buffer;
+            }
+        }
+        if(!victim)
+        {
+            break;
+        }
+        std::lock_guard<std::mutex> lock(victim->mutex_);
+        victim->EvictFirstGop();
+        evicted_gops_++;
+    }
+}
+
+/**
+ * @brief 在起播点索引上二分查找
+ */
+bool TimeShiftBuffer::FindKeyFrame(uint64_t timestamp, KeyFrame& key_frame)
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    if(key_frames_.empty())
+    {
+        return false;
+    }
+    auto iter = std::upper_bound(key_frames_.begin(), key_frames_.end(), timestamp,
+                                 [](uint64_t value, const KeyFrame& item) { return value < item.timestamp; });
+    key_frame = (iter == key_frames_.begin()) ? *iter : *(iter - 1);
+    return true;
+}
+
+/**
+ * @brief 按序号顺序读取已到时间的消息，消息对象在观看者之间共享
+ */
+bool TimeShiftBuffer::Read(uint64_t& sequence, uint64_t max_timestamp, size_t max_count,
+                           std::vector<RtmpMediaPacket::Ptr>& packets)
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    bool skipped = false;
+    if(sequence < first_sequence_)
+    {
+        sequence = key_frames_.empty() ? first_sequence_ : key_frames_.front().sequence;
+        skipped = true;
+    }
+    size_t index = (size_t)(sequence - first_sequence_);
+    while(index < packets_.size() && packets.size() < max_count)
+    {
+        const RtmpMediaPacket::Ptr& packet = packets_[index];
+        if(packet->GetTimestamp() > max_timestamp)
+        {
+            break;
+        }
+        packets.push_back(packet);
+        index++;
+        sequence++;
+    }
+    return skipped;
+}
+
+/**
+ * @brief 获取元数据与序列头
+ */
+void TimeShiftBuffer::GetHeaders(RtmpMediaPacket::Ptr& meta_data, RtmpMediaPacket::Ptr& aac_header,
+                                 RtmpMediaPacket::Ptr& avc_header, uint32_t& generation)
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    meta_data = meta_data_;
+    aac_header = aac_header_;
+    avc_header = avc_header_;
+    generation = generation_.load();
+}
+
+/**
+ * @brief 窗口覆盖的时间戳范围
+ */
+bool TimeShiftBuffer::GetRange(uint64_t& first_timestamp, uint64_t& last_timestamp)
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    if(packets_.empty())
+    {
+        return false;
+    }
+    first_timestamp = packets_.front()->GetTimestamp();
+    last_timestamp = packets_.back()->GetTimestamp();
+    return true;
+}
@@ -0,0 +1,162 @@
+/**
+ * @file TimeShiftBuffer.h
+ * @brief 时移缓冲：按流保存最近一段时间的音视频消息，观看者可以落后直播指定时长播放或在窗口内回看。
+ *
+ * 主要职责：
+ *  - 保存推流端共享的负载（引用计数，不拷贝），按消息序号顺序存放，从关键帧开始
+ *  - 维护紧凑的关键帧索引（时间戳、序号、写入时刻），按时间戳二分查找起播位置
+ *  - 超出窗口时长的 GOP 从队头整体淘汰；所有流共用一个内存上限，超出时淘汰全局最早写入的 GOP
+ *  - 保存元数据与序列头，编码参数变化或重新推流时清空，旧数据无法再解码
+ *
+ * 推流线程写入，观看者线程读取，内部加锁；淘汰其他流时先取全局登记表锁再取该流的锁，不会反向加锁。
+ */
+
+#ifndef _TIMESHIFTBUFFER_H_
+#define _TIMESHIFTBUFFER_H_
+
+#include "RtmpMediaPacket.h"
+#include <atomic>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+/**
+ * @class TimeShiftBuffer
+ * @brief 单条流的时移窗口，由 RtmpSession 持有
+ */
+class TimeShiftBuffer
+{
+public:
+    using Ptr = std::shared_ptr<TimeShiftBuffer>;
+
+    /** 关键帧索引项：纯音频流每隔 kAudioIndexInterval 毫秒取一个音频帧作为起播点 */
+    struct KeyFrame
+    {
+        uint64_t timestamp = 0;     ///< 关键帧时间戳（毫秒）
+        uint64_t sequence = 0;      ///< 关键帧的消息序号
+        int64_t arrival = 0;        ///< 写入时刻（毫秒），全局淘汰时比较
+    };
+
+    /** 纯音频流的起播点间隔（毫秒） */
+    static const uint32_t kAudioIndexInterval = 1000;
+
+    /**
+     * @brief 构造函数，登记到全局淘汰表
+     * @param window_ms 保留的媒体时长（毫秒）
+     */
+    TimeShiftBuffer(uint32_t window_ms);
+
+    /**
+     * @brief 析构函数，归还全局占用并注销
+     */
+    ~TimeShiftBuffer();
+
+    /**
+     * @brief 写入一条推流消息：元数据与序列头单独保存，音视频从第一个关键帧开始追加
+     *
+     * 追加后淘汰超出窗口的 GOP，全局占用超过上限时淘汰所有流中最早写入的 GOP
+     * @param packet 会话内的媒体消息，只引用其负载
+     */
+    void Append(RtmpMediaPacket::Ptr packet);
+
+    /**
+     * @brief 清空窗口与序列头（重新推流时调用），序号继续递增，读取位置失效
+     */
+    void Clear();
+
+    /**
+     * @brief 查找时间戳不晚于 timestamp 的最后一个起播点，O(log n)
+     * @param timestamp 目标时间戳（毫秒）
+     * @param key_frame 输出起播点，目标早于窗口时取窗口内第一个起播点
+     * @return false 表示窗口为空
+     */
+    bool FindKeyFrame(uint64_t timestamp, KeyFrame& key_frame);
+
+    /**
+     * @brief 从 sequence 开始读取时间戳不晚于 max_timestamp 的消息
+     *
+     * sequence 已被淘汰时跳到窗口内第一个起播点，并通过 skipped 告知调用者
+     * @param sequence 读取位置，返回时指向下一条未读消息
+     * @param max_timestamp 允许读取的最大时间戳（毫秒）
+     * @param max_count 本次最多读取的消息数
+     * @param packets 输出消息
+     * @return true 表示读取位置被淘汰过，已跳到第一个起播点
+     */
+    bool Read(uint64_t& sequence, uint64_t max_timestamp, size_t max_count, std::vector<RtmpMediaPacket::Ptr>& packets);
+
+    /**
+     * @brief 获取元数据与序列头，观看者起播或位置跳变时重新发送
+     * @param generation 输出序列头版本，每次 Clear 或收到新的序列头时递增
+     */
+    void GetHeaders(RtmpMediaPacket::Ptr& meta_data, RtmpMediaPacket::Ptr& aac_header,
+                    RtmpMediaPacket::Ptr& avc_header, uint32_t& generation);
+
+    /**
+     * @brief 窗口内第一个与最后一个消息的时间戳
+     * @return false 表示窗口为空
+     */
+    bool GetRange(uint64_t& first_timestamp, uint64_t& last_timestamp);
+
+    uint32_t GetWindow() const { return window_ms_; }
+    uint64_t GetBytes() const { return bytes_.load(std::memory_order_relaxed); }   ///< 本窗口占用字节数
+    uint32_t GetGeneration() const { return generation_.load(std::memory_order_relaxed); }
+
+    /**
+     * @brief 设置所有时移窗口的总内存上限
+     * @param max_bytes 总上限（字节，按负载所在块的大小计），0 表示不限制
+     */
+    static void SetMaxTotalBytes(uint64_t max_bytes) { max_total_bytes_ = max_bytes; }
+
+    /**
+     * @brief 所有时移窗口当前占用的字节数
+     */
+    static uint64_t GetTotalBytes() { return total_bytes_.load(); }
+
+    /**
+     * @brief 累计因全局内存上限被淘汰的 GOP 数
+     */
+    static uint64_t GetEvictedGops() { return evicted_gops_.load(); }
+
+private:
+    /**
+     * @brief 淘汰队头第一个 GOP（调用者持有 mutex_），只剩一个 GOP 时整体清空
+     */
+    void EvictFirstGop();
+
+    /**
+     * @brief 清空窗口中的消息（调用者持有 mutex_），保留序列头
+     */
+    void ClearPackets();
+
+    /**
+     * @brief 全局占用超过上限时，反复淘汰所有窗口中写入最早的 GOP
+     */
+    static void EvictGlobal();
+
+    /**
+     * @brief 更新队头写入时刻，供全局淘汰无锁比较（调用者持有 mutex_）
+     */
+    void UpdateOldestArrival();
+
+    std::mutex mutex_;                            ///< 保护以下队列与序列头
+    uint32_t window_ms_ = 0;                      ///< 保留的媒体时长
+    std::deque<RtmpMediaPacket::Ptr> packets_;    ///< 窗口内的音视频消息，首条为起播点
+    std::deque<KeyFrame> key_frames_;             ///< 起播点索引，时间戳与序号均升序
+    std::deque<uint32_t> gop_bytes_;              ///< 各 GOP 占用字节数，与 key_frames_ 一一对应
+    uint64_t first_sequence_ = 0;                 ///< packets_ 首条消息的序号
+    RtmpMediaPacket::Ptr meta_data_;              ///< 最近一次的元数据
+    RtmpMediaPacket::Ptr aac_header_;             ///< 音频序列头
+    RtmpMediaPacket::Ptr avc_header_;             ///< 视频序列头，非空时只以视频关键帧作为起播点
+    std::atomic<uint64_t> bytes_{0};              ///< 本窗口占用字节数
+    std::atomic<uint32_t> generation_{0};         ///< 序列头版本
+    std::atomic<int64_t> oldest_arrival_;         ///< 队头 GOP 的写入时刻，窗口为空时为 INT64_MAX
+
+    static std::mutex registry_mutex_;                        ///< 保护 registry_，先于各窗口的锁获取
+    static std::vector<TimeShiftBuffer*> registry_;           ///< 所有存活的时移窗口
+    static std::atomic<uint64_t> total_bytes_;                ///< 所有窗口占用
+    static std::atomic<uint64_t> max_total_bytes_;            ///< 所有窗口总上限
+    static std::atomic<uint64_t> evicted_gops_;               ///< 因全局上限淘汰的 GOP 数
+};
+
+#endif // _TIMESHIFTBUFFER_H_
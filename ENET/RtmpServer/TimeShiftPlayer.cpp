@@ -0,0 +1,168 @@
+/**
+ * @file TimeShiftPlayer.cpp
+ * @brief 实现 TimeShiftPlayer：关键帧定位、固定落后时长的发送节奏与发送队列背压。
+ */
+#include "TimeShiftPlayer.h"
+#include "RtmpSink.h"
+#include "../EdoyunNet/TaskScheduler.h"
+
+/**
+ * @brief 构造函数
+ */
+TimeShiftPlayer::TimeShiftPlayer(TimeShiftBuffer::Ptr buffer, std::weak_ptr<RtmpSink> sink,
+                                 const PendingCallback& pending_cb)
+    :buffer_(buffer)
+    ,sink_(sink)
+    ,pending_cb_(pending_cb)
+{
+}
+
+/**
+ * @brief 定位起点后注册定时器，定时器只持有弱引用，连接释放发送器后自动结束
+ */
+void TimeShiftPlayer::Start(TaskScheduler* scheduler, uint32_t delay_ms)
+{
+    uint64_t first_timestamp = 0, last_timestamp = 0;
+    if(buffer_->GetRange(first_timestamp, last_timestamp))
+    {
+        Seek(last_timestamp > delay_ms ? last_timestamp - delay_ms : 0);
+    }
+    delay_ms_ = delay_ms;
+    ClampDelay();
+
+    std::weak_ptr<TimeShiftPlayer> weak_player = shared_from_this();
+    scheduler->AddTimer([weak_player]() {
+        auto player = weak_player.lock();
+        if(!player || player->stopped_)
+        {
+            return false;
+        }
+        player->Pump();
+        return true;
+    }, kTickInterval);
+    Pump();
+}
+
+/**
+ * @brief 在关键帧索引上定位，落后时长改为窗口最新时间戳与目标位置之差
+ */
+uint64_t TimeShiftPlayer::Seek(uint64_t timestamp)
+{
+    TimeShiftBuffer::KeyFrame key_frame;
+    uint64_t first_timestamp = 0, last_timestamp = 0;
+    if(!buffer_->FindKeyFrame(timestamp, key_frame) || !buffer_->GetRange(first_timestamp, last_timestamp))
+    {
+        return timestamp;
+    }
+    sequence_ = key_frame.sequence;
+    position_ = key_frame.timestamp;
+    uint64_t target = timestamp > key_frame.timestamp ? timestamp : key_frame.timestamp;
+    delay_ms_ = last_timestamp > target ? last_timestamp - target : 0;
+    send_headers_ = true;                               // 播放器拖动后清空了解码器，重新发送序列头
+    return key_frame.timestamp;
+}
+
+/**
+ * @brief 暂停期间直播继续前进，恢复时保持暂停处的位置，落后时长相应增加
+ */
+void TimeShiftPlayer::Pause(bool pause)
+{
+    if(pause)
+    {
+        paused_ = true;
+    }
+    else if(paused_)
+    {
+        paused_ = false;
+        uint64_t first_timestamp = 0, last_timestamp = 0;
+        if(buffer_->GetRange(first_timestamp, last_timestamp))
+        {
+            delay_ms_ = last_timestamp > position_ ? last_timestamp - position_ : 0;
+            ClampDelay();
+        }
+        Pump();
+    }
+}
+
+/**
+ * @brief 落后时长超过窗口跨度时，允许发送的位置落在窗口之前，按窗口跨度截断
+ */
+void TimeShiftPlayer::ClampDelay()
+{
+    uint64_t first_timestamp = 0, last_timestamp = 0;
+    if(buffer_->GetRange(first_timestamp, last_timestamp) && delay_ms_ > last_timestamp - first_timestamp)
+    {
+        delay_ms_ = last_timestamp - first_timestamp;
+    }
+}
+
+/**
+ * @brief 发送元数据与序列头，观看者连接按类型记录序列头
+ */
+void TimeShiftPlayer::SendHeaders(const std::shared_ptr<RtmpSink>& sink)
+{
+    RtmpMediaPacket::Ptr meta_data, aac_header, avc_header;
+    buffer_->GetHeaders(meta_data, aac_header, avc_header, generation_);
+    if(meta_data)
+    {
+        sink->SendMetaData(meta_data);
+    }
+    if(aac_header)
+    {
+        sink->SendMediaPacket(aac_header);
+    }
+    if(avc_header)
+    {
+        sink->SendMediaPacket(avc_header);
+    }
+    send_headers_ = false;
+}
+
+/**
+ * @brief 读取时间戳不晚于（最新时间戳 - 落后时长）的消息交给连接，直到发送队列达到上限或没有可发送的消息
+ */
+void TimeShiftPlayer::Pump()
+{
+    if(stopped_ || paused_ || pumping_)
+    {
+        return;
+    }
+    auto sink = sink_.lock();
+    if(!sink)
+    {
+        stopped_ = true;
+        return;
+    }
+    pumping_ = true;
+
+    std::vector<RtmpMediaPacket::Ptr> packets;
+    while(!stopped_ && pending_cb_() < kMaxPendingBytes)
+    {
+        uint64_t first_timestamp = 0, last_timestamp = 0;
+        if(!buffer_->GetRange(first_timestamp, last_timestamp))
+        {
+            break;                                          // 窗口为空，等待推流端写入
+        }
+        uint64_t allowed = last_timestamp > delay_ms_ ? last_timestamp - delay_ms_ : 0;
+
+        packets.clear();
+        if(buffer_->Read(sequence_, allowed, kMaxReadPackets, packets))
+        {
+            ClampDelay();                                   // 读取位置被淘汰，从窗口起点的关键帧继续，序列头不变
+        }
+        if(send_headers_ || buffer_->GetGeneration() != generation_)
+        {
+            SendHeaders(sink);
+        }
+        for(auto& packet : packets)
+        {
+            sink->SendMediaPacket(packet);
+            position_ = packet->GetTimestamp();
+        }
+        if(packets.size() < kMaxReadPackets)
+        {
+            break;
+        }
+    }
+    pumping_ = false;
+}
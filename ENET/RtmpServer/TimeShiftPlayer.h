@@ -0,0 +1,107 @@
+/**
+ * @file TimeShiftPlayer.h
+ * @brief 时移发送器：按固定的落后时长把时移窗口中的消息交给观看者连接，支持在窗口内拖动与暂停。
+ *
+ * 主要职责：
+ *  - 起播与拖动时在关键帧索引上定位，先发送元数据与序列头，再从关键帧开始顺序发送
+ *  - 允许发送的时间戳为窗口最新时间戳减去落后时长，起播关键帧之后到该位置的数据一次性突发
+ *  - 暂停后恢复从暂停处继续，落后时长随暂停时长增加；读取位置被淘汰时跳到窗口起点并缩短落后时长
+ *  - 连接发送队列超过上限时暂停读取，时移观看者不丢帧
+ *
+ * RTMP 与 HTTP-FLV 观看者共用，只在所属连接的调度线程上运行。
+ */
+
+#ifndef _TIMESHIFTPLAYER_H_
+#define _TIMESHIFTPLAYER_H_
+
+#include "TimeShiftBuffer.h"
+#include <functional>
+#include <memory>
+
+class TaskScheduler;
+class RtmpSink;
+
+/**
+ * @class TimeShiftPlayer
+ * @brief 单个时移观看者的发送器，由观看者连接持有
+ */
+class TimeShiftPlayer : public std::enable_shared_from_this<TimeShiftPlayer>
+{
+public:
+    using Ptr = std::shared_ptr<TimeShiftPlayer>;
+    /** 获取连接发送队列中尚未写入内核的字节数 */
+    using PendingCallback = std::function<uint64_t()>;
+
+    /** 定时检查的周期（毫秒） */
+    static const uint32_t kTickInterval = 20;
+    /** 连接发送队列超过该字节数时暂停读取窗口 */
+    static const uint32_t kMaxPendingBytes = 512 * 1024;
+    /** 每次从窗口读取的最大消息数 */
+    static const size_t kMaxReadPackets = 64;
+
+    /**
+     * @brief 构造函数
+     * @param buffer 流的时移窗口
+     * @param sink 观看者连接，只持有弱引用
+     * @param pending_cb 获取发送积压
+     */
+    TimeShiftPlayer(TimeShiftBuffer::Ptr buffer, std::weak_ptr<RtmpSink> sink, const PendingCallback& pending_cb);
+
+    /**
+     * @brief 定位到落后直播 delay_ms 的关键帧并开始定时发送
+     * @param scheduler 观看者连接所在的调度线程
+     * @param delay_ms 落后直播的时长（毫秒），超过窗口时从窗口起点开始
+     */
+    void Start(TaskScheduler* scheduler, uint32_t delay_ms);
+
+    /**
+     * @brief 拖动到不晚于 timestamp 的关键帧，落后时长随之改变
+     * @param timestamp 目标位置（流时间戳，毫秒），早于窗口时从窗口起点开始
+     * @return 实际开始的位置（关键帧时间戳），窗口为空时返回 timestamp
+     */
+    uint64_t Seek(uint64_t timestamp);
+
+    /**
+     * @brief 暂停或恢复发送，恢复时从暂停处继续
+     */
+    void Pause(bool pause);
+
+    /**
+     * @brief 发送已到时间且发送队列未满的消息，由定时器与连接的写队列回调调用
+     */
+    void Pump();
+
+    /**
+     * @brief 停止发送，定时器在下一次到期时结束
+     */
+    void Stop() { stopped_ = true; }
+
+    uint64_t GetDelay() const { return delay_ms_; }            ///< 当前落后直播的时长（毫秒）
+    uint64_t GetPosition() const { return position_; }         ///< 最近发送的时间戳（毫秒）
+
+private:
+    /**
+     * @brief 发送元数据与序列头，并记录序列头版本
+     */
+    void SendHeaders(const std::shared_ptr<RtmpSink>& sink);
+
+    /**
+     * @brief 落后时长不超过窗口跨度，保证允许发送的位置仍在窗口内
+     */
+    void ClampDelay();
+
+    TimeShiftBuffer::Ptr buffer_;       ///< 流的时移窗口
+    std::weak_ptr<RtmpSink> sink_;      ///< 观看者连接
+    PendingCallback pending_cb_;
+
+    uint64_t sequence_ = 0;             ///< 下一条待发送消息的序号
+    uint64_t delay_ms_ = 0;             ///< 落后窗口最新时间戳的时长
+    uint64_t position_ = 0;             ///< 最近发送的时间戳
+    uint32_t generation_ = 0;           ///< 已发送序列头的版本
+    bool send_headers_ = true;          ///< 下次发送前是否先发送序列头
+    bool paused_ = false;               ///< 是否暂停
+    bool stopped_ = false;              ///< 是否已停止
+    bool pumping_ = false;              ///< 防止发送回调中重入
+};
+
+#endif // _TIMESHIFTPLAYER_H_
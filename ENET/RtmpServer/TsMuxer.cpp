@@ -0,0 +1,384 @@
+/**
+ * @file TsMuxer.cpp
+ * @brief 实现 TsMuxer：AVCC 转 Annex-B、AAC 加 ADTS 头、PES 封装与 TS 分包。
+ */
+#include "TsMuxer.h"
+#include <cstring>
+
+static const uint32_t kTsPacketSize = 188;   ///< TS 包长度
+static const uint16_t kPmtPid = 0x1000;      ///< PMT PID
+static const uint16_t kVideoPid = 0x100;     ///< H.264 基本流 PID
+static const uint16_t kAudioPid = 0x101;     ///< AAC 基本流 PID
+static const uint64_t kPtsOffset = 90 * 200; ///< PTS/DTS 整体偏移 200ms，避免 CTS 为负时下溢
+
+static inline uint32_t ReadUint16(const uint8_t* p) { return ((uint32_t)p[0] << 8) | p[1]; }
+
+/**
+ * @brief 构造函数
+ */
+TsMuxer::TsMuxer()
+{
+}
+
+/**
+ * @brief 解析 AVCDecoderConfigurationRecord，转换为 Annex-B 格式的 SPS/PPS
+ *
+ * FLV 视频负载：1 字节帧类型/编码 + 1 字节 AVCPacketType + 3 字节 CTS + 配置记录
+ */
+bool TsMuxer::SetAvcSequenceHeader(const char* data, uint32_t size)
+{
+    const uint8_t* p = (const uint8_t*)data;
+    if(size < 11 || (p[0] & 0x0f) != 7 || p[1] != 0)
+    {
+        return false;
+    }
+
+    const uint8_t* end = p + size;
+    const uint8_t* record = p + 5;
+    nalu_length_size_ = (record[4] & 0x03) + 1;
+    std::string sps_pps;
+    const uint8_t* q = record + 5;
+    for(int pass = 0; pass < 2; pass++)     // 先 SPS 后 PPS
+    {
+        if(q >= end)
+        {
+            return false;
+        }
+        uint32_t count = pass == 0 ? (*q & 0x1f) : *q;
+        q++;
+        for(uint32_t i = 0; i < count; i++)
+        {
+            if(q + 2 > end)
+            {
+                return false;
+            }
+            uint32_t len = ReadUint16(q);
+            q += 2;
+            if(q + len > end)
+            {
+                return false;
+            }
+            sps_pps.append("\x00\x00\x00\x01", 4);
+            sps_pps.append((const char*)q, len);
+            q += len;
+        }
+    }
+
+    sps_pps_ = sps_pps;
+    has_video_ = true;
+    return true;
+}
+
+/**
+ * @brief 解析 AudioSpecificConfig，生成 ADTS 头所需的参数
+ *
+ * FLV 音频负载：1 字节音频格式 + 1 字节 AACPacketType + AudioSpecificConfig
+ */
+bool TsMuxer::SetAacSequenceHeader(const char* data, uint32_t size)
+{
+    const uint8_t* p = (const uint8_t*)data;
+    if(size < 4 || (p[0] >> 4) != 10 || p[1] != 0)
+    {
+        return false;
+    }
+
+    aac_object_type_ = p[2] >> 3;
+    aac_sample_index_ = ((p[2] & 0x07) << 1) | (p[3] >> 7);
+    aac_channels_ = (p[3] >> 3) & 0x0f;
+    if(aac_object_type_ == 0 || aac_object_type_ > 4)
+    {
+        aac_object_type_ = 2;               // ADTS 只能表示前 4 种，HE-AAC 等按 LC 声明
+    }
+    has_audio_ = true;
+    return true;
+}
+
+/**
+ * @brief 写入 PAT 与 PMT，PMT 只声明已收到序列头的基本流
+ */
+void TsMuxer::WriteTables(std::string& out)
+{
+    // PAT：节目 1 -> PMT PID
+    uint8_t pat[16] = {
+        0x00, 0xb0, 0x0d, 0x00, 0x01, 0xc1, 0x00, 0x00,
+        0x00, 0x01, (uint8_t)(0xe0 | (kPmtPid >> 8)), (uint8_t)(kPmtPid & 0xff)
+    };
+    uint32_t crc = Crc32(pat, 12);
+    pat[12] = (uint8_t)(crc >> 24);
+    pat[13] = (uint8_t)(crc >> 16);
+    pat[14] = (uint8_t)(crc >> 8);
+    pat[15] = (uint8_t)crc;
+    WriteSection(0, pat_cc_, pat, sizeof(pat), out);
+
+    // PMT：PCR 由视频 PID 携带，纯音频流改由音频 PID 携带
+    uint8_t pmt[32] = {0};
+    uint16_t pcr_pid = has_video_ || !has_audio_ ? kVideoPid : kAudioPid;
+    uint32_t pos = 0;
+    pmt[pos++] = 0x02;
+    pos += 2;                               // section_length 最后回填
+    pmt[pos++] = 0x00;
+    pmt[pos++] = 0x01;                      // program_number
+    pmt[pos++] = 0xc1;
+    pmt[pos++] = 0x00;
+    pmt[pos++] = 0x00;
+    pmt[pos++] = (uint8_t)(0xe0 | (pcr_pid >> 8));
+    pmt[pos++] = (uint8_t)(pcr_pid & 0xff);
+    pmt[pos++] = 0xf0;
+    pmt[pos++] = 0x00;                      // program_info_length = 0
+    if(has_video_ || !has_audio_)
+    {
+        pmt[pos++] = 0x1b;                  // H.264
+        pmt[pos++] = (uint8_t)(0xe0 | (kVideoPid >> 8));
+        pmt[pos++] = (uint8_t)(kVideoPid & 0xff);
+        pmt[pos++] = 0xf0;
+        pmt[pos++] = 0x00;
+    }
+    if(has_audio_)
+    {
+        pmt[pos++] = 0x0f;                  // AAC ADTS
+        pmt[pos++] = (uint8_t)(0xe0 | (kAudioPid >> 8));
+        pmt[pos++] = (uint8_t)(kAudioPid & 0xff);
+        pmt[pos++] = 0xf0;
+        pmt[pos++] = 0x00;
+    }
+    uint32_t section_length = pos - 3 + 4;
+    pmt[1] = (uint8_t)(0xb0 | (section_length >> 8));
+    pmt[2] = (uint8_t)(section_length & 0xff);
+    crc = Crc32(pmt, pos);
+    pmt[pos++] = (uint8_t)(crc >> 24);
+    pmt[pos++] = (uint8_t)(crc >> 16);
+    pmt[pos++] = (uint8_t)(crc >> 8);
+    pmt[pos++] = (uint8_t)crc;
+    WriteSection(kPmtPid, pmt_cc_, pmt, pos, out);
+}
+
+/**
+ * @brief 将长度前缀的 NALU 转为起始码格式，帧前加 AUD，关键帧前加 SPS/PPS
+ */
+bool TsMuxer::WriteVideo(const char* data, uint32_t size, uint64_t timestamp, std::string& out)
+{
+    const uint8_t* p = (const uint8_t*)data;
+    if(!has_video_ || size < 5 || (p[0] & 0x0f) != 7 || p[1] != 1)
+    {
+        return false;
+    }
+
+    bool key_frame = (p[0] >> 4) == 1;
+    int32_t cts = (int32_t)(((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 8) | p[4]);
+    if(cts & 0x800000)
+    {
+        cts -= 0x1000000;                   // SI24 符号扩展
+    }
+
+    es_.clear();
+    es_.append("\x00\x00\x00\x01\x09\xf0", 6);   // AUD
+    if(key_frame)
+    {
+        es_.append(sps_pps_);
+    }
+
+    const uint8_t* q = p + 5;
+    const uint8_t* end = p + size;
+    while(q + nalu_length_size_ <= end)
+    {
+        uint32_t len = 0;
+        for(uint32_t i = 0; i < nalu_length_size_; i++)
+        {
+            len = (len << 8) | q[i];
+        }
+        q += nalu_length_size_;
+        if(len == 0 || len > (uint32_t)(end - q))
+        {
+            break;
+        }
+        uint8_t nalu_type = q[0] & 0x1f;
+        if(nalu_type != 9 && !(key_frame && (nalu_type == 7 || nalu_type == 8)))
+        {
+            es_.append("\x00\x00\x00\x01", 4);   // 帧内自带的 AUD/SPS/PPS 已由上面统一写入
+            es_.append((const char*)q, len);
+        }
+        q += len;
+    }
+
+    uint64_t dts = timestamp * 90 + kPtsOffset;
+    uint64_t pts = dts + (int64_t)cts * 90;
+    WritePes(kVideoPid, 0xe0, pts, dts, key_frame, true, out);
+    return true;
+}
+
+/**
+ * @brief 为原始 AAC 帧加 7 字节 ADTS 头后封装
+ */
+bool TsMuxer::WriteAudio(const char* data, uint32_t size, uint64_t timestamp, std::string& out)
+{
+    const uint8_t* p = (const uint8_t*)data;
+    if(!has_audio_ || size <= 2 || (p[0] >> 4) != 10 || p[1] != 1)
+    {
+        return false;
+    }
+
+    uint32_t frame_length = size - 2 + 7;
+    uint8_t adts[7];
+    adts[0] = 0xff;
+    adts[1] = 0xf1;
+    adts[2] = (uint8_t)(((aac_object_type_ - 1) << 6) | ((aac_sample_index_ & 0x0f) << 2) | ((aac_channels_ >> 2) & 0x01));
+    adts[3] = (uint8_t)(((aac_channels_ & 0x03) << 6) | ((frame_length >> 11) & 0x03));
+    adts[4] = (uint8_t)((frame_length >> 3) & 0xff);
+    adts[5] = (uint8_t)(((frame_length & 0x07) << 5) | 0x1f);
+    adts[6] = 0xfc;
+
+    es_.clear();
+    es_.append((const char*)adts, sizeof(adts));
+    es_.append(data + 2, size - 2);
+
+    uint64_t pts = timestamp * 90 + kPtsOffset;
+    WritePes(kAudioPid, 0xc0, pts, pts, false, !has_video_, out);
+    return true;
+}
+
+/**
+ * @brief 写入 PTS/DTS 的 5 字节编码
+ */
+static void WriteTimestamp(std::string& out, uint8_t prefix, uint64_t ts)
+{
+    char buf[5];
+    buf[0] = (char)((prefix << 4) | (((ts >> 30) & 0x07) << 1) | 1);
+    buf[1] = (char)((ts >> 22) & 0xff);
+    buf[2] = (char)((((ts >> 15) & 0x7f) << 1) | 1);
+    buf[3] = (char)((ts >> 7) & 0xff);
+    buf[4] = (char)(((ts & 0x7f) << 1) | 1);
+    out.append(buf, 5);
+}
+
+/**
+ * @brief PES 头 + es_ 按 184 字节负载拆分为 TS 包，末包用适配域填充
+ */
+void TsMuxer::WritePes(uint16_t pid, uint8_t stream_id, uint64_t pts, uint64_t dts, bool random_access, bool pcr, std::string& out)
+{
+    bool has_dts = pts != dts;
+    std::string header;
+    header.append("\x00\x00\x01", 3);
+    header.push_back((char)stream_id);
+    uint32_t pes_length = (uint32_t)es_.size() + 3 + (has_dts ? 10 : 5);
+    if(stream_id == 0xe0 || pes_length > 0xffff)
+    {
+        pes_length = 0;                     // 视频 PES 长度不限
+    }
+    header.push_back((char)(pes_length >> 8));
+    header.push_back((char)(pes_length & 0xff));
+    header.push_back((char)0x80);
+    header.push_back((char)(has_dts ? 0xc0 : 0x80));
+    header.push_back((char)(has_dts ? 10 : 5));
+    WriteTimestamp(header, has_dts ? 3 : 2, pts);
+    if(has_dts)
+    {
+        WriteTimestamp(header, 1, dts);
+    }
+
+    uint8_t& cc = pid == kVideoPid ? video_cc_ : audio_cc_;
+    uint32_t total = (uint32_t)(header.size() + es_.size());
+    uint32_t written = 0;
+    bool first = true;
+    out.reserve(out.size() + (total / 184 + 2) * kTsPacketSize);
+    while(written < total)
+    {
+        uint8_t packet[kTsPacketSize];
+        packet[0] = 0x47;
+        packet[1] = (uint8_t)((first ? 0x40 : 0x00) | (pid >> 8));
+        packet[2] = (uint8_t)(pid & 0xff);
+
+        // 适配域长度（含长度字节本身）：首包可能携带 PCR/随机访问标志，末包用于填充
+        uint32_t adaptation = 0;
+        if(first && (pcr || random_access))
+        {
+            adaptation = 2 + (pcr ? 6 : 0);
+        }
+        uint32_t remaining = total - written;
+        if(remaining < kTsPacketSize - 4 - adaptation)
+        {
+            adaptation = kTsPacketSize - 4 - remaining;
+        }
+        packet[3] = (uint8_t)((adaptation > 0 ? 0x30 : 0x10) | (cc & 0x0f));
+        cc++;
+
+        uint32_t pos = 4;
+        if(adaptation > 0)
+        {
+            packet[pos++] = (uint8_t)(adaptation - 1);
+            if(adaptation > 1)
+            {
+                uint8_t flags = 0;
+                if(first && random_access)
+                {
+                    flags |= 0x40;
+                }
+                if(first && pcr)
+                {
+                    flags |= 0x10;
+                }
+                packet[pos++] = flags;
+                if(flags & 0x10)
+                {
+                    uint64_t base = dts - (dts > 90 * 100 ? 90 * 100 : 0);  // PCR 略早于 DTS
+                    packet[pos++] = (uint8_t)(base >> 25);
+                    packet[pos++] = (uint8_t)(base >> 17);
+                    packet[pos++] = (uint8_t)(base >> 9);
+                    packet[pos++] = (uint8_t)(base >> 1);
+                    packet[pos++] = (uint8_t)(((base & 0x01) << 7) | 0x7e);
+                    packet[pos++] = 0x00;
+                }
+                memset(packet + pos, 0xff, 4 + adaptation - pos);
+                pos = 4 + adaptation;
+            }
+        }
+
+        uint32_t payload = kTsPacketSize - pos;
+        uint32_t header_left = written < header.size() ? (uint32_t)header.size() - written : 0;
+        uint32_t from_header = header_left < payload ? header_left : payload;
+        if(from_header > 0)
+        {
+            memcpy(packet + pos, header.data() + written, from_header);
+        }
+        if(payload > from_header)
+        {
+            memcpy(packet + pos + from_header, es_.data() + (written + from_header - header.size()), payload - from_header);
+        }
+        written += payload;
+        out.append((const char*)packet, kTsPacketSize);
+        first = false;
+    }
+}
+
+/**
+ * @brief PSI 段放入单个 TS 包：pointer_field + 段 + 0xff 填充
+ */
+void TsMuxer::WriteSection(uint16_t pid, uint8_t& cc, const uint8_t* section, uint32_t size, std::string& out)
+{
+    uint8_t packet[kTsPacketSize];
+    memset(packet, 0xff, sizeof(packet));
+    packet[0] = 0x47;
+    packet[1] = (uint8_t)(0x40 | (pid >> 8));
+    packet[2] = (uint8_t)(pid & 0xff);
+    packet[3] = (uint8_t)(0x10 | (cc & 0x0f));
+    cc++;
+    packet[4] = 0x00;
+    memcpy(packet + 5, section, size);
+    out.append((const char*)packet, kTsPacketSize);
+}
+
+/**
+ * @brief MPEG-2 CRC32，逐位计算（每个切片只调用两次）
+ */
+uint32_t TsMuxer::Crc32(const uint8_t* data, uint32_t size)
+{
+    uint32_t crc = 0xffffffff;
+    for(uint32_t i = 0; i < size; i++)
+    {
+        crc ^= (uint32_t)data[i] << 24;
+        for(int bit = 0; bit < 8; bit++)
+        {
+            crc = (crc & 0x80000000) ? (crc << 1) ^ 0x04c11db7 : (crc << 1);
+        }
+    }
+    return crc;
+}
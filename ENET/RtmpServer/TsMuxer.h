@@ -0,0 +1,108 @@
+/**
+ * @file TsMuxer.h
+ * @brief 将 FLV 封装的 H.264/AAC 负载转换为 MPEG-TS 包，供 HLS 切片使用。
+ *
+ * 视频: AVCC（长度前缀 NALU）转为 Annex-B，关键帧前插入 SPS/PPS，每帧前插入 AUD；
+ * 音频: 原始 AAC 帧加 ADTS 头；
+ * 每帧封装为一个 PES，再拆分为 188 字节 TS 包，视频 PES 携带 PCR。
+ */
+
+#ifndef _TSMUXER_H_
+#define _TSMUXER_H_
+
+#include <cstdint>
+#include <string>
+
+/**
+ * @class TsMuxer
+ * @brief 单路流的 MPEG-TS 复用器，输出追加到调用者提供的缓冲区
+ */
+class TsMuxer
+{
+public:
+    TsMuxer();
+
+    /**
+     * @brief 解析 FLV AVC Sequence Header（AVCDecoderConfigurationRecord）
+     * @param data FLV 视频负载
+     * @param size 负载长度
+     * @return true 解析成功
+     */
+    bool SetAvcSequenceHeader(const char* data, uint32_t size);
+
+    /**
+     * @brief 解析 FLV AAC Sequence Header（AudioSpecificConfig）
+     * @param data FLV 音频负载
+     * @param size 负载长度
+     * @return true 解析成功
+     */
+    bool SetAacSequenceHeader(const char* data, uint32_t size);
+
+    bool HasVideo() const { return has_video_; }
+    bool HasAudio() const { return has_audio_; }
+
+    /**
+     * @brief 写入 PAT 和 PMT，每个切片（分片）开始时调用，使其可独立解析
+     * @param out 输出缓冲区
+     */
+    void WriteTables(std::string& out);
+
+    /**
+     * @brief 将一帧 FLV 视频负载封装为 TS 包
+     * @param data FLV 视频负载
+     * @param size 负载长度
+     * @param timestamp 解码时间戳（毫秒）
+     * @param out 输出缓冲区
+     * @return true 已写入，false 表示不是可封装的 H.264 帧
+     */
+    bool WriteVideo(const char* data, uint32_t size, uint64_t timestamp, std::string& out);
+
+    /**
+     * @brief 将一帧 FLV 音频负载封装为 TS 包
+     * @param data FLV 音频负载
+     * @param size 负载长度
+     * @param timestamp 时间戳（毫秒）
+     * @param out 输出缓冲区
+     * @return true 已写入，false 表示不是可封装的 AAC 帧
+     */
+    bool WriteAudio(const char* data, uint32_t size, uint64_t timestamp, std::string& out);
+
+private:
+    /**
+     * @brief 将 es_ 中的一帧封装为 PES 并拆分为 TS 包
+     * @param pid 基本流 PID
+     * @param stream_id PES stream_id
+     * @param pts 显示时间戳（90kHz）
+     * @param dts 解码时间戳（90kHz）
+     * @param random_access 是否标记随机访问点
+     * @param pcr 是否在首个 TS 包携带 PCR
+     * @param out 输出缓冲区
+     */
+    void WritePes(uint16_t pid, uint8_t stream_id, uint64_t pts, uint64_t dts, bool random_access, bool pcr, std::string& out);
+
+    /**
+     * @brief 写入一个只包含 PSI 段的 TS 包
+     */
+    void WriteSection(uint16_t pid, uint8_t& cc, const uint8_t* section, uint32_t size, std::string& out);
+
+    /**
+     * @brief MPEG-2 CRC32（多项式 0x04C11DB7）
+     */
+    static uint32_t Crc32(const uint8_t* data, uint32_t size);
+
+    bool has_video_ = false;          ///< 是否已收到 AVC 序列头
+    bool has_audio_ = false;          ///< 是否已收到 AAC 序列头
+    std::string sps_pps_;             ///< Annex-B 格式的 SPS/PPS，关键帧前插入
+    uint32_t nalu_length_size_ = 4;   ///< AVCC NALU 长度字段字节数
+    uint8_t aac_object_type_ = 2;     ///< AAC object type（LC 为 2）
+    uint8_t aac_sample_index_ = 4;    ///< 采样率索引
+    uint8_t aac_channels_ = 2;        ///< 声道配置
+
+    uint8_t pat_cc_ = 0;              ///< PAT 连续计数器
+    uint8_t pmt_cc_ = 0;              ///< PMT 连续计数器
+    uint8_t video_cc_ = 0;            ///< 视频 PID 连续计数器
+    uint8_t audio_cc_ = 0;            ///< 音频 PID 连续计数器
+    std::string es_;                  ///< 复用的基本流帧缓冲区
+};
+
+#endif // _TSMUXER_H_
@@ -0,0 +1,165 @@
+/**
+ * @file VodPlayer.cpp
+ * @brief 实现 VodPlayer：关键帧定位、实时节奏与发送队列背压。
+ */
+#include "VodPlayer.h"
+#include "../EdoyunNet/TaskScheduler.h"
+#include <chrono>
+
+/** 发送位置之前提示内核预读的字节数 */
+static const uint64_t kPrefetchBytes = 2 * 1024 * 1024;
+
+static int64_t GetNowMs()
+{
+    return std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+/**
+ * @brief 构造函数
+ */
+VodPlayer::VodPlayer(FlvVodFile::Ptr file, uint32_t max_run_bytes, const SendCallback& send_cb,
+                     const PendingCallback& pending_cb, const EndCallback& end_cb)
+    :file_(file)
+    ,max_run_bytes_(max_run_bytes)
+    ,send_cb_(send_cb)
+    ,pending_cb_(pending_cb)
+    ,end_cb_(end_cb)
+{
+}
+
+/**
+ * @brief 定位起点后注册定时器，定时器只持有弱引用，连接释放发送器后自动结束
+ */
+void VodPlayer::Start(TaskScheduler* scheduler, uint32_t start_ms)
+{
+    Seek(start_ms);
+    std::weak_ptr<VodPlayer> weak_player = shared_from_this();
+    scheduler->AddTimer([weak_player]() {
+        auto player = weak_player.lock();
+        if(!player || player->stopped_)
+        {
+            return false;
+        }
+        player->Pump();
+        return true;
+    }, kTickInterval);
+    Pump();
+}
+
+/**
+ * @brief 按关键帧索引定位，纯音频文件从媒体数据起点开始
+ */
+uint32_t VodPlayer::Seek(uint32_t timestamp)
+{
+    FlvVodFile::KeyFrame key_frame;
+    if(file_->FindKeyFrame(timestamp, key_frame))
+    {
+        offset_ = key_frame.offset;
+        base_timestamp_ = key_frame.timestamp;
+    }
+    else
+    {
+        FlvVodFile::Tag tag;
+        offset_ = file_->GetMediaOffset();
+        base_timestamp_ = file_->ReadTag(offset_, tag) ? tag.timestamp : 0;
+    }
+    base_time_ = GetNowMs();
+    burst_ms_ = kInitialBufferMs;
+    position_ = base_timestamp_;
+    prefetched_ = offset_;
+    finished_ = false;
+    return base_timestamp_;
+}
+
+/**
+ * @brief 暂停时播放器缓冲中已有约一个初始缓冲的数据，恢复后从暂停处按实时速度继续，不再突发
+ */
+void VodPlayer::Pause(bool pause)
+{
+    if(pause)
+    {
+        paused_ = true;
+    }
+    else if(paused_)
+    {
+        paused_ = false;
+        base_timestamp_ = position_;
+        base_time_ = GetNowMs();
+        burst_ms_ = 0;
+        Pump();
+    }
+}
+
+/**
+ * @brief 把时间戳已到的 tag 按段交给连接，直到发送队列达到上限或下一个 tag 未到时间
+ */
+void VodPlayer::Pump()
+{
+    if(stopped_ || paused_ || finished_ || pumping_)
+    {
+        return;
+    }
+    pumping_ = true;
+
+    uint64_t allowed = (uint64_t)base_timestamp_ + (uint64_t)(GetNowMs() - base_time_) + burst_ms_;
+    uint64_t end = file_->GetSize();
+    while(!stopped_ && offset_ < end && pending_cb_() < kMaxPendingBytes)
+    {
+        if(offset_ + kPrefetchBytes / 2 > prefetched_)
+        {
+            uint64_t begin = prefetched_ > offset_ ? prefetched_ : offset_;
+            file_->Prefetch(begin, kPrefetchBytes);
+            prefetched_ = begin + kPrefetchBytes;
+        }
+
+        // 收集一段连续的 tag，段长不超过 max_run_bytes_
+        FlvVodFile::Tag tag;
+        uint32_t run_size = 0;
+        uint32_t first_timestamp = 0;
+        bool valid = true;
+        while(offset_ + run_size < end)
+        {
+            if(!file_->ReadTag(offset_ + run_size, tag))
+            {
+                valid = false;
+                break;
+            }
+            if(tag.timestamp > allowed || (run_size > 0 && run_size + tag.size > max_run_bytes_))
+            {
+                break;
+            }
+            if(run_size == 0)
+            {
+                first_timestamp = tag.timestamp;
+            }
+            position_ = tag.timestamp;
+            run_size += tag.size;
+        }
+
+        if(run_size > 0)
+        {
+            send_cb_(offset_, run_size, first_timestamp);
+            offset_ += run_size;
+            sent_bytes_ += run_size;
+        }
+        if(!valid)
+        {
+            offset_ = end;                        // 文件内容损坏，按结束处理
+        }
+        if(run_size == 0)
+        {
+            break;
+        }
+    }
+
+    if(offset_ >= end && !stopped_)
+    {
+        finished_ = true;
+        if(end_cb_)
+        {
+            end_cb_();
+        }
+    }
+    pumping_ = false;
+}
@@ -0,0 +1,110 @@
+/**
+ * @file VodPlayer.h
+ * @brief 点播发送器：按实时速度把映射文件中的 tag 交给观看者连接，起播与拖动后先突发一段缓冲。
+ *
+ * 主要职责：
+ *  - 以关键帧索引定位起播/拖动位置，从该关键帧的 tag 开始顺序发送
+ *  - 允许发送的时间戳为起点加已过时长再加初始缓冲，播放器先收到一段缓冲，之后与实时同速
+ *  - 每次交出一段连续的完整 tag（文件内范围），由连接决定封装方式（RTMP 聚合消息或 HTTP-FLV 原始 tag）
+ *  - 连接发送队列超过上限时暂停读取文件，点播观看者不丢帧
+ *
+ * RTMP 与 HTTP-FLV 观看者共用，只在所属连接的调度线程上运行。
+ */
+
+#ifndef _VODPLAYER_H_
+#define _VODPLAYER_H_
+
+#include "FlvVodFile.h"
+#include <functional>
+#include <memory>
+
+class TaskScheduler;
+
+/**
+ * @class VodPlayer
+ * @brief 单个点播观看者的发送器，由观看者连接持有
+ */
+class VodPlayer : public std::enable_shared_from_this<VodPlayer>
+{
+public:
+    using Ptr = std::shared_ptr<VodPlayer>;
+    /** 发送一段连续的完整 tag：offset/size 为文件内范围，timestamp 为首个 tag 的时间戳 */
+    using SendCallback = std::function<void(uint64_t offset, uint32_t size, uint32_t timestamp)>;
+    /** 获取连接发送队列中尚未写入内核的字节数 */
+    using PendingCallback = std::function<uint64_t()>;
+    /** 文件发送完毕 */
+    using EndCallback = std::function<void()>;
+
+    /** 定时检查的周期（毫秒） */
+    static const uint32_t kTickInterval = 20;
+    /** 起播与拖动后立即发送的媒体时长（毫秒） */
+    static const uint32_t kInitialBufferMs = 3000;
+    /** 连接发送队列超过该字节数时暂停读取文件 */
+    static const uint32_t kMaxPendingBytes = 512 * 1024;
+
+    /**
+     * @brief 构造函数
+     * @param file 点播文件
+     * @param max_run_bytes 每段连续 tag 的最大字节数，单个 tag 超过时单独成段
+     * @param send_cb 发送一段 tag
+     * @param pending_cb 获取发送积压
+     * @param end_cb 发送完毕
+     */
+    VodPlayer(FlvVodFile::Ptr file, uint32_t max_run_bytes, const SendCallback& send_cb,
+              const PendingCallback& pending_cb, const EndCallback& end_cb);
+
+    /**
+     * @brief 定位到起点并开始定时发送
+     * @param scheduler 观看者连接所在的调度线程
+     * @param start_ms 起播位置（毫秒），从不晚于该位置的关键帧开始
+     */
+    void Start(TaskScheduler* scheduler, uint32_t start_ms);
+
+    /**
+     * @brief 拖动到 timestamp 之前的关键帧，重新开始初始缓冲
+     * @param timestamp 目标位置（毫秒）
+     * @return 实际开始的位置（关键帧时间戳）
+     */
+    uint32_t Seek(uint32_t timestamp);
+
+    /**
+     * @brief 暂停或恢复发送，恢复时从暂停处继续按实时速度发送
+     */
+    void Pause(bool pause);
+
+    /**
+     * @brief 发送时间戳已到且发送队列未满的 tag，由定时器与连接的写队列回调调用
+     */
+    void Pump();
+
+    /**
+     * @brief 停止发送，定时器在下一次到期时结束
+     */
+    void Stop() { stopped_ = true; }
+
+    FlvVodFile::Ptr GetFile() const { return file_; }
+    uint64_t GetSentBytes() const { return sent_bytes_; }      ///< 已交给连接的文件字节数
+    uint32_t GetPosition() const { return position_; }         ///< 最近发送的时间戳（毫秒）
+    bool IsFinished() const { return finished_; }              ///< 是否已发送到文件末尾
+
+private:
+    FlvVodFile::Ptr file_;              ///< 点播文件
+    uint32_t max_run_bytes_;            ///< 每段连续 tag 的最大字节数
+    SendCallback send_cb_;
+    PendingCallback pending_cb_;
+    EndCallback end_cb_;
+
+    uint64_t offset_ = 0;               ///< 下一个待发送 tag 的偏移
+    uint64_t prefetched_ = 0;           ///< 已提示预读到的偏移
+    uint32_t base_timestamp_ = 0;       ///< 计时起点对应的媒体时间戳
+    int64_t base_time_ = 0;             ///< 计时起点（毫秒）
+    uint32_t burst_ms_ = kInitialBufferMs; ///< 超前于实时的媒体时长
+    uint32_t position_ = 0;             ///< 最近发送的时间戳
+    uint64_t sent_bytes_ = 0;           ///< 已发送的文件字节数
+    bool paused_ = false;               ///< 是否暂停
+    bool stopped_ = false;              ///< 是否已停止
+    bool finished_ = false;             ///< 是否已发送到文件末尾
+    bool pumping_ = false;              ///< 防止发送回调中重入
+};
+
+#endif // _VODPLAYER_H_
@@ -0,0 +1,54 @@
+/**
+ * @file WorkerRelayServer.cpp
+ * @brief 实现 WorkerRelayServer 的创建与连接分发。
+ */
+#include "WorkerRelayServer.h"
+#include "RtmpConnection.h"
+#include "RtmpServer.h"
+#include "../EdoyunNet/EventLoop.h"
+#include <unistd.h>
+
+/**
+ * @brief 静态工厂方法，创建中继监听服务实例
+ * @param eventloop 事件循环
+ * @param rtmp_server RTMP 服务
+ * @return 中继监听服务共享指针
+ */
+std::shared_ptr<WorkerRelayServer> WorkerRelayServer::Create(EventLoop* eventloop, std::shared_ptr<RtmpServer> rtmp_server)
+{
+    std::shared_ptr<WorkerRelayServer> server(new WorkerRelayServer(eventloop, rtmp_server));
+    return server;
+}
+
+/**
+ * @brief 私有构造函数
+ */
+WorkerRelayServer::WorkerRelayServer(EventLoop* eventloop, std::shared_ptr<RtmpServer> rtmp_server)
+    :TcpServer(eventloop)
+    ,loop_(eventloop)
+    ,rtmp_server_(rtmp_server)
+{
+}
+
+/**
+ * @brief 析构函数
+ */
+WorkerRelayServer::~WorkerRelayServer()
+{
+}
+
+/**
+ * @brief TCP 新连接回调，中继连接与公共端口的连接一样处理 play
+ * @param socket 新连接的 socket 描述符
+ * @return 对应的 RtmpConnection 智能指针
+ */
+TcpConnection::Ptr WorkerRelayServer::OnConnect(int socket)
+{
+    auto rtmp_server = rtmp_server_.lock();
+    if(!rtmp_server)
+    {
+        ::close(socket);
+        return nullptr;
+    }
+    return std::make_shared<RtmpConnection>(rtmp_server, loop_->GetTaskSchduler().get(), socket);
+}
@@ -0,0 +1,55 @@
+/**
+ * @file WorkerRelayServer.h
+ * @brief 多进程模式下工作进程之间的中继监听：只监听回环地址，接受其他工作进程的拉流连接。
+ *
+ * 公共端口以 SO_REUSEPORT 在所有工作进程间分发，无法指定由哪个进程接受；
+ * 每个工作进程另在 127.0.0.1:(基准端口 + 编号) 上监听，连接以 RtmpConnection 加入本进程的会话，
+ * 其他进程的观看者落到没有推流的进程时，由该进程经此端口向推流所在的进程拉流（见 RtmpServer::RouteStream）。
+ */
+
+#ifndef _WORKERRELAYSERVER_H_
+#define _WORKERRELAYSERVER_H_
+
+#include "../EdoyunNet/TcpServer.h"
+#include <memory>
+
+class RtmpServer;
+
+/**
+ * @class WorkerRelayServer
+ * @brief 基于 TcpServer 的中继监听服务，为每个连接创建与公共端口相同的 RtmpConnection
+ */
+class WorkerRelayServer : public TcpServer, public std::enable_shared_from_this<WorkerRelayServer>
+{
+public:
+    /**
+     * @brief 创建中继监听服务实例
+     * @param eventloop 事件循环，与 RtmpServer 相同
+     * @param rtmp_server 提供会话的 RTMP 服务
+     * @return 中继监听服务共享指针
+     */
+    static std::shared_ptr<WorkerRelayServer> Create(EventLoop* eventloop, std::shared_ptr<RtmpServer> rtmp_server);
+
+    /**
+     * @brief 析构函数
+     */
+    ~WorkerRelayServer();
+
+private:
+    /**
+     * @brief 私有构造，仅通过 Create() 调用
+     */
+    WorkerRelayServer(EventLoop* eventloop, std::shared_ptr<RtmpServer> rtmp_server);
+
+    /**
+     * @brief TCP 新连接回调，创建 RtmpConnection
+     * @param socket 新连接的 socket 描述符
+     * @return 连接对象，RTMP 服务已销毁时返回 nullptr
+     */
+    virtual TcpConnection::Ptr OnConnect(int socket) override;
+
+    EventLoop* loop_;                         ///< 事件循环
+    std::weak_ptr<RtmpServer> rtmp_server_;   ///< 共享会话表的 RTMP 服务
+};
+
+#endif // _WORKERRELAYSERVER_H_
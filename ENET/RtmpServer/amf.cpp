@@ -3,6 +3,7 @@
 // 描述: 实现 RTMP 协议中 AMF0(Action Message Format) 的编解码。
 //   - AmfDecoder: 将网络字节流中的 AMF0 数据解析为内存对象
 //   - AmfEncoder: 将内存对象序列化为 AMF0 格式字节流
+//   - AmfReader: 在原始字节流上零分配地读取与跳过 AMF0 值
 // 主要流程:
 //   解码: 根据类型标记(AMF0DataType)依次调用 decodeBoolean/Number/String/Object
 //   编码: 按照 AMF0 规范写入类型标记 + 数据长度/值
@@ -176,6 +177,47 @@ uint32_t AmfDecoder::decodeInt32(const char *data, int size)
     return ReadUint32BE((char*)data);
 }
 
+// reset: 清空上一次解码的结果
+void AmfDecoder::reset()
+{
+    m_obj.amf_string.clear();
+    m_obj.amf_number = 0;
+    m_obj.amf_boolean = false;
+    m_objs.clear();
+}
+
+std::string AmfDecoder::getString() const
+{
+    return m_obj.amf_string;
+}
+
+double AmfDecoder::getNumber() const
+{
+    return m_obj.amf_number;
+}
+
+bool AmfDecoder::hasObject(const std::string &key) const
+{
+    return m_objs.find(key) != m_objs.end();
+}
+
+// getObject: 键不存在时返回空对象，不向集合中插入
+AmfObject AmfDecoder::getObject(const std::string &key)
+{
+    auto iter = m_objs.find(key);
+    return iter != m_objs.end() ? iter->second : AmfObject();
+}
+
+AmfObject AmfDecoder::getObject()
+{
+    return m_obj;
+}
+
+AmfObjects AmfDecoder::getObjects()
+{
+    return m_objs;
+}
+
 // 构造函数: 预分配编码缓冲区
 AmfEncoder::AmfEncoder(uint32_t size)
     : m_data(new char[size], std::default_delete<char[]>()), m_size(size), m_index(0)
@@ -186,6 +228,22 @@ AmfEncoder::~AmfEncoder()
 {
 }
 
+// reset: 写入偏移归零，缓冲区保留复用
+void AmfEncoder::reset()
+{
+    m_index = 0;
+}
+
+std::shared_ptr<char> AmfEncoder::data()
+{
+    return m_data;
+}
+
+uint32_t AmfEncoder::size() const
+{
+    return m_index;
+}
+
 // encodeString: 序列化字符串类型
 // @param str      字符串数据指针
 // @param len      字符串字节长度
@@ -200,7 +258,7 @@ void AmfEncoder::encodeString(const char *str, int len, bool isObject)
     //编码字符串
     if((m_size - m_index) < (len + 1 + 2 + 2)) //当前内存剩余空间不足
     {
-        this->realloc(m_size + len + 5); //扩容
+        this->realloc(m_index + len + 5); //扩容
     }
 
     if(len < 65536) //afm0_string
@@ -282,7 +340,7 @@ void AmfEncoder::encodeObjects(AmfObjects &objs)
     //否则不为空，就是一个对象类型
     
     encodeInt8(AMF0_OBJECT);
-    for(auto iter : objs) //遍历编码 键-> string 值->对象
+    for(const auto &iter : objs) //遍历编码 键-> string 值->对象
     {
         //我们先编码字符 编码键
         encodeString(iter.first.c_str(),(int)iter.first.size(),false);
@@ -322,7 +380,7 @@ void AmfEncoder::encodeECMA(AmfObjects &objs)
     encodeInt32(0);
 
     //编码对象数组
-    for(auto iter : objs)
+    for(const auto &iter : objs)
     {
          //我们先编码字符 编码键
         encodeString(iter.first.c_str(),(int)iter.first.size(),false);
@@ -376,7 +434,7 @@ void AmfEncoder::encodeInt16(int16_t value)
 // @param value 24 位整数
 void AmfEncoder::encodeInt24(int32_t value)
 {
-    if((m_size - m_index) < 1)
+    if((m_size - m_index) < 3)
     {
         this->realloc(m_size + 1024);
     }
@@ -389,7 +447,7 @@ void AmfEncoder::encodeInt24(int32_t value)
 // @param value 32 位整数
 void AmfEncoder::encodeInt32(int32_t value)
 {
-    if((m_size - m_index) < 1)
+    if((m_size - m_index) < 4)
     {
         this->realloc(m_size + 1024);
     }
@@ -398,8 +456,9 @@ void AmfEncoder::encodeInt32(int32_t value)
 }
 
 // realloc: 扩展内部缓冲区大小
-// @param size 新缓冲区大小
-// 逻辑: 如果新大小 <= 当前大小，则不做处理；否则分配新内存并拷贝已有数据
+// @param size 至少需要的缓冲区大小
+// 逻辑: 如果新大小 <= 当前大小，则不做处理；否则按两倍增长分配新内存并拷贝已有数据，
+//       编码大对象时扩容次数为对数级
 void AmfEncoder::realloc(uint32_t size)
 {
     //扩容
@@ -407,9 +466,299 @@ void AmfEncoder::realloc(uint32_t size)
     {
         return ;
     }
+    if(size < m_size * 2)
+    {
+        size = m_size * 2;
+    }
 
     std::shared_ptr<char> data(new char[size],std::default_delete<char[]>());
     memcpy(data.get(),m_data.get(),m_index);
     m_size = size;
     m_data = data;
 }
+
+// AmfReader 嵌套对象的最大深度，防止恶意数据造成深递归
+static const int kMaxAmfDepth = 16;
+
+bool AmfStringView::equals(const char* str) const
+{
+    uint32_t len = (uint32_t)strlen(str);
+    return len == size && memcmp(data, str, len) == 0;
+}
+
+AmfReader::AmfReader(const char* data, uint32_t size)
+    : m_data(data), m_size(data ? size : 0), m_pos(0)
+{
+}
+
+// readString: 短字符串 2 字节长度，长字符串 4 字节长度，返回指向原始缓冲区的视图
+bool AmfReader::readString(AmfStringView& value)
+{
+    if(remaining() < 3)
+    {
+        return false;
+    }
+
+    const char* p = m_data + m_pos;
+    uint32_t header = 0;
+    uint32_t len = 0;
+    if(p[0] == AMF0_STRING)
+    {
+        header = 3;
+        len = ReadUint16BE((char*)p + 1);
+    }
+    else if(p[0] == AMF0_LONG_STRING && remaining() >= 5)
+    {
+        header = 5;
+        len = ReadUint32BE((char*)p + 1);
+    }
+    else
+    {
+        return false;
+    }
+
+    if(len > remaining() - header)
+    {
+        return false;
+    }
+    value.data = p + header;
+    value.size = len;
+    m_pos += header + len;
+    return true;
+}
+
+bool AmfReader::readNumber(double& value)
+{
+    if(remaining() < 9 || m_data[m_pos] != AMF0_NUMBER)
+    {
+        return false;
+    }
+
+    // 大端转小端
+    const char* ci = m_data + m_pos + 1;
+    char* co = (char*)&value;
+    for(int i = 0; i < 8; ++i)
+    {
+        co[i] = ci[7 - i];
+    }
+    m_pos += 9;
+    return true;
+}
+
+bool AmfReader::readBoolean(bool& value)
+{
+    if(remaining() < 2 || m_data[m_pos] != AMF0_BOOLEAN)
+    {
+        return false;
+    }
+
+    value = (m_data[m_pos + 1] != 0);
+    m_pos += 2;
+    return true;
+}
+
+// readObject: object 的范围是属性列表（不含结束标记），之后可用 findString/findNumber 查找
+bool AmfReader::readObject(AmfReader& object)
+{
+    if(remaining() < 1)
+    {
+        return false;
+    }
+
+    char type = m_data[m_pos];
+    uint32_t pos = m_pos + 1;
+    if(type == AMF0_NULL || type == AMF0_UNDEFINED)
+    {
+        object = AmfReader(m_data + pos, 0);
+        m_pos = pos;
+        return true;
+    }
+    if(type == AMF0_ECMA_ARRAY)
+    {
+        pos += 4;                                  // 元素个数不可信，以结束标记为准
+        if(pos > m_size)
+        {
+            return false;
+        }
+    }
+    else if(type != AMF0_OBJECT)
+    {
+        return false;
+    }
+
+    uint32_t begin = pos;
+    if(!skipProperties(m_data, m_size, pos, 0))
+    {
+        return false;
+    }
+    object = AmfReader(m_data + begin, pos - 3 - begin);
+    m_pos = pos;
+    return true;
+}
+
+bool AmfReader::skip()
+{
+    uint32_t pos = m_pos;
+    if(!skipValue(m_data, m_size, pos, 0))
+    {
+        return false;
+    }
+    m_pos = pos;
+    return true;
+}
+
+bool AmfReader::findString(const char* key, AmfStringView& value) const
+{
+    uint32_t offset = 0;
+    if(!findValue(key, offset))
+    {
+        return false;
+    }
+    AmfReader reader(m_data + offset, m_size - offset);
+    return reader.readString(value);
+}
+
+bool AmfReader::findNumber(const char* key, double& value) const
+{
+    uint32_t offset = 0;
+    if(!findValue(key, offset))
+    {
+        return false;
+    }
+    AmfReader reader(m_data + offset, m_size - offset);
+    return reader.readNumber(value);
+}
+
+// findValue: 从属性列表开头线性查找，命令对象的属性通常不超过十个
+bool AmfReader::findValue(const char* key, uint32_t& offset) const
+{
+    uint32_t key_len = (uint32_t)strlen(key);
+    uint32_t pos = 0;
+    while(m_size - pos >= 2)
+    {
+        uint32_t len = ReadUint16BE((char*)m_data + pos);
+        pos += 2;
+        if(len > m_size - pos)
+        {
+            return false;
+        }
+        bool match = (len == key_len && memcmp(m_data + pos, key, len) == 0);
+        pos += len;
+        if(match)
+        {
+            offset = pos;
+            return true;
+        }
+        if(!skipValue(m_data, m_size, pos, 1))
+        {
+            return false;
+        }
+    }
+    return false;
+}
+
+// skipValue: 按类型标记跳过一个值，嵌套对象与数组递归处理
+bool AmfReader::skipValue(const char* data, uint32_t size, uint32_t& pos, int depth)
+{
+    if(pos >= size || depth > kMaxAmfDepth)
+    {
+        return false;
+    }
+
+    uint32_t left = size - pos - 1;
+    switch (data[pos++])
+    {
+    case AMF0_NUMBER:
+        if(left < 8) return false;
+        pos += 8;
+        return true;
+    case AMF0_BOOLEAN:
+        if(left < 1) return false;
+        pos += 1;
+        return true;
+    case AMF0_STRING:
+    {
+        if(left < 2) return false;
+        uint32_t len = ReadUint16BE((char*)data + pos);
+        if(len > left - 2) return false;
+        pos += 2 + len;
+        return true;
+    }
+    case AMF0_LONG_STRING:
+    case AMF0_XML_DOC:
+    {
+        if(left < 4) return false;
+        uint32_t len = ReadUint32BE((char*)data + pos);
+        if(len > left - 4) return false;
+        pos += 4 + len;
+        return true;
+    }
+    case AMF0_NULL:
+    case AMF0_UNDEFINED:
+    case AMF0_UNSUPPORTED:
+        return true;
+    case AMF0_REFERENCE:
+        if(left < 2) return false;
+        pos += 2;
+        return true;
+    case AMF0_DATE:
+        if(left < 10) return false;
+        pos += 10;
+        return true;
+    case AMF0_OBJECT:
+        return skipProperties(data, size, pos, depth + 1);
+    case AMF0_ECMA_ARRAY:
+        if(left < 4) return false;
+        pos += 4;
+        return skipProperties(data, size, pos, depth + 1);
+    case AMF0_TYPED_OBJECT:
+    {
+        if(left < 2) return false;
+        uint32_t len = ReadUint16BE((char*)data + pos);
+        if(len > left - 2) return false;
+        pos += 2 + len;                            // 类名
+        return skipProperties(data, size, pos, depth + 1);
+    }
+    case AMF0_STRICT_ARRAY:
+    {
+        if(left < 4) return false;
+        uint32_t count = ReadUint32BE((char*)data + pos);
+        pos += 4;
+        for(uint32_t i = 0; i < count; i++)
+        {
+            if(!skipValue(data, size, pos, depth + 1))
+            {
+                return false;
+            }
+        }
+        return true;
+    }
+    default:
+        return false;                              // AMF3 等不支持的类型
+    }
+}
+
+// skipProperties: 跳过 键名 + 值 序列，直到空键名 + AMF0_OBJECT_END，pos 停在结束标记之后
+bool AmfReader::skipProperties(const char* data, uint32_t size, uint32_t& pos, int depth)
+{
+    while(size - pos >= 3)
+    {
+        uint32_t len = ReadUint16BE((char*)data + pos);
+        if(len == 0 && data[pos + 2] == AMF0_OBJECT_END)
+        {
+            pos += 3;
+            return true;
+        }
+        pos += 2;
+        if(len > size - pos)
+        {
+            return false;
+        }
+        pos += len;
+        if(!skipValue(data, size, pos, depth))
+        {
+            return false;
+        }
+    }
+    return false;
+}
@@ -4,6 +4,7 @@
 //   - 支持基本类型：Number、Boolean、String
 //   - 支持复合类型：Object (键值对)、ECMA Array
 //   - 用于 RTMP 命令消息（如 connect、play、pause 等）的序列化和解析
+//   - AmfReader 在原始字节上按需读取，不构造中间对象，用于热路径上的命令与元数据解析
 //=============================================================================
 
 #ifndef _AMF_H_
@@ -157,4 +158,58 @@ private:
     uint32_t m_index;             // 当前写入偏移
 };
 
+// AmfStringView: 指向 AMF 字节流内部的字符串，不拥有内存，生命周期不超过原始缓冲区
+struct AmfStringView
+{
+    const char* data = nullptr; // 字符串起始地址（不以 '\0' 结尾）
+    uint32_t    size = 0;       // 字符串字节长度
+
+    // equals: 与以 '\0' 结尾的字符串比较
+    bool equals(const char* str) const;
+    bool operator==(const char* str) const { return equals(str); }
+    bool operator!=(const char* str) const { return !equals(str); }
+    // toString: 需要保存时再拷贝为 std::string
+    std::string toString() const { return std::string(data, size); }
+};
+
+// AmfReader: 零分配的 AMF0 读取器
+// 直接在消息负载上顺序读取值，字符串以 AmfStringView 返回，对象按需查找属性，
+// 跳过不关心的值时不做任何拷贝；读取失败时位置不变
+class AmfReader
+{
+public:
+    AmfReader(const char* data = nullptr, uint32_t size = 0);
+
+    // readString: 读取 String/Long String
+    bool readString(AmfStringView& value);
+    // readNumber: 读取 Number
+    bool readNumber(double& value);
+    // readBoolean: 读取 Boolean
+    bool readBoolean(bool& value);
+    // readObject: 读取 Object/ECMA Array，object 指向其属性列表；Null/Undefined 视为空对象
+    bool readObject(AmfReader& object);
+    // skip: 跳过一个任意类型的值
+    bool skip();
+
+    // findString/findNumber: 在 readObject 得到的属性列表中按键查找，不移动读取位置
+    bool findString(const char* key, AmfStringView& value) const;
+    bool findNumber(const char* key, double& value) const;
+
+    // position: 已读取的字节数
+    uint32_t position() const { return m_pos; }
+    // remaining: 剩余字节数
+    uint32_t remaining() const { return m_size - m_pos; }
+
+private:
+    // findValue: 在属性列表中查找键，返回值的起始偏移
+    bool findValue(const char* key, uint32_t& offset) const;
+    // skipValue/skipProperties: 从 pos 开始跳过一个值或一组属性，depth 限制嵌套深度
+    static bool skipValue(const char* data, uint32_t size, uint32_t& pos, int depth);
+    static bool skipProperties(const char* data, uint32_t size, uint32_t& pos, int depth);
+
+    const char* m_data; // 原始字节流，不拥有内存
+    uint32_t m_size;    // 字节流长度
+    uint32_t m_pos;     // 当前读取偏移
+};
+
 #endif // _AMF_H_
\ No newline at end of file
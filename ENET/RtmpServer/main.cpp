@@ -1,24 +1,232 @@
 #include <iostream>
+#include <stdlib.h>
+#include <string.h>
+#include <vector>
 #include "../EdoyunNet/EventLoop.h"
+#include "../EdoyunNet/WorkerSupervisor.h"
 #include "RtmpServer.h"
+#include "HttpFlvServer.h"
+#include "HlsServer.h"
+#include "RecordService.h"
+#include "ForwardService.h"
+#include "StatsServer.h"
+#include "WorkerRelayServer.h"
 
-int main()
+static const char* kServerIp = "192.168.31.30";
+static const uint16_t kServerPort = 1935;
+static const uint16_t kHttpFlvPort = 8080;
+static const uint16_t kHlsPort = 8081;
+static const uint16_t kStatsPort = 8082;
+// 多进程模式下工作进程 i 在 127.0.0.1 上监听的中继端口与统计端口（基准 + i）
+static const uint16_t kWorkerRelayPort = 19350;
+static const uint16_t kWorkerStatsPort = 18082;
+
+// 工作进程数，0 表示单进程运行
+static int g_workers = 0;
+
+// 录制目录，为空时不录制
+static std::string g_record_dir;
+// 边缘模式的源站列表，为空时不回源
+static std::vector<std::string> g_edge_origins;
+// 推流转发的下游列表，为空时不转发
+static std::vector<std::string> g_forward_targets;
+// RTMP 观看者聚合窗口（毫秒），0 表示逐帧发送
+static uint32_t g_aggregate_window = 0;
+// 自适应码率的档位后缀（如 "_720,_480"），为空时观看者不切换档位
+static std::vector<std::string> g_abr_suffixes;
+// 点播目录，没有推流的路径发送该目录下的同名 FLV 文件，为空时不提供点播
+static std::string g_vod_root;
+// 时移窗口（秒），0 表示关闭；开启后观看者可以请求 "?delay=秒" 落后直播播放
+static uint32_t g_time_shift_window = 0;
+// 每个会话的 GOP 缓存上限（KB），-1 表示使用默认值（4MB），0 表示关闭（新观看者等待下一个关键帧）
+static int g_gop_cache_kb = -1;
+
+// 按逗号拆分地址列表
+static void SplitList(const std::string& list, std::vector<std::string>& items)
+{
+    for(size_t pos = 0; pos <= list.size(); )
+    {
+        size_t end = list.find(',', pos);
+        if(end == std::string::npos)
+        {
+            end = list.size();
+        }
+        if(end > pos)
+        {
+            items.push_back(list.substr(pos, end - pos));
+        }
+        pos = end + 1;
+    }
+}
+
+// 运行一个 RTMP 服务实例；channel_fd >= 0 时以工作进程身份运行并与监控进程通信
+static int RunServer(int worker_id, int channel_fd)
 {
-    int count = std::thread::hardware_concurrency();
     EventLoop loop(2);
     auto rtmp_server = RtmpServer::Create(&loop);
     rtmp_server->SetChunkSize(60000);
-    rtmp_server->SetEventCallback([](std::string type,std::string stream_path){
-        printf("[Event]%s,stream_path%s\n",type.c_str(),stream_path.c_str());
+    rtmp_server->SetEventCallback([worker_id](std::string type,std::string stream_path){
+        printf("[Event][worker %d]%s,stream_path%s\n",worker_id,type.c_str(),stream_path.c_str());
     });
-    if(!rtmp_server->Start("192.168.31.30",1935))
+    // 边缘模式：本地没有推流的流向源站回源，无观看者 10 秒后断开
+    if(!g_edge_origins.empty())
+    {
+        rtmp_server->SetEdgeOrigins(g_edge_origins, 10000);
+    }
+    // 普通音视频帧按窗口打包为聚合消息，减少观看者的 send 调用次数
+    if(g_aggregate_window > 0)
+    {
+        rtmp_server->SetPlayerAggregate(g_aggregate_window);
+    }
+    // 自适应码率：观看者在源流与各档位流之间按关键帧切换，积压 1 秒降档，10 秒后尝试升档
+    if(!g_abr_suffixes.empty())
+    {
+        rtmp_server->SetAdaptiveBitrate(g_abr_suffixes, 1000, 10000);
+    }
+    // 点播：/app/name 对应 点播目录/app/name.flv，文件映射在观看者之间共享
+    if(!g_vod_root.empty())
+    {
+        rtmp_server->SetVodRoot(g_vod_root);
+    }
+    // GOP 缓存：所有会话合计不超过 256MB
+    if(g_gop_cache_kb >= 0)
+    {
+        rtmp_server->SetGopCache((uint32_t)g_gop_cache_kb * 1024, 256ULL * 1024 * 1024);
+    }
+    // 时移：每条流在内存中保留最近 g_time_shift_window 秒，所有流合计不超过 512MB
+    if(g_time_shift_window > 0)
+    {
+        rtmp_server->SetTimeShift(g_time_shift_window * 1000, 512ULL * 1024 * 1024);
+    }
+    if(channel_fd >= 0)
+    {
+        rtmp_server->SetWorkerChannel(std::make_shared<WorkerChannel>(&loop, worker_id, channel_fd));
+        rtmp_server->SetWorkerRelayPort(kWorkerRelayPort);
+    }
+    // 各工作进程以 SO_REUSEPORT 监听同一端口，由内核分发连接
+    if(!rtmp_server->Start(kServerIp,kServerPort))
     {
         printf("rtmp server failed\n");
+        return 1;
     }
     printf("rtmp server success\n");
+    // 推流在其他工作进程时，观看者所在的工作进程经回环中继端口向推流所在的工作进程拉流
+    std::shared_ptr<WorkerRelayServer> relay_server;
+    if(channel_fd >= 0)
+    {
+        relay_server = WorkerRelayServer::Create(&loop, rtmp_server);
+        if(!relay_server->Start("127.0.0.1", kWorkerRelayPort + worker_id))
+        {
+            printf("worker relay server failed\n");
+            return 1;
+        }
+    }
+    // HTTP-FLV 观看者与 RTMP 观看者共用同一套会话
+    auto flv_server = HttpFlvServer::Create(&loop, rtmp_server);
+    if(!flv_server->Start(kServerIp,kHttpFlvPort))
+    {
+        printf("http-flv server failed\n");
+        return 1;
+    }
+    printf("http-flv server success\n");
+    // HLS/LL-HLS 切片在内存中按流生成一次，2 秒切片、500 毫秒分片
+    auto hls_server = HlsServer::Create(&loop, rtmp_server);
+    hls_server->SetSegment(2000, 500, 6);
+    if(!hls_server->Start(kServerIp,kHlsPort))
+    {
+        printf("hls server failed\n");
+        return 1;
+    }
+    printf("hls server success\n");
+    // 录制由独立写线程写盘，磁盘慢时丢帧计数，不影响事件循环
+    std::shared_ptr<RecordService> record_service;
+    if(!g_record_dir.empty())
+    {
+        record_service = RecordService::Create(&loop, rtmp_server, g_record_dir, 2);
+        record_service->SetRotation(10 * 60 * 1000, 0);
+    }
+    // 每条推流转发到所有下游，下游变慢时各自丢帧到关键帧，断开后 1 秒重连
+    std::shared_ptr<ForwardService> forward_service;
+    if(!g_forward_targets.empty())
+    {
+        forward_service = ForwardService::Create(&loop, rtmp_server, g_forward_targets);
+    }
+    // 统计接口：/stats 输出 JSON，/metrics 输出 Prometheus 文本
+    auto stats_server = StatsServer::Create(&loop, rtmp_server);
+    if(!stats_server->Start(kServerIp,kStatsPort))
+    {
+        printf("stats server failed\n");
+        return 1;
+    }
+    printf("stats server success\n");
+    // 多进程模式：每个工作进程另在回环端口提供本进程的统计，对外端口的请求汇总所有工作进程
+    std::shared_ptr<StatsServer> local_stats_server;
+    if(channel_fd >= 0)
+    {
+        local_stats_server = StatsServer::Create(&loop, rtmp_server);
+        if(!local_stats_server->Start("127.0.0.1", kWorkerStatsPort + worker_id))
+        {
+            printf("worker stats server failed\n");
+            return 1;
+        }
+        stats_server->SetWorkerPeers(worker_id, (uint32_t)g_workers, kWorkerStatsPort);
+    }
     //getchar();
     	while (1) {
 		std::this_thread::sleep_for(std::chrono::milliseconds(100));
 	}
     return 0;
-}
\ No newline at end of file
+}
+
+// 用法: RtmpSvr [-w 工作进程数] [-r 录制目录] [-o 源站ip:port[,ip:port...]] [-f 下游ip:port[,ip:port...]] [-a 聚合窗口毫秒] [-A 档位后缀[,档位后缀...]] [-v 点播目录] [-T 时移窗口秒数] [-g GOP缓存KB]，不指定 -w 时以单进程方式运行
+int main(int argc, char** argv)
+{
+    for(int i = 1; i < argc - 1; i++)
+    {
+        if(strcmp(argv[i], "-w") == 0)
+        {
+            g_workers = atoi(argv[i + 1]);
+        }
+        else if(strcmp(argv[i], "-r") == 0)
+        {
+            g_record_dir = argv[i + 1];
+        }
+        else if(strcmp(argv[i], "-o") == 0)
+        {
+            SplitList(argv[i + 1], g_edge_origins);
+        }
+        else if(strcmp(argv[i], "-f") == 0)
+        {
+            SplitList(argv[i + 1], g_forward_targets);
+        }
+        else if(strcmp(argv[i], "-a") == 0)
+        {
+            g_aggregate_window = (uint32_t)atoi(argv[i + 1]);
+        }
+        else if(strcmp(argv[i], "-A") == 0)
+        {
+            SplitList(argv[i + 1], g_abr_suffixes);
+        }
+        else if(strcmp(argv[i], "-v") == 0)
+        {
+            g_vod_root = argv[i + 1];
+        }
+        else if(strcmp(argv[i], "-T") == 0)
+        {
+            g_time_shift_window = (uint32_t)atoi(argv[i + 1]);
+        }
+        else if(strcmp(argv[i], "-g") == 0)
+        {
+            g_gop_cache_kb = atoi(argv[i + 1]);
+        }
+    }
+
+    if(g_workers <= 0)
+    {
+        return RunServer(0, -1);
+    }
+
+    // 监控进程不创建任何线程，必须在 EventLoop 之前 fork
+    WorkerSupervisor supervisor(g_workers);
+    return supervisor.Run(RunServer) < 0 ? 1 : 0;
+}
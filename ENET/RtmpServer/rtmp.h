@@ -35,6 +35,8 @@ static const int RTMP_VIDEO = 0x09;
 static const int RTMP_NOTIFY = 0x12;
 /** 调用消息（Command Message） */
 static const int RTMP_INVOKE = 0x14;
+/** 聚合消息（Aggregate Message），包含多个音视频子消息 */
+static const int RTMP_AGGREGATE = 0x16;
 
 // --- Chunk 头格式类型（FMT 类型） ---------------------------------------------
 /** 基本头类型 0 (完整消息头) */
@@ -97,6 +99,17 @@ public:
     void SetPeerBandwidth(uint32_t size)
     { peer_bandwidth_ = size; }
 
+    /**
+     * @brief 设置确认窗口，对端每收到该字节数后回复一次 Acknowledgement
+     * @param size 窗口大小（字节）
+     */
+    void SetAcknowledgementSize(uint32_t size)
+    {
+        if (size > 0) {
+            acknowledgement_size_ = size;
+        }
+    }
+
     /**
      * @brief 获取当前最大 Chunk 大小
      * @return Chunk 大小（字节）